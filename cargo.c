@@ -30,14 +30,21 @@
 #include "cargo.h"
 #include <stdarg.h>
 #include <limits.h>
+#include <locale.h>
 #ifdef _WIN32
 #include <windows.h>
 #include <io.h>
 #define strcasecmp _stricmp
 #else // _WIN32 (Unix below)
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <wordexp.h>
+#ifndef CARGO_NO_THREADS
+#include <pthread.h>
+#endif
 #endif // _WIN32
 
 #ifdef __APPLE__
@@ -65,6 +72,33 @@
 #define CARGO_ULONGLONG_FMT "llu"
 #endif
 
+#ifndef LLONG_MAX
+#define LLONG_MAX ((long long)(~0ULL >> 1))
+#endif
+#ifndef LLONG_MIN
+#define LLONG_MIN (-LLONG_MAX - 1)
+#endif
+#ifndef ULLONG_MAX
+#define ULLONG_MAX (~0ULL)
+#endif
+
+#ifndef CARGO_NO_THREADS
+// Threads used to convert a large array with CARGO_PARALLEL_CONVERT,
+// and the smallest number of values worth splitting up.
+#ifndef CARGO_CONVERT_THREADS
+#define CARGO_CONVERT_THREADS 4
+#endif
+#ifndef CARGO_PARALLEL_MIN_VALUES
+#define CARGO_PARALLEL_MIN_VALUES 65536
+#endif
+#endif // CARGO_NO_THREADS
+
+// The most values a range list such as "[u-]+" expands to for one
+// argument, so a single huge range can't exhaust the memory.
+#ifndef CARGO_MAX_RANGE_VALUES
+#define CARGO_MAX_RANGE_VALUES 1048576
+#endif
+
 #ifdef C90
 #include <math.h>
 #define cargo_fabs fabs
@@ -89,47 +123,83 @@ void cargo_set_memfunctions(cargo_malloc_f malloc_replacement,
     replaced_cargo_free = free_replacement;
 }
 
-static void *_cargo_malloc(size_t size)
+//
+// Memory owned by a context is allocated through its cargo_mem_t, which
+// holds the allocator given to cargo_init_with_allocator (if any) and
+// counts the heap calls made. A NULL cargo_mem_t, or one without an
+// allocator, falls back to the global functions above.
+//
+typedef struct cargo_mem_s
+{
+    cargo_allocator_t alloc;
+    size_t count;               // Heap allocations since the last reset.
+} cargo_mem_t;
+
+static void *_cargo_malloc(cargo_mem_t *m, size_t size)
 {
     if (size == 0)
         return NULL;
 
+    if (m)
+    {
+        m->count++;
+
+        if (m->alloc.malloc_fn)
+            return m->alloc.malloc_fn(m->alloc.user, size);
+    }
+
     if (replaced_cargo_malloc)
         return replaced_cargo_malloc(size);
 
     return malloc(size);
 }
 
-static void *_cargo_realloc(void *ptr, size_t size)
+static void *_cargo_realloc(cargo_mem_t *m, void *ptr, size_t size)
 {
+    if (m)
+    {
+        m->count++;
+
+        if (m->alloc.realloc_fn)
+            return m->alloc.realloc_fn(m->alloc.user, ptr, size);
+    }
+
     return replaced_cargo_realloc ? replaced_cargo_realloc(ptr, size) : realloc(ptr, size);
 }
 
-static void _cargo_free(void *ptr)
+static void _cargo_free(cargo_mem_t *m, void *ptr)
 {
-    if (replaced_cargo_free)
+    if (m && m->alloc.free_fn)
+    {
+        if (ptr)
+            m->alloc.free_fn(m->alloc.user, ptr);
+    }
+    else if (replaced_cargo_free)
         replaced_cargo_free(ptr);
     else
         free(ptr);
 }
 
-static void *_cargo_calloc(size_t count, size_t size)
+static void *_cargo_calloc(cargo_mem_t *m, size_t count, size_t size)
 {
     void *p = NULL;
 
     if (!count || !size)
         return NULL;
 
-    if (replaced_cargo_malloc)
+    if ((m && m->alloc.malloc_fn) || replaced_cargo_malloc)
     {
         size_t sz = count * size;
         // TODO: If count > (size_t max / size), goto fail.
-        p = replaced_cargo_malloc(sz);
+        p = _cargo_malloc(m, sz);
 
         if (p)
             return memset(p, 0, sz);
     }
 
+    if (m)
+        m->count++;
+
     p = calloc(count, size);
 
     #ifdef _WIN32
@@ -144,7 +214,7 @@ static void *_cargo_calloc(size_t count, size_t size)
     return p;
 }
 
-static char *_cargo_strdup(const char *str)
+static char *_cargo_strdup(cargo_mem_t *m, const char *str)
 {
     if (!str)
     {
@@ -152,7 +222,7 @@ static char *_cargo_strdup(const char *str)
         return NULL;
     }
 
-    if (replaced_cargo_malloc)
+    if ((m && m->alloc.malloc_fn) || replaced_cargo_malloc)
     {
         size_t len = strlen(str);
         void *p = NULL;
@@ -160,13 +230,16 @@ static char *_cargo_strdup(const char *str)
         if (len == ((size_t)-1))
             goto fail;
 
-        if ((p = replaced_cargo_malloc(len + 1)))
+        if ((p = _cargo_malloc(m, len + 1)))
         {
             return memcpy(p, str, len + 1);
         }
     }
     else
     {
+        if (m)
+            m->count++;
+
         #ifdef _WIN32
         return _strdup(str);
         #else
@@ -283,7 +356,7 @@ int cargo_snprintf(char *buf, size_t buflen, const char *format, ...)
     return r;
 }
 
-char *cargo_strndup(const char *s, size_t n)
+static char *_cargo_strndup(cargo_mem_t *m, const char *s, size_t n)
 {
     char *res;
     size_t len = strlen(s);
@@ -293,7 +366,7 @@ char *cargo_strndup(const char *s, size_t n)
         len = n;
     }
 
-    if (!(res = (char *)_cargo_malloc(len + 1)))
+    if (!(res = (char *)_cargo_malloc(m, len + 1)))
     {
         return NULL;
     }
@@ -302,6 +375,240 @@ char *cargo_strndup(const char *s, size_t n)
     return (char *)memcpy(res, s, len);
 }
 
+char *cargo_strndup(const char *s, size_t n)
+{
+    return _cargo_strndup(NULL, s, n);
+}
+
+//
+// Scratch arena.
+//
+// A bump pointer allocator for memory that is only needed until the next
+// parse, such as the argument lists, highlights and error messages.
+// Nothing is freed individually, instead everything is released at once
+// when the arena is reset at the start of a parse. Once the arena has
+// grown big enough to fit a parse in a single block, a reset is O(1)
+// and a parse makes no heap calls for these.
+//
+#define CARGO_ARENA_MIN_SIZE 1024
+#define CARGO_ARENA_ALIGN sizeof(double)
+#define CARGO_ARENA_ALIGN_SIZE(sz) \
+    (((sz) + (CARGO_ARENA_ALIGN - 1)) & ~(CARGO_ARENA_ALIGN - 1))
+
+typedef struct cargo_arena_block_s
+{
+    struct cargo_arena_block_s *prev;
+    size_t size;
+    double align;               // Makes the data after this aligned.
+} cargo_arena_block_t;
+
+typedef struct cargo_arena_s
+{
+    char *buf;                  // The memory currently allocated from.
+    size_t size;
+    size_t used;
+    char *last;                 // Last allocation, can be grown in place.
+    char *user_buf;             // Optional buffer supplied by the user.
+    size_t user_size;
+    cargo_arena_block_t *blocks; // Heap blocks, newest first.
+    size_t block_count;
+    size_t next_size;           // Size of the next block to allocate.
+    cargo_mem_t *mem;           // Where the blocks are allocated from.
+} cargo_arena_t;
+
+static void *_cargo_arena_alloc(cargo_arena_t *a, size_t size)
+{
+    char *p = NULL;
+    cargo_arena_block_t *b = NULL;
+    assert(a);
+
+    size = CARGO_ARENA_ALIGN_SIZE(CARGO_MAX(size, 1));
+
+    if (!a->buf || ((a->size - a->used) < size))
+    {
+        size_t block_size = CARGO_MAX(size, a->next_size);
+        block_size = CARGO_MAX(block_size, CARGO_ARENA_MIN_SIZE);
+
+        if (!(b = _cargo_malloc(a->mem, sizeof(cargo_arena_block_t) + block_size)))
+        {
+            return NULL;
+        }
+
+        b->size = block_size;
+        b->prev = a->blocks;
+        a->blocks = b;
+        a->block_count++;
+
+        a->buf = (char *)(b + 1);
+        a->size = block_size;
+        a->used = 0;
+        a->next_size = block_size * 2;
+    }
+
+    p = a->buf + a->used;
+    a->used += size;
+    a->last = p;
+
+    return p;
+}
+
+static void *_cargo_arena_calloc(cargo_arena_t *a, size_t count, size_t size)
+{
+    void *p = NULL;
+
+    if ((p = _cargo_arena_alloc(a, count * size)))
+    {
+        memset(p, 0, count * size);
+    }
+
+    return p;
+}
+
+static void *_cargo_arena_realloc(cargo_arena_t *a, void *ptr,
+                                  size_t old_size, size_t size)
+{
+    char *p = (char *)ptr;
+    void *n = NULL;
+
+    if (!p)
+    {
+        return _cargo_arena_alloc(a, size);
+    }
+
+    // Grow the last allocation in place if there is room.
+    if ((p == a->last)
+        && (CARGO_ARENA_ALIGN_SIZE(size) <= (a->size - (size_t)(p - a->buf))))
+    {
+        a->used = (size_t)(p - a->buf) + CARGO_ARENA_ALIGN_SIZE(size);
+        return p;
+    }
+
+    if ((n = _cargo_arena_alloc(a, size)))
+    {
+        memcpy(n, p, CARGO_MIN(old_size, size));
+    }
+
+    return n;
+}
+
+static char *_cargo_arena_strndup(cargo_arena_t *a, const char *str, size_t len)
+{
+    char *p = NULL;
+
+    if ((p = _cargo_arena_alloc(a, len + 1)))
+    {
+        memcpy(p, str, len);
+        p[len] = '\0';
+    }
+
+    return p;
+}
+
+static char *_cargo_arena_strdup(cargo_arena_t *a, const char *str)
+{
+    return _cargo_arena_strndup(a, str, strlen(str));
+}
+
+// Makes room for one more element in a list allocated from the arena.
+static int _cargo_arena_grow(cargo_arena_t *a, void *list, size_t *max,
+                             size_t count, size_t size)
+{
+    void **l = (void **)list;
+    void *n = NULL;
+    size_t new_max;
+
+    if (count < *max)
+        return 0;
+
+    new_max = *max ? (*max * 2) : 16;
+
+    if (!(n = _cargo_arena_realloc(a, *l, *max * size, new_max * size)))
+    {
+        return -1;
+    }
+
+    *l = n;
+    *max = new_max;
+
+    return 0;
+}
+
+static int _cargo_arena_owns(cargo_arena_t *a, const void *ptr)
+{
+    const char *p = (const char *)ptr;
+    cargo_arena_block_t *b = NULL;
+
+    if (!p)
+        return 0;
+
+    if (a->user_buf && (p >= a->user_buf) && (p < a->user_buf + a->user_size))
+        return 1;
+
+    for (b = a->blocks; b; b = b->prev)
+    {
+        const char *data = (const char *)(b + 1);
+
+        if ((p >= data) && (p < data + b->size))
+            return 1;
+    }
+
+    return 0;
+}
+
+static void _cargo_arena_free_blocks(cargo_arena_t *a)
+{
+    cargo_arena_block_t *b = NULL;
+
+    while (a->blocks)
+    {
+        b = a->blocks;
+        a->blocks = b->prev;
+        _cargo_free(a->mem, b);
+    }
+
+    a->block_count = 0;
+}
+
+static void _cargo_arena_reset(cargo_arena_t *a)
+{
+    size_t total = 0;
+    cargo_arena_block_t *b = NULL;
+    assert(a);
+
+    // If the last parse needed more than one block, replace them with
+    // one block big enough for all of it on the next allocation.
+    if (a->user_buf || (a->block_count > 1))
+    {
+        for (b = a->blocks; b; b = b->prev)
+        {
+            total += b->size;
+        }
+
+        _cargo_arena_free_blocks(a);
+        a->next_size = total;
+    }
+
+    if (a->user_buf)
+    {
+        a->buf = a->user_buf;
+        a->size = a->user_size;
+    }
+    else
+    {
+        a->buf = a->blocks ? (char *)(a->blocks + 1) : NULL;
+        a->size = a->blocks ? a->blocks->size : 0;
+    }
+
+    a->used = 0;
+    a->last = NULL;
+}
+
+static void _cargo_arena_destroy(cargo_arena_t *a)
+{
+    _cargo_arena_free_blocks(a);
+    memset(a, 0, sizeof(cargo_arena_t));
+}
+
 typedef struct cargo_str_s
 {
     char *s;
@@ -335,6 +642,8 @@ typedef struct cargo_astr_s
     size_t l;
     size_t offset;
     size_t diff;
+    cargo_arena_t *arena;   // Allocate from this instead of the heap if set.
+    cargo_mem_t *mem;       // Heap to allocate from otherwise.
 } cargo_astr_t;
 
 int cargo_avappendf(cargo_astr_t *str, const char *format, va_list ap)
@@ -353,7 +662,9 @@ int cargo_avappendf(cargo_astr_t *str, const char *format, va_list ap)
 
         str->offset = 0;
 
-        if (!(*str->s = _cargo_calloc(1, str->l)))
+        if (!(*str->s = str->arena
+                        ? _cargo_arena_calloc(str->arena, 1, str->l)
+                        : _cargo_calloc(str->mem, 1, str->l)))
         {
             CARGODBG(1, "Out of memory!\n");
             return -1;
@@ -379,11 +690,14 @@ int cargo_avappendf(cargo_astr_t *str, const char *format, va_list ap)
 
         if ((size_t)ret >= str->diff)
         {
+            size_t old_l = str->l;
             if (str->l == 0) str->l = CARGO_ASTR_DEFAULT_SIZE;
             str->l *= 2;
             CARGODBG(4, "Realloc %lu\n", str->l);
 
-            if (!(*str->s = _cargo_realloc(*str->s, str->l)))
+            if (!(*str->s = str->arena
+                    ? _cargo_arena_realloc(str->arena, *str->s, old_l, str->l)
+                    : _cargo_realloc(str->mem, *str->s, str->l)))
             {
                 CARGODBG(1, "Out of memory!\n");
                 return -1;
@@ -433,7 +747,8 @@ int _vscprintf(const char *format, va_list argptr)
 // Below is code for translating ANSI color escape codes to
 // windows equivalent API calls.
 //
-int cargo_vasprintf(char **strp, const char *format, va_list ap)
+static int _cargo_vasprintf(cargo_mem_t *m, char **strp,
+                            const char *format, va_list ap)
 {
     int count;
     va_list apc;
@@ -446,7 +761,7 @@ int cargo_vasprintf(char **strp, const char *format, va_list ap)
 
     if (count == 0)
     {
-        *strp = _cargo_strdup("");
+        *strp = _cargo_strdup(m, "");
         return 0;
     }
     else if (count < 0)
@@ -456,7 +771,7 @@ int cargo_vasprintf(char **strp, const char *format, va_list ap)
     }
 
     // Allocate memory for our string
-    if (!(*strp = _cargo_malloc(count + 1)))
+    if (!(*strp = _cargo_malloc(m, count + 1)))
     {
         return -1;
     }
@@ -465,6 +780,11 @@ int cargo_vasprintf(char **strp, const char *format, va_list ap)
     return vsprintf(*strp, format, ap);
 }
 
+int cargo_vasprintf(char **strp, const char *format, va_list ap)
+{
+    return _cargo_vasprintf(NULL, strp, format, ap);
+}
+
 int cargo_asprintf(char** strp, const char* format, ...)
 {
     va_list ap;
@@ -763,7 +1083,7 @@ void cargo_fprintf(FILE *fd, const char *fmt, ...)
         cargo_print_ansicolor(fd, s);
     }
 
-    if (s) _cargo_free(s);
+    if (s) _cargo_free(NULL, s);
 }
 
 // Overload the normal printf!
@@ -799,6 +1119,7 @@ const char *_cargo_type_to_str(cargo_type_t type)
         case CARGO_STRING: return "string";
         case CARGO_LONGLONG: return "long long";
         case CARGO_ULONGLONG: return "unsigned long long";
+        case CARGO_EXTENSION: return "extension";
     }
 
     return NULL;
@@ -812,6 +1133,23 @@ typedef enum cargo_bool_acc_op_e
     CARGO_BOOL_OP_STORE
 } cargo_bool_acc_op_t;
 
+typedef union cargo_vals_s
+{
+    int i;
+    unsigned int u;
+    float f;
+    double d;
+    long long int ll;
+    unsigned long long ull;
+} cargo_vals_t;
+
+typedef struct cargo_range_validation_s
+{
+    cargo_vals_t min;
+    cargo_vals_t max;
+    cargo_vals_t epsilon;
+} cargo_range_validation_t;
+
 struct cargo_validation_s
 {
     const char *name;
@@ -824,6 +1162,16 @@ struct cargo_validation_s
 
 typedef struct cargo_group_s cargo_group_t;
 
+// A scalar type added using cargo_add_type.
+typedef struct cargo_ext_type_s
+{
+    char fmt;                   // Format character for the type.
+    char *name;
+    size_t size;
+    cargo_type_f parse;
+    void *user;
+} cargo_ext_type_t;
+
 typedef struct cargo_opt_s
 {
     char *name[CARGO_NAME_COUNT];
@@ -832,10 +1180,14 @@ typedef struct cargo_opt_s
     char *metavar;
     int positional;
     cargo_type_t type;
+    cargo_ext_type_t ext;       // The type when it is CARGO_EXTENSION.
     int nargs;
     int alloc;
     int str_alloc_items;        // If we should allocate string items
                                 // (but not the array).
+    int str_borrow;             // Point string targets into argv instead
+                                // of copying them, see CARGO_OPT_BORROW_STRING.
+    int str_borrowed;           // The current string targets are borrowed.
 
     int group_index;
     size_t mutex_group_idxs[CARGO_MAX_OPT_MUTEX_GROUP];
@@ -849,14 +1201,21 @@ typedef struct cargo_opt_s
 
     char **custom_target;       // Internal storage for args passed to callback.
     size_t custom_target_count; // Internal count for args passed to callbac.
+    int internal_target;        // Target points to the custom target above.
 
     void **target;              // Pointer to target values.
     size_t target_idx;          // Current index into target values.
     size_t *target_count;       // Return value or number of parsed target values.
     size_t lenstr;              // String length.
     size_t max_target_count;    // Max values to store in an array.
+    size_t target_alloc_count;  // Values allocated for an unbounded array.
+    size_t target_alloc_hint;   // Values counted ahead for an unbounded array.
 
     int array;                  // Is this option being parsed as an array?
+    char delimiter;             // Separates values within one argument "[i,]+".
+    int ranges;                 // Values are range lists "[i-]+" or "m#".
+    int bitmap;                 // The target is a bitmap "m#".
+    size_t bitmap_bits;         // Number of bits in a bitmap target.
     int parsed;                 // The argv index when we last parsed the option
     cargo_option_flags_t flags;
     int num_eaten;              // How many arguments consumed by this option.
@@ -865,6 +1224,11 @@ typedef struct cargo_opt_s
     int bool_store;             // Value to store when a bool flag is set.
     int bool_count;             // If we should count occurances for bool flag.
 
+    // Bool bit target "B", the target is the bitset word with the bit.
+    unsigned long long bit_mask;
+    int bit_value;              // The bool value the bit is set from.
+    int bit_loaded;             // bit_value has been read in this parse.
+
     // Bool accumulator related.
     int *bool_acc;              // Values to accumulate.
     cargo_bool_acc_op_t bool_acc_op;    // Operation used to accumulate.
@@ -875,6 +1239,7 @@ typedef struct cargo_opt_s
 
     cargo_validation_t *validation; // Validation for target values.
     cargo_validation_flags_t validation_flags;
+    cargo_range_validation_t *range;    // A built-in range validation.
 } cargo_opt_t;
 
 #define CARGO_DEFAULT_MAX_GROUPS 4
@@ -895,6 +1260,75 @@ struct cargo_group_s
     void *user;
 };
 
+// Entry in the option name index. Refers to a name by its option and
+// name index, since the options array can be reallocated.
+typedef struct cargo_name_entry_s
+{
+    size_t opt_i;
+    size_t name_i;
+    unsigned int hash;
+    int used;
+} cargo_name_entry_t;
+
+// Open addressing hash table over all option names and aliases.
+typedef struct cargo_name_index_s
+{
+    cargo_name_entry_t *entries;
+    size_t count;
+    size_t size;                // Always a power of 2.
+} cargo_name_index_t;
+
+#define CARGO_NAME_INDEX_MIN_SIZE 64
+
+// Node in the character trie over all option names. Children are kept as
+// a linked list of siblings, nodes are referred to by index.
+typedef struct cargo_trie_node_s
+{
+    char c;
+    size_t child;           // First child (0 means none, 0 is the root).
+    size_t sibling;         // Next sibling (0 means none).
+    size_t opt_i;           // An option with a name in this subtree.
+    size_t name_i;
+    int ambiguous;          // More than one option has names in this subtree.
+    int terminal;           // A name ends at this node.
+    size_t term_opt_i;      // The option and name ending here.
+    size_t term_name_i;
+} cargo_trie_node_t;
+
+typedef enum cargo_token_kind_e
+{
+    CARGO_TOKEN_ARG,            // A value or positional argument.
+    CARGO_TOKEN_OPTION,         // Matches an option name.
+    CARGO_TOKEN_OPTION_COMPACT, // Bundled bool options such as "-vvv" or "-abc".
+    CARGO_TOKEN_UNKNOWN         // Has a prefix but matches no option.
+} cargo_token_kind_t;
+
+// An option name without its prefix, to suggest for unknown options.
+typedef struct cargo_suggest_name_s
+{
+    const char *name;
+    size_t len;
+    size_t opt_i;
+    size_t name_i;
+} cargo_suggest_name_t;
+
+// Classification of an argv element, done once before parsing.
+typedef struct cargo_token_s
+{
+    cargo_token_kind_t kind;
+    size_t opt_i;               // Option index for CARGO_TOKEN_OPTION*.
+    const char *name;           // The name the option was matched by.
+    size_t prefix_len;          // Number of leading prefix characters.
+    int negative;               // Is this a negative number?
+} cargo_token_t;
+
+// A response file mapped into memory, see CARGO_RESPONSE_FILES.
+typedef struct cargo_mapping_s
+{
+    char *data;
+    size_t size;
+} cargo_mapping_t;
+
 typedef struct cargo_s
 {
     char *progname;
@@ -912,6 +1346,9 @@ typedef struct cargo_s
     int stopped;
     int stopped_hard;
 
+    cargo_token_t *tokens;  // Classification of each argv element.
+    size_t max_tokens;
+
     int help;
 
     cargo_group_t *groups;
@@ -925,8 +1362,18 @@ typedef struct cargo_s
     cargo_opt_t *options;
     size_t opt_count;
     size_t max_opts;
+    cargo_name_index_t name_index;
+    cargo_trie_node_t *trie;
+    size_t trie_count;
+    size_t trie_max;
+    int trie_dirty;             // Names changed since the trie was built.
     const char *prefix;
 
+    size_t *positionals;        // Indices of positional options in order.
+    size_t positional_count;
+    size_t max_positionals;
+    size_t positional_cursor;   // First positional that is not yet filled.
+
     char **unknown_opts;
     int *unknown_opts_idxs;
     size_t unknown_opts_count;
@@ -934,14 +1381,62 @@ typedef struct cargo_s
     char **args;
     size_t arg_count;
 
+    // Streamed parse, see cargo_parse_begin.
+    int streaming;
+    int stream_final;           // No more arguments will be pushed.
+    cargo_flags_t stream_flags; // Flags to restore when the parse ends.
+    char **stream_argv;         // Pushed arguments that are not yet parsed.
+    size_t stream_count;
+    size_t stream_max;
+    size_t stream_base;         // Number of arguments parsed and dropped.
+    cargo_opt_t *stream_opt;    // Option still taking values when
+    const char *stream_name;    // the pushed arguments ran out.
+    size_t max_args;            // Size of the lists below when streaming.
+    size_t max_unknown_opts;
+
+    int batching;               // Parsing a line of cargo_parse_batch.
+
+    cargo_mapping_t *mappings;  // Response files the args point into.
+    size_t mapping_count;
+    size_t max_mappings;
+
+    cargo_ext_type_t *ext_types;    // Types added using cargo_add_type.
+    size_t ext_type_count;
+
+    cargo_suggest_name_t *suggest_names;    // Built for the first unknown
+    size_t suggest_name_count;              // option of a parse.
+
     char *error;
     char *short_usage;
     char *usage;
 
+    // Errors and warnings of the last parse. The error message is only
+    // rendered from the last record once it is asked for.
+    cargo_error_record_t *records;
+    size_t record_count;
+    size_t max_records;
+    int error_pending;          // The last record is not in error yet.
+
+    cargo_mem_t mem;            // Allocator for everything the context owns.
+    cargo_arena_t arena;        // Scratch memory, reset on each parse.
+
     void *user;
+
+    cargo_compiled_t compiled;  // Set for a parse state of a compiled parser.
 } cargo_s;
 
-static void _cargo_xfree(void *p)
+// A parser that can no longer be changed. The definitions are shared
+// read-only by any number of parse states (see cargo_state_init), which
+// each have their own copy of the options with the targets rebased from
+// the template onto the memory given for that state.
+struct cargo_compiled_s
+{
+    cargo_t ctx;
+    char *tmpl;
+    size_t tmpl_size;
+};
+
+static void _cargo_xfree(cargo_mem_t *m, void *p)
 {
     void **pp;
     assert(p);
@@ -950,17 +1445,101 @@ static void _cargo_xfree(void *p)
 
     if (*pp)
     {
-        _cargo_free(*pp);
+        _cargo_free(m, *pp);
         *pp = NULL;
     }
 }
 
+static cargo_ext_type_t *_cargo_find_ext_type(cargo_t ctx, char fmt)
+{
+    size_t i;
+
+    for (i = 0; i < ctx->ext_type_count; i++)
+    {
+        if (ctx->ext_types[i].fmt == fmt)
+            return &ctx->ext_types[i];
+    }
+
+    return NULL;
+}
+
+static int _cargo_is_compiled(cargo_t ctx)
+{
+    // The definitions of a parse state are shared with the
+    // compiled parser it was created from, so they can't change.
+    if (ctx->compiled)
+    {
+        CARGODBG(1, "Cannot change the definitions of a compiled parser\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+static void _cargo_ctx_free(cargo_t ctx, void *p)
+{
+    // Scratch memory is released all at once on the next parse.
+    if (!_cargo_arena_owns(&ctx->arena, p))
+    {
+        _cargo_free(&ctx->mem, p);
+    }
+}
+
+//
+// Adds an error or warning record. A new error replaces an error that
+// is the last record, so there is at most one, while warnings are all
+// kept. The text of a record is only put together when needed.
+//
+static cargo_error_record_t *_cargo_add_record(cargo_t ctx,
+                                               cargo_error_code_t code,
+                                               int warning)
+{
+    cargo_error_record_t *r = NULL;
+
+    if (!warning && (ctx->record_count > 0)
+        && !ctx->records[ctx->record_count - 1].warning)
+    {
+        ctx->record_count--;
+    }
+
+    if (_cargo_arena_grow(&ctx->arena, &ctx->records, &ctx->max_records,
+                          ctx->record_count, sizeof(cargo_error_record_t)))
+    {
+        CARGODBG(1, "Out of memory\n");
+        return NULL;
+    }
+
+    r = &ctx->records[ctx->record_count++];
+    r->code = code;
+    r->warning = warning;
+    r->opt_i = -1;
+    r->name = NULL;
+    r->argi = -1;
+    r->prev_argi = -1;
+
+    return r;
+}
+
 static void _cargo_set_error(cargo_t ctx, char *error)
 {
     assert(ctx);
 
-    _cargo_xfree(&ctx->error);
+    _cargo_ctx_free(ctx, ctx->error);
     ctx->error = error;
+    ctx->error_pending = 0;
+
+    if (error)
+    {
+        _cargo_add_record(ctx, CARGO_ERROR_MESSAGE, 0);
+    }
+}
+
+// Sets the error to be rendered from a record the next time it is needed.
+static void _cargo_set_error_record(cargo_t ctx, cargo_error_record_t *r)
+{
+    _cargo_ctx_free(ctx, ctx->error);
+    ctx->error = NULL;
+    ctx->error_pending = (r != NULL);
 }
 
 static cargo_fprint_flags_t _cargo_get_cflag(cargo_t ctx)
@@ -971,7 +1550,7 @@ static cargo_fprint_flags_t _cargo_get_cflag(cargo_t ctx)
 
 static size_t _cargo_get_type_size(cargo_type_t t)
 {
-    assert((t >= CARGO_BOOL) && (t <= CARGO_ULONGLONG));
+    assert((t >= CARGO_BOOL) && (t <= CARGO_EXTENSION));
 
     switch (t)
     {
@@ -983,11 +1562,28 @@ static size_t _cargo_get_type_size(cargo_type_t t)
         case CARGO_STRING: return sizeof(char *);
         case CARGO_LONGLONG: return sizeof(long long int);
         case CARGO_ULONGLONG: return sizeof(unsigned long long int);
+        case CARGO_EXTENSION: break;
     }
 
     return 0;
 }
 
+static size_t _cargo_get_value_size(cargo_opt_t *opt)
+{
+    if (opt->type == CARGO_EXTENSION)
+        return opt->ext.size;
+
+    return _cargo_get_type_size(opt->type);
+}
+
+static const char *_cargo_get_value_type_str(cargo_opt_t *opt)
+{
+    if (opt->type == CARGO_EXTENSION)
+        return opt->ext.name;
+
+    return _cargo_type_to_str(opt->type);
+}
+
 static int _cargo_nargs_is_valid(int nargs)
 {
     return (nargs >= 0)
@@ -1017,32 +1613,358 @@ static char _cargo_is_prefix(cargo_t ctx, char c)
     return 0;
 }
 
-static int _cargo_find_option_name(cargo_t ctx, const char *name,
+static unsigned int _cargo_hash_str(const char *s)
+{
+    // FNV-1a
+    unsigned int h = 2166136261u;
+
+    while (*s)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+static void _cargo_name_index_destroy(cargo_mem_t *m, cargo_name_index_t *idx)
+{
+    assert(idx);
+    _cargo_xfree(m, &idx->entries);
+    idx->count = 0;
+    idx->size = 0;
+}
+
+static void _cargo_name_index_put(cargo_name_index_t *idx,
+                                  const cargo_name_entry_t *e)
+{
+    size_t mask = idx->size - 1;
+    size_t k = e->hash & mask;
+
+    // Linear probing, the table is never more than half full.
+    while (idx->entries[k].used)
+    {
+        k = (k + 1) & mask;
+    }
+
+    idx->entries[k] = *e;
+    idx->count++;
+}
+
+static int _cargo_name_index_grow(cargo_mem_t *m, cargo_name_index_t *idx)
+{
+    size_t i;
+    size_t old_size = idx->size;
+    cargo_name_entry_t *old_entries = idx->entries;
+    cargo_name_entry_t *entries = NULL;
+    size_t size = old_size ? (old_size * 2) : CARGO_NAME_INDEX_MIN_SIZE;
+
+    if (!(entries = _cargo_calloc(m, size, sizeof(cargo_name_entry_t))))
+    {
+        CARGODBG(1, "Out of memory\n");
+        return -1;
+    }
+
+    idx->entries = entries;
+    idx->size = size;
+    idx->count = 0;
+
+    for (i = 0; i < old_size; i++)
+    {
+        if (old_entries[i].used)
+        {
+            _cargo_name_index_put(idx, &old_entries[i]);
+        }
+    }
+
+    _cargo_xfree(m, &old_entries);
+
+    return 0;
+}
+
+static int _cargo_name_index_add(cargo_t ctx, size_t opt_i, size_t name_i)
+{
+    cargo_name_entry_t e;
+    cargo_name_index_t *idx = &ctx->name_index;
+    assert(opt_i < ctx->opt_count);
+    assert(name_i < ctx->options[opt_i].name_count);
+
+    if (((idx->count + 1) * 2) > idx->size)
+    {
+        if (_cargo_name_index_grow(&ctx->mem, idx))
+        {
+            return -1;
+        }
+    }
+
+    e.opt_i = opt_i;
+    e.name_i = name_i;
+    e.hash = _cargo_hash_str(ctx->options[opt_i].name[name_i]);
+    e.used = 1;
+
+    ctx->trie_dirty = 1;
+
+    _cargo_name_index_put(idx, &e);
+
+    return 0;
+}
+
+static int _cargo_name_index_rebuild(cargo_t ctx)
+{
+    size_t i;
+    size_t j;
+    cargo_name_index_t *idx = &ctx->name_index;
+
+    // Used when an option is removed again, since open addressing
+    // doesn't support removing entries without tombstones.
+    if (idx->entries)
+    {
+        memset(idx->entries, 0, idx->size * sizeof(cargo_name_entry_t));
+    }
+
+    idx->count = 0;
+    ctx->trie_dirty = 1;
+
+    for (i = 0; i < ctx->opt_count; i++)
+    {
+        for (j = 0; j < ctx->options[i].name_count; j++)
+        {
+            if (_cargo_name_index_add(ctx, i, j))
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int _cargo_find_option_name(cargo_t ctx, const char *name,
                                     size_t *opt_i, size_t *name_i)
 {
-    size_t i = 0;
-    size_t j = 0;
-    cargo_opt_t *opt = NULL;
+    size_t k;
+    size_t mask;
+    unsigned int hash;
+    cargo_name_entry_t *e = NULL;
+    cargo_name_index_t *idx = &ctx->name_index;
     assert(name);
 
-    for (i = 0; i < ctx->opt_count; i++)
+    if (!idx->entries)
     {
-        opt = &ctx->options[i];
+        return -1;
+    }
+
+    hash = _cargo_hash_str(name);
+    mask = idx->size - 1;
+
+    for (k = hash & mask; idx->entries[k].used; k = (k + 1) & mask)
+    {
+        e = &idx->entries[k];
+
+        if ((e->hash == hash)
+         && !strcmp(ctx->options[e->opt_i].name[e->name_i], name))
+        {
+            if (opt_i) *opt_i = e->opt_i;
+            if (name_i) *name_i = e->name_i;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static size_t _cargo_trie_child(cargo_t ctx, size_t node, char c)
+{
+    size_t k;
+
+    for (k = ctx->trie[node].child; k; k = ctx->trie[k].sibling)
+    {
+        if (ctx->trie[k].c == c)
+        {
+            return k;
+        }
+    }
+
+    return 0;
+}
+
+static int _cargo_trie_insert(cargo_t ctx, size_t opt_i, size_t name_i)
+{
+    size_t node = 0;
+    size_t k;
+    const char *s = ctx->options[opt_i].name[name_i];
+    cargo_trie_node_t *n = NULL;
+
+    for (; *s; s++)
+    {
+        if (!(k = _cargo_trie_child(ctx, node, *s)))
+        {
+            if (ctx->trie_count >= ctx->trie_max)
+            {
+                cargo_trie_node_t *new_trie = NULL;
+                size_t max = ctx->trie_max * 2;
+
+                if (!(new_trie = _cargo_realloc(&ctx->mem, ctx->trie,
+                                    max * sizeof(cargo_trie_node_t))))
+                {
+                    CARGODBG(1, "Out of memory!\n");
+                    return -1;
+                }
+
+                ctx->trie = new_trie;
+                ctx->trie_max = max;
+            }
+
+            k = ctx->trie_count++;
+            n = &ctx->trie[k];
+            memset(n, 0, sizeof(cargo_trie_node_t));
+            n->c = *s;
+            n->opt_i = opt_i;
+            n->name_i = name_i;
+            n->sibling = ctx->trie[node].child;
+            ctx->trie[node].child = k;
+        }
+        else if (ctx->trie[k].opt_i != opt_i)
+        {
+            ctx->trie[k].ambiguous = 1;
+        }
+
+        node = k;
+    }
+
+    n = &ctx->trie[node];
+    n->terminal = 1;
+    n->term_opt_i = opt_i;
+    n->term_name_i = name_i;
+
+    return 0;
+}
+
+static int _cargo_trie_build(cargo_t ctx)
+{
+    size_t i;
+    size_t j;
+    assert(ctx);
+
+    if (!ctx->trie)
+    {
+        ctx->trie_max = CARGO_NAME_INDEX_MIN_SIZE;
+
+        if (!(ctx->trie = _cargo_malloc(&ctx->mem, ctx->trie_max
+                                        * sizeof(cargo_trie_node_t))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            return -1;
+        }
+    }
+
+    // The root node.
+    memset(&ctx->trie[0], 0, sizeof(cargo_trie_node_t));
+    ctx->trie_count = 1;
 
-        for (j = 0; j < opt->name_count; j++)
+    for (i = 0; i < ctx->opt_count; i++)
+    {
+        for (j = 0; j < ctx->options[i].name_count; j++)
         {
-            if (!strcmp(opt->name[j], name))
+            if (_cargo_trie_insert(ctx, i, j))
             {
-                if (opt_i) *opt_i = i;
-                if (name_i) *name_i = j;
-                return 0;
+                return -1;
             }
         }
     }
 
+    ctx->trie_dirty = 0;
+
+    return 0;
+}
+
+static int _cargo_trie_find_short(cargo_t ctx, char prefix, char c,
+                                  size_t *opt_i, size_t *name_i)
+{
+    size_t k;
+
+    // Finds the short option "-c".
+    if ((k = _cargo_trie_child(ctx, 0, prefix))
+     && (k = _cargo_trie_child(ctx, k, c))
+     && ctx->trie[k].terminal)
+    {
+        *opt_i = ctx->trie[k].term_opt_i;
+        *name_i = ctx->trie[k].term_name_i;
+        return 0;
+    }
+
     return -1;
 }
 
+static const char *_cargo_trie_find_bundle(cargo_t ctx, const char *arg,
+                                           size_t *opt_i)
+{
+    size_t i;
+    size_t first_i = 0;
+    size_t name_i = 0;
+    const char *name = NULL;
+    char prefix = arg[0];
+
+    // Bundled short flags, "-abc" is the same as "-a -b -c", and
+    // "-vvv" the same as "-v -v -v".
+    if (!_cargo_is_prefix(ctx, arg[0]) || _cargo_is_prefix(ctx, arg[1])
+        || (strlen(arg) < 3))
+    {
+        return NULL;
+    }
+
+    for (arg++; *arg; arg++)
+    {
+        if (_cargo_trie_find_short(ctx, prefix, *arg, &i, &name_i))
+        {
+            return NULL;
+        }
+
+        if (ctx->options[i].type != CARGO_BOOL)
+        {
+            return NULL;
+        }
+
+        if (!name)
+        {
+            first_i = i;
+            name = ctx->options[i].name[name_i];
+        }
+    }
+
+    *opt_i = first_i;
+
+    return name;
+}
+
+static const char *_cargo_trie_find_abbrev(cargo_t ctx, const char *arg,
+                                           size_t *opt_i)
+{
+    size_t node = 0;
+    cargo_trie_node_t *n = NULL;
+
+    // Abbreviated long option, "--ar" matches "--arne" unless
+    // there's some other option starting with "--ar".
+    for (; *arg; arg++)
+    {
+        if (!(node = _cargo_trie_child(ctx, node, *arg)))
+        {
+            return NULL;
+        }
+    }
+
+    n = &ctx->trie[node];
+
+    if (n->ambiguous)
+    {
+        return NULL;
+    }
+
+    *opt_i = n->opt_i;
+
+    return ctx->options[n->opt_i].name[n->name_i];
+}
+
 static int _cargo_validate_option_args(cargo_t ctx, cargo_opt_t *o)
 {
     assert(ctx);
@@ -1073,7 +1995,7 @@ static int _cargo_validate_option_args(cargo_t ctx, cargo_opt_t *o)
     return 0;
 }
 
-static int _cargo_grow_options(cargo_opt_t **options,
+static int _cargo_grow_options(cargo_mem_t *m, cargo_opt_t **options,
                                 size_t *opt_count, size_t *max_opts)
 {
     assert(options);
@@ -1083,7 +2005,7 @@ static int _cargo_grow_options(cargo_opt_t **options,
 
     if (!*options)
     {
-        if (!((*options) = _cargo_calloc(*max_opts, sizeof(cargo_opt_t))))
+        if (!((*options) = _cargo_calloc(m, *max_opts, sizeof(cargo_opt_t))))
         {
             CARGODBG(1, "Out of memory\n");
             return -1;
@@ -1092,13 +2014,14 @@ static int _cargo_grow_options(cargo_opt_t **options,
 
     if (*opt_count >= *max_opts)
     {
+        size_t i;
         cargo_opt_t *new_options = NULL;
         CARGODBG(2, "Option count (%lu) >= Max option count (%lu)\n",
             *opt_count, *max_opts);
 
         (*max_opts) *= 2;
 
-        if (!(new_options = _cargo_realloc(*options,
+        if (!(new_options = _cargo_realloc(m, *options,
                                     (*max_opts) * sizeof(cargo_opt_t))))
         {
             CARGODBG(1, "Out of memory!\n");
@@ -1106,112 +2029,73 @@ static int _cargo_grow_options(cargo_opt_t **options,
         }
 
         *options = new_options;
-    }
-
-    return 0;
-}
-
-static int _cargo_get_positional(cargo_t ctx, size_t *opt_i)
-{
-    size_t i;
-    cargo_opt_t *opt = NULL;
-    assert(ctx);
-
-    *opt_i = 0;
-
-    for (i = 0; i < ctx->opt_count; i++)
-    {
-        opt = &ctx->options[i];
 
-        if (opt->positional && (opt->num_eaten != opt->nargs))
+        // Internal targets point into the options themselves.
+        for (i = 0; i < *opt_count; i++)
         {
-            *opt_i = i;
-            return 0;
+            if (new_options[i].internal_target)
+            {
+                new_options[i].target = (void **)&new_options[i].custom_target;
+                new_options[i].target_count = &new_options[i].custom_target_count;
+            }
         }
     }
 
-    return -1;
+    return 0;
 }
 
-static const char *_cargo_is_option_name(cargo_t ctx,
-                    cargo_opt_t *opt, const char *arg)
+static int _cargo_add_positional(cargo_t ctx, size_t opt_i)
 {
-    size_t i;
-    const char *name;
-
-    if (!_cargo_starts_with_prefix(ctx, arg))
-        return NULL;
+    assert(ctx);
 
-    for (i = 0; i < opt->name_count; i++)
+    if (ctx->positional_count >= ctx->max_positionals)
     {
-        name = opt->name[i];
+        size_t *new_positionals = NULL;
+        size_t max = ctx->max_positionals
+                   ? (ctx->max_positionals * 2) : CARGO_DEFAULT_MAX_OPTS;
 
-        if (!strcmp(name, arg))
+        if (!(new_positionals = _cargo_realloc(&ctx->mem, ctx->positionals,
+                                        max * sizeof(size_t))))
         {
-            CARGODBG(3, "  Found matching option \"%s\", alias \"%s\"\n",
-                    opt->name[0], opt->name[i]);
-            return name;
+            CARGODBG(1, "Out of memory!\n");
+            return -1;
         }
+
+        ctx->positionals = new_positionals;
+        ctx->max_positionals = max;
     }
 
-    return NULL;
+    ctx->positionals[ctx->positional_count++] = opt_i;
+
+    return 0;
 }
 
-static const char *_cargo_is_option_name_compact(cargo_t ctx,
-                    cargo_opt_t *opt, const char *arg)
+static int _cargo_get_positional(cargo_t ctx, size_t *opt_i)
 {
-    size_t i;
-    size_t j;
-    int found = 0;
-    const char *name;
-
-    // This looks for the format -vvv when we have
-    // an option "--verbosity -v" of type CARGO_BOOL
-    // that has 'b!' format specifier set.
-    // Which means to count each flag occurance.
-    // Then "-v -v -v" and "-vvv" is equivalent and should
-    // parse the bool as 3.
-
-    if (!_cargo_starts_with_prefix(ctx, arg))
-        return NULL;
+    cargo_opt_t *opt = NULL;
+    assert(ctx);
 
-    arg += strspn(arg, ctx->prefix);
+    *opt_i = 0;
 
-    for (i = 0; i < opt->name_count; i++)
+    // A positional that has been filled is never parsed again
+    // during the same parse, so we never have to look back.
+    while (ctx->positional_cursor < ctx->positional_count)
     {
-        name = opt->name[i];
-
-        if (!_cargo_starts_with_prefix(ctx, name))
-            continue;
-
-        // "-vvv" -> "vvv"
-        name += strspn(name, ctx->prefix);
-        found = 0;
+        opt = &ctx->options[ctx->positionals[ctx->positional_cursor]];
 
-        // Compare only the beginning of the arg we're given.
-        // So if the opt has an alias "-v", we remove the "-"
-        // and compare "v" with strlen("v") characters in the
-        // input string: strncmp("v", "vvv", 1) == 0
-        for (j = 0; j < strlen(arg); j++)
+        if (opt->num_eaten != opt->nargs)
         {
-            found = (*name == arg[j]);
+            *opt_i = ctx->positionals[ctx->positional_cursor];
+            return 0;
         }
 
-        if (found)
-        {
-            if (opt->bool_count || opt->bool_acc)
-            {
-                CARGODBG(3, "  Found matching option \"%s\", alias \"%s\"\n",
-                        opt->name[0], opt->name[i]);
-                return name;
-            }
-        }
+        ctx->positional_cursor++;
     }
 
-    return NULL;
+    return -1;
 }
 
-static void _cargo_free_str_list(char ***s, size_t *count)
+static void _cargo_free_str_list(cargo_mem_t *m, char ***s, size_t *count)
 {
     size_t i;
 
@@ -1223,12 +2107,12 @@ static void _cargo_free_str_list(char ***s, size_t *count)
     {
         for (i = 0; i < *count; i++)
         {
-            _cargo_free((*s)[i]);
+            _cargo_free(m, (*s)[i]);
             (*s)[i] = NULL;
         }
     }
 
-    _cargo_free(*s);
+    _cargo_free(m, *s);
     *s = NULL;
 done:
     if (count)
@@ -1244,6 +2128,7 @@ static void _cargo_cleanup_option_value(cargo_t ctx,
     opt->target_idx = 0;
     opt->parsed = -1;    // index into argv that we parsed this option at.
     opt->num_eaten = 0;
+    opt->bit_loaded = 0;
 
     CARGODBG(3, "Cleanup option (%s) value: %s\n",
             _cargo_type_to_str(opt->type), opt->name[0]);
@@ -1262,7 +2147,8 @@ static void _cargo_cleanup_option_value(cargo_t ctx,
     if (opt->first_parse)
     {
         if ((ctx->flags & CARGO_DEFAULT_LITERALS)
-         || (opt->flags & CARGO_OPT_DEFAULT_LITERAL))
+         || (opt->flags & CARGO_OPT_DEFAULT_LITERAL)
+         || opt->str_borrow)
         {
             // Don't free a default value set like this:
             // char *s = "abc";
@@ -1288,7 +2174,8 @@ static void _cargo_cleanup_option_value(cargo_t ctx,
 
     if (opt->custom)
     {
-        _cargo_free_str_list(&opt->custom_target, &opt->custom_target_count);
+        _cargo_free_str_list(&ctx->mem, &opt->custom_target,
+                             &opt->custom_target_count);
         return;
     }
     else if (opt->alloc)
@@ -1301,14 +2188,14 @@ static void _cargo_cleanup_option_value(cargo_t ctx,
             {
                 CARGODBG(4, "    Array\n");
 
-                if (opt->type == CARGO_STRING)
+                if ((opt->type == CARGO_STRING) && !opt->str_borrowed)
                 {
-                    _cargo_free_str_list(((char ***)opt->target),
+                    _cargo_free_str_list(&ctx->mem, ((char ***)opt->target),
                         opt->target_count);
                 }
                 else
                 {
-                    _cargo_free(*opt->target);
+                    _cargo_free(&ctx->mem, *opt->target);
                     *opt->target = NULL;
                 }
             }
@@ -1319,7 +2206,8 @@ static void _cargo_cleanup_option_value(cargo_t ctx,
                 if (opt->type == CARGO_STRING)
                 {
                     CARGODBG(4, "    String\n");
-                    _cargo_free(*opt->target);
+                    if (!opt->str_borrowed)
+                        _cargo_free(&ctx->mem, *opt->target);
                     *opt->target = NULL;
                 }
             }
@@ -1334,7 +2222,7 @@ static void _cargo_cleanup_option_value(cargo_t ctx,
         if (opt->target && opt->target_count)
         {
             memset(opt->target, 0,
-                _cargo_get_type_size(opt->type) * (*opt->target_count));
+                _cargo_get_value_size(opt) * (*opt->target_count));
         }
     }
 
@@ -1344,6 +2232,9 @@ skip_free:
 
     if (opt->alloc && opt->target)
         *opt->target = NULL;
+
+    opt->target_alloc_count = 0;
+    opt->str_borrowed = 0;
 }
 
 static void _cargo_cleanup_option_values(cargo_t ctx, int free_targets)
@@ -1366,9 +2257,11 @@ static void _cargo_free_validation(cargo_validation_t **vd)
 
     v = *vd;
 
-    v->ref_count--;
+    // A validation that was never added has no references.
+    if (v->ref_count > 0)
+        v->ref_count--;
 
-    if (v->ref_count <= 0)
+    if (v->ref_count == 0)
     {
         if (v->destroy)
         {
@@ -1376,8 +2269,8 @@ static void _cargo_free_validation(cargo_validation_t **vd)
             v->destroy(v->user);
         }
 
-        _cargo_xfree(&v->user);
-        _cargo_xfree(vd);
+        _cargo_xfree(NULL, &v->user);
+        _cargo_xfree(NULL, vd);
     }
 }
 
@@ -1392,6 +2285,8 @@ void _cargo_option_destroy_validation(cargo_opt_t *o)
 
         _cargo_free_validation(&o->validation);
     }
+
+    o->range = NULL;
 }
 
 int _cargo_validate_option_value(cargo_t ctx, cargo_opt_t *o, void *value)
@@ -1446,2636 +2341,3620 @@ int _cargo_validate_options(cargo_t ctx)
     return 0;
 }
 
-static char *_cargo_highlight_current_target_value(cargo_t ctx)
+static char *_cargo_get_fprintl_args(cargo_arena_t *arena,
+                            int argc, char **argv, int start,
+                            cargo_fprint_flags_t flags,
+                            size_t max_width,
+                            size_t highlight_count,
+                            const cargo_highlight_t *highlights_in);
+
+static char *_cargo_highlight_args(cargo_t ctx, size_t highlight_count,
+                                   const cargo_highlight_t *highlights)
 {
-    return cargo_get_fprint_args(ctx->argc, ctx->argv, ctx->start,
+    // The highlighted args are only used for error messages,
+    // so they can live in the scratch arena.
+    if (ctx->streaming)
+    {
+        // Most of the arguments are gone by the time an error is found.
+        return _cargo_arena_calloc(&ctx->arena, 1, 1);
+    }
+
+    return _cargo_get_fprintl_args(&ctx->arena,
+                        ctx->argc, ctx->argv, ctx->start,
                         _cargo_get_cflag(ctx), ctx->max_width,
-                        2,
+                        highlight_count, highlights);
+}
+
+static char *_cargo_highlight_two_args(cargo_t ctx, int i1, char *c1,
+                                       int i2, char *c2)
+{
+    cargo_highlight_t highlights[2];
+    highlights[0].i = i1;
+    highlights[0].c = c1;
+    highlights[1].i = i2;
+    highlights[1].c = c2;
+
+    return _cargo_highlight_args(ctx, 2, highlights);
+}
+
+static char *_cargo_highlight_current_target_value(cargo_t ctx)
+{
+    return _cargo_highlight_two_args(ctx,
                         ctx->i - 1, "^"CARGO_COLOR_YELLOW,
                         ctx->j, "~"CARGO_COLOR_RED);
 }
 
-static int _cargo_set_target_value(cargo_t ctx, cargo_opt_t *opt,
-                                    const char *name, char *val)
+// Puts together the error message from the last record if it hasn't
+// been already, so a warning that is never shown is never formatted.
+static const char *_cargo_render_error(cargo_t ctx)
 {
-    void *target;
-    char *end = NULL;
-    assert(ctx);
-    assert((opt->type >= CARGO_BOOL) && (opt->type <= CARGO_ULONGLONG));
+    cargo_astr_t str;
+    char *error = NULL;
+    char *s = NULL;
+    cargo_error_record_t *r = NULL;
 
-    if ((opt->type != CARGO_BOOL)
-        && (opt->target_idx >= opt->max_target_count))
+    if (!ctx->error_pending)
     {
-        CARGODBG(1, "Target index out of bounds (%lu > max %lu)\n",
-                opt->target_idx, opt->max_target_count);
-        return 1;
+        return ctx->error;
     }
 
-    CARGODBG(2, "_cargo_set_target_value:\n");
-    CARGODBG(2, "  alloc: %d\n", opt->alloc);
-    CARGODBG(2, "  nargs: %d\n", opt->nargs);
+    ctx->error_pending = 0;
+    r = &ctx->records[ctx->record_count - 1];
+    memset(&str, 0, sizeof(cargo_astr_t));
+    str.s = &error;
+    str.arena = &ctx->arena;
 
-    // If number of arguments is just 1 don't allocate an array
-    // (Except for custom callback, then we always use an array
-    //  since we store the arguments internally).
-    if (opt->custom || (opt->alloc && (opt->nargs != 1)))
+    switch (r->code)
     {
-        // Allocate the memory needed.
-        if (!*(opt->target))
+        case CARGO_ERROR_NOT_UNIQUE:
+        {
+            s = (r->argi < 0) ? "" : _cargo_highlight_two_args(ctx,
+                            r->prev_argi, "^"CARGO_COLOR_GREEN,
+                            r->argi, "~"CARGO_COLOR_RED);
+            cargo_aappendf(&str,
+                "%s\n Error: %s was already specified before.\n", s, r->name);
+            break;
+        }
+        case CARGO_ERROR_ALREADY_PARSED:
         {
-            // TODO: Break out into function.
-            void **new_target;
-            int alloc_count = opt->nargs;
+            cargo_aappendf(&str, " Warning: %s was already specified before, "
+                            "the latter value will be used.\n", r->name);
+            break;
+        }
+        case CARGO_ERROR_MESSAGE:
+        case CARGO_ERROR_VALUE:
+            break;
+    }
 
-            if (opt->nargs < 0)
-            {
-                // In this case we don't want to preallocate everything
-                // since we might have "unlimited" arguments.
-                // CARGO_NARGS_ONE_OR_MORE
-                // CARGO_NARGS_ZERO_OR_MORE
-                // TODO: Don't allocate all of these right away.
-                alloc_count = ctx->argc - ctx->i;
-                assert(alloc_count >= 0);
-
-                // Don't allocate more than necessary.
-                if (opt->max_target_count < (size_t)alloc_count)
-                    alloc_count = opt->max_target_count;
-            }
+    ctx->error = error;
+    return ctx->error;
+}
 
-            if (!(new_target = (void **)_cargo_calloc(alloc_count,
-                        _cargo_get_type_size(opt->type))))
-            {
-                CARGODBG(1, "Out of memory!\n");
-                return -1;
-            }
+//
+// Integer parsing that doesn't depend on the locale, and fails on
+// overflow instead of saturating or truncating like the strtox functions.
+// Each returns a pointer past the parsed digits, or the input itself
+// if there is nothing to parse or the value doesn't fit.
+//
+#define CARGO_SWAR_ONES 0x0101010101010101ULL
 
-            CARGODBG(3, "Allocated %dx %s!\n",
-                    alloc_count, _cargo_type_to_str(opt->type));
+static int _cargo_little_endian(void)
+{
+    const unsigned int one = 1;
+    return *((const unsigned char *)&one);
+}
 
-            *(opt->target) = new_target;
-        }
+// Checks if all 8 bytes in v are ASCII digits.
+static int _cargo_swar_is_8_digits(unsigned long long v)
+{
+    return (((v & (0xF0 * CARGO_SWAR_ONES))
+          | (((v + (0x06 * CARGO_SWAR_ONES)) & (0xF0 * CARGO_SWAR_ONES)) >> 4))
+          == (0x33 * CARGO_SWAR_ONES));
+}
 
-        target = *(opt->target);
-    }
-    else if (opt->str_alloc_items)
-    {
-        CARGODBG(3, "Static list size %lu of allocated strings\n",
-                    opt->max_target_count);
+// Converts 8 ASCII digits loaded little endian into their value.
+static unsigned long long _cargo_swar_parse_8_digits(unsigned long long v)
+{
+    const unsigned long long mask = 0x000000FF000000FFULL;
+    const unsigned long long mul1 = 100 + (1000000ULL << 32);
+    const unsigned long long mul2 = 1 + (10000ULL << 32);
 
-        target = (void *)opt->target;
-    }
-    else
+    v -= (0x30 * CARGO_SWAR_ONES);
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+
+    return v & 0xFFFFFFFFULL;
+}
+
+static const char *_cargo_parse_digits(const char *s,
+                                       unsigned long long max,
+                                       unsigned long long *out)
+{
+    const char *p = s;
+    unsigned long long acc = 0;
+    unsigned long long v;
+    unsigned int d;
+
+    // Long digit runs are done 8 at a time. Only where the string is
+    // known to have 8 more bytes, so we never read past its end.
+    // (Not using strlen, the digits can be the start of a long
+    //  delimited list).
+    if (_cargo_little_endian())
     {
-        // Just a normal pointer.
-        CARGODBG(3, "Not allocating array or single %s\n",
-                _cargo_type_to_str(opt->type));
+        while (!memchr(p, '\0', sizeof(v)))
+        {
+            memcpy(&v, p, sizeof(v));
 
-        target = (void *)opt->target;
+            if (!_cargo_swar_is_8_digits(v))
+                break;
+
+            v = _cargo_swar_parse_8_digits(v);
+
+            if (acc > ((max - v) / 100000000ULL))
+                return s;
+
+            acc = (acc * 100000000ULL) + v;
+            p += 8;
+        }
     }
 
-    switch (opt->type)
+    while ((d = (unsigned int)(*p - '0')) <= 9)
     {
-        case CARGO_BOOL:
-        {
-            int *val = &((int *)target)[opt->target_idx];
-            CARGODBG(2, "      bool\n");
+        if (acc > ((max - d) / 10))
+            return s;
 
-            // TODO: This could be more general to support
-            //       short command lines bundled together:
-            //       "-vaet" same as "-v -a -e -t"...
+        acc = (acc * 10) + d;
+        p++;
+    }
 
-            // If BOOL COUNT is turned on, we allow multiple occurances of
-            // a bool option. "-v -v -v" will be parsed as 3.
-            if (opt->bool_count)
-            {
-                char *arg = ctx->argv[ctx->i];
-                CARGODBG(2, "        bool count enabled\n");
+    *out = acc;
+    return p;
+}
 
-                // We can specify it as "-vvv" as well.
-                if (!_cargo_is_option_name(ctx, opt, arg)
-                  && _cargo_is_option_name_compact(ctx, opt, arg))
-                {
-                    int amount;
-                    CARGODBG(2, "          Compact %s\n", arg);
-                    arg += strspn(arg, ctx->prefix);
-                    amount = (int)strlen(arg);
-                    CARGODBG(2, "              %d\n", amount);
-                    (*val) += amount;
-                }
-                else
-                {
-                    CARGODBG(2, "          Normal\n");
-                    (*val)++;
-                }
-            }
-            else if (opt->bool_acc)
-            {
-                // TODO: Maybe move all this complexity from
-                // handling -vvv as a special case here, to instead expanding it
-                // at the beginning of the parse... "-vvv" -> "-v", "-v", "-v"
-                size_t count;
-                int acc_val;
-                size_t i = 0;
-                char *arg = ctx->argv[ctx->i];
-                CARGODBG(2, "           ARG: %s\n", arg);
+static const char *_cargo_skip_space(const char *s)
+{
+    while ((*s == ' ') || ((*s >= '\t') && (*s <= '\r')))
+        s++;
+    return s;
+}
 
-                // "-vvv" support.
-                if (!_cargo_is_option_name(ctx, opt, arg)
-                  && _cargo_is_option_name_compact(ctx, opt, arg))
-                {
-                    CARGODBG(2, "          Compact %s\n", arg);
-                    arg += strspn(arg, ctx->prefix);
-                    count = strlen(arg);
-                    CARGODBG(2, "              %lu\n", count);
-                }
-                else
-                {
-                    count = 1;
-                }
+static const char *_cargo_parse_ulonglong(const char *s,
+                                          unsigned long long max,
+                                          unsigned long long *out)
+{
+    const char *p = _cargo_skip_space(s);
+    const char *end = NULL;
 
-                for (i = opt->bool_acc_count;
-                    (i < opt->bool_acc_count + count)
-                    && (i < opt->bool_acc_max_count);
-                    i++)
-                {
-                    acc_val = opt->bool_acc[i];
+    if (*p == '+')
+        p++;
 
-                    CARGODBG(2, "       %lu Bool acc %x\n", i, acc_val);
-                    switch (opt->bool_acc_op)
-                    {
-                        case CARGO_BOOL_OP_OR:
-                        {
-                            CARGODBG(2, "       OR\n");
-                            *val |= acc_val;
-                            break;
-                        }
-                        case CARGO_BOOL_OP_AND:
-                        {
-                            CARGODBG(2, "       AND\n");
-                            *val &= acc_val;
-                            break;
-                        }
-                        case CARGO_BOOL_OP_PLUS:
-                        {
-                            CARGODBG(2, "       PLUS\n");
-                            *val += acc_val;
-                            break;
-                        }
-                        case CARGO_BOOL_OP_STORE:
-                        {
-                            CARGODBG(2, "       STORE\n");
-                            *val = acc_val;
-                            break;
-                        }
-                        default:
-                        {
-                            CARGODBG(1, "Got unknown operation\n");
-                            break;
-                        }
-                    }
-                }
+    if ((end = _cargo_parse_digits(p, max, out)) == p)
+        return s;
 
-                opt->bool_acc_count = i;
+    return end;
+}
 
-                if (opt->bool_acc_count >= opt->bool_acc_max_count)
-                {
-                    CARGODBG(2, "       Bool acc reached maxcount %lu\n",
-                            opt->bool_acc_max_count);
-                    break;
-                }
-            }
-            else
-            {
-                CARGODBG(2, "       No bool count\n");
-                *val = opt->bool_store;
-            }
-            break;
-        }
-        case CARGO_INT:
-        {
-            CARGODBG(2, "      int %s\n", val);
-            ((int *)target)[opt->target_idx] = strtol(val, &end, 10);
-            break;
-        }
-        case CARGO_UINT:
-        {
-            CARGODBG(2, "      uint %s\n", val);
-            ((unsigned int *)target)[opt->target_idx] = strtoul(val, &end, 10);
-            break;
-        }
-        case CARGO_LONGLONG:
-        {
-            CARGODBG(2, "      long long %s\n", val);
-            ((long long int *)target)[opt->target_idx] = strtoll(val, &end, 10);
-            break;
-        }
-        case CARGO_ULONGLONG:
-        {
-            CARGODBG(2, "      unsigned long long %s\n", val);
-            ((unsigned long long int *)target)[opt->target_idx] = strtoull(val, &end, 10);
-            break;
-        }
-        case CARGO_FLOAT:
-        {
-            CARGODBG(2, "      float %s\n", val);
-            ((float *)target)[opt->target_idx] = (float)strtof(val, &end);
-            break;
-        }
-        case CARGO_DOUBLE:
-        {
-            CARGODBG(2, "      double %s\n", val);
-            ((double *)target)[opt->target_idx] = (double)strtod(val, &end);
-            break;
-        }
-        case CARGO_STRING:
-            CARGODBG(2, "      string \"%s\"\n", val);
-            if (opt->alloc)
-            {
-                CARGODBG(2, "       ALLOCATED STRING\n");
-                if (opt->lenstr == 0)
-                {
-                    //char **t = (char **)((char *)target + opt->target_idx * sizeof(char *));
-                    CARGODBG(2, "          COPY FULL STRING\n");
+static const char *_cargo_parse_longlong(const char *s,
+                                         long long min, long long max,
+                                         long long *out)
+{
+    const char *p = _cargo_skip_space(s);
+    const char *end = NULL;
+    unsigned long long u = 0;
+    int neg = 0;
 
-                    if (!(((char **)target)[opt->target_idx]
-                            = _cargo_strdup(val)))
-                    {
-                        return -1;
-                    }
-                }
-                else
-                {
-                    CARGODBG(2, "          MAX LENGTH: %lu\n", opt->lenstr);
-                    if (!(((char **)target)[opt->target_idx]
-                            = cargo_strndup(val, opt->lenstr)))
-                    {
-                        return -1;
-                    }
-                }
-            }
-            else if (opt->str_alloc_items)
-            {
-                // Special case for static lists of allocated strings:
-                //  char *strs[5];
-                CARGODBG(2, "          COPY FULL STRING INTO STATIC LIST\n");
-                if (!(((char **)target)[opt->target_idx] = _cargo_strdup(val)))
-                {
-                    return -1;
-                }
-            }
-            else // static string.
-            {
-                char *t = (char *)((char *)target + opt->target_idx * opt->lenstr);
-                CARGODBG(2, "       STATIC STRING, bufsize = %lu\n", opt->lenstr);
-                strncpy(t, val, opt->lenstr);
-                CARGODBG(2, "       \"%s\"\n", t);
-            }
-            break;
+    if ((*p == '-') || (*p == '+'))
+    {
+        neg = (*p == '-');
+        p++;
     }
 
-    // Error checks.
+    // The magnitude of min is one more than max, so it doesn't fit
+    // in a long long by itself.
+    if ((end = _cargo_parse_digits(p,
+            neg ? ((unsigned long long)(-(min + 1)) + 1)
+                : (unsigned long long)max, &u)) == p)
     {
-        cargo_astr_t str;
-        char *error = NULL;
-        char *highlight = NULL;
-        memset(&str, 0, sizeof(cargo_astr_t));
-        str.s = &error;
+        return s;
+    }
 
-        // This indicates error for the strtox functions.
-        // (Don't include bool here, since val will be NULL in that case).
-        if ((opt->type != CARGO_BOOL) && (end == val))
-        {
-            CARGODBG(1, "Cannot parse \"%s\" as %s\n",
-                    val, _cargo_type_to_str(opt->type));
+    *out = neg ? (-(long long)(u - 1) - 1) : (long long)u;
+    return end;
+}
 
-            highlight = _cargo_highlight_current_target_value(ctx);
+//
+// Float parsing that doesn't depend on the locale, and is correctly
+// rounded. The decimal is converted using the Eisel-Lemire algorithm
+// (Daniel Lemire, "Number Parsing at a Gigabyte per Second"), and the
+// rare values it cannot decide on are left to strtod.
+//
+#define CARGO_POW5_MIN_EXP (-342)
+#define CARGO_POW5_MAX_EXP 308
+
+// The 128 most significant bits of 5^q for each q in
+// [CARGO_POW5_MIN_EXP, CARGO_POW5_MAX_EXP], as high and low halves.
+static const unsigned long long _cargo_pow5_128[] =
+{
+    0xEEF453D6923BD65AULL, 0x113FAA2906A13B3FULL,
+    0x9558B4661B6565F8ULL, 0x4AC7CA59A424C507ULL,
+    0xBAAEE17FA23EBF76ULL, 0x5D79BCF00D2DF649ULL,
+    0xE95A99DF8ACE6F53ULL, 0xF4D82C2C107973DCULL,
+    0x91D8A02BB6C10594ULL, 0x79071B9B8A4BE869ULL,
+    0xB64EC836A47146F9ULL, 0x9748E2826CDEE284ULL,
+    0xE3E27A444D8D98B7ULL, 0xFD1B1B2308169B25ULL,
+    0x8E6D8C6AB0787F72ULL, 0xFE30F0F5E50E20F7ULL,
+    0xB208EF855C969F4FULL, 0xBDBD2D335E51A935ULL,
+    0xDE8B2B66B3BC4723ULL, 0xAD2C788035E61382ULL,
+    0x8B16FB203055AC76ULL, 0x4C3BCB5021AFCC31ULL,
+    0xADDCB9E83C6B1793ULL, 0xDF4ABE242A1BBF3DULL,
+    0xD953E8624B85DD78ULL, 0xD71D6DAD34A2AF0DULL,
+    0x87D4713D6F33AA6BULL, 0x8672648C40E5AD68ULL,
+    0xA9C98D8CCB009506ULL, 0x680EFDAF511F18C2ULL,
+    0xD43BF0EFFDC0BA48ULL, 0x0212BD1B2566DEF2ULL,
+    0x84A57695FE98746DULL, 0x014BB630F7604B57ULL,
+    0xA5CED43B7E3E9188ULL, 0x419EA3BD35385E2DULL,
+    0xCF42894A5DCE35EAULL, 0x52064CAC828675B9ULL,
+    0x818995CE7AA0E1B2ULL, 0x7343EFEBD1940993ULL,
+    0xA1EBFB4219491A1FULL, 0x1014EBE6C5F90BF8ULL,
+    0xCA66FA129F9B60A6ULL, 0xD41A26E077774EF6ULL,
+    0xFD00B897478238D0ULL, 0x8920B098955522B4ULL,
+    0x9E20735E8CB16382ULL, 0x55B46E5F5D5535B0ULL,
+    0xC5A890362FDDBC62ULL, 0xEB2189F734AA831DULL,
+    0xF712B443BBD52B7BULL, 0xA5E9EC7501D523E4ULL,
+    0x9A6BB0AA55653B2DULL, 0x47B233C92125366EULL,
+    0xC1069CD4EABE89F8ULL, 0x999EC0BB696E840AULL,
+    0xF148440A256E2C76ULL, 0xC00670EA43CA250DULL,
+    0x96CD2A865764DBCAULL, 0x380406926A5E5728ULL,
+    0xBC807527ED3E12BCULL, 0xC605083704F5ECF2ULL,
+    0xEBA09271E88D976BULL, 0xF7864A44C633682EULL,
+    0x93445B8731587EA3ULL, 0x7AB3EE6AFBE0211DULL,
+    0xB8157268FDAE9E4CULL, 0x5960EA05BAD82964ULL,
+    0xE61ACF033D1A45DFULL, 0x6FB92487298E33BDULL,
+    0x8FD0C16206306BABULL, 0xA5D3B6D479F8E056ULL,
+    0xB3C4F1BA87BC8696ULL, 0x8F48A4899877186CULL,
+    0xE0B62E2929ABA83CULL, 0x331ACDABFE94DE87ULL,
+    0x8C71DCD9BA0B4925ULL, 0x9FF0C08B7F1D0B14ULL,
+    0xAF8E5410288E1B6FULL, 0x07ECF0AE5EE44DD9ULL,
+    0xDB71E91432B1A24AULL, 0xC9E82CD9F69D6150ULL,
+    0x892731AC9FAF056EULL, 0xBE311C083A225CD2ULL,
+    0xAB70FE17C79AC6CAULL, 0x6DBD630A48AAF406ULL,
+    0xD64D3D9DB981787DULL, 0x092CBBCCDAD5B108ULL,
+    0x85F0468293F0EB4EULL, 0x25BBF56008C58EA5ULL,
+    0xA76C582338ED2621ULL, 0xAF2AF2B80AF6F24EULL,
+    0xD1476E2C07286FAAULL, 0x1AF5AF660DB4AEE1ULL,
+    0x82CCA4DB847945CAULL, 0x50D98D9FC890ED4DULL,
+    0xA37FCE126597973CULL, 0xE50FF107BAB528A0ULL,
+    0xCC5FC196FEFD7D0CULL, 0x1E53ED49A96272C8ULL,
+    0xFF77B1FCBEBCDC4FULL, 0x25E8E89C13BB0F7AULL,
+    0x9FAACF3DF73609B1ULL, 0x77B191618C54E9ACULL,
+    0xC795830D75038C1DULL, 0xD59DF5B9EF6A2417ULL,
+    0xF97AE3D0D2446F25ULL, 0x4B0573286B44AD1DULL,
+    0x9BECCE62836AC577ULL, 0x4EE367F9430AEC32ULL,
+    0xC2E801FB244576D5ULL, 0x229C41F793CDA73FULL,
+    0xF3A20279ED56D48AULL, 0x6B43527578C1110FULL,
+    0x9845418C345644D6ULL, 0x830A13896B78AAA9ULL,
+    0xBE5691EF416BD60CULL, 0x23CC986BC656D553ULL,
+    0xEDEC366B11C6CB8FULL, 0x2CBFBE86B7EC8AA8ULL,
+    0x94B3A202EB1C3F39ULL, 0x7BF7D71432F3D6A9ULL,
+    0xB9E08A83A5E34F07ULL, 0xDAF5CCD93FB0CC53ULL,
+    0xE858AD248F5C22C9ULL, 0xD1B3400F8F9CFF68ULL,
+    0x91376C36D99995BEULL, 0x23100809B9C21FA1ULL,
+    0xB58547448FFFFB2DULL, 0xABD40A0C2832A78AULL,
+    0xE2E69915B3FFF9F9ULL, 0x16C90C8F323F516CULL,
+    0x8DD01FAD907FFC3BULL, 0xAE3DA7D97F6792E3ULL,
+    0xB1442798F49FFB4AULL, 0x99CD11CFDF41779CULL,
+    0xDD95317F31C7FA1DULL, 0x40405643D711D583ULL,
+    0x8A7D3EEF7F1CFC52ULL, 0x482835EA666B2572ULL,
+    0xAD1C8EAB5EE43B66ULL, 0xDA3243650005EECFULL,
+    0xD863B256369D4A40ULL, 0x90BED43E40076A82ULL,
+    0x873E4F75E2224E68ULL, 0x5A7744A6E804A291ULL,
+    0xA90DE3535AAAE202ULL, 0x711515D0A205CB36ULL,
+    0xD3515C2831559A83ULL, 0x0D5A5B44CA873E03ULL,
+    0x8412D9991ED58091ULL, 0xE858790AFE9486C2ULL,
+    0xA5178FFF668AE0B6ULL, 0x626E974DBE39A872ULL,
+    0xCE5D73FF402D98E3ULL, 0xFB0A3D212DC8128FULL,
+    0x80FA687F881C7F8EULL, 0x7CE66634BC9D0B99ULL,
+    0xA139029F6A239F72ULL, 0x1C1FFFC1EBC44E80ULL,
+    0xC987434744AC874EULL, 0xA327FFB266B56220ULL,
+    0xFBE9141915D7A922ULL, 0x4BF1FF9F0062BAA8ULL,
+    0x9D71AC8FADA6C9B5ULL, 0x6F773FC3603DB4A9ULL,
+    0xC4CE17B399107C22ULL, 0xCB550FB4384D21D3ULL,
+    0xF6019DA07F549B2BULL, 0x7E2A53A146606A48ULL,
+    0x99C102844F94E0FBULL, 0x2EDA7444CBFC426DULL,
+    0xC0314325637A1939ULL, 0xFA911155FEFB5308ULL,
+    0xF03D93EEBC589F88ULL, 0x793555AB7EBA27CAULL,
+    0x96267C7535B763B5ULL, 0x4BC1558B2F3458DEULL,
+    0xBBB01B9283253CA2ULL, 0x9EB1AAEDFB016F16ULL,
+    0xEA9C227723EE8BCBULL, 0x465E15A979C1CADCULL,
+    0x92A1958A7675175FULL, 0x0BFACD89EC191EC9ULL,
+    0xB749FAED14125D36ULL, 0xCEF980EC671F667BULL,
+    0xE51C79A85916F484ULL, 0x82B7E12780E7401AULL,
+    0x8F31CC0937AE58D2ULL, 0xD1B2ECB8B0908810ULL,
+    0xB2FE3F0B8599EF07ULL, 0x861FA7E6DCB4AA15ULL,
+    0xDFBDCECE67006AC9ULL, 0x67A791E093E1D49AULL,
+    0x8BD6A141006042BDULL, 0xE0C8BB2C5C6D24E0ULL,
+    0xAECC49914078536DULL, 0x58FAE9F773886E18ULL,
+    0xDA7F5BF590966848ULL, 0xAF39A475506A899EULL,
+    0x888F99797A5E012DULL, 0x6D8406C952429603ULL,
+    0xAAB37FD7D8F58178ULL, 0xC8E5087BA6D33B83ULL,
+    0xD5605FCDCF32E1D6ULL, 0xFB1E4A9A90880A64ULL,
+    0x855C3BE0A17FCD26ULL, 0x5CF2EEA09A55067FULL,
+    0xA6B34AD8C9DFC06FULL, 0xF42FAA48C0EA481EULL,
+    0xD0601D8EFC57B08BULL, 0xF13B94DAF124DA26ULL,
+    0x823C12795DB6CE57ULL, 0x76C53D08D6B70858ULL,
+    0xA2CB1717B52481EDULL, 0x54768C4B0C64CA6EULL,
+    0xCB7DDCDDA26DA268ULL, 0xA9942F5DCF7DFD09ULL,
+    0xFE5D54150B090B02ULL, 0xD3F93B35435D7C4CULL,
+    0x9EFA548D26E5A6E1ULL, 0xC47BC5014A1A6DAFULL,
+    0xC6B8E9B0709F109AULL, 0x359AB6419CA1091BULL,
+    0xF867241C8CC6D4C0ULL, 0xC30163D203C94B62ULL,
+    0x9B407691D7FC44F8ULL, 0x79E0DE63425DCF1DULL,
+    0xC21094364DFB5636ULL, 0x985915FC12F542E4ULL,
+    0xF294B943E17A2BC4ULL, 0x3E6F5B7B17B2939DULL,
+    0x979CF3CA6CEC5B5AULL, 0xA705992CEECF9C42ULL,
+    0xBD8430BD08277231ULL, 0x50C6FF782A838353ULL,
+    0xECE53CEC4A314EBDULL, 0xA4F8BF5635246428ULL,
+    0x940F4613AE5ED136ULL, 0x871B7795E136BE99ULL,
+    0xB913179899F68584ULL, 0x28E2557B59846E3FULL,
+    0xE757DD7EC07426E5ULL, 0x331AEADA2FE589CFULL,
+    0x9096EA6F3848984FULL, 0x3FF0D2C85DEF7621ULL,
+    0xB4BCA50B065ABE63ULL, 0x0FED077A756B53A9ULL,
+    0xE1EBCE4DC7F16DFBULL, 0xD3E8495912C62894ULL,
+    0x8D3360F09CF6E4BDULL, 0x64712DD7ABBBD95CULL,
+    0xB080392CC4349DECULL, 0xBD8D794D96AACFB3ULL,
+    0xDCA04777F541C567ULL, 0xECF0D7A0FC5583A0ULL,
+    0x89E42CAAF9491B60ULL, 0xF41686C49DB57244ULL,
+    0xAC5D37D5B79B6239ULL, 0x311C2875C522CED5ULL,
+    0xD77485CB25823AC7ULL, 0x7D633293366B828BULL,
+    0x86A8D39EF77164BCULL, 0xAE5DFF9C02033197ULL,
+    0xA8530886B54DBDEBULL, 0xD9F57F830283FDFCULL,
+    0xD267CAA862A12D66ULL, 0xD072DF63C324FD7BULL,
+    0x8380DEA93DA4BC60ULL, 0x4247CB9E59F71E6DULL,
+    0xA46116538D0DEB78ULL, 0x52D9BE85F074E608ULL,
+    0xCD795BE870516656ULL, 0x67902E276C921F8BULL,
+    0x806BD9714632DFF6ULL, 0x00BA1CD8A3DB53B6ULL,
+    0xA086CFCD97BF97F3ULL, 0x80E8A40ECCD228A4ULL,
+    0xC8A883C0FDAF7DF0ULL, 0x6122CD128006B2CDULL,
+    0xFAD2A4B13D1B5D6CULL, 0x796B805720085F81ULL,
+    0x9CC3A6EEC6311A63ULL, 0xCBE3303674053BB0ULL,
+    0xC3F490AA77BD60FCULL, 0xBEDBFC4411068A9CULL,
+    0xF4F1B4D515ACB93BULL, 0xEE92FB5515482D44ULL,
+    0x991711052D8BF3C5ULL, 0x751BDD152D4D1C4AULL,
+    0xBF5CD54678EEF0B6ULL, 0xD262D45A78A0635DULL,
+    0xEF340A98172AACE4ULL, 0x86FB897116C87C34ULL,
+    0x9580869F0E7AAC0EULL, 0xD45D35E6AE3D4DA0ULL,
+    0xBAE0A846D2195712ULL, 0x8974836059CCA109ULL,
+    0xE998D258869FACD7ULL, 0x2BD1A438703FC94BULL,
+    0x91FF83775423CC06ULL, 0x7B6306A34627DDCFULL,
+    0xB67F6455292CBF08ULL, 0x1A3BC84C17B1D542ULL,
+    0xE41F3D6A7377EECAULL, 0x20CABA5F1D9E4A93ULL,
+    0x8E938662882AF53EULL, 0x547EB47B7282EE9CULL,
+    0xB23867FB2A35B28DULL, 0xE99E619A4F23AA43ULL,
+    0xDEC681F9F4C31F31ULL, 0x6405FA00E2EC94D4ULL,
+    0x8B3C113C38F9F37EULL, 0xDE83BC408DD3DD04ULL,
+    0xAE0B158B4738705EULL, 0x9624AB50B148D445ULL,
+    0xD98DDAEE19068C76ULL, 0x3BADD624DD9B0957ULL,
+    0x87F8A8D4CFA417C9ULL, 0xE54CA5D70A80E5D6ULL,
+    0xA9F6D30A038D1DBCULL, 0x5E9FCF4CCD211F4CULL,
+    0xD47487CC8470652BULL, 0x7647C3200069671FULL,
+    0x84C8D4DFD2C63F3BULL, 0x29ECD9F40041E073ULL,
+    0xA5FB0A17C777CF09ULL, 0xF468107100525890ULL,
+    0xCF79CC9DB955C2CCULL, 0x7182148D4066EEB4ULL,
+    0x81AC1FE293D599BFULL, 0xC6F14CD848405530ULL,
+    0xA21727DB38CB002FULL, 0xB8ADA00E5A506A7CULL,
+    0xCA9CF1D206FDC03BULL, 0xA6D90811F0E4851CULL,
+    0xFD442E4688BD304AULL, 0x908F4A166D1DA663ULL,
+    0x9E4A9CEC15763E2EULL, 0x9A598E4E043287FEULL,
+    0xC5DD44271AD3CDBAULL, 0x40EFF1E1853F29FDULL,
+    0xF7549530E188C128ULL, 0xD12BEE59E68EF47CULL,
+    0x9A94DD3E8CF578B9ULL, 0x82BB74F8301958CEULL,
+    0xC13A148E3032D6E7ULL, 0xE36A52363C1FAF01ULL,
+    0xF18899B1BC3F8CA1ULL, 0xDC44E6C3CB279AC1ULL,
+    0x96F5600F15A7B7E5ULL, 0x29AB103A5EF8C0B9ULL,
+    0xBCB2B812DB11A5DEULL, 0x7415D448F6B6F0E7ULL,
+    0xEBDF661791D60F56ULL, 0x111B495B3464AD21ULL,
+    0x936B9FCEBB25C995ULL, 0xCAB10DD900BEEC34ULL,
+    0xB84687C269EF3BFBULL, 0x3D5D514F40EEA742ULL,
+    0xE65829B3046B0AFAULL, 0x0CB4A5A3112A5112ULL,
+    0x8FF71A0FE2C2E6DCULL, 0x47F0E785EABA72ABULL,
+    0xB3F4E093DB73A093ULL, 0x59ED216765690F56ULL,
+    0xE0F218B8D25088B8ULL, 0x306869C13EC3532CULL,
+    0x8C974F7383725573ULL, 0x1E414218C73A13FBULL,
+    0xAFBD2350644EEACFULL, 0xE5D1929EF90898FAULL,
+    0xDBAC6C247D62A583ULL, 0xDF45F746B74ABF39ULL,
+    0x894BC396CE5DA772ULL, 0x6B8BBA8C328EB783ULL,
+    0xAB9EB47C81F5114FULL, 0x066EA92F3F326564ULL,
+    0xD686619BA27255A2ULL, 0xC80A537B0EFEFEBDULL,
+    0x8613FD0145877585ULL, 0xBD06742CE95F5F36ULL,
+    0xA798FC4196E952E7ULL, 0x2C48113823B73704ULL,
+    0xD17F3B51FCA3A7A0ULL, 0xF75A15862CA504C5ULL,
+    0x82EF85133DE648C4ULL, 0x9A984D73DBE722FBULL,
+    0xA3AB66580D5FDAF5ULL, 0xC13E60D0D2E0EBBAULL,
+    0xCC963FEE10B7D1B3ULL, 0x318DF905079926A8ULL,
+    0xFFBBCFE994E5C61FULL, 0xFDF17746497F7052ULL,
+    0x9FD561F1FD0F9BD3ULL, 0xFEB6EA8BEDEFA633ULL,
+    0xC7CABA6E7C5382C8ULL, 0xFE64A52EE96B8FC0ULL,
+    0xF9BD690A1B68637BULL, 0x3DFDCE7AA3C673B0ULL,
+    0x9C1661A651213E2DULL, 0x06BEA10CA65C084EULL,
+    0xC31BFA0FE5698DB8ULL, 0x486E494FCFF30A62ULL,
+    0xF3E2F893DEC3F126ULL, 0x5A89DBA3C3EFCCFAULL,
+    0x986DDB5C6B3A76B7ULL, 0xF89629465A75E01CULL,
+    0xBE89523386091465ULL, 0xF6BBB397F1135823ULL,
+    0xEE2BA6C0678B597FULL, 0x746AA07DED582E2CULL,
+    0x94DB483840B717EFULL, 0xA8C2A44EB4571CDCULL,
+    0xBA121A4650E4DDEBULL, 0x92F34D62616CE413ULL,
+    0xE896A0D7E51E1566ULL, 0x77B020BAF9C81D17ULL,
+    0x915E2486EF32CD60ULL, 0x0ACE1474DC1D122EULL,
+    0xB5B5ADA8AAFF80B8ULL, 0x0D819992132456BAULL,
+    0xE3231912D5BF60E6ULL, 0x10E1FFF697ED6C69ULL,
+    0x8DF5EFABC5979C8FULL, 0xCA8D3FFA1EF463C1ULL,
+    0xB1736B96B6FD83B3ULL, 0xBD308FF8A6B17CB2ULL,
+    0xDDD0467C64BCE4A0ULL, 0xAC7CB3F6D05DDBDEULL,
+    0x8AA22C0DBEF60EE4ULL, 0x6BCDF07A423AA96BULL,
+    0xAD4AB7112EB3929DULL, 0x86C16C98D2C953C6ULL,
+    0xD89D64D57A607744ULL, 0xE871C7BF077BA8B7ULL,
+    0x87625F056C7C4A8BULL, 0x11471CD764AD4972ULL,
+    0xA93AF6C6C79B5D2DULL, 0xD598E40D3DD89BCFULL,
+    0xD389B47879823479ULL, 0x4AFF1D108D4EC2C3ULL,
+    0x843610CB4BF160CBULL, 0xCEDF722A585139BAULL,
+    0xA54394FE1EEDB8FEULL, 0xC2974EB4EE658828ULL,
+    0xCE947A3DA6A9273EULL, 0x733D226229FEEA32ULL,
+    0x811CCC668829B887ULL, 0x0806357D5A3F525FULL,
+    0xA163FF802A3426A8ULL, 0xCA07C2DCB0CF26F7ULL,
+    0xC9BCFF6034C13052ULL, 0xFC89B393DD02F0B5ULL,
+    0xFC2C3F3841F17C67ULL, 0xBBAC2078D443ACE2ULL,
+    0x9D9BA7832936EDC0ULL, 0xD54B944B84AA4C0DULL,
+    0xC5029163F384A931ULL, 0x0A9E795E65D4DF11ULL,
+    0xF64335BCF065D37DULL, 0x4D4617B5FF4A16D5ULL,
+    0x99EA0196163FA42EULL, 0x504BCED1BF8E4E45ULL,
+    0xC06481FB9BCF8D39ULL, 0xE45EC2862F71E1D6ULL,
+    0xF07DA27A82C37088ULL, 0x5D767327BB4E5A4CULL,
+    0x964E858C91BA2655ULL, 0x3A6A07F8D510F86FULL,
+    0xBBE226EFB628AFEAULL, 0x890489F70A55368BULL,
+    0xEADAB0ABA3B2DBE5ULL, 0x2B45AC74CCEA842EULL,
+    0x92C8AE6B464FC96FULL, 0x3B0B8BC90012929DULL,
+    0xB77ADA0617E3BBCBULL, 0x09CE6EBB40173744ULL,
+    0xE55990879DDCAABDULL, 0xCC420A6A101D0515ULL,
+    0x8F57FA54C2A9EAB6ULL, 0x9FA946824A12232DULL,
+    0xB32DF8E9F3546564ULL, 0x47939822DC96ABF9ULL,
+    0xDFF9772470297EBDULL, 0x59787E2B93BC56F7ULL,
+    0x8BFBEA76C619EF36ULL, 0x57EB4EDB3C55B65AULL,
+    0xAEFAE51477A06B03ULL, 0xEDE622920B6B23F1ULL,
+    0xDAB99E59958885C4ULL, 0xE95FAB368E45ECEDULL,
+    0x88B402F7FD75539BULL, 0x11DBCB0218EBB414ULL,
+    0xAAE103B5FCD2A881ULL, 0xD652BDC29F26A119ULL,
+    0xD59944A37C0752A2ULL, 0x4BE76D3346F0495FULL,
+    0x857FCAE62D8493A5ULL, 0x6F70A4400C562DDBULL,
+    0xA6DFBD9FB8E5B88EULL, 0xCB4CCD500F6BB952ULL,
+    0xD097AD07A71F26B2ULL, 0x7E2000A41346A7A7ULL,
+    0x825ECC24C873782FULL, 0x8ED400668C0C28C8ULL,
+    0xA2F67F2DFA90563BULL, 0x728900802F0F32FAULL,
+    0xCBB41EF979346BCAULL, 0x4F2B40A03AD2FFB9ULL,
+    0xFEA126B7D78186BCULL, 0xE2F610C84987BFA8ULL,
+    0x9F24B832E6B0F436ULL, 0x0DD9CA7D2DF4D7C9ULL,
+    0xC6EDE63FA05D3143ULL, 0x91503D1C79720DBBULL,
+    0xF8A95FCF88747D94ULL, 0x75A44C6397CE912AULL,
+    0x9B69DBE1B548CE7CULL, 0xC986AFBE3EE11ABAULL,
+    0xC24452DA229B021BULL, 0xFBE85BADCE996168ULL,
+    0xF2D56790AB41C2A2ULL, 0xFAE27299423FB9C3ULL,
+    0x97C560BA6B0919A5ULL, 0xDCCD879FC967D41AULL,
+    0xBDB6B8E905CB600FULL, 0x5400E987BBC1C920ULL,
+    0xED246723473E3813ULL, 0x290123E9AAB23B68ULL,
+    0x9436C0760C86E30BULL, 0xF9A0B6720AAF6521ULL,
+    0xB94470938FA89BCEULL, 0xF808E40E8D5B3E69ULL,
+    0xE7958CB87392C2C2ULL, 0xB60B1D1230B20E04ULL,
+    0x90BD77F3483BB9B9ULL, 0xB1C6F22B5E6F48C2ULL,
+    0xB4ECD5F01A4AA828ULL, 0x1E38AEB6360B1AF3ULL,
+    0xE2280B6C20DD5232ULL, 0x25C6DA63C38DE1B0ULL,
+    0x8D590723948A535FULL, 0x579C487E5A38AD0EULL,
+    0xB0AF48EC79ACE837ULL, 0x2D835A9DF0C6D851ULL,
+    0xDCDB1B2798182244ULL, 0xF8E431456CF88E65ULL,
+    0x8A08F0F8BF0F156BULL, 0x1B8E9ECB641B58FFULL,
+    0xAC8B2D36EED2DAC5ULL, 0xE272467E3D222F3FULL,
+    0xD7ADF884AA879177ULL, 0x5B0ED81DCC6ABB0FULL,
+    0x86CCBB52EA94BAEAULL, 0x98E947129FC2B4E9ULL,
+    0xA87FEA27A539E9A5ULL, 0x3F2398D747B36224ULL,
+    0xD29FE4B18E88640EULL, 0x8EEC7F0D19A03AADULL,
+    0x83A3EEEEF9153E89ULL, 0x1953CF68300424ACULL,
+    0xA48CEAAAB75A8E2BULL, 0x5FA8C3423C052DD7ULL,
+    0xCDB02555653131B6ULL, 0x3792F412CB06794DULL,
+    0x808E17555F3EBF11ULL, 0xE2BBD88BBEE40BD0ULL,
+    0xA0B19D2AB70E6ED6ULL, 0x5B6ACEAEAE9D0EC4ULL,
+    0xC8DE047564D20A8BULL, 0xF245825A5A445275ULL,
+    0xFB158592BE068D2EULL, 0xEED6E2F0F0D56712ULL,
+    0x9CED737BB6C4183DULL, 0x55464DD69685606BULL,
+    0xC428D05AA4751E4CULL, 0xAA97E14C3C26B886ULL,
+    0xF53304714D9265DFULL, 0xD53DD99F4B3066A8ULL,
+    0x993FE2C6D07B7FABULL, 0xE546A8038EFE4029ULL,
+    0xBF8FDB78849A5F96ULL, 0xDE98520472BDD033ULL,
+    0xEF73D256A5C0F77CULL, 0x963E66858F6D4440ULL,
+    0x95A8637627989AADULL, 0xDDE7001379A44AA8ULL,
+    0xBB127C53B17EC159ULL, 0x5560C018580D5D52ULL,
+    0xE9D71B689DDE71AFULL, 0xAAB8F01E6E10B4A6ULL,
+    0x9226712162AB070DULL, 0xCAB3961304CA70E8ULL,
+    0xB6B00D69BB55C8D1ULL, 0x3D607B97C5FD0D22ULL,
+    0xE45C10C42A2B3B05ULL, 0x8CB89A7DB77C506AULL,
+    0x8EB98A7A9A5B04E3ULL, 0x77F3608E92ADB242ULL,
+    0xB267ED1940F1C61CULL, 0x55F038B237591ED3ULL,
+    0xDF01E85F912E37A3ULL, 0x6B6C46DEC52F6688ULL,
+    0x8B61313BBABCE2C6ULL, 0x2323AC4B3B3DA015ULL,
+    0xAE397D8AA96C1B77ULL, 0xABEC975E0A0D081AULL,
+    0xD9C7DCED53C72255ULL, 0x96E7BD358C904A21ULL,
+    0x881CEA14545C7575ULL, 0x7E50D64177DA2E54ULL,
+    0xAA242499697392D2ULL, 0xDDE50BD1D5D0B9E9ULL,
+    0xD4AD2DBFC3D07787ULL, 0x955E4EC64B44E864ULL,
+    0x84EC3C97DA624AB4ULL, 0xBD5AF13BEF0B113EULL,
+    0xA6274BBDD0FADD61ULL, 0xECB1AD8AEACDD58EULL,
+    0xCFB11EAD453994BAULL, 0x67DE18EDA5814AF2ULL,
+    0x81CEB32C4B43FCF4ULL, 0x80EACF948770CED7ULL,
+    0xA2425FF75E14FC31ULL, 0xA1258379A94D028DULL,
+    0xCAD2F7F5359A3B3EULL, 0x096EE45813A04330ULL,
+    0xFD87B5F28300CA0DULL, 0x8BCA9D6E188853FCULL,
+    0x9E74D1B791E07E48ULL, 0x775EA264CF55347EULL,
+    0xC612062576589DDAULL, 0x95364AFE032A819EULL,
+    0xF79687AED3EEC551ULL, 0x3A83DDBD83F52205ULL,
+    0x9ABE14CD44753B52ULL, 0xC4926A9672793543ULL,
+    0xC16D9A0095928A27ULL, 0x75B7053C0F178294ULL,
+    0xF1C90080BAF72CB1ULL, 0x5324C68B12DD6339ULL,
+    0x971DA05074DA7BEEULL, 0xD3F6FC16EBCA5E04ULL,
+    0xBCE5086492111AEAULL, 0x88F4BB1CA6BCF585ULL,
+    0xEC1E4A7DB69561A5ULL, 0x2B31E9E3D06C32E6ULL,
+    0x9392EE8E921D5D07ULL, 0x3AFF322E62439FD0ULL,
+    0xB877AA3236A4B449ULL, 0x09BEFEB9FAD487C3ULL,
+    0xE69594BEC44DE15BULL, 0x4C2EBE687989A9B4ULL,
+    0x901D7CF73AB0ACD9ULL, 0x0F9D37014BF60A11ULL,
+    0xB424DC35095CD80FULL, 0x538484C19EF38C95ULL,
+    0xE12E13424BB40E13ULL, 0x2865A5F206B06FBAULL,
+    0x8CBCCC096F5088CBULL, 0xF93F87B7442E45D4ULL,
+    0xAFEBFF0BCB24AAFEULL, 0xF78F69A51539D749ULL,
+    0xDBE6FECEBDEDD5BEULL, 0xB573440E5A884D1CULL,
+    0x89705F4136B4A597ULL, 0x31680A88F8953031ULL,
+    0xABCC77118461CEFCULL, 0xFDC20D2B36BA7C3EULL,
+    0xD6BF94D5E57A42BCULL, 0x3D32907604691B4DULL,
+    0x8637BD05AF6C69B5ULL, 0xA63F9A49C2C1B110ULL,
+    0xA7C5AC471B478423ULL, 0x0FCF80DC33721D54ULL,
+    0xD1B71758E219652BULL, 0xD3C36113404EA4A9ULL,
+    0x83126E978D4FDF3BULL, 0x645A1CAC083126EAULL,
+    0xA3D70A3D70A3D70AULL, 0x3D70A3D70A3D70A4ULL,
+    0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCDULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL,
+    0xA000000000000000ULL, 0x0000000000000000ULL,
+    0xC800000000000000ULL, 0x0000000000000000ULL,
+    0xFA00000000000000ULL, 0x0000000000000000ULL,
+    0x9C40000000000000ULL, 0x0000000000000000ULL,
+    0xC350000000000000ULL, 0x0000000000000000ULL,
+    0xF424000000000000ULL, 0x0000000000000000ULL,
+    0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xBEBC200000000000ULL, 0x0000000000000000ULL,
+    0xEE6B280000000000ULL, 0x0000000000000000ULL,
+    0x9502F90000000000ULL, 0x0000000000000000ULL,
+    0xBA43B74000000000ULL, 0x0000000000000000ULL,
+    0xE8D4A51000000000ULL, 0x0000000000000000ULL,
+    0x9184E72A00000000ULL, 0x0000000000000000ULL,
+    0xB5E620F480000000ULL, 0x0000000000000000ULL,
+    0xE35FA931A0000000ULL, 0x0000000000000000ULL,
+    0x8E1BC9BF04000000ULL, 0x0000000000000000ULL,
+    0xB1A2BC2EC5000000ULL, 0x0000000000000000ULL,
+    0xDE0B6B3A76400000ULL, 0x0000000000000000ULL,
+    0x8AC7230489E80000ULL, 0x0000000000000000ULL,
+    0xAD78EBC5AC620000ULL, 0x0000000000000000ULL,
+    0xD8D726B7177A8000ULL, 0x0000000000000000ULL,
+    0x878678326EAC9000ULL, 0x0000000000000000ULL,
+    0xA968163F0A57B400ULL, 0x0000000000000000ULL,
+    0xD3C21BCECCEDA100ULL, 0x0000000000000000ULL,
+    0x84595161401484A0ULL, 0x0000000000000000ULL,
+    0xA56FA5B99019A5C8ULL, 0x0000000000000000ULL,
+    0xCECB8F27F4200F3AULL, 0x0000000000000000ULL,
+    0x813F3978F8940984ULL, 0x4000000000000000ULL,
+    0xA18F07D736B90BE5ULL, 0x5000000000000000ULL,
+    0xC9F2C9CD04674EDEULL, 0xA400000000000000ULL,
+    0xFC6F7C4045812296ULL, 0x4D00000000000000ULL,
+    0x9DC5ADA82B70B59DULL, 0xF020000000000000ULL,
+    0xC5371912364CE305ULL, 0x6C28000000000000ULL,
+    0xF684DF56C3E01BC6ULL, 0xC732000000000000ULL,
+    0x9A130B963A6C115CULL, 0x3C7F400000000000ULL,
+    0xC097CE7BC90715B3ULL, 0x4B9F100000000000ULL,
+    0xF0BDC21ABB48DB20ULL, 0x1E86D40000000000ULL,
+    0x96769950B50D88F4ULL, 0x1314448000000000ULL,
+    0xBC143FA4E250EB31ULL, 0x17D955A000000000ULL,
+    0xEB194F8E1AE525FDULL, 0x5DCFAB0800000000ULL,
+    0x92EFD1B8D0CF37BEULL, 0x5AA1CAE500000000ULL,
+    0xB7ABC627050305ADULL, 0xF14A3D9E40000000ULL,
+    0xE596B7B0C643C719ULL, 0x6D9CCD05D0000000ULL,
+    0x8F7E32CE7BEA5C6FULL, 0xE4820023A2000000ULL,
+    0xB35DBF821AE4F38BULL, 0xDDA2802C8A800000ULL,
+    0xE0352F62A19E306EULL, 0xD50B2037AD200000ULL,
+    0x8C213D9DA502DE45ULL, 0x4526F422CC340000ULL,
+    0xAF298D050E4395D6ULL, 0x9670B12B7F410000ULL,
+    0xDAF3F04651D47B4CULL, 0x3C0CDD765F114000ULL,
+    0x88D8762BF324CD0FULL, 0xA5880A69FB6AC800ULL,
+    0xAB0E93B6EFEE0053ULL, 0x8EEA0D047A457A00ULL,
+    0xD5D238A4ABE98068ULL, 0x72A4904598D6D880ULL,
+    0x85A36366EB71F041ULL, 0x47A6DA2B7F864750ULL,
+    0xA70C3C40A64E6C51ULL, 0x999090B65F67D924ULL,
+    0xD0CF4B50CFE20765ULL, 0xFFF4B4E3F741CF6DULL,
+    0x82818F1281ED449FULL, 0xBFF8F10E7A8921A4ULL,
+    0xA321F2D7226895C7ULL, 0xAFF72D52192B6A0DULL,
+    0xCBEA6F8CEB02BB39ULL, 0x9BF4F8A69F764490ULL,
+    0xFEE50B7025C36A08ULL, 0x02F236D04753D5B4ULL,
+    0x9F4F2726179A2245ULL, 0x01D762422C946590ULL,
+    0xC722F0EF9D80AAD6ULL, 0x424D3AD2B7B97EF5ULL,
+    0xF8EBAD2B84E0D58BULL, 0xD2E0898765A7DEB2ULL,
+    0x9B934C3B330C8577ULL, 0x63CC55F49F88EB2FULL,
+    0xC2781F49FFCFA6D5ULL, 0x3CBF6B71C76B25FBULL,
+    0xF316271C7FC3908AULL, 0x8BEF464E3945EF7AULL,
+    0x97EDD871CFDA3A56ULL, 0x97758BF0E3CBB5ACULL,
+    0xBDE94E8E43D0C8ECULL, 0x3D52EEED1CBEA317ULL,
+    0xED63A231D4C4FB27ULL, 0x4CA7AAA863EE4BDDULL,
+    0x945E455F24FB1CF8ULL, 0x8FE8CAA93E74EF6AULL,
+    0xB975D6B6EE39E436ULL, 0xB3E2FD538E122B44ULL,
+    0xE7D34C64A9C85D44ULL, 0x60DBBCA87196B616ULL,
+    0x90E40FBEEA1D3A4AULL, 0xBC8955E946FE31CDULL,
+    0xB51D13AEA4A488DDULL, 0x6BABAB6398BDBE41ULL,
+    0xE264589A4DCDAB14ULL, 0xC696963C7EED2DD1ULL,
+    0x8D7EB76070A08AECULL, 0xFC1E1DE5CF543CA2ULL,
+    0xB0DE65388CC8ADA8ULL, 0x3B25A55F43294BCBULL,
+    0xDD15FE86AFFAD912ULL, 0x49EF0EB713F39EBEULL,
+    0x8A2DBF142DFCC7ABULL, 0x6E3569326C784337ULL,
+    0xACB92ED9397BF996ULL, 0x49C2C37F07965404ULL,
+    0xD7E77A8F87DAF7FBULL, 0xDC33745EC97BE906ULL,
+    0x86F0AC99B4E8DAFDULL, 0x69A028BB3DED71A3ULL,
+    0xA8ACD7C0222311BCULL, 0xC40832EA0D68CE0CULL,
+    0xD2D80DB02AABD62BULL, 0xF50A3FA490C30190ULL,
+    0x83C7088E1AAB65DBULL, 0x792667C6DA79E0FAULL,
+    0xA4B8CAB1A1563F52ULL, 0x577001B891185938ULL,
+    0xCDE6FD5E09ABCF26ULL, 0xED4C0226B55E6F86ULL,
+    0x80B05E5AC60B6178ULL, 0x544F8158315B05B4ULL,
+    0xA0DC75F1778E39D6ULL, 0x696361AE3DB1C721ULL,
+    0xC913936DD571C84CULL, 0x03BC3A19CD1E38E9ULL,
+    0xFB5878494ACE3A5FULL, 0x04AB48A04065C723ULL,
+    0x9D174B2DCEC0E47BULL, 0x62EB0D64283F9C76ULL,
+    0xC45D1DF942711D9AULL, 0x3BA5D0BD324F8394ULL,
+    0xF5746577930D6500ULL, 0xCA8F44EC7EE36479ULL,
+    0x9968BF6ABBE85F20ULL, 0x7E998B13CF4E1ECBULL,
+    0xBFC2EF456AE276E8ULL, 0x9E3FEDD8C321A67EULL,
+    0xEFB3AB16C59B14A2ULL, 0xC5CFE94EF3EA101EULL,
+    0x95D04AEE3B80ECE5ULL, 0xBBA1F1D158724A12ULL,
+    0xBB445DA9CA61281FULL, 0x2A8A6E45AE8EDC97ULL,
+    0xEA1575143CF97226ULL, 0xF52D09D71A3293BDULL,
+    0x924D692CA61BE758ULL, 0x593C2626705F9C56ULL,
+    0xB6E0C377CFA2E12EULL, 0x6F8B2FB00C77836CULL,
+    0xE498F455C38B997AULL, 0x0B6DFB9C0F956447ULL,
+    0x8EDF98B59A373FECULL, 0x4724BD4189BD5EACULL,
+    0xB2977EE300C50FE7ULL, 0x58EDEC91EC2CB657ULL,
+    0xDF3D5E9BC0F653E1ULL, 0x2F2967B66737E3EDULL,
+    0x8B865B215899F46CULL, 0xBD79E0D20082EE74ULL,
+    0xAE67F1E9AEC07187ULL, 0xECD8590680A3AA11ULL,
+    0xDA01EE641A708DE9ULL, 0xE80E6F4820CC9495ULL,
+    0x884134FE908658B2ULL, 0x3109058D147FDCDDULL,
+    0xAA51823E34A7EEDEULL, 0xBD4B46F0599FD415ULL,
+    0xD4E5E2CDC1D1EA96ULL, 0x6C9E18AC7007C91AULL,
+    0x850FADC09923329EULL, 0x03E2CF6BC604DDB0ULL,
+    0xA6539930BF6BFF45ULL, 0x84DB8346B786151CULL,
+    0xCFE87F7CEF46FF16ULL, 0xE612641865679A63ULL,
+    0x81F14FAE158C5F6EULL, 0x4FCB7E8F3F60C07EULL,
+    0xA26DA3999AEF7749ULL, 0xE3BE5E330F38F09DULL,
+    0xCB090C8001AB551CULL, 0x5CADF5BFD3072CC5ULL,
+    0xFDCB4FA002162A63ULL, 0x73D9732FC7C8F7F6ULL,
+    0x9E9F11C4014DDA7EULL, 0x2867E7FDDCDD9AFAULL,
+    0xC646D63501A1511DULL, 0xB281E1FD541501B8ULL,
+    0xF7D88BC24209A565ULL, 0x1F225A7CA91A4226ULL,
+    0x9AE757596946075FULL, 0x3375788DE9B06958ULL,
+    0xC1A12D2FC3978937ULL, 0x0052D6B1641C83AEULL,
+    0xF209787BB47D6B84ULL, 0xC0678C5DBD23A49AULL,
+    0x9745EB4D50CE6332ULL, 0xF840B7BA963646E0ULL,
+    0xBD176620A501FBFFULL, 0xB650E5A93BC3D898ULL,
+    0xEC5D3FA8CE427AFFULL, 0xA3E51F138AB4CEBEULL,
+    0x93BA47C980E98CDFULL, 0xC66F336C36B10137ULL,
+    0xB8A8D9BBE123F017ULL, 0xB80B0047445D4184ULL,
+    0xE6D3102AD96CEC1DULL, 0xA60DC059157491E5ULL,
+    0x9043EA1AC7E41392ULL, 0x87C89837AD68DB2FULL,
+    0xB454E4A179DD1877ULL, 0x29BABE4598C311FBULL,
+    0xE16A1DC9D8545E94ULL, 0xF4296DD6FEF3D67AULL,
+    0x8CE2529E2734BB1DULL, 0x1899E4A65F58660CULL,
+    0xB01AE745B101E9E4ULL, 0x5EC05DCFF72E7F8FULL,
+    0xDC21A1171D42645DULL, 0x76707543F4FA1F73ULL,
+    0x899504AE72497EBAULL, 0x6A06494A791C53A8ULL,
+    0xABFA45DA0EDBDE69ULL, 0x0487DB9D17636892ULL,
+    0xD6F8D7509292D603ULL, 0x45A9D2845D3C42B6ULL,
+    0x865B86925B9BC5C2ULL, 0x0B8A2392BA45A9B2ULL,
+    0xA7F26836F282B732ULL, 0x8E6CAC7768D7141EULL,
+    0xD1EF0244AF2364FFULL, 0x3207D795430CD926ULL,
+    0x8335616AED761F1FULL, 0x7F44E6BD49E807B8ULL,
+    0xA402B9C5A8D3A6E7ULL, 0x5F16206C9C6209A6ULL,
+    0xCD036837130890A1ULL, 0x36DBA887C37A8C0FULL,
+    0x802221226BE55A64ULL, 0xC2494954DA2C9789ULL,
+    0xA02AA96B06DEB0FDULL, 0xF2DB9BAA10B7BD6CULL,
+    0xC83553C5C8965D3DULL, 0x6F92829494E5ACC7ULL,
+    0xFA42A8B73ABBF48CULL, 0xCB772339BA1F17F9ULL,
+    0x9C69A97284B578D7ULL, 0xFF2A760414536EFBULL,
+    0xC38413CF25E2D70DULL, 0xFEF5138519684ABAULL,
+    0xF46518C2EF5B8CD1ULL, 0x7EB258665FC25D69ULL,
+    0x98BF2F79D5993802ULL, 0xEF2F773FFBD97A61ULL,
+    0xBEEEFB584AFF8603ULL, 0xAAFB550FFACFD8FAULL,
+    0xEEAABA2E5DBF6784ULL, 0x95BA2A53F983CF38ULL,
+    0x952AB45CFA97A0B2ULL, 0xDD945A747BF26183ULL,
+    0xBA756174393D88DFULL, 0x94F971119AEEF9E4ULL,
+    0xE912B9D1478CEB17ULL, 0x7A37CD5601AAB85DULL,
+    0x91ABB422CCB812EEULL, 0xAC62E055C10AB33AULL,
+    0xB616A12B7FE617AAULL, 0x577B986B314D6009ULL,
+    0xE39C49765FDF9D94ULL, 0xED5A7E85FDA0B80BULL,
+    0x8E41ADE9FBEBC27DULL, 0x14588F13BE847307ULL,
+    0xB1D219647AE6B31CULL, 0x596EB2D8AE258FC8ULL,
+    0xDE469FBD99A05FE3ULL, 0x6FCA5F8ED9AEF3BBULL,
+    0x8AEC23D680043BEEULL, 0x25DE7BB9480D5854ULL,
+    0xADA72CCC20054AE9ULL, 0xAF561AA79A10AE6AULL,
+    0xD910F7FF28069DA4ULL, 0x1B2BA1518094DA04ULL,
+    0x87AA9AFF79042286ULL, 0x90FB44D2F05D0842ULL,
+    0xA99541BF57452B28ULL, 0x353A1607AC744A53ULL,
+    0xD3FA922F2D1675F2ULL, 0x42889B8997915CE8ULL,
+    0x847C9B5D7C2E09B7ULL, 0x69956135FEBADA11ULL,
+    0xA59BC234DB398C25ULL, 0x43FAB9837E699095ULL,
+    0xCF02B2C21207EF2EULL, 0x94F967E45E03F4BBULL,
+    0x8161AFB94B44F57DULL, 0x1D1BE0EEBAC278F5ULL,
+    0xA1BA1BA79E1632DCULL, 0x6462D92A69731732ULL,
+    0xCA28A291859BBF93ULL, 0x7D7B8F7503CFDCFEULL,
+    0xFCB2CB35E702AF78ULL, 0x5CDA735244C3D43EULL,
+    0x9DEFBF01B061ADABULL, 0x3A0888136AFA64A7ULL,
+    0xC56BAEC21C7A1916ULL, 0x088AAA1845B8FDD0ULL,
+    0xF6C69A72A3989F5BULL, 0x8AAD549E57273D45ULL,
+    0x9A3C2087A63F6399ULL, 0x36AC54E2F678864BULL,
+    0xC0CB28A98FCF3C7FULL, 0x84576A1BB416A7DDULL,
+    0xF0FDF2D3F3C30B9FULL, 0x656D44A2A11C51D5ULL,
+    0x969EB7C47859E743ULL, 0x9F644AE5A4B1B325ULL,
+    0xBC4665B596706114ULL, 0x873D5D9F0DDE1FEEULL,
+    0xEB57FF22FC0C7959ULL, 0xA90CB506D155A7EAULL,
+    0x9316FF75DD87CBD8ULL, 0x09A7F12442D588F2ULL,
+    0xB7DCBF5354E9BECEULL, 0x0C11ED6D538AEB2FULL,
+    0xE5D3EF282A242E81ULL, 0x8F1668C8A86DA5FAULL,
+    0x8FA475791A569D10ULL, 0xF96E017D694487BCULL,
+    0xB38D92D760EC4455ULL, 0x37C981DCC395A9ACULL,
+    0xE070F78D3927556AULL, 0x85BBE253F47B1417ULL,
+    0x8C469AB843B89562ULL, 0x93956D7478CCEC8EULL,
+    0xAF58416654A6BABBULL, 0x387AC8D1970027B2ULL,
+    0xDB2E51BFE9D0696AULL, 0x06997B05FCC0319EULL,
+    0x88FCF317F22241E2ULL, 0x441FECE3BDF81F03ULL,
+    0xAB3C2FDDEEAAD25AULL, 0xD527E81CAD7626C3ULL,
+    0xD60B3BD56A5586F1ULL, 0x8A71E223D8D3B074ULL,
+    0x85C7056562757456ULL, 0xF6872D5667844E49ULL,
+    0xA738C6BEBB12D16CULL, 0xB428F8AC016561DBULL,
+    0xD106F86E69D785C7ULL, 0xE13336D701BEBA52ULL,
+    0x82A45B450226B39CULL, 0xECC0024661173473ULL,
+    0xA34D721642B06084ULL, 0x27F002D7F95D0190ULL,
+    0xCC20CE9BD35C78A5ULL, 0x31EC038DF7B441F4ULL,
+    0xFF290242C83396CEULL, 0x7E67047175A15271ULL,
+    0x9F79A169BD203E41ULL, 0x0F0062C6E984D386ULL,
+    0xC75809C42C684DD1ULL, 0x52C07B78A3E60868ULL,
+    0xF92E0C3537826145ULL, 0xA7709A56CCDF8A82ULL,
+    0x9BBCC7A142B17CCBULL, 0x88A66076400BB691ULL,
+    0xC2ABF989935DDBFEULL, 0x6ACFF893D00EA435ULL,
+    0xF356F7EBF83552FEULL, 0x0583F6B8C4124D43ULL,
+    0x98165AF37B2153DEULL, 0xC3727A337A8B704AULL,
+    0xBE1BF1B059E9A8D6ULL, 0x744F18C0592E4C5CULL,
+    0xEDA2EE1C7064130CULL, 0x1162DEF06F79DF73ULL,
+    0x9485D4D1C63E8BE7ULL, 0x8ADDCB5645AC2BA8ULL,
+    0xB9A74A0637CE2EE1ULL, 0x6D953E2BD7173692ULL,
+    0xE8111C87C5C1BA99ULL, 0xC8FA8DB6CCDD0437ULL,
+    0x910AB1D4DB9914A0ULL, 0x1D9C9892400A22A2ULL,
+    0xB54D5E4A127F59C8ULL, 0x2503BEB6D00CAB4BULL,
+    0xE2A0B5DC971F303AULL, 0x2E44AE64840FD61DULL,
+    0x8DA471A9DE737E24ULL, 0x5CEAECFED289E5D2ULL,
+    0xB10D8E1456105DADULL, 0x7425A83E872C5F47ULL,
+    0xDD50F1996B947518ULL, 0xD12F124E28F77719ULL,
+    0x8A5296FFE33CC92FULL, 0x82BD6B70D99AAA6FULL,
+    0xACE73CBFDC0BFB7BULL, 0x636CC64D1001550BULL,
+    0xD8210BEFD30EFA5AULL, 0x3C47F7E05401AA4EULL,
+    0x8714A775E3E95C78ULL, 0x65ACFAEC34810A71ULL,
+    0xA8D9D1535CE3B396ULL, 0x7F1839A741A14D0DULL,
+    0xD31045A8341CA07CULL, 0x1EDE48111209A050ULL,
+    0x83EA2B892091E44DULL, 0x934AED0AAB460432ULL,
+    0xA4E4B66B68B65D60ULL, 0xF81DA84D5617853FULL,
+    0xCE1DE40642E3F4B9ULL, 0x36251260AB9D668EULL,
+    0x80D2AE83E9CE78F3ULL, 0xC1D72B7C6B426019ULL,
+    0xA1075A24E4421730ULL, 0xB24CF65B8612F81FULL,
+    0xC94930AE1D529CFCULL, 0xDEE033F26797B627ULL,
+    0xFB9B7CD9A4A7443CULL, 0x169840EF017DA3B1ULL,
+    0x9D412E0806E88AA5ULL, 0x8E1F289560EE864EULL,
+    0xC491798A08A2AD4EULL, 0xF1A6F2BAB92A27E2ULL,
+    0xF5B5D7EC8ACB58A2ULL, 0xAE10AF696774B1DBULL,
+    0x9991A6F3D6BF1765ULL, 0xACCA6DA1E0A8EF29ULL,
+    0xBFF610B0CC6EDD3FULL, 0x17FD090A58D32AF3ULL,
+    0xEFF394DCFF8A948EULL, 0xDDFC4B4CEF07F5B0ULL,
+    0x95F83D0A1FB69CD9ULL, 0x4ABDAF101564F98EULL,
+    0xBB764C4CA7A4440FULL, 0x9D6D1AD41ABE37F1ULL,
+    0xEA53DF5FD18D5513ULL, 0x84C86189216DC5EDULL,
+    0x92746B9BE2F8552CULL, 0x32FD3CF5B4E49BB4ULL,
+    0xB7118682DBB66A77ULL, 0x3FBC8C33221DC2A1ULL,
+    0xE4D5E82392A40515ULL, 0x0FABAF3FEAA5334AULL,
+    0x8F05B1163BA6832DULL, 0x29CB4D87F2A7400EULL,
+    0xB2C71D5BCA9023F8ULL, 0x743E20E9EF511012ULL,
+    0xDF78E4B2BD342CF6ULL, 0x914DA9246B255416ULL,
+    0x8BAB8EEFB6409C1AULL, 0x1AD089B6C2F7548EULL,
+    0xAE9672ABA3D0C320ULL, 0xA184AC2473B529B1ULL,
+    0xDA3C0F568CC4F3E8ULL, 0xC9E5D72D90A2741EULL,
+    0x8865899617FB1871ULL, 0x7E2FA67C7A658892ULL,
+    0xAA7EEBFB9DF9DE8DULL, 0xDDBB901B98FEEAB7ULL,
+    0xD51EA6FA85785631ULL, 0x552A74227F3EA565ULL,
+    0x8533285C936B35DEULL, 0xD53A88958F87275FULL,
+    0xA67FF273B8460356ULL, 0x8A892ABAF368F137ULL,
+    0xD01FEF10A657842CULL, 0x2D2B7569B0432D85ULL,
+    0x8213F56A67F6B29BULL, 0x9C3B29620E29FC73ULL,
+    0xA298F2C501F45F42ULL, 0x8349F3BA91B47B8FULL,
+    0xCB3F2F7642717713ULL, 0x241C70A936219A73ULL,
+    0xFE0EFB53D30DD4D7ULL, 0xED238CD383AA0110ULL,
+    0x9EC95D1463E8A506ULL, 0xF4363804324A40AAULL,
+    0xC67BB4597CE2CE48ULL, 0xB143C6053EDCD0D5ULL,
+    0xF81AA16FDC1B81DAULL, 0xDD94B7868E94050AULL,
+    0x9B10A4E5E9913128ULL, 0xCA7CF2B4191C8326ULL,
+    0xC1D4CE1F63F57D72ULL, 0xFD1C2F611F63A3F0ULL,
+    0xF24A01A73CF2DCCFULL, 0xBC633B39673C8CECULL,
+    0x976E41088617CA01ULL, 0xD5BE0503E085D813ULL,
+    0xBD49D14AA79DBC82ULL, 0x4B2D8644D8A74E18ULL,
+    0xEC9C459D51852BA2ULL, 0xDDF8E7D60ED1219EULL,
+    0x93E1AB8252F33B45ULL, 0xCABB90E5C942B503ULL,
+    0xB8DA1662E7B00A17ULL, 0x3D6A751F3B936243ULL,
+    0xE7109BFBA19C0C9DULL, 0x0CC512670A783AD4ULL,
+    0x906A617D450187E2ULL, 0x27FB2B80668B24C5ULL,
+    0xB484F9DC9641E9DAULL, 0xB1F9F660802DEDF6ULL,
+    0xE1A63853BBD26451ULL, 0x5E7873F8A0396973ULL,
+    0x8D07E33455637EB2ULL, 0xDB0B487B6423E1E8ULL,
+    0xB049DC016ABC5E5FULL, 0x91CE1A9A3D2CDA62ULL,
+    0xDC5C5301C56B75F7ULL, 0x7641A140CC7810FBULL,
+    0x89B9B3E11B6329BAULL, 0xA9E904C87FCB0A9DULL,
+    0xAC2820D9623BF429ULL, 0x546345FA9FBDCD44ULL,
+    0xD732290FBACAF133ULL, 0xA97C177947AD4095ULL,
+    0x867F59A9D4BED6C0ULL, 0x49ED8EABCCCC485DULL,
+    0xA81F301449EE8C70ULL, 0x5C68F256BFFF5A74ULL,
+    0xD226FC195C6A2F8CULL, 0x73832EEC6FFF3111ULL,
+    0x83585D8FD9C25DB7ULL, 0xC831FD53C5FF7EABULL,
+    0xA42E74F3D032F525ULL, 0xBA3E7CA8B77F5E55ULL,
+    0xCD3A1230C43FB26FULL, 0x28CE1BD2E55F35EBULL,
+    0x80444B5E7AA7CF85ULL, 0x7980D163CF5B81B3ULL,
+    0xA0555E361951C366ULL, 0xD7E105BCC332621FULL,
+    0xC86AB5C39FA63440ULL, 0x8DD9472BF3FEFAA7ULL,
+    0xFA856334878FC150ULL, 0xB14F98F6F0FEB951ULL,
+    0x9C935E00D4B9D8D2ULL, 0x6ED1BF9A569F33D3ULL,
+    0xC3B8358109E84F07ULL, 0x0A862F80EC4700C8ULL,
+    0xF4A642E14C6262C8ULL, 0xCD27BB612758C0FAULL,
+    0x98E7E9CCCFBD7DBDULL, 0x8038D51CB897789CULL,
+    0xBF21E44003ACDD2CULL, 0xE0470A63E6BD56C3ULL,
+    0xEEEA5D5004981478ULL, 0x1858CCFCE06CAC74ULL,
+    0x95527A5202DF0CCBULL, 0x0F37801E0C43EBC8ULL,
+    0xBAA718E68396CFFDULL, 0xD30560258F54E6BAULL,
+    0xE950DF20247C83FDULL, 0x47C6B82EF32A2069ULL,
+    0x91D28B7416CDD27EULL, 0x4CDC331D57FA5441ULL,
+    0xB6472E511C81471DULL, 0xE0133FE4ADF8E952ULL,
+    0xE3D8F9E563A198E5ULL, 0x58180FDDD97723A6ULL,
+    0x8E679C2F5E44FF8FULL, 0x570F09EAA7EA7648ULL
+};
 
-            cargo_aappendf(&str, "%s\nCannot parse \"%s\" as %s for option \"%s\"\n",
-                    highlight, val, _cargo_type_to_str(opt->type), opt->name[0]);
+typedef struct cargo_float_format_s
+{
+    int mantissa_bits;          // Explicit bits in the mantissa.
+    int sign_bit;
+    int min_exponent;
+    int infinite_power;
+    int min_pow10;              // Anything smaller is 0.
+    int max_pow10;              // Anything larger is infinite.
+    int min_round_to_even;      // Range where a value can be exactly
+    int max_round_to_even;      // halfway between two floats.
+} cargo_float_format_t;
 
-            _cargo_xfree(&highlight);
-            _cargo_set_error(ctx, error);
-            return -1;
-        }
+static const cargo_float_format_t _cargo_double_format =
+    { 52, 63, -1023, 0x7FF, -342, 308, -4, 23 };
 
-        // Use validation function to verify target value.
-        if (opt->validation)
-        {
-            // Cast the current target index properly.
-            void *trg = NULL;
-
-            switch (opt->type)
-            {
-                case CARGO_BOOL:
-                case CARGO_INT:
-                    trg = (void *)&((int *)target)[opt->target_idx];
-                    break;
-                case CARGO_UINT:
-                    trg = (void *)&((unsigned int *)target)[opt->target_idx];
-                    break;
-                case CARGO_FLOAT:
-                    trg = (void *)&((float *)target)[opt->target_idx];
-                    break;
-                case CARGO_DOUBLE:
-                    trg = (void *)&((double *)target)[opt->target_idx];
-                    break;
-                case CARGO_LONGLONG:
-                    trg = (void *)&((long long int *)target)[opt->target_idx];
-                    break;
-                case CARGO_ULONGLONG:
-                    trg = (void *)&((unsigned long long int *)target)[opt->target_idx];
-                    break;
-                case CARGO_STRING:
-                    trg = (void *)((char **)target)[opt->target_idx];
-                    break;
-            }
-
-            if (_cargo_validate_option_value(ctx, opt, trg))
-            {
-                CARGODBG(1, "Failed to validate \"%s\" for \"%s\"\n", val, opt->name[0]);
-                highlight = _cargo_highlight_current_target_value(ctx);
-
-                // The validation can set an error. So use that.
-                if (ctx->error)
-                {
-                    cargo_aappendf(&str, "%s\n%s\n", highlight, ctx->error);
-                }
-                else
-                {
-                    cargo_aappendf(&str, "%s\nFailed to validate value for \"%s\"\n",
-                                    highlight, opt->name[0]);
-                }
+static const cargo_float_format_t _cargo_float_format =
+    { 23, 31, -127, 0xFF, -65, 38, -17, 10 };
 
-                _cargo_xfree(&highlight);
-                _cargo_set_error(ctx, error);
-                return -1;
-            }
-        }
-    }
+static void _cargo_mul_64(unsigned long long a, unsigned long long b,
+                          unsigned long long *hi, unsigned long long *lo)
+{
+    #if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (unsigned long long)(r >> 64);
+    *lo = (unsigned long long)r;
+    #else
+    unsigned long long a_lo = a & 0xFFFFFFFFULL;
+    unsigned long long a_hi = a >> 32;
+    unsigned long long b_lo = b & 0xFFFFFFFFULL;
+    unsigned long long b_hi = b >> 32;
+    unsigned long long p0 = a_lo * b_lo;
+    unsigned long long p1 = a_lo * b_hi;
+    unsigned long long p2 = a_hi * b_lo;
+    unsigned long long p3 = a_hi * b_hi;
+    unsigned long long mid = (p0 >> 32) + (p1 & 0xFFFFFFFFULL)
+                           + (p2 & 0xFFFFFFFFULL);
+    *lo = (mid << 32) | (p0 & 0xFFFFFFFFULL);
+    *hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+    #endif
+}
 
-    opt->target_idx++;
-    CARGODBG(3, "UPDATED TARGET INDEX: %lu\n", opt->target_idx);
+static int _cargo_clz_64(unsigned long long v)
+{
+    #if defined(__GNUC__)
+    return __builtin_clzll(v);
+    #else
+    int n = 0;
 
-    if (opt->target_count)
+    while (!(v & (1ULL << 63)))
     {
-        *opt->target_count = opt->target_idx;
+        v <<= 1;
+        n++;
     }
 
-    return 0;
+    return n;
+    #endif
 }
 
-static const char *_cargo_check_options(cargo_t ctx, cargo_opt_t **opt, char *arg)
+// floor(log2(10^q)) + 63
+static int _cargo_pow10_to_pow2(long q)
 {
-    size_t j;
-    const char *name = NULL;
-    assert(opt);
+    long v = (152170 + 65536) * q;
+    return (int)((v >= 0) ? (v >> 16) : -((-v + 65535) >> 16)) + 63;
+}
 
-    if (!_cargo_starts_with_prefix(ctx, arg))
-        return NULL;
+// Converts w * 10^q to the given format. Returns the biased exponent
+// and sets the mantissa, or -1 if the result could not be decided.
+static int _cargo_eisel_lemire(const cargo_float_format_t *f,
+                               long q, unsigned long long w,
+                               unsigned long long *mantissa)
+{
+    unsigned long long hi;
+    unsigned long long lo;
+    unsigned long long hi2;
+    unsigned long long lo2;
+    unsigned long long mask;
+    unsigned long long m;
+    size_t idx;
+    int lz;
+    int upperbit;
+    int shift;
+    int power2;
 
-    // Look for completely matching options first.
-    for (j = 0; j < ctx->opt_count; j++)
+    *mantissa = 0;
+
+    if ((w == 0) || (q < f->min_pow10))
+        return 0;
+
+    if (q > f->max_pow10)
+        return f->infinite_power;
+
+    lz = _cargo_clz_64(w);
+    w <<= lz;
+
+    // Only use the low half of 5^q if the precision we need depends on it.
+    idx = 2 * (size_t)(q - CARGO_POW5_MIN_EXP);
+    mask = 0xFFFFFFFFFFFFFFFFULL >> (f->mantissa_bits + 3);
+    _cargo_mul_64(w, _cargo_pow5_128[idx], &hi, &lo);
+
+    if ((hi & mask) == mask)
     {
-        name = NULL;
-        *opt = &ctx->options[j];
+        _cargo_mul_64(w, _cargo_pow5_128[idx + 1], &hi2, &lo2);
+        lo += hi2;
 
-        if ((name = _cargo_is_option_name(ctx, *opt, arg)))
-        {
-            return name;
-        }
+        if (hi2 > lo)
+            hi++;
     }
 
-    // Now look for the special case "-vvv" for bools.
-    for (j = 0; j < ctx->opt_count; j++)
+    if ((lo == 0xFFFFFFFFFFFFFFFFULL) && ((q < -27) || (q > 55)))
+        return -1;
+
+    upperbit = (int)(hi >> 63);
+    shift = upperbit + 64 - f->mantissa_bits - 3;
+    m = hi >> shift;
+    power2 = _cargo_pow10_to_pow2(q) + upperbit - lz - f->min_exponent;
+
+    // Subnormal.
+    if (power2 <= 0)
     {
-        name = NULL;
-        *opt = &ctx->options[j];
+        if ((-power2 + 1) >= 64)
+            return 0;
 
-        if ((name = _cargo_is_option_name_compact(ctx, *opt, arg)))
-        {
-            return name;
-        }
+        m >>= -power2 + 1;
+        m += (m & 1);
+        m >>= 1;
+        *mantissa = m & ((1ULL << f->mantissa_bits) - 1);
+
+        return (m < (1ULL << f->mantissa_bits)) ? 0 : 1;
     }
 
-    *opt = NULL;
+    // Exactly halfway between two floats, round to even.
+    if ((lo <= 1) && (q >= f->min_round_to_even)
+        && (q <= f->max_round_to_even) && ((m & 3) == 1)
+        && ((m << shift) == hi))
+    {
+        m &= ~1ULL;
+    }
 
-    return NULL;
-}
+    m += (m & 1);
+    m >>= 1;
 
-static int _cargo_is_another_option(cargo_t ctx, char *arg)
-{
-    cargo_opt_t *opt = NULL;
-    const char *name = _cargo_check_options(ctx, &opt, arg);
-    return (name != NULL);
+    if (m >= (2ULL << f->mantissa_bits))
+    {
+        m = (1ULL << f->mantissa_bits);
+        power2++;
+    }
+
+    m &= ~(1ULL << f->mantissa_bits);
+
+    if (power2 >= f->infinite_power)
+    {
+        power2 = f->infinite_power;
+        m = 0;
+    }
+
+    *mantissa = m;
+    return power2;
 }
 
-static int _cargo_check_if_already_parsed(cargo_t ctx,
-                                          cargo_opt_t *opt, const char *name)
+// Reads a decimal as w * 10^exp10, keeping the first 19 significant digits.
+static const char *_cargo_scan_decimal(const char *s, unsigned long long *w,
+                                       long *exp10, int *truncated)
 {
-    if (opt->parsed >= 0)
+    const char *p = s;
+    const char *e = NULL;
+    unsigned int d;
+    int digits = 0;
+    int any = 0;
+    long exp = 0;
+    int exp_neg = 0;
+
+    *w = 0;
+    *exp10 = 0;
+    *truncated = 0;
+
+    for (; (d = (unsigned int)(*p - '0')) <= 9; p++)
     {
-        cargo_astr_t str;
-        char *error = NULL;
-        char *s = NULL;
-        memset(&str, 0, sizeof(cargo_astr_t));
-        str.s = &error;
+        any = 1;
 
-        if ((opt->type == CARGO_BOOL)
-         && (opt->bool_count || opt->bool_acc))
-        {
-            // This is for parsing multiple arguments of the same type
-            // for instance -v -v -v.
-            // We need to reset the target index when doing this, otherwise
-            // we would be treating the target value for the bool option as an
-            // array since target_idx is incremented on each parse.
-            opt->target_idx = 0;
-        }
-        else if ((ctx->flags & CARGO_UNIQUE_OPTS)
-              || (opt->flags & CARGO_OPT_UNIQUE))
+        if ((*w == 0) && (d == 0))
+            continue;
+
+        if (digits < 19)
         {
-            CARGODBG(2, "%s: Parsing option as unique\n", name);
-            s = cargo_get_fprint_args(ctx->argc, ctx->argv, ctx->start,
-                            _cargo_get_cflag(ctx), ctx->max_width,
-                            2, // Number of highlights.
-                            opt->parsed, "^"CARGO_COLOR_GREEN,
-                            ctx->i, "~"CARGO_COLOR_RED);
-            cargo_aappendf(&str,
-                "%s\n Error: %s was already specified before.\n", s, name);
-            _cargo_xfree(&s);
-            _cargo_set_error(ctx, error);
-            return -1;
+            *w = (*w * 10) + d;
+            digits++;
         }
         else
         {
-            CARGODBG(2,
-                "%s: Parsing option that has already been parsed\n", name);
-            s = cargo_get_fprint_args(ctx->argc, ctx->argv, ctx->start,
-                            _cargo_get_cflag(ctx), ctx->max_width,
-                            2,
-                            opt->parsed, "^"CARGO_COLOR_DARK_GRAY,
-                            ctx->i, "~"CARGO_COLOR_YELLOW);
+            (*exp10)++;
+            *truncated |= (d != 0);
+        }
+    }
 
-            cargo_aappendf(&str, " Warning: %s was already specified before, "
-                            "the latter value will be used.\n", name);
+    if (*p == '.')
+    {
+        for (p++; (d = (unsigned int)(*p - '0')) <= 9; p++)
+        {
+            any = 1;
 
-            // TODO: Should we always do this?
-            // Say --abc takes a list of integers.
-            // --abc 1 2 3 ... or why not --abc 1 --def 5 --abc 2 3
-            // (probably a bad idea :D)
-            _cargo_cleanup_option_value(ctx, opt, 1);
-            _cargo_xfree(&s);
-            _cargo_set_error(ctx, error);
+            if ((*w == 0) && (d == 0))
+            {
+                (*exp10)--;
+            }
+            else if (digits < 19)
+            {
+                *w = (*w * 10) + d;
+                digits++;
+                (*exp10)--;
+            }
+            else
+            {
+                *truncated |= (d != 0);
+            }
         }
     }
-    else
+
+    if (!any)
+        return s;
+
+    // An exponent without any digits is not part of the number.
+    if ((*p == 'e') || (*p == 'E'))
     {
-        _cargo_cleanup_option_value(ctx, opt, 1);
+        e = p + 1;
+
+        if ((*e == '-') || (*e == '+'))
+        {
+            exp_neg = (*e == '-');
+            e++;
+        }
+
+        if ((unsigned int)(*e - '0') <= 9)
+        {
+            for (; (d = (unsigned int)(*e - '0')) <= 9; e++)
+            {
+                if (exp < 100000)
+                    exp = (exp * 10) + d;
+            }
+
+            *exp10 += exp_neg ? -exp : exp;
+            p = e;
+        }
     }
 
-    return 0;
+    return p;
 }
 
-static const char *_cargo_nargs_str(int nargs)
+// Returns the end of the number and sets the bits of the float in the
+// given format, or NULL if it has to be left to strtod.
+static const char *_cargo_parse_float_bits(const char *s,
+                                           const cargo_float_format_t *f,
+                                           unsigned long long *bits)
 {
-    static char s[32];
+    const char *p = _cargo_skip_space(s);
+    const char *end = NULL;
+    unsigned long long w = 0;
+    unsigned long long m = 0;
+    unsigned long long m2 = 0;
+    long exp10 = 0;
+    int truncated = 0;
+    int neg = 0;
+    int power2;
 
-    *s = '\0';
+    if ((*p == '-') || (*p == '+'))
+    {
+        neg = (*p == '-');
+        p++;
+    }
 
-    switch (nargs)
+    // Hex floats, inf and nan.
+    if ((p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X')))
+        return NULL;
+
+    if ((end = _cargo_scan_decimal(p, &w, &exp10, &truncated)) == p)
+        return NULL;
+
+    if ((power2 = _cargo_eisel_lemire(f, exp10, w, &m)) < 0)
+        return NULL;
+
+    // Digits were dropped, so the value is somewhere between
+    // w and w + 1. Only if both round the same it is known.
+    if (truncated
+        && ((_cargo_eisel_lemire(f, exp10, w + 1, &m2) != power2)
+         || (m2 != m)))
     {
-        case CARGO_NARGS_ZERO_OR_ONE: return "0 or 1";
-        case CARGO_NARGS_ONE_OR_MORE: return "1 or more";
-        case CARGO_NARGS_ZERO_OR_MORE: return "0 or more";
-        default: cargo_snprintf(s, sizeof(s), "%d", nargs); return s;
+        return NULL;
     }
+
+    *bits = m | ((unsigned long long)power2 << f->mantissa_bits)
+              | ((unsigned long long)neg << f->sign_bit);
+
+    return end;
 }
 
-static cargo_parse_result_t _cargo_parse_option(cargo_t ctx,
-                                cargo_opt_t *opt,
-                                const char *name,
-                                int argc, char **argv)
+// strtod and strtof but with '.' as the decimal point
+// regardless of the locale.
+static const char *_cargo_strtod_c(const char *s, double *d, float *f)
 {
-    int ret;
-    int args_to_look_for;
-    int start = opt->positional ? ctx->i : (ctx->i + 1);
-
-    CARGODBG(2, "------ Parse option %s ------\n", opt->name[0]);
-    CARGODBG(2, "argc: %d\n", argc);
-    CARGODBG(2, "i: %d\n", ctx->i);
-    CARGODBG(2, "start: %d\n", start);
-    CARGODBG(2, "parsed: %d\n", opt->parsed);
-    CARGODBG(2, "positional: %d\n", opt->positional);
+    char buf[128];
+    char *copy = buf;
+    char *p = NULL;
+    char *end = NULL;
+    size_t len = 0;
+    struct lconv *lc = localeconv();
+    char point = (lc && lc->decimal_point && lc->decimal_point[0])
+               ? lc->decimal_point[0] : '.';
 
-    if (!opt->positional
-        && _cargo_check_if_already_parsed(ctx, opt, name))
+    if (point == '.')
     {
-        return CARGO_PARSE_OPT_ALREADY_PARSED;
+        if (f) *f = strtof(s, &end);
+        else   *d = strtod(s, &end);
+        return end;
     }
 
-    // Keep looking until the end of the argument list.
-    if ((opt->nargs == CARGO_NARGS_ONE_OR_MORE) ||
-        (opt->nargs == CARGO_NARGS_ZERO_OR_MORE) ||
-        (opt->nargs == CARGO_NARGS_ZERO_OR_ONE))
-    {
-        args_to_look_for = (argc - start);
+    // Only copy what can be part of a number, so that a ',' after it
+    // (as in a delimited list) isn't read as the locale's decimal point.
+    len = strspn(s, " \t\n\v\f\r+-.0123456789"
+                    "abcdefABCDEFiInNtTyYxXpP()_");
 
-        switch (opt->nargs)
-        {
-            case CARGO_NARGS_ONE_OR_MORE:
-                args_to_look_for = CARGO_MAX(args_to_look_for, 1);
-                break;
-            case CARGO_NARGS_ZERO_OR_ONE:
-                args_to_look_for = CARGO_MIN(args_to_look_for, 1);
-                break;
-        }
-    }
-    else
+    if ((len >= sizeof(buf)) && !(copy = _cargo_malloc(NULL, len + 1)))
     {
-        // Read (number of expected arguments) - (read so far).
-        args_to_look_for = (opt->nargs - opt->target_idx);
+        return s;
     }
 
-    assert(args_to_look_for >= 0);
+    memcpy(copy, s, len);
+    copy[len] = '\0';
 
-    if (start + args_to_look_for >= ctx->argc)
+    if ((p = strchr(copy, '.')))
+        *p = point;
+
+    if (f) *f = strtof(copy, &end);
+    else   *d = strtod(copy, &end);
+
+    end = (char *)s + (end - copy);
+
+    if (copy != buf)
+        _cargo_free(NULL, copy);
+
+    return end;
+}
+
+static const char *_cargo_parse_double(const char *s, double *out)
+{
+    unsigned long long bits = 0;
+    const char *end = NULL;
+
+    if ((sizeof(double) == sizeof(bits))
+        && (end = _cargo_parse_float_bits(s, &_cargo_double_format, &bits)))
     {
-        args_to_look_for = ctx->argc - start;
+        memcpy(out, &bits, sizeof(*out));
+        return end;
     }
 
-    CARGODBG(3, "Looking for %d args\n", args_to_look_for);
-    CARGODBG(3, "Start %d, End %d (argc %d, nargs %d)\n",
-            start, (start + args_to_look_for), argc, opt->nargs);
+    return _cargo_strtod_c(s, out, NULL);
+}
 
-    ctx->j = start;
+static const char *_cargo_parse_float(const char *s, float *out)
+{
+    unsigned long long bits = 0;
+    unsigned int bits32 = 0;
+    const char *end = NULL;
 
-    if (opt->type == CARGO_BOOL)
+    if ((sizeof(float) == sizeof(bits32))
+        && (end = _cargo_parse_float_bits(s, &_cargo_float_format, &bits)))
     {
-        if ((ret = _cargo_set_target_value(ctx, opt, name, argv[ctx->j])) < 0)
-        {
-            CARGODBG(1, "Failed to set value for no argument option\n");
-            return CARGO_PARSE_FAIL_OPT;
-        }
+        bits32 = (unsigned int)bits;
+        memcpy(out, &bits32, sizeof(*out));
+        return end;
     }
-    else if (opt->nargs == CARGO_NARGS_ZERO_OR_ONE)
-    {
-        char *arg;
 
-        if ((args_to_look_for == 0)
-            || _cargo_is_another_option(ctx, argv[ctx->j]))
-        {
-            arg = opt->zero_or_one_default;
-        }
-        else
+    return _cargo_strtod_c(s, NULL, out);
+}
+
+// Makes room for at least "needed" values in an allocated target array.
+static int _cargo_alloc_target(cargo_t ctx, cargo_opt_t *opt, size_t needed)
+{
+    void *new_target;
+    size_t size = _cargo_get_value_size(opt);
+    size_t alloc_count = (size_t)opt->nargs;
+
+    if (!*(opt->target))
+    {
+        if (opt->nargs < 0)
         {
-            arg = argv[ctx->j];
+            // In this case we don't want to preallocate everything
+            // since we might have "unlimited" arguments.
+            // CARGO_NARGS_ONE_OR_MORE
+            // CARGO_NARGS_ZERO_OR_MORE
+            // Instead use the number of values counted ahead of
+            // this run, and grow the array if more show up later.
+            // Don't allocate more than necessary.
+            alloc_count = CARGO_MIN(needed, opt->max_target_count);
         }
 
-        if ((ret = _cargo_set_target_value(ctx,
-                        opt, name, arg) < 0))
+        if (!(new_target = _cargo_calloc(&ctx->mem, alloc_count, size)))
         {
-            CARGODBG(1, "Failed to set value for no argument option\n");
-            return CARGO_PARSE_FAIL_OPT;
+            CARGODBG(1, "Out of memory!\n");
+            return -1;
         }
-    }
-    else
-    {
-        // Read until we find another option, or we've "eaten" the
-        // arguments we want.
-        for (ctx->j = start; ctx->j < (start + args_to_look_for); ctx->j++)
-        {
-            CARGODBG(3, "    argv[%i]: %s\n", ctx->j, argv[ctx->j]);
 
-            if (_cargo_is_another_option(ctx, argv[ctx->j]))
-            {
-                // We found another option, stop parsing arguments
-                // for this option.
-                CARGODBG(3, "%s", "    Found other option\n");
-                break;
-            }
+        CARGODBG(3, "Allocated %lux %s!\n",
+                alloc_count, _cargo_type_to_str(opt->type));
 
-            if ((ret = _cargo_set_target_value(ctx, opt, name, argv[ctx->j])) < 0)
-            {
-                CARGODBG(1, "Failed to set target value for %s: \n", name);
-                return CARGO_PARSE_FAIL_OPT;
-            }
+        *(opt->target) = new_target;
+        opt->target_alloc_count = alloc_count;
+    }
+    else if ((opt->nargs < 0) && opt->target_alloc_count
+          && (needed > opt->target_alloc_count))
+    {
+        // The values didn't all fit in what was available when the
+        // array was allocated, such as for a streamed parse.
+        alloc_count = CARGO_MIN(CARGO_MAX(opt->target_alloc_count * 2, needed),
+                                opt->max_target_count);
 
-            // If we have exceeded opt->max_target_count
-            // for CARGO_NARGS_ZERO_OR_MORE or CARGO_NARGS_ONE_OR_MORE
-            // we should stop so we don't eat all the remaining arguments.
-            if (ret)
-                break;
+        if (!(new_target = _cargo_realloc(&ctx->mem, *(opt->target),
+                                          alloc_count * size)))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            return -1;
         }
+
+        memset((char *)new_target + opt->target_alloc_count * size, 0,
+               (alloc_count - opt->target_alloc_count) * size);
+        *(opt->target) = new_target;
+        opt->target_alloc_count = alloc_count;
     }
 
-    opt->parsed = ctx->i;
-    opt->first_parse = 0; // This is not reset between calls to cargo_parse
+    return 0;
+}
 
-    // Number of arguments eaten.
-    opt->num_eaten = (ctx->j - start);
-
-    CARGODBG(2, "_cargo_parse_option ate %d\n", opt->num_eaten);
-
-    // If we're parsing using a custom callback, pass it onto that.
-    if (opt->custom)
-    {
-        int custom_eaten = 0;
-
-        // Set the value of the return count for the caller as well:
-        // ... "[c]#", callback_func, &data, &data_count, DATA_COUNT);
-        //                                   ^^^^^^^^^^^
-        if (opt->custom_user_count)
-        {
-            CARGODBG(3, "Set custom user count: %lu\n", opt->custom_target_count);
-            *opt->custom_user_count = opt->custom_target_count;
-        }
-
-        custom_eaten = opt->custom(ctx, opt->custom_user, opt->name[0],
-                                    opt->custom_target_count, opt->custom_target);
-
-        if (custom_eaten < 0)
-        {
-            CARGODBG(1, "Custom callback indicated error\n");
-            return CARGO_PARSE_CALLBACK_ERR;
-        }
-
-        CARGODBG(2, "Custom call back ate: %d\n", custom_eaten);
-    }
-
-    if (opt->flags & CARGO_OPT_STOP)
+static void *_cargo_get_target_value(cargo_opt_t *opt, void *target, size_t i)
+{
+    switch (opt->type)
     {
-        ctx->stopped = ctx->j;
-        CARGODBG(2, "%s: Stopping parse (index %d)\n", opt->name[0], ctx->stopped);
-
-        if (opt->flags & CARGO_OPT_STOP_HARD)
-        {
-            ctx->stopped_hard = 1;
-            CARGODBG(2, "%s: Stopping HARD (Mutex groups won't be checked)\n", opt->name[0]);
-        }
+        case CARGO_EXTENSION:
+            return (void *)((char *)target + i * opt->ext.size);
+        case CARGO_BOOL:
+        case CARGO_INT:
+            return (void *)&((int *)target)[i];
+        case CARGO_UINT:
+            return (void *)&((unsigned int *)target)[i];
+        case CARGO_FLOAT:
+            return (void *)&((float *)target)[i];
+        case CARGO_DOUBLE:
+            return (void *)&((double *)target)[i];
+        case CARGO_LONGLONG:
+            return (void *)&((long long int *)target)[i];
+        case CARGO_ULONGLONG:
+            return (void *)&((unsigned long long int *)target)[i];
+        case CARGO_STRING:
+            return (void *)((char **)target)[i];
     }
 
-    return (opt->positional) ? opt->num_eaten : (opt->num_eaten + 1);
+    return NULL;
 }
 
-static int _cargo_compare_strlen(const void *a, const void *b)
+static int _cargo_nearly_equal(double a, double b, double epsilon)
 {
-    const char *as = *((const char **)a);
-    const char *bs = *((const char **)b);
-    size_t alen = strlen(as);
-    size_t blen = strlen(bs);
-    CARGODBG(4, "Compare length: %s (%lu) < %s (%lu) (%lu)\n",
-            as, alen, bs, blen, (alen - blen));
-    return (alen - blen);
+    double largest;
+    double diff = cargo_fabs(a - b);
+    a = (double)cargo_fabs(a);
+    b = (double)cargo_fabs(b);
+    largest = (b > a) ? b : a;
+
+    if (diff <= (largest * epsilon))
+        return 1;
+    return 0;
 }
 
-static int _cargo_generate_metavar(cargo_t ctx, cargo_opt_t *opt, cargo_astr_t *str)
+//
+// Returns the number of values in a row that are within the range of a
+// built-in range validation. The values are first checked in a single
+// pass without branches, so this vectorizes, and only when something
+// is out of range are they gone through again to find which one.
+//
+#define CARGO_RANGE_SCAN(ctype, member, outside)                \
+{                                                               \
+    const ctype *t = (const ctype *)values;                     \
+    const ctype lo = r->min.member;                             \
+    const ctype hi = r->max.member;                             \
+    int bad = 0;                                                \
+    for (k = 0; k < n; k++)                                     \
+        bad |= (t[k] < lo) | (t[k] > hi);                       \
+    if (!bad) return n;                                         \
+    for (k = 0; k < n; k++)                                     \
+        if (outside) return k;                                  \
+    return n;                                                   \
+}
+
+#define CARGO_OUTSIDE_INT_RANGE ((t[k] < lo) || (t[k] > hi))
+
+// Floats are allowed to be outside by the epsilon.
+#define CARGO_OUTSIDE_FLOAT_RANGE(member)                                   \
+    (((t[k] < lo) && !_cargo_nearly_equal(t[k], lo, r->epsilon.member))     \
+  || ((t[k] > hi) && !_cargo_nearly_equal(t[k], hi, r->epsilon.member)))
+
+static size_t _cargo_check_range(cargo_type_t type,
+                                 const cargo_range_validation_t *r,
+                                 const void *values, size_t n)
 {
-    int j = 0;
-    int i = 0;
-    char metavarname[20];
-    assert(ctx);
-    assert(opt);
+    size_t k;
 
-    if (opt->type == CARGO_BOOL)
+    switch (type)
     {
-        return 0;
+        case CARGO_INT:
+            CARGO_RANGE_SCAN(int, i, CARGO_OUTSIDE_INT_RANGE)
+        case CARGO_UINT:
+            CARGO_RANGE_SCAN(unsigned int, u, CARGO_OUTSIDE_INT_RANGE)
+        case CARGO_LONGLONG:
+            CARGO_RANGE_SCAN(long long int, ll, CARGO_OUTSIDE_INT_RANGE)
+        case CARGO_ULONGLONG:
+            CARGO_RANGE_SCAN(unsigned long long int, ull, CARGO_OUTSIDE_INT_RANGE)
+        case CARGO_FLOAT:
+            CARGO_RANGE_SCAN(float, f, CARGO_OUTSIDE_FLOAT_RANGE(f))
+        case CARGO_DOUBLE:
+            CARGO_RANGE_SCAN(double, d, CARGO_OUTSIDE_FLOAT_RANGE(d))
+        default:
+            break;
     }
 
-    while (_cargo_is_prefix(ctx, opt->name[0][i]))
-    {
-        i++;
-    }
+    return 0;
+}
 
-    while (opt->name[0][i] && (j < (sizeof(metavarname) - 1)))
-    {
-        metavarname[j++] = toupper(opt->name[0][i++]);
-    }
+#undef CARGO_RANGE_SCAN
+#undef CARGO_OUTSIDE_INT_RANGE
+#undef CARGO_OUTSIDE_FLOAT_RANGE
 
-    metavarname[j] = '\0';
+//
+// Validates n values of a target starting at first, and returns how many
+// of them are valid before the first one that isn't. The error is set
+// for that value by its validation.
+//
+static size_t _cargo_validate_target_values(cargo_t ctx, cargo_opt_t *opt,
+                                            void *target, size_t first,
+                                            size_t n)
+{
+    size_t k = 0;
 
-    if (opt->nargs < 0)
+    if (!opt->validation)
     {
-        // List the number of arguments.
-        if (cargo_aappendf(str, "%s [%s ...]", metavarname, metavarname) < 0)
-            return -1;
+        return n;
     }
-    else if (opt->nargs > 0)
+
+    if (opt->range)
     {
-        if (cargo_aappendf(str, "%s", metavarname) < 0) return -1;
+        k = _cargo_check_range(opt->type, opt->range,
+                    _cargo_get_target_value(opt, target, first), n);
 
-        for (i = 1; (int)i < opt->nargs; i++)
+        if (k < n)
         {
-            if (cargo_aappendf(str, " %s", metavarname) < 0) return -1;
+            _cargo_validate_option_value(ctx, opt,
+                    _cargo_get_target_value(opt, target, first + k));
         }
+
+        return k;
     }
-    else
+
+    for (k = 0; k < n; k++)
     {
-        if (cargo_aappendf(str, "%s", metavarname) < 0) return -1;
+        if (_cargo_validate_option_value(ctx, opt,
+                    _cargo_get_target_value(opt, target, first + k)))
+        {
+            break;
+        }
     }
 
-    return 0;
+    return k;
 }
 
-static int _cargo_get_option_name_str(cargo_t ctx, cargo_opt_t *opt,
-    char *namebuf, size_t buf_size)
+// Sets the error for the value at ctx->j that failed
+// to parse, or failed validation if it was parsed.
+static int _cargo_target_value_error(cargo_t ctx, cargo_opt_t *opt,
+                                     const char *val, int parsed)
 {
-    int ret = -1;
-    size_t i;
-    char **sorted_names = NULL;
     cargo_astr_t str;
-    char *opt_name = NULL;
-    assert(ctx);
-    assert(opt);
-
-    namebuf[0] = '\0';
-
-    memset(&str, 0, sizeof(str));
-    str.s = &opt_name;
-
-    CARGODBG(3, "%s: Sorting %lu option names:\n", opt->name[0], opt->name_count);
+    char *error = NULL;
+    char *highlight = NULL;
+    memset(&str, 0, sizeof(cargo_astr_t));
+    str.s = &error;
+    str.arena = &ctx->arena;
 
-    // Sort the names by length.
+    if (!parsed)
     {
-        if (!(sorted_names = _cargo_calloc(opt->name_count, sizeof(char *))))
-        {
-            CARGODBG(1, "%s", "Out of memory\n");
-            return -1;
-        }
-
-        for (i = 0; i < opt->name_count; i++)
-        {
-            if (!(sorted_names[i] = _cargo_strdup(opt->name[i])))
-            {
-                ret = -1; goto fail;
-            }
-        }
-
-        qsort(sorted_names, opt->name_count,
-            sizeof(char *), _cargo_compare_strlen);
-    }
+        CARGODBG(1, "Cannot parse \"%s\" as %s\n",
+                val, _cargo_get_value_type_str(opt));
 
-    // Print the option names.
-    for (i = 0; i < opt->name_count; i++)
-    {
-        if (opt->positional)
-            continue;
+        highlight = _cargo_highlight_current_target_value(ctx);
 
-        if (cargo_aappendf(&str, "%s%s",
-            sorted_names[i],
-            (i + 1 != opt->name_count) ? ", " : "") < 0)
-        {
-            goto fail;
-        }
+        cargo_aappendf(&str, "%s\nCannot parse \"%s\" as %s for option \"%s\"\n",
+                highlight, val, _cargo_get_value_type_str(opt), opt->name[0]);
     }
-
-    // If the option has an argument, add a "metavar".
-    if ((opt->nargs != 0) || opt->positional)
+    else
     {
-        char *metavar = NULL;
+        CARGODBG(1, "Failed to validate \"%s\" for \"%s\"\n", val, opt->name[0]);
+        highlight = _cargo_highlight_current_target_value(ctx);
 
-        if (opt->metavar)
+        // The validation can set an error. So use that.
+        if (_cargo_render_error(ctx))
         {
-            metavar = _cargo_strdup(opt->metavar);
+            cargo_aappendf(&str, "%s\n%s\n", highlight, ctx->error);
         }
         else
         {
-            cargo_astr_t metavar_str;
-            memset(&metavar_str, 0, sizeof(metavar_str));
-            metavar_str.s = &metavar;
-
-            if (_cargo_generate_metavar(ctx, opt, &metavar_str))
-            {
-                CARGODBG(1, "Failed to generate metavar for %s\n", opt->name[0]);
-                _cargo_xfree(&metavar);
-                metavar = _cargo_strdup(opt->name[0]);
-            }
+            cargo_aappendf(&str, "%s\nFailed to validate value for \"%s\"\n",
+                            highlight, opt->name[0]);
         }
-
-        cargo_aappendf(&str, " %s", metavar);
-        _cargo_xfree(&metavar);
     }
 
-    strncpy(namebuf, opt_name, buf_size);
-    ret = strlen(namebuf);
-
-fail:
-    i = opt->name_count;
-    _cargo_free_str_list(&sorted_names, &i);
-    _cargo_xfree(&opt_name);
-    return ret;
+    _cargo_set_error(ctx, error);
+    return -1;
 }
 
-static char **_cargo_split(const char *s, const char *splitchars, size_t *count)
+// Choices maps from cargo_validate_choices_map, see below.
+static const int *_cargo_get_choice_map(cargo_opt_t *opt);
+static int _cargo_map_choice(cargo_t ctx, cargo_opt_t *opt,
+                             const char *val, int *out);
+
+static int _cargo_set_target_value(cargo_t ctx, cargo_opt_t *opt,
+                                    const char *name, char *val)
 {
-    char **ss;
-    size_t i = 0;
-    char *p = NULL;
-    char *scpy = NULL;
+    void *target;
     char *end = NULL;
-    size_t splitlen = strlen(splitchars);
-    assert(count);
+    assert(ctx);
+    assert((opt->type >= CARGO_BOOL) && (opt->type <= CARGO_EXTENSION));
 
-    *count = 0;
+    if ((opt->type != CARGO_BOOL)
+        && (opt->target_idx >= opt->max_target_count))
+    {
+        CARGODBG(1, "Target index out of bounds (%lu > max %lu)\n",
+                opt->target_idx, opt->max_target_count);
+        return 1;
+    }
 
-    if (!s)
-        return NULL;
+    CARGODBG(2, "_cargo_set_target_value:\n");
+    CARGODBG(2, "  alloc: %d\n", opt->alloc);
+    CARGODBG(2, "  nargs: %d\n", opt->nargs);
 
-    if (!*s)
-        return NULL;
+    // If number of arguments is just 1 don't allocate an array
+    // (Except for custom callback, then we always use an array
+    //  since we store the arguments internally).
+    if (opt->custom || (opt->alloc && (opt->nargs != 1)))
+    {
+        // Allocate the memory needed.
+        if (_cargo_alloc_target(ctx, opt,
+                CARGO_MAX(opt->target_alloc_hint, opt->target_idx + 1)))
+        {
+            return -1;
+        }
 
-    if (!(scpy = _cargo_strdup(s)))
-        return NULL;
+        target = *(opt->target);
+    }
+    else if (opt->str_alloc_items)
+    {
+        CARGODBG(3, "Static list size %lu of allocated strings\n",
+                    opt->max_target_count);
 
-    p = scpy;
-    end = scpy + strlen(scpy);
-    p += strspn(p, splitchars);
+        target = (void *)opt->target;
+    }
+    else
+    {
+        // Just a normal pointer.
+        CARGODBG(3, "Not allocating array or single %s\n",
+                _cargo_type_to_str(opt->type));
 
-    *count = 1;
+        target = (void *)opt->target;
+    }
 
-    while (*p)
+    switch (opt->type)
     {
-        // If the string ends in just splitchars
-        // don't count the last empty string.
-        if ((p + strspn(p, splitchars)) >= end)
+        case CARGO_BOOL:
         {
-            break;
-        }
+            int *val = &((int *)target)[opt->target_idx];
+            CARGODBG(2, "      bool\n");
 
-        // Look for a split character.
-        for (i = 0; i < splitlen; i++)
-        {
-            if (*p == splitchars[i])
+            // A bit target works on a plain bool value that starts out
+            // as the bit, and then sets the bit from it.
+            if (opt->bit_mask)
             {
-                (*count)++;
-                break;
-            }
-        }
-
-        // Consume all duplicates so we don't get
-        // a bunch of empty strings.
-        p += strspn(p, splitchars) + 1;
-    }
-
-    if (!(ss = _cargo_calloc(*count, sizeof(char *))))
-        goto fail;
+                val = &opt->bit_value;
 
-    p = strtok(scpy, splitchars);
-    i = 0;
+                if (!opt->bit_loaded)
+                {
+                    opt->bit_value = !!(*(unsigned long long *)target & opt->bit_mask);
+                    opt->bit_loaded = 1;
+                }
+            }
 
-    while (p && (i < (*count)))
-    {
-        p += strspn(p, splitchars);
+            // If BOOL COUNT is turned on, we allow multiple occurances of
+            // a bool option. "-v -v -v" will be parsed as 3.
+            // (Bundled flags "-vvv" are split up by the parse loop, so
+            //  this is called once per flag).
+            if (opt->bool_count)
+            {
+                CARGODBG(2, "        bool count enabled\n");
+                (*val)++;
+            }
+            else if (opt->bool_acc)
+            {
+                int acc_val;
+                size_t i = opt->bool_acc_count;
+                CARGODBG(2, "           ARG: %s\n", ctx->argv[ctx->i]);
 
-        if (!(ss[i] = _cargo_strdup(p)))
-        {
-            goto fail;
-        }
+                if (i < opt->bool_acc_max_count)
+                {
+                    acc_val = opt->bool_acc[i];
 
-        p = strtok(NULL, splitchars);
-        i++;
-    }
+                    CARGODBG(2, "       %lu Bool acc %x\n", i, acc_val);
+                    switch (opt->bool_acc_op)
+                    {
+                        case CARGO_BOOL_OP_OR:
+                        {
+                            CARGODBG(2, "       OR\n");
+                            *val |= acc_val;
+                            break;
+                        }
+                        case CARGO_BOOL_OP_AND:
+                        {
+                            CARGODBG(2, "       AND\n");
+                            *val &= acc_val;
+                            break;
+                        }
+                        case CARGO_BOOL_OP_PLUS:
+                        {
+                            CARGODBG(2, "       PLUS\n");
+                            *val += acc_val;
+                            break;
+                        }
+                        case CARGO_BOOL_OP_STORE:
+                        {
+                            CARGODBG(2, "       STORE\n");
+                            *val = acc_val;
+                            break;
+                        }
+                        default:
+                        {
+                            CARGODBG(1, "Got unknown operation\n");
+                            break;
+                        }
+                    }
 
-    // The count and number of strings must match.
-    assert(i == *count);
+                    i++;
+                }
 
-    _cargo_free(scpy);
+                opt->bool_acc_count = i;
 
-    return ss;
-fail:
-    _cargo_xfree(&scpy);
-    _cargo_free_str_list(&ss, count);
-    return NULL;
-}
+                if (opt->bool_acc_count >= opt->bool_acc_max_count)
+                {
+                    CARGODBG(2, "       Bool acc reached maxcount %lu\n",
+                            opt->bool_acc_max_count);
+                }
+            }
+            else
+            {
+                CARGODBG(2, "       No bool count\n");
+                *val = opt->bool_store;
+            }
 
-static char *_cargo_linebreak(cargo_t ctx, const char *str, size_t width)
-{
-    char *s = _cargo_strdup(str);
-    char *start = s;
-    char *prev = s;
-    char *p = s;
+            if (opt->bit_mask)
+            {
+                if (*val)
+                    *(unsigned long long *)target |= opt->bit_mask;
+                else
+                    *(unsigned long long *)target &= ~opt->bit_mask;
+            }
+            break;
+        }
+        case CARGO_INT:
+        {
+            long long v = 0;
+            CARGODBG(2, "      int %s\n", val);
 
-    if (!s)
-        return NULL;
+            // The value is looked up by name in a choices map,
+            // which also validates it.
+            if (_cargo_get_choice_map(opt))
+            {
+                if (_cargo_map_choice(ctx, opt, val,
+                        &((int *)target)[opt->target_idx]))
+                {
+                    return _cargo_target_value_error(ctx, opt, val, 1);
+                }
 
-    p = strpbrk(p, " \n");
-    while (p != NULL)
-    {
-        CARGODBG(6, "(p - start) = %ld: %.*s\n",
-            (p - start), (int)(p - start), start);
+                break;
+            }
 
-        // Restart on already existing explicit line breaks.
-        if (*p == '\n')
+            end = (char *)_cargo_parse_longlong(val, INT_MIN, INT_MAX, &v);
+            ((int *)target)[opt->target_idx] = (int)v;
+            break;
+        }
+        case CARGO_UINT:
         {
-            CARGODBG(5, "EXISTING NEW LINE len %ld:\n%.*s\n\n",
-                (p - start), (int)(p - start), start);
-            start = p;
+            unsigned long long v = 0;
+            CARGODBG(2, "      uint %s\n", val);
+            end = (char *)_cargo_parse_ulonglong(val, UINT_MAX, &v);
+            ((unsigned int *)target)[opt->target_idx] = (unsigned int)v;
+            break;
         }
-        else if ((size_t)(p - start) > width)
+        case CARGO_LONGLONG:
         {
-            // We found a word that goes beyond the width we're
-            // aiming for, so add the line break before that word.
-            *prev = '\n';
-            CARGODBG(5, "ADD NEW LINE len %ld:\n%.*s\n\n",
-                (prev - start), (int)(prev - start), start);
-            start = prev;
-            continue;
+            long long v = 0;
+            CARGODBG(2, "      long long %s\n", val);
+            end = (char *)_cargo_parse_longlong(val, LLONG_MIN, LLONG_MAX, &v);
+            ((long long int *)target)[opt->target_idx] = v;
+            break;
         }
-
-        prev = p;
-        p = strpbrk(p + 1, " \n");
-
-        CARGODBG(5, "\n");
-    }
-
-    // Make sure the last line is also within "width".
-    p = strrchr(s, '\n');
-    if (!p) p = s;
-
-    if ((size_t)((s + strlen(s)) - p) > width)
-    {
-        *prev = '\n';
-    }
-
-    return s;
-}
-
-static void _cargo_add_help_if_missing(cargo_t ctx)
-{
-    assert(ctx);
-
-    if (!(ctx->flags & CARGO_NO_AUTOHELP)
-        && _cargo_find_option_name(ctx, "--help", NULL, NULL))
-    {
-        if (cargo_add_option(ctx, 0, "--help", "Show this help", "b", &ctx->help))
+        case CARGO_ULONGLONG:
         {
-            CARGODBG(1, "Failed to add --help\n");
-            return;
+            unsigned long long v = 0;
+            CARGODBG(2, "      unsigned long long %s\n", val);
+            end = (char *)_cargo_parse_ulonglong(val, ULLONG_MAX, &v);
+            ((unsigned long long int *)target)[opt->target_idx] = v;
+            break;
         }
-
-        if (_cargo_find_option_name(ctx, "-h", NULL, NULL))
+        case CARGO_FLOAT:
         {
-            cargo_add_alias(ctx, "--help", "-h");
+            float v = 0;
+            CARGODBG(2, "      float %s\n", val);
+            end = (char *)_cargo_parse_float(val, &v);
+            ((float *)target)[opt->target_idx] = v;
+            break;
         }
-    }
-}
+        case CARGO_DOUBLE:
+        {
+            double v = 0;
+            CARGODBG(2, "      double %s\n", val);
+            end = (char *)_cargo_parse_double(val, &v);
+            ((double *)target)[opt->target_idx] = v;
+            break;
+        }
+        case CARGO_EXTENSION:
+        {
+            // Parsed straight into the value, without a copy of the string.
+            CARGODBG(2, "      %s %s\n", opt->ext.name, val);
+            if (!opt->ext.parse(ctx, opt->ext.user, name, val,
+                    _cargo_get_target_value(opt, target, opt->target_idx)))
+            {
+                end = val + strlen(val);
+            }
+            else
+            {
+                end = val;
+            }
+            break;
+        }
+        case CARGO_STRING:
+            CARGODBG(2, "      string \"%s\"\n", val);
 
-static int _cargo_damerau_levensthein_dist(const char *s, const char *t)
-{
-    #define d(i, j) dd[(i) * (m + 2) + (j) ]
-    #define min(x, y) ((x) < (y) ? (x) : (y))
-    #define min3(a, b, c) ((a) < (b) ? min((a), (c)) : min((b), (c)))
-    #define min4(a, b, c, d) ((a) < (b) ? min3((a), (c), (d)) : min3((b), (c),(d)))
+            // A streamed parse frees the arguments as it goes, and a
+            // batch reuses its line buffer, so those are always copied.
+            opt->str_borrowed = opt->str_borrow
+                             && !ctx->streaming && !ctx->batching;
 
-    int *dd;
-    int DA[256];
-    int i;
-    int j;
-    int cost;
-    int i1;
-    int j1;
-    int DB;
-    int n = (int)strlen(s);
-    int m = (int)strlen(t);
-    int max_dist = n + m;
+            if (opt->str_borrowed)
+            {
+                CARGODBG(2, "       BORROWED STRING\n");
+                ((char **)target)[opt->target_idx] = val;
+            }
+            else if (opt->alloc)
+            {
+                CARGODBG(2, "       ALLOCATED STRING\n");
+                if (opt->lenstr == 0)
+                {
+                    //char **t = (char **)((char *)target + opt->target_idx * sizeof(char *));
+                    CARGODBG(2, "          COPY FULL STRING\n");
 
-    if (!(dd = (int *)_cargo_malloc((n + 2) * (m + 2) * sizeof(int))))
-    {
-        return -1;
+                    if (!(((char **)target)[opt->target_idx]
+                            = _cargo_strdup(&ctx->mem, val)))
+                    {
+                        return -1;
+                    }
+                }
+                else
+                {
+                    CARGODBG(2, "          MAX LENGTH: %lu\n", opt->lenstr);
+                    if (!(((char **)target)[opt->target_idx]
+                            = _cargo_strndup(&ctx->mem, val, opt->lenstr)))
+                    {
+                        return -1;
+                    }
+                }
+            }
+            else if (opt->str_alloc_items)
+            {
+                // Special case for static lists of allocated strings:
+                //  char *strs[5];
+                CARGODBG(2, "          COPY FULL STRING INTO STATIC LIST\n");
+                if (!(((char **)target)[opt->target_idx]
+                        = _cargo_strdup(&ctx->mem, val)))
+                {
+                    return -1;
+                }
+            }
+            else // static string.
+            {
+                char *t = (char *)((char *)target + opt->target_idx * opt->lenstr);
+                CARGODBG(2, "       STATIC STRING, bufsize = %lu\n", opt->lenstr);
+                strncpy(t, val, opt->lenstr);
+                CARGODBG(2, "       \"%s\"\n", t);
+            }
+            break;
     }
 
-    memset(DA, 0, sizeof(DA));
-
-    d(0, 0) = max_dist;
-
-    for (i = 0; i < (n + 1); i++)
+    // This indicates error for the strtox functions.
+    // (Don't include bool here, since val will be NULL in that case).
+    if ((opt->type != CARGO_BOOL) && (end == val))
     {
-        d(i + 1, 1) = i;
-        d(i + 1, 0) = max_dist;
+        return _cargo_target_value_error(ctx, opt, val, 0);
     }
 
-    for (j = 0; j < (m + 1); j++)
+    // Use validation function to verify target value.
+    if (opt->validation && !_cargo_get_choice_map(opt)
+        && !_cargo_validate_target_values(ctx, opt, target,
+                                          opt->target_idx, 1))
     {
-        d(1, j + 1) = j;
-        d(0, j + 1) = max_dist;
+        return _cargo_target_value_error(ctx, opt, val, 1);
     }
 
-    for (i = 1; i < (n + 1); i++)
-    {
-        DB = 0;
-
-        for(j = 1; j < (m + 1); j++)
-        {
-            i1 = DA[(int)t[j - 1]];
-            j1 = DB;
-            cost = ((s[ i - 1] == t[j - 1]) ? 0 : 1);
-
-            if (cost == 0)
-                DB = j;
-
-            d(i + 1, j + 1) = min4(d(i, j) + cost,
-                              d(i + 1, j) + 1,
-                              d(i, j + 1) + 1,
-                              d(i1, j1) + (i - i1 - 1) + 1 + (j - j1 - 1));
-        }
+    opt->target_idx++;
+    CARGODBG(3, "UPDATED TARGET INDEX: %lu\n", opt->target_idx);
 
-        DA[(int)s[i - 1]] = i;
+    if (opt->target_count)
+    {
+        *opt->target_count = opt->target_idx;
     }
 
-    cost = d(n + 1, m + 1);
-    _cargo_free(dd);
-    return cost;
-
-    #undef d
+    return 0;
 }
 
-const char *_cargo_find_closest_opt(cargo_t ctx, const char *unknown)
+static int _cargo_can_convert_run(cargo_opt_t *opt)
 {
-    size_t i;
-    size_t j;
-    size_t maxi = 0;
-    size_t maxj = 0;
-    int min_dist = INT_MAX;
-    int dist = 0;
-    char *name = NULL;
+    return (opt->nargs < 0) && opt->alloc && !opt->custom && !opt->delimiter
+        && (opt->type != CARGO_BOOL) && (opt->type != CARGO_STRING)
+        && (opt->type != CARGO_EXTENSION) && !_cargo_get_choice_map(opt);
+}
 
-    unknown += strspn(unknown, ctx->prefix);
+//
+// Converts a whole run of values for a numeric list at once, instead
+// of going through _cargo_set_target_value for each of them. The run
+// has already been counted, so it contains no options. Behaves the same
+// as the per value path, including which value an error is reported for.
+//
+#define CARGO_CONVERT_RUN(ctype, vtype, parse)                  \
+{                                                               \
+    ctype *t = (ctype *)target;                                 \
+    vtype v;                                                    \
+    for (k = 0; k < n; k++)                                     \
+    {                                                           \
+        const char *val = argv[k];                              \
+        if ((parse) == val) break;                              \
+        t[k] = (ctype)v;                                        \
+    }                                                           \
+    break;                                                      \
+}
 
-    for (i = 0; i < ctx->opt_count; i++)
+// Returns the number of values converted before one failed to parse.
+static size_t _cargo_convert_values(cargo_type_t type, void *target,
+                                    char **argv, size_t n)
+{
+    size_t k = 0;
+
+    switch (type)
     {
-        for (j = 0; j < ctx->options[i].name_count; j++)
-        {
-            name = ctx->options[i].name[j];
-            name += strspn(name, ctx->prefix);
-
-            dist = _cargo_damerau_levensthein_dist(unknown, name);
-
-            if (dist < min_dist)
-            {
-                min_dist = dist;
-                maxi = i;
-                maxj = j;
-            }
-        }
+        case CARGO_INT:
+            CARGO_CONVERT_RUN(int, long long,
+                _cargo_parse_longlong(val, INT_MIN, INT_MAX, &v))
+        case CARGO_UINT:
+            CARGO_CONVERT_RUN(unsigned int, unsigned long long,
+                _cargo_parse_ulonglong(val, UINT_MAX, &v))
+        case CARGO_LONGLONG:
+            CARGO_CONVERT_RUN(long long int, long long,
+                _cargo_parse_longlong(val, LLONG_MIN, LLONG_MAX, &v))
+        case CARGO_ULONGLONG:
+            CARGO_CONVERT_RUN(unsigned long long int, unsigned long long,
+                _cargo_parse_ulonglong(val, ULLONG_MAX, &v))
+        case CARGO_FLOAT:
+            CARGO_CONVERT_RUN(float, float, _cargo_parse_float(val, &v))
+        case CARGO_DOUBLE:
+            CARGO_CONVERT_RUN(double, double, _cargo_parse_double(val, &v))
+        default:
+            assert(0);
+            break;
     }
 
-    return (min_dist <= 1) ? ctx->options[maxi].name[maxj] : NULL;
+    return k;
 }
 
-static int _cargo_fit_optnames_and_description(cargo_t ctx, cargo_astr_t *str,
-                size_t i, int name_padding, int option_causes_newline, int max_name_len)
-{
-    size_t j;
-    cargo_opt_t *opt = NULL;
-    int ret = -1;
-    assert(str);
-    assert(ctx);
-
-    char **desc_lines = NULL;
-    size_t line_count = 0;
+#undef CARGO_CONVERT_RUN
 
-    int padding = 0;
+#ifndef CARGO_NO_THREADS
 
-    // We want to fit the opt names + description within max_width
-    // We already know the width of the opt names (max_name_len)
-    // so calculate how wide the description is allowed to be
-    // including any spaces and padding between them.
-    size_t max_desc_len =
-        ctx->max_width  // Total width of names + description.
-        - 2             // 2 for spaces before/after opt " --opt ".
-        - max_name_len  // The longest of the opt names.
-        - name_padding; // Padding.
+typedef struct cargo_convert_chunk_s
+{
+    cargo_type_t type;
+    void *target;       // First value of the chunk in the target array.
+    char **argv;        // First argument of the chunk.
+    size_t count;
+    size_t converted;   // Values converted before one failed.
+} cargo_convert_chunk_t;
 
-    char *opt_description = NULL;
+#ifdef _WIN32
+static DWORD WINAPI _cargo_convert_thread(LPVOID arg)
+#else
+static void *_cargo_convert_thread(void *arg)
+#endif
+{
+    cargo_convert_chunk_t *c = (cargo_convert_chunk_t *)arg;
+    c->converted = _cargo_convert_values(c->type, c->target, c->argv, c->count);
+    return 0;
+}
 
-    CARGODBG(2, "max_desc_len = %lu\n", max_desc_len);
-    CARGODBG(2, "str.l = %lu\n", str->l);
-    CARGODBG(2, "str.offset = %lu\n", str->offset);
-    opt = &ctx->options[i];
+//
+// Splits the conversion of a large run into chunks that are converted
+// in parallel, straight into the target array. The first chunk is done
+// on the calling thread, and a chunk whose thread can't be started is
+// as well. Returns the same as _cargo_convert_values would.
+//
+static size_t _cargo_convert_values_parallel(cargo_type_t type, void *target,
+                                             char **argv, size_t n)
+{
+    size_t i;
+    size_t offset = 0;
+    size_t size = _cargo_get_type_size(type);
+    size_t chunk_size = (n + CARGO_CONVERT_THREADS - 1) / CARGO_CONVERT_THREADS;
+    cargo_convert_chunk_t chunks[CARGO_CONVERT_THREADS];
+    int started[CARGO_CONVERT_THREADS];
+    #ifdef _WIN32
+    HANDLE threads[CARGO_CONVERT_THREADS];
+    #else
+    pthread_t threads[CARGO_CONVERT_THREADS];
+    #endif
 
-    // No description for option.
-    if (!opt->description)
+    for (i = 0; i < CARGO_CONVERT_THREADS; i++)
     {
-        cargo_aappendf(str, "\n");
-        return 0;
-    }
-
-    opt_description = _cargo_linebreak(ctx, opt->description,
-                                            max_desc_len);
+        chunks[i].type = type;
+        chunks[i].target = (char *)target + offset * size;
+        chunks[i].argv = argv + offset;
+        chunks[i].count = CARGO_MIN(chunk_size, n - offset);
+        chunks[i].converted = 0;
+        offset += chunks[i].count;
+        started[i] = 0;
 
-    if (!opt_description)
-    {
-        CARGODBG(1, "%s: Failed to line break option description\n", opt->name[0]);
-        goto fail;
-    }
+        if ((i == 0) || (chunks[i].count == 0))
+            continue;
 
-    CARGODBG(5, "ctx->max_width - 2 - max_name_len - (2 * NAME_PADDING) =\n");
-    CARGODBG(5, "%lu - 2 - %d - (2 * %d) = %lu\n",
-        ctx->max_width, max_name_len,
-        name_padding,
-        max_desc_len);
+        #ifdef _WIN32
+        started[i] = ((threads[i] = CreateThread(NULL, 0,
+                            _cargo_convert_thread, &chunks[i], 0, NULL)) != NULL);
+        #else
+        started[i] = !pthread_create(&threads[i], NULL,
+                            _cargo_convert_thread, &chunks[i]);
+        #endif
 
-    if (!(desc_lines = _cargo_split(opt_description, "\n", &line_count)))
-    {
-        CARGODBG(1, "Failed to split option description\n");
-        goto fail;
+        if (!started[i])
+        {
+            CARGODBG(2, "Failed to start conversion thread %lu\n", i);
+        }
     }
 
-    for (j = 0; j < line_count; j++)
+    for (i = 0; i < CARGO_CONVERT_THREADS; i++)
     {
-        if ((j == 0) && !option_causes_newline)
+        if (started[i])
         {
-            // --theoption  Description <- First line of description.
-            padding = 0;
+            #ifdef _WIN32
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+            #else
+            pthread_join(threads[i], NULL);
+            #endif
         }
         else
         {
-            // --theoption  Description
-            //              continues here <- Now we want pre-padding.
-            // ---------------------------------------------------------
-            // --reallyreallyreallyreallylongoption
-            //              Description    <- First line but pad anyway.
-            //              continues here
-            padding = max_name_len + name_padding;
+            _cargo_convert_thread(&chunks[i]);
         }
+    }
 
-        if (cargo_aappendf(str, "  %*s%s\n",
-            padding, "", desc_lines[j]) < 0)
+    // The first chunk that stopped early has the first failing value.
+    for (i = 0, offset = 0; i < CARGO_CONVERT_THREADS; i++)
+    {
+        if (chunks[i].converted < chunks[i].count)
         {
-            CARGODBG(1, "Failed to append\n");
-            goto fail;
+            return offset + chunks[i].converted;
         }
-    }
 
-    ret = 0;
-fail:
-    _cargo_xfree(&opt_description);
-    _cargo_free_str_list(&desc_lines, &line_count);
+        offset += chunks[i].count;
+    }
 
-    return ret;
+    return n;
 }
 
-static int _cargo_mutex_group_should_be_grouped(cargo_t ctx,
-            cargo_opt_t *opt, int short_usage)
+#endif // CARGO_NO_THREADS
+
+static int _cargo_set_target_values(cargo_t ctx, cargo_opt_t *opt,
+                                    const char *name, char **argv,
+                                    int start, int count)
 {
-    cargo_group_t *mgrp = NULL;
-    size_t i;
-    assert(opt);
+    int ret = 0;
+    size_t k = 0;
+    size_t n = (size_t)count;
+    size_t first = opt->target_idx;
+    size_t size = _cargo_get_type_size(opt->type);
+    void *target;
+    assert(_cargo_can_convert_run(opt));
+    (void)name; // Only used for debug output.
 
-    for (i = 0; i < opt->mutex_group_count; i++)
+    // Stop at the max count and leave the rest of the run.
+    if (first >= opt->max_target_count)
     {
-        assert(opt->mutex_group_idxs[i] < ctx->mutex_group_count);
-        mgrp = &ctx->mutex_groups[opt->mutex_group_idxs[i]];
+        n = 0;
+        ret = (count > 0);
+    }
+    else if (n > (opt->max_target_count - first))
+    {
+        n = opt->max_target_count - first;
+        ret = 1;
+    }
 
-        if (mgrp->flags & (CARGO_MUTEXGRP_ORDER_BEFORE | CARGO_MUTEXGRP_ORDER_AFTER))
-            continue;
+    ctx->j = start;
 
-        if (short_usage)
-        {
-            if (!(mgrp->flags & CARGO_MUTEXGRP_NO_GROUP_SHORT_USAGE))
-            {
-                return 1;
-            }
-        }
-        else
-        {
-            if (mgrp->flags & CARGO_MUTEXGRP_GROUP_USAGE)
-            {
-                return 1;
-            }
-        }
+    if (n == 0)
+    {
+        return ret;
     }
 
-    return 0;
-}
-
-static int _cargo_print_options(cargo_t ctx,
-                                size_t *opt_indices, size_t opt_count,
-                                int show_positional, cargo_astr_t *str,
-                                int max_name_len, int indent, int is_mutex,
-                                cargo_usage_t flags)
-{
-    #define NAME_PADDING 2
-    size_t i = 0;
-    size_t opt_i;
-    cargo_opt_t *opt = NULL;
-    int option_causes_newline = 0;
-    size_t namelen = 0;
-    char *name = NULL;
-    int ret = -1;
-    assert(str);
-    assert(ctx);
+    CARGODBG(2, "%s: Converting %lu %s values\n",
+            name, n, _cargo_type_to_str(opt->type));
 
-    // TODO: Replace with cargo_astr_t so we don't have to prealloc max_width
-    if (!(name = _cargo_malloc(ctx->max_width)))
+    if (_cargo_alloc_target(ctx, opt, first + n))
     {
-        CARGODBG(1, "Out of memory!\n");
         return -1;
     }
 
-    // Option names + descriptions.
-    for (i = 0; i < opt_count; i++)
-    {
-        opt_i = opt_indices[i];
-        opt = &ctx->options[opt_i];
-
-        if (opt->flags & CARGO_OPT_HIDE)
-        {
-            continue;
-        }
-
-        // We don't show this in its normal position since it is a member of
-        // a mutex group that should be grouped in the usage.
-        if (_cargo_mutex_group_should_be_grouped(ctx, opt, 0) && !is_mutex)
-        {
-            continue;
-        }
-
-        // Skip options depending on type so we can group them by
-        // calling this function multiple times.
-        if ((show_positional && !opt->positional)
-         || (!show_positional && opt->positional))
-        {
-            continue;
-        }
+    target = *(opt->target);
 
-        // TODO: Hmmm maybe store option max length in the opt struct instead when adding?
-        namelen = _cargo_get_option_name_str(ctx, opt,
-                                            name, ctx->max_width);
+    #ifndef CARGO_NO_THREADS
+    if ((ctx->flags & CARGO_PARALLEL_CONVERT)
+        && (n >= CARGO_PARALLEL_MIN_VALUES))
+    {
+        k = _cargo_convert_values_parallel(opt->type,
+                    (char *)target + first * size, &argv[start], n);
+    }
+    else
+    #endif
+    {
+        k = _cargo_convert_values(opt->type,
+                    (char *)target + first * size, &argv[start], n);
+    }
 
-        // Is the option name so long we need a new line before the description?
-        option_causes_newline = (int)strlen(name) > max_name_len;
+    // Validate what was converted before reporting a value
+    // that could not be parsed, the same as one at a time would.
+    if (opt->validation)
+    {
+        size_t m = _cargo_validate_target_values(ctx, opt, target, first, k);
 
-        // Print the option names.
-        // "  --ducks [DUCKS ...]  "
-        if (cargo_aappendf(str, "%*s%-*s%s",
-                indent + NAME_PADDING, " ",
-                max_name_len, name,
-                (option_causes_newline ? "\n" : "")) < 0)
+        if (m < k)
         {
-            goto fail;
+            opt->target_idx = first + m;
+            ctx->j = start + (int)m;
+            return _cargo_target_value_error(ctx, opt, argv[ctx->j], 1);
         }
+    }
 
-        // Option description.
-        if ((flags & CARGO_USAGE_RAW_OPT_DESCRIPTIONS)
-            || (opt->flags & CARGO_OPT_RAW_DESCRIPTION))
-        {
-            CARGODBG(5, "%s: RAW DESCRIPTION\n", opt->name[0]);
+    opt->target_idx = first + k;
+    ctx->j = start + (int)k;
 
-            if (cargo_aappendf(str, "%*s%s\n",
-                NAME_PADDING, "", opt->description) < 0)
-            {
-                goto fail;
-            }
-        }
-        else
-        {
-            // Add line breaks to fit the width we want.
-            if (_cargo_fit_optnames_and_description(ctx, str, opt_i,
-                    indent + NAME_PADDING, option_causes_newline, max_name_len))
-            {
-                goto fail;
-            }
-        }
+    if (opt->target_count)
+    {
+        *opt->target_count = opt->target_idx;
     }
 
-    ret = 0;
+    if (k < n)
+    {
+        return _cargo_target_value_error(ctx, opt, argv[ctx->j], 0);
+    }
 
-fail:
-    _cargo_xfree(&name);
     return ret;
 }
 
-static int _cargo_get_short_option_usage(cargo_t ctx,
-                                        cargo_opt_t *opt,
-                                        cargo_astr_t *str,
-                                        int is_positional,
-                                        int show_is_optional)
+// Counts the occurrences of c in the first len bytes of s, 8 at a time.
+static size_t _cargo_count_char(const char *s, size_t len, char c)
 {
-    int is_req;
-    char *metavar = NULL;
-    assert(ctx);
-    assert(opt);
-    assert(str);
+    size_t i = 0;
+    size_t count = 0;
+    unsigned long long v;
+    const unsigned long long low7 = 0x7F * CARGO_SWAR_ONES;
+    const unsigned long long pattern = (unsigned char)c * CARGO_SWAR_ONES;
 
-    if ((opt->flags & CARGO_OPT_HIDE) || (opt->flags & CARGO_OPT_HIDE_SHORT))
+    for (; (i + 8) <= len; i += 8)
     {
-        return 1;
-    }
+        memcpy(&v, s + i, sizeof(v));
+        v ^= pattern;
 
-    // Positional arguments.
-    if (is_positional && !opt->positional)
-    {
-        return 1;
+        // Set the high bit of the bytes that are zero, meaning c,
+        // then add them up.
+        v = ~(((v & low7) + low7) | v | low7);
+        count += (size_t)((((v >> 7) * CARGO_SWAR_ONES)) >> 56);
     }
 
-    // Options.
-    if (!is_positional && opt->positional)
+    for (; i < len; i++)
     {
-        return 1;
+        count += (s[i] == c);
     }
 
-    if (opt->metavar)
-    {
-        metavar = _cargo_strdup(opt->metavar);
-    }
-    else
-    {
-        cargo_astr_t metavar_str;
-        memset(&metavar_str, 0, sizeof(metavar_str)),
-        metavar_str.s = &metavar;
+    return count;
+}
 
-        if (_cargo_generate_metavar(ctx, opt, &metavar_str))
-        {
-            CARGODBG(1, "Failed to generate metavar\n");
-            return -1;
-        }
-    }
+#define CARGO_CONVERT_DELIMITED(ctype, vtype, parse)            \
+{                                                               \
+    ctype *t = (ctype *)target;                                 \
+    vtype v;                                                    \
+    for (k = 0; k < n; k++)                                     \
+    {                                                           \
+        const char *e = (parse);                                \
+        if ((e == p) || ((*e != delim) && (*e != '\0'))) break; \
+        t[k] = (ctype)v;                                        \
+        p = e + 1;                                              \
+    }                                                           \
+    break;                                                      \
+}
 
-    is_req = (opt->flags & CARGO_OPT_REQUIRED);
+// Converts the n values in s separated by delim. Returns the number
+// converted before one failed to parse, and points *fail at that one.
+static size_t _cargo_convert_delimited(cargo_type_t type, void *target,
+                                       const char *s, char delim, size_t n,
+                                       const char **fail)
+{
+    size_t k = 0;
+    const char *p = s;
 
-    if (show_is_optional && !is_req)
+    switch (type)
     {
-        cargo_aappendf(str, "[");
+        case CARGO_INT:
+            CARGO_CONVERT_DELIMITED(int, long long,
+                _cargo_parse_longlong(p, INT_MIN, INT_MAX, &v))
+        case CARGO_UINT:
+            CARGO_CONVERT_DELIMITED(unsigned int, unsigned long long,
+                _cargo_parse_ulonglong(p, UINT_MAX, &v))
+        case CARGO_LONGLONG:
+            CARGO_CONVERT_DELIMITED(long long int, long long,
+                _cargo_parse_longlong(p, LLONG_MIN, LLONG_MAX, &v))
+        case CARGO_ULONGLONG:
+            CARGO_CONVERT_DELIMITED(unsigned long long int, unsigned long long,
+                _cargo_parse_ulonglong(p, ULLONG_MAX, &v))
+        case CARGO_FLOAT:
+            CARGO_CONVERT_DELIMITED(float, float, _cargo_parse_float(p, &v))
+        case CARGO_DOUBLE:
+            CARGO_CONVERT_DELIMITED(double, double, _cargo_parse_double(p, &v))
+        default:
+            assert(0);
+            break;
     }
 
-    if (!opt->positional)
-    {
-        cargo_aappendf(str, "%s", opt->name[0]);
-    }
+    *fail = p;
+    return k;
+}
 
-    if (metavar && *metavar)
-    {
-        cargo_aappendf(str, " %s", metavar);
-    }
+#undef CARGO_CONVERT_DELIMITED
 
-    if (show_is_optional && !is_req)
-    {
-        cargo_aappendf(str, "]");
-    }
+static int _cargo_too_many_values_error(cargo_t ctx, cargo_opt_t *opt,
+                                        size_t max)
+{
+    cargo_astr_t str;
+    char *error = NULL;
+    char *highlight = NULL;
+    memset(&str, 0, sizeof(cargo_astr_t));
+    str.s = &error;
+    str.arena = &ctx->arena;
 
-    if (metavar)
-        _cargo_free(metavar);
+    highlight = _cargo_highlight_current_target_value(ctx);
+    cargo_aappendf(&str, "%s\nToo many values for option \"%s\", "
+                         "expected at most %lu\n",
+                    highlight, opt->name[0], max);
+    _cargo_set_error(ctx, error);
+    return -1;
+}
 
-    return 0;
+// Sets the error for an item in a delimited list that can't be parsed.
+// Only the item is shown, not the whole list.
+static int _cargo_list_item_error(cargo_t ctx, cargo_opt_t *opt,
+                                  const char *item, const char *what)
+{
+    cargo_astr_t str;
+    char *error = NULL;
+    char *highlight = NULL;
+    const char *item_end = strchr(item, opt->delimiter);
+    int item_len = item_end ? (int)(item_end - item) : (int)strlen(item);
+    memset(&str, 0, sizeof(cargo_astr_t));
+    str.s = &error;
+    str.arena = &ctx->arena;
+
+    highlight = _cargo_highlight_current_target_value(ctx);
+    cargo_aappendf(&str, "%s\nCannot parse \"%.*s\" as %s for option \"%s\"\n",
+            highlight, item_len, item, what, opt->name[0]);
+    _cargo_set_error(ctx, error);
+    return -1;
 }
 
-static void _cargo_fit_on_short_usage_line(cargo_t ctx, cargo_astr_t *str,
-                                            size_t indent,
-                                            size_t cur_offset,
-                                            size_t opt_offset,
-                                            size_t *prev_offset)
+//
+// Sets the values of a delimited list option "[i,]+" from a single
+// argument such as "1,2,3". The argument is scanned for delimiters once
+// to size the array, and the values are then converted straight from
+// the argument into the target.
+//
+static int _cargo_set_delimited_values(cargo_t ctx, cargo_opt_t *opt,
+                                       const char *name, char *val)
 {
-    assert(ctx);
-    assert(prev_offset);
-    assert(str);
+    size_t k;
+    size_t m;
+    size_t n;
+    size_t len = strlen(val);
+    size_t first = opt->target_idx;
+    size_t size = _cargo_get_type_size(opt->type);
+    const char *fail = NULL;
+    void *target;
+    assert(opt->delimiter);
+    (void)name; // Only used for debug output.
 
-    if ((cur_offset + opt_offset - (*prev_offset)) >= ctx->max_width)
+    if (first >= opt->max_target_count)
     {
-        *prev_offset = cur_offset;
-        cargo_aappendf(str, "\n%*s", indent, " ");
+        return 1;
     }
-}
 
-static int _cargo_get_short_option_usages(cargo_t ctx,
-                                        cargo_astr_t *str,
-                                        size_t indent,
-                                        int is_positional)
-{
-    size_t i;
-    int ret;
-    cargo_astr_t opt_str;
-    size_t prev_offset = 0;
-    cargo_opt_t *opt = NULL;
-    char *opt_s = NULL;
-    assert(ctx);
-    assert(str);
+    n = _cargo_count_char(val, len, opt->delimiter) + 1;
 
-    for (i = 0; i < ctx->opt_count; i++)
+    CARGODBG(2, "%s: Converting %lu delimited %s values\n",
+            name, n, _cargo_type_to_str(opt->type));
+
+    if (n > (opt->max_target_count - first))
     {
-        memset(&opt_str, 0, sizeof(opt_str));
-        opt_str.s = &opt_s;
-        opt = &ctx->options[i];
+        return _cargo_too_many_values_error(ctx, opt, opt->max_target_count);
+    }
 
-        if (opt->flags & CARGO_OPT_HIDE)
+    if (opt->alloc)
+    {
+        if (_cargo_alloc_target(ctx, opt, first + n))
         {
-            continue;
+            return -1;
         }
 
-        // We display this seperately in _cargo_mutex_group_short_usage
-        if (_cargo_mutex_group_should_be_grouped(ctx, opt, 1))
-        {
-            continue;
-        }
+        target = *(opt->target);
+    }
+    else
+    {
+        target = (void *)opt->target;
+    }
 
-        cargo_aappendf(&opt_str, " ");
+    k = _cargo_convert_delimited(opt->type, (char *)target + first * size,
+                                 val, opt->delimiter, n, &fail);
 
-        if ((ret = _cargo_get_short_option_usage(ctx, opt,
-                                &opt_str, is_positional, 1)) < 0)
-        {
-            CARGODBG(1, "Failed to get option usage\n");
-            goto fail;
-        }
+    if ((m = _cargo_validate_target_values(ctx, opt, target, first, k)) < k)
+    {
+        opt->target_idx = first + m;
+        return _cargo_target_value_error(ctx, opt, val, 1);
+    }
 
-        if (ret == 1)
-        {
-            _cargo_xfree(&opt_s);
-            continue;
-        }
+    opt->target_idx = first + k;
 
-        // Does the option fit on this line?
-        _cargo_fit_on_short_usage_line(ctx, str,
-            indent, str->offset, opt_str.offset, &prev_offset);
+    if (opt->target_count)
+    {
+        *opt->target_count = opt->target_idx;
+    }
 
-        if (opt_s)
-        {
-            cargo_aappendf(str, "%s", opt_s);
-            _cargo_xfree(&opt_s);
-        }
+    if (k < n)
+    {
+        return _cargo_list_item_error(ctx, opt, fail,
+                                      _cargo_type_to_str(opt->type));
     }
 
     return 0;
-fail:
-    _cargo_xfree(&opt_s);
-    return -1;
 }
 
-static char **_cargo_split_and_verify_option_names(cargo_t ctx,
-                                                    const char *optnames,
-                                                    size_t *optcount)
+//
+// Range lists such as "0-63,128-191:2" for "[i-]+" arrays and "m#"
+// bitmaps. While parsing, values are kept as unsigned long long with
+// signed ones biased by 2^63, so that both kinds order the same way.
+//
+#define CARGO_RANGE_BIAS (1ULL << 63)
+
+static unsigned long long _cargo_range_bias(cargo_type_t type)
 {
-    char **optname_list = NULL;
-    char *tmp = NULL;
-    assert(ctx);
-    assert(optcount);
+    return ((type == CARGO_INT) || (type == CARGO_LONGLONG))
+            ? CARGO_RANGE_BIAS : 0;
+}
 
-    if (!(tmp = _cargo_strdup(optnames)))
-    {
-        return NULL;
-    }
+static const char *_cargo_parse_range_value(cargo_type_t type, const char *s,
+                                            unsigned long long *out)
+{
+    long long v = 0;
+    const char *end = s;
 
-    if (!(optname_list = _cargo_split(tmp, " ", optcount))
-        || (*optcount <= 0))
+    switch (type)
     {
-        CARGODBG(1, "Failed to split option name list: \"%s\"\n", optnames);
-        goto fail;
+        case CARGO_INT:
+            end = _cargo_parse_longlong(s, INT_MIN, INT_MAX, &v);
+            *out = (unsigned long long)v ^ CARGO_RANGE_BIAS;
+            break;
+        case CARGO_LONGLONG:
+            end = _cargo_parse_longlong(s, LLONG_MIN, LLONG_MAX, &v);
+            *out = (unsigned long long)v ^ CARGO_RANGE_BIAS;
+            break;
+        case CARGO_UINT:
+            end = _cargo_parse_ulonglong(s, UINT_MAX, out);
+            break;
+        case CARGO_ULONGLONG:
+            end = _cargo_parse_ulonglong(s, ULLONG_MAX, out);
+            break;
+        default:
+            assert(0);
+            break;
     }
 
-    #ifdef CARGO_DEBUG
-    {
-        size_t i;
-        CARGODBG(3, "Got %lu option names:\n", *optcount);
-        for (i = 0; i < *optcount; i++)
-        {
-            CARGODBG(3, " %s\n", optname_list[i]);
-        }
-    }
-    #endif // CARGO_DEBUG
+    return end;
+}
 
-    if (!_cargo_find_option_name(ctx, optname_list[0], NULL, NULL))
-    {
-        CARGODBG(1, "%s already exists\n", optname_list[0]);
-        goto fail;
-    }
+// Parses one "N", "N-M" or "N-M:STEP" item. Returns a pointer to the
+// ',' or '\0' after it, or NULL if it is invalid.
+static const char *_cargo_parse_range(cargo_type_t type, const char *s,
+                                      unsigned long long *lo,
+                                      unsigned long long *hi,
+                                      unsigned long long *step)
+{
+    const char *p = s;
+    const char *e = NULL;
 
-    // If this is a positional argument it has to start with
-    // [a-zA-Z]
-    if (!_cargo_starts_with_prefix(ctx, optname_list[0]))
+    if ((e = _cargo_parse_range_value(type, p, lo)) == p)
+        return NULL;
+
+    *hi = *lo;
+    *step = 1;
+
+    if (*e == '-')
     {
-        if (strpbrk(optname_list[0],
-            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ")
-            != optname_list[0])
+        p = e + 1;
+
+        if ((e = _cargo_parse_range_value(type, p, hi)) == p)
+            return NULL;
+
+        if (*e == ':')
         {
-            CARGODBG(1, "A positional argument must start with [a-zA-Z]\n");
-            goto fail;
+            p = e + 1;
+
+            if (((e = _cargo_parse_ulonglong(p, ULLONG_MAX, step)) == p)
+                || (*step == 0))
+                return NULL;
         }
     }
 
-    _cargo_free(tmp);
-    return optname_list;
-
-fail:
-    _cargo_xfree(&tmp);
-    _cargo_free_str_list(&optname_list, optcount);
+    if (((*e != ',') && (*e != '\0')) || (*hi < *lo))
+        return NULL;
 
-    return NULL;
+    return e;
 }
 
-static cargo_opt_t *_cargo_option_init(cargo_t ctx,
-                                        const char *name,
-                                        const char *description)
+static int _cargo_validate_range_item(cargo_t ctx, cargo_opt_t *opt,
+                                      unsigned long long v)
 {
-    char *optname = NULL;
-    cargo_opt_t *o = NULL;
-    assert(ctx);
+    union
+    {
+        int i;
+        unsigned int u;
+        long long ll;
+        unsigned long long ull;
+    } t;
 
-    if (_cargo_grow_options(&ctx->options, &ctx->opt_count, &ctx->max_opts))
+    switch (opt->type)
     {
-        return NULL;
+        case CARGO_INT: t.i = (int)(long long)(v ^ CARGO_RANGE_BIAS); break;
+        case CARGO_UINT: t.u = (unsigned int)v; break;
+        case CARGO_LONGLONG: t.ll = (long long)(v ^ CARGO_RANGE_BIAS); break;
+        case CARGO_ULONGLONG: t.ull = v; break;
+        default: assert(0); return -1;
     }
 
-    o = &ctx->options[ctx->opt_count];
-    memset(o, 0, sizeof(cargo_opt_t));
-    ctx->opt_count++;
+    return _cargo_validate_option_value(ctx, opt, &t);
+}
 
-    if (o->name_count >= CARGO_NAME_COUNT)
-    {
-        CARGODBG(1, "Max %d names allowed\n", CARGO_NAME_COUNT);
-        return NULL;
-    }
+static int _cargo_validate_range_items(cargo_t ctx, cargo_opt_t *opt,
+                                       unsigned long long lo,
+                                       unsigned long long hi,
+                                       unsigned long long step)
+{
+    unsigned long long v;
 
-    if (!(optname = _cargo_strdup(name)))
+    // A range validator only needs to see the first and last value,
+    // so a large range isn't validated one value at a time.
+    if (opt->range)
     {
-        CARGODBG(1, "Out of memory\n");
-        return NULL;
+        return _cargo_validate_range_item(ctx, opt, lo)
+            || _cargo_validate_range_item(ctx, opt,
+                                          lo + ((hi - lo) / step) * step);
     }
 
-    o->name[o->name_count] = optname;
-    o->name_count++;
-
-    if (description && !(o->description = _cargo_strdup(description)))
+    for (v = lo; ; v += step)
     {
-        CARGODBG(1, "Out of memory\n");
-        return NULL;
+        if (_cargo_validate_range_item(ctx, opt, v))
+            return -1;
+
+        if ((hi - v) < step)
+            break;
     }
 
-    return o;
+    return 0;
 }
 
-static void _cargo_option_destroy(cargo_opt_t *o)
+// Sets the bits lo to hi, a whole word at a time where possible.
+static void _cargo_bitmap_set_range(unsigned long long *words,
+                                    unsigned long long lo,
+                                    unsigned long long hi,
+                                    unsigned long long step)
 {
-    size_t j;
+    size_t w;
+    size_t first = (size_t)(lo / 64);
+    size_t last = (size_t)(hi / 64);
+    unsigned long long lo_mask = ~0ULL << (lo % 64);
+    unsigned long long hi_mask = ~0ULL >> (63 - (hi % 64));
 
-    if (!o)
+    if (step > 1)
     {
-        return;
-    }
+        for (; ; lo += step)
+        {
+            words[lo / 64] |= 1ULL << (lo % 64);
 
-    for (j = 0; j < o->name_count; j++)
+            if ((hi - lo) < step)
+                break;
+        }
+    }
+    else if (first == last)
     {
-        CARGODBG(2, "###### FREE OPTION NAME: %s\n", o->name[j]);
-        _cargo_xfree(&o->name[j]);
+        words[first] |= lo_mask & hi_mask;
     }
+    else
+    {
+        words[first] |= lo_mask;
 
-    o->name_count = 0;
-
-    _cargo_xfree(&o->description);
-    _cargo_xfree(&o->metavar);
-    _cargo_xfree(&o->bool_acc);
-    o->bool_acc_count = 0;
-    o->bool_acc_max_count = 0;
+        for (w = first + 1; w < last; w++)
+        {
+            words[w] = ~0ULL;
+        }
 
-    // Special case for custom callback target, it is allocated
-    // internally so we should always auto clean it.
-    _cargo_free_str_list(&o->custom_target, &o->custom_target_count);
-    _cargo_free_str_list(&o->mutex_group_names, &o->mutex_group_count);
+        words[last] |= hi_mask;
+    }
+}
 
-    _cargo_option_destroy_validation(o);
+#define CARGO_FILL_RANGE(ctype, vtype)                          \
+{                                                               \
+    ctype *t = (ctype *)target + first;                         \
+    for (v = lo; ; v += step)                                   \
+    {                                                           \
+        t[k++] = (ctype)(vtype)(v ^ bias);                      \
+        if ((hi - v) < step) break;                             \
+    }                                                           \
+    break;                                                      \
 }
 
-typedef struct cargo_fmt_token_s
-{
-    int column;
-    char token;
-} cargo_fmt_token_t;
+//
+// Sets the values of a range list option. The list is checked and
+// validated first, which also counts the values so an array is only
+// allocated once. Then each range is written out, for a bitmap as
+// whole words.
+//
+static int _cargo_set_range_values(cargo_t ctx, cargo_opt_t *opt,
+                                   const char *name, char *val)
+{
+    size_t k = 0;
+    size_t total = 0;
+    size_t room = 0;
+    size_t first = opt->target_idx;
+    unsigned long long lo = 0;
+    unsigned long long hi = 0;
+    unsigned long long step = 1;
+    unsigned long long v;
+    unsigned long long bias = _cargo_range_bias(opt->type);
+    const char *p;
+    const char *e;
+    void *target;
+    cargo_astr_t str;
+    char *error = NULL;
+    memset(&str, 0, sizeof(cargo_astr_t));
+    str.s = &error;
+    str.arena = &ctx->arena;
+    assert(opt->ranges);
+    (void)name; // Only used for debug output.
 
-typedef struct cargo_fmt_scanner_s
-{
-    const char *fmt;
-    const char *start;
-    cargo_fmt_token_t prev_token;
-    cargo_fmt_token_t token;
-    cargo_fmt_token_t next_token;
+    if (!opt->bitmap)
+    {
+        if (first >= opt->max_target_count)
+        {
+            return 1;
+        }
 
-    int column;
-} cargo_fmt_scanner_t;
+        room = opt->max_target_count - first;
+        room = CARGO_MIN(room, CARGO_MAX_RANGE_VALUES);
+    }
 
-static char _cargo_fmt_token(cargo_fmt_scanner_t *s)
-{
-    return s->token.token;
-}
+    for (p = val; ; p = e + 1)
+    {
+        if (!(e = _cargo_parse_range(opt->type, p, &lo, &hi, &step)))
+        {
+            return _cargo_list_item_error(ctx, opt, p, "a range");
+        }
 
-static void _cargo_fmt_scanner_init(cargo_fmt_scanner_t *s,
-                                    const char *fmt)
-{
-    assert(s);
-    memset(s, 0, sizeof(cargo_fmt_scanner_t));
+        if (opt->bitmap)
+        {
+            if (hi >= opt->bitmap_bits)
+            {
+                cargo_aappendf(&str, "%s\nBit %"CARGO_ULONGLONG_FMT" is out "
+                        "of range for option \"%s\", expected at most %lu\n",
+                        _cargo_highlight_current_target_value(ctx),
+                        hi, opt->name[0], opt->bitmap_bits - 1);
+                _cargo_set_error(ctx, error);
+                return -1;
+            }
+        }
+        else
+        {
+            if (((hi - lo) / step) >= (room - total))
+            {
+                return _cargo_too_many_values_error(ctx, opt, first + room);
+            }
 
-    CARGODBG(2, "FMT scanner init: \"%s\"\n", fmt);
-    s->fmt = fmt;
-    s->start = fmt;
-    s->column = 0;
+            total += (size_t)((hi - lo) / step) + 1;
+        }
 
-    s->token.token = *fmt;
-}
+        if (opt->validation
+            && _cargo_validate_range_items(ctx, opt, lo, hi, step))
+        {
+            return _cargo_target_value_error(ctx, opt, val, 1);
+        }
 
-static void _cargo_fmt_next_token(cargo_fmt_scanner_t *s)
-{
-    const char *fmt;
+        if (*e == '\0')
+            break;
+    }
 
-    CARGODBG(4, "\"%s\"\n", s->start);
-    CARGODBG(4, " %*s\n", s->token.column, "^");
+    CARGODBG(2, "%s: Setting %lu %s values from ranges\n",
+            name, total, _cargo_type_to_str(opt->type));
 
-    s->prev_token = s->token;
+    if (opt->bitmap)
+    {
+        target = (void *)opt->target;
+        memset(target, 0, ((opt->bitmap_bits + 63) / 64) * sizeof(unsigned long long));
+    }
+    else if (opt->alloc)
+    {
+        if (_cargo_alloc_target(ctx, opt, first + total))
+        {
+            return -1;
+        }
 
-    s->column++;
+        target = *(opt->target);
+    }
+    else
+    {
+        target = (void *)opt->target;
+    }
 
-    fmt = s->fmt;
-    while ((*fmt == ' ') || (*fmt == '\t'))
+    for (p = val; ; p = e + 1)
     {
-        s->column++;
-        fmt++;
+        e = _cargo_parse_range(opt->type, p, &lo, &hi, &step);
+        assert(e);
+
+        switch (opt->bitmap ? 0 : opt->type)
+        {
+            case 0:
+                _cargo_bitmap_set_range((unsigned long long *)target, lo, hi, step);
+                break;
+            case CARGO_INT:
+                CARGO_FILL_RANGE(int, long long)
+            case CARGO_UINT:
+                CARGO_FILL_RANGE(unsigned int, unsigned long long)
+            case CARGO_LONGLONG:
+                CARGO_FILL_RANGE(long long int, long long)
+            case CARGO_ULONGLONG:
+                CARGO_FILL_RANGE(unsigned long long int, unsigned long long)
+            default:
+                assert(0);
+                return -1;
+        }
+
+        if (*e == '\0')
+            break;
     }
 
-    s->token.token = *fmt;
-    s->token.column = s->column;
+    if (!opt->bitmap)
+    {
+        opt->target_idx = first + k;
 
-    fmt++;
-    s->fmt = fmt;
+        if (opt->target_count)
+        {
+            *opt->target_count = opt->target_idx;
+        }
+    }
+
+    return 0;
 }
 
-static void _cargo_fmt_prev_token(cargo_fmt_scanner_t *s)
+#undef CARGO_FILL_RANGE
+
+static const char *_cargo_check_options(cargo_t ctx, cargo_opt_t **opt, char *arg)
 {
-    s->next_token = s->token;
-    s->token = s->prev_token;
-    s->fmt = &s->start[s->token.column];
+    size_t j;
+    size_t name_i;
+    assert(opt);
 
-    CARGODBG(4, "\"%s\"\n", s->start);
-    CARGODBG(4, " %*s\n", s->token.column, "^");
+    if (!_cargo_starts_with_prefix(ctx, arg))
+        return NULL;
+
+    // Look for completely matching options first.
+    if (!_cargo_find_option_name(ctx, arg, &j, &name_i))
+    {
+        *opt = &ctx->options[j];
+        CARGODBG(3, "  Found matching option \"%s\", alias \"%s\"\n",
+                (*opt)->name[0], (*opt)->name[name_i]);
+        return (*opt)->name[name_i];
+    }
+
+    *opt = NULL;
+
+    return NULL;
 }
 
-static const char *_cargo_get_option_group_names(cargo_t ctx,
-                                        const char *optnames,
-                                        char **grpname,
-                                        char **mutex_grpname)
+static int _cargo_is_arg_negative_integer(const char *arg)
 {
-    int len = 0;
     char *end = NULL;
-    char *tmp = NULL;
-    char **groups = NULL;
-    const char *ret = NULL;
-    char *s = NULL;
-    size_t count;
-    size_t i;
-    assert(ctx);
-    assert(grpname);
-    assert(mutex_grpname);
-
-    *grpname = NULL;
+    long long int i = strtoll(arg, &end, 10);
+    return (i < 0);
+}
 
-    // Skip any whitespace.
-    optnames += strspn(optnames, " \t");
+static void _cargo_classify_arg(cargo_t ctx, cargo_token_t *t, char *arg)
+{
+    cargo_opt_t *opt = NULL;
 
-    if (*optnames != '<')
-    {
-        return optnames;
-    }
+    memset(t, 0, sizeof(cargo_token_t));
+    t->prefix_len = strspn(arg, ctx->prefix);
 
-    if (!(end = strchr(optnames, '>')))
+    if (t->prefix_len == 0)
     {
-        CARGODBG(1, "Missing '>' to terminate group name\n");
-        return NULL;
+        t->kind = CARGO_TOKEN_ARG;
+        return;
     }
 
-    end--;
-
-    len = (end - optnames);
+    t->negative = _cargo_is_arg_negative_integer(arg);
 
-    if (!(tmp = cargo_strndup(&optnames[1], len)))
+    if ((t->name = _cargo_check_options(ctx, &opt, arg)))
     {
-        CARGODBG(1, "Out of memory!\n");
-        return NULL;
+        t->opt_i = (size_t)(opt - ctx->options);
+        t->kind = CARGO_TOKEN_OPTION;
     }
-
-    if (!(groups = _cargo_split(tmp, ",", &count)))
+    else if ((t->name = _cargo_trie_find_bundle(ctx, arg, &t->opt_i)))
     {
-        CARGODBG(1, "Failed to split group names\n");
-        goto fail;
+        t->kind = CARGO_TOKEN_OPTION_COMPACT;
     }
-
-    if (count > 2)
+    else if ((t->prefix_len >= 2) && (strlen(arg) > t->prefix_len)
+          && (ctx->flags & CARGO_ABBREV)
+          && (t->name = _cargo_trie_find_abbrev(ctx, arg, &t->opt_i)))
     {
-        CARGODBG(1, "Invalid number of groups specified. "
-                    "1 normal and 1 mutex group allowed\n");
-        goto fail;
+        CARGODBG(3, "  \"%s\" is an abbreviation of \"%s\"\n",
+                arg, t->name);
+        t->kind = CARGO_TOKEN_OPTION;
     }
-
-    for (i = 0; i < count; i++)
+    else if (t->negative)
     {
-        s = groups[i];
-        s += strspn(s, " \t");
-
-        if (s[0] == '!')
-        {
-            if (!(*mutex_grpname = _cargo_strdup(&s[1])))
-            {
-                CARGODBG(1, "Out of memory!\n");
-                goto fail;
-            }
-        }
-        else
-        {
-            if (!(*grpname = _cargo_strdup(s)))
-            {
-                CARGODBG(1, "Out of memory!\n");
-                goto fail;
-            }
-        }
+        t->kind = CARGO_TOKEN_ARG;
     }
-
-    optnames += len + 2;
-    ret = optnames;
-
-fail:
-    _cargo_xfree(&tmp);
-
-    if (!ret)
+    else
     {
-        _cargo_xfree(grpname);
-        _cargo_xfree(mutex_grpname);
+        t->kind = CARGO_TOKEN_UNKNOWN;
     }
 
-    _cargo_free_str_list(&groups, &count);
-
-    return ret;
-}
-
-static void _cargo_group_destroy(cargo_group_t *g)
-{
-    if (!g) return;
-    _cargo_xfree(&g->option_indices);
-    _cargo_xfree(&g->name);
-    _cargo_xfree(&g->title);
-    _cargo_xfree(&g->description);
-    _cargo_xfree(&g->metavar);
-    g->opt_count = 0;
+    CARGODBG(4, "\"%s\" kind %d\n", arg, t->kind);
 }
 
-static void _cargo_groups_destroy(cargo_t ctx)
+static int _cargo_classify_args(cargo_t ctx)
 {
-    size_t i;
+    int i;
     assert(ctx);
 
-    if (ctx->groups)
+    // Decide once what each argv element is, so that the parse
+    // and the checks after it don't have to look at it again.
+    if ((size_t)ctx->argc > ctx->max_tokens)
     {
-        for (i = 0; i < ctx->group_count; i++)
+        _cargo_xfree(&ctx->mem, &ctx->tokens);
+        ctx->max_tokens = 0;
+
+        if (!(ctx->tokens = _cargo_calloc(&ctx->mem, ctx->argc,
+                                              sizeof(cargo_token_t))))
         {
-            _cargo_group_destroy(&ctx->groups[i]);
+            CARGODBG(1, "Out of memory!\n");
+            return -1;
         }
 
-        _cargo_xfree(&ctx->groups);
+        ctx->max_tokens = ctx->argc;
     }
 
-    if (ctx->mutex_groups)
+    if (ctx->trie_dirty && _cargo_trie_build(ctx))
     {
-        for (i = 0; i < ctx->mutex_group_count; i++)
+        return -1;
+    }
+
+    for (i = 0; i < ctx->argc; i++)
+    {
+        if (i < ctx->start)
         {
-            _cargo_group_destroy(&ctx->mutex_groups[i]);
+            memset(&ctx->tokens[i], 0, sizeof(cargo_token_t));
+            continue;
         }
 
-        _cargo_xfree(&ctx->mutex_groups);
+        _cargo_classify_arg(ctx, &ctx->tokens[i], ctx->argv[i]);
     }
+
+    return 0;
 }
 
-static cargo_group_t *_cargo_find_group(cargo_t ctx,
-                    cargo_group_t *groups, size_t group_count,
-                    const char *name, size_t *grp_i)
+static int _cargo_is_another_option(cargo_t ctx, int i)
 {
-    size_t i;
-    cargo_group_t *g;
-    assert(ctx);
-    assert(name);
+    return (ctx->tokens[i].kind == CARGO_TOKEN_OPTION)
+        || (ctx->tokens[i].kind == CARGO_TOKEN_OPTION_COMPACT);
+}
 
-    if (!groups)
-        return NULL;
+static cargo_error_record_t *_cargo_add_option_record(cargo_t ctx,
+                                            cargo_error_code_t code,
+                                            int warning, cargo_opt_t *opt,
+                                            const char *name)
+{
+    cargo_error_record_t *r = NULL;
 
-    for (i = 0; i < group_count; i++)
+    if ((r = _cargo_add_record(ctx, code, warning)))
     {
-        g = &groups[i];
+        r->opt_i = (int)(opt - ctx->options);
+        r->name = name;
 
-        if (!strcmp(g->name, name))
+        // The arguments of a stream are gone once parsed.
+        if (!ctx->streaming)
         {
-            if (grp_i) *grp_i = i;
-            return g;
+            r->argi = ctx->i;
+            r->prev_argi = opt->parsed;
         }
     }
 
-    return NULL;
+    return r;
 }
 
-static int _cargo_add_group(cargo_t ctx,
-                    cargo_group_t **groups, size_t *group_count,
-                    size_t *max_groups,
-                    size_t flags, const char *name,
-                    const char *title, const char *description)
+// Adds the option and argument to the error just set for a value
+// of the option that could not be parsed or did not validate.
+static void _cargo_set_value_error_record(cargo_t ctx, cargo_opt_t *opt,
+                                          const char *name)
 {
-    int ret = -1;
-    cargo_group_t *grp = NULL;
-    assert(ctx);
-    assert(name);
-    assert(groups);
-    assert(max_groups);
-    assert(group_count);
+    cargo_error_record_t *r = NULL;
 
-    CARGODBG(2, "Add group %s (%lu)\n", name, *group_count);
+    if (ctx->record_count == 0)
+        return;
 
-    // Initial allocation.
-    if (!*groups)
-    {
-        (*max_groups) = CARGO_DEFAULT_MAX_GROUPS;
+    r = &ctx->records[ctx->record_count - 1];
 
-        if (!((*groups) = _cargo_calloc(*max_groups, sizeof(cargo_group_t))))
-        {
-            CARGODBG(1, "Out of memory!\n");
-            return -1;
-        }
-    }
+    if (r->warning || (r->code != CARGO_ERROR_MESSAGE) || (r->opt_i >= 0))
+        return;
 
-    if (_cargo_find_group(ctx, *groups, *group_count, name, NULL))
+    r->code = CARGO_ERROR_VALUE;
+    r->opt_i = (int)(opt - ctx->options);
+    r->name = name;
+
+    // The arguments of a stream are gone once parsed.
+    if (!ctx->streaming && (ctx->j < ctx->argc))
     {
-        CARGODBG(1, "Group \"%s\" already exists\n", name);
-        return -1;
+        r->argi = ctx->j;
     }
+}
 
-    // Realloc if needed.
-    if (*group_count >= *max_groups)
+static int _cargo_check_if_already_parsed(cargo_t ctx,
+                                          cargo_opt_t *opt, const char *name)
+{
+    if (opt->parsed >= 0)
     {
-        (*max_groups) *= 2;
-
-        if (!((*groups) = _cargo_realloc(*groups,
-            sizeof(cargo_group_t) * (*max_groups))))
+        if ((opt->type == CARGO_BOOL)
+         && (opt->bool_count || opt->bool_acc))
         {
-            CARGODBG(1, "Out of memory!\n");
-            goto fail;
+            // This is for parsing multiple arguments of the same type
+            // for instance -v -v -v.
+            // We need to reset the target index when doing this, otherwise
+            // we would be treating the target value for the bool option as an
+            // array since target_idx is incremented on each parse.
+            opt->target_idx = 0;
         }
-    }
-
-    grp = &(*groups)[*group_count];
-    memset(grp, 0, sizeof(cargo_group_t));
-
-    if (!(grp->name = _cargo_strdup(name)))
-    {
-        CARGODBG(1, "Out of memory!\n");
-        goto fail;
-    }
-
-    if (title)
-    {
-        if (!(grp->title = _cargo_strdup(title)))
+        else if ((ctx->flags & CARGO_UNIQUE_OPTS)
+              || (opt->flags & CARGO_OPT_UNIQUE))
         {
-            CARGODBG(1, "Out of memory!\n");
-            goto fail;
+            CARGODBG(2, "%s: Parsing option as unique\n", name);
+            _cargo_set_error_record(ctx, _cargo_add_option_record(ctx,
+                            CARGO_ERROR_NOT_UNIQUE, 0, opt, name));
+            return -1;
         }
-    }
-    else
-    {
-        if (!(grp->title = _cargo_strdup(name)))
+        else
         {
-            CARGODBG(1, "Out of memory!\n");
-            goto fail;
+            CARGODBG(2,
+                "%s: Parsing option that has already been parsed\n", name);
+            _cargo_set_error_record(ctx, _cargo_add_option_record(ctx,
+                            CARGO_ERROR_ALREADY_PARSED, 1, opt, name));
+
+            // TODO: Should we always do this?
+            // Say --abc takes a list of integers.
+            // --abc 1 2 3 ... or why not --abc 1 --def 5 --abc 2 3
+            // (probably a bad idea :D)
+            _cargo_cleanup_option_value(ctx, opt, 1);
         }
     }
-
-    if (description)
+    else
     {
-        if (!(grp->description = _cargo_strdup(description)))
-        {
-            CARGODBG(1, "Out of memory!\n");
-            goto fail;
-        }
+        _cargo_cleanup_option_value(ctx, opt, 1);
     }
 
-    grp->flags = flags;
-    grp->max_opt_count = CARGO_DEFAULT_MAX_GROUP_OPTS;
-    grp->opt_count = 0;
+    return 0;
+}
+
+static const char *_cargo_nargs_str(int nargs, char *s, size_t len)
+{
+    *s = '\0';
 
-    if (!(grp->option_indices = _cargo_calloc(grp->max_opt_count, sizeof(size_t))))
+    switch (nargs)
     {
-        CARGODBG(1, "Out of memory!\n");
-        goto fail;
+        case CARGO_NARGS_ZERO_OR_ONE: return "0 or 1";
+        case CARGO_NARGS_ONE_OR_MORE: return "1 or more";
+        case CARGO_NARGS_ZERO_OR_MORE: return "0 or more";
+        default: cargo_snprintf(s, len, "%d", nargs); return s;
     }
+}
 
-    (*group_count)++;
-    CARGODBG(3, "  group_count after: %lu\n", *group_count);
-
-    ret = 0;
+static size_t _cargo_count_option_args(cargo_t ctx, int start, int count)
+{
+    int j;
 
-fail:
-    if (ret < 0)
+    for (j = start; j < (start + count); j++)
     {
-        _cargo_group_destroy(grp);
+        if (_cargo_is_another_option(ctx, j))
+            break;
     }
 
-    return ret;
+    return (size_t)(j - start);
 }
 
-static int _cargo_group_add_option_ex(cargo_t ctx,
-                                        cargo_group_t *groups,
-                                        size_t group_count,
-                                        const char *group,
-                                        const char *opt,
-                                        int is_mutex)
+static cargo_parse_result_t _cargo_parse_option(cargo_t ctx,
+                                cargo_opt_t *opt,
+                                const char *name,
+                                int argc, char **argv)
 {
-    size_t opt_i;
-    cargo_group_t *g = NULL;
-    size_t grp_i;
-    cargo_opt_t *o = NULL;
-    assert(ctx);
-    assert(groups);
-    assert(group);
-    assert(opt);
+    int ret = 0;
+    int eaten;
+    int args_to_look_for;
+    int start = opt->positional ? ctx->i : (ctx->i + 1);
 
-    CARGODBG(2, "+++++++ Add %s to group \"%s\" +++++++\n", opt, group);
+    CARGODBG(2, "------ Parse option %s ------\n", opt->name[0]);
+    CARGODBG(2, "argc: %d\n", argc);
+    CARGODBG(2, "i: %d\n", ctx->i);
+    CARGODBG(2, "start: %d\n", start);
+    CARGODBG(2, "parsed: %d\n", opt->parsed);
+    CARGODBG(2, "positional: %d\n", opt->positional);
 
-    if (!(g = _cargo_find_group(ctx, groups, group_count, group, &grp_i)))
+    if (!opt->positional
+        && _cargo_check_if_already_parsed(ctx, opt, name))
     {
-        CARGODBG(1, "No such group \"%s\"\n", group);
-        return -1;
+        return CARGO_PARSE_OPT_ALREADY_PARSED;
     }
 
-    if (_cargo_find_option_name(ctx, opt, &opt_i, NULL))
+    // Keep looking until the end of the argument list.
+    if ((opt->nargs == CARGO_NARGS_ONE_OR_MORE) ||
+        (opt->nargs == CARGO_NARGS_ZERO_OR_MORE) ||
+        (opt->nargs == CARGO_NARGS_ZERO_OR_ONE))
     {
-        CARGODBG(1, "No such option \"%s\"\n", opt);
-        return -1;
+        args_to_look_for = (argc - start);
+
+        switch (opt->nargs)
+        {
+            case CARGO_NARGS_ONE_OR_MORE:
+                args_to_look_for = CARGO_MAX(args_to_look_for, 1);
+                break;
+            case CARGO_NARGS_ZERO_OR_ONE:
+                args_to_look_for = CARGO_MIN(args_to_look_for, 1);
+                break;
+        }
+    }
+    else
+    {
+        // Read (number of expected arguments) - (read so far).
+        args_to_look_for = (opt->nargs - opt->target_idx);
     }
 
-    assert(opt_i < ctx->opt_count);
-    o = &ctx->options[opt_i];
+    assert(args_to_look_for >= 0);
 
-    if (!is_mutex && (o->group_index > 0))
+    if (start + args_to_look_for >= ctx->argc)
     {
-        CARGODBG(1, "\"%s\" is already in another group \"%s\"\n",
-                o->name[0], ctx->groups[o->group_index].name);
-        return -1;
+        args_to_look_for = ctx->argc - start;
     }
 
-    if (g->opt_count >= g->max_opt_count)
-    {
-        CARGODBG(2, "Realloc group max option count from %lu to %lu\n",
-                g->max_opt_count, 2 * g->max_opt_count);
+    CARGODBG(3, "Looking for %d args\n", args_to_look_for);
+    CARGODBG(3, "Start %d, End %d (argc %d, nargs %d)\n",
+            start, (start + args_to_look_for), argc, opt->nargs);
 
-        g->max_opt_count *= 2;
+    ctx->j = start;
 
-        if (!(g->option_indices = _cargo_realloc(g->option_indices,
-                g->max_opt_count * sizeof(size_t))))
+    if (opt->type == CARGO_BOOL)
+    {
+        // A flag takes no value, and argv[start] is past the end
+        // when it is the last argument.
+        if ((ret = _cargo_set_target_value(ctx, opt, name, NULL)) < 0)
         {
-            CARGODBG(1, "Out of memory!\n");
-            return -1;
+            CARGODBG(1, "Failed to set value for no argument option\n");
+            _cargo_set_value_error_record(ctx, opt, name);
+            return CARGO_PARSE_FAIL_OPT;
         }
     }
-
-    g->option_indices[g->opt_count] = opt_i;
-
-    // Save index in option
-    // (since we might realloc the array of groups we must use the index)
-    if (is_mutex)
+    else if (opt->nargs == CARGO_NARGS_ZERO_OR_ONE)
     {
-        if (o->mutex_group_count == CARGO_MAX_OPT_MUTEX_GROUP)
+        char *arg;
+
+        if ((args_to_look_for == 0)
+            || _cargo_is_another_option(ctx, ctx->j))
         {
-            CARGODBG(1, "Option %s cannot belong to more mutex groups. "
-                       "Count is CARGO_MAX_OPT_MUTEX_GROUP (%d).\n",
-                       opt, CARGO_MAX_OPT_MUTEX_GROUP);
-            return -1;
+            arg = opt->zero_or_one_default;
+        }
+        else
+        {
+            arg = argv[ctx->j];
         }
 
-        o->mutex_group_idxs[o->mutex_group_count++] = grp_i;
+        if ((ret = _cargo_set_target_value(ctx,
+                        opt, name, arg) < 0))
+        {
+            CARGODBG(1, "Failed to set value for no argument option\n");
+            _cargo_set_value_error_record(ctx, opt, name);
+            return CARGO_PARSE_FAIL_OPT;
+        }
     }
     else
     {
-        o->group_index = grp_i;
-    }
+        int run = args_to_look_for;
+        opt->target_alloc_hint = 0;
 
-    g->opt_count++;
+        // Size an unbounded array after the values in this run.
+        if ((opt->nargs < 0) && (opt->custom || opt->alloc))
+        {
+            run = (int)_cargo_count_option_args(ctx, start, args_to_look_for);
+            opt->target_alloc_hint = opt->target_idx + run;
+        }
 
-    CARGODBG(2, "   Group \"%s\" option count: %lu\n", g->name, g->opt_count);
+        if (_cargo_can_convert_run(opt))
+        {
+            if ((ret = _cargo_set_target_values(ctx, opt, name,
+                                                argv, start, run)) < 0)
+            {
+                CARGODBG(1, "Failed to set target values for %s: \n", name);
+                _cargo_set_value_error_record(ctx, opt, name);
+                return CARGO_PARSE_FAIL_OPT;
+            }
+        }
+        else
+        {
+            // Read until we find another option, or we've "eaten" the
+            // arguments we want.
+            for (ctx->j = start; ctx->j < (start + args_to_look_for); ctx->j++)
+            {
+                CARGODBG(3, "    argv[%i]: %s\n", ctx->j, argv[ctx->j]);
 
-    return 0;
-}
+                if (_cargo_is_another_option(ctx, ctx->j))
+                {
+                    // We found another option, stop parsing arguments
+                    // for this option.
+                    CARGODBG(3, "%s", "    Found other option\n");
+                    break;
+                }
 
-static void _cargo_print_mutex_group(cargo_t ctx,
-                                     size_t start_index,
-                                     cargo_astr_t *str,
-                                     cargo_group_t *g)
-{
-    size_t i;
-    cargo_opt_t *opt = NULL;
-    assert(g);
-    assert(str);
+                if (opt->ranges)
+                {
+                    ret = _cargo_set_range_values(ctx, opt, name, argv[ctx->j]);
+                }
+                else if (opt->delimiter)
+                {
+                    ret = _cargo_set_delimited_values(ctx, opt, name, argv[ctx->j]);
+                }
+                else
+                {
+                    ret = _cargo_set_target_value(ctx, opt, name, argv[ctx->j]);
+                }
 
-    if (start_index >= g->opt_count)
-        return;
+                if (ret < 0)
+                {
+                    CARGODBG(1, "Failed to set target value for %s: \n", name);
+                    _cargo_set_value_error_record(ctx, opt, name);
+                    return CARGO_PARSE_FAIL_OPT;
+                }
 
-    for (i = start_index; i < g->opt_count; i++)
-    {
-        opt = &ctx->options[g->option_indices[i]];
-        cargo_aappendf(str, "%s%s", opt->name[0],
-                (i < (g->opt_count - 1)) ? ", " : "\n");
+                // If we have exceeded opt->max_target_count
+                // for CARGO_NARGS_ZERO_OR_MORE or CARGO_NARGS_ONE_OR_MORE
+                // we should stop so we don't eat all the remaining arguments.
+                if (ret)
+                    break;
+            }
+        }
     }
-}
 
-static void _cargo_print_mutex_group_highlights(cargo_t ctx,
-                                            cargo_astr_t *str,
-                                            cargo_highlight_t *parse_highlights,
-                                            size_t parsed_count)
-{
-    char *s;
-
-    if (!(s = cargo_get_fprintl_args(ctx->argc, ctx->argv, ctx->start,
-                _cargo_get_cflag(ctx), ctx->max_width,
-                parsed_count, parse_highlights)))
-    {
-        CARGODBG(1, "Out of memory\n");
-        return;
-    }
-
-    cargo_aappendf(str, "%s\n", s);
-    _cargo_free(s);
-}
+    // A streamed parse drops the arguments it is done with.
+    opt->parsed = ctx->i + (int)ctx->stream_base;
+    opt->first_parse = 0; // This is not reset between calls to cargo_parse
 
-static int _cargo_check_mutex_group(cargo_t ctx,
-                                    cargo_astr_t *str,
-                                    cargo_group_t *g)
-{
-    cargo_opt_t *opt = NULL;
-    size_t j = 0;
-    int ret = -1;
-    cargo_highlight_t *parse_highlights = NULL;
-    size_t parsed_count = 0;
-    assert(ctx);
-    assert(g);
-    assert(str);
+    // Number of arguments eaten. A positional can be interrupted by
+    // an option and continue after it, so it keeps counting.
+    eaten = (ctx->j - start);
+    opt->num_eaten = opt->positional ? (opt->num_eaten + eaten) : eaten;
 
-    parsed_count = 0;
+    CARGODBG(2, "_cargo_parse_option ate %d\n", opt->num_eaten);
 
-    // We create a list of highlights, so if more than one option in the
-    // mutex groups is parsed, we can highlight it.
-    if (!(parse_highlights = _cargo_calloc(g->opt_count,
-                                sizeof(cargo_highlight_t))))
+    // If we're parsing using a custom callback, pass it onto that.
+    if (opt->custom)
     {
-        CARGODBG(1, "Out of memory!\n");
-        goto fail;
-    }
+        int custom_eaten = 0;
 
-    for (j = 0; j < g->opt_count; j++)
-    {
-        opt = &ctx->options[g->option_indices[j]];
+        // Set the value of the return count for the caller as well:
+        // ... "[c]#", callback_func, &data, &data_count, DATA_COUNT);
+        //                                   ^^^^^^^^^^^
+        if (opt->custom_user_count)
+        {
+            CARGODBG(3, "Set custom user count: %lu\n", opt->custom_target_count);
+            *opt->custom_user_count = opt->custom_target_count;
+        }
 
-        if (opt->parsed >= 0)
+        custom_eaten = opt->custom(ctx, opt->custom_user, opt->name[0],
+                                    opt->custom_target_count, opt->custom_target);
+
+        if (custom_eaten < 0)
         {
-            parse_highlights[parsed_count].i = opt->parsed;
-            parse_highlights[parsed_count].c = "~"CARGO_COLOR_RED;
-            parsed_count++;
+            CARGODBG(1, "Custom callback indicated error\n");
+            return CARGO_PARSE_CALLBACK_ERR;
         }
+
+        CARGODBG(2, "Custom call back ate: %d\n", custom_eaten);
     }
 
-    if (parsed_count > 1)
+    // When streaming, an unbounded list that ran into the end of the
+    // pushed arguments keeps taking values from the next push.
+    if (ctx->streaming && !ctx->stream_final
+        && ((opt->nargs == CARGO_NARGS_ONE_OR_MORE)
+         || (opt->nargs == CARGO_NARGS_ZERO_OR_MORE))
+        && (ctx->j >= ctx->argc) && !ret
+        && !opt->custom && !(opt->flags & CARGO_OPT_STOP))
     {
-        _cargo_print_mutex_group_highlights(ctx, str, parse_highlights, parsed_count);
-        cargo_aappendf(str, "Only one of these variables is allowed at the same time:\n");
-        _cargo_print_mutex_group(ctx, 0, str, g);
-        goto fail;
+        ctx->stream_opt = opt;
+        ctx->stream_name = name;
     }
-    else if ((parsed_count == 0)
-            && (g->flags & CARGO_MUTEXGRP_ONE_REQUIRED))
+
+    if (opt->flags & CARGO_OPT_STOP)
     {
-        cargo_aappendf(str, "One of these variables is required:\n");
-        _cargo_print_mutex_group(ctx, 0, str, g);
-        goto fail;
+        ctx->stopped = ctx->j;
+        CARGODBG(2, "%s: Stopping parse (index %d)\n", opt->name[0], ctx->stopped);
+
+        if (opt->flags & CARGO_OPT_STOP_HARD)
+        {
+            ctx->stopped_hard = 1;
+            CARGODBG(2, "%s: Stopping HARD (Mutex groups won't be checked)\n", opt->name[0]);
+        }
     }
 
-    ret = 0;
+    return (opt->positional) ? eaten : (eaten + 1);
+}
 
-fail:
-    _cargo_xfree(&parse_highlights);
-    return ret;
+static int _cargo_compare_strlen(const void *a, const void *b)
+{
+    const char *as = *((const char **)a);
+    const char *bs = *((const char **)b);
+    size_t alen = strlen(as);
+    size_t blen = strlen(bs);
+    CARGODBG(4, "Compare length: %s (%lu) < %s (%lu) (%lu)\n",
+            as, alen, bs, blen, (alen - blen));
+    return (alen - blen);
 }
 
-static int _cargo_check_order_mutex_group(cargo_t ctx,
-                                          cargo_astr_t *str,
-                                          cargo_group_t *g)
+static int _cargo_generate_metavar(cargo_t ctx, cargo_opt_t *opt, cargo_astr_t *str)
 {
-    int ret = -1;
-    size_t i = 0;
-    cargo_opt_t *opt = NULL;
-    cargo_opt_t *first_opt = NULL;
-    cargo_highlight_t *parse_highlights = NULL;
-    int first_i = -1;
-    int is_invalid = 0;
-    size_t invalid_order_count = 0;
+    int j = 0;
+    int i = 0;
+    char metavarname[20];
     assert(ctx);
-    assert(str);
-    assert(g);
-    assert(g->flags & (CARGO_MUTEXGRP_ORDER_BEFORE | CARGO_MUTEXGRP_ORDER_AFTER));
+    assert(opt);
 
-    if (g->opt_count == 0)
+    if (opt->type == CARGO_BOOL)
     {
-        CARGODBG(1, "Warning: No options in mutex order group \"%s\"\n", g->name);
         return 0;
     }
 
-    // We create a list of highlights, so if more than one option in the
-    // mutex groups is parsed, we can highlight it.
-    if (!(parse_highlights = _cargo_calloc(g->opt_count,
-                                sizeof(cargo_highlight_t))))
+    while (_cargo_is_prefix(ctx, opt->name[0][i]))
     {
-        CARGODBG(1, "Out of memory!\n");
-        goto fail;
+        i++;
     }
 
-    // We compare all other options with the parse index of the first one.
-    first_opt = &ctx->options[g->option_indices[0]];
-    first_i = first_opt->parsed;
-
-    parse_highlights[invalid_order_count].i = first_i;
-    parse_highlights[invalid_order_count].c = "^"CARGO_COLOR_GREEN;
-
-    invalid_order_count = 1;
-
-    for (i = 1; i < g->opt_count; i++)
+    while (opt->name[0][i] && (j < (sizeof(metavarname) - 1)))
     {
-        is_invalid = 0;
-        opt = &ctx->options[g->option_indices[i]];
-
-        // Skip unparsed.
-        if (opt->parsed < 0)
-        {
-            CARGODBG(3, "  Not parsed skipping %s\n", opt->name[0]);
-            continue;
-        }
+        metavarname[j++] = toupper(opt->name[0][i++]);
+    }
 
-        CARGODBG(3, "  Check mutex order for %s\n", opt->name[0]);
+    metavarname[j] = '\0';
 
-        if (g->flags & CARGO_MUTEXGRP_ORDER_BEFORE)
-        {
-            if (opt->parsed > first_i)
-            {
-                is_invalid = 1;
-            }
-        }
-        else
-        {
-            if (opt->parsed < first_i)
-            {
-                is_invalid = 1;
-            }
-        }
+    if (opt->ranges)
+    {
+        if (cargo_aappendf(str, "%s[-%s][,...]", metavarname, metavarname) < 0)
+            return -1;
+    }
+    else if (opt->delimiter)
+    {
+        // The values are given in one argument.
+        if (cargo_aappendf(str, "%s[%c%s ...]", metavarname,
+                            opt->delimiter, metavarname) < 0)
+            return -1;
+    }
+    else if (opt->nargs < 0)
+    {
+        // List the number of arguments.
+        if (cargo_aappendf(str, "%s [%s ...]", metavarname, metavarname) < 0)
+            return -1;
+    }
+    else if (opt->nargs > 0)
+    {
+        if (cargo_aappendf(str, "%s", metavarname) < 0) return -1;
 
-        if (is_invalid)
+        for (i = 1; (int)i < opt->nargs; i++)
         {
-            CARGODBG(3, "     Invalid order, highlight index %d\n", opt->parsed);
-            parse_highlights[invalid_order_count].i = opt->parsed;
-            parse_highlights[invalid_order_count].c = "~"CARGO_COLOR_RED;
-            invalid_order_count++;
+            if (cargo_aappendf(str, " %s", metavarname) < 0) return -1;
         }
     }
-
-    if (invalid_order_count > 1)
+    else
     {
-        CARGODBG(3, "  Invalid order highlight count: %lu\n", invalid_order_count);
-        _cargo_print_mutex_group_highlights(ctx, str, parse_highlights, invalid_order_count);
-        cargo_aappendf(str, "These options must all be specified %s \"%s\":\n",
-            (g->flags & CARGO_MUTEXGRP_ORDER_BEFORE) ? "before" : "after",
-            first_opt->name[0]);
-        _cargo_print_mutex_group(ctx, 1, str, g);
-        goto fail;
+        if (cargo_aappendf(str, "%s", metavarname) < 0) return -1;
     }
 
-    ret = 0;
-
-fail:
-    _cargo_xfree(&parse_highlights);
-    return ret;
+    return 0;
 }
 
-static cargo_parse_result_t _cargo_check_mutex_groups(cargo_t ctx)
+static int _cargo_get_option_name_str(cargo_t ctx, cargo_opt_t *opt,
+    char *namebuf, size_t buf_size)
 {
+    int ret = -1;
+    size_t i;
+    char **sorted_names = NULL;
     cargo_astr_t str;
-    char *error = NULL;
-    int ret = CARGO_PARSE_MUTEX_CONFLICT;
-    size_t i = 0;
-    cargo_group_t *g = NULL;
+    char *opt_name = NULL;
     assert(ctx);
-    memset(&str, 0, sizeof(cargo_astr_t));
-    str.s = &error;
+    assert(opt);
 
-    CARGODBG(2, "Check mutex %lu groups\n", ctx->mutex_group_count);
+    namebuf[0] = '\0';
 
-    for (i = 0; i < ctx->mutex_group_count; i++)
-    {
-        g = &ctx->mutex_groups[i];
+    memset(&str, 0, sizeof(str));
+    str.s = &opt_name;
+    str.mem = &ctx->mem;
 
-        if (g->flags & (CARGO_MUTEXGRP_ORDER_BEFORE | CARGO_MUTEXGRP_ORDER_AFTER))
-        {
-            CARGODBG(2, "Order mutex group %s:\n", g->name);
+    CARGODBG(3, "%s: Sorting %lu option names:\n", opt->name[0], opt->name_count);
 
-            // Check that all options in the group is either before or after
-            // the first option of the group.
-            if (_cargo_check_order_mutex_group(ctx, &str, g))
-            {
-                ret = CARGO_PARSE_MUTEX_CONFLICT_ORDER; goto fail;
-            }
-        }
-        else
+    // Sort the names by length.
+    {
+        if (!(sorted_names = _cargo_calloc(&ctx->mem, opt->name_count, sizeof(char *))))
         {
-            CARGODBG(2, "Normal mutex group %s:\n", g->name);
+            CARGODBG(1, "%s", "Out of memory\n");
+            return -1;
+        }
 
-            // Check that only one of the group is selected.
-            if (_cargo_check_mutex_group(ctx, &str, g))
+        for (i = 0; i < opt->name_count; i++)
+        {
+            if (!(sorted_names[i] = _cargo_strdup(&ctx->mem, opt->name[i])))
             {
-                ret = CARGO_PARSE_MUTEX_CONFLICT; goto fail;
+                ret = -1; goto fail;
             }
         }
+
+        qsort(sorted_names, opt->name_count,
+            sizeof(char *), _cargo_compare_strlen);
     }
 
-    ret = CARGO_PARSE_OK;
-fail:
-    if (ret)
+    // Print the option names.
+    for (i = 0; i < opt->name_count; i++)
     {
-        _cargo_set_error(ctx, error);
+        if (opt->positional)
+            continue;
+
+        if (cargo_aappendf(&str, "%s%s",
+            sorted_names[i],
+            (i + 1 != opt->name_count) ? ", " : "") < 0)
+        {
+            goto fail;
+        }
     }
 
-    return ret;
-}
-
-static int _cargo_add_orphans_to_default_group(cargo_t ctx)
-{
-    // Instead of being able to delete options from groups
-    // we add any orphans to the default group at first use.
-    size_t i;
-    cargo_opt_t *opt = NULL;
-    assert(ctx);
-
-    for (i = 0; i < ctx->opt_count; i++)
+    // If the option has an argument, add a "metavar".
+    if ((opt->nargs != 0) || opt->positional)
     {
-        opt = &ctx->options[i];
+        char *metavar = NULL;
 
-        // Default group.
-        if (opt->group_index < 0)
+        if (opt->metavar)
         {
-            if (cargo_group_add_option(ctx, "", opt->name[0]))
+            metavar = _cargo_strdup(&ctx->mem, opt->metavar);
+        }
+        else
+        {
+            cargo_astr_t metavar_str;
+            memset(&metavar_str, 0, sizeof(metavar_str));
+            metavar_str.s = &metavar;
+            metavar_str.mem = &ctx->mem;
+
+            if (_cargo_generate_metavar(ctx, opt, &metavar_str))
             {
-                CARGODBG(1, "Failed to add \"%s\" to default group\n", opt->name[0]);
-                return -1;
+                CARGODBG(1, "Failed to generate metavar for %s\n", opt->name[0]);
+                _cargo_xfree(&ctx->mem, &metavar);
+                metavar = _cargo_strdup(&ctx->mem, opt->name[0]);
             }
         }
+
+        cargo_aappendf(&str, " %s", metavar);
+        _cargo_xfree(&ctx->mem, &metavar);
     }
 
-    return 0;
+    strncpy(namebuf, opt_name, buf_size);
+    ret = strlen(namebuf);
+
+fail:
+    i = opt->name_count;
+    _cargo_free_str_list(&ctx->mem, &sorted_names, &i);
+    _cargo_xfree(&ctx->mem, &opt_name);
+    return ret;
 }
 
-static int _cargo_is_arg_negative_integer(const char *arg)
+static char **_cargo_split(cargo_mem_t *m, const char *s,
+                           const char *splitchars, size_t *count)
 {
+    char **ss;
+    size_t i = 0;
+    char *p = NULL;
+    char *scpy = NULL;
     char *end = NULL;
-    long long int i = strtoll(arg, &end, 10);
-    return (i < 0);
-}
+    char *next = NULL;
+    size_t splitlen = strlen(splitchars);
+    assert(count);
 
-static void _cargo_check_unknown_options_gather(cargo_t ctx,
-                                                int start, int end)
-{
-    cargo_opt_t *opt = NULL;
-    char *arg = NULL;
-    const char *name = NULL;
-    assert(ctx);
+    *count = 0;
+
+    if (!s)
+        return NULL;
+
+    if (!*s)
+        return NULL;
+
+    if (!(scpy = _cargo_strdup(m, s)))
+        return NULL;
 
-    // TODO: Add support for options with negative numbers.
-    for (ctx->i = start; ctx->i < end; )
+    p = scpy;
+    end = scpy + strlen(scpy);
+    p += strspn(p, splitchars);
+
+    *count = 1;
+
+    while (*p)
     {
-        arg = ctx->argv[ctx->i];
+        // If the string ends in just splitchars
+        // don't count the last empty string.
+        if ((p + strspn(p, splitchars)) >= end)
+        {
+            break;
+        }
 
-        if (_cargo_starts_with_prefix(ctx, arg)
-        && !_cargo_is_arg_negative_integer(arg))
+        // Look for a split character.
+        for (i = 0; i < splitlen; i++)
         {
-            if (!(name = _cargo_check_options(ctx, &opt, arg)))
+            if (*p == splitchars[i])
             {
-                CARGODBG(2, "    Unknown option: %s\n", arg);
-                ctx->unknown_opts[ctx->unknown_opts_count] = arg;
-                ctx->unknown_opts_idxs[ctx->unknown_opts_count] = ctx->i;
-                ctx->unknown_opts_count++;
+                (*count)++;
+                break;
             }
         }
 
-        ctx->i++;
+        // Consume all duplicates so we don't get
+        // a bunch of empty strings.
+        p += strspn(p, splitchars) + 1;
     }
-}
 
-static cargo_parse_result_t _cargo_check_unknown_options(cargo_t ctx)
-{
-    cargo_parse_result_t ret = CARGO_PARSE_UNKNOWN_OPTS;
-    size_t i;
-    cargo_highlight_t *highlights = NULL;
-    cargo_astr_t str;
-    char *error = NULL;
-    memset(&str, 0, sizeof(str));
-    str.s = &error;
-    assert(ctx);
+    if (!(ss = _cargo_calloc(m, *count, sizeof(char *))))
+        goto fail;
 
-    // We could do a first pass for unknown options the first thing we do.
-    // Default is to wait until after parsing.
-    if (ctx->flags & CARGO_UNKNOWN_EARLY)
-    {
-        CARGODBG(2, "Check for unknown options before parsing.\n"
-                    "   CARGO_UNKNOWN_EARLY is set\n"
-                    "    Check between %d and %d\n", ctx->start, ctx->stopped);
-        _cargo_check_unknown_options_gather(ctx, ctx->start, ctx->argc);
-    }
-    else
-    {
-        CARGODBG(2, "Check for unknown options after parsing.\n"
-                    "    CARGO_UNKNOWN_EARLY is NOT set\n"
-                    "    Check between %d and %d\n", ctx->start, ctx->stopped);
-        _cargo_check_unknown_options_gather(ctx, ctx->start, ctx->stopped);
-    }
+    // Not using strtok here, since it keeps its state in a global.
+    p = scpy;
+    i = 0;
 
-    if (ctx->unknown_opts_count > 0)
+    while (i < (*count))
     {
-        const char *suggestion = NULL;
-        char *s = NULL;
+        p += strspn(p, splitchars);
 
-        if (ctx->error)
-        {
-            cargo_aappendf(&str, "%s\n", ctx->error);
-        }
+        if (!*p)
+            break;
 
-        CARGODBG(2, "Unknown options count: %lu\n", ctx->unknown_opts_count);
-        cargo_aappendf(&str, "Unknown options:\n");
+        next = p + strcspn(p, splitchars);
 
-        if (!(highlights = _cargo_calloc(ctx->unknown_opts_count,
-                                sizeof(cargo_highlight_t))))
+        if (*next)
         {
-            ret = CARGO_PARSE_NOMEM; goto fail;
+            *next++ = '\0';
         }
 
-        for (i = 0; i < ctx->unknown_opts_count; i++)
+        if (!(ss[i] = _cargo_strdup(m, p)))
         {
-            highlights[i].i = ctx->unknown_opts_idxs[i];
-            highlights[i].c = "~"CARGO_COLOR_RED;
+            goto fail;
         }
 
-        if (!(s = cargo_get_fprintl_args(ctx->argc, ctx->argv, ctx->start,
-            _cargo_get_cflag(ctx), ctx->max_width,
-            ctx->unknown_opts_count, highlights)))
-        {
-            CARGODBG(1, "Out of memory\n");
-            ret = CARGO_PARSE_NOMEM; goto fail;
-        }
+        p = next;
+        i++;
+    }
 
-        cargo_aappendf(&str, "%s\n", s);
+    // The count and number of strings must match.
+    assert(i == *count);
 
-        for (i = 0; i < ctx->unknown_opts_count; i++)
-        {
-            suggestion = _cargo_find_closest_opt(ctx, ctx->unknown_opts[i]);
-            if (!suggestion) continue;
+    _cargo_free(m, scpy);
 
-            cargo_aappendf(&str, "%s ", ctx->unknown_opts[i]);
-            cargo_aappendf(&str, " (Did you mean %s)?", suggestion);
-            cargo_aappendf(&str, "\n");
-        }
+    return ss;
+fail:
+    _cargo_xfree(m, &scpy);
+    _cargo_free_str_list(m, &ss, count);
+    return NULL;
+}
 
-        _cargo_xfree(&highlights);
-        _cargo_xfree(&s);
+static char *_cargo_linebreak(cargo_t ctx, const char *str, size_t width)
+{
+    char *s = _cargo_strdup(&ctx->mem, str);
+    char *start = s;
+    char *prev = s;
+    char *p = s;
 
-        if (!(ctx->flags & CARGO_NO_FAIL_UNKNOWN))
+    if (!s)
+        return NULL;
+
+    p = strpbrk(p, " \n");
+    while (p != NULL)
+    {
+        CARGODBG(6, "(p - start) = %ld: %.*s\n",
+            (p - start), (int)(p - start), start);
+
+        // Restart on already existing explicit line breaks.
+        if (*p == '\n')
         {
-            _cargo_set_error(ctx, error);
-            return ret;
+            CARGODBG(5, "EXISTING NEW LINE len %ld:\n%.*s\n\n",
+                (p - start), (int)(p - start), start);
+            start = p;
         }
-        else
+        else if ((size_t)(p - start) > width)
         {
-            CARGODBG(2, "No error on unknown options, CARGO_NO_FAIL_UNKNOWN set\n");
+            // We found a word that goes beyond the width we're
+            // aiming for, so add the line break before that word.
+            *prev = '\n';
+            CARGODBG(5, "ADD NEW LINE len %ld:\n%.*s\n\n",
+                (prev - start), (int)(prev - start), start);
+            start = prev;
+            continue;
         }
+
+        prev = p;
+        p = strpbrk(p + 1, " \n");
+
+        CARGODBG(5, "\n");
     }
 
-    ret = CARGO_PARSE_OK;
+    // Make sure the last line is also within "width".
+    p = strrchr(s, '\n');
+    if (!p) p = s;
 
-fail:
-    // We failed to set the error...
-    _cargo_xfree(&error);
-    _cargo_xfree(&highlights);
-    return ret;
+    if ((size_t)((s + strlen(s)) - p) > width)
+    {
+        *prev = '\n';
+    }
+
+    return s;
 }
 
-static cargo_parse_result_t _cargo_check_unknown_options_after(cargo_t ctx)
+static void _cargo_add_help_if_missing(cargo_t ctx)
 {
     assert(ctx);
 
-    // This check has already been done.
-    if (ctx->flags & CARGO_UNKNOWN_EARLY)
+    if (!(ctx->flags & CARGO_NO_AUTOHELP)
+        && _cargo_find_option_name(ctx, "--help", NULL, NULL))
     {
-        return CARGO_PARSE_OK;
-    }
+        if (cargo_add_option(ctx, 0, "--help", "Show this help", "b", &ctx->help))
+        {
+            CARGODBG(1, "Failed to add --help\n");
+            return;
+        }
 
-    // We must have a stop index so we know for what span to check for unknown
-    // options. Any options remaining after the stop index will be excluded in
-    // this check.
-    if (!ctx->stopped)
-    {
-        CARGODBG(2, "Stop at end of argv after parse: %d\n", ctx->argc);
-        ctx->stopped = ctx->argc;
-    }
-    else
-    {
-        CARGODBG(2, "Stopped by option at index: %d\n", ctx->stopped);
+        if (_cargo_find_option_name(ctx, "-h", NULL, NULL))
+        {
+            cargo_add_alias(ctx, "--help", "-h");
+        }
     }
-
-    // TODO: Only append errors.
-    return _cargo_check_unknown_options(ctx);
 }
 
-static void _cargo_parse_show_error(cargo_t ctx)
+//
+// The Damerau-Levenshtein distance between two strings, but only as far as
+// a suggestion cares. Returns 0 if they are equal, 1 if a single insert,
+// delete, substitution or swap of two adjacent characters turns one into
+// the other, and 2 for anything further apart. Nothing is allocated, and
+// each string is gone through at most once past their common prefix.
+//
+static int _cargo_bounded_edit_dist(const char *s, size_t n,
+                                    const char *t, size_t m)
 {
-    FILE *fd = (ctx->flags & CARGO_STDOUT_ERR) ? stdout : stderr;
-    assert(ctx);
+    size_t p = 0;
 
-    if (!ctx->error)
-        return;
+    if (((n > m) ? (n - m) : (m - n)) > 1)
+        return 2;
 
-    if (!(ctx->flags & CARGO_NOERR_USAGE))
-    {
-        cargo_fprint_usage(ctx, fd, ctx->usage_flags);
-    }
+    while ((p < n) && (p < m) && (s[p] == t[p]))
+        p++;
 
-    // Show errors automatically?
-    if (!(ctx->flags & CARGO_NOERR_OUTPUT))
+    if ((p == n) && (p == m))
+        return 0;
+
+    if (n == m)
     {
-        fprintf(fd, "%s\n", ctx->error);
+        // Substitution.
+        if (!memcmp(s + p + 1, t + p + 1, n - p - 1))
+            return 1;
+
+        // Adjacent characters swapped.
+        if (((p + 1) < n) && (s[p] == t[p + 1]) && (s[p + 1] == t[p])
+            && !memcmp(s + p + 2, t + p + 2, n - p - 2))
+            return 1;
+
+        return 2;
     }
+
+    // Insert or delete.
+    if (n > m)
+        return memcmp(s + p + 1, t + p, n - p - 1) ? 2 : 1;
+
+    return memcmp(s + p, t + p + 1, m - p - 1) ? 2 : 1;
 }
 
-static int _cargo_get_max_name_length(cargo_t ctx,
-            size_t *positional_count, size_t *option_count)
+static int _cargo_build_suggest_names(cargo_t ctx)
 {
-    #define MAX_OPT_NAME_LEN 40
-    size_t i = 0;
-    int namelen = 0;
-    int max_name_len = 0;
-    char *name = NULL;
-    cargo_opt_t *opt = NULL;
-    assert(ctx);
-    assert(positional_count);
-    assert(option_count);
+    size_t i;
+    size_t j;
+    size_t count = 0;
+    cargo_suggest_name_t *sn = NULL;
 
-    (*positional_count) = 0;
-    (*option_count) = 0;
+    for (i = 0; i < ctx->opt_count; i++)
+    {
+        count += ctx->options[i].name_count;
+    }
 
-    // TODO: Replace with cargo_astr_t so we don't have to prealloc max_width
-    if (!(name = _cargo_malloc(ctx->max_width)))
+    if (!(ctx->suggest_names = _cargo_arena_calloc(&ctx->arena,
+                                CARGO_MAX(count, 1), sizeof(cargo_suggest_name_t))))
     {
-        CARGODBG(1, "Out of memory!\n");
         return -1;
     }
 
     for (i = 0; i < ctx->opt_count; i++)
     {
-        opt = &ctx->options[i];
-
-        if (opt->flags & CARGO_OPT_HIDE)
+        for (j = 0; j < ctx->options[i].name_count; j++)
         {
-            continue;
+            sn = &ctx->suggest_names[ctx->suggest_name_count++];
+            sn->name = ctx->options[i].name[j];
+            sn->name += strspn(sn->name, ctx->prefix);
+            sn->len = strlen(sn->name);
+            sn->opt_i = i;
+            sn->name_i = j;
         }
+    }
 
-        if (opt->positional)
-        {
-            (*positional_count)++;
-        }
-        else
-        {
-            (*option_count)++;
-        }
+    return 0;
+}
 
-        namelen = _cargo_get_option_name_str(ctx, opt,
-                                            name, ctx->max_width);
+const char *_cargo_find_closest_opt(cargo_t ctx, const char *unknown)
+{
+    size_t k;
+    size_t n;
+    size_t best = 0;
+    int min_dist = 2;
+    int dist = 0;
+    cargo_suggest_name_t *sn = NULL;
 
-        if (namelen < 0)
-        {
-            max_name_len = -1;
-            goto fail;
-        }
+    // The names are stripped and measured once for all unknown options.
+    if (!ctx->suggest_names && _cargo_build_suggest_names(ctx))
+    {
+        return NULL;
+    }
 
-        // Get the longest option name.
-        // (However, if it's too long don't count it, then we'll just
-        // do a line break before printing the description).
-        if ((namelen > max_name_len) && (namelen <= MAX_OPT_NAME_LEN))
+    unknown += strspn(unknown, ctx->prefix);
+    n = strlen(unknown);
+
+    // Only a name at most one edit away is suggested, so the first
+    // one that is that close wins, unless there is an exact match.
+    for (k = 0; (k < ctx->suggest_name_count) && (min_dist > 0); k++)
+    {
+        sn = &ctx->suggest_names[k];
+
+        if (((n > sn->len) ? (n - sn->len) : (sn->len - n)) > 1)
+            continue;
+
+        dist = _cargo_bounded_edit_dist(unknown, n, sn->name, sn->len);
+
+        if (dist < min_dist)
         {
-            max_name_len = namelen;
+            min_dist = dist;
+            best = k;
         }
     }
 
-fail:
-    _cargo_xfree(&name);
+    if (min_dist > 1)
+        return NULL;
 
-    return max_name_len;
+    sn = &ctx->suggest_names[best];
+    return ctx->options[sn->opt_i].name[sn->name_i];
 }
 
-static int _cargo_get_group_description(cargo_t ctx, cargo_astr_t *str,
-                                        cargo_group_t *grp, int indent)
+static int _cargo_fit_optnames_and_description(cargo_t ctx, cargo_astr_t *str,
+                size_t i, int name_padding, int option_causes_newline, int max_name_len)
 {
+    size_t j;
+    cargo_opt_t *opt = NULL;
     int ret = -1;
-    size_t j = 0;
-    char *lb_desc = NULL;
+    assert(str);
+    assert(ctx);
+
     char **desc_lines = NULL;
     size_t line_count = 0;
-    assert(ctx);
-    assert(str);
-    assert(grp);
 
-    if (!grp->description || strlen(grp->description) == 0)
+    int padding = 0;
+
+    // We want to fit the opt names + description within max_width
+    // We already know the width of the opt names (max_name_len)
+    // so calculate how wide the description is allowed to be
+    // including any spaces and padding between them.
+    size_t max_desc_len =
+        ctx->max_width  // Total width of names + description.
+        - 2             // 2 for spaces before/after opt " --opt ".
+        - max_name_len  // The longest of the opt names.
+        - name_padding; // Padding.
+
+    char *opt_description = NULL;
+
+    CARGODBG(2, "max_desc_len = %lu\n", max_desc_len);
+    CARGODBG(2, "str.l = %lu\n", str->l);
+    CARGODBG(2, "str.offset = %lu\n", str->offset);
+    opt = &ctx->options[i];
+
+    // No description for option.
+    if (!opt->description)
     {
+        cargo_aappendf(str, "\n");
         return 0;
     }
 
-    if (grp->flags & CARGO_GROUP_RAW_DESCRIPTION)
+    opt_description = _cargo_linebreak(ctx, opt->description,
+                                            max_desc_len);
+
+    if (!opt_description)
     {
-        cargo_aappendf(str, "%*s%s\n", indent, " ", grp->description);
+        CARGODBG(1, "%s: Failed to line break option description\n", opt->name[0]);
+        goto fail;
     }
-    else
+
+    CARGODBG(5, "ctx->max_width - 2 - max_name_len - (2 * NAME_PADDING) =\n");
+    CARGODBG(5, "%lu - 2 - %d - (2 * %d) = %lu\n",
+        ctx->max_width, max_name_len,
+        name_padding,
+        max_desc_len);
+
+    if (!(desc_lines = _cargo_split(&ctx->mem, opt_description, "\n", &line_count)))
     {
-        if (!(lb_desc = _cargo_linebreak(ctx, grp->description, ctx->max_width)))
+        CARGODBG(1, "Failed to split option description\n");
+        goto fail;
+    }
+
+    for (j = 0; j < line_count; j++)
+    {
+        if ((j == 0) && !option_causes_newline)
         {
-            goto fail;
+            // --theoption  Description <- First line of description.
+            padding = 0;
         }
-
-        if (!(desc_lines = _cargo_split(lb_desc, "\n", &line_count)))
+        else
         {
-            CARGODBG(1, "Failed to split group description\n");
-            goto fail;
+            // --theoption  Description
+            //              continues here <- Now we want pre-padding.
+            // ---------------------------------------------------------
+            // --reallyreallyreallyreallylongoption
+            //              Description    <- First line but pad anyway.
+            //              continues here
+            padding = max_name_len + name_padding;
         }
 
-        for (j = 0; j < line_count; j++)
+        if (cargo_aappendf(str, "  %*s%s\n",
+            padding, "", desc_lines[j]) < 0)
         {
-            cargo_aappendf(str, "%*s%s\n", indent, " ", desc_lines[j]);
+            CARGODBG(1, "Failed to append\n");
+            goto fail;
         }
     }
 
     ret = 0;
 fail:
-    _cargo_xfree(&lb_desc);
-    _cargo_free_str_list(&desc_lines, &line_count);
+    _cargo_xfree(&ctx->mem, &opt_description);
+    _cargo_free_str_list(&ctx->mem, &desc_lines, &line_count);
 
     return ret;
 }
 
-void _cargo_invalid_format_char(cargo_t ctx,
-                                    const char *optname, const char *fmt,
-                                    cargo_fmt_scanner_t *s)
-{
-    assert(ctx);
-    assert(optname);
-    assert(s);
-
-    CARGODBG(1, "  %s: Unknown format character '%c' at index %d\n",
-            optname, _cargo_fmt_token(s), s->column);
-    CARGODBG(1, "      \"%s\"\n", fmt);
-    CARGODBG(1, "       %*s\n", s->column, "^");
-}
-
-static int _cargo_check_required_options(cargo_t ctx)
+static int _cargo_mutex_group_should_be_grouped(cargo_t ctx,
+            cargo_opt_t *opt, int short_usage)
 {
-    cargo_astr_t errstr;
-    char *error = NULL;
+    cargo_group_t *mgrp = NULL;
     size_t i;
-    cargo_opt_t *opt = NULL;
-    memset(&errstr, 0, sizeof(cargo_astr_t));
-    errstr.s = &error;
+    assert(opt);
 
-    for (i = 0; i < ctx->opt_count; i++)
+    for (i = 0; i < opt->mutex_group_count; i++)
     {
-        opt = &ctx->options[i];
+        assert(opt->mutex_group_idxs[i] < ctx->mutex_group_count);
+        mgrp = &ctx->mutex_groups[opt->mutex_group_idxs[i]];
 
-        if ((opt->flags & CARGO_OPT_REQUIRED) && (opt->parsed < 0))
-        {
-            CARGODBG(1, "Missing required argument \"%s\"\n", opt->name[0]);
-            cargo_aappendf(&errstr, "Missing required argument \"%s\"\n", opt->name[0]);
+        if (mgrp->flags & (CARGO_MUTEXGRP_ORDER_BEFORE | CARGO_MUTEXGRP_ORDER_AFTER))
+            continue;
 
-            _cargo_set_error(ctx, error);
-            return -1;
+        if (short_usage)
+        {
+            if (!(mgrp->flags & CARGO_MUTEXGRP_NO_GROUP_SHORT_USAGE))
+            {
+                return 1;
+            }
         }
-
-        if (opt->parsed >= 0)
+        else
         {
-            if (((opt->nargs == CARGO_NARGS_ONE_OR_MORE) && (opt->num_eaten == 0))
-             || ((opt->nargs >= 0) && (opt->num_eaten != opt->nargs)))
+            if (mgrp->flags & CARGO_MUTEXGRP_GROUP_USAGE)
             {
-                CARGODBG(1, "Not enough arguments. Expected %s, got %d\n",
-                        _cargo_nargs_str(opt->nargs), opt->num_eaten);
-
-                // TODO: Highlight option (ctx->parsed is the index into argv)
-
-                if (opt->num_eaten == 0)
-                {
-                    cargo_aappendf(&errstr,
-                        "Not enough arguments for \"%s\" expected %s "
-                        "but got none\n", opt->name[0],
-                        _cargo_nargs_str(opt->nargs));
-                }
-                else
-                {
-                    cargo_aappendf(&errstr,
-                        "Not enough arguments for \"%s\" expected %s "
-                        "but got only %d\n", opt->name[0],
-                        _cargo_nargs_str(opt->nargs), opt->num_eaten);
-                }
-
-                _cargo_set_error(ctx, error);
-                return -1;
+                return 1;
             }
         }
     }
@@ -4083,7719 +5962,14225 @@ static int _cargo_check_required_options(cargo_t ctx)
     return 0;
 }
 
-static size_t _cargo_process_max_width(size_t max_width)
+static int _cargo_print_options(cargo_t ctx,
+                                size_t *opt_indices, size_t opt_count,
+                                int show_positional, cargo_astr_t *str,
+                                int max_name_len, int indent, int is_mutex,
+                                cargo_usage_t flags)
 {
-    int console_width;
-    size_t maxw = CARGO_DEFAULT_MAX_WIDTH;
+    #define NAME_PADDING 2
+    size_t i = 0;
+    size_t opt_i;
+    cargo_opt_t *opt = NULL;
+    int option_causes_newline = 0;
+    size_t namelen = 0;
+    char *name = NULL;
+    int ret = -1;
+    assert(str);
+    assert(ctx);
 
-    if (max_width == CARGO_AUTO_MAX_WIDTH)
+    // TODO: Replace with cargo_astr_t so we don't have to prealloc max_width
+    if (!(name = _cargo_malloc(&ctx->mem, ctx->max_width)))
     {
-        CARGODBG(2, "User specified CARGO_AUTO_MAX_WIDTH\n");
+        CARGODBG(1, "Out of memory!\n");
+        return -1;
+    }
 
-        if ((console_width = _cargo_get_console_width()) > 0)
+    // Option names + descriptions.
+    for (i = 0; i < opt_count; i++)
+    {
+        opt_i = opt_indices[i];
+        opt = &ctx->options[opt_i];
+
+        if (opt->flags & CARGO_OPT_HIDE)
         {
-            CARGODBG(2, "Max width based on console width: %d\n", console_width);
-            maxw = console_width;
+            continue;
         }
-        else
+
+        // We don't show this in its normal position since it is a member of
+        // a mutex group that should be grouped in the usage.
+        if (_cargo_mutex_group_should_be_grouped(ctx, opt, 0) && !is_mutex)
         {
-            CARGODBG(2, "Max width set to CARGO_DEFAULT_MAX_WIDTH = %d\n",
-                    CARGO_DEFAULT_MAX_WIDTH);
+            continue;
         }
-    }
-    else
-    {
-        CARGODBG(2, "User specified max width: %lu\n", max_width);
-        maxw = max_width;
-    }
 
-    // Since we allocate memory based on this later on, make sure this
-    // is something sane. Anything above 1024 characters is more than enough.
-    // Also some systems might have a really big console width for instance.
-    // (This happened on drone.io continous integration service).
-    if (maxw > CARGO_MAX_MAX_WIDTH)
-    {
-        CARGODBG(2, "Max width too large, capping at: %d\n", CARGO_MAX_MAX_WIDTH);
-        maxw = CARGO_MAX_MAX_WIDTH;
+        // Skip options depending on type so we can group them by
+        // calling this function multiple times.
+        if ((show_positional && !opt->positional)
+         || (!show_positional && opt->positional))
+        {
+            continue;
+        }
+
+        // TODO: Hmmm maybe store option max length in the opt struct instead when adding?
+        namelen = _cargo_get_option_name_str(ctx, opt,
+                                            name, ctx->max_width);
+
+        // Is the option name so long we need a new line before the description?
+        option_causes_newline = (int)strlen(name) > max_name_len;
+
+        // Print the option names.
+        // "  --ducks [DUCKS ...]  "
+        if (cargo_aappendf(str, "%*s%-*s%s",
+                indent + NAME_PADDING, " ",
+                max_name_len, name,
+                (option_causes_newline ? "\n" : "")) < 0)
+        {
+            goto fail;
+        }
+
+        // Option description.
+        if ((flags & CARGO_USAGE_RAW_OPT_DESCRIPTIONS)
+            || (opt->flags & CARGO_OPT_RAW_DESCRIPTION))
+        {
+            CARGODBG(5, "%s: RAW DESCRIPTION\n", opt->name[0]);
+
+            if (cargo_aappendf(str, "%*s%s\n",
+                NAME_PADDING, "", opt->description) < 0)
+            {
+                goto fail;
+            }
+        }
+        else
+        {
+            // Add line breaks to fit the width we want.
+            if (_cargo_fit_optnames_and_description(ctx, str, opt_i,
+                    indent + NAME_PADDING, option_causes_newline, max_name_len))
+            {
+                goto fail;
+            }
+        }
     }
 
-    return maxw;
+    ret = 0;
+
+fail:
+    _cargo_xfree(&ctx->mem, &name);
+    return ret;
 }
 
-static int _cargo_set_group_context(cargo_t ctx,
-        const char *group, cargo_group_t *groups, size_t group_count, void *user)
+static int _cargo_get_short_option_usage(cargo_t ctx,
+                                        cargo_opt_t *opt,
+                                        cargo_astr_t *str,
+                                        int is_positional,
+                                        int show_is_optional)
 {
-    cargo_group_t *grp = NULL;
+    int is_req;
+    char *metavar = NULL;
     assert(ctx);
+    assert(opt);
+    assert(str);
 
-    // If a NULL group is given, we interpret that as the default "" group.
-    if (!group)
+    if ((opt->flags & CARGO_OPT_HIDE) || (opt->flags & CARGO_OPT_HIDE_SHORT))
     {
-        group = "";
+        return 1;
     }
 
-    grp = _cargo_find_group(ctx, groups, group_count, group, NULL);
-
-    if (!grp)
+    // Positional arguments.
+    if (is_positional && !opt->positional)
     {
-        CARGODBG(1, "No such group \"%s\"\n", group);
-        return -1;
+        return 1;
     }
 
-    grp->user = user;
+    // Options.
+    if (!is_positional && opt->positional)
+    {
+        return 1;
+    }
 
-    return 0;
-}
+    if (opt->metavar)
+    {
+        metavar = _cargo_strdup(&ctx->mem, opt->metavar);
+    }
+    else
+    {
+        cargo_astr_t metavar_str;
+        memset(&metavar_str, 0, sizeof(metavar_str)),
+        metavar_str.s = &metavar;
+        metavar_str.mem = &ctx->mem;
 
-static void * _cargo_get_group_context(cargo_t ctx, const char *group,
-                cargo_group_t *groups, size_t group_count)
-{
-    cargo_group_t *grp = NULL;
-    assert(ctx);
+        if (_cargo_generate_metavar(ctx, opt, &metavar_str))
+        {
+            CARGODBG(1, "Failed to generate metavar\n");
+            return -1;
+        }
+    }
 
-    grp = _cargo_find_group(ctx, groups, group_count, group, NULL);
+    is_req = (opt->flags & CARGO_OPT_REQUIRED);
 
-    if (!grp)
+    if (show_is_optional && !is_req)
     {
-        CARGODBG(1, "No such group \"%s\"\n", group);
-        return NULL;
+        cargo_aappendf(str, "[");
     }
 
-    return grp->user;
-}
-
-static const char *_cargo_option_get_group(cargo_t ctx, const char *opt,
-                        cargo_group_t *groups, size_t group_count)
-{
-    cargo_opt_t *o = NULL;
-    size_t opt_i;
-    assert(ctx);
-    assert(opt);
-
-    if (_cargo_find_option_name(ctx, opt, &opt_i, NULL) < 0)
+    if (!opt->positional)
     {
-        CARGODBG(1, "No such option \"%s\"\n", opt);
-        return NULL;
+        cargo_aappendf(str, "%s", opt->name[0]);
     }
 
-    o = &ctx->options[opt_i];
+    if (metavar && *metavar)
+    {
+        cargo_aappendf(str, " %s", metavar);
+    }
 
-    if (o->group_index < 0)
+    if (show_is_optional && !is_req)
     {
-        CARGODBG(1, "%s: Group is not set\n", opt);
-        return NULL;
+        cargo_aappendf(str, "]");
     }
 
-    CARGODBG(3, "Opt idx: %lu, Group idx: %d, Group name: \"%s\"\n",
-            opt_i, o->group_index, groups[o->group_index].title);
+    if (metavar)
+        _cargo_free(&ctx->mem, metavar);
 
-    return groups[o->group_index].name;
+    return 0;
 }
 
-static void _cargo_mutex_group_short_usage(cargo_t ctx,
-                        cargo_astr_t *str, size_t indent)
+static void _cargo_fit_on_short_usage_line(cargo_t ctx, cargo_astr_t *str,
+                                            size_t indent,
+                                            size_t cur_offset,
+                                            size_t opt_offset,
+                                            size_t *prev_offset)
+{
+    assert(ctx);
+    assert(prev_offset);
+    assert(str);
+
+    if ((cur_offset + opt_offset - (*prev_offset)) >= ctx->max_width)
+    {
+        *prev_offset = cur_offset;
+        cargo_aappendf(str, "\n%*s", indent, " ");
+    }
+}
+
+static int _cargo_get_short_option_usages(cargo_t ctx,
+                                        cargo_astr_t *str,
+                                        size_t indent,
+                                        int is_positional)
 {
-    int ret = 0;
     size_t i;
-    size_t j;
+    int ret;
+    cargo_astr_t opt_str;
     size_t prev_offset = 0;
-    cargo_group_t *mgrp = NULL;
     cargo_opt_t *opt = NULL;
-    cargo_astr_t opt_str;
     char *opt_s = NULL;
     assert(ctx);
     assert(str);
 
-    for (i = 0; i < ctx->mutex_group_count; i++)
+    for (i = 0; i < ctx->opt_count; i++)
     {
-        mgrp = &ctx->mutex_groups[i];
+        memset(&opt_str, 0, sizeof(opt_str));
+        opt_str.s = &opt_s;
+        opt_str.mem = &ctx->mem;
+        opt = &ctx->options[i];
 
-        if (mgrp->flags & (CARGO_MUTEXGRP_ORDER_BEFORE | CARGO_MUTEXGRP_ORDER_AFTER))
+        if (opt->flags & CARGO_OPT_HIDE)
         {
             continue;
         }
 
-        // Given by the user to override.
-        if (mgrp->metavar)
+        // We display this seperately in _cargo_mutex_group_short_usage
+        if (_cargo_mutex_group_should_be_grouped(ctx, opt, 1))
         {
-            memset(&opt_str, 0, sizeof(opt_str));
-            opt_str.s = &opt_s;
-            cargo_aappendf(&opt_str, " %s", mgrp->metavar);
-
-            _cargo_fit_on_short_usage_line(ctx, str,
-                indent, str->offset, opt_str.offset, &prev_offset);
+            continue;
+        }
 
-            if (opt_s)
-            {
-                cargo_aappendf(str, "%s", opt_s);
-                _cargo_xfree(&opt_s);
-            }
+        cargo_aappendf(&opt_str, " ");
 
-            continue;
+        if ((ret = _cargo_get_short_option_usage(ctx, opt,
+                                &opt_str, is_positional, 1)) < 0)
+        {
+            CARGODBG(1, "Failed to get option usage\n");
+            goto fail;
         }
 
-        // If we should group the options in the mutex group like this
-        // {opt1, opt2, opt3} or [opt1, opt2, opt3].
-        if ((mgrp->flags & CARGO_MUTEXGRP_NO_GROUP_SHORT_USAGE))
+        if (ret == 1)
         {
+            _cargo_xfree(&ctx->mem, &opt_s);
             continue;
         }
 
-        // Instead of printing the {} before and after loop we include it
-        // in the string inside the loop together with the option name
-        // so that we always get a nice linebreak like this:
-        //   {opt1, opt2}
-        // compared to:
-        //   {
-        //   opt1, opt2}
+        // Does the option fit on this line?
+        _cargo_fit_on_short_usage_line(ctx, str,
+            indent, str->offset, opt_str.offset, &prev_offset);
 
-        for (j = 0; j < mgrp->opt_count; j++)
+        if (opt_s)
         {
-            int is_first = (j == 0);
-            int is_last = (j == (mgrp->opt_count - 1));
-            char is_req = (mgrp->flags & CARGO_MUTEXGRP_ONE_REQUIRED);
+            cargo_aappendf(str, "%s", opt_s);
+            _cargo_xfree(&ctx->mem, &opt_s);
+        }
+    }
 
-            memset(&opt_str, 0, sizeof(opt_str));
-            opt_str.s = &opt_s;
+    return 0;
+fail:
+    _cargo_xfree(&ctx->mem, &opt_s);
+    return -1;
+}
 
-            opt = &ctx->options[mgrp->option_indices[j]];
+static char **_cargo_split_and_verify_option_names(cargo_t ctx,
+                                                    const char *optnames,
+                                                    size_t *optcount)
+{
+    char **optname_list = NULL;
+    char *tmp = NULL;
+    assert(ctx);
+    assert(optcount);
 
-            if (is_first) cargo_aappendf(&opt_str, "%s", (is_req ? " {" : " ["));
+    if (!(tmp = _cargo_strdup(&ctx->mem, optnames)))
+    {
+        return NULL;
+    }
 
-            if ((ret = _cargo_get_short_option_usage(ctx, opt,
-                            &opt_str, opt->positional, 0)) < 0)
-            {
-                CARGODBG(1, "Failed to get option usage\n");
-                return;
-            }
-
-            if (!is_last) cargo_aappendf(&opt_str, ", ");
-            if (is_last) cargo_aappendf(&opt_str, "%s", (is_req ? "}" : "]"));
-
-            _cargo_fit_on_short_usage_line(ctx, str,
-                indent, str->offset, opt_str.offset, &prev_offset);
+    if (!(optname_list = _cargo_split(&ctx->mem, tmp, " ", optcount))
+        || (*optcount <= 0))
+    {
+        CARGODBG(1, "Failed to split option name list: \"%s\"\n", optnames);
+        goto fail;
+    }
 
-            if (opt_s)
-            {
-                cargo_aappendf(str, "%s", opt_s);
-                _cargo_xfree(&opt_s);
-            }
+    #ifdef CARGO_DEBUG
+    {
+        size_t i;
+        CARGODBG(3, "Got %lu option names:\n", *optcount);
+        for (i = 0; i < *optcount; i++)
+        {
+            CARGODBG(3, " %s\n", optname_list[i]);
         }
     }
-}
+    #endif // CARGO_DEBUG
 
-static const char *_cargo_strip_path_from_progname(const char *org_progname)
-{
-    const char *progname;
+    if (!_cargo_find_option_name(ctx, optname_list[0], NULL, NULL))
+    {
+        CARGODBG(1, "%s already exists\n", optname_list[0]);
+        goto fail;
+    }
 
-    // Strip any directory path from the program name.
-    if (!(progname = strrchr(org_progname, '/')))
+    // If this is a positional argument it has to start with
+    // [a-zA-Z]
+    if (!_cargo_starts_with_prefix(ctx, optname_list[0]))
     {
-        if (!(progname = strrchr(org_progname, '\\')))
+        if (strpbrk(optname_list[0],
+            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ")
+            != optname_list[0])
         {
-            progname = org_progname;
+            CARGODBG(1, "A positional argument must start with [a-zA-Z]\n");
+            goto fail;
         }
     }
 
-    progname += strspn(progname, "/\\");
+    _cargo_free(&ctx->mem, tmp);
+    return optname_list;
 
-    return progname;
+fail:
+    _cargo_xfree(&ctx->mem, &tmp);
+    _cargo_free_str_list(&ctx->mem, &optname_list, optcount);
+
+    return NULL;
 }
 
-static const char *_cargo_get_short_usage(cargo_t ctx, cargo_usage_t flags)
+static cargo_opt_t *_cargo_option_init(cargo_t ctx,
+                                        const char *name,
+                                        const char *description)
 {
-    char *b = NULL;
-    size_t indent = 0;
-    cargo_astr_t str;
-    const char *progname;
+    char *optname = NULL;
+    cargo_opt_t *o = NULL;
     assert(ctx);
 
-    _cargo_add_help_if_missing(ctx);
-    _cargo_add_orphans_to_default_group(ctx);
-
-    memset(&str, 0, sizeof(str));
-    str.s = &b;
-
-    if ((flags & CARGO_USAGE_NO_STRIP_PROGNAME))
-    {
-        progname = ctx->progname;
-    }
-    else
+    if (_cargo_grow_options(&ctx->mem, &ctx->options, &ctx->opt_count, &ctx->max_opts))
     {
-        progname = _cargo_strip_path_from_progname(ctx->progname);
+        return NULL;
     }
 
-    cargo_aappendf(&str, "Usage: %s", progname);
+    o = &ctx->options[ctx->opt_count];
+    memset(o, 0, sizeof(cargo_opt_t));
+    ctx->opt_count++;
 
-    if (!(flags & CARGO_USAGE_OVERRIDE_SHORT))
+    if (o->name_count >= CARGO_NAME_COUNT)
     {
-        indent = str.offset;
-
-        // Options.
-        _cargo_get_short_option_usages(ctx, &str, indent, 0);
-
-        _cargo_mutex_group_short_usage(ctx, &str, indent);
-
-        // Positional arguments at the end.
-        _cargo_get_short_option_usages(ctx, &str, indent, 1);
+        CARGODBG(1, "Max %d names allowed\n", CARGO_NAME_COUNT);
+        return NULL;
     }
 
-    // Reallocate the memory used for the string so it's too big.
-    if (!(b = _cargo_realloc(b, str.offset + 1)))
+    if (!(optname = _cargo_strdup(&ctx->mem, name)))
     {
-        CARGODBG(1, "Out of memory!\n");
+        CARGODBG(1, "Out of memory\n");
         return NULL;
     }
 
-    // We are always responsible to free this.
-    _cargo_xfree(&ctx->short_usage);
-
-    ctx->short_usage = b;
-
-    return b;
-}
-
-char **_cargo_copy_string_list(char **strs, size_t count, size_t *target_count)
-{
-    char **ret = NULL;
-    size_t i;
-
-    if (target_count) *target_count = 0;
+    o->name[o->name_count] = optname;
+    o->name_count++;
 
-    if (!strs)
+    if (_cargo_name_index_add(ctx, ctx->opt_count - 1, 0))
     {
         return NULL;
     }
 
-    if (!(ret = _cargo_calloc(count, sizeof(char *))))
+    if (description && !(o->description = _cargo_strdup(&ctx->mem, description)))
     {
-        CARGODBG(1, "Out of memory!\n");
+        CARGODBG(1, "Out of memory\n");
         return NULL;
     }
 
-    if (target_count) *target_count = count;
+    return o;
+}
 
-    for (i = 0; i < count; i++)
+static void _cargo_option_destroy(cargo_mem_t *m, cargo_opt_t *o)
+{
+    size_t j;
+
+    if (!o)
     {
-        if (!(ret[i] = _cargo_strdup(strs[i])))
-        {
-            CARGODBG(1, "Out of memory\n");
-            goto fail;
-        }
+        return;
     }
 
-    return ret;
-fail:
-    if (ret)
+    for (j = 0; j < o->name_count; j++)
     {
-        count = i;
-        for (i = 0; i < count; i++)
-        {
-            _cargo_free(ret[i]);
-        }
-
-        _cargo_free(ret);
+        CARGODBG(2, "###### FREE OPTION NAME: %s\n", o->name[j]);
+        _cargo_xfree(m, &o->name[j]);
     }
 
-    if (target_count) *target_count = 0;
+    o->name_count = 0;
 
-    return NULL;
-}
+    _cargo_xfree(m, &o->description);
+    _cargo_xfree(m, &o->metavar);
+    _cargo_xfree(m, &o->bool_acc);
+    o->bool_acc_count = 0;
+    o->bool_acc_max_count = 0;
 
-// -----------------------------------------------------------------------------
-// Public functions
-// -----------------------------------------------------------------------------
+    // Special case for custom callback target, it is allocated
+    // internally so we should always auto clean it.
+    _cargo_free_str_list(m, &o->custom_target, &o->custom_target_count);
+    _cargo_free_str_list(m, &o->mutex_group_names, &o->mutex_group_count);
 
-void cargo_set_internal_usage_flags(cargo_t ctx, cargo_usage_t flags)
-{
-    assert(ctx);
-    ctx->usage_flags = flags;
+    _cargo_option_destroy_validation(o);
 }
 
-int cargo_get_width(cargo_t ctx, cargo_width_flags_t flags)
+typedef struct cargo_fmt_token_s
 {
-    int ret = 0;
-    assert(ctx);
+    int column;
+    char token;
+} cargo_fmt_token_t;
 
-    ret = (int)ctx->max_width;
+typedef struct cargo_fmt_scanner_s
+{
+    const char *fmt;
+    const char *start;
+    cargo_fmt_token_t prev_token;
+    cargo_fmt_token_t token;
+    cargo_fmt_token_t next_token;
 
-    if (flags & CARGO_WIDTH_RAW)
-    {
-        ret = _cargo_get_console_width();
-    }
+    int column;
+} cargo_fmt_scanner_t;
 
-    return ret;
+static char _cargo_fmt_token(cargo_fmt_scanner_t *s)
+{
+    return s->token.token;
 }
 
-void cargo_set_max_width(cargo_t ctx, size_t max_width)
+static void _cargo_fmt_scanner_init(cargo_fmt_scanner_t *s,
+                                    const char *fmt)
 {
-    assert(ctx);
-    ctx->max_width = _cargo_process_max_width(max_width);
-    CARGODBG(2, "Usage max width: %lu\n", ctx->max_width);
+    assert(s);
+    memset(s, 0, sizeof(cargo_fmt_scanner_t));
+
+    CARGODBG(2, "FMT scanner init: \"%s\"\n", fmt);
+    s->fmt = fmt;
+    s->start = fmt;
+    s->column = 0;
+
+    s->token.token = *fmt;
 }
 
-int cargo_init(cargo_t *ctx, cargo_flags_t flags, const char *progname_fmt, ...)
+static void _cargo_fmt_next_token(cargo_fmt_scanner_t *s)
 {
-    va_list ap;
-    cargo_s *c;
-    assert(ctx);
+    const char *fmt;
 
-    *ctx = (cargo_s *)_cargo_calloc(1, sizeof(cargo_s));
-    c = *ctx;
+    CARGODBG(4, "\"%s\"\n", s->start);
+    CARGODBG(4, " %*s\n", s->token.column, "^");
 
-    if (!c)
-        return -1;
+    s->prev_token = s->token;
 
-    c->max_opts = CARGO_DEFAULT_MAX_OPTS;
-    c->flags = flags;
-    c->prefix = CARGO_DEFAULT_PREFIX;
-    cargo_set_max_width(c, CARGO_AUTO_MAX_WIDTH);
+    s->column++;
 
-    va_start(ap, progname_fmt);
-    cargo_vasprintf(&c->progname, progname_fmt, ap);
-    va_end(ap);
+    fmt = s->fmt;
+    while ((*fmt == ' ') || (*fmt == '\t'))
+    {
+        s->column++;
+        fmt++;
+    }
 
-    // By default we show only short usage on errors.
-    c->usage_flags = CARGO_USAGE_SHORT;
+    s->token.token = *fmt;
+    s->token.column = s->column;
 
-    // Add the default group.
-    cargo_add_group(c, 0, "", "", "");
+    fmt++;
+    s->fmt = fmt;
+}
 
-    _cargo_add_help_if_missing(c);
+static void _cargo_fmt_prev_token(cargo_fmt_scanner_t *s)
+{
+    s->next_token = s->token;
+    s->token = s->prev_token;
+    s->fmt = &s->start[s->token.column];
 
-    return 0;
+    CARGODBG(4, "\"%s\"\n", s->start);
+    CARGODBG(4, " %*s\n", s->token.column, "^");
 }
 
-void cargo_destroy(cargo_t *ctx)
+static const char *_cargo_get_option_group_names(cargo_t ctx,
+                                        const char *optnames,
+                                        char **grpname,
+                                        char **mutex_grpname)
 {
+    int len = 0;
+    char *end = NULL;
+    char *tmp = NULL;
+    char **groups = NULL;
+    const char *ret = NULL;
+    char *s = NULL;
+    size_t count;
     size_t i;
+    assert(ctx);
+    assert(grpname);
+    assert(mutex_grpname);
 
-    CARGODBG(2, "cargo_destroy: DESTROY!\n");
+    *grpname = NULL;
 
-    if (ctx)
-    {
-        cargo_opt_t *opt;
-        cargo_t c = *ctx;
+    // Skip any whitespace.
+    optnames += strspn(optnames, " \t");
 
-        if (c->flags & CARGO_AUTOCLEAN)
+    if (*optnames != '<')
+    {
+        return optnames;
+    }
+
+    if (!(end = strchr(optnames, '>')))
+    {
+        CARGODBG(1, "Missing '>' to terminate group name\n");
+        return NULL;
+    }
+
+    end--;
+
+    len = (end - optnames);
+
+    if (!(tmp = _cargo_strndup(&ctx->mem, &optnames[1], len)))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        return NULL;
+    }
+
+    if (!(groups = _cargo_split(&ctx->mem, tmp, ",", &count)))
+    {
+        CARGODBG(1, "Failed to split group names\n");
+        goto fail;
+    }
+
+    if (count > 2)
+    {
+        CARGODBG(1, "Invalid number of groups specified. "
+                    "1 normal and 1 mutex group allowed\n");
+        goto fail;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        s = groups[i];
+        s += strspn(s, " \t");
+
+        if (s[0] == '!')
         {
-            CARGODBG(2, "Auto clean target values\n");
-            _cargo_cleanup_option_values(c, 1);
+            if (!(*mutex_grpname = _cargo_strdup(&ctx->mem, &s[1])))
+            {
+                CARGODBG(1, "Out of memory!\n");
+                goto fail;
+            }
         }
-
-        if (c->options)
+        else
         {
-            CARGODBG(2, "DESTROY %lu options!\n", c->opt_count);
-
-            for (i = 0; i < c->opt_count; i++)
+            if (!(*grpname = _cargo_strdup(&ctx->mem, s)))
             {
-                opt = &c->options[i];
-                CARGODBG(2, "Free opt: %s\n", opt->name[0]);
-                _cargo_option_destroy(opt);
+                CARGODBG(1, "Out of memory!\n");
+                goto fail;
             }
-
-            _cargo_xfree(&c->options);
         }
+    }
 
-        _cargo_groups_destroy(c);
-
-        _cargo_free_str_list(&c->args, NULL);
-        _cargo_free_str_list(&c->unknown_opts, NULL);
+    optnames += len + 2;
+    ret = optnames;
 
-        _cargo_xfree(&c->unknown_opts_idxs);
-        _cargo_xfree(&c->error);
-        _cargo_xfree(&c->short_usage);
-        _cargo_xfree(&c->usage);
-        _cargo_xfree(&c->description);
-        _cargo_xfree(&c->epilog);
-        _cargo_xfree(&c->progname);
+fail:
+    _cargo_xfree(&ctx->mem, &tmp);
 
-        _cargo_free(*ctx);
-        ctx = NULL;
+    if (!ret)
+    {
+        _cargo_xfree(&ctx->mem, grpname);
+        _cargo_xfree(&ctx->mem, mutex_grpname);
     }
-}
 
-void cargo_set_flags(cargo_t ctx, cargo_flags_t flags)
-{
-    assert(ctx);
-    ctx->flags = flags;
-}
+    _cargo_free_str_list(&ctx->mem, &groups, &count);
 
-cargo_flags_t cargo_get_flags(cargo_t ctx)
-{
-    assert(ctx);
-    return ctx->flags;
+    return ret;
 }
 
-void cargo_set_prefix(cargo_t ctx, const char *prefix_chars)
+static void _cargo_group_destroy(cargo_mem_t *m, cargo_group_t *g)
 {
-    assert(ctx);
-    ctx->prefix = prefix_chars;
+    if (!g) return;
+    _cargo_xfree(m, &g->option_indices);
+    _cargo_xfree(m, &g->name);
+    _cargo_xfree(m, &g->title);
+    _cargo_xfree(m, &g->description);
+    _cargo_xfree(m, &g->metavar);
+    g->opt_count = 0;
 }
 
-void cargo_set_prognamev(cargo_t ctx, const char *fmt, va_list ap)
+static void _cargo_groups_destroy(cargo_t ctx)
 {
+    size_t i;
     assert(ctx);
-    _cargo_xfree(&ctx->progname);
-    cargo_vasprintf(&ctx->progname, fmt, ap);
-}
 
-void cargo_set_progname(cargo_t ctx, const char *fmt, ...)
-{
-    va_list ap;
-    assert(ctx);
-    va_start(ap, fmt);
-    cargo_set_prognamev(ctx, fmt, ap);
-    va_end(ap);
-}
+    if (ctx->groups)
+    {
+        for (i = 0; i < ctx->group_count; i++)
+        {
+            _cargo_group_destroy(&ctx->mem, &ctx->groups[i]);
+        }
 
-void cargo_set_descriptionv(cargo_t ctx, const char *fmt, va_list ap)
-{
-    assert(ctx);
-    _cargo_xfree(&ctx->description);
-    cargo_vasprintf(&ctx->description, fmt, ap);
-}
+        _cargo_xfree(&ctx->mem, &ctx->groups);
+    }
 
-void cargo_set_description(cargo_t ctx, const char *fmt, ...)
-{
-    va_list ap;
-    assert(ctx);
-    va_start(ap, fmt);
-    cargo_set_descriptionv(ctx, fmt, ap);
-    va_end(ap);
-}
+    if (ctx->mutex_groups)
+    {
+        for (i = 0; i < ctx->mutex_group_count; i++)
+        {
+            _cargo_group_destroy(&ctx->mem, &ctx->mutex_groups[i]);
+        }
 
-void cargo_set_epilogv(cargo_t ctx, const char *fmt, va_list ap)
-{
-    assert(ctx);
-    _cargo_xfree(&ctx->epilog);
-    cargo_vasprintf(&ctx->epilog, fmt, ap);
+        _cargo_xfree(&ctx->mem, &ctx->mutex_groups);
+    }
 }
 
-void cargo_set_epilog(cargo_t ctx, const char *fmt, ...)
+static cargo_group_t *_cargo_find_group(cargo_t ctx,
+                    cargo_group_t *groups, size_t group_count,
+                    const char *name, size_t *grp_i)
 {
-    va_list ap;
+    size_t i;
+    cargo_group_t *g;
     assert(ctx);
-    va_start(ap, fmt);
-    cargo_set_epilogv(ctx, fmt, ap);
-    va_end(ap);
-}
+    assert(name);
 
-typedef struct cargo_phighlight_s
-{
-    int i;              // Index of highlight in argv.
-    char *c;            // Highlight character (followed by color).
-    int indent;         // Indent position for highlight in relation
-                        // to previous highlight.
-    int total_indent;   // Total indentation since start of string.
-    int highlight_len;  // Length of the highlight.
-    int show;
-} cargo_phighlight_t;
+    if (!groups)
+        return NULL;
 
-static int _cargo_compare_highlights(const void *a, const void *b)
-{
-    cargo_phighlight_t *ha = (cargo_phighlight_t *)a;
-    cargo_phighlight_t *hb = (cargo_phighlight_t *)b;
-    return (ha->i - hb->i);
+    for (i = 0; i < group_count; i++)
+    {
+        g = &groups[i];
+
+        if (!strcmp(g->name, name))
+        {
+            if (grp_i) *grp_i = i;
+            return g;
+        }
+    }
+
+    return NULL;
 }
 
-char *cargo_get_fprintl_args(int argc, char **argv, int start,
-                            cargo_fprint_flags_t flags,
-                            size_t max_width,
-                            size_t highlight_count,
-                            const cargo_highlight_t *highlights_in)
+static int _cargo_add_group(cargo_t ctx,
+                    cargo_group_t **groups, size_t *group_count,
+                    size_t *max_groups,
+                    size_t flags, const char *name,
+                    const char *title, const char *description)
 {
-    char *ret = NULL;
-    int i;
-    int j;
-    int global_indent = 0;
-    size_t arglen = 0;
-    cargo_str_t str;
-    char *out = NULL;
-    size_t out_size = 0;
-    cargo_phighlight_t *highlights = NULL;
-    assert(highlights_in);
+    int ret = -1;
+    cargo_group_t *grp = NULL;
+    assert(ctx);
+    assert(name);
+    assert(groups);
+    assert(max_groups);
+    assert(group_count);
 
-    max_width = _cargo_process_max_width(max_width);
+    CARGODBG(2, "Add group %s (%lu)\n", name, *group_count);
 
-    if (!(highlights = _cargo_calloc(highlight_count, sizeof(cargo_phighlight_t))))
+    // Initial allocation.
+    if (!*groups)
     {
-        CARGODBG(1, "Out of memory!\n");
-        return NULL;
+        (*max_groups) = CARGO_DEFAULT_MAX_GROUPS;
+
+        if (!((*groups) = _cargo_calloc(&ctx->mem, *max_groups, sizeof(cargo_group_t))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            return -1;
+        }
     }
 
-    for (i = 0; i < (int)highlight_count; i++)
+    if (_cargo_find_group(ctx, *groups, *group_count, name, NULL))
     {
-        highlights[i].i = highlights_in[i].i;
-        highlights[i].c = highlights_in[i].c;
-        CARGODBG(6, "  Highlight %d: %d\n", i, highlights[i].i);
+        CARGODBG(1, "Group \"%s\" already exists\n", name);
+        return -1;
     }
 
-    CARGODBG(6, "  Sort highlights:\n");
-    qsort(highlights, highlight_count,
-        sizeof(cargo_phighlight_t), _cargo_compare_highlights);
-
-    #if (CARGO_DEBUG >= 6)
-    for (i = 0; i < (int)highlight_count; i++)
+    // Realloc if needed.
+    if (*group_count >= *max_groups)
     {
-        CARGODBG(6, "  Highlight %d: %d\n", i, highlights[i].i);
+        (*max_groups) *= 2;
+
+        if (!((*groups) = _cargo_realloc(&ctx->mem, *groups,
+            sizeof(cargo_group_t) * (*max_groups))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            goto fail;
+        }
     }
-    #endif
 
-    // Get buffer size and highlight data.
-    for (i = 0, j = 0; i < argc; i++)
+    grp = &(*groups)[*group_count];
+    memset(grp, 0, sizeof(cargo_group_t));
+
+    if (!(grp->name = _cargo_strdup(&ctx->mem, name)))
     {
-        arglen = (i >= start) ? strlen(argv[i]) : 0;
+        CARGODBG(1, "Out of memory!\n");
+        goto fail;
+    }
 
-        if (arglen + global_indent >= max_width)
+    if (title)
+    {
+        if (!(grp->title = _cargo_strdup(&ctx->mem, title)))
         {
-            break;
+            CARGODBG(1, "Out of memory!\n");
+            goto fail;
         }
-
-        if (j < (int)highlight_count)
+    }
+    else
+    {
+        if (!(grp->title = _cargo_strdup(&ctx->mem, name)))
         {
-            cargo_phighlight_t *h = &highlights[j];
-            if (h->i == i)
-            {
-                // We only keep this flag so that we can make sure we don't
-                // output the color codes when an index is out of range.
-                if (i >= start)
-                {
-                    h->show = 1;
-                }
-
-                h->highlight_len = (int)arglen;
-                h->total_indent = global_indent;
+            CARGODBG(1, "Out of memory!\n");
+            goto fail;
+        }
+    }
 
-                // We want to indent in relation to the previous indentation.
-                if (j > 0)
-                {
-                    cargo_phighlight_t *hprev = &highlights[j - 1];
-                    h->indent = h->total_indent
-                              - (hprev->total_indent + hprev->highlight_len);
-                }
-                else
-                {
-                    h->indent = h->total_indent;
-                }
-
-                // If we use color, we must include the ANSI color code length
-                // in the buffer length as well.
-                out_size += strlen(h->c);
-
-                j++;
-            }
+    if (description)
+    {
+        if (!(grp->description = _cargo_strdup(&ctx->mem, description)))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            goto fail;
         }
-
-        global_indent += arglen;
-        if (i >= start) global_indent++; // + 1 for space.
-        out_size += global_indent;
     }
 
-    // Allocate and fill buffer.
-    out_size += 2; // New lines.
-    out_size *= 2; // Two rows, one for args and one for highlighting.
+    grp->flags = flags;
+    grp->max_opt_count = CARGO_DEFAULT_MAX_GROUP_OPTS;
+    grp->opt_count = 0;
 
-    if (!(out = _cargo_malloc(out_size)))
+    if (!(grp->option_indices = _cargo_calloc(&ctx->mem, grp->max_opt_count, sizeof(size_t))))
     {
         CARGODBG(1, "Out of memory!\n");
         goto fail;
     }
 
-    str.s = out;
-    str.l = out_size;
-    str.offset = 0;
-
-    // TODO: Try adding an "..." and try to fit all highlights on screen if possible.
-    if (!(flags & CARGO_FPRINT_NOARGS))
-    {
-        for (i = start; i < argc; i++)
-        {
-            // The highlight will be incorrect if we allow a line break.
-            if (str.offset + strlen(argv[i]) >= max_width)
-            {
-                break;
-            }
+    (*group_count)++;
+    CARGODBG(3, "  group_count after: %lu\n", *group_count);
 
-            cargo_appendf(&str, "%s ", argv[i]);
-        }
+    ret = 0;
 
-        cargo_appendf(&str, "\n");
+fail:
+    if (ret < 0)
+    {
+        _cargo_group_destroy(&ctx->mem, grp);
     }
 
-    if (!(flags & CARGO_FPRINT_NOHIGHLIGHT))
-    {
-        for (i = 0; i < (int)highlight_count; i++)
-        {
-            cargo_phighlight_t *h = &highlights[i];
-            char *highlvec;
-            int has_color = strlen(h->c) > 1;
+    return ret;
+}
 
-            if (h->highlight_len == 0)
-                continue;
+static int _cargo_group_add_option_ex(cargo_t ctx,
+                                        cargo_group_t *groups,
+                                        size_t group_count,
+                                        const char *group,
+                                        const char *opt,
+                                        int is_mutex)
+{
+    size_t opt_i;
+    cargo_group_t *g = NULL;
+    size_t grp_i;
+    cargo_opt_t *o = NULL;
+    assert(ctx);
+    assert(groups);
+    assert(group);
+    assert(opt);
 
-            if (!(highlvec = _cargo_malloc(h->highlight_len)))
-            {
-                CARGODBG(1, "Out of memory!\n");
-                goto fail;
-            }
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-            // Use the first character as the highlight character.
-            //                                ~~~~~~~~~
-            memset(highlvec, *h->c, h->highlight_len);
+    CARGODBG(2, "+++++++ Add %s to group \"%s\" +++++++\n", opt, group);
 
-            // If we have more characters, we append that as a string.
-            // (This can be used for color ansi color codes).
-            if (!(flags & CARGO_FPRINT_NOCOLOR) && has_color && h->show)
-            {
-                cargo_appendf(&str, "%s", &h->c[1]);
-            }
+    if (!(g = _cargo_find_group(ctx, groups, group_count, group, &grp_i)))
+    {
+        CARGODBG(1, "No such group \"%s\"\n", group);
+        return -1;
+    }
 
-            cargo_appendf(&str, "%*s%*.*s",
-                h->indent, "",
-                h->highlight_len,
-                h->highlight_len,
-                highlvec);
+    if (_cargo_find_option_name(ctx, opt, &opt_i, NULL))
+    {
+        CARGODBG(1, "No such option \"%s\"\n", opt);
+        return -1;
+    }
 
-            if (!(flags & CARGO_FPRINT_NOCOLOR) && has_color && h->show)
-            {
-                cargo_appendf(&str, "%s", CARGO_COLOR_RESET);
-            }
+    assert(opt_i < ctx->opt_count);
+    o = &ctx->options[opt_i];
 
-            _cargo_free(highlvec);
-        }
+    if (!is_mutex && (o->group_index > 0))
+    {
+        CARGODBG(1, "\"%s\" is already in another group \"%s\"\n",
+                o->name[0], ctx->groups[o->group_index].name);
+        return -1;
     }
 
-    ret = out;
+    if (g->opt_count >= g->max_opt_count)
+    {
+        CARGODBG(2, "Realloc group max option count from %lu to %lu\n",
+                g->max_opt_count, 2 * g->max_opt_count);
 
-fail:
-    if (!ret) _cargo_free(out);
-    _cargo_free(highlights);
+        g->max_opt_count *= 2;
 
-    return ret;
-}
+        if (!(g->option_indices = _cargo_realloc(&ctx->mem, g->option_indices,
+                g->max_opt_count * sizeof(size_t))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            return -1;
+        }
+    }
 
-char *cargo_get_vfprint_args(int argc, char **argv, int start,
-                            cargo_fprint_flags_t flags,
-                            size_t max_width,
-                            size_t highlight_count, va_list ap)
-{
-    char *ret = NULL;
-    int i;
-    cargo_highlight_t *highlights = NULL;
+    g->option_indices[g->opt_count] = opt_i;
 
-    // Create a list of indices to highlight from the va_args.
-    if (!(highlights = _cargo_calloc(highlight_count, sizeof(cargo_highlight_t))))
+    // Save index in option
+    // (since we might realloc the array of groups we must use the index)
+    if (is_mutex)
     {
-        CARGODBG(1, "Out of memory trying to allocate %lu highlights!\n",
-                highlight_count);
-        goto fail;
-    }
+        if (o->mutex_group_count == CARGO_MAX_OPT_MUTEX_GROUP)
+        {
+            CARGODBG(1, "Option %s cannot belong to more mutex groups. "
+                       "Count is CARGO_MAX_OPT_MUTEX_GROUP (%d).\n",
+                       opt, CARGO_MAX_OPT_MUTEX_GROUP);
+            return -1;
+        }
 
-    for (i = 0; i < (int)highlight_count; i++)
+        o->mutex_group_idxs[o->mutex_group_count++] = grp_i;
+    }
+    else
     {
-        highlights[i].i = va_arg(ap, int);
-        highlights[i].c = va_arg(ap, char *);
+        o->group_index = grp_i;
     }
 
-    ret = cargo_get_fprintl_args(argc, argv, start, flags, max_width,
-                                highlight_count, highlights);
+    g->opt_count++;
 
-fail:
-    _cargo_xfree(&highlights);
+    CARGODBG(2, "   Group \"%s\" option count: %lu\n", g->name, g->opt_count);
 
-    return ret;
+    return 0;
 }
 
-char *cargo_get_fprint_args(int argc, char **argv, int start,
-                            cargo_fprint_flags_t flags,
-                            size_t max_width,
-                            size_t highlight_count, ...)
+static void _cargo_print_mutex_group(cargo_t ctx,
+                                     size_t start_index,
+                                     cargo_astr_t *str,
+                                     cargo_group_t *g)
 {
-    char *ret;
-    va_list ap;
-    va_start(ap, highlight_count);
-    ret = cargo_get_vfprint_args(argc, argv, start, flags,
-                                max_width, highlight_count, ap);
-    va_end(ap);
-    return ret;
-}
+    size_t i;
+    cargo_opt_t *opt = NULL;
+    assert(g);
+    assert(str);
 
-int cargo_fprint_args(FILE *f, int argc, char **argv, int start,
-                      cargo_fprint_flags_t flags, size_t max_width,
-                      size_t highlight_count, ...)
-{
-    char *ret;
-    va_list ap;
-    va_start(ap, highlight_count);
-    ret = cargo_get_vfprint_args(argc, argv, start, flags,
-                                max_width, highlight_count, ap);
-    va_end(ap);
+    if (start_index >= g->opt_count)
+        return;
 
-    if (!ret)
+    for (i = start_index; i < g->opt_count; i++)
     {
-        return -1;
+        opt = &ctx->options[g->option_indices[i]];
+        cargo_aappendf(str, "%s%s", opt->name[0],
+                (i < (g->opt_count - 1)) ? ", " : "\n");
     }
-
-    fprintf(f, "%s\n", ret);
-    _cargo_free(ret);
-    return 0;
 }
 
-int cargo_fprintl_args(FILE *f, int argc, char **argv, int start,
-                       cargo_fprint_flags_t flags,
-                       size_t max_width, size_t highlight_count,
-                       const cargo_highlight_t *highlights)
+static void _cargo_print_mutex_group_highlights(cargo_t ctx,
+                                            cargo_astr_t *str,
+                                            cargo_highlight_t *parse_highlights,
+                                            size_t parsed_count)
 {
-    char *ret;
-    if (!(ret = cargo_get_fprintl_args(argc, argv, start, flags,
-                                max_width, highlight_count, highlights)))
+    char *s;
+
+    if (!(s = _cargo_highlight_args(ctx, parsed_count, parse_highlights)))
     {
-        return -1;
+        CARGODBG(1, "Out of memory\n");
+        return;
     }
 
-    fprintf(f, "%s\n", ret);
-    _cargo_free(ret);
-    return 0;
+    cargo_aappendf(str, "%s\n", s);
 }
 
-int cargo_parse(cargo_t ctx, cargo_flags_t flags, int start_index, int argc, char **argv)
+static int _cargo_check_mutex_group(cargo_t ctx,
+                                    cargo_astr_t *str,
+                                    cargo_group_t *g)
 {
-    int ret = CARGO_PARSE_OK;
-    int start = 0;
-    int opt_arg_count = 0;
-    char *arg = NULL;
-    const char *name = NULL;
     cargo_opt_t *opt = NULL;
-    cargo_flags_t global_flags = ctx->flags;
+    size_t j = 0;
+    int ret = -1;
+    cargo_highlight_t *parse_highlights = NULL;
+    size_t parsed_count = 0;
+    assert(ctx);
+    assert(g);
+    assert(str);
 
-    // Override if any flags are set.
-    if (flags)
+    parsed_count = 0;
+
+    // We create a list of highlights, so if more than one option in the
+    // mutex groups is parsed, we can highlight it.
+    if (!(parse_highlights = _cargo_arena_calloc(&ctx->arena, g->opt_count,
+                                sizeof(cargo_highlight_t))))
     {
-        ctx->flags = flags;
+        CARGODBG(1, "Out of memory!\n");
+        goto fail;
     }
 
-    CARGODBG(2, "============ Cargo Parse =============\n");
-
-    ctx->argc = argc;
-    ctx->argv = argv;
-    ctx->start = start_index;
-    ctx->stopped = 0;
-    ctx->stopped_hard = 0;
+    for (j = 0; j < g->opt_count; j++)
+    {
+        opt = &ctx->options[g->option_indices[j]];
 
-    _cargo_set_error(ctx, NULL);
+        if (opt->parsed >= 0)
+        {
+            parse_highlights[parsed_count].i = opt->parsed;
+            parse_highlights[parsed_count].c = "~"CARGO_COLOR_RED;
+            parsed_count++;
+        }
+    }
 
-    _cargo_add_help_if_missing(ctx);
-    _cargo_add_orphans_to_default_group(ctx);
+    if (parsed_count > 1)
+    {
+        _cargo_print_mutex_group_highlights(ctx, str, parse_highlights, parsed_count);
+        cargo_aappendf(str, "Only one of these variables is allowed at the same time:\n");
+        _cargo_print_mutex_group(ctx, 0, str, g);
+        goto fail;
+    }
+    else if ((parsed_count == 0)
+            && (g->flags & CARGO_MUTEXGRP_ONE_REQUIRED))
+    {
+        cargo_aappendf(str, "One of these variables is required:\n");
+        _cargo_print_mutex_group(ctx, 0, str, g);
+        goto fail;
+    }
 
-    _cargo_free_str_list(&ctx->args, NULL);
-    ctx->arg_count = 0;
+    ret = 0;
 
-    _cargo_free_str_list(&ctx->unknown_opts, NULL);
-    _cargo_xfree(&ctx->unknown_opts_idxs);
-    ctx->unknown_opts_count = 0;
+fail:
+    return ret;
+}
 
-    // Make sure we start over, if this function is
-    // called more than once.
-    // (But we don't free the values since we don't want to
-    //  overwrite default or already parsed values)
-    _cargo_cleanup_option_values(ctx, 0);
+static int _cargo_check_order_mutex_group(cargo_t ctx,
+                                          cargo_astr_t *str,
+                                          cargo_group_t *g)
+{
+    int ret = -1;
+    size_t i = 0;
+    cargo_opt_t *opt = NULL;
+    cargo_opt_t *first_opt = NULL;
+    cargo_highlight_t *parse_highlights = NULL;
+    int first_i = -1;
+    int is_invalid = 0;
+    size_t invalid_order_count = 0;
+    assert(ctx);
+    assert(str);
+    assert(g);
+    assert(g->flags & (CARGO_MUTEXGRP_ORDER_BEFORE | CARGO_MUTEXGRP_ORDER_AFTER));
 
-    if (!(ctx->args = (char **)_cargo_calloc(argc, sizeof(char *))))
+    if (g->opt_count == 0)
     {
-        CARGODBG(1, "Out of memory!\n");
-        ret = CARGO_PARSE_NOMEM; goto fail;
+        CARGODBG(1, "Warning: No options in mutex order group \"%s\"\n", g->name);
+        return 0;
     }
 
-    if (!(ctx->unknown_opts = (char **)_cargo_calloc(argc, sizeof(char *))))
+    // We create a list of highlights, so if more than one option in the
+    // mutex groups is parsed, we can highlight it.
+    if (!(parse_highlights = _cargo_arena_calloc(&ctx->arena, g->opt_count,
+                                sizeof(cargo_highlight_t))))
     {
         CARGODBG(1, "Out of memory!\n");
-        ret = CARGO_PARSE_NOMEM; goto fail;
+        goto fail;
     }
 
-    if (!(ctx->unknown_opts_idxs = _cargo_calloc(argc, sizeof(int))))
-    {
-        CARGODBG(1, "Out of memory");
-        ret = CARGO_PARSE_NOMEM; goto fail;
-    }
+    // We compare all other options with the parse index of the first one.
+    first_opt = &ctx->options[g->option_indices[0]];
+    first_i = first_opt->parsed;
 
-    CARGODBG(2, "Parse arg list of count %d start at index %d\n", argc, start_index);
+    parse_highlights[invalid_order_count].i = first_i;
+    parse_highlights[invalid_order_count].c = "^"CARGO_COLOR_GREEN;
 
-    // Check for unknown options early.
-    if ((ctx->flags & CARGO_UNKNOWN_EARLY)
-        && _cargo_check_unknown_options(ctx))
-    {
-        ret = CARGO_PARSE_UNKNOWN_OPTS; goto fail;
-    }
+    invalid_order_count = 1;
 
-    for (ctx->i = ctx->start; ctx->i < ctx->argc; )
+    for (i = 1; i < g->opt_count; i++)
     {
-        arg = argv[ctx->i];
-        start = ctx->i;
-        opt_arg_count = 0;
+        is_invalid = 0;
+        opt = &ctx->options[g->option_indices[i]];
 
-        CARGODBG(3, "\n");
-        CARGODBG(3, "argv[%d] = %s\n", ctx->i, arg);
-        CARGODBG(3, "  Look for opt matching %s:\n", arg);
+        // Skip unparsed.
+        if (opt->parsed < 0)
+        {
+            CARGODBG(3, "  Not parsed skipping %s\n", opt->name[0]);
+            continue;
+        }
 
-        // TODO: Add support for a "--" option which forces all
-        // options specified after it to be parsed as positional arguments
-        // and not options. Say there's a file named "-thefile".
+        CARGODBG(3, "  Check mutex order for %s\n", opt->name[0]);
 
-        // TODO: Add support for abbreviated prefix matching so that
-        // --ar will match --arne unless it's ambigous with some other option.
-        if (!ctx->stopped && (name = _cargo_check_options(ctx, &opt, arg)))
+        if (g->flags & CARGO_MUTEXGRP_ORDER_BEFORE)
         {
-            // We found an option, parse any arguments it might have.
-            if ((opt_arg_count = _cargo_parse_option(ctx, opt, name,
-                                                    argc, argv)) < 0)
+            if (opt->parsed > first_i)
             {
-                CARGODBG(1, "Failed to parse %s option: %s\n",
-                        _cargo_type_to_str(opt->type), name);
-                ret = opt_arg_count; goto fail;
+                is_invalid = 1;
             }
         }
         else
         {
-            size_t opt_i = 0;
-            CARGODBG(2, "    Positional argument: %s\n", argv[ctx->i]);
-
-            // Positional argument.
-            if (!ctx->stopped && (_cargo_get_positional(ctx, &opt_i) == 0))
-            {
-                opt = &ctx->options[opt_i];
-                if ((opt_arg_count = _cargo_parse_option(ctx, opt,
-                                                    opt->name[0],
-                                                    argc, argv)) < 0)
-                {
-                    CARGODBG(1, "    Failed to parse %s option: %s\n",
-                            _cargo_type_to_str(opt->type), name);
-                    ret = opt_arg_count; goto fail;
-                }
-            }
-            else
+            if (opt->parsed < first_i)
             {
-                CARGODBG(2, "    Extra argument: %s\n", argv[ctx->i]);
-                ctx->args[ctx->arg_count] = argv[ctx->i];
-                ctx->arg_count++;
-                opt_arg_count = 1;
+                is_invalid = 1;
             }
         }
 
-        ctx->i += opt_arg_count;
-
-        #if CARGO_DEBUG
+        if (is_invalid)
         {
-            int k = 0;
-            int ate = opt_arg_count;
-
-            CARGODBG(2, "    Ate %d args: ", opt_arg_count);
-
-            for (k = start; k < (start + opt_arg_count); k++)
-            {
-                CARGODBGI(2, "\"%s\" ", argv[k]);
-            }
-
-            CARGODBGI(2, "%s", "\n");
+            CARGODBG(3, "     Invalid order, highlight index %d\n", opt->parsed);
+            parse_highlights[invalid_order_count].i = opt->parsed;
+            parse_highlights[invalid_order_count].c = "~"CARGO_COLOR_RED;
+            invalid_order_count++;
         }
-        #endif // CARGO_DEBUG
-    }
-
-    // Print automatic help.
-    if (ctx->help)
-    {
-        cargo_print_usage(ctx, 0);
-        ctx->flags = global_flags;
-        return CARGO_PARSE_SHOW_HELP;
     }
 
-    // An option can cause a "hard stop", meaning that there
-    // won't be any errors for mutex groups and so on. This is
-    // useful for cases where you have --advanced_help or similar
-    // where you just want to show some extended help without also
-    // having to specify required arguments.
-    if (ctx->stopped_hard)
-    {
-        goto skip_checks;
-    }
-
-    if (_cargo_check_required_options(ctx))
-    {
-        ret = CARGO_PARSE_MISS_REQUIRED; goto fail;
-    }
-
-    if ((ret = _cargo_check_mutex_groups(ctx)))
-    {
-        goto fail;
-    }
-
-    if ((ret = _cargo_check_unknown_options_after(ctx)))
+    if (invalid_order_count > 1)
     {
+        CARGODBG(3, "  Invalid order highlight count: %lu\n", invalid_order_count);
+        _cargo_print_mutex_group_highlights(ctx, str, parse_highlights, invalid_order_count);
+        cargo_aappendf(str, "These options must all be specified %s \"%s\":\n",
+            (g->flags & CARGO_MUTEXGRP_ORDER_BEFORE) ? "before" : "after",
+            first_opt->name[0]);
+        _cargo_print_mutex_group(ctx, 1, str, g);
         goto fail;
     }
 
-    // Shows warnings.
-    if (!(ctx->flags & CARGO_NOWARN))
-    {
-        _cargo_parse_show_error(ctx);
-    }
-
-skip_checks:
-    ctx->flags = global_flags;
-    return CARGO_PARSE_OK;
+    ret = 0;
 
 fail:
-    // Let unknown options override other errors.
-    // But don't check for them more than once.
-    if (ctx->unknown_opts_count == 0)
-    {
-        int unknown_ret = 0;
-        if ((unknown_ret = _cargo_check_unknown_options_after(ctx)))
-        {
-            CARGODBG(1, "Unknown option overrides previous error\n");
-            ret = unknown_ret;
-        }
-    }
-
-    _cargo_parse_show_error(ctx);
-    _cargo_cleanup_option_values(ctx, 1);
-    ctx->flags = global_flags;
     return ret;
 }
 
-void cargo_set_errorv(cargo_t ctx, cargo_err_flags_t flags,
-                    const char *fmt, va_list ap)
+static cargo_parse_result_t _cargo_check_mutex_groups(cargo_t ctx)
 {
-    int ret = 0;
+    cargo_astr_t str;
     char *error = NULL;
-    char *error2 = NULL;
+    int ret = CARGO_PARSE_MUTEX_CONFLICT;
+    size_t i = 0;
+    cargo_group_t *g = NULL;
     assert(ctx);
+    memset(&str, 0, sizeof(cargo_astr_t));
+    str.s = &error;
+    str.arena = &ctx->arena;
 
-    ret = cargo_vasprintf(&error, fmt, ap);
+    CARGODBG(2, "Check mutex %lu groups\n", ctx->mutex_group_count);
 
-    if (ret >= 0)
+    for (i = 0; i < ctx->mutex_group_count; i++)
     {
-        // Maybe this can be done a bit nicer...
-        if (ctx->error && (flags & CARGO_ERR_APPEND))
+        g = &ctx->mutex_groups[i];
+
+        if (g->flags & (CARGO_MUTEXGRP_ORDER_BEFORE | CARGO_MUTEXGRP_ORDER_AFTER))
         {
-            ret = cargo_asprintf(&error2, "%s%s", ctx->error, error);
+            CARGODBG(2, "Order mutex group %s:\n", g->name);
 
-            if (ret >= 0)
+            // Check that all options in the group is either before or after
+            // the first option of the group.
+            if (_cargo_check_order_mutex_group(ctx, &str, g))
             {
-                _cargo_free(error);
-                error = error2;
+                ret = CARGO_PARSE_MUTEX_CONFLICT_ORDER; goto fail;
             }
         }
+        else
+        {
+            CARGODBG(2, "Normal mutex group %s:\n", g->name);
 
-        _cargo_xfree(&ctx->error);
-        ctx->error = error;
+            // Check that only one of the group is selected.
+            if (_cargo_check_mutex_group(ctx, &str, g))
+            {
+                ret = CARGO_PARSE_MUTEX_CONFLICT; goto fail;
+            }
+        }
     }
-}
 
-void cargo_set_error(cargo_t ctx,
-                    cargo_err_flags_t flags, const char *fmt, ...)
-{
-    va_list ap;
-    assert(ctx);
-    va_start(ap, fmt);
-    cargo_set_errorv(ctx, flags, fmt, ap);
-    va_end(ap);
-}
+    ret = CARGO_PARSE_OK;
+fail:
+    if (ret)
+    {
+        _cargo_set_error(ctx, error);
+    }
 
-const char *cargo_get_error(cargo_t ctx)
-{
-    assert(ctx);
-    return ctx->error;
+    return ret;
 }
 
-const char **cargo_get_unknown(cargo_t ctx, size_t *unknown_count)
+static int _cargo_add_orphans_to_default_group(cargo_t ctx)
 {
+    // Instead of being able to delete options from groups
+    // we add any orphans to the default group at first use.
+    size_t i;
+    cargo_opt_t *opt = NULL;
     assert(ctx);
 
-    if (unknown_count)
+    for (i = 0; i < ctx->opt_count; i++)
     {
-        *unknown_count = ctx->unknown_opts_count;
+        opt = &ctx->options[i];
+
+        // Default group.
+        if (opt->group_index < 0)
+        {
+            if (cargo_group_add_option(ctx, "", opt->name[0]))
+            {
+                CARGODBG(1, "Failed to add \"%s\" to default group\n", opt->name[0]);
+                return -1;
+            }
+        }
     }
 
-    return (const char **)ctx->unknown_opts;
+    return 0;
 }
 
-char **cargo_get_unknown_copy(cargo_t ctx, size_t *unknown_count)
+static void _cargo_check_unknown_options_gather(cargo_t ctx,
+                                                int start, int end)
 {
+    int i;
     assert(ctx);
-    return _cargo_copy_string_list(ctx->unknown_opts,
-            ctx->unknown_opts_count, unknown_count);
-}
 
-const char **cargo_get_args(cargo_t ctx, size_t *argc)
-{
-    assert(ctx);
+    // A streamed parse gathers them as the arguments are parsed.
+    if (ctx->streaming || !ctx->tokens || !ctx->unknown_opts)
+        return;
 
-    if (argc)
+    for (i = start; i < end; i++)
     {
-        *argc = ctx->arg_count;
+        if (ctx->tokens[i].kind == CARGO_TOKEN_UNKNOWN)
+        {
+            CARGODBG(2, "    Unknown option: %s\n", ctx->argv[i]);
+            ctx->unknown_opts[ctx->unknown_opts_count] = ctx->argv[i];
+            ctx->unknown_opts_idxs[ctx->unknown_opts_count] = i;
+            ctx->unknown_opts_count++;
+        }
     }
-
-    return (const char **)ctx->args;
-}
-
-char **cargo_get_args_copy(cargo_t ctx, size_t *argc)
-{
-    assert(ctx);
-    return _cargo_copy_string_list(ctx->args, ctx->arg_count, argc);
 }
 
-int cargo_add_alias(cargo_t ctx, const char *optname, const char *alias)
+static cargo_parse_result_t _cargo_check_unknown_options(cargo_t ctx)
 {
-    size_t opt_i;
-    size_t name_i;
-    cargo_opt_t *opt;
+    cargo_parse_result_t ret = CARGO_PARSE_UNKNOWN_OPTS;
+    size_t i;
+    cargo_highlight_t *highlights = NULL;
+    cargo_astr_t str;
+    char *error = NULL;
     assert(ctx);
+    memset(&str, 0, sizeof(str));
+    str.s = &error;
+    str.arena = &ctx->arena;
 
-    if (!_cargo_find_option_name(ctx, alias, &opt_i, &name_i))
+    // We could do a first pass for unknown options the first thing we do.
+    // Default is to wait until after parsing.
+    if (ctx->flags & CARGO_UNKNOWN_EARLY)
     {
-        CARGODBG(1, "Alias %s already used by option %s. Cannot add to %s.\n",
-                alias, ctx->options[opt_i].name[0], optname);
-        return -1;
+        CARGODBG(2, "Check for unknown options before parsing.\n"
+                    "   CARGO_UNKNOWN_EARLY is set\n"
+                    "    Check between %d and %d\n", ctx->start, ctx->stopped);
+        _cargo_check_unknown_options_gather(ctx, ctx->start, ctx->argc);
     }
-
-    if (_cargo_find_option_name(ctx, optname, &opt_i, &name_i))
+    else
     {
-        CARGODBG(1, "Failed to add alias %s to %s, option not found.\n",
-                alias, optname);
-        return -1;
+        CARGODBG(2, "Check for unknown options after parsing.\n"
+                    "    CARGO_UNKNOWN_EARLY is NOT set\n"
+                    "    Check between %d and %d\n", ctx->start, ctx->stopped);
+        _cargo_check_unknown_options_gather(ctx, ctx->start, ctx->stopped);
     }
 
-    CARGODBG(2, "Found option \"%s\"\n", optname);
+    if (ctx->unknown_opts_count > 0)
+    {
+        const char *suggestion = NULL;
+        char *s = NULL;
 
-    opt = &ctx->options[opt_i];
+        if (_cargo_render_error(ctx))
+        {
+            cargo_aappendf(&str, "%s\n", ctx->error);
+        }
 
-    if (opt->positional)
-    {
-        CARGODBG(1, "Cannot add alias for positional argument\n");
-        return -1;
-    }
-    else
-    {
-        if (!_cargo_starts_with_prefix(ctx, alias))
+        CARGODBG(2, "Unknown options count: %lu\n", ctx->unknown_opts_count);
+        cargo_aappendf(&str, "Unknown options:\n");
+
+        if (!(highlights = _cargo_arena_calloc(&ctx->arena,
+                                ctx->unknown_opts_count,
+                                sizeof(cargo_highlight_t))))
         {
-            CARGODBG(1, "Cannot add a positional as an alias to an option. "
-                        "The alias must be prefixed with %s: \"%s\"\n",
-                        (strlen(ctx->prefix) > 1)
-                        ? "one of these characters" : "this character",
-                        ctx->prefix);
-            return -1;
+            ret = CARGO_PARSE_NOMEM; goto fail;
         }
-    }
 
-    if (opt->name_count >= CARGO_NAME_COUNT)
-    {
-        CARGODBG(1, "Too many aliases for option: %s\n", opt->name[0]);
-        return -1;
-    }
+        for (i = 0; i < ctx->unknown_opts_count; i++)
+        {
+            highlights[i].i = ctx->unknown_opts_idxs[i];
+            highlights[i].c = "~"CARGO_COLOR_RED;
+        }
 
-    if (!(opt->name[opt->name_count] = _cargo_strdup(alias)))
-    {
-        CARGODBG(1, "Out of memory\n");
-        return -1;
-    }
+        if (!(s = _cargo_highlight_args(ctx,
+                    ctx->unknown_opts_count, highlights)))
+        {
+            CARGODBG(1, "Out of memory\n");
+            ret = CARGO_PARSE_NOMEM; goto fail;
+        }
 
-    opt->name_count++;
+        cargo_aappendf(&str, "%s\n", s);
 
-    CARGODBG(2, "  Added alias \"%s\"\n", alias);
+        for (i = 0; i < ctx->unknown_opts_count; i++)
+        {
+            suggestion = _cargo_find_closest_opt(ctx, ctx->unknown_opts[i]);
+            if (!suggestion) continue;
 
-    return 0;
+            cargo_aappendf(&str, "%s ", ctx->unknown_opts[i]);
+            cargo_aappendf(&str, " (Did you mean %s)?", suggestion);
+            cargo_aappendf(&str, "\n");
+        }
+
+        if (!(ctx->flags & CARGO_NO_FAIL_UNKNOWN))
+        {
+            _cargo_set_error(ctx, error);
+            return ret;
+        }
+        else
+        {
+            CARGODBG(2, "No error on unknown options, CARGO_NO_FAIL_UNKNOWN set\n");
+        }
+    }
+
+    ret = CARGO_PARSE_OK;
+
+fail:
+    // We failed to set the error...
+    _cargo_ctx_free(ctx, error);
+    return ret;
 }
 
-int cargo_set_option_descriptionv(cargo_t ctx,
-                                  const char *optname,
-                                  const char *fmt, va_list ap)
+static cargo_parse_result_t _cargo_check_unknown_options_after(cargo_t ctx)
 {
-    int ret = 0;
-    size_t opt_i = 0;
-    size_t name_i = 0;
-    cargo_opt_t *opt = NULL;
     assert(ctx);
 
-    if (_cargo_find_option_name(ctx, optname, &opt_i, &name_i))
+    // This check has already been done.
+    if (ctx->flags & CARGO_UNKNOWN_EARLY)
     {
-        CARGODBG(1, "Failed to find option \"%s\"\n", optname);
-        return -1;
+        return CARGO_PARSE_OK;
     }
 
-    opt = &ctx->options[opt_i];
-
-    _cargo_xfree(&opt->description);
+    // We must have a stop index so we know for what span to check for unknown
+    // options. Any options remaining after the stop index will be excluded in
+    // this check.
+    if (!ctx->stopped)
+    {
+        CARGODBG(2, "Stop at end of argv after parse: %d\n", ctx->argc);
+        ctx->stopped = ctx->argc;
+    }
+    else
+    {
+        CARGODBG(2, "Stopped by option at index: %d\n", ctx->stopped);
+    }
 
-    ret = cargo_vasprintf(&opt->description, fmt, ap);
-    return (ret >= 0) ? 0 : -1;
+    // TODO: Only append errors.
+    return _cargo_check_unknown_options(ctx);
 }
 
-int cargo_set_option_description(cargo_t ctx,
-                                 const char *optname,
-                                 const char *fmt, ...)
+static void _cargo_parse_show_error(cargo_t ctx)
 {
-    int ret = 0;
-    va_list ap;
+    FILE *fd = (ctx->flags & CARGO_STDOUT_ERR) ? stdout : stderr;
     assert(ctx);
-    va_start(ap, fmt);
-    ret = cargo_set_option_descriptionv(ctx, optname, fmt, ap);
-    va_end(ap);
-    return ret;
-}
 
-int cargo_set_metavarv(cargo_t ctx,
-                    const char *optname,
-                    const char *fmt, va_list ap)
-{
-    int ret = 0;
-    size_t opt_i;
-    size_t name_i;
-    cargo_opt_t *opt;
-    assert(ctx);
+    if (!ctx->error && !ctx->error_pending)
+        return;
 
-    if (_cargo_find_option_name(ctx, optname, &opt_i, &name_i))
+    if (!(ctx->flags & CARGO_NOERR_USAGE))
     {
-        CARGODBG(1, "Failed to find option \"%s\"\n", optname);
-        return -1;
+        cargo_fprint_usage(ctx, fd, ctx->usage_flags);
     }
 
-    opt = &ctx->options[opt_i];
-
-    _cargo_xfree(&opt->metavar);
-
-    ret = cargo_vasprintf(&opt->metavar, fmt, ap);
-    return (ret >= 0) ? 0 : -1;
+    // Show errors automatically?
+    if (!(ctx->flags & CARGO_NOERR_OUTPUT))
+    {
+        fprintf(fd, "%s\n", _cargo_render_error(ctx));
+    }
 }
 
-int cargo_set_metavar(cargo_t ctx,
-                    const char *optname,
-                    const char *fmt, ...)
+static int _cargo_get_max_name_length(cargo_t ctx,
+            size_t *positional_count, size_t *option_count)
 {
-    int ret = 0;
-    va_list ap;
+    #define MAX_OPT_NAME_LEN 40
+    size_t i = 0;
+    int namelen = 0;
+    int max_name_len = 0;
+    char *name = NULL;
+    cargo_opt_t *opt = NULL;
     assert(ctx);
-    va_start(ap, fmt);
-    ret = cargo_set_metavarv(ctx, optname, fmt, ap);
-    va_end(ap);
-    return ret;
-}
+    assert(positional_count);
+    assert(option_count);
 
-int cargo_mutex_group_set_metavarv(cargo_t ctx,
-                                   const char *mutex_group,
-                                   const char *fmt, va_list ap)
-{
-    int ret = 0;
-    cargo_group_t *g = NULL;
-    assert(ctx);
-    assert(mutex_group);
+    (*positional_count) = 0;
+    (*option_count) = 0;
 
-    if (!(g =_cargo_find_group(ctx,
-        ctx->mutex_groups, ctx->mutex_group_count, mutex_group, NULL)))
+    // TODO: Replace with cargo_astr_t so we don't have to prealloc max_width
+    if (!(name = _cargo_malloc(&ctx->mem, ctx->max_width)))
     {
-        CARGODBG(1, "No such mutex group \"%s\"\n", mutex_group);
+        CARGODBG(1, "Out of memory!\n");
         return -1;
     }
 
-    _cargo_xfree(&g->metavar);
-
-    ret = cargo_vasprintf(&g->metavar, fmt, ap);
+    for (i = 0; i < ctx->opt_count; i++)
+    {
+        opt = &ctx->options[i];
 
-    return (ret >= 0) ? 0 : -1;
-}
+        if (opt->flags & CARGO_OPT_HIDE)
+        {
+            continue;
+        }
 
-int cargo_mutex_group_set_metavar(cargo_t ctx,
-                                  const char *mutex_group,
-                                  const char *fmt, ...)
-{
-    int ret = 0;
-    va_list ap;
-    assert(ctx);
-    va_start(ap, fmt);
-    ret = cargo_mutex_group_set_metavarv(ctx, mutex_group, fmt, ap);
-    va_end(ap);
-    return ret;
-}
+        if (opt->positional)
+        {
+            (*positional_count)++;
+        }
+        else
+        {
+            (*option_count)++;
+        }
 
-const char *cargo_get_usage(cargo_t ctx, cargo_usage_t flags)
-{
-    char *ret = NULL;
-    size_t i;
-    char *b = NULL;
-    int max_name_len = 0;
-    size_t positional_count = 0;
-    size_t option_count = 0;
-    const char *short_usage = NULL;
-    cargo_group_t *grp = NULL;
-    cargo_astr_t str;
-    int is_default_group = 1;
-    assert(ctx);
+        namelen = _cargo_get_option_name_str(ctx, opt,
+                                            name, ctx->max_width);
 
-    if (!(flags & CARGO_USAGE_HIDE_SHORT))
-    {
-        if (!(short_usage = _cargo_get_short_usage(ctx, flags)))
+        if (namelen < 0)
         {
-            CARGODBG(1, "Failed to get short usage\n");
-            return NULL;
+            max_name_len = -1;
+            goto fail;
         }
-    }
-
-    // Only show short usage.
-    if (flags & CARGO_USAGE_SHORT)
-    {
-        return short_usage;
-    }
-
-    // TODO: Instead of looping over all options at this stage, save the length
-    // of all options on add_option, including max_length, positional_count and
-    // so on.
 
-    // First get option names and their length.
-    // We get the widest one so we know the column width to use
-    // for the final result.
-    //   --option_a         Some description.
-    //   --longer_option_b  Another description...
-    // ^-------------------^
-    // What should the above width be.
-    if ((max_name_len = _cargo_get_max_name_length(ctx,
-                        &positional_count, &option_count)) < 0)
-    {
-        CARGODBG(1, "Failed to get option name max length\n");
-        goto fail;
+        // Get the longest option name.
+        // (However, if it's too long don't count it, then we'll just
+        // do a line break before printing the description).
+        if ((namelen > max_name_len) && (namelen <= MAX_OPT_NAME_LEN))
+        {
+            max_name_len = namelen;
+        }
     }
 
-    str.s = &b;
-    str.l = 1024;
-    str.offset = 0;
+fail:
+    _cargo_xfree(&ctx->mem, &name);
 
-    // TODO: Break all this into separate functions.
+    return max_name_len;
+}
 
-    if (short_usage && !(flags & CARGO_USAGE_HIDE_SHORT))
-    {
-        cargo_aappendf(&str, "%s\n", short_usage);
-    }
+static int _cargo_get_group_description(cargo_t ctx, cargo_astr_t *str,
+                                        cargo_group_t *grp, int indent)
+{
+    int ret = -1;
+    size_t j = 0;
+    char *lb_desc = NULL;
+    char **desc_lines = NULL;
+    size_t line_count = 0;
+    assert(ctx);
+    assert(str);
+    assert(grp);
 
-    if(ctx->description && strlen(ctx->description)
-       && !(flags & CARGO_USAGE_HIDE_DESCRIPTION))
+    if (!grp->description || strlen(grp->description) == 0)
     {
-        if (flags & CARGO_USAGE_RAW_DESCRIPTION)
-        {
-            if (cargo_aappendf(&str, "\n%s\n", ctx->description) < 0) goto fail;
-        }
-        else
-        {
-            char *lb_desc;
-            if (!(lb_desc = _cargo_linebreak(ctx, ctx->description, ctx->max_width)))
-            {
-                goto fail;
-            }
-            cargo_aappendf(&str, "\n%s\n", lb_desc);
-            _cargo_free(lb_desc);
-        }
+        return 0;
     }
 
-    CARGODBG(2, "max_name_len = %d, ctx->max_width = %lu\n",
-            max_name_len, ctx->max_width);
-
-    #ifdef CARGO_DEBUG
-    for (i = 0; i < ctx->group_count; i++)
+    if (grp->flags & CARGO_GROUP_RAW_DESCRIPTION)
     {
-        CARGODBG(2, "%s: %lu\n",
-            ctx->groups[i].name, ctx->groups[i].opt_count);
+        cargo_aappendf(str, "%*s%s\n", indent, " ", grp->description);
     }
-    #endif
-
-    // Start by printing mutually exclusive groups
-    for (i = 0; i < ctx->mutex_group_count; i++)
+    else
     {
-        int indent = 2;
-        const char *description = NULL;
-        grp = &ctx->mutex_groups[i];
-
-        if (!(grp->flags & CARGO_MUTEXGRP_GROUP_USAGE))
-        {
-            continue;
-        }
-
-        if (grp->title)
-        {
-            cargo_aappendf(&str, "\n%s:\n", grp->title);
-        }
-
-        description = grp->description;
-
-        if (!description)
-        {
-            description = "Specify one of the following.";
-        }
-
-        if (_cargo_get_group_description(ctx, &str, grp, indent))
+        if (!(lb_desc = _cargo_linebreak(ctx, grp->description, ctx->max_width)))
         {
             goto fail;
         }
 
-        // Positional.
-        if (_cargo_print_options(ctx, grp->option_indices, grp->opt_count,
-                                1, &str, max_name_len, indent, 1, flags))
+        if (!(desc_lines = _cargo_split(&ctx->mem, lb_desc, "\n", &line_count)))
         {
+            CARGODBG(1, "Failed to split group description\n");
             goto fail;
         }
 
-        // Options.
-        if (_cargo_print_options(ctx, grp->option_indices, grp->opt_count,
-                                0, &str, max_name_len, indent, 1, flags))
+        for (j = 0; j < line_count; j++)
         {
-            goto fail;
+            cargo_aappendf(str, "%*s%s\n", indent, " ", desc_lines[j]);
         }
     }
 
-    for (i = 0; i < ctx->group_count; i++)
-    {
-        int indent = 2;
-        grp = &ctx->groups[i];
+    ret = 0;
+fail:
+    _cargo_xfree(&ctx->mem, &lb_desc);
+    _cargo_free_str_list(&ctx->mem, &desc_lines, &line_count);
 
-        if ((grp->flags & CARGO_GROUP_HIDE) || (grp->opt_count == 0))
-        {
-            continue;
-        }
+    return ret;
+}
 
-        // The group name is always set for normal groups.
-        // The default group is simply "".
-        is_default_group = (strlen(grp->name) == 0);
+void _cargo_invalid_format_char(cargo_t ctx,
+                                    const char *optname, const char *fmt,
+                                    cargo_fmt_scanner_t *s)
+{
+    assert(ctx);
+    assert(optname);
+    assert(s);
 
-        if (!is_default_group)
-        {
-            indent = 2;
-        }
+    CARGODBG(1, "  %s: Unknown format character '%c' at index %d\n",
+            optname, _cargo_fmt_token(s), s->column);
+    CARGODBG(1, "      \"%s\"\n", fmt);
+    CARGODBG(1, "       %*s\n", s->column, "^");
+}
 
-        if (!is_default_group) cargo_aappendf(&str, "\n%s:", grp->title);
-        if (grp->description) cargo_aappendf(&str, "\n");
+static int _cargo_check_required_options(cargo_t ctx)
+{
+    cargo_astr_t errstr;
+    char *error = NULL;
+    size_t i;
+    char nargs[32];
+    const char *nargs_str = NULL;
+    cargo_opt_t *opt = NULL;
+    memset(&errstr, 0, sizeof(cargo_astr_t));
+    errstr.s = &error;
+    errstr.arena = &ctx->arena;
 
-        if (_cargo_get_group_description(ctx, &str, grp, indent))
+    for (i = 0; i < ctx->opt_count; i++)
+    {
+        opt = &ctx->options[i];
+
+        if ((opt->flags & CARGO_OPT_REQUIRED) && (opt->parsed < 0))
         {
-            goto fail;
+            CARGODBG(1, "Missing required argument \"%s\"\n", opt->name[0]);
+            cargo_aappendf(&errstr, "Missing required argument \"%s\"\n", opt->name[0]);
+
+            _cargo_set_error(ctx, error);
+            return -1;
         }
 
-        // Note, we only show the "Positional arguments" and "Options"
-        // titles for the default group. It becomes quite spammy otherwise.
-        if (positional_count > 0)
+        if (opt->parsed >= 0)
         {
-            if (is_default_group)
-                if (cargo_aappendf(&str, "Positional arguments:\n") < 0) goto fail;
+            // A delimited list counts values, not arguments.
+            int got = (opt->delimiter && !opt->bitmap)
+                    ? (int)opt->target_idx : opt->num_eaten;
 
-            if (_cargo_print_options(ctx, grp->option_indices, grp->opt_count,
-                                    1, &str, max_name_len, indent, 0, flags))
+            if (((opt->nargs == CARGO_NARGS_ONE_OR_MORE) && (got == 0))
+             || ((opt->nargs >= 0) && (got != opt->nargs)))
             {
-                goto fail;
-            }
-        }
+                nargs_str = _cargo_nargs_str(opt->nargs, nargs, sizeof(nargs));
+                CARGODBG(1, "Not enough arguments. Expected %s, got %d\n",
+                        nargs_str, got);
 
-        if (cargo_aappendf(&str, "\n") < 0) goto fail;
+                // TODO: Highlight option (ctx->parsed is the index into argv)
 
-        if (option_count > 0)
-        {
-            if (is_default_group)
-                if (cargo_aappendf(&str, "Options:\n") < 0) goto fail;
+                if (got == 0)
+                {
+                    cargo_aappendf(&errstr,
+                        "Not enough arguments for \"%s\" expected %s "
+                        "but got none\n", opt->name[0],
+                        nargs_str);
+                }
+                else
+                {
+                    cargo_aappendf(&errstr,
+                        "Not enough arguments for \"%s\" expected %s "
+                        "but got only %d\n", opt->name[0],
+                        nargs_str, got);
+                }
 
-            if (_cargo_print_options(ctx, grp->option_indices, grp->opt_count,
-                                    0, &str, max_name_len, indent, 0, flags))
-            {
-                goto fail;
+                _cargo_set_error(ctx, error);
+                return -1;
             }
         }
     }
 
-    if(ctx->epilog && strlen(ctx->epilog)
-       && !(flags & CARGO_USAGE_HIDE_EPILOG))
+    return 0;
+}
+
+static size_t _cargo_process_max_width(size_t max_width)
+{
+    int console_width;
+    size_t maxw = CARGO_DEFAULT_MAX_WIDTH;
+
+    if (max_width == CARGO_AUTO_MAX_WIDTH)
     {
-        if (flags & CARGO_USAGE_RAW_EPILOG)
+        CARGODBG(2, "User specified CARGO_AUTO_MAX_WIDTH\n");
+
+        if ((console_width = _cargo_get_console_width()) > 0)
         {
-            if (cargo_aappendf(&str, "\n%s\n", ctx->epilog) < 0) goto fail;
+            CARGODBG(2, "Max width based on console width: %d\n", console_width);
+            maxw = console_width;
         }
         else
         {
-            char *lb_epilog;
-            if (!(lb_epilog = _cargo_linebreak(ctx, ctx->epilog, ctx->max_width)))
-            {
-                goto fail;
-            }
-            cargo_aappendf(&str, "\n%s\n", lb_epilog);
-            _cargo_free(lb_epilog);
+            CARGODBG(2, "Max width set to CARGO_DEFAULT_MAX_WIDTH = %d\n",
+                    CARGO_DEFAULT_MAX_WIDTH);
         }
     }
-
-    // TODO: Realloc the buffer to minimize size.
-
-    ret = b;
-
-fail:
-    // A real failure!
-    if (!ret)
+    else
     {
-        _cargo_xfree(&b);
+        CARGODBG(2, "User specified max width: %lu\n", max_width);
+        maxw = max_width;
     }
 
-    // Save the usage and destroy it on exit,
-    // we want the user to be able to do things like this:
-    // printf("%s\nYou're bad at typing!\n", cargo_get_usage(cargo, 0));
-    // without leaking memory.
-    _cargo_xfree(&ctx->usage);
-
-    ctx->usage = ret;
-
-    return ret;
-}
-
-int cargo_get_stop_index(cargo_t ctx)
-{
-    assert(ctx);
-    return ctx->stopped;
-}
-
-int cargo_fprint_usage(cargo_t ctx, FILE *f, cargo_usage_t flags)
-{
-    const char *s;
-    assert(ctx);
-
-    if (!(s = cargo_get_usage(ctx, flags)))
+    // Since we allocate memory based on this later on, make sure this
+    // is something sane. Anything above 1024 characters is more than enough.
+    // Also some systems might have a really big console width for instance.
+    // (This happened on drone.io continous integration service).
+    if (maxw > CARGO_MAX_MAX_WIDTH)
     {
-        return -1;
+        CARGODBG(2, "Max width too large, capping at: %d\n", CARGO_MAX_MAX_WIDTH);
+        maxw = CARGO_MAX_MAX_WIDTH;
     }
 
-    fprintf(f, "%s\n", s);
-
-    return 0;
-}
-
-int cargo_print_usage(cargo_t ctx, cargo_usage_t flags)
-{
-    return cargo_fprint_usage(ctx, stdout, flags);
+    return maxw;
 }
 
-int cargo_add_group(cargo_t ctx, cargo_group_flags_t flags, const char *name,
-                    const char *title, const char *description, ...)
+static int _cargo_set_group_context(cargo_t ctx,
+        const char *group, cargo_group_t *groups, size_t group_count, void *user)
 {
-    char *d = NULL;
-    int ret = 0;
-    va_list ap;
+    cargo_group_t *grp = NULL;
     assert(ctx);
 
-    if (description)
+    if (_cargo_is_compiled(ctx))
+        return -1;
+
+    // If a NULL group is given, we interpret that as the default "" group.
+    if (!group)
     {
-        va_start(ap, description);
-        cargo_vasprintf(&d, description, ap);
-        va_end(ap);
+        group = "";
     }
 
-    ret = _cargo_add_group(ctx, &ctx->groups, &ctx->group_count,
-                            &ctx->max_groups,
-                            (size_t)flags, name, title, d);
-    _cargo_xfree(&d);
-    return ret;
-}
-
-int cargo_group_add_option(cargo_t ctx, const char *group, const char *opt)
-{
-    return _cargo_group_add_option_ex(ctx,
-                ctx->groups, ctx->group_count, group, opt, 0);
-}
-
-int cargo_group_set_flags(cargo_t ctx, const char *group,
-                           cargo_group_flags_t flags)
-{
-    cargo_group_t *g = NULL;
-    size_t grp_i;
-    assert(ctx);
-    assert(group);
+    grp = _cargo_find_group(ctx, groups, group_count, group, NULL);
 
-    if (!(g = _cargo_find_group(ctx, ctx->groups, ctx->group_count, group, &grp_i)))
+    if (!grp)
     {
         CARGODBG(1, "No such group \"%s\"\n", group);
         return -1;
     }
 
-    g->flags = flags;
+    grp->user = user;
 
     return 0;
 }
 
-int cargo_add_mutex_group(cargo_t ctx,
-                        cargo_mutex_group_flags_t flags,
-                        const char *name,
-                        const char *title,
-                        const char *description, ...)
+static void * _cargo_get_group_context(cargo_t ctx, const char *group,
+                cargo_group_t *groups, size_t group_count)
 {
-    char *d = NULL;
-    int ret = 0;
-    va_list ap;
+    cargo_group_t *grp = NULL;
     assert(ctx);
 
-    if (description)
+    grp = _cargo_find_group(ctx, groups, group_count, group, NULL);
+
+    if (!grp)
     {
-        va_start(ap, description);
-        cargo_vasprintf(&d, description, ap);
-        va_end(ap);
+        CARGODBG(1, "No such group \"%s\"\n", group);
+        return NULL;
     }
 
-    ret = _cargo_add_group(ctx, &ctx->mutex_groups, &ctx->mutex_group_count,
-                            &ctx->mutex_max_groups,
-                            (size_t)flags, name, title, d);
-    _cargo_xfree(&d);
-    return ret;
-}
-
-int cargo_mutex_group_add_option(cargo_t ctx, const char *group, const char *opt)
-{
-    return _cargo_group_add_option_ex(ctx,
-                ctx->mutex_groups, ctx->mutex_group_count, group, opt, 1);
+    return grp->user;
 }
 
-int cargo_add_optionv(cargo_t ctx, cargo_option_flags_t flags,
-                         const char *optnames, const char *description,
-                         const char *fmt, va_list ap)
+static const char *_cargo_option_get_group(cargo_t ctx, const char *opt,
+                        cargo_group_t *groups, size_t group_count)
 {
-    size_t optcount = 0;
-    char **optname_list = NULL;
-    int ret = -1;
-    size_t i = 0;
-    cargo_fmt_scanner_t s;
     cargo_opt_t *o = NULL;
-    char *grpname = NULL;
-    char *mutex_grpname = NULL;
-    int nargs_is_set = 0;
+    size_t opt_i;
     assert(ctx);
+    assert(opt);
 
-    CARGODBG(2, "-------- Add option \"%s\", \"%s\" --------\n", optnames, fmt);
-
-    if ((
-            (flags & CARGO_OPT_DEFAULT_LITERAL) ||
-            (ctx->flags & CARGO_DEFAULT_LITERALS)
-        )
-        && !(ctx->flags & CARGO_AUTOCLEAN))
+    if (_cargo_find_option_name(ctx, opt, &opt_i, NULL) < 0)
     {
-        CARGODBG(1, "Option flag CARGO_OPT_DEFAULT_LITERAL or global flag "
-                    "CARGO_DEFAULT_LITERALS must be "
-                    "combined with the global flag CARGO_AUTOCLEAN "
-                    "to avoid memory leak / crash.");
-        return -1;
+        CARGODBG(1, "No such option \"%s\"\n", opt);
+        return NULL;
     }
 
-    // TODO: Allow multiple mutex groups...
-    if (!(optnames = _cargo_get_option_group_names(ctx, optnames,
-                        &grpname, &mutex_grpname)))
+    o = &ctx->options[opt_i];
+
+    if (o->group_index < 0)
     {
-        CARGODBG(1, "Failed to parse group name\n");
-        return -1;
+        CARGODBG(1, "%s: Group is not set\n", opt);
+        return NULL;
     }
 
-    CARGODBG(2, " Group: \"%s\", Optnames: \"%s\"\n", grpname, optnames);
+    CARGODBG(3, "Opt idx: %lu, Group idx: %d, Group name: \"%s\"\n",
+            opt_i, o->group_index, groups[o->group_index].title);
 
-    if (!(optname_list = _cargo_split_and_verify_option_names(ctx, optnames, &optcount)))
-    {
-        CARGODBG(1, "Failed to split option names \"%s\"\n", optnames);
-        goto fail;
-    }
+    return groups[o->group_index].name;
+}
 
-    if (!(o = _cargo_option_init(ctx, optname_list[0], description)))
-    {
-        CARGODBG(1, "Failed to init option\n");
-        goto fail;
-    }
+static void _cargo_mutex_group_short_usage(cargo_t ctx,
+                        cargo_astr_t *str, size_t indent)
+{
+    int ret = 0;
+    size_t i;
+    size_t j;
+    size_t prev_offset = 0;
+    cargo_group_t *mgrp = NULL;
+    cargo_opt_t *opt = NULL;
+    cargo_astr_t opt_str;
+    char *opt_s = NULL;
+    assert(ctx);
+    assert(str);
 
-    if (grpname)
+    for (i = 0; i < ctx->mutex_group_count; i++)
     {
-        CARGODBG(2, "Add \"%s\" to group \"%s\"\n", o->name[0], grpname);
+        mgrp = &ctx->mutex_groups[i];
 
-        if (cargo_group_add_option(ctx, grpname, o->name[0]))
+        if (mgrp->flags & (CARGO_MUTEXGRP_ORDER_BEFORE | CARGO_MUTEXGRP_ORDER_AFTER))
         {
-            CARGODBG(1, "Failed to add option \"%s\" to group \"%s\"\n",
-                    o->name[0], grpname);
-            goto fail;
+            continue;
         }
-    }
-    else
-    {
-        CARGODBG(2, "Add \"%s\" to default group\n", o->name[0]);
-        o->group_index = -1;
-    }
 
-    if (mutex_grpname)
-    {
-        CARGODBG(2, "Add \"%s\" to mutex group \"%s\"\n", o->name[0], mutex_grpname);
+        // Given by the user to override.
+        if (mgrp->metavar)
+        {
+            memset(&opt_str, 0, sizeof(opt_str));
+            opt_str.s = &opt_s;
+            opt_str.mem = &ctx->mem;
+            cargo_aappendf(&opt_str, " %s", mgrp->metavar);
 
-        if (cargo_mutex_group_add_option(ctx, mutex_grpname, o->name[0]))
+            _cargo_fit_on_short_usage_line(ctx, str,
+                indent, str->offset, opt_str.offset, &prev_offset);
+
+            if (opt_s)
+            {
+                cargo_aappendf(str, "%s", opt_s);
+                _cargo_xfree(&ctx->mem, &opt_s);
+            }
+
+            continue;
+        }
+
+        // If we should group the options in the mutex group like this
+        // {opt1, opt2, opt3} or [opt1, opt2, opt3].
+        if ((mgrp->flags & CARGO_MUTEXGRP_NO_GROUP_SHORT_USAGE))
         {
-            CARGODBG(1, "Failed to add option \"%s\" to mutex group \"%s\"",
-                    o->name[0], mutex_grpname);
-            goto fail;
+            continue;
         }
-    }
 
-    // Start parsing the format string.
-    _cargo_fmt_scanner_init(&s, fmt);
-    _cargo_fmt_next_token(&s);
+        // Instead of printing the {} before and after loop we include it
+        // in the string inside the loop together with the option name
+        // so that we always get a nice linebreak like this:
+        //   {opt1, opt2}
+        // compared to:
+        //   {
+        //   opt1, opt2}
 
-    // Get the first token.
-    if (_cargo_fmt_token(&s) == '.')
-    {
-        CARGODBG(2, "Static\n");
-        o->alloc = 0;
-        _cargo_fmt_next_token(&s);
-    }
-    else
-    {
-        o->alloc = 1;
-    }
+        for (j = 0; j < mgrp->opt_count; j++)
+        {
+            int is_first = (j == 0);
+            int is_last = (j == (mgrp->opt_count - 1));
+            char is_req = (mgrp->flags & CARGO_MUTEXGRP_ONE_REQUIRED);
 
-    if (_cargo_fmt_token(&s) == '[')
-    {
-        CARGODBG(4, "   [\n");
-        o->array = 1;
-        _cargo_fmt_next_token(&s);
-    }
+            memset(&opt_str, 0, sizeof(opt_str));
+            opt_str.s = &opt_s;
+            opt_str.mem = &ctx->mem;
 
-    switch (_cargo_fmt_token(&s))
-    {
-        //
-        // !!!WARNING!!!
-        // Do not attempt to refactor and put these longer cases in
-        // separate functions. Passing a va_list around is dangerous.
-        // This works fine on Unix, but fails randomly on Windows!
-        //
+            opt = &ctx->options[mgrp->option_indices[j]];
 
-        // Same as string, but the target is internal
-        // and will be passed to the user specified callback.
-        case 'c':
-        {
-            CARGODBG(4, "Custom callback\n");
+            if (is_first) cargo_aappendf(&opt_str, "%s", (is_req ? " {" : " ["));
 
-            if (!o->alloc)
+            if ((ret = _cargo_get_short_option_usage(ctx, opt,
+                            &opt_str, opt->positional, 0)) < 0)
             {
-                CARGODBG(1, "WARNING! Static '.' is ignored for a custom "
-                            "callback the memory for the arguments is "
-                            "allocated internally.");
-                o->alloc = 1;
+                CARGODBG(1, "Failed to get option usage\n");
+                return;
             }
 
-            o->type = CARGO_STRING;
-            o->custom = va_arg(ap, cargo_custom_f);
-            o->custom_user = va_arg(ap, void *);
-
-            // Internal target.
-            o->target = (void **)&o->custom_target;
-            o->target_count = &o->custom_target_count;
-
-            o->lenstr = 0;
-
-            if (!o->custom)
-            {
-                CARGODBG(2, "Warning: Got NULL custom callback pointer\n");
-            }
+            if (!is_last) cargo_aappendf(&opt_str, ", ");
+            if (is_last) cargo_aappendf(&opt_str, "%s", (is_req ? "}" : "]"));
 
-            _cargo_fmt_next_token(&s);
+            _cargo_fit_on_short_usage_line(ctx, str,
+                indent, str->offset, opt_str.offset, &prev_offset);
 
-            switch (_cargo_fmt_token(&s))
+            if (opt_s)
             {
-                // A shortcut to "[c]#", cbfunc, NULL, NULL, 0.
-                // which makes a custom callback a bool flag basically.
-                case '0': o->nargs = 0; break;
-                default:
-                {
-                    _cargo_fmt_prev_token(&s);
-                    o->nargs = 1;
-                    break;
-                }
+                cargo_aappendf(str, "%s", opt_s);
+                _cargo_xfree(&ctx->mem, &opt_s);
             }
+        }
+    }
+}
 
-            nargs_is_set = 1;
+static const char *_cargo_strip_path_from_progname(const char *org_progname)
+{
+    const char *progname;
 
-            break;
-        }
-        case 'D': // D as in Dummy.
+    // Strip any directory path from the program name.
+    if (!(progname = strrchr(org_progname, '/')))
+    {
+        if (!(progname = strrchr(org_progname, '\\')))
         {
-            // Shortcut for: "c0", NULL, NULL;
-            // That is a dummy callback. This is mostly useful
-            // for using in a mutex group.
-            o->array = 0;
-            o->alloc = 1;
-            o->type = CARGO_STRING;
-            o->custom = NULL;
-            o->custom_user = NULL;
-            o->lenstr = 0;
-            o->nargs = 0;
-            o->target = (void **)&o->custom_target;
-            o->target_count = &o->custom_target_count;
-            nargs_is_set = 1;
-            break;
+            progname = org_progname;
         }
-        case 's':
-        {
-            o->type = CARGO_STRING;
-            o->target = (void *)va_arg(ap, char *);
+    }
 
-            CARGODBG(4, "Read string\n");
-            _cargo_fmt_next_token(&s);
+    progname += strspn(progname, "/\\");
 
-            if (_cargo_fmt_token(&s) == '#')
-            {
-                o->lenstr = (size_t)va_arg(ap, int);
-                CARGODBG(4, "String length: %lu\n", o->lenstr);
+    return progname;
+}
 
-                if (o->alloc)
-                {
-                    CARGODBG(1, "%s: WARNING! Usually restricting the size of a "
-                        "string using # is only done on static strings.\n"
-                        "    Are you sure you want this?\n",
-                        o->name[0]);
-                    CARGODBG(1, "      \"%s\"\n", s.start);
-                    CARGODBG(1, "       %*s\n", s.column, "^");
-                }
-            }
-            else
-            {
-                // String size not fixed.
-                o->lenstr = 0;
-                _cargo_fmt_prev_token(&s);
-            }
+static const char *_cargo_get_short_usage(cargo_t ctx, cargo_usage_t flags)
+{
+    char *b = NULL;
+    size_t indent = 0;
+    cargo_astr_t str;
+    const char *progname;
+    assert(ctx);
 
-            break;
-        }
-        case 'b':
-        {
-            o->type = CARGO_BOOL;
-            o->target = va_arg(ap, void *);
+    _cargo_add_help_if_missing(ctx);
+    _cargo_add_orphans_to_default_group(ctx);
 
-            // Look for any modifier tokens.
-            _cargo_fmt_next_token(&s);
+    memset(&str, 0, sizeof(str));
+    str.s = &b;
+    str.mem = &ctx->mem;
 
-            switch (_cargo_fmt_token(&s))
-            {
-                // Read an int that will be stored in the bool value (Default 1)
-                case '=': o->bool_store = va_arg(ap, int); break;
-                // Count flag occurances.
-                case '!': o->bool_count = 1; break;
-                case '|':
-                case '+':
-                case '&':
-                case '_':
-                {
-                    switch (_cargo_fmt_token(&s))
-                    {
-                        default:
-                        case '|': o->bool_acc_op = CARGO_BOOL_OP_OR; break;
-                        case '+': o->bool_acc_op = CARGO_BOOL_OP_PLUS; break;
-                        case '&': o->bool_acc_op = CARGO_BOOL_OP_AND; break;
-                        case '_': o->bool_acc_op = CARGO_BOOL_OP_STORE; break;
-                    }
+    if ((flags & CARGO_USAGE_NO_STRIP_PROGNAME))
+    {
+        progname = ctx->progname;
+    }
+    else
+    {
+        progname = _cargo_strip_path_from_progname(ctx->progname);
+    }
 
-                    o->bool_acc_count = 0;
-                    o->bool_acc_max_count = (size_t)va_arg(ap, unsigned int);
-                    CARGODBG(3, "Bool acc max count %lu\n", o->bool_acc_max_count);
+    cargo_aappendf(&str, "Usage: %s", progname);
 
-                    if (!(o->bool_acc = _cargo_calloc(o->bool_acc_max_count, sizeof(int))))
-                    {
-                        CARGODBG(1, "Out of memory\n");
-                        goto fail;
-                    }
+    if (!(flags & CARGO_USAGE_OVERRIDE_SHORT))
+    {
+        indent = str.offset;
 
-                    for (i = 0; i < o->bool_acc_max_count; i++)
-                    {
-                        o->bool_acc[i] = va_arg(ap, int);
-                        CARGODBG(3, "  bool acc value %lu: 0x%x\n", i, o->bool_acc[i]);
-                    }
-                    break;
-                }
-                default:
-                {
-                    // Got no flag modifier token.
-                    o->bool_store = 1;
-                    o->bool_count = 0;
-                    o->bool_acc = NULL;
-                    _cargo_fmt_prev_token(&s);
-                }
-            }
+        // Options.
+        _cargo_get_short_option_usages(ctx, &str, indent, 0);
 
-            break;
-        }
-        // TODO: Maybe replace target here with a union?
-        case 'i': o->type = CARGO_INT;    o->target = va_arg(ap, void *); break;
-        case 'd': o->type = CARGO_DOUBLE; o->target = va_arg(ap, void *); break;
-        case 'u': o->type = CARGO_UINT;   o->target = va_arg(ap, void *); break;
-        case 'f': o->type = CARGO_FLOAT;  o->target = va_arg(ap, void *); break;
-        case 'L': o->type = CARGO_LONGLONG;   o->target = va_arg(ap, void *); break;
-        case 'U': o->type = CARGO_ULONGLONG;  o->target = va_arg(ap, void *); break;
-        default: _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);goto fail;
+        _cargo_mutex_group_short_usage(ctx, &str, indent);
+
+        // Positional arguments at the end.
+        _cargo_get_short_option_usages(ctx, &str, indent, 1);
     }
 
-    if (o->array)
+    // Reallocate the memory used for the string so it's too big.
+    if (!(b = _cargo_realloc(&ctx->mem, b, str.offset + 1)))
     {
-        // Custom callbacks uses an internal target and count.
-        // However we still return the count in a separate
-        // user specified value for arrays.
-        if (o->custom)
-        {
-            o->custom_user_count = va_arg(ap, size_t *);
-        }
-        else
-        {
-            // This is where we return the number of arguments
-            // we have parsed for this option.
-            o->target_count = va_arg(ap, size_t *);
-        }
+        CARGODBG(1, "Out of memory!\n");
+        return NULL;
+    }
 
-        _cargo_fmt_next_token(&s);
+    // We are always responsible to free this.
+    _cargo_xfree(&ctx->mem, &ctx->short_usage);
 
-        if (_cargo_fmt_token(&s) != ']')
-        {
-            CARGODBG(1, "%s: Expected ']'\n", o->name[0]);
-            CARGODBG(1, "      \"%s\"\n", fmt);
-            CARGODBG(1, "        %*s\n", s.column, "^");
-            goto fail;
-        }
+    ctx->short_usage = b;
 
-        _cargo_fmt_next_token(&s);
+    return b;
+}
 
-        if (o->alloc)
-        {
-            switch (_cargo_fmt_token(&s))
-            {
-                case '*': o->nargs = CARGO_NARGS_ZERO_OR_MORE; break;
-                case '+': o->nargs = CARGO_NARGS_ONE_OR_MORE;  break;
-                case 'N': // Fall through. Python uses N so lets allow that...
-                case '#': o->nargs = va_arg(ap, int); break;
-                default: _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
-                        goto fail;
-            }
+char **_cargo_copy_string_list(cargo_mem_t *m, char **strs, size_t count,
+                               size_t *target_count)
+{
+    char **ret = NULL;
+    size_t i;
 
-            // By default "nargs" is the max number of arguments the option should parse.
-            o->max_target_count = (o->nargs >= 0) ? o->nargs : (size_t)(-1);
-        }
-        else
-        {
-            assert(*fmt == '.');
-            // If we have a static array. For example:
-            // "int val[4];"
-            // The max target count must still always be specified
-            // if we use "+" or "*" when in static mode.
-            o->max_target_count = va_arg(ap, int);
+    if (target_count) *target_count = 0;
 
-            switch (_cargo_fmt_token(&s))
-            {
-                case '*': o->nargs = CARGO_NARGS_ZERO_OR_MORE; break;
-                case '+': o->nargs = CARGO_NARGS_ONE_OR_MORE;  break;
-                case 'N': // Fall through. Python uses N so lets allow that...
-                case '#': o->nargs = o->max_target_count; break;
-                default: _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
-                        goto fail;
-            }
-        }
+    if (!strs)
+    {
+        return NULL;
     }
-    else
+
+    if (!(ret = _cargo_calloc(m, count, sizeof(char *))))
     {
-        // Non-array.
+        CARGODBG(1, "Out of memory!\n");
+        return NULL;
+    }
 
-        if (o->type == CARGO_BOOL)
+    if (target_count) *target_count = count;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(ret[i] = _cargo_strdup(m, strs[i])))
         {
-            // BOOLs never have arguments.
-            o->nargs = 0;
+            CARGODBG(1, "Out of memory\n");
+            goto fail;
         }
-        else
-        {
-            _cargo_fmt_next_token(&s);
-
-            if (_cargo_fmt_token(&s) == '?')
-            {
-                o->nargs = CARGO_NARGS_ZERO_OR_ONE;
-                o->zero_or_one_default = va_arg(ap, char *);
-            }
-            else
-            {
-                _cargo_fmt_prev_token(&s);
+    }
 
-                if (!nargs_is_set)
-                {
-                    o->nargs = 1;
-                }
-            }
+    return ret;
+fail:
+    if (ret)
+    {
+        count = i;
+        for (i = 0; i < count; i++)
+        {
+            _cargo_free(m, ret[i]);
         }
 
-        // Never allocate single values (unless it's a string).
-        o->alloc = (o->type != CARGO_STRING) ? 0 : o->alloc;
-        o->max_target_count = 1;
+        _cargo_free(m, ret);
     }
 
-    _cargo_fmt_next_token(&s);
+    if (target_count) *target_count = 0;
 
-    if (_cargo_fmt_token(&s) != '\0')
-    {
-        _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
-        CARGODBG(1, "Got garbage at end of format string\n");
-        goto fail;
-    }
+    return NULL;
+}
 
-    o->flags = flags;
-    o->first_parse = 1;
+// -----------------------------------------------------------------------------
+// Public functions
+// -----------------------------------------------------------------------------
 
-    // Check if the option has a prefix
-    // (if not it's positional).
-    o->positional = !_cargo_is_prefix(ctx, o->name[0][0]);
+void cargo_set_internal_usage_flags(cargo_t ctx, cargo_usage_t flags)
+{
+    assert(ctx);
+    ctx->usage_flags = flags;
+}
 
-    if (o->positional
-        && !(o->flags & CARGO_OPT_NOT_REQUIRED)
-        && (o->nargs != CARGO_NARGS_ZERO_OR_MORE)
-        && (o->nargs != CARGO_NARGS_ZERO_OR_ONE))
-    {
-        CARGODBG(2, "Positional argument %s required by default\n", o->name[0]);
-        o->flags |= CARGO_OPT_REQUIRED;
-    }
+int cargo_get_width(cargo_t ctx, cargo_width_flags_t flags)
+{
+    int ret = 0;
+    assert(ctx);
 
-    if (_cargo_validate_option_args(ctx, o))
+    ret = (int)ctx->max_width;
+
+    if (flags & CARGO_WIDTH_RAW)
     {
-        goto fail;
+        ret = _cargo_get_console_width();
     }
 
-    // .[s]#  .[s]+  .[s]*
-    if ((o->type == CARGO_STRING)
-         && (o->nargs != 1)
-         && (o->lenstr == 0)
-         && !o->alloc)
-    {
-        // A list of strings with a static size is a special case:
-        //   char *strs[5];
-        // Since we only want to allocate memory for the individual
-        // strings we parse, but not the entire list (as with):
-        //   char **strs;
-        // The format string for this would be ".[s]#"
-        //
-        // nargs != 1 && nargs != -1:
-        //   So we want nargs to be set, but not to infinite (-1),
-        //   this means # was used.
-        // lenstr == 0:
-        //   .[s#]# would mean we have something like char strs[5][15];
-        // !alloc:
-        //   The list is not to be allocated.
+    return ret;
+}
 
-        // So in this case we are not allocating the list itself
-        // since that is of a fixed size. But we want to allocate
-        // each individual item string.
-        o->str_alloc_items = 1;
-    }
+void cargo_set_max_width(cargo_t ctx, size_t max_width)
+{
+    assert(ctx);
+    ctx->max_width = _cargo_process_max_width(max_width);
+    CARGODBG(2, "Usage max width: %lu\n", ctx->max_width);
+}
 
-    for (i = 1; i < optcount; i++)
+static int _cargo_initv(cargo_t *ctx, const cargo_allocator_t *allocator,
+                        cargo_flags_t flags, const char *progname_fmt,
+                        va_list ap)
+{
+    cargo_s *c;
+    cargo_mem_t mem;
+    assert(ctx);
+
+    memset(&mem, 0, sizeof(mem));
+    *ctx = NULL;
+
+    if (allocator)
     {
-        if (cargo_add_alias(ctx, optname_list[0], optname_list[i]))
+        if (!allocator->malloc_fn || !allocator->realloc_fn
+            || !allocator->free_fn)
         {
-            goto fail;
+            CARGODBG(1, "Allocator must have malloc, realloc and free set\n");
+            return -1;
         }
+
+        mem.alloc = *allocator;
     }
 
-    CARGODBG(2, " Option %s:\n", o->name[0]);
-    CARGODBG(2, "   max_target_count = %lu\n", o->max_target_count);
-    CARGODBG(2, "   alloc = %d\n", o->alloc);
-    CARGODBG(2, "   lenstr = %lu\n", o->lenstr);
-    CARGODBG(2, "   nargs = %d\n", o->nargs);
-    CARGODBG(2, "   positional = %d\n", o->positional);
-    CARGODBG(2, "   array = %d\n", o->array);
-    CARGODBG(2, "   \n");
+    *ctx = (cargo_s *)_cargo_calloc(&mem, 1, sizeof(cargo_s));
+    c = *ctx;
 
-    ret = 0;
+    if (!c)
+        return -1;
 
-fail:
-    if (ret < 0)
-    {
-        if (o)
-        {
-            _cargo_option_destroy(o);
-            ctx->opt_count--;
-        }
-    }
+    c->mem = mem;
+    c->arena.mem = &c->mem;
+    c->max_opts = CARGO_DEFAULT_MAX_OPTS;
+    c->flags = flags;
+    c->prefix = CARGO_DEFAULT_PREFIX;
+    cargo_set_max_width(c, CARGO_AUTO_MAX_WIDTH);
 
-    _cargo_xfree(&grpname);
-    _cargo_xfree(&mutex_grpname);
-    _cargo_free_str_list(&optname_list, &optcount);
+    _cargo_vasprintf(&c->mem, &c->progname, progname_fmt, ap);
 
-    return ret;
+    // By default we show only short usage on errors.
+    c->usage_flags = CARGO_USAGE_SHORT;
+
+    // Add the default group.
+    cargo_add_group(c, 0, "", "", "");
+
+    _cargo_add_help_if_missing(c);
+
+    return 0;
 }
 
-int cargo_add_option(cargo_t ctx, cargo_option_flags_t flags,
-                        const char *optnames, const char *description,
-                        const char *fmt, ...)
+int cargo_init(cargo_t *ctx, cargo_flags_t flags, const char *progname_fmt, ...)
 {
     int ret;
     va_list ap;
-    assert(ctx);
-
-    va_start(ap, fmt);
-    ret = cargo_add_optionv(ctx, flags, optnames, description, fmt, ap);
+    va_start(ap, progname_fmt);
+    ret = _cargo_initv(ctx, NULL, flags, progname_fmt, ap);
     va_end(ap);
+    return ret;
+}
 
+int cargo_init_with_allocator(cargo_t *ctx,
+                              const cargo_allocator_t *allocator,
+                              cargo_flags_t flags,
+                              const char *progname_fmt, ...)
+{
+    int ret;
+    va_list ap;
+    va_start(ap, progname_fmt);
+    ret = _cargo_initv(ctx, allocator, flags, progname_fmt, ap);
+    va_end(ap);
     return ret;
 }
 
-cargo_validation_t *cargo_create_validator(const char *name,
-                                           cargo_validation_f validator,
-                                           cargo_validation_destroy_f destroy,
-                                           cargo_type_t types,
-                                           void *user)
+#define CARGO_RESPONSE_FILE_MAX_DEPTH 16
+
+static void _cargo_unmap_response_files(cargo_t ctx)
 {
-    cargo_validation_t *v = NULL;
+    size_t i;
+    cargo_mapping_t *m = NULL;
 
-    if (!(v = _cargo_calloc(1, sizeof(cargo_validation_t))))
+    for (i = 0; i < ctx->mapping_count; i++)
     {
-        return NULL;
-    }
+        m = &ctx->mappings[i];
 
-    v->name = name;
-    v->validator = validator;
-    v->destroy = destroy;
-    v->types = types;
-    v->user = user;
+        #ifdef _WIN32
+        UnmapViewOfFile(m->data);
+        #else
+        munmap(m->data, m->size);
+        #endif
+    }
 
-    return v;
+    // The list itself is in the scratch arena.
+    ctx->mappings = NULL;
+    ctx->mapping_count = 0;
+    ctx->max_mappings = 0;
 }
 
-void *cargo_validator_get_context(cargo_validation_t *validator)
+static int _cargo_response_file_error(cargo_t ctx, const char *path,
+                                      const char *reason)
 {
-    assert(validator);
-    return validator->user;
-}
+    cargo_astr_t str;
+    char *error = NULL;
+    memset(&str, 0, sizeof(str));
+    str.s = &error;
+    str.arena = &ctx->arena;
 
+    cargo_aappendf(&str, "Failed to read response file \"%s\": %s\n",
+                   path, reason);
+    _cargo_set_error(ctx, error);
 
-typedef union cargo_vals_s
-{
-    int i;
-    unsigned int u;
-    float f;
-    double d;
-    long long int ll;
-    unsigned long long ull;
-} cargo_vals_t;
+    return CARGO_PARSE_FAIL_OPT;
+}
 
-typedef struct cargo_range_validation_s
+// Maps a file copy-on-write, so it can be tokenized in place
+// without changing the file.
+static int _cargo_map_file(cargo_t ctx, const char *path, cargo_mapping_t *m)
 {
-    cargo_vals_t min;
-    cargo_vals_t max;
-    cargo_vals_t epsilon;
-} cargo_range_validation_t;
+    #ifdef _WIN32
+    HANDLE f = INVALID_HANDLE_VALUE;
+    HANDLE h = NULL;
+    LARGE_INTEGER size;
+    #else
+    int fd = -1;
+    struct stat st;
+    #endif
 
-static int _cargo_nearly_equal(double a, double b, double epsilon)
-{
-    double largest;
-    double diff = cargo_fabs(a - b);
-    a = (double)cargo_fabs(a);
-    b = (double)cargo_fabs(b);
-    largest = (b > a) ? b : a;
+    memset(m, 0, sizeof(cargo_mapping_t));
 
-    if (diff <= (largest * epsilon))
-        return 1;
-    return 0;
-}
-
-static int _cargo_validate_range_cb(cargo_t ctx, cargo_validation_flags_t flags,
-                        const char *opt, cargo_validation_t *vd, void *value)
-{
-    #define _CARGO_COMPARE_RANGE(_type, valfmt, _member)                    \
-    do                                                                      \
-    {                                                                       \
-        _type i = *((_type *)value);                                        \
-        if ((i < vr->min._member) || (i > vr->max._member))                 \
-        {                                                                   \
-            cargo_set_error(ctx, 0,                                         \
-                "Value must be in the range between "                       \
-                 valfmt" and "valfmt" for %s but got "valfmt"\n",           \
-                vr->min._member, vr->max._member, opt, i);                  \
-            return -1;                                                      \
-        }                                                                   \
-    } while (0)
-
-    #define _CARGO_COMPARE_FLOAT_RANGE(_type, valfmt, _member)              \
-    do                                                                      \
-    {                                                                       \
-        _type f = *((_type *)value);                                        \
-        _type min = vr->min._member;                                        \
-        _type max = vr->max._member;                                        \
-        _type epsilon = vr->epsilon._member;                                \
-        if (((f < min) && !_cargo_nearly_equal(f, min, epsilon))            \
-         || ((f > max) && !_cargo_nearly_equal(f, max, epsilon)))           \
-        {                                                                   \
-            cargo_set_error(ctx, 0,                                         \
-                "Value must be in the range between "                       \
-                 valfmt" and "valfmt" for %s but got "valfmt"\n",       \
-                vr->min._member, vr->max._member, opt, f);                  \
-            return -1;                                                      \
-        }                                                                   \
-    } while (0)
-
-    cargo_type_t type = cargo_get_option_type(ctx, opt);
-    cargo_range_validation_t *vr = NULL;
-    assert(ctx);
-    assert(vd);
-    assert(opt);
-
-    vr = (cargo_range_validation_t *)cargo_validator_get_context(vd);
+    #ifdef _WIN32
+    if ((f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL))
+                == INVALID_HANDLE_VALUE)
+    {
+        return _cargo_response_file_error(ctx, path, "Cannot open file");
+    }
 
-    switch (type)
+    if (!GetFileSizeEx(f, &size))
     {
-        case CARGO_INT:
-            _CARGO_COMPARE_RANGE(int, "%d", i); break;
-        case CARGO_UINT:
-            _CARGO_COMPARE_RANGE(unsigned int, "%u", u); break;
-        case CARGO_FLOAT:
-            _CARGO_COMPARE_FLOAT_RANGE(float, "%0.2f", f); break;
-        case CARGO_DOUBLE:
-            _CARGO_COMPARE_FLOAT_RANGE(double, "%0.2f", d); break;
-        case CARGO_LONGLONG:
-            _CARGO_COMPARE_RANGE(long long int, "%"CARGO_LONGLONG_FMT, ll); break;
-        case CARGO_ULONGLONG:
-            _CARGO_COMPARE_RANGE(unsigned long long int, "%"CARGO_ULONGLONG_FMT, ull); break;
-        case CARGO_BOOL:
-        case CARGO_STRING: return -1;
+        CloseHandle(f);
+        return _cargo_response_file_error(ctx, path, "Cannot get file size");
     }
 
-    return 0;
-    #undef _CARGO_COMPARE_RANGE
-    #undef _CARGO_COMPARE_FLOAT_RANGE
-}
+    m->size = (size_t)size.QuadPart;
 
-static cargo_validation_t *_cargo_create_range(const char *name,
-                                               cargo_type_t type)
-{
-    cargo_range_validation_t *vr = NULL;
-    cargo_validation_t *v = NULL;
+    if (m->size > 0)
+    {
+        if ((h = CreateFileMappingA(f, NULL, PAGE_WRITECOPY, 0, 0, NULL)))
+        {
+            m->data = (char *)MapViewOfFile(h, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(h);
+        }
+    }
 
-    if (!(vr = _cargo_calloc(1, sizeof(cargo_range_validation_t))))
+    CloseHandle(f);
+    #else
+    if ((fd = open(path, O_RDONLY)) < 0)
     {
-        return NULL;
+        return _cargo_response_file_error(ctx, path, strerror(errno));
     }
 
-    if (!(v = cargo_create_validator(name,
-                                    _cargo_validate_range_cb,
-                                    NULL, type, vr)))
+    if (fstat(fd, &st))
     {
-        _cargo_free(vr);
-        return NULL;
+        close(fd);
+        return _cargo_response_file_error(ctx, path, strerror(errno));
     }
 
-    return v;
-}
+    m->size = (size_t)st.st_size;
 
-#define _CARGO_CREATE_VALIDATE_RANGE_FUNC_BODY(type, _cargo_type, _member)          \
-    cargo_range_validation_t *vr = NULL;                                            \
-    cargo_validation_t *v = NULL;                                                   \
-    if (!(v = _cargo_create_range(#type" range", _cargo_type)))                 \
-        return NULL;                                                                \
-    vr = cargo_validator_get_context(v);                                            \
-    vr->min._member = min;                                                          \
-    vr->max._member = max;                                                          \
-    vr->epsilon._member = epsilon;                                                  \
-    return v;                                                                       \
+    if (m->size > 0)
+    {
+        m->data = (char *)mmap(NULL, m->size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE, fd, 0);
 
-#define _CARGO_CREATE_VALIDATE_RANGE_FUNC(name, type, _cargo_type, _member)         \
-    cargo_validation_t *cargo_validate_##name(type min, type max)                   \
-    {                                                                               \
-        type epsilon = 0;                                                           \
-        _CARGO_CREATE_VALIDATE_RANGE_FUNC_BODY(type, _cargo_type, _member);         \
+        if (m->data == (char *)MAP_FAILED)
+        {
+            m->data = NULL;
+        }
     }
 
-#define _CARGO_CREATE_VALIDATE_FLOAT_RANGE_FUNC(name, type, _cargo_type, _member)   \
-    cargo_validation_t *cargo_validate_##name(type min, type max, type epsilon)     \
-    {                                                                               \
-        _CARGO_CREATE_VALIDATE_RANGE_FUNC_BODY(type, _cargo_type, _member);         \
+    close(fd);
+    #endif // _WIN32
+
+    if ((m->size > 0) && !m->data)
+    {
+        return _cargo_response_file_error(ctx, path, "Cannot map file");
     }
 
-_CARGO_CREATE_VALIDATE_RANGE_FUNC(int_range, int, CARGO_INT, i)
-_CARGO_CREATE_VALIDATE_RANGE_FUNC(uint_range, unsigned int, CARGO_UINT, u)
-_CARGO_CREATE_VALIDATE_RANGE_FUNC(longlong_range, long long int, CARGO_LONGLONG, ll)
-_CARGO_CREATE_VALIDATE_RANGE_FUNC(ulonglong_range, unsigned long long int, CARGO_ULONGLONG, ull)
-_CARGO_CREATE_VALIDATE_FLOAT_RANGE_FUNC(float_range, float, CARGO_FLOAT, f)
-_CARGO_CREATE_VALIDATE_FLOAT_RANGE_FUNC(double_range, double, CARGO_DOUBLE, d)
+    return 0;
+}
 
-typedef struct cargo_choices_validation_s
+static int _cargo_add_response_arg(cargo_t ctx, char ***list,
+                                   size_t *count, size_t *max, char *arg)
 {
-    cargo_type_t type;
-    size_t count;
-    char **strs;
-    cargo_vals_t *nums;
-    double epsilon;
-    cargo_validate_choices_flags_t flags;
-    char *err;
-} cargo_choices_validation_t;
+    if (_cargo_arena_grow(&ctx->arena, list, max, *count, sizeof(char *)))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        return CARGO_PARSE_NOMEM;
+    }
 
-static void _cargo_validate_choices_destroy_cb(void *user)
-{
-    cargo_choices_validation_t *vc = (cargo_choices_validation_t *)user;
+    (*list)[(*count)++] = arg;
 
-    _cargo_xfree(&vc->nums);
-    _cargo_xfree(&vc->err);
-    _cargo_free_str_list(&vc->strs, &vc->count);
+    return 0;
 }
 
-int _cargo_validate_choices_cb(cargo_t ctx,
-                            cargo_validation_flags_t flags,
-                            const char *opt, cargo_validation_t *vd,
-                            void *value)
+static int _cargo_expand_arg(cargo_t ctx, char *arg, int depth,
+                             char ***list, size_t *count, size_t *max);
+
+// Returns the next whitespace separated argument in a buffer, or NULL
+// if there are none left. Quotes and escapes are removed by moving the
+// rest of the argument back, which also leaves room for the terminating
+// NUL. Only if the argument ends the buffer is it left unterminated,
+// which can be seen by (arg + len == end).
+static char *_cargo_next_arg_inplace(char **pos, char *end, size_t *len)
 {
-    size_t i;
-    cargo_choices_validation_t *vc = NULL;
-    int case_sensitive = 0;
-    assert(ctx);
-    assert(vd);
+    char *p = *pos;
+    char *tok = NULL;
+    char *out = NULL;
+    char quote = 0;
+    char c;
 
-    vc = (cargo_choices_validation_t *)cargo_validator_get_context(vd);
-    assert(vc);
+    while ((p < end) && isspace((unsigned char)*p))
+        p++;
 
-    case_sensitive = vc->flags & CARGO_VALIDATE_CHOICES_CASE_SENSITIVE;
+    if (p >= end)
+    {
+        *pos = p;
+        return NULL;
+    }
 
-    for (i = 0; i < vc->count; i++)
+    tok = out = p;
+
+    while (p < end)
     {
-        switch (vc->type)
+        c = *p;
+
+        if (quote)
         {
-            case CARGO_STRING:
+            if (c == quote)
             {
-                char *str = ((char *)value);
-                if (case_sensitive)
-                {
-                    if (!strcmp(vc->strs[i], str))
-                    {
-                        return 0;
-                    }
-                }
-                else
-                {
-                    if (!strcasecmp(vc->strs[i], str))
-                    {
-                        return 0;
-                    }
-                }
-                break;
+                quote = 0;
+                p++;
+                continue;
             }
-            case CARGO_INT:
-                if (vc->nums[i].i == *((int *)value))
-                    return 0;
-                break;
-            case CARGO_UINT:
-                if (vc->nums[i].u == *((unsigned int *)value))
-                    return 0;
-                break;
-            case CARGO_FLOAT:
-                if (_cargo_nearly_equal(vc->nums[i].f, *((float *)value),
-                                        vc->epsilon))
-                    return 0;
-                break;
-            case CARGO_DOUBLE:
-                if (_cargo_nearly_equal(vc->nums[i].d, *((double *)value),
-                                        vc->epsilon))
-                    return 0;
-                break;
-            case CARGO_LONGLONG:
-                if (vc->nums[i].ll == *((long long int *)value))
-                    return 0;
-                break;
-            case CARGO_ULONGLONG:
-                if (vc->nums[i].ull == *((unsigned long long int *)value))
-                    return 0;
-                break;
-            default:
+
+            if ((c == '\\') && (quote == '"') && ((p + 1) < end)
+                && ((p[1] == '"') || (p[1] == '\\')))
+            {
+                c = *(++p);
+            }
+        }
+        else
+        {
+            if (isspace((unsigned char)c))
                 break;
+
+            if ((c == '"') || (c == '\''))
+            {
+                quote = c;
+                p++;
+                continue;
+            }
+
+            if ((c == '\\') && ((p + 1) < end))
+            {
+                c = *(++p);
+            }
         }
+
+        // Only write when something was removed, so untouched
+        // pages of a mapped file are never copied.
+        if (out != p)
+            *out = c;
+        out++;
+        p++;
     }
 
-    cargo_set_error(ctx, 0, "The value for %s, must be one of these %s: %s",
-                    opt, case_sensitive ? "(case sensitive)" : "", vc->err);
+    if (out < end)
+        *out = '\0';
 
-    return -1;
+    *pos = (p < end) ? (p + 1) : p;
+    *len = (size_t)(out - tok);
+
+    return tok;
 }
 
-cargo_validation_t *cargo_validate_choices(cargo_validate_choices_flags_t flags,
-                                            cargo_type_t type,
-                                            size_t count, ...)
+// Splits a mapped response file into arguments in place.
+static int _cargo_tokenize_response_file(cargo_t ctx, char *data,
+                                         size_t size, int depth,
+                                         char ***list, size_t *count,
+                                         size_t *max)
 {
-    va_list ap;
-    size_t i;
-    cargo_astr_t str;
-    cargo_validation_t *v = NULL;
-    cargo_choices_validation_t *vc = NULL;
-    memset(&str, 0, sizeof(str));
+    int ret = 0;
+    char *p = data;
+    char *end = data + size;
+    char *tok = NULL;
+    size_t len = 0;
 
-    if (!(vc = _cargo_calloc(1, sizeof(cargo_choices_validation_t))))
+    while ((tok = _cargo_next_arg_inplace(&p, end, &len)))
     {
-        return NULL;
+        // The last argument ends the file, no room for the NUL.
+        if (((tok + len) == end)
+            && !(tok = _cargo_arena_strndup(&ctx->arena, tok, len)))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            return CARGO_PARSE_NOMEM;
+        }
+
+        if ((ret = _cargo_expand_arg(ctx, tok, depth, list, count, max)))
+        {
+            return ret;
+        }
     }
 
-    if (!(v = cargo_create_validator("choices",
-                _cargo_validate_choices_cb,
-                _cargo_validate_choices_destroy_cb,
-                (CARGO_STRING | CARGO_INT | CARGO_UINT | CARGO_FLOAT |
-                 CARGO_DOUBLE | CARGO_LONGLONG | CARGO_ULONGLONG),
-                vc)))
+    return 0;
+}
+
+static int _cargo_read_response_file(cargo_t ctx, const char *path,
+                                     int depth, char ***list,
+                                     size_t *count, size_t *max)
+{
+    int ret = 0;
+    cargo_mapping_t m;
+
+    if (depth >= CARGO_RESPONSE_FILE_MAX_DEPTH)
     {
-        _cargo_free(vc);
-        return NULL;
+        return _cargo_response_file_error(ctx, path,
+                                "Response files nested too deep");
     }
 
-    vc->flags = flags;
-    vc->type = type;
-    vc->count = count;
+    if (_cargo_arena_grow(&ctx->arena, &ctx->mappings, &ctx->max_mappings,
+                          ctx->mapping_count, sizeof(cargo_mapping_t)))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        return CARGO_PARSE_NOMEM;
+    }
 
-    if (vc->type == CARGO_STRING)
+    if ((ret = _cargo_map_file(ctx, path, &m)))
     {
-        if (!(vc->strs = _cargo_calloc(vc->count, sizeof(char *))))
-        {
-            CARGODBG(1, "Out of memory\n");
-            goto fail;
-        }
+        return ret;
     }
-    else
+
+    if (m.data)
     {
-        if (!(vc->nums = _cargo_calloc(vc->count, sizeof(cargo_vals_t))))
-        {
-            CARGODBG(1, "Out of memory\n");
-            goto fail;
-        }
+        ctx->mappings[ctx->mapping_count++] = m;
     }
 
-    // Start out with room strings of 20 chars
-    // to keep reallocation to a minimum.
-    str.s = &vc->err;
-    str.l = count * 20;
+    CARGODBG(2, "Response file \"%s\" (%lu bytes)\n", path, m.size);
 
-    va_start(ap, count);
+    return _cargo_tokenize_response_file(ctx, m.data, m.size, depth + 1,
+                                         list, count, max);
+}
 
-    if (vc->flags & CARGO_VALIDATE_CHOICES_SET_EPSILON)
-    {
-        vc->epsilon = va_arg(ap, double);
-    }
-    else
+static int _cargo_expand_arg(cargo_t ctx, char *arg, int depth,
+                             char ***list, size_t *count, size_t *max)
+{
+    if ((arg[0] == '@') && (arg[1] != '\0'))
     {
-        vc->epsilon = CARGO_DEFAULT_EPSILON;
+        return _cargo_read_response_file(ctx, arg + 1, depth,
+                                         list, count, max);
     }
 
-    for (i = 0; i < vc->count; i++)
-    {
-        switch (vc->type)
-        {
-            case CARGO_STRING:
-            {
-                if (!(vc->strs[i] = _cargo_strdup(va_arg(ap, char *))))
-                {
-                    goto fail;
-                }
-
-                cargo_aappendf(&str, "%s", vc->strs[i]);
-                break;
-            }
-            case CARGO_INT:
-            {
-                vc->nums[i].i = va_arg(ap, int);
-                cargo_aappendf(&str, "%d", vc->nums[i].i);
-                break;
-            }
-            case CARGO_UINT:
-            {
-                vc->nums[i].u = va_arg(ap, unsigned int);
-                cargo_aappendf(&str, "%u", vc->nums[i].u);
-                break;
-            }
-            case CARGO_FLOAT:
-            {
-                vc->nums[i].f = (float)va_arg(ap, double);
-                cargo_aappendf(&str, "%.2f", vc->nums[i].f);
-                break;
-            }
-            case CARGO_DOUBLE:
-            {
-                vc->nums[i].d = va_arg(ap, double);
-                cargo_aappendf(&str, "%.2f", vc->nums[i].d);
-                break;
-            }
-            case CARGO_LONGLONG:
-            {
-                vc->nums[i].ll = va_arg(ap, long long int);
-                cargo_aappendf(&str, "%"CARGO_LONGLONG_FMT, vc->nums[i].ll);
-                break;
-            }
-            case CARGO_ULONGLONG:
-            {
-                vc->nums[i].ull = va_arg(ap, unsigned long long int);
-                cargo_aappendf(&str, "%"CARGO_ULONGLONG_FMT, vc->nums[i].ull);
-                break;
-            }
-            default:
-                break;
-        }
-
-        if (i + 1 < vc->count)
-        {
-            cargo_aappendf(&str, ", ");
-        }
-    }
-
-    va_end(ap);
-
-    return v;
-fail:
-    _cargo_xfree(&vc->strs);
-    _cargo_xfree(&vc->nums);
-    _cargo_xfree(&vc->err);
-    _cargo_free(vc);
-    _cargo_free(v);
-    return NULL;
+    return _cargo_add_response_arg(ctx, list, count, max, arg);
 }
 
-int cargo_add_validation(cargo_t ctx, cargo_validation_flags_t flags,
-                        const char *opt, cargo_validation_t *vd)
+// Replaces any "@file" arguments with the contents of the file.
+static int _cargo_expand_response_files(cargo_t ctx)
 {
-    size_t opt_i;
-    size_t name_i;
-    cargo_opt_t *o;
-    assert(ctx);
-    assert(opt);
+    int ret = 0;
+    int i;
+    char **list = NULL;
+    size_t count = 0;
+    size_t max = 0;
 
-    if (!vd)
+    for (i = ctx->start; i < ctx->argc; i++)
     {
-        CARGODBG(1, "Got NULL validation for options \"%s\"\n", opt);
-        return -1;
+        if ((ctx->argv[i][0] == '@') && (ctx->argv[i][1] != '\0'))
+            break;
     }
 
-    if (!(vd->validator))
-    {
-        CARGODBG(1, "Validation missing validator function for \"%s\"\n", opt);
-        goto fail;
-    }
+    // Nothing to expand.
+    if (i == ctx->argc)
+        return 0;
 
-    if (_cargo_find_option_name(ctx, opt, &opt_i, &name_i))
+    for (i = 0; i < ctx->argc; i++)
     {
-        CARGODBG(1, "Failed to find option \"%s\"\n", opt);
-        goto fail;
-    }
+        if (i < ctx->start)
+        {
+            ret = _cargo_add_response_arg(ctx, &list, &count, &max,
+                                          ctx->argv[i]);
+        }
+        else
+        {
+            ret = _cargo_expand_arg(ctx, ctx->argv[i], 0,
+                                    &list, &count, &max);
+        }
 
-    o = &ctx->options[opt_i];
+        if (ret)
+            return ret;
+    }
 
-    if (!(o->type & vd->types))
+    // Terminate it like a real argv.
+    if ((ret = _cargo_add_response_arg(ctx, &list, &count, &max, NULL)))
     {
-        CARGODBG(1, "\"%s\" of type \"%s\" is not supported by the validation %s\n",
-                opt, _cargo_type_to_str(o->type), vd->name);
-        goto fail;
+        return ret;
     }
 
-    // Remove current validation.
-    _cargo_option_destroy_validation(o);
-
-    // We have a reference count so that
-    // multiple options can use the same validation.
-    vd->ref_count++;
-    o->validation = vd;
-    o->validation_flags = flags;
+    ctx->argv = list;
+    ctx->argc = (int)(count - 1);
 
     return 0;
-fail:
-    _cargo_free_validation(&vd);
-    return -1;
 }
 
-void cargo_free_commandline(char ***argv, int argc)
+static void _cargo_stream_clear(cargo_t ctx)
 {
     size_t i;
-    assert(argv);
 
-    if (*argv)
+    for (i = 0; i < ctx->stream_count; i++)
     {
-        for (i = 0; i < (size_t)argc; i++)
-        {
-            _cargo_xfree(&((*argv)[i]));
-        }
+        _cargo_free(&ctx->mem, ctx->stream_argv[i]);
+    }
 
-        _cargo_xfree(argv);
+    _cargo_xfree(&ctx->mem, &ctx->stream_argv);
+    ctx->stream_count = 0;
+    ctx->stream_max = 0;
+    ctx->stream_base = 0;
+    ctx->stream_opt = NULL;
+    ctx->stream_name = NULL;
+    ctx->stream_final = 0;
+
+    if (ctx->streaming)
+    {
+        ctx->streaming = 0;
+        ctx->argv = NULL;
+        ctx->argc = 0;
     }
 }
 
-char **cargo_split_commandline(cargo_splitcmd_flags_t flags, const char *cmdline, int *argc)
+void cargo_destroy(cargo_t *ctx)
 {
-    int i;
-    char **argv = NULL;
-    assert(argc);
+    size_t i;
 
-    if (!cmdline)
-    {
-        CARGODBG(1, "Got NULL input\n");
-        return NULL;
-    }
+    CARGODBG(2, "cargo_destroy: DESTROY!\n");
 
-    // Posix.
-    #ifndef _WIN32
+    if (ctx && *ctx)
     {
-        int ret;
-        wordexp_t p;
-        memset(&p, 0, sizeof(p));
+        cargo_opt_t *opt;
+        cargo_mem_t mem;
+        cargo_t c = *ctx;
 
-        // Note! This expands shell variables.
-        if ((ret = wordexp(cmdline, &p, 0)))
+        if (c->flags & CARGO_AUTOCLEAN)
         {
-            CARGODBG(1, "wordexp error %d: '%s'\n", ret, cmdline);
-            return NULL;
+            CARGODBG(2, "Auto clean target values\n");
+            _cargo_cleanup_option_values(c, 1);
         }
 
-        *argc = p.we_wordc;
-
-        if (!(argv = _cargo_calloc(*argc, sizeof(char *))))
-        {
-            CARGODBG(1, "Out of memory!\n");
-            goto fail;
-        }
+        // In case a streamed parse was never ended.
+        _cargo_stream_clear(c);
+        _cargo_unmap_response_files(c);
 
-        for (i = 0; i < p.we_wordc; i++)
+        if (c->compiled)
         {
-            if (!(argv[i] = _cargo_strdup(p.we_wordv[i])))
+            // A parse state only owns its copy of the options, everything
+            // else is shared with the compiled parser.
+            for (i = 0; i < c->opt_count; i++)
             {
-                CARGODBG(1, "Out of memory!\n");
-                goto fail;
+                opt = &c->options[i];
+                _cargo_free_str_list(&c->mem, &opt->custom_target,
+                                     &opt->custom_target_count);
             }
-        }
-
-        // wordfree seems to fail to free everything in the wordexp_t struct
-        // at least on OSX 10.9.5. This is supposed to help on 10.8.5 at least.
-        p.we_offs = 0;
-        wordfree(&p);
-
-        return argv;
-    fail:
-        p.we_offs = 0;
-        wordfree(&p);
-    }
-    #else // WIN32
-    {
-        // TODO: __getmainargs is an alternative... https://msdn.microsoft.com/en-us/library/ff770599.aspx
-        wchar_t **wargs = NULL;
-        size_t needed = 0;
-        wchar_t *cmdlinew = NULL;
-        size_t len = strlen(cmdline) + 1;
 
-        if (!(cmdlinew = _cargo_calloc(len, sizeof(wchar_t))))
-        {
-            CARGODBG(1, "Out of memory!\n");
-            goto fail;
+            _cargo_xfree(&c->mem, &c->options);
         }
-
-        if (!MultiByteToWideChar(CP_ACP, 0, cmdline, -1, cmdlinew, len))
+        else
         {
-            CARGODBG(1, "Failed to convert to unicode!\n");
-            goto fail;
-        }
+            if (c->options)
+            {
+                CARGODBG(2, "DESTROY %lu options!\n", c->opt_count);
 
-        if (!(wargs = CommandLineToArgvW(cmdlinew, argc)))
-        {
-            CARGODBG(1, "Out of memory!\n");
-            goto fail;
-        }
+                for (i = 0; i < c->opt_count; i++)
+                {
+                    opt = &c->options[i];
+                    CARGODBG(2, "Free opt: %s\n", opt->name[0]);
+                    _cargo_option_destroy(&c->mem, opt);
+                }
 
-        if (!(argv = _cargo_calloc(*argc, sizeof(char *))))
-        {
-            CARGODBG(1, "Out of memory!\n");
-            goto fail;
-        }
+                _cargo_xfree(&c->mem, &c->options);
+            }
 
-        // Convert from wchar_t * to ANSI char *
-        for (i = 0; i < *argc; i++)
-        {
-            // Get the size needed for the target buffer.
-            // CP_ACP = Ansi Codepage.
-            needed = WideCharToMultiByte(CP_ACP, 0, wargs[i], -1,
-                                        NULL, 0, NULL, NULL);
+            _cargo_name_index_destroy(&c->mem, &c->name_index);
+            _cargo_xfree(&c->mem, &c->trie);
+            _cargo_xfree(&c->mem, &c->positionals);
+            _cargo_groups_destroy(c);
 
-            if (!(argv[i] = _cargo_malloc(needed)))
+            for (i = 0; i < c->ext_type_count; i++)
             {
-                CARGODBG(1, "Out of memory!\n");
-                goto fail;
+                _cargo_free(&c->mem, c->ext_types[i].name);
             }
 
-            // Do the conversion.
-            needed = WideCharToMultiByte(CP_ACP, 0, wargs[i], -1,
-                                        argv[i], needed, NULL, NULL);
+            _cargo_xfree(&c->mem, &c->ext_types);
+            _cargo_xfree(&c->mem, &c->description);
+            _cargo_xfree(&c->mem, &c->epilog);
+            _cargo_xfree(&c->mem, &c->progname);
         }
 
-        if (wargs) LocalFree(wargs);
-        _cargo_xfree(&cmdlinew);
-        return argv;
-
-    fail:
-        if (wargs) LocalFree(wargs);
-        _cargo_xfree(&cmdlinew);
-    }
-    #endif // WIN32
-
-    if (argv)
-    {
-        for (i = 0; i < *argc; i++)
-        {
-            _cargo_xfree(&argv[i]);
-        }
+        _cargo_xfree(&c->mem, &c->tokens);
+        _cargo_ctx_free(c, c->error);
+        _cargo_arena_destroy(&c->arena);
+        _cargo_xfree(&c->mem, &c->short_usage);
+        _cargo_xfree(&c->mem, &c->usage);
 
-        _cargo_free(argv);
+        mem = c->mem;
+        _cargo_free(&mem, c);
+        *ctx = NULL;
     }
-
-    return NULL;
 }
 
-const char *cargo_get_version()
+void cargo_set_flags(cargo_t ctx, cargo_flags_t flags)
 {
-    return CARGO_VERSION_STR;
+    assert(ctx);
+    ctx->flags = flags;
 }
 
-void cargo_set_context(cargo_t ctx, void *user)
+cargo_flags_t cargo_get_flags(cargo_t ctx)
 {
     assert(ctx);
-    ctx->user = user;
+    return ctx->flags;
 }
 
-void *cargo_get_context(cargo_t ctx)
+void cargo_set_prefix(cargo_t ctx, const char *prefix_chars)
 {
     assert(ctx);
-    return ctx->user;
-}
 
-int cargo_set_group_context(cargo_t ctx, const char *group, void *user)
-{
-    if (!group) group = "";
-    return _cargo_set_group_context(ctx, group,
-                ctx->groups, ctx->group_count, user);
+    if (_cargo_is_compiled(ctx))
+        return;
+
+    ctx->prefix = prefix_chars;
 }
 
-void *cargo_get_group_context(cargo_t ctx, const char *group)
+void cargo_set_prognamev(cargo_t ctx, const char *fmt, va_list ap)
 {
-    if (!group) group = "";
-    return _cargo_get_group_context(ctx, group, ctx->groups, ctx->group_count);
+    assert(ctx);
+
+    if (_cargo_is_compiled(ctx))
+        return;
+
+    _cargo_xfree(&ctx->mem, &ctx->progname);
+    _cargo_vasprintf(&ctx->mem, &ctx->progname, fmt, ap);
 }
 
-int cargo_set_mutex_group_context(cargo_t ctx, const char *mutex_group, void *user)
+void cargo_set_progname(cargo_t ctx, const char *fmt, ...)
 {
-    assert(mutex_group);
-    return _cargo_set_group_context(ctx, mutex_group,
-                ctx->mutex_groups, ctx->mutex_group_count, user);
+    va_list ap;
+    assert(ctx);
+    va_start(ap, fmt);
+    cargo_set_prognamev(ctx, fmt, ap);
+    va_end(ap);
 }
 
-void *cargo_get_mutex_group_context(cargo_t ctx, const char *mutex_group)
+void cargo_set_descriptionv(cargo_t ctx, const char *fmt, va_list ap)
 {
-    assert(mutex_group);
-    return _cargo_get_group_context(ctx, mutex_group,
-                ctx->mutex_groups, ctx->mutex_group_count);
+    assert(ctx);
+
+    if (_cargo_is_compiled(ctx))
+        return;
+
+    _cargo_xfree(&ctx->mem, &ctx->description);
+    _cargo_vasprintf(&ctx->mem, &ctx->description, fmt, ap);
 }
 
-const char *cargo_get_option_group(cargo_t ctx, const char *opt)
+void cargo_set_description(cargo_t ctx, const char *fmt, ...)
 {
-    return _cargo_option_get_group(ctx, opt, ctx->groups, ctx->group_count);
+    va_list ap;
+    assert(ctx);
+    va_start(ap, fmt);
+    cargo_set_descriptionv(ctx, fmt, ap);
+    va_end(ap);
 }
 
-const char **cargo_get_option_mutex_groups(cargo_t ctx,
-                                            const char *opt, size_t *count)
+void cargo_set_epilogv(cargo_t ctx, const char *fmt, va_list ap)
 {
-    size_t i;
-    cargo_opt_t *o = NULL;
-    cargo_group_t *mgrp = NULL;
-    size_t opt_i;
     assert(ctx);
-    assert(opt);
 
-    if (count) *count = 0;
+    if (_cargo_is_compiled(ctx))
+        return;
 
-    if (_cargo_find_option_name(ctx, opt, &opt_i, NULL))
-    {
-        CARGODBG(1, "No such option \"%s\"\n", opt);
-        return NULL;
-    }
+    _cargo_xfree(&ctx->mem, &ctx->epilog);
+    _cargo_vasprintf(&ctx->mem, &ctx->epilog, fmt, ap);
+}
 
-    o = &ctx->options[opt_i];
+void cargo_set_epilog(cargo_t ctx, const char *fmt, ...)
+{
+    va_list ap;
+    assert(ctx);
+    va_start(ap, fmt);
+    cargo_set_epilogv(ctx, fmt, ap);
+    va_end(ap);
+}
 
-    // Use cached version. Mutex group count should
-    // not be changed between calls anyway.
-    if (o->mutex_group_names)
-    {
-        if (count) *count = o->mutex_group_count;
-        return (const char **)o->mutex_group_names;
-    }
+typedef struct cargo_phighlight_s
+{
+    int i;              // Index of highlight in argv.
+    char *c;            // Highlight character (followed by color).
+    int indent;         // Indent position for highlight in relation
+                        // to previous highlight.
+    int total_indent;   // Total indentation since start of string.
+    int highlight_len;  // Length of the highlight.
+    int show;
+} cargo_phighlight_t;
+
+static int _cargo_compare_highlights(const void *a, const void *b)
+{
+    cargo_phighlight_t *ha = (cargo_phighlight_t *)a;
+    cargo_phighlight_t *hb = (cargo_phighlight_t *)b;
+    return (ha->i - hb->i);
+}
 
-    if (!(o->mutex_group_names = _cargo_calloc(o->mutex_group_count, sizeof(char *))))
+static char *_cargo_get_fprintl_args(cargo_arena_t *arena,
+                            int argc, char **argv, int start,
+                            cargo_fprint_flags_t flags,
+                            size_t max_width,
+                            size_t highlight_count,
+                            const cargo_highlight_t *highlights_in)
+{
+    char *ret = NULL;
+    int i;
+    int j;
+    int global_indent = 0;
+    size_t arglen = 0;
+    cargo_str_t str;
+    char *out = NULL;
+    size_t out_size = 0;
+    cargo_phighlight_t *highlights = NULL;
+    assert(highlights_in);
+
+    max_width = _cargo_process_max_width(max_width);
+
+    if (!(highlights = arena
+        ? _cargo_arena_calloc(arena, highlight_count, sizeof(cargo_phighlight_t))
+        : _cargo_calloc(NULL, highlight_count, sizeof(cargo_phighlight_t))))
     {
-        CARGODBG(1, "Out of memory\n");
+        CARGODBG(1, "Out of memory!\n");
         return NULL;
     }
 
-    for (i = 0; i < o->mutex_group_count; i++)
+    for (i = 0; i < (int)highlight_count; i++)
     {
-        mgrp = &ctx->mutex_groups[o->mutex_group_idxs[i]];
-        o->mutex_group_names[i] = _cargo_strdup(mgrp->name);
+        highlights[i].i = highlights_in[i].i;
+        highlights[i].c = highlights_in[i].c;
+        CARGODBG(6, "  Highlight %d: %d\n", i, highlights[i].i);
     }
 
-    if (count) *count = o->mutex_group_count;
+    CARGODBG(6, "  Sort highlights:\n");
+    qsort(highlights, highlight_count,
+        sizeof(cargo_phighlight_t), _cargo_compare_highlights);
 
-    if (o->mutex_group_count == 0)
+    #if (CARGO_DEBUG >= 6)
+    for (i = 0; i < (int)highlight_count; i++)
     {
-        return NULL;
+        CARGODBG(6, "  Highlight %d: %d\n", i, highlights[i].i);
     }
+    #endif
 
-    return (const char **)o->mutex_group_names;
-}
-
-cargo_type_t cargo_get_option_type(cargo_t ctx, const char *opt)
-{
-    cargo_opt_t *o = NULL;
-    size_t opt_i;
-    assert(ctx);
-    assert(opt);
-
-    if (_cargo_find_option_name(ctx, opt, &opt_i, NULL))
+    // Get buffer size and highlight data.
+    for (i = 0, j = 0; i < argc; i++)
     {
-        CARGODBG(1, "No such option \"%s\"\n", opt);
-        return -1;
-    }
+        arglen = (i >= start) ? strlen(argv[i]) : 0;
 
-    o = &ctx->options[opt_i];
+        if (arglen + global_indent >= max_width)
+        {
+            break;
+        }
 
-    return o->type;
-}
+        if (j < (int)highlight_count)
+        {
+            cargo_phighlight_t *h = &highlights[j];
+            if (h->i == i)
+            {
+                // We only keep this flag so that we can make sure we don't
+                // output the color codes when an index is out of range.
+                if (i >= start)
+                {
+                    h->show = 1;
+                }
 
-#endif // !CARGO_NOLIB
+                h->highlight_len = (int)arglen;
+                h->total_indent = global_indent;
 
-// -----------------------------------------------------------------------------
-// Tests.
-// -----------------------------------------------------------------------------
-// LCOV_EXCL_START
-#ifdef CARGO_TEST
+                // We want to indent in relation to the previous indentation.
+                if (j > 0)
+                {
+                    cargo_phighlight_t *hprev = &highlights[j - 1];
+                    h->indent = h->total_indent
+                              - (hprev->total_indent + hprev->highlight_len);
+                }
+                else
+                {
+                    h->indent = h->total_indent;
+                }
 
-#define LOREM_IPSUM                                                         \
-    "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do"       \
-    " eiusmod tempor incididunt ut labore et dolore magna aliqua. "         \
-    "Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris "   \
-    "nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in "    \
-    "reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla "  \
-    "pariatur. Excepteur sint occaecat cupidatat non proident, sunt in "    \
-    "culpa qui officia deserunt mollit anim id est laborum."
+                // If we use color, we must include the ANSI color code length
+                // in the buffer length as well.
+                out_size += strlen(h->c);
 
+                j++;
+            }
+        }
 
-#define cargo_assert(test, message) \
-do                                  \
-{                                   \
-    if (!(test))                    \
-    {                               \
-        msg = message;              \
-        goto fail;                  \
-    }                               \
-} while (0)
+        global_indent += arglen;
+        if (i >= start) global_indent++; // + 1 for space.
+        out_size += global_indent;
+    }
 
-// Used for asserting in custom callbacks.
-#define cargo_cb_assert(cond, msg)      \
-do                                      \
-{                                       \
-    if (!(cond))                        \
-    {                                   \
-        fprintf(stderr, "%s\n", msg);   \
-        return -1;                      \
-    }                                   \
-} while (0);
+    // Allocate and fill buffer.
+    out_size += 2; // New lines.
+    out_size *= 2; // Two rows, one for args and one for highlighting.
 
-#define cargo_assert_array(count, expected_count, array, array_expected)    \
-do                                                                          \
-{                                                                           \
-    size_t k;                                                               \
-    printf("Check that \""#array"\" has "#expected_count" elements\n");     \
-    cargo_assert((count) == (expected_count),                               \
-        #array" array count "#count" is not expected "#expected_count);     \
-    for (k = 0; k < (count); k++)                                           \
-    {                                                                       \
-        cargo_assert((array)[k] == (array_expected)[k],                     \
-            "Array contains unexpected value");                             \
-    }                                                                       \
-} while (0)
+    if (!(out = arena ? _cargo_arena_alloc(arena, out_size)
+                      : _cargo_malloc(NULL, out_size)))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        goto fail;
+    }
 
-#define cargo_assert_str_array(count, expected_count, array, array_expected)    \
-do                                                                              \
-{                                                                               \
-    size_t k;                                                                   \
-    printf("Check that \""#array"\" has "#expected_count" elements\n");         \
-    cargo_assert((count) == (expected_count),                                   \
-        #array" array count "#count" is not expected "#expected_count);         \
-    for (k = 0; k < count; k++)                                                 \
-    {                                                                           \
-        printf("  %lu: \"%s\" -> \"%s\"\n",                                     \
-            k+1, (char *)(array)[k], (char *)(array_expected)[k]);              \
-        cargo_assert(!strcmp((char *)(array)[k], (char *)(array_expected)[k]),  \
-            "Array contains unexpected value");                                 \
-    }                                                                           \
-} while (0)
+    str.s = out;
+    str.l = out_size;
+    str.offset = 0;
 
-static int malloc_fail_count;
-static int malloc_current;
-static int realloc_fail_count;
-static int realloc_current;
+    // TODO: Try adding an "..." and try to fit all highlights on screen if possible.
+    if (!(flags & CARGO_FPRINT_NOARGS))
+    {
+        for (i = start; i < argc; i++)
+        {
+            // The highlight will be incorrect if we allow a line break.
+            if (str.offset + strlen(argv[i]) >= max_width)
+            {
+                break;
+            }
 
-void _cargo_test_set_malloc_fail_count(int count)
-{
-    malloc_current = 0;
-    malloc_fail_count = count;
-}
+            cargo_appendf(&str, "%s ", argv[i]);
+        }
 
-void *_cargo_test_malloc(size_t sz)
-{
-    malloc_current++;
+        cargo_appendf(&str, "\n");
+    }
 
-    if ((malloc_fail_count > 0)
-        && (malloc_current >= malloc_fail_count))
-        return NULL;
-
-    return malloc(sz);
-}
+    if (!(flags & CARGO_FPRINT_NOHIGHLIGHT))
+    {
+        for (i = 0; i < (int)highlight_count; i++)
+        {
+            cargo_phighlight_t *h = &highlights[i];
+            int k;
+            int has_color = strlen(h->c) > 1;
 
-void _cargo_test_set_realloc_fail_count(int count)
-{
-    realloc_current = 0;
-    realloc_fail_count = count;
-}
+            if (h->highlight_len == 0)
+                continue;
 
-void *_cargo_test_realloc(void *ptr, size_t sz)
-{
-    realloc_current++;
+            // If we have more characters, we append that as a string.
+            // (This can be used for color ansi color codes).
+            if (!(flags & CARGO_FPRINT_NOCOLOR) && has_color && h->show)
+            {
+                cargo_appendf(&str, "%s", &h->c[1]);
+            }
 
-    if ((realloc_fail_count > 0)
-        && (realloc_current >= realloc_fail_count))
-        return NULL;
+            cargo_appendf(&str, "%*s", h->indent, "");
 
-    return realloc(ptr, sz);
-}
+            // Use the first character as the highlight character.
+            //                                ~~~~~~~~~
+            for (k = 0; (k < h->highlight_len) && (str.offset + 1 < str.l); k++)
+            {
+                str.s[str.offset++] = *h->c;
+            }
 
-//
-// Some helper macros for creating test functions.
-//
-#define _MAKE_TEST_FUNC_NAME(f) f()
+            str.s[str.offset] = '\0';
 
-// Start a test. Initializes the lib.
-#define _TEST_START_EX(testname, flags)                 \
-static const char *_MAKE_TEST_FUNC_NAME(testname)       \
-{                                                       \
-    const char *msg = NULL;                             \
-    int ret = 0;                                        \
-    cargo_t cargo;                                      \
-                                                        \
-    if (cargo_init(&cargo, flags, "program"))           \
-    {                                                   \
-        return "Failed to init cargo";                  \
+            if (!(flags & CARGO_FPRINT_NOCOLOR) && has_color && h->show)
+            {
+                cargo_appendf(&str, "%s", CARGO_COLOR_RESET);
+            }
+        }
     }
 
-#define _TEST_START(testname) _TEST_START_EX(testname, 0)
+    ret = out;
 
-// Cleanup point, must be placed at the end of the test
-//
-// scope _TEST_START(name) { ... _TEST_CLEANUP(); free(something) } _TEST_END()
-//
-// cargo_assert jumps to this point on failure. Any cleanup should be
-// placed after this call.
-#define _TEST_CLEANUP()     \
-    fail: (void)0
+fail:
+    if (!arena)
+    {
+        if (!ret) _cargo_free(NULL, out);
+        _cargo_free(NULL, highlights);
+    }
 
-#define _TEST_END()         \
-    cargo_destroy(&cargo);  \
-    return msg;             \
+    return ret;
 }
 
-// For tests where we want to assert after
-// cargo_destroy has been called.
-#define _TEST_END_NODESTROY()   \
-    return msg;                 \
+char *cargo_get_fprintl_args(int argc, char **argv, int start,
+                            cargo_fprint_flags_t flags,
+                            size_t max_width,
+                            size_t highlight_count,
+                            const cargo_highlight_t *highlights_in)
+{
+    return _cargo_get_fprintl_args(NULL, argc, argv, start, flags, max_width,
+                                   highlight_count, highlights_in);
 }
 
-// =================================================================
-// Test functions.
-// =================================================================
-
-_TEST_START(TEST_no_args_bool_option)
+char *cargo_get_vfprint_args(int argc, char **argv, int start,
+                            cargo_fprint_flags_t flags,
+                            size_t max_width,
+                            size_t highlight_count, va_list ap)
 {
-    int a;
-    char *args[] = { "program", "--alpha" };
-    int argc = sizeof(args) / sizeof(args[0]);
-
-    ret = cargo_add_option(cargo, 0, "--alpha", "Description", "b", &a);
-    cargo_assert(ret == 0, "Failed to add valid bool option");
+    char *ret = NULL;
+    int i;
+    cargo_highlight_t *highlights = NULL;
 
-    if (cargo_parse(cargo, 0, 1, argc, args))
+    // Create a list of indices to highlight from the va_args.
+    if (!(highlights = _cargo_calloc(NULL, highlight_count, sizeof(cargo_highlight_t))))
     {
-        msg = "Failed to parse bool with no argument";
+        CARGODBG(1, "Out of memory trying to allocate %lu highlights!\n",
+                highlight_count);
         goto fail;
     }
 
-    cargo_assert(a == 1, "Failed to parse bool with no argument to 1");
+    for (i = 0; i < (int)highlight_count; i++)
+    {
+        highlights[i].i = va_arg(ap, int);
+        highlights[i].c = va_arg(ap, char *);
+    }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    ret = cargo_get_fprintl_args(argc, argv, start, flags, max_width,
+                                highlight_count, highlights);
 
-//
-// Simple add option tests.
-//
-#define _TEST_ADD_SIMPLE_OPTION(name, type, value, fmt, ...)                \
-    _TEST_START(name)                                                       \
-    {                                                                       \
-        char *args[] = { "program", "--alpha", #value };                    \
-        type a;                                                             \
-        ret = cargo_add_option(cargo, 0, "--alpha -a",                      \
-                                "Description",                              \
-                                fmt,                                        \
-                                &a, ##__VA_ARGS__);                         \
-        cargo_assert(ret == 0, "Failed to add valid "#type" option");       \
-        if (cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args)) \
-        {                                                                   \
-            msg = "Failed to parse "#type" with value \""#value"\"";        \
-            goto fail;                                                      \
-        }                                                                   \
-        printf("Attempt to parse value: "#value"\n");                       \
-        cargo_assert(a == value, "Failed to parse correct value "#value);   \
-        _TEST_CLEANUP();                                                    \
-    }                                                                       \
-    _TEST_END()
+fail:
+    _cargo_xfree(NULL, &highlights);
 
-_TEST_ADD_SIMPLE_OPTION(TEST_add_integer_option, int, -3, "i")
-_TEST_ADD_SIMPLE_OPTION(TEST_add_uinteger_option, unsigned int, 3, "u")
-_TEST_ADD_SIMPLE_OPTION(TEST_add_float_option, float, 0.3f, "f")
-_TEST_ADD_SIMPLE_OPTION(TEST_add_bool_option, int, 1, "b")
-_TEST_ADD_SIMPLE_OPTION(TEST_add_double_option, double, 0.4, "d")
+    return ret;
+}
 
-_TEST_START(TEST_add_static_string_option)
+char *cargo_get_fprint_args(int argc, char **argv, int start,
+                            cargo_fprint_flags_t flags,
+                            size_t max_width,
+                            size_t highlight_count, ...)
 {
-    char b[10];
-    char *args[] = { "program", "--beta", "abc" };
-    ret = cargo_add_option(cargo, 0, "--beta -b",
-                            "Description",
-                            ".s#",
-                            &b, sizeof(b));
-    cargo_assert(ret == 0, "Failed to add valid static string option");
+    char *ret;
+    va_list ap;
+    va_start(ap, highlight_count);
+    ret = cargo_get_vfprint_args(argc, argv, start, flags,
+                                max_width, highlight_count, ap);
+    va_end(ap);
+    return ret;
+}
 
-    if (cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args))
+int cargo_fprint_args(FILE *f, int argc, char **argv, int start,
+                      cargo_fprint_flags_t flags, size_t max_width,
+                      size_t highlight_count, ...)
+{
+    char *ret;
+    va_list ap;
+    va_start(ap, highlight_count);
+    ret = cargo_get_vfprint_args(argc, argv, start, flags,
+                                max_width, highlight_count, ap);
+    va_end(ap);
+
+    if (!ret)
     {
-        msg = "Failed to parse static char * with value \"abc\"";
-        goto fail;
+        return -1;
     }
-    printf("Attempt to parse value: abc\n");
-    cargo_assert(!strcmp(b, "abc"), "Failed to parse correct value abc");
-    _TEST_CLEANUP();
+
+    fprintf(f, "%s\n", ret);
+    _cargo_free(NULL, ret);
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_add_alloc_string_option)
+int cargo_fprintl_args(FILE *f, int argc, char **argv, int start,
+                       cargo_fprint_flags_t flags,
+                       size_t max_width, size_t highlight_count,
+                       const cargo_highlight_t *highlights)
 {
-    char *b = NULL;
-    char *args[] = { "program", "--beta", "abc" };
-    ret = cargo_add_option(cargo, 0, "--beta -b",
-                            "Description",
-                            "s",
-                            &b);
-    cargo_assert(ret == 0, "Failed to add valid alloc string option");
-
-    if (cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args))
+    char *ret;
+    if (!(ret = cargo_get_fprintl_args(argc, argv, start, flags,
+                                max_width, highlight_count, highlights)))
     {
-        msg = "Failed to parse alloc char * with value \"abc\"";
-        goto fail;
+        return -1;
     }
-    printf("Attempt to parse value: abc\n");
-    cargo_assert(b, "pointer is null");
-    cargo_assert(!strcmp(b, "abc"), "Failed to parse correct value abc");
 
-    _TEST_CLEANUP();
-    _cargo_free(b);
+    fprintf(f, "%s\n", ret);
+    _cargo_free(NULL, ret);
+    return 0;
 }
-_TEST_END()
 
-//
-// =========================== Array Tests ====================================
-//
-#define _TEST_ARRAY_OPTION(array, array_size, args, argc, fmt, ...)          \
-{                                                                            \
-    ret = cargo_add_option(cargo, 0, "--beta -b", "Description",             \
-                            fmt, ##__VA_ARGS__);                             \
-    cargo_assert(ret == 0,                                                   \
-        "Failed to add "#array"["#array_size"] array option");               \
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);    \
-    cargo_assert(ret == 0, "Failed to parse array: "#array"["#array_size"]");\
-}
+static int _cargo_parse_bundle(cargo_t ctx, int argc, char **argv)
+{
+    int ret;
+    size_t opt_i;
+    size_t name_i;
+    const char *s = ctx->argv[ctx->i];
+    char prefix = *s;
+    cargo_opt_t *opt = NULL;
 
-#define ARG_SIZE (sizeof(args) / sizeof(args[0]))
-#define ARRAY_SIZE (sizeof(a_expect) / sizeof(a_expect[0]))
-#define _ADD_TEST_FIXED_ARRAY(fmt, printfmt)                            \
-do                                                                      \
-{                                                                       \
-    size_t count = 0;                                                       \
-    size_t i;                                                           \
-    _TEST_ARRAY_OPTION(a, ARRAY_SIZE, args, ARG_SIZE,                   \
-        fmt, &a, &count, ARRAY_SIZE);                                   \
-    cargo_assert(a != NULL, "Array is null");                           \
-    cargo_assert(count == ARRAY_SIZE, "Array count is invalid");        \
-    printf("Read %lu values from int array:\n", count);                 \
-    for (i = 0; i < ARRAY_SIZE; i++) printf("  "printfmt"\n", a[i]);    \
-    cargo_assert_array(count, ARRAY_SIZE, a, a_expect);                 \
-} while (0)
+    // The classifier has already made sure each character
+    // is the short name of a bool option.
+    for (s++; *s; s++)
+    {
+        if (_cargo_trie_find_short(ctx, prefix, *s, &opt_i, &name_i))
+        {
+            return CARGO_PARSE_FAIL_OPT;
+        }
 
-///
-/// Simple add array tests.
-///
-_TEST_START(TEST_add_static_int_array_option)
-{
-    int a[3];
-    int a_expect[3] = { 1, -2, 3 };
-    char *args[] = { "program", "--beta", "1", "-2", "3" };
-    _ADD_TEST_FIXED_ARRAY(".[i]#", "%d");
-    _TEST_CLEANUP();
-}
-_TEST_END()
+        opt = &ctx->options[opt_i];
 
-_TEST_START(TEST_add_static_uint_array_option)
-{
-    unsigned int a[3];
-    unsigned int a_expect[3] = { 1, 2, 3 };
-    char *args[] = { "program", "--beta", "1", "2", "3" };
-    _ADD_TEST_FIXED_ARRAY(".[u]#", "%u");
-    _TEST_CLEANUP();
-}
-_TEST_END()
+        if ((ret = _cargo_parse_option(ctx, opt, opt->name[name_i],
+                                       argc, argv)) < 0)
+        {
+            return ret;
+        }
+    }
 
-_TEST_START(TEST_add_static_long_long_int_array_option)
-{
-    long long int a[3];
-    long long int a_expect[3] = { 9223372036854775807, -9223372036854775807, 3 };
-    char *args[] = { "program", "--beta", "9223372036854775807", "-9223372036854775807", "3" };
-    memset(a, 0, sizeof(a));
-    _ADD_TEST_FIXED_ARRAY(".[L]#", "%"CARGO_LONGLONG_FMT);
-    _TEST_CLEANUP();
+    return 1;
 }
-_TEST_END()
 
-_TEST_START(TEST_add_static_unsigned_long_long_int_array_option)
+static void _cargo_parse_reset(cargo_t ctx, cargo_flags_t flags,
+                               int start_index, int argc, char **argv)
 {
-    long long int a[3];
-    long long int a_expect[3] = { 1844674407370955161, 9223372036854775807, 3 };
-    char *args[] = { "program", "--beta", "1844674407370955161", "9223372036854775807", "3" };
-    _ADD_TEST_FIXED_ARRAY(".[U]#", "%"CARGO_ULONGLONG_FMT);
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    // Starting a new parse ends any streamed one.
+    _cargo_stream_clear(ctx);
+    _cargo_unmap_response_files(ctx);
 
-_TEST_START(TEST_add_static_float_array_option)
-{
-    float a[3];
-    float a_expect[3] = { 0.1f, 0.2f, 0.3f };
-    char *args[] = { "program", "--beta", "0.1", "0.2", "0.3" };
-    _ADD_TEST_FIXED_ARRAY(".[f]#", "%f");
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    // Override if any flags are set.
+    if (flags)
+    {
+        ctx->flags = flags;
+    }
 
-_TEST_START(TEST_add_static_double_array_option)
-{
-    double a[3];
-    double a_expect[3] = { 0.1, 0.2, 0.3 };
-    char *args[] = { "program", "--beta", "0.1", "0.2", "0.3" };
-    _ADD_TEST_FIXED_ARRAY(".[d]#", "%f");
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    ctx->argc = argc;
+    ctx->argv = argv;
+    ctx->start = start_index;
+    ctx->stopped = 0;
+    ctx->stopped_hard = 0;
 
-_TEST_START(TEST_add_static_string_array_option)
-{
-    #define LENSTR 5
-    char a[3][LENSTR];
-    size_t count = 0;
-    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
-    #define ARRAY2_SIZE (sizeof(a) / sizeof(a[0]))
-    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
-    memset(a, 0, sizeof(a));
+    _cargo_set_error(ctx, NULL);
 
-    _TEST_ARRAY_OPTION(a, ARRAY2_SIZE, args, ARG_SIZE,
-                        ".[s#]#", &a, LENSTR, &count, ARRAY2_SIZE);
+    // Everything in the scratch arena belongs to the previous parse.
+    ctx->suggest_names = NULL;
+    ctx->suggest_name_count = 0;
+    ctx->records = NULL;
+    ctx->record_count = 0;
+    ctx->max_records = 0;
+    ctx->args = NULL;
+    ctx->arg_count = 0;
+    ctx->max_args = 0;
+    ctx->positional_cursor = 0;
 
-    printf("Read %lu values from int array: %s, %s, %s\n",
-            count, a[0], a[1], a[2]);
-    cargo_assert(count == ARRAY2_SIZE, "Array count is not 3 as expected");
-    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
-    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
-    cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    ctx->unknown_opts = NULL;
+    ctx->unknown_opts_idxs = NULL;
+    ctx->unknown_opts_count = 0;
+    ctx->max_unknown_opts = 0;
 
-///
-/// Alloc fixed size array tests.
-///
-_TEST_START(TEST_add_alloc_fixed_int_array_option)
-{
-    int *a = NULL;
-    int a_expect[3] = { 1, -2, 3 };
-    char *args[] = { "program", "--beta", "1", "-2", "3" };
-    _ADD_TEST_FIXED_ARRAY("[i]#", "%d");
-    _TEST_CLEANUP();
-    _cargo_free(a);
-}
-_TEST_END()
+    _cargo_arena_reset(&ctx->arena);
+    ctx->mem.count = 0;
 
-_TEST_START(TEST_add_alloc_fixed_uint_array_option)
-{
-    unsigned int *a = NULL;
-    unsigned int a_expect[3] = { 1, 2, 3 };
-    char *args[] = { "program", "--beta", "1", "2", "3" };
-    _ADD_TEST_FIXED_ARRAY("[u]#", "%u");
-    _TEST_CLEANUP();
-    _cargo_free(a);
-}
-_TEST_END()
+    _cargo_add_help_if_missing(ctx);
+    _cargo_add_orphans_to_default_group(ctx);
 
-_TEST_START(TEST_add_alloc_fixed_float_array_option)
-{
-    float *a = NULL;
-    float a_expect[3] = { 1.1f, -2.2f, 3.3f };
-    char *args[] = { "program", "--beta", "1.1", "-2.2", "3.3" };
-    _ADD_TEST_FIXED_ARRAY("[f]#", "%f");
-    _TEST_CLEANUP();
-    _cargo_free(a);
+    // Make sure we start over, if this function is
+    // called more than once.
+    // (But we don't free the values since we don't want to
+    //  overwrite default or already parsed values)
+    _cargo_cleanup_option_values(ctx, 0);
 }
-_TEST_END()
 
-_TEST_START(TEST_add_alloc_fixed_double_array_option)
+static int _cargo_add_extra_arg(cargo_t ctx, char *arg)
 {
-    double *a = NULL;
-    double a_expect[3] = { 1.1, -2.2, 3.3 };
-    char *args[] = { "program", "--beta", "1.1", "-2.2", "3.3" };
-    _ADD_TEST_FIXED_ARRAY("[d]#", "%f");
-    _TEST_CLEANUP();
-    _cargo_free(a);
+    // The pushed arguments are freed once parsed, so keep a copy.
+    if (ctx->streaming)
+    {
+        if (_cargo_arena_grow(&ctx->arena, &ctx->args, &ctx->max_args,
+                              ctx->arg_count, sizeof(char *))
+            || !(arg = _cargo_arena_strdup(&ctx->arena, arg)))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            return -1;
+        }
+    }
+
+    ctx->args[ctx->arg_count] = arg;
+    ctx->arg_count++;
+
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_add_alloc_fixed_string_array_option)
+// Parses the argument at ctx->i, returns the number of arguments used.
+static int _cargo_parse_arg(cargo_t ctx)
 {
-    #define LENSTR 5
-    char **a = NULL;
-    size_t count;
-    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
-    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
+    int opt_arg_count = 0;
+    char *arg = ctx->argv[ctx->i];
+    const char *name = NULL;
+    cargo_opt_t *opt = NULL;
 
-    _TEST_ARRAY_OPTION(a, 3, args, ARG_SIZE,
-                        "[s#]#", &a, LENSTR, &count, 3);
+    CARGODBG(3, "\n");
+    CARGODBG(3, "argv[%d] = %s\n", ctx->i, arg);
+    CARGODBG(3, "  Look for opt matching %s:\n", arg);
 
-    cargo_assert(a != NULL, "Array is null");
-    cargo_assert(count == 3, "Array count is not 3");
-    printf("Read %lu values from int array: %s, %s, %s\n",
-            count, a[0], a[1], a[2]);
-    cargo_assert(count == 3, "Array count is not 3 as expected");
-    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
-    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
-    cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
-    _TEST_CLEANUP();
-    _cargo_free_str_list(&a, &count);
-}
-_TEST_END()
+    // TODO: Add support for a "--" option which forces all
+    // options specified after it to be parsed as positional arguments
+    // and not options. Say there's a file named "-thefile".
 
-_TEST_START(TEST_add_alloc_fixed_string_array_option2)
-{
-    char **a = NULL;
-    size_t count;
-    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
-    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
+    if (!ctx->stopped
+        && (ctx->tokens[ctx->i].kind == CARGO_TOKEN_OPTION_COMPACT))
+    {
+        // Bundled flags "-abc", parse each as its own option.
+        if ((opt_arg_count = _cargo_parse_bundle(ctx, ctx->argc,
+                                                 ctx->argv)) < 0)
+        {
+            CARGODBG(1, "Failed to parse bundled options: %s\n", arg);
+        }
+    }
+    else if (!ctx->stopped && _cargo_is_another_option(ctx, ctx->i))
+    {
+        opt = &ctx->options[ctx->tokens[ctx->i].opt_i];
+        name = ctx->tokens[ctx->i].name;
 
-    _TEST_ARRAY_OPTION(a, 3, args, ARG_SIZE,
-                        "[s]#", &a, &count, 3);
+        // We found an option, parse any arguments it might have.
+        if ((opt_arg_count = _cargo_parse_option(ctx, opt, name,
+                                                ctx->argc, ctx->argv)) < 0)
+        {
+            CARGODBG(1, "Failed to parse %s option: %s\n",
+                    _cargo_type_to_str(opt->type), name);
+        }
+    }
+    else
+    {
+        size_t opt_i = 0;
+        CARGODBG(2, "    Positional argument: %s\n", arg);
 
-    cargo_assert(a != NULL, "Array is null");
-    cargo_assert(count == 3, "Array count is not 3");
-    printf("Read %lu values from string array: %s, %s, %s\n",
-            count, a[0], a[1], a[2]);
-    cargo_assert(count == 3, "Array count is not 3 as expected");
-    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
-    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
-    cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
-    _TEST_CLEANUP();
-    _cargo_free_str_list(&a, &count);
+        // Positional argument.
+        if (!ctx->stopped && (_cargo_get_positional(ctx, &opt_i) == 0))
+        {
+            opt = &ctx->options[opt_i];
+            if ((opt_arg_count = _cargo_parse_option(ctx, opt,
+                                                opt->name[0],
+                                                ctx->argc, ctx->argv)) < 0)
+            {
+                CARGODBG(1, "    Failed to parse %s option: %s\n",
+                        _cargo_type_to_str(opt->type), opt->name[0]);
+            }
+        }
+        else
+        {
+            CARGODBG(2, "    Extra argument: %s\n", arg);
+            if (_cargo_add_extra_arg(ctx, arg))
+            {
+                return CARGO_PARSE_NOMEM;
+            }
+            opt_arg_count = 1;
+        }
+    }
+
+    #if CARGO_DEBUG
+    if (opt_arg_count > 0)
+    {
+        int k = 0;
+
+        CARGODBG(2, "    Ate %d args: ", opt_arg_count);
+
+        for (k = ctx->i; (k < (ctx->i + opt_arg_count)) && (k < ctx->argc); k++)
+        {
+            CARGODBGI(2, "\"%s\" ", ctx->argv[k]);
+        }
+
+        CARGODBGI(2, "%s", "\n");
+    }
+    #endif // CARGO_DEBUG
+
+    return opt_arg_count;
 }
-_TEST_END()
 
-_TEST_START(TEST_add_alloc_fixed_string_array_option3)
+static void _cargo_shrink_option_values(cargo_t ctx)
 {
-    #define NUM_ELEMENTS 3
-    char *a[NUM_ELEMENTS];
-    size_t count = 0;
     size_t i;
-    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
-    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
-    memset(a, 0, sizeof(a));
-
-    _TEST_ARRAY_OPTION(a, 3, args, ARG_SIZE,
-                        ".[s]#", &a, &count, NUM_ELEMENTS);
+    size_t size;
+    void *new_target;
+    cargo_opt_t *opt;
 
-    cargo_assert(a != NULL, "Array is null");
-    cargo_assert(count == 3, "Array count is not 3");
-    printf("Read %lu values from string array: %s, %s, %s\n",
-            count, a[0], a[1], a[2]);
-    cargo_assert(count == NUM_ELEMENTS, "Array count is not 3 as expected");
-    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
-    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
-    cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
-    _TEST_CLEANUP();
-    for (i = 0; i < NUM_ELEMENTS; i++)
+    // Give back what an unbounded array didn't end up using.
+    for (i = 0; i < ctx->opt_count; i++)
     {
-        if (a[i]) free(a[i]);
+        opt = &ctx->options[i];
+
+        if ((opt->nargs >= 0) || !opt->alloc || !opt->target
+            || !*(opt->target) || (opt->target_idx == 0)
+            || (opt->target_idx >= opt->target_alloc_count))
+        {
+            continue;
+        }
+
+        size = _cargo_get_value_size(opt);
+
+        // Keep the larger array if this fails, it is still valid.
+        if ((new_target = _cargo_realloc(&ctx->mem, *(opt->target),
+                                         opt->target_idx * size)))
+        {
+            *(opt->target) = new_target;
+            opt->target_alloc_count = opt->target_idx;
+        }
     }
 }
-_TEST_END()
 
-_TEST_START(TEST_add_alloc_fixed_string_array_option4)
+static int _cargo_parse_finish(cargo_t ctx, int ret,
+                               cargo_flags_t global_flags)
 {
-    #define NUM_ELEMENTS 3
-    char *a[NUM_ELEMENTS];
-    size_t count = 0;
-    size_t i;
-    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
-    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
-    memset(a, 0, sizeof(a));
+    int unknown_checked = 0;
 
-    _TEST_ARRAY_OPTION(a, 3, args, ARG_SIZE,
-                        ".[s]+", &a, &count, NUM_ELEMENTS);
+    if (ret < 0)
+    {
+        goto fail;
+    }
 
-    cargo_assert(a != NULL, "Array is null");
-    cargo_assert(count == 3, "Array count is not 3");
-    printf("Read %lu values from string array: %s, %s, %s\n",
-            count, a[0], a[1], a[2]);
-    cargo_assert(count == NUM_ELEMENTS, "Array count is not 3 as expected");
-    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
-    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
-    //cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
-    _TEST_CLEANUP();
-    for (i = 0; i < NUM_ELEMENTS; i++)
+    // Print automatic help.
+    if (ctx->help)
     {
-        if (a[i]) free(a[i]);
+        cargo_print_usage(ctx, 0);
+        ctx->flags = global_flags;
+        return CARGO_PARSE_SHOW_HELP;
     }
-}
-_TEST_END()
 
-//
-// Dynamic sized alloc array tests.
-//
-_TEST_START(TEST_add_alloc_dynamic_int_array_option)
-{
-    int *a = NULL;
-    int a_expect[3] = { 1, -2, 3 };
-    char *args[] = { "program", "--beta", "1", "-2", "3" };
-    _ADD_TEST_FIXED_ARRAY("[i]+", "%d");
-    _TEST_CLEANUP();
-    _cargo_free(a);
-}
-_TEST_END()
+    // An option can cause a "hard stop", meaning that there
+    // won't be any errors for mutex groups and so on. This is
+    // useful for cases where you have --advanced_help or similar
+    // where you just want to show some extended help without also
+    // having to specify required arguments.
+    if (ctx->stopped_hard)
+    {
+        goto skip_checks;
+    }
 
-_TEST_START(TEST_add_alloc_dynamic_int_array_option_noargs)
-{
-    int *a = NULL;
-    char *args[] = { "program", "--beta" };
-    size_t count;
+    if (_cargo_check_required_options(ctx))
+    {
+        ret = CARGO_PARSE_MISS_REQUIRED; goto fail;
+    }
 
-    ret = cargo_add_option(cargo, 0, "--beta -b", "Description", "[i]+",
-                            &a, &count);
-    cargo_assert(ret == 0, "Failed to add options");
+    if ((ret = _cargo_check_mutex_groups(ctx)))
+    {
+        goto fail;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Successfully parsed when no args");
+    unknown_checked = 1;
+    if ((ret = _cargo_check_unknown_options_after(ctx)))
+    {
+        goto fail;
+    }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    // Shows warnings.
+    if (!(ctx->flags & CARGO_NOWARN))
+    {
+        _cargo_parse_show_error(ctx);
+    }
 
-//
-// Misc output tests.
-//
-_TEST_START(TEST_print_usage)
-{
-    int a[3];
-    size_t a_count = 0;
-    float b;
-    double c;
-    char *s = NULL;
-    int *vals = NULL;
-    size_t val_count = 0;
+skip_checks:
+    _cargo_shrink_option_values(ctx);
+    ctx->flags = global_flags;
+    return CARGO_PARSE_OK;
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a",
-            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
-            "eiusmod tempor incididunt ut labore et dolore magna aliqua. "
-            "Ut enim ad minim veniam, quis nostrud exercitation ullamco "
-            "laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure "
-            "dolor in reprehenderit in voluptate velit esse cillum dolore eu "
-            "fugiat nulla pariatur. Excepteur sint occaecat cupidatat non "
-            "proident, sunt in culpa qui officia deserunt mollit anim id est "
-            "laborum",
-            ".[i]#",
-            &a, &a_count, sizeof(a) / sizeof(a[0]));
+fail:
+    // Let unknown options override other errors.
+    // But don't check for them more than once. A streamed
+    // parse has already gathered them, but not checked them.
+    if ((ctx->unknown_opts_count == 0)
+        || (ctx->streaming && !unknown_checked))
+    {
+        int unknown_ret = 0;
+        if ((unknown_ret = _cargo_check_unknown_options_after(ctx)))
+        {
+            CARGODBG(1, "Unknown option overrides previous error\n");
+            ret = unknown_ret;
+        }
+    }
 
-    ret |= cargo_add_option(cargo, 0, "--beta -b",
-            "Shorter description",
-            "f",
-            &b);
-    ret |= cargo_set_metavar(cargo, "--beta", "FLOAT");
+    _cargo_parse_show_error(ctx);
+    _cargo_cleanup_option_values(ctx, 1);
+    ctx->flags = global_flags;
+    return ret;
+}
 
-    ret |= cargo_add_option(cargo, 0, "--call_this_a_long_option_that_wont_fit -c",
-            "Sed ut perspiciatis unde omnis iste natus error sit voluptatem "
-            "accusantium doloremque laudantium, totam rem aperiam, eaque ipsa "
-            "quae ab illo inventore veritatis et quasi architecto beatae vitae "
-            "dicta sunt explicabo",
-            "d",
-            &c);
+int cargo_parse(cargo_t ctx, cargo_flags_t flags, int start_index, int argc, char **argv)
+{
+    int ret = CARGO_PARSE_OK;
+    int opt_arg_count = 0;
+    cargo_flags_t global_flags = ctx->flags;
 
-    ret |= cargo_add_option(cargo, 0, "--shorter -s",
-            "Sed ut perspiciatis unde omnis iste natus error sit voluptatem "
-            "accusantium doloremque laudantium, totam rem aperiam, eaque ipsa "
-            "quae ab illo inventore veritatis et quasi architecto beatae vitae "
-            "dicta sunt explicabo",
-            "s",
-            &s);
+    CARGODBG(2, "============ Cargo Parse =============\n");
 
-    ret |= cargo_add_option(cargo, 0, "--vals -v",
-            "Shorter description",
-            "[ i ]+",
-            &vals, &val_count);
-    cargo_assert(ret == 0, "Failed to add options");
+    _cargo_parse_reset(ctx, flags, start_index, argc, argv);
 
-    cargo_set_epilog(cargo, "That's it!");
-    cargo_set_description(cargo, "Introductionary description");
+    if ((ctx->flags & CARGO_RESPONSE_FILES)
+        && (ret = _cargo_expand_response_files(ctx)))
+    {
+        goto fail;
+    }
 
-    cargo_print_usage(cargo, 0);
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    if (!(ctx->args = (char **)_cargo_arena_calloc(&ctx->arena,
+                                                ctx->argc, sizeof(char *))))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        ret = CARGO_PARSE_NOMEM; goto fail;
+    }
 
-_TEST_START(TEST_get_usage_settings)
-{
-    typedef struct _test_usage_settings_s
+    if (!(ctx->unknown_opts = (char **)_cargo_arena_calloc(&ctx->arena,
+                                                ctx->argc, sizeof(char *))))
     {
-        cargo_usage_t fmt;
-        char *expect[4];
-        size_t expect_count;
-    } _test_usage_settings_t;
+        CARGODBG(1, "Out of memory!\n");
+        ret = CARGO_PARSE_NOMEM; goto fail;
+    }
 
-    #define DESCRIPT "Brown fox"
-    #define EPILOG "Lazy fox"
-    #define OPT_TXT "The alpha"
-    size_t j;
-    size_t k;
-    int i;
-    const char *usage = NULL;
-    _test_usage_settings_t tus[] =
+    if (!(ctx->unknown_opts_idxs = _cargo_arena_calloc(&ctx->arena,
+                                                ctx->argc, sizeof(int))))
     {
-        { 0,                                { DESCRIPT, EPILOG, OPT_TXT }, 3},
-        { CARGO_USAGE_HIDE_EPILOG,          { DESCRIPT, OPT_TXT }, 2},
-        { CARGO_USAGE_HIDE_DESCRIPTION,     { EPILOG, OPT_TXT }, 2}
-    };
+        CARGODBG(1, "Out of memory");
+        ret = CARGO_PARSE_NOMEM; goto fail;
+    }
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", OPT_TXT, "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+    CARGODBG(2, "Parse arg list of count %d start at index %d\n",
+            ctx->argc, start_index);
 
-    cargo_set_description(cargo, "Brown fox");
-    cargo_set_epilog(cargo, "Lazy fox");
+    if (_cargo_classify_args(ctx))
+    {
+        ret = CARGO_PARSE_NOMEM; goto fail;
+    }
 
-    for (j = 0; j < sizeof(tus) / sizeof(tus[0]); j++)
+    // Check for unknown options early.
+    if ((ctx->flags & CARGO_UNKNOWN_EARLY)
+        && _cargo_check_unknown_options(ctx))
     {
-        usage = cargo_get_usage(cargo, tus[j].fmt);
-        cargo_assert(usage != NULL, "Got null usage");
-        printf("\n\n");
+        ret = CARGO_PARSE_UNKNOWN_OPTS; goto fail;
+    }
 
-        for (k = 0; k < tus[j].expect_count; k++)
+    for (ctx->i = ctx->start; ctx->i < ctx->argc; )
+    {
+        if ((opt_arg_count = _cargo_parse_arg(ctx)) < 0)
         {
-            char *s = tus[j].expect[k];
-            char *found = strstr(usage, s);
-            printf("-------------------------------------\n");
-            printf("%s\n", usage);
-            printf("-------------------------------------\n");
-            printf("Expecting to find in usage: \"%s\"\n", s);
-            cargo_assert(found != NULL,
-                "Usage formatting unexpected");
+            ret = opt_arg_count; goto fail;
         }
 
-        printf("-------------------------------------\n");
-        printf("%s\n", usage);
-        printf("-------------------------------------\n");
+        ctx->i += opt_arg_count;
     }
 
-    _TEST_CLEANUP();
+fail:
+    return _cargo_parse_finish(ctx, ret, global_flags);
 }
-_TEST_END()
 
-_TEST_START(TEST_autohelp_default)
+static int _cargo_stream_add_unknown(cargo_t ctx, const char *arg, size_t idx)
 {
-    int i;
-    const char *usage = NULL;
+    size_t max_idxs = ctx->max_unknown_opts;
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    CARGODBG(2, "    Unknown option: %s\n", arg);
 
-    // Default is to automatically add --help option.
-    usage = cargo_get_usage(cargo, 0);
-    cargo_assert(usage != NULL, "Got NULL usage");
-    printf("-------------------------------------\n");
-    printf("%s", usage);
-    printf("-------------------------------------\n");
-    cargo_assert(strstr(usage, "help") != NULL, "No help found by default");
+    if (_cargo_arena_grow(&ctx->arena, &ctx->unknown_opts,
+                &ctx->max_unknown_opts, ctx->unknown_opts_count,
+                sizeof(char *))
+     || _cargo_arena_grow(&ctx->arena, &ctx->unknown_opts_idxs,
+                &max_idxs, ctx->unknown_opts_count, sizeof(int))
+     || !(ctx->unknown_opts[ctx->unknown_opts_count]
+            = _cargo_arena_strdup(&ctx->arena, arg)))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        return -1;
+    }
 
-    _TEST_CLEANUP();
+    ctx->unknown_opts_idxs[ctx->unknown_opts_count] = (int)idx;
+    ctx->unknown_opts_count++;
+
+    return 0;
 }
-_TEST_END()
 
-_TEST_START_EX(TEST_autohelp_off, CARGO_NO_AUTOHELP)
+// Returns 1 when the argument at ctx->i can be parsed with
+// the arguments pushed so far.
+static int _cargo_stream_ready(cargo_t ctx)
 {
-    int i;
-    const char *usage = NULL;
-
-    // Turn off auto_help (--help).
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    int k;
+    int start;
+    int needed;
+    size_t opt_i = 0;
+    cargo_opt_t *opt = NULL;
+    cargo_token_t *t = &ctx->tokens[ctx->i];
 
-    usage = cargo_get_usage(cargo, 0);
-    cargo_assert(usage != NULL, "Got NULL usage");
-    printf("-------------------------------------\n");
-    printf("%s", usage);
-    printf("-------------------------------------\n");
-    cargo_assert(strstr(usage, "help") == NULL,
-                "Help found when auto_help turned off");
+    if (ctx->stopped || (t->kind == CARGO_TOKEN_OPTION_COMPACT))
+        return 1;
 
-    _TEST_CLEANUP();
-    cargo_destroy(&cargo);
-}
-_TEST_END_NODESTROY()
+    if (t->kind == CARGO_TOKEN_OPTION)
+    {
+        opt = &ctx->options[t->opt_i];
+        start = ctx->i + 1;
+    }
+    else if (_cargo_get_positional(ctx, &opt_i) == 0)
+    {
+        opt = &ctx->options[opt_i];
+        start = ctx->i;
+    }
+    else
+    {
+        // Extra argument.
+        return 1;
+    }
 
-#define _ADD_TEST_USAGE_OPTIONS()                                           \
-do                                                                          \
-{                                                                           \
-    int *k;                                                                 \
-    size_t k_count;                                                         \
-    int i;                                                                  \
-    float f;                                                                \
-    int b;                                                                  \
-    ret |= cargo_add_option(cargo, 0, "pos", "Positional arg", "[i]+",      \
-                            &k, &k_count);                                  \
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha" LOREM_IPSUM, "i", &i);  \
-    ret |= cargo_add_option(cargo, 0, "--beta", "The alpha", "f", &f);      \
-    ret |= cargo_add_option(cargo, 0, "--crash -c", "The alpha", "b", &b);  \
-    cargo_assert(ret == 0, "Failed to add options");                        \
-} while (0)
+    if (opt->type == CARGO_BOOL)
+        return 1;
 
-_TEST_START(TEST_get_usage)
-{
-    const char *usage = NULL;
+    switch (opt->nargs)
+    {
+        case CARGO_NARGS_ONE_OR_MORE:
+        case CARGO_NARGS_ZERO_OR_MORE:
+            // Unless something needs to see the whole list at once,
+            // the rest of it can be fed as it is pushed.
+            if (!opt->custom && !(opt->flags & CARGO_OPT_STOP))
+                return 1;
+            needed = INT_MAX;
+            break;
+        case CARGO_NARGS_ZERO_OR_ONE: needed = 1; break;
+        default:
+            needed = opt->positional
+                   ? (opt->nargs - (int)opt->target_idx) : opt->nargs;
+            break;
+    }
 
-    _ADD_TEST_USAGE_OPTIONS();
-    usage = cargo_get_usage(cargo, 0);
-    cargo_assert(usage != NULL, "Failed to get allocated usage");
-    printf("%s\n", usage);
-    printf("Cargo v%s\n", cargo_get_version());
+    // An option ends the arguments for this one.
+    for (k = start; k < ctx->argc; k++)
+    {
+        if (_cargo_is_another_option(ctx, k) || ((k - start + 1) >= needed))
+            return 1;
+    }
 
-    _TEST_CLEANUP();
+    return (needed <= 0);
 }
-_TEST_END()
 
-_TEST_START(TEST_misspelled_argument)
+// Parses as much of the pushed arguments as possible, and drops
+// the ones that are done with.
+static int _cargo_stream_process(cargo_t ctx, int final)
 {
-    int i;
-    float f;
-    int b;
-    char *args[] = { "program", "--bota", "0.1" };
+    int ret = 0;
+    int opt_arg_count = 0;
+    size_t i;
+    size_t consumed;
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
-    ret |= cargo_add_option(cargo, 0, "--beta", "The alpha", "f", &f);
-    ret |= cargo_add_option(cargo, 0, "--crash -c", "The alpha", "b", &b);
-    cargo_assert(ret == 0, "Failed to add options");
+    ctx->argv = ctx->stream_argv;
+    ctx->argc = (int)ctx->stream_count;
+    ctx->start = 0;
+    ctx->stream_final = final;
 
-    ret = cargo_parse(cargo, 0, 1, 3, args);
-    cargo_assert(ret == -1, "Got valid parse with invalid input");
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    for (ctx->i = 0; ctx->i < ctx->argc; )
+    {
+        if (ctx->stream_opt)
+        {
+            cargo_opt_t *opt = ctx->stream_opt;
 
-_TEST_START(TEST_add_duplicate_option)
-{
-    int i;
+            if (!ctx->stopped && _cargo_is_another_option(ctx, ctx->i))
+            {
+                ctx->stream_opt = NULL;
+                continue;
+            }
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
-    cargo_assert(ret != 0, "Succesfully added duplicated, not allowed");
+            // Keep filling the list that ran into the end of the last push.
+            ctx->j = ctx->i;
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+            if ((ret = _cargo_set_target_value(ctx, opt, ctx->stream_name,
+                                               ctx->argv[ctx->i])) < 0)
+            {
+                CARGODBG(1, "Failed to set target value for %s\n",
+                        ctx->stream_name);
+                ret = CARGO_PARSE_FAIL_OPT; goto fail;
+            }
 
-_TEST_START(TEST_get_extra_args)
-{
-    size_t argc = 0;
-    const char **extra_args = NULL;
-    char *extra_args_expect[] = { "abc", "def", "ghi" };
-    int i;
-    char *args[] = { "program", "-a", "1", "abc", "def", "ghi" };
+            opt->num_eaten++;
+            ctx->i++;
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+            if (ret)
+            {
+                ctx->stream_opt = NULL;
+            }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse extra args input");
+            continue;
+        }
 
-    // Get left over arguments.
-    extra_args = cargo_get_args(cargo, &argc);
-    cargo_assert(extra_args != NULL, "Got NULL extra args");
+        if (!final && !_cargo_stream_ready(ctx))
+            break;
 
-    printf("argc = %lu\n", argc);
-    cargo_assert(argc == 3, "Expected argc == 3");
-    cargo_assert_str_array(argc, 3, extra_args, extra_args_expect);
+        {
+            int was_stopped = ctx->stopped;
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+            if ((opt_arg_count = _cargo_parse_arg(ctx)) < 0)
+            {
+                ret = opt_arg_count; goto fail;
+            }
 
-_TEST_START(TEST_get_unknown_opts)
-{
-    size_t unknown_count = 0;
-    const char **unknown_opts = NULL;
-    char *unknown_opts_expect[] = { "-b", "-c" };
-    int i;
-    char *args[] = { "program", "-a", "1", "-b", "-c", "3" };
+            if (!was_stopped && ctx->stopped)
+            {
+                ctx->stopped += (int)ctx->stream_base;
+            }
+        }
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+        ctx->i += opt_arg_count;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Succeeded parsing with unknown options");
+    consumed = CARGO_MIN((size_t)ctx->i, ctx->stream_count);
 
-    // Get left over arguments.
-    unknown_opts = cargo_get_unknown(cargo, &unknown_count);
-    cargo_assert(unknown_opts != NULL, "Got NULL unknown options");
+    // Unknown options are only looked at after parsing, but the
+    // arguments won't be around by then.
+    if (!(ctx->flags & CARGO_UNKNOWN_EARLY))
+    {
+        for (i = 0; i < consumed; i++)
+        {
+            if ((ctx->tokens[i].kind != CARGO_TOKEN_UNKNOWN)
+                || (ctx->stopped
+                 && ((ctx->stream_base + i) >= (size_t)ctx->stopped)))
+            {
+                continue;
+            }
 
-    printf("Unknown option count = %lu\n", unknown_count);
-    cargo_assert(unknown_count == 2, "Unknown option count == 2");
-    cargo_assert_str_array(unknown_count, 2, unknown_opts, unknown_opts_expect);
+            if (_cargo_stream_add_unknown(ctx, ctx->stream_argv[i],
+                                          ctx->stream_base + i))
+            {
+                ret = CARGO_PARSE_NOMEM; goto fail;
+            }
+        }
+    }
 
-    _TEST_CLEANUP();
+    for (i = 0; i < consumed; i++)
+    {
+        _cargo_free(&ctx->mem, ctx->stream_argv[i]);
+    }
+
+    memmove(ctx->stream_argv, ctx->stream_argv + consumed,
+            (ctx->stream_count - consumed) * sizeof(char *));
+    memmove(ctx->tokens, ctx->tokens + consumed,
+            (ctx->stream_count - consumed) * sizeof(cargo_token_t));
+    ctx->stream_count -= consumed;
+    ctx->stream_argv[ctx->stream_count] = NULL;
+    ctx->stream_base += consumed;
+    ctx->argc = (int)ctx->stream_count;
+
+    return 0;
+
+fail:
+    return ret;
 }
-_TEST_END()
 
-_TEST_START(TEST_cargo_split)
+static int _cargo_stream_append_arg(cargo_t ctx, const char *arg)
 {
-    size_t i;
-    size_t j;
+    cargo_token_t *t = NULL;
 
-    char *in[] =
+    // Keep room for a terminating NULL, like a real argv.
+    if ((ctx->stream_count + 1) >= ctx->stream_max)
     {
-        " abc def   ghi   ",
-        "abc",
-        NULL
-    };
-    #define NUM (sizeof(in) / sizeof(in[0]))
+        size_t new_max = ctx->stream_max ? (ctx->stream_max * 2) : 16;
+        char **argv = NULL;
 
-    char *expect0[] = { "abc", "def", "ghi" };
-    char *expect1[] = { "abc" };
-    char *expect2[] = { NULL };
-    char **expect[] = { expect0, expect1, expect2 };
-    size_t expect_count[] =
+        if (!(argv = _cargo_realloc(&ctx->mem, ctx->stream_argv,
+                                    new_max * sizeof(char *))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            return CARGO_PARSE_NOMEM;
+        }
+
+        ctx->stream_argv = argv;
+        ctx->stream_max = new_max;
+    }
+
+    if (ctx->stream_max > ctx->max_tokens)
     {
-        3,
-        1,
-        0
-    };
+        if (!(t = _cargo_realloc(&ctx->mem, ctx->tokens,
+                                 ctx->stream_max * sizeof(cargo_token_t))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            return CARGO_PARSE_NOMEM;
+        }
 
-    char **out[NUM];
-    size_t out_count[NUM];
-    ret = 0;
+        ctx->tokens = t;
+        ctx->max_tokens = ctx->stream_max;
+    }
 
-    for (i = 0; i < NUM; i++)
+    if (!(ctx->stream_argv[ctx->stream_count] = _cargo_strdup(&ctx->mem, arg)))
     {
-        printf("Split: \"%s\"", in[i]);
-        out[i] = _cargo_split(in[i], " ", &out_count[i]);
-        printf(" into %lu substrings\n", out_count[i]);
+        CARGODBG(1, "Out of memory!\n");
+        return CARGO_PARSE_NOMEM;
+    }
 
-        if (in[i] != NULL)
-            cargo_assert(out[i] != NULL, "Got null split result");
+    t = &ctx->tokens[ctx->stream_count];
+    _cargo_classify_arg(ctx, t, ctx->stream_argv[ctx->stream_count]);
+    ctx->stream_count++;
+    ctx->stream_argv[ctx->stream_count] = NULL;
 
-        for (j = 0; j < out_count[i]; j++)
+    // Nothing will be parsed ahead of time, so this is as early as it gets.
+    if ((ctx->flags & CARGO_UNKNOWN_EARLY)
+        && (t->kind == CARGO_TOKEN_UNKNOWN))
+    {
+        if (_cargo_stream_add_unknown(ctx, arg,
+                            ctx->stream_base + ctx->stream_count - 1))
         {
-            printf("\"%s\"%s ",
-                out[i][j], ((j + 1) != out_count[i]) ? "," : "");
+            return CARGO_PARSE_NOMEM;
         }
 
-        printf("\n");
+        return _cargo_check_unknown_options(ctx);
     }
 
-    for (i = 0; i < NUM; i++)
+    return 0;
+}
+
+static int _cargo_stream_append(cargo_t ctx, const char *arg)
+{
+    int ret = 0;
+    size_t i;
+    char **list = NULL;
+    size_t count = 0;
+    size_t max = 0;
+
+    if (!(ctx->flags & CARGO_RESPONSE_FILES)
+        || (arg[0] != '@') || (arg[1] == '\0'))
     {
-        cargo_assert_str_array(out_count[i], expect_count[i], out[i], expect[i]);
+        return _cargo_stream_append_arg(ctx, arg);
     }
 
-    _TEST_CLEANUP();
-    for (i = 0; i < NUM; i++)
+    // The arguments of a response file are copied like any other
+    // pushed argument, so the file is not needed after this.
+    if ((ret = _cargo_read_response_file(ctx, arg + 1, 0,
+                                         &list, &count, &max)))
     {
-        _cargo_free_str_list(&out[i], &out_count[i]);
+        return ret;
     }
-    #undef NUM
+
+    for (i = 0; i < count; i++)
+    {
+        if ((ret = _cargo_stream_append_arg(ctx, list[i])))
+            return ret;
+    }
+
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_invalid_value)
+static int _cargo_stream_fail(cargo_t ctx, int ret)
 {
-    int i;
-    int j;
-    char *args[] = { "program", "--alpha", "1", "--beta", "a" };
+    ret = _cargo_parse_finish(ctx, ret, ctx->stream_flags);
+    _cargo_stream_clear(ctx);
+    return ret;
+}
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
-    cargo_assert(ret == 0, "Failed to add options");
+int cargo_parse_begin(cargo_t ctx, cargo_flags_t flags)
+{
+    cargo_flags_t global_flags;
+    assert(ctx);
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Succesfully parsed invalid value");
+    CARGODBG(2, "============ Cargo Parse Begin =======\n");
 
-    _TEST_CLEANUP();
+    global_flags = ctx->flags;
+
+    _cargo_parse_reset(ctx, flags, 0, 0, NULL);
+    ctx->streaming = 1;
+    ctx->stream_flags = global_flags;
+
+    if (ctx->trie_dirty && _cargo_trie_build(ctx))
+    {
+        return _cargo_stream_fail(ctx, CARGO_PARSE_NOMEM);
+    }
+
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_twice)
+cargo_parse_result_t cargo_parse_push(cargo_t ctx, const char *arg)
 {
-    // This test make sure the parser is reset between
-    // different parse sessions.
-    #define PORTS_COUNT 3
-    int ports[PORTS_COUNT];
-    size_t ports_count = 0;
-    char *name = NULL;
-    char **vals = NULL;
-    size_t vals_count = 0;
+    int ret = 0;
+    assert(ctx);
+    assert(arg);
 
-    char *args1[] =
+    if (!ctx->streaming)
     {
-        "program",
-        "--ports", "22", "24", "26",
-        "--vals", "abc", "def", "123456789101112", "ghi", "jklmnopq",
-        "--name", "server"
-    };
-    int args1_ports_expect[] = { 22, 24, 26 };
-    char *args1_vals_expect[] = { "abc", "def", "123456789101112", "ghi", "jklmnopq" };
+        CARGODBG(1, "cargo_parse_begin has not been called\n");
+        return CARGO_PARSE_FAIL_OPT;
+    }
 
-    char *args2[] =
+    if ((ret = _cargo_stream_append(ctx, arg))
+     || (ret = _cargo_stream_process(ctx, 0)))
     {
-        "program",
-        "--vals", "abc", "def", "123456789101112", "ghi", "jklmnopq",
-        "--ports", "33", "34", "36",
-        "--name", "server"
-    };
-    int args2_ports_expect[] = { 33, 34, 36 };
-
-    ret |= cargo_add_option(cargo, 0, "--ports -p", "Ports", ".[i]#",
-                            &ports, &ports_count, PORTS_COUNT);
-    ret |= cargo_add_option(cargo, 0, "--name -n", "Name", "s", &name);
-    ret |= cargo_add_option(cargo, 0, "--vals -v", "Description of vals", "[s]+",
-                            &vals, &vals_count);
-    cargo_assert(ret == 0, "Failed to add options");
+        return _cargo_stream_fail(ctx, ret);
+    }
 
-    printf("\nArgs 1:\n");
-    {
-        ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    return 0;
+}
 
-        cargo_assert(ret == 0, "Failed to parse advanced example");
-        cargo_assert_array(ports_count, PORTS_COUNT, ports, args1_ports_expect);
-        cargo_assert_str_array(vals_count, 5, vals, args1_vals_expect);
-        cargo_assert(name && !strcmp(name, "server"), "Expected name = \"server\"");
+cargo_parse_result_t cargo_parse_push_args(cargo_t ctx, int argc, char **argv)
+{
+    int ret = 0;
+    int i;
+    assert(ctx);
 
-        // TODO: Remove this and make sure these are freed at cargo_parse instead
-        _cargo_free_str_list(&vals, &vals_count);
-        _cargo_xfree(&name);
-        memset(&ports, 0, sizeof(ports));
+    if (!ctx->streaming)
+    {
+        CARGODBG(1, "cargo_parse_begin has not been called\n");
+        return CARGO_PARSE_FAIL_OPT;
     }
 
-    printf("\nArgs 2:\n");
+    for (i = 0; i < argc; i++)
     {
-        ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+        if ((ret = _cargo_stream_append(ctx, argv[i])))
+        {
+            return _cargo_stream_fail(ctx, ret);
+        }
+    }
 
-        cargo_assert(ret == 0, "Failed to parse advanced example");
-        cargo_assert_str_array(vals_count, 5, vals, args1_vals_expect);
-        cargo_assert_array(ports_count, PORTS_COUNT, ports, args2_ports_expect);
-        cargo_assert(!strcmp(name, "server"), "Expected name = \"server\"");
+    if ((ret = _cargo_stream_process(ctx, 0)))
+    {
+        return _cargo_stream_fail(ctx, ret);
     }
 
-    _TEST_CLEANUP();
-    _cargo_free_str_list(&vals, &vals_count);
-    _cargo_xfree(&name);
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_missing_value)
+cargo_parse_result_t cargo_parse_end(cargo_t ctx)
 {
-    int i;
-    int j;
-    char *args[] = { "program", "--alpha", "1", "--beta" };
+    int ret = 0;
+    assert(ctx);
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (!ctx->streaming)
+    {
+        CARGODBG(1, "cargo_parse_begin has not been called\n");
+        return CARGO_PARSE_FAIL_OPT;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Succesfully parsed missing value");
+    CARGODBG(2, "============ Cargo Parse End =========\n");
 
-    _TEST_CLEANUP();
+    ret = _cargo_stream_process(ctx, 1);
+    ret = _cargo_parse_finish(ctx, ret, ctx->stream_flags);
+    _cargo_stream_clear(ctx);
+
+    return ret;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_missing_array_value)
+int cargo_parse_batch(cargo_t ctx, cargo_flags_t flags,
+                      const char *lines, size_t len,
+                      cargo_batch_f callback, void *user)
 {
-    int i[3];
-    size_t i_count = 0;
-    int j = 0;
-    char *args[] = { "program", "--beta", "2", "--alpha", "1", "2" };
+    int ret = -1;
+    int argc = 0;
+    cargo_parse_result_t result;
+    const char *line = lines;
+    const char *end = lines + len;
+    const char *eol = NULL;
+    size_t line_len = 0;
+    size_t line_no = 0;
+    size_t parsed = 0;
+    char *buf = NULL;
+    size_t buf_size = 0;
+    char **argv = NULL;
+    size_t max_argv = 0;
+    char *p = NULL;
+    char *tok = NULL;
+    size_t tok_len = 0;
+    assert(ctx);
+    assert(lines || !len);
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", ".[i]#", &i, &i_count, 3);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
-    cargo_assert(ret == 0, "Failed to add options");
+    // The line and argv buffers are reused for all lines, as is
+    // everything cargo_parse allocates.
+    while (line < end)
+    {
+        if (!(eol = memchr(line, '\n', (size_t)(end - line))))
+            eol = end;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Succesfully parsed missing value");
+        line_len = (size_t)(eol - line);
 
-    _TEST_CLEANUP();
+        if ((line_len + 1) > buf_size)
+        {
+            size_t new_size = CARGO_MAX(line_len + 1, buf_size * 2);
+            char *n = NULL;
+
+            if (!(n = _cargo_realloc(&ctx->mem, buf, new_size)))
+            {
+                CARGODBG(1, "Out of memory!\n");
+                goto fail;
+            }
+
+            buf = n;
+            buf_size = new_size;
+        }
+
+        memcpy(buf, line, line_len);
+        buf[line_len] = '\0';
+
+        argc = 0;
+        p = buf;
+
+        while ((tok = _cargo_next_arg_inplace(&p, buf + line_len, &tok_len)))
+        {
+            // Room for the argument and a terminating NULL.
+            if (((size_t)argc + 2) > max_argv)
+            {
+                size_t new_max = max_argv ? (max_argv * 2) : 16;
+                char **n = NULL;
+
+                if (!(n = _cargo_realloc(&ctx->mem, argv,
+                                         new_max * sizeof(char *))))
+                {
+                    CARGODBG(1, "Out of memory!\n");
+                    goto fail;
+                }
+
+                argv = n;
+                max_argv = new_max;
+            }
+
+            argv[argc++] = tok;
+        }
+
+        // Blank lines are skipped.
+        if (argc > 0)
+        {
+            argv[argc] = NULL;
+            ctx->batching = 1;
+            result = cargo_parse(ctx, flags, 0, argc, argv);
+            ctx->batching = 0;
+            parsed++;
+
+            CARGODBG(2, "Batch line %lu: %d\n", line_no, result);
+
+            if (callback && callback(ctx, user, line_no, result))
+            {
+                CARGODBG(2, "Batch stopped by callback\n");
+                break;
+            }
+        }
+
+        line_no++;
+        line = eol + 1;
+    }
+
+    ret = (int)parsed;
+
+fail:
+    _cargo_free(&ctx->mem, buf);
+    _cargo_free(&ctx->mem, argv);
+    return ret;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_missing_array_value_ensure_free)
+int cargo_set_scratch_buffer(cargo_t ctx, void *buf, size_t size)
 {
-    // Here we make sure allocated values get freed on a failed parse.
-    int i[3];
-    size_t i_count = 0;
-    int *j = NULL;
-    size_t j_count = 0;
-    char *args[] = { "program", "--beta", "2", "3", "--alpha", "1", "2" };
+    cargo_arena_t *a = NULL;
+    size_t align = 0;
+    assert(ctx);
 
-    memset(i, 0, sizeof(i));
+    a = &ctx->arena;
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", ".[i]#", &i, &i_count, 3);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "The beta", "[i]#", &j, &j_count, 2);
-    cargo_assert(ret == 0, "Failed to add options");
+    // Everything from the previous parse that is in the arena
+    // is gone after this.
+    _cargo_unmap_response_files(ctx);
+    _cargo_set_error(ctx, NULL);
+    ctx->args = NULL;
+    ctx->arg_count = 0;
+    ctx->unknown_opts = NULL;
+    ctx->unknown_opts_idxs = NULL;
+    ctx->unknown_opts_count = 0;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Succesfully parsed missing value");
-    cargo_assert(j == NULL, "Array non-NULL after failed parse");
+    if (buf)
+    {
+        align = (CARGO_ARENA_ALIGN - ((size_t)buf % CARGO_ARENA_ALIGN))
+              % CARGO_ARENA_ALIGN;
 
-    _TEST_CLEANUP();
+        if (size <= align)
+        {
+            CARGODBG(1, "Scratch buffer too small\n");
+            return -1;
+        }
+    }
+
+    a->user_buf = buf ? ((char *)buf + align) : NULL;
+    a->user_size = buf ? (size - align) : 0;
+    _cargo_arena_reset(a);
+
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_same_option_twice)
+size_t cargo_get_heap_alloc_count(cargo_t ctx)
 {
-    int i;
-    int j;
-    char *args[] = { "program", "--alpha", "1", "--beta", "4", "--alpha", "2" };
+    assert(ctx);
+    return ctx->mem.count;
+}
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
-    cargo_assert(ret == 0, "Failed to add options");
+static int _cargo_in_template(cargo_compiled_t compiled, const void *p)
+{
+    const char *c = (const char *)p;
+    return compiled->tmpl && (c >= compiled->tmpl)
+        && (c < (compiled->tmpl + compiled->tmpl_size));
+}
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    printf("--alpha == %d\n", i);
-    cargo_assert(ret == 0, "Failed to parsed duplicate option without unique");
-    cargo_assert(i == 2, "Expected --alpha to have value 2");
+static void *_cargo_rebase_target(cargo_compiled_t compiled,
+                                  void *p, char *targets)
+{
+    if (!_cargo_in_template(compiled, p))
+        return p;
 
-    _TEST_CLEANUP();
+    return targets + ((char *)p - compiled->tmpl);
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_same_option_twice_string)
+static int _cargo_compile_check_option(cargo_compiled_t compiled,
+                                       cargo_opt_t *opt)
 {
-    char *s = NULL;
-    int i;
-    char *args[] = { "program", "--alpha", "abc", "--beta", "4", "--alpha", "def" };
+    cargo_t ctx = compiled->ctx;
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "s", &s);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+    // Every target that is written to during a parse must be rebased
+    // for each parse state, otherwise they would be shared.
+    if (opt->internal_target || (opt->target == (void **)&ctx->help))
+    {
+        // Internal target, re-pointed for each parse state.
+    }
+    else if (!_cargo_in_template(compiled, opt->target)
+          || (opt->target_count
+            && !_cargo_in_template(compiled, opt->target_count)))
+    {
+        CARGODBG(1, "Target for \"%s\" is not in the template\n",
+                opt->name[0]);
+        return -1;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parsed duplicate option without unique");
-    cargo_assert(s && !strcmp(s, "def"), "Expected --alpha to have value \"def\"");
+    if (opt->custom_user_count
+        && !_cargo_in_template(compiled, opt->custom_user_count))
+    {
+        CARGODBG(1, "Custom count for \"%s\" is not in the template\n",
+                opt->name[0]);
+        return -1;
+    }
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&s);
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_same_option_twice_with_unique)
+int cargo_compile(cargo_t *ctx, cargo_compiled_t *compiled,
+                  void *tmpl, size_t tmpl_size)
 {
-    int i;
-    int j;
-    char *args[] = { "program", "--alpha", "1", "--beta", "4", "--alpha", "2" };
+    size_t i;
+    cargo_t c = NULL;
+    cargo_compiled_t cp = NULL;
+    assert(ctx);
+    assert(*ctx);
+    assert(compiled);
 
-    ret |= cargo_add_option(cargo, CARGO_OPT_UNIQUE,
-                                "--alpha -a", "The alpha", "i", &i);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
-    cargo_assert(ret == 0, "Failed to add options");
+    c = *ctx;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    printf("--alpha == %d\n", i);
-    cargo_assert(ret != 0, "Succesfully parsed duplicate option");
-    cargo_assert(i == 1, "Expected --alpha to have value 1");
+    if (_cargo_is_compiled(c))
+        return -1;
 
-    _TEST_CLEANUP();
+    if (!(cp = _cargo_calloc(&c->mem, 1, sizeof(struct cargo_compiled_s))))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        return -1;
+    }
+
+    cp->ctx = c;
+    cp->tmpl = (char *)tmpl;
+    cp->tmpl_size = tmpl_size;
+
+    // Do everything cargo_parse would otherwise do on the first parse,
+    // after this nothing in the definitions change.
+    _cargo_add_help_if_missing(c);
+
+    if (_cargo_add_orphans_to_default_group(c))
+    {
+        goto fail;
+    }
+
+    if (c->trie_dirty && _cargo_trie_build(c))
+    {
+        goto fail;
+    }
+
+    for (i = 0; i < c->opt_count; i++)
+    {
+        if (_cargo_compile_check_option(cp, &c->options[i]))
+        {
+            goto fail;
+        }
+    }
+
+    *compiled = cp;
+    *ctx = NULL;
+
+    return 0;
+
+fail:
+    _cargo_free(&c->mem, cp);
+    return -1;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_same_option_twice_string_with_unique)
+void cargo_compiled_destroy(cargo_compiled_t *compiled)
 {
-    char *s = NULL;
-    int i;
-    char *args[] = { "program", "--alpha", "abc", "--beta", "4", "--alpha", "def" };
+    cargo_compiled_t cp;
+    cargo_mem_t mem;
 
-    ret |= cargo_add_option(cargo, CARGO_OPT_UNIQUE,
-                            "--alpha -a", "The alpha", "s", &s);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (!compiled || !*compiled)
+        return;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    printf("--alpha = %s\n", s);
-    cargo_assert(ret != 0, "Succesfully parsed duplicate option");
-    cargo_assert(s == NULL, "Expected --alpha to have value NULL");
+    cp = *compiled;
+    mem = cp->ctx->mem;
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&s);
+    // The template might be gone by now, and it was never parsed into.
+    cp->ctx->flags &= ~CARGO_AUTOCLEAN;
+    cargo_destroy(&cp->ctx);
+
+    _cargo_free(&mem, cp);
+    *compiled = NULL;
 }
-_TEST_END()
 
-_TEST_START(TEST_highlight_args)
+int cargo_state_init_with_allocator(cargo_t *state,
+                                    cargo_compiled_t compiled,
+                                    void *targets,
+                                    const cargo_allocator_t *allocator)
 {
-    char *args[] =
+    size_t i;
+    cargo_t c = NULL;
+    cargo_t m = NULL;
+    cargo_opt_t *opt = NULL;
+    cargo_mem_t mem;
+    assert(state);
+    assert(compiled);
+
+    m = compiled->ctx;
+    *state = NULL;
+
+    // Unless given, use the same allocator as the compiled parser.
+    memset(&mem, 0, sizeof(mem));
+    mem.alloc = m->mem.alloc;
+
+    if (allocator)
     {
-        "program",
-        "--alpha", "abc",
-        "--beta", "def", "ghi",
-        "--crazy", "banans"
-    };
-    char *s = NULL;
-    int argc = sizeof(args) / sizeof(args[0]);
+        if (!allocator->malloc_fn || !allocator->realloc_fn
+            || !allocator->free_fn)
+        {
+            CARGODBG(1, "Allocator must have malloc, realloc and free set\n");
+            return -1;
+        }
 
-    printf("With color highlight & args:\n");
-    printf("----------------------------\n");
-    ret = cargo_fprint_args(stdout,
-                        argc,
-                        args,
-                        1, // Start index.
-                        0, // flags
-                        CARGO_DEFAULT_MAX_WIDTH,
-                        3, // Highlight count.
-                        1, "^"CARGO_COLOR_RED,
-                        3, "~"CARGO_COLOR_GREEN,
-                        4, "-");
-    cargo_assert(ret == 0, "Failed call cargo_fprint_args");
+        mem.alloc = *allocator;
+    }
 
-    printf("With highlight & args:\n");
-    printf("----------------------\n");
-    ret = cargo_fprint_args(stdout,
-                        argc,
-                        args,
-                        1, // Start index.
-                        CARGO_FPRINT_NOCOLOR, // flags
-                        CARGO_DEFAULT_MAX_WIDTH,
-                        3, // Highlight count.
-                        1, "^"CARGO_COLOR_RED,
-                        3, "~"CARGO_COLOR_GREEN,
-                        4, "-");
-    cargo_assert(ret == 0, "Failed call cargo_fprint_args");
+    if (!(c = _cargo_malloc(&mem, sizeof(cargo_s))))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        return -1;
+    }
 
-    printf("With highlight & no args:\n");
-    printf("-------------------------\n");
-    ret = cargo_fprint_args(stdout,
-                        argc,
-                        args,
-                        1, // Start index.
-                        CARGO_FPRINT_NOARGS, // flags
-                        CARGO_DEFAULT_MAX_WIDTH,
-                        3, // Highlight count.
-                        1, "^"CARGO_COLOR_RED, 3, "~"CARGO_COLOR_GREEN, 4, "-");
-    cargo_assert(ret == 0, "Failed call cargo_fprint_args");
+    // Share the definitions, but nothing that a parse writes to.
+    *c = *m;
+    c->mem = mem;
+    c->compiled = compiled;
+    c->help = 0;
+    c->tokens = NULL;
+    c->max_tokens = 0;
+    c->positional_cursor = 0;
+    c->unknown_opts = NULL;
+    c->unknown_opts_idxs = NULL;
+    c->unknown_opts_count = 0;
+    c->args = NULL;
+    c->arg_count = 0;
+    c->max_args = 0;
+    c->max_unknown_opts = 0;
+    c->streaming = 0;
+    c->batching = 0;
+    c->stream_final = 0;
+    c->stream_argv = NULL;
+    c->stream_count = 0;
+    c->stream_max = 0;
+    c->stream_base = 0;
+    c->stream_opt = NULL;
+    c->stream_name = NULL;
+    c->mappings = NULL;
+    c->mapping_count = 0;
+    c->max_mappings = 0;
+    c->error = NULL;
+    c->suggest_names = NULL;
+    c->suggest_name_count = 0;
+    c->records = NULL;
+    c->record_count = 0;
+    c->max_records = 0;
+    c->error_pending = 0;
+    c->short_usage = NULL;
+    c->usage = NULL;
+    memset(&c->arena, 0, sizeof(cargo_arena_t));
+    c->arena.mem = &c->mem;
+
+    if (!(c->options = _cargo_calloc(&c->mem, CARGO_MAX(m->opt_count, 1),
+                                     sizeof(cargo_opt_t))))
+    {
+        CARGODBG(1, "Out of memory!\n");
+        _cargo_free(&mem, c);
+        return -1;
+    }
 
-    printf("With no highlight & args:\n");
-    printf("-------------------------\n");
-    ret = cargo_fprint_args(stdout,
-                        argc,
-                        args,
-                        1, // Start index.
-                        CARGO_FPRINT_NOHIGHLIGHT, // flags
-                        CARGO_DEFAULT_MAX_WIDTH,
-                        3, // Highlight count.
-                        1, "^"CARGO_COLOR_RED, 3, "~"CARGO_COLOR_GREEN, 4, "-");
-    cargo_assert(ret == 0, "Failed call cargo_fprint_args");
+    memcpy(c->options, m->options, m->opt_count * sizeof(cargo_opt_t));
+    c->max_opts = m->opt_count;
 
-    printf("With default & not ordered:\n");
-    printf("-------------------------\n");
-    s = cargo_get_fprint_args(
-                        argc,
-                        args,
-                        1, // Start index.
-                        0, // flags
-                        CARGO_DEFAULT_MAX_WIDTH,
-                        3, // Highlight count.
-                        3, "~"CARGO_COLOR_GREEN, 1, "^"CARGO_COLOR_RED, 4, "-");
-    cargo_assert(s, "Failed call cargo_get_fprint_args");
-    printf("%s\n", s);
-    cargo_assert(strstr(s, "~~~~~~"), "Did not find highlight for --beta");
-    cargo_assert(strstr(s, "^^^^^^^"), "Did not find highlight for --alpha");
-    cargo_assert(strstr(s, "---"), "Did not find highlight for 'def'");
-    cargo_assert(strstr(s, "^^^^^^^") < strstr(s, "---"),
-        "--beta highlight after --alpha");
+    for (i = 0; i < c->opt_count; i++)
+    {
+        opt = &c->options[i];
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&s);
-}
-_TEST_END()
+        opt->custom_target = NULL;
+        opt->custom_target_count = 0;
+        opt->target_idx = 0;
+        opt->target_alloc_count = 0;
+        opt->target_alloc_hint = 0;
+        opt->parsed = -1;
+        opt->num_eaten = 0;
+        opt->first_parse = 1;
+        opt->bool_acc_count = 0;
 
-_TEST_START(TEST_positional_argument)
-{
-    // Here we make sure allocated values get freed on a failed parse.
-    int i;
-    int j;
-    char *args[] = { "program", "--beta", "123", "456" };
+        if (opt->internal_target)
+        {
+            opt->target = (void **)&opt->custom_target;
+            opt->target_count = &opt->custom_target_count;
+        }
+        else if (opt->target == (void **)&m->help)
+        {
+            opt->target = (void **)&c->help;
+        }
+        else
+        {
+            opt->target = _cargo_rebase_target(compiled, opt->target, targets);
+            opt->target_count = _cargo_rebase_target(compiled,
+                                        opt->target_count, targets);
+        }
 
-    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", "i", &j);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+        opt->custom_user = _cargo_rebase_target(compiled,
+                                        opt->custom_user, targets);
+        opt->custom_user_count = _cargo_rebase_target(compiled,
+                                        opt->custom_user_count, targets);
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    printf("alpha = %d\n", j);
-    cargo_assert(ret == 0, "Failed to parse positional argument");
-    cargo_assert(j == 456, "Expected \"alpha\" to have value 456");
+    *state = c;
 
-    _TEST_CLEANUP();
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_positional_array_argument)
+int cargo_state_init(cargo_t *state, cargo_compiled_t compiled, void *targets)
 {
-    // Here we make sure allocated values get freed on a failed parse.
-    size_t k;
-    int i;
-    int j[3];
-    int j_expect[] = { 456, 789, 101112 };
-    size_t j_count = 0;
-    char *args[] = { "program", "--beta", "123", "456", "789", "101112" };
+    return cargo_state_init_with_allocator(state, compiled, targets, NULL);
+}
 
-    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", ".[i]#", &j, &j_count, 3);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+void cargo_set_errorv(cargo_t ctx, cargo_err_flags_t flags,
+                    const char *fmt, va_list ap)
+{
+    cargo_astr_t str;
+    char *error = NULL;
+    assert(ctx);
+    memset(&str, 0, sizeof(str));
+    str.s = &error;
+    str.arena = &ctx->arena;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    for (k = 0; k < j_count; k++)
+    if (_cargo_render_error(ctx) && (flags & CARGO_ERR_APPEND))
     {
-        printf("alpha = %d\n", j[k]);
+        if (cargo_aappendf(&str, "%s", ctx->error) < 0)
+            return;
     }
-    cargo_assert(ret == 0, "Failed to parse positional argument");
-    cargo_assert_array(j_count, 3, j, j_expect);
 
-    _TEST_CLEANUP();
+    if (cargo_avappendf(&str, fmt, ap) < 0)
+        return;
+
+    _cargo_set_error(ctx, error);
 }
-_TEST_END()
 
-_TEST_START(TEST_multiple_positional_array_argument)
+void cargo_set_error(cargo_t ctx,
+                    cargo_err_flags_t flags, const char *fmt, ...)
 {
-    size_t k;
-    int i;
-    int j[3];
-    int j_expect[] = { 456, 789, 101112 };
-    size_t j_count = 0;
-    float m[3];
-    float m_expect[] = { 4.3f, 2.3f, 50.34f };
-    size_t m_count = 0;
-    char *args[] =
-    {
-        "program",
-        "--beta", "123",
-        "456", "789", "101112",
-        "4.3", "2.3", "50.34"
-    };
+    va_list ap;
+    assert(ctx);
+    va_start(ap, fmt);
+    cargo_set_errorv(ctx, flags, fmt, ap);
+    va_end(ap);
+}
 
-    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", ".[i]#",
-                            &j, &j_count, 3);
-    ret |= cargo_add_option(cargo, 0, "mad", "Mutual Assured Destruction", ".[f]#",
-                            &m, &m_count, 3);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+const char *cargo_get_error(cargo_t ctx)
+{
+    assert(ctx);
+    return _cargo_render_error(ctx);
+}
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+const cargo_error_record_t *cargo_get_error_records(cargo_t ctx,
+                                                    size_t *count)
+{
+    assert(ctx);
+    assert(count);
 
-    for (k = 0; k < j_count; k++)
+    *count = ctx->record_count;
+    return ctx->records;
+}
+
+const char **cargo_get_unknown(cargo_t ctx, size_t *unknown_count)
+{
+    assert(ctx);
+
+    if (unknown_count)
     {
-        printf("alpha = %d\n", j[k]);
+        *unknown_count = ctx->unknown_opts_count;
     }
 
-    for (k = 0; k < m_count; k++)
+    return (const char **)ctx->unknown_opts;
+}
+
+char **cargo_get_unknown_copy(cargo_t ctx, size_t *unknown_count)
+{
+    assert(ctx);
+    return _cargo_copy_string_list(&ctx->mem, ctx->unknown_opts,
+            ctx->unknown_opts_count, unknown_count);
+}
+
+const char **cargo_get_args(cargo_t ctx, size_t *argc)
+{
+    assert(ctx);
+
+    if (argc)
     {
-        printf("mad = %f\n", m[k]);
+        *argc = ctx->arg_count;
     }
 
-    cargo_assert(ret == 0, "Failed to parse positional argument");
-    cargo_assert_array(j_count, 3, j, j_expect);
-    cargo_assert_array(m_count, 3, m, m_expect);
+    return (const char **)ctx->args;
+}
 
-    _TEST_CLEANUP();
+char **cargo_get_args_copy(cargo_t ctx, size_t *argc)
+{
+    assert(ctx);
+    return _cargo_copy_string_list(&ctx->mem, ctx->args, ctx->arg_count, argc);
 }
-_TEST_END()
 
-_TEST_START(TEST_multiple_positional_array_argument2)
+int cargo_add_type(cargo_t ctx, char fmt, const char *name, size_t size,
+                   cargo_type_f parse, void *user)
 {
-    // Shuffle the order of arguments
-    size_t k;
-    int i;
-    int j[3];
-    int j_expect[] = { 456, 789, 101112 };
-    size_t j_count = 0;
-    float m[3];
-    float m_expect[] = { 4.3f, 2.3f, 50.34f };
-    size_t m_count = 0;
-    char *args[] =
-    {
-        "program",
-        "456", "789", "101112",
-        "--beta", "123",
-        "4.3", "2.3", "50.34"
-    };
+    cargo_ext_type_t *types = NULL;
+    cargo_ext_type_t *t = NULL;
+    assert(ctx);
 
-    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", ".[i]#",
-                            &j, &j_count, 3);
-    ret |= cargo_add_option(cargo, 0, "mad", "Mutual Assured Destruction", ".[f]#",
-                            &m, &m_count, 3);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    // The built in types and the format modifiers can't be replaced.
+    if (!name || !parse || (size == 0)
+        || !(((fmt >= 'a') && (fmt <= 'z')) || ((fmt >= 'A') && (fmt <= 'Z')))
+        || strchr("bBiudfLUscmDN", fmt))
+    {
+        CARGODBG(1, "Invalid type '%c'\n", fmt);
+        return -1;
+    }
 
-    for (k = 0; k < j_count; k++)
+    if (_cargo_find_ext_type(ctx, fmt))
     {
-        printf("alpha = %d\n", j[k]);
+        CARGODBG(1, "The type '%c' has already been added\n", fmt);
+        return -1;
     }
 
-    for (k = 0; k < m_count; k++)
+    if (!(types = _cargo_realloc(&ctx->mem, ctx->ext_types,
+                    (ctx->ext_type_count + 1) * sizeof(cargo_ext_type_t))))
     {
-        printf("mad = %f\n", m[k]);
+        CARGODBG(1, "Out of memory\n");
+        return -1;
     }
 
-    cargo_assert(ret == 0, "Failed to parse positional argument");
-    cargo_assert_array(j_count, 3, j, j_expect);
-    cargo_assert(m, "m is NULL");
-    cargo_assert_array(m_count, 3, m, m_expect);
+    ctx->ext_types = types;
+    t = &types[ctx->ext_type_count];
+    memset(t, 0, sizeof(cargo_ext_type_t));
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
-
-_TEST_START(TEST_multiple_positional_array_argument3)
-{
-    // Test with an allocated array of 1 or more positional arguments.
-    size_t k;
-    int i;
-    int j[3];
-    int j_expect[] = { 456, 789, 101112 };
-    size_t j_count = 0;
-    float *m = NULL;
-    float m_expect[] = { 4.3f, 2.3f, 50.34f, 0.99f };
-    size_t m_count = 0;
-    char *args[] =
+    if (!(t->name = _cargo_strdup(&ctx->mem, name)))
     {
-        "program",
-        "456", "789", "101112",
-        "--beta", "123",
-        "4.3", "2.3", "50.34", "0.99"
-    };
+        return -1;
+    }
 
-    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", ".[i]#",
-                            &j, &j_count, 3);
-    ret |= cargo_add_option(cargo, 0, "mad", "Mutual Assured Destruction", "[f]+",
-                            &m, &m_count);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+    t->fmt = fmt;
+    t->size = size;
+    t->parse = parse;
+    t->user = user;
+    ctx->ext_type_count++;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    return 0;
+}
 
-    printf("j_count = %lu\n", j_count);
-    for (k = 0; k < j_count; k++)
+int cargo_add_alias(cargo_t ctx, const char *optname, const char *alias)
+{
+    size_t opt_i;
+    size_t name_i;
+    cargo_opt_t *opt;
+    assert(ctx);
+
+    if (_cargo_is_compiled(ctx))
+        return -1;
+
+    if (!_cargo_find_option_name(ctx, alias, &opt_i, &name_i))
     {
-        printf("alpha = %d\n", j[k]);
+        CARGODBG(1, "Alias %s already used by option %s. Cannot add to %s.\n",
+                alias, ctx->options[opt_i].name[0], optname);
+        return -1;
     }
 
-    printf("m_count = %lu\n", m_count);
-    for (k = 0; k < m_count; k++)
+    if (_cargo_find_option_name(ctx, optname, &opt_i, &name_i))
     {
-        printf("mad = %f\n", m[k]);
+        CARGODBG(1, "Failed to add alias %s to %s, option not found.\n",
+                alias, optname);
+        return -1;
     }
 
-    cargo_assert(ret == 0, "Failed to parse positional argument");
-    cargo_assert_array(j_count, 3, j, j_expect);
-    cargo_assert_array(m_count, 4, m, m_expect);
-
-    _TEST_CLEANUP();
-    _cargo_xfree(&m);
-}
-_TEST_END()
+    CARGODBG(2, "Found option \"%s\"\n", optname);
 
-_TEST_START_EX(TEST_autoclean_flag, CARGO_AUTOCLEAN)
-{
-    char *s = NULL;
-    char *args[] = { "program", "--alpha", "abc" };
+    opt = &ctx->options[opt_i];
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "s", &s);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (opt->positional)
+    {
+        CARGODBG(1, "Cannot add alias for positional argument\n");
+        return -1;
+    }
+    else
+    {
+        if (!_cargo_starts_with_prefix(ctx, alias))
+        {
+            CARGODBG(1, "Cannot add a positional as an alias to an option. "
+                        "The alias must be prefixed with %s: \"%s\"\n",
+                        (strlen(ctx->prefix) > 1)
+                        ? "one of these characters" : "this character",
+                        ctx->prefix);
+            return -1;
+        }
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse valid option");
-    cargo_assert(s && !strcmp(s, "abc"), "Expected --alpha to have value \"abc\"");
+    if (opt->name_count >= CARGO_NAME_COUNT)
+    {
+        CARGODBG(1, "Too many aliases for option: %s\n", opt->name[0]);
+        return -1;
+    }
 
-    _TEST_CLEANUP();
-    // Note! We're not using the normal _TEST_END here so we can assert after
-    // the cargo_destroy call. Important not to use cargo_assert after
-    // _TEST_CLEANUP. Since it will result in an infinite loop!
-    cargo_destroy(&cargo);
-    if (s != NULL) return "Expected \"s\" to be freed and NULL";
-}
-_TEST_END_NODESTROY()
+    if (!(opt->name[opt->name_count] = _cargo_strdup(&ctx->mem, alias)))
+    {
+        CARGODBG(1, "Out of memory\n");
+        return -1;
+    }
 
-_TEST_START_EX(TEST_autoclean_flag_off, 0)
-{
-    char *s = NULL;
-    char *args[] = { "program", "--alpha", "abc" };
+    opt->name_count++;
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "s", &s);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (_cargo_name_index_add(ctx, opt_i, opt->name_count - 1))
+    {
+        _cargo_xfree(&ctx->mem, &opt->name[--opt->name_count]);
+        return -1;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse valid option");
-    cargo_assert(s && !strcmp(s, "abc"), "Expected --alpha to have value \"abc\"");
+    CARGODBG(2, "  Added alias \"%s\"\n", alias);
 
-    _TEST_CLEANUP();
-    cargo_destroy(&cargo);
-    if (s == NULL) return "Expected \"s\" to be non-NULL";
-    _cargo_free(s);
+    return 0;
 }
-_TEST_END_NODESTROY()
 
-_TEST_START(TEST_parse_zero_or_more_with_args)
+int cargo_set_option_descriptionv(cargo_t ctx,
+                                  const char *optname,
+                                  const char *fmt, va_list ap)
 {
-    int *i = NULL;
-    int i_expect[] = { 1, 2 };
-    size_t i_count = 0;
-    int j = 0;
-    char *args[] = { "program", "--beta", "2", "--alpha", "1", "2" };
+    int ret = 0;
+    size_t opt_i = 0;
+    size_t name_i = 0;
+    cargo_opt_t *opt = NULL;
+    assert(ctx);
 
-    cargo_get_flags(cargo);
-    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "[i]*", &i, &i_count);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (_cargo_find_option_name(ctx, optname, &opt_i, &name_i))
+    {
+        CARGODBG(1, "Failed to find option \"%s\"\n", optname);
+        return -1;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert_array(i_count, 2, i, i_expect);
+    opt = &ctx->options[opt_i];
 
-    _TEST_CLEANUP();
-    // Auto cleanup enabled.
+    _cargo_xfree(&ctx->mem, &opt->description);
+
+    ret = _cargo_vasprintf(&ctx->mem, &opt->description, fmt, ap);
+    return (ret >= 0) ? 0 : -1;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_zero_or_more_without_args)
+int cargo_set_option_description(cargo_t ctx,
+                                 const char *optname,
+                                 const char *fmt, ...)
 {
-    int *i = NULL;
-    size_t i_count = 0;
-    int j = 0;
-    char *args[] = { "program", "--beta", "2", "--alpha" };
-
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "[i]*", &i, &i_count);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert(i == NULL, "Expected i to be NULL");
-    cargo_assert(i_count == 0, "Expected i count to be 0");
-
-    _TEST_CLEANUP();
+    int ret = 0;
+    va_list ap;
+    assert(ctx);
+    va_start(ap, fmt);
+    ret = cargo_set_option_descriptionv(ctx, optname, fmt, ap);
+    va_end(ap);
+    return ret;
 }
-_TEST_END()
 
-_TEST_START(TEST_parse_zero_or_more_with_positional)
+int cargo_set_metavarv(cargo_t ctx,
+                    const char *optname,
+                    const char *fmt, va_list ap)
 {
-    int *pos = NULL;
-    int pos_expect[] = { 1, 2 };
-    size_t pos_count = 0;
-    int *i = NULL;
-    int i_expect[] = { 3, 4 };
-    size_t i_count = 0;
-    int *j = NULL;
-    int j_expect[] = { 5, 6 };
-    size_t j_count = 0;
-    char *args[] = { "program", "1", "2", "--alpha", "3", "4", "--beta", "5", "6" };
+    int ret = 0;
+    size_t opt_i;
+    size_t name_i;
+    cargo_opt_t *opt;
+    assert(ctx);
 
-    cargo_get_flags(cargo);
-    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-    ret |= cargo_add_option(cargo, 0, "pos", "The positional", "[i]*", &pos, &pos_count);
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "[i]*", &i, &i_count);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "[i]*", &j, &j_count);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (_cargo_find_option_name(ctx, optname, &opt_i, &name_i))
+    {
+        CARGODBG(1, "Failed to find option \"%s\"\n", optname);
+        return -1;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert_array(pos_count, 2, pos, pos_expect);
-    cargo_assert_array(i_count, 2, i, i_expect);
-    cargo_assert_array(j_count, 2, j, j_expect);
+    opt = &ctx->options[opt_i];
 
-    _TEST_CLEANUP();
-    // Auto cleanup enabled.
+    _cargo_xfree(&ctx->mem, &opt->metavar);
+
+    ret = _cargo_vasprintf(&ctx->mem, &opt->metavar, fmt, ap);
+    return (ret >= 0) ? 0 : -1;
 }
-_TEST_END()
 
-_TEST_START(TEST_required_option_missing)
+int cargo_set_metavar(cargo_t ctx,
+                    const char *optname,
+                    const char *fmt, ...)
 {
-    int i;
-    int j;
-    char *args[] = { "program", "--beta", "123", "456" };
+    int ret = 0;
+    va_list ap;
+    assert(ctx);
+    va_start(ap, fmt);
+    ret = cargo_set_metavarv(ctx, optname, fmt, ap);
+    va_end(ap);
+    return ret;
+}
 
-    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED,
-                            "--alpha", "The alpha", "i", &j);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+int cargo_mutex_group_set_metavarv(cargo_t ctx,
+                                   const char *mutex_group,
+                                   const char *fmt, va_list ap)
+{
+    int ret = 0;
+    cargo_group_t *g = NULL;
+    assert(ctx);
+    assert(mutex_group);
 
-    cargo_set_internal_usage_flags(cargo, CARGO_USAGE_HIDE_DESCRIPTION);
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Succeeded with missing required option");
-
-    _TEST_CLEANUP();
-}
-_TEST_END()
-
-_TEST_START(TEST_required_option)
-{
-    int i;
-    int j;
-    char *args[] = { "program", "--beta", "123", "456", "--alpha", "789" };
+    if (!(g =_cargo_find_group(ctx,
+        ctx->mutex_groups, ctx->mutex_group_count, mutex_group, NULL)))
+    {
+        CARGODBG(1, "No such mutex group \"%s\"\n", mutex_group);
+        return -1;
+    }
 
-    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED,
-                            "--alpha", "The alpha", "i", &j);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+    _cargo_xfree(&ctx->mem, &g->metavar);
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed with existing required option");
-    cargo_assert(j == 789, "Expected j == 789");
+    ret = _cargo_vasprintf(&ctx->mem, &g->metavar, fmt, ap);
 
-    _TEST_CLEANUP();
+    return (ret >= 0) ? 0 : -1;
 }
-_TEST_END()
 
-typedef struct _test_data_s
+int cargo_mutex_group_set_metavar(cargo_t ctx,
+                                  const char *mutex_group,
+                                  const char *fmt, ...)
 {
-    int width;
-    int height;
-} _test_data_t;
+    int ret = 0;
+    va_list ap;
+    assert(ctx);
+    va_start(ap, fmt);
+    ret = cargo_mutex_group_set_metavarv(ctx, mutex_group, fmt, ap);
+    va_end(ap);
+    return ret;
+}
 
-static int _test_cb(cargo_t ctx, void *user, const char *optname,
-                    int argc, char **argv)
+const char *cargo_get_usage(cargo_t ctx, cargo_usage_t flags)
 {
+    char *ret = NULL;
+    size_t i;
+    char *b = NULL;
+    int max_name_len = 0;
+    size_t positional_count = 0;
+    size_t option_count = 0;
+    const char *short_usage = NULL;
+    cargo_group_t *grp = NULL;
+    cargo_astr_t str;
+    int is_default_group = 1;
     assert(ctx);
-    assert(user);
-
-    _test_data_t *u = (_test_data_t *)user;
-    memset(u, 0, sizeof(_test_data_t));
 
-    if (argc > 0)
+    if (!(flags & CARGO_USAGE_HIDE_SHORT))
     {
-        if (sscanf(argv[0], "%dx%d", &u->width, &u->height) != 2)
+        if (!(short_usage = _cargo_get_short_usage(ctx, flags)))
         {
-            return -1;
+            CARGODBG(1, "Failed to get short usage\n");
+            return NULL;
         }
-
-        return 1; // We ate 1 argument.
     }
 
-    return -1;
-}
-
-_TEST_START(TEST_custom_callback)
-{
-    _test_data_t data;
-    char *args[] = { "program", "--alpha", "128x64" };
-
-    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+    // Only show short usage.
+    if (flags & CARGO_USAGE_SHORT)
+    {
+        return short_usage;
+    }
 
-    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "c", _test_cb, &data);
-    cargo_assert(ret == 0, "Failed to add options");
+    // TODO: Instead of looping over all options at this stage, save the length
+    // of all options on add_option, including max_length, positional_count and
+    // so on.
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    printf("%dx%d\n", data.width, data.height);
-    cargo_assert(data.width == 128, "Width expected to be 128");
-    cargo_assert(data.height == 64, "Height expected to be 128");
+    // First get option names and their length.
+    // We get the widest one so we know the column width to use
+    // for the final result.
+    //   --option_a         Some description.
+    //   --longer_option_b  Another description...
+    // ^-------------------^
+    // What should the above width be.
+    if ((max_name_len = _cargo_get_max_name_length(ctx,
+                        &positional_count, &option_count)) < 0)
+    {
+        CARGODBG(1, "Failed to get option name max length\n");
+        goto fail;
+    }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    memset(&str, 0, sizeof(str));
+    str.s = &b;
+    str.mem = &ctx->mem;
+    str.l = 1024;
 
-static int _test_cb_fixed_array(cargo_t ctx, void *user, const char *optname,
-                                int argc, char **argv)
-{
-    int i;
-    assert(ctx);
-    assert(user);
+    // TODO: Break all this into separate functions.
 
-    _test_data_t *u = (_test_data_t *)user;
-    memset(u, 0, sizeof(_test_data_t));
+    if (short_usage && !(flags & CARGO_USAGE_HIDE_SHORT))
+    {
+        cargo_aappendf(&str, "%s\n", short_usage);
+    }
 
-    for (i = 0; i < argc; i++)
+    if(ctx->description && strlen(ctx->description)
+       && !(flags & CARGO_USAGE_HIDE_DESCRIPTION))
     {
-        if (sscanf(argv[i], "%dx%d", &u[i].width, &u[i].height) != 2)
+        if (flags & CARGO_USAGE_RAW_DESCRIPTION)
         {
-            return -1;
+            if (cargo_aappendf(&str, "\n%s\n", ctx->description) < 0) goto fail;
+        }
+        else
+        {
+            char *lb_desc;
+            if (!(lb_desc = _cargo_linebreak(ctx, ctx->description, ctx->max_width)))
+            {
+                goto fail;
+            }
+            cargo_aappendf(&str, "\n%s\n", lb_desc);
+            _cargo_free(&ctx->mem, lb_desc);
         }
     }
 
-    return i;
-}
+    CARGODBG(2, "max_name_len = %d, ctx->max_width = %lu\n",
+            max_name_len, ctx->max_width);
 
-_TEST_START(TEST_custom_callback_fixed_array)
-{
-    size_t i;
-    #define DATA_COUNT 5
-    _test_data_t data[DATA_COUNT];
-    size_t data_count = 0;
-    _test_data_t data_expect[] =
+    #ifdef CARGO_DEBUG
+    for (i = 0; i < ctx->group_count; i++)
     {
-        { 128, 64 },
-        { 32, 16 },
-        { 24, 32 },
-        { 32, 32 },
-        { 24, 24 }
-    };
-    char *args[] = { "program", "--alpha", "128x64", "32x16", "24x32", "32x32", "24x24" };
+        CARGODBG(2, "%s: %lu\n",
+            ctx->groups[i].name, ctx->groups[i].opt_count);
+    }
+    #endif
 
-    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+    // Start by printing mutually exclusive groups
+    for (i = 0; i < ctx->mutex_group_count; i++)
+    {
+        int indent = 2;
+        const char *description = NULL;
+        grp = &ctx->mutex_groups[i];
 
-    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "[c]#",
-                            _test_cb_fixed_array, &data, &data_count, DATA_COUNT);
-    cargo_assert(ret == 0, "Failed to add options");
+        if (!(grp->flags & CARGO_MUTEXGRP_GROUP_USAGE))
+        {
+            continue;
+        }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+        if (grp->title)
+        {
+            cargo_aappendf(&str, "\n%s:\n", grp->title);
+        }
 
-    cargo_assert(data_count == DATA_COUNT, "Expected data_count == DATA_COUNT");
+        description = grp->description;
 
-    for (i = 0; i < data_count; i++)
-    {
-        printf("%dx%d == %dx%d\n",
-            data[i].width, data[i].height,
-            data_expect[i].width, data_expect[i].height);
-        cargo_assert(data[i].width == data_expect[i].width, "Unexpected width");
-        cargo_assert(data[i].height == data_expect[i].height, "Unexpected height");
-    }
+        if (!description)
+        {
+            description = "Specify one of the following.";
+        }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+        if (_cargo_get_group_description(ctx, &str, grp, indent))
+        {
+            goto fail;
+        }
 
-typedef struct _test_rect_s
-{
-    int x;
-    int y;
-    int w;
-    int h;
-} _test_rect_t;
+        // Positional.
+        if (_cargo_print_options(ctx, grp->option_indices, grp->opt_count,
+                                1, &str, max_name_len, indent, 1, flags))
+        {
+            goto fail;
+        }
 
-static int _test_cb_fixed_array_no_count(cargo_t ctx, void *user,
-                                        const char *optname,
-                                        int argc, char **argv)
-{
-    _test_rect_t *rect = (_test_rect_t *)user;
+        // Options.
+        if (_cargo_print_options(ctx, grp->option_indices, grp->opt_count,
+                                0, &str, max_name_len, indent, 1, flags))
+        {
+            goto fail;
+        }
+    }
 
-    if (argc != 4)
+    for (i = 0; i < ctx->group_count; i++)
     {
-        cargo_set_error(ctx, 0, "Not enough!");
-        return -1;
-    }
+        int indent = 2;
+        grp = &ctx->groups[i];
 
-    rect->x = atoi(argv[0]);
-    rect->y = atoi(argv[1]);
-    rect->w = atoi(argv[2]);
-    rect->h = atoi(argv[3]);
+        if ((grp->flags & CARGO_GROUP_HIDE) || (grp->opt_count == 0))
+        {
+            continue;
+        }
 
-    return argc;
-}
+        // The group name is always set for normal groups.
+        // The default group is simply "".
+        is_default_group = (strlen(grp->name) == 0);
 
-_TEST_START(TEST_many_options_custom)
-{
-    size_t j = 0;
-    _test_rect_t rect;
-    #define OPT_COUNT 100
-    int vals[OPT_COUNT];
-    char optname[256];
-    char *args[] = { "program", "--help" };
+        if (!is_default_group)
+        {
+            indent = 2;
+        }
 
-    // This reproduces a bug seen on the raspberry pi where
-    // you get a SIGSEV because the internal list for a custom
-    // variable would be freed and then target count was dereferenced
-    // (which now was freed).
-    for (j = 0; j < OPT_COUNT + 1; j++)
-    {
-        if (j == (OPT_COUNT / 2))
+        if (!is_default_group) cargo_aappendf(&str, "\n%s:", grp->title);
+        if (grp->description) cargo_aappendf(&str, "\n");
+
+        if (_cargo_get_group_description(ctx, &str, grp, indent))
         {
-            ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "[c]#",
-                            _test_cb_fixed_array_no_count,
-                            &rect, NULL, 4);
-            cargo_assert(ret == 0, "Failed to add options");
-            continue;
+            goto fail;
         }
-        cargo_snprintf(optname, sizeof(optname), "--opto%02d",  j+1);
-        ret |= cargo_add_option(cargo, 0, optname, LOREM_IPSUM, "i", &vals[j]);
-        cargo_assert(ret == 0, "Failed to add option");
-    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+        // Note, we only show the "Positional arguments" and "Options"
+        // titles for the default group. It becomes quite spammy otherwise.
+        if (positional_count > 0)
+        {
+            if (is_default_group)
+                if (cargo_aappendf(&str, "Positional arguments:\n") < 0) goto fail;
 
-    cargo_print_usage(cargo, 0);
+            if (_cargo_print_options(ctx, grp->option_indices, grp->opt_count,
+                                    1, &str, max_name_len, indent, 0, flags))
+            {
+                goto fail;
+            }
+        }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+        if (cargo_aappendf(&str, "\n") < 0) goto fail;
 
-_TEST_START(TEST_custom_callback_fixed_array_no_count)
-{
-    _test_rect_t rect;
-    char *args[] = { "program", "--alpha", "1", "2", "3", "4" };
+        if (option_count > 0)
+        {
+            if (is_default_group)
+                if (cargo_aappendf(&str, "Options:\n") < 0) goto fail;
 
-    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+            if (_cargo_print_options(ctx, grp->option_indices, grp->opt_count,
+                                    0, &str, max_name_len, indent, 0, flags))
+            {
+                goto fail;
+            }
+        }
+    }
 
-    // We set the count var to NULL. This should work fine!
-    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "[c]#",
-                            _test_cb_fixed_array_no_count,
-                            &rect, NULL, 4);
-    cargo_assert(ret == 0, "Failed to add options");
+    if(ctx->epilog && strlen(ctx->epilog)
+       && !(flags & CARGO_USAGE_HIDE_EPILOG))
+    {
+        if (flags & CARGO_USAGE_RAW_EPILOG)
+        {
+            if (cargo_aappendf(&str, "\n%s\n", ctx->epilog) < 0) goto fail;
+        }
+        else
+        {
+            char *lb_epilog;
+            if (!(lb_epilog = _cargo_linebreak(ctx, ctx->epilog, ctx->max_width)))
+            {
+                goto fail;
+            }
+            cargo_aappendf(&str, "\n%s\n", lb_epilog);
+            _cargo_free(&ctx->mem, lb_epilog);
+        }
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse");
+    // TODO: Realloc the buffer to minimize size.
 
-    cargo_assert(rect.x == 1, "Expected x = 1");
-    cargo_assert(rect.y == 2, "Expected y = 2");
-    cargo_assert(rect.w == 3, "Expected w = 3");
-    cargo_assert(rect.h == 4, "Expected h = 4");
+    ret = b;
 
-    _TEST_CLEANUP();
+fail:
+    // A real failure!
+    if (!ret)
+    {
+        _cargo_xfree(&ctx->mem, &b);
+    }
+
+    // Save the usage and destroy it on exit,
+    // we want the user to be able to do things like this:
+    // printf("%s\nYou're bad at typing!\n", cargo_get_usage(cargo, 0));
+    // without leaking memory.
+    _cargo_xfree(&ctx->mem, &ctx->usage);
+
+    ctx->usage = ret;
+
+    return ret;
 }
-_TEST_END()
 
-static int _test_cb_array(cargo_t ctx, void *user, const char *optname,
-                                int argc, char **argv)
+int cargo_get_stop_index(cargo_t ctx)
 {
-    int i;
     assert(ctx);
-    assert(user);
-    _test_data_t **u = (_test_data_t **)user;
-    _test_data_t *data;
+    return ctx->stopped;
+}
+
+int cargo_fprint_usage(cargo_t ctx, FILE *f, cargo_usage_t flags)
+{
+    const char *s;
+    assert(ctx);
 
-    if (!(*u = _cargo_calloc(argc, sizeof(_test_data_t))))
+    if (!(s = cargo_get_usage(ctx, flags)))
     {
         return -1;
     }
 
-    data = *u;
-
-    for (i = 0; i < argc; i++)
-    {
-        if (sscanf(argv[i], "%dx%d", &data[i].width, &data[i].height) != 2)
-        {
-            return -1;
-        }
-    }
+    fprintf(f, "%s\n", s);
 
-    return i; // How many arguments we ate.
+    return 0;
 }
 
-_TEST_START(TEST_custom_callback_array)
+int cargo_print_usage(cargo_t ctx, cargo_usage_t flags)
 {
-    size_t i;
-    _test_data_t *data = NULL;
-    size_t data_count = 0;
-    _test_data_t data_expect[] =
-    {
-        { 128, 64 },
-        { 32, 16 },
-        { 24, 32 },
-        { 32, 32 },
-        { 24, 24 }
-    };
-    char *args[] = { "program", "--alpha", "128x64", "32x16", "24x32", "32x32", "24x24" };
-
-    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
-
-    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "[c]*",
-                            _test_cb_array, &data, &data_count, DATA_COUNT);
-    cargo_assert(ret == 0, "Failed to add options");
+    return cargo_fprint_usage(ctx, stdout, flags);
+}
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+int cargo_add_group(cargo_t ctx, cargo_group_flags_t flags, const char *name,
+                    const char *title, const char *description, ...)
+{
+    char *d = NULL;
+    int ret = 0;
+    va_list ap;
+    assert(ctx);
 
-    cargo_assert(data_count == 5, "Expected data_count == 5");
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-    for (i = 0; i < data_count; i++)
+    if (description)
     {
-        printf("%dx%d == %dx%d\n",
-            data[i].width, data[i].height,
-            data_expect[i].width, data_expect[i].height);
-        cargo_assert(data[i].width == data_expect[i].width, "Unexpected width");
-        cargo_assert(data[i].height == data_expect[i].height, "Unexpected height");
+        va_start(ap, description);
+        _cargo_vasprintf(&ctx->mem, &d, description, ap);
+        va_end(ap);
     }
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&data);
+    ret = _cargo_add_group(ctx, &ctx->groups, &ctx->group_count,
+                            &ctx->max_groups,
+                            (size_t)flags, name, title, d);
+    _cargo_xfree(&ctx->mem, &d);
+    return ret;
 }
-_TEST_END()
 
-_TEST_START(TEST_zero_or_more_with_arg)
+int cargo_group_add_option(cargo_t ctx, const char *group, const char *opt)
 {
-    int i = 0;
-    int j = 0;
-    char *args[] = { "program", "--alpha", "789", "--beta", "123", "456" };
+    return _cargo_group_add_option_ex(ctx,
+                ctx->groups, ctx->group_count, group, opt, 0);
+}
 
-    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "i?", &j, "3");
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+int cargo_group_set_flags(cargo_t ctx, const char *group,
+                           cargo_group_flags_t flags)
+{
+    cargo_group_t *g = NULL;
+    size_t grp_i;
+    assert(ctx);
+    assert(group);
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed zero or more args parse");
-    cargo_assert(j == 789, "Expected j == 789");
+    if (!(g = _cargo_find_group(ctx, ctx->groups, ctx->group_count, group, &grp_i)))
+    {
+        CARGODBG(1, "No such group \"%s\"\n", group);
+        return -1;
+    }
 
-    _TEST_CLEANUP();
+    g->flags = flags;
+
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_zero_or_more_without_arg)
+int cargo_add_mutex_group(cargo_t ctx,
+                        cargo_mutex_group_flags_t flags,
+                        const char *name,
+                        const char *title,
+                        const char *description, ...)
 {
-    int i = 0;
-    int j = 5;
-    char *args[] = { "program", "--alpha", "--beta", "123", "456" };
+    char *d = NULL;
+    int ret = 0;
+    va_list ap;
+    assert(ctx);
 
-    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "i?", &j, "3");
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed zero or more args parse");
-    cargo_assert(j == 3, "Expected j == 3");
+    if (description)
+    {
+        va_start(ap, description);
+        _cargo_vasprintf(&ctx->mem, &d, description, ap);
+        va_end(ap);
+    }
 
-    _TEST_CLEANUP();
+    ret = _cargo_add_group(ctx, &ctx->mutex_groups, &ctx->mutex_group_count,
+                            &ctx->mutex_max_groups,
+                            (size_t)flags, name, title, d);
+    _cargo_xfree(&ctx->mem, &d);
+    return ret;
 }
-_TEST_END()
 
-_TEST_START(TEST_group)
+int cargo_mutex_group_add_option(cargo_t ctx, const char *group, const char *opt)
 {
-    int i = 0;
-    int j = 0;
-    int k = 0;
-    int l = 0;
-    char *args[] = { "program", "--alpha", "--beta", "123", "456" };
-    cargo_set_max_width(cargo, 60);
+    return _cargo_group_add_option_ex(ctx,
+                ctx->mutex_groups, ctx->mutex_group_count, group, opt, 1);
+}
 
-    ret = cargo_add_group(cargo, 0, "group1", "The Group 1", "This group is 1st");
-    ret |= cargo_add_group(cargo, 0, "group2", "The Group 2", LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM);
-    cargo_assert(ret == 0, "Failed to add group");
-
-    // Add options to the group using inline method.
-    ret |= cargo_add_option(cargo, 0, "   <group1> --alpha", "The alpha", "i?", &j, "3");
-    ret |= cargo_add_option(cargo, 0, "<group1> --beta -b", LOREM_IPSUM, "i", &i);
+int cargo_add_optionv(cargo_t ctx, cargo_option_flags_t flags,
+                         const char *optnames, const char *description,
+                         const char *fmt, va_list ap)
+{
+    size_t optcount = 0;
+    char **optname_list = NULL;
+    int ret = -1;
+    size_t i = 0;
+    cargo_fmt_scanner_t s;
+    cargo_opt_t *o = NULL;
+    char *grpname = NULL;
+    char *mutex_grpname = NULL;
+    int nargs_is_set = 0;
+    assert(ctx);
 
-    // Try using the API to add the option to the group.
-    ret |= cargo_add_option(cargo, 0, "--centauri", "The alpha centauri", "i?", &k, "4");
-    ret |= cargo_group_add_option(cargo, "group1", "--centauri");
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-    ret |= cargo_add_option(cargo, 0, "<group2> --delta", LOREM_IPSUM LOREM_IPSUM, "i?", &l, "5");
-    cargo_assert(ret == 0, "Failed to add options");
+    CARGODBG(2, "-------- Add option \"%s\", \"%s\" --------\n", optnames, fmt);
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed zero or more args parse");
+    if ((
+            (flags & CARGO_OPT_DEFAULT_LITERAL) ||
+            (ctx->flags & CARGO_DEFAULT_LITERALS)
+        )
+        && !(ctx->flags & CARGO_AUTOCLEAN))
+    {
+        CARGODBG(1, "Option flag CARGO_OPT_DEFAULT_LITERAL or global flag "
+                    "CARGO_DEFAULT_LITERALS must be "
+                    "combined with the global flag CARGO_AUTOCLEAN "
+                    "to avoid memory leak / crash.");
+        return -1;
+    }
 
-    cargo_print_usage(cargo, 0);
+    // TODO: Allow multiple mutex groups...
+    if (!(optnames = _cargo_get_option_group_names(ctx, optnames,
+                        &grpname, &mutex_grpname)))
+    {
+        CARGODBG(1, "Failed to parse group name\n");
+        return -1;
+    }
 
-    // Make sure the group can be hidden.
-    cargo_assert(strstr(cargo_get_usage(cargo, 0), "Group 2") != NULL, "Did not find Group 2");
-    cargo_group_set_flags(cargo, "group2", CARGO_GROUP_HIDE);
-    cargo_assert(strstr(cargo_get_usage(cargo, 0), "Group 2") == NULL, "Found Group 2");
+    CARGODBG(2, " Group: \"%s\", Optnames: \"%s\"\n", grpname, optnames);
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    if (!(optname_list = _cargo_split_and_verify_option_names(ctx, optnames, &optcount)))
+    {
+        CARGODBG(1, "Failed to split option names \"%s\"\n", optnames);
+        goto fail;
+    }
 
-_TEST_START(TEST_many_groups)
-{
-    size_t i = 0;
-    size_t j = 0;
-    #define GROUP_COUNT 20
-    #define GROUP_OPT_COUNT 20
-    int vals[GROUP_COUNT][GROUP_OPT_COUNT];
-    char grpname[256];
-    char title[256];
-    char optname[256];
-    char *args[] = { "program", "--optg01o01", "5", "--optg02o02", "123" };
+    if (!(o = _cargo_option_init(ctx, optname_list[0], description)))
+    {
+        CARGODBG(1, "Failed to init option\n");
+        goto fail;
+    }
 
-    for (i = 0; i < GROUP_COUNT; i++)
+    if (grpname)
     {
-        cargo_snprintf(grpname, sizeof(grpname), "group%d", i+1);
-        cargo_snprintf(title, sizeof(title), "The Group%d", i+1);
-        ret |= cargo_add_group(cargo, 0, grpname, title, "Group");
-        cargo_assert(ret == 0, "Failed to add group");
+        CARGODBG(2, "Add \"%s\" to group \"%s\"\n", o->name[0], grpname);
 
-        for (j = 0; j < GROUP_OPT_COUNT; j++)
+        if (cargo_group_add_option(ctx, grpname, o->name[0]))
         {
-            cargo_snprintf(optname, sizeof(optname), "--optg%02do%02d", i+1, j+1);
-            ret |= cargo_add_option(cargo, 0, optname, LOREM_IPSUM, "i", &vals[i][j]);
-            ret |= cargo_group_add_option(cargo, grpname, optname);
-            cargo_assert(ret == 0, "Failed to add option");
+            CARGODBG(1, "Failed to add option \"%s\" to group \"%s\"\n",
+                    o->name[0], grpname);
+            goto fail;
         }
     }
+    else
+    {
+        CARGODBG(2, "Add \"%s\" to default group\n", o->name[0]);
+        o->group_index = -1;
+    }
 
-    cargo_assert(ret == 0, "Failed to add groups");
+    if (mutex_grpname)
+    {
+        CARGODBG(2, "Add \"%s\" to mutex group \"%s\"\n", o->name[0], mutex_grpname);
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed zero or more args parse");
-    cargo_assert(vals[0][0] == 5, "Expected --optg01o01 to be 5");
-    cargo_assert(vals[1][1] == 123, "Expected --optg02o02 to be 123");
+        if (cargo_mutex_group_add_option(ctx, mutex_grpname, o->name[0]))
+        {
+            CARGODBG(1, "Failed to add option \"%s\" to mutex group \"%s\"",
+                    o->name[0], mutex_grpname);
+            goto fail;
+        }
+    }
 
-    cargo_print_usage(cargo, 0);
+    // Start parsing the format string.
+    _cargo_fmt_scanner_init(&s, fmt);
+    _cargo_fmt_next_token(&s);
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    // Get the first token.
+    if (_cargo_fmt_token(&s) == '.')
+    {
+        CARGODBG(2, "Static\n");
+        o->alloc = 0;
+        _cargo_fmt_next_token(&s);
+    }
+    else
+    {
+        o->alloc = 1;
+    }
 
-_TEST_START(TEST_mutex_group_guard)
-{
-    int i = 0;
-    int j = 0;
-    int k = 0;
-    char *args[] = { "program", "--alpha", "--beta", "123", "456" };
+    if (_cargo_fmt_token(&s) == '[')
+    {
+        CARGODBG(4, "   [\n");
+        o->array = 1;
+        _cargo_fmt_next_token(&s);
+    }
 
-    ret = cargo_add_mutex_group(cargo, 0, "mutex_group1", NULL, NULL);
-    cargo_assert(ret == 0, "Failed to add mutex group");
+    switch (_cargo_fmt_token(&s))
+    {
+        //
+        // !!!WARNING!!!
+        // Do not attempt to refactor and put these longer cases in
+        // separate functions. Passing a va_list around is dangerous.
+        // This works fine on Unix, but fails randomly on Windows!
+        //
 
-    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "i?", &j, "3");
-    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--alpha");
+        // Same as string, but the target is internal
+        // and will be passed to the user specified callback.
+        case 'c':
+        {
+            CARGODBG(4, "Custom callback\n");
 
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--beta");
+            if (!o->alloc)
+            {
+                CARGODBG(1, "WARNING! Static '.' is ignored for a custom "
+                            "callback the memory for the arguments is "
+                            "allocated internally.");
+                o->alloc = 1;
+            }
 
-    ret |= cargo_add_option(cargo, 0, "--centauri", "The centauri", "i?", &k, "3");
-    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--centauri");
-    cargo_assert(ret == 0, "Failed to add options");
+            o->type = CARGO_STRING;
+            o->custom = va_arg(ap, cargo_custom_f);
+            o->custom_user = va_arg(ap, void *);
 
-    // We parse args with 2 members of the mutex group.
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Succesfully parsed mutex group with 2 group members");
+            // Internal target.
+            o->target = (void **)&o->custom_target;
+            o->target_count = &o->custom_target_count;
+            o->internal_target = 1;
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+            o->lenstr = 0;
 
-_TEST_START(TEST_mutex_group_require_one)
-{
-    int i = 0;
-    int j = 0;
-    int k = 0;
-    char *args[] = { "program", "--centauri", "5" };
+            if (!o->custom)
+            {
+                CARGODBG(2, "Warning: Got NULL custom callback pointer\n");
+            }
 
-    ret = cargo_add_mutex_group(cargo,
-                                CARGO_MUTEXGRP_ONE_REQUIRED,
-                                "mutex_group1", NULL, NULL);
-    cargo_assert(ret == 0, "Failed to add mutex group");
+            _cargo_fmt_next_token(&s);
 
-    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "i", &j);
-    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--alpha");
+            switch (_cargo_fmt_token(&s))
+            {
+                // A shortcut to "[c]#", cbfunc, NULL, NULL, 0.
+                // which makes a custom callback a bool flag basically.
+                case '0': o->nargs = 0; break;
+                default:
+                {
+                    _cargo_fmt_prev_token(&s);
+                    o->nargs = 1;
+                    break;
+                }
+            }
 
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
-    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--beta");
+            nargs_is_set = 1;
 
-    // Don't add this to te mutex group.
-    ret |= cargo_add_option(cargo, 0, "--centauri", "The centauri", "i?", &k, "3");
-    cargo_assert(ret == 0, "Failed to add options");
+            break;
+        }
+        case 'D': // D as in Dummy.
+        {
+            // Shortcut for: "c0", NULL, NULL;
+            // That is a dummy callback. This is mostly useful
+            // for using in a mutex group.
+            o->array = 0;
+            o->alloc = 1;
+            o->type = CARGO_STRING;
+            o->custom = NULL;
+            o->custom_user = NULL;
+            o->lenstr = 0;
+            o->nargs = 0;
+            o->target = (void **)&o->custom_target;
+            o->target_count = &o->custom_target_count;
+            o->internal_target = 1;
+            nargs_is_set = 1;
+            break;
+        }
+        case 's':
+        {
+            o->type = CARGO_STRING;
+            o->target = (void *)va_arg(ap, char *);
 
-    // We parse args with no members of the mutex group.
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0,
-        "Succesfully parsed mutex group with no mutex member when 1 required");
-    cargo_assert(k == 5, "Expected k == 5");
+            CARGODBG(4, "Read string\n");
+            _cargo_fmt_next_token(&s);
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+            if (_cargo_fmt_token(&s) == '#')
+            {
+                o->lenstr = (size_t)va_arg(ap, int);
+                CARGODBG(4, "String length: %lu\n", o->lenstr);
 
-_TEST_START(TEST_cargo_split_commandline)
-{
-    const char *cmd = "abc def \"ghi jkl\"";
-    char *argv_expect[] =
-    {
-        "abc", "def", "ghi jkl"
-    };
-    char **argv = NULL;
-    int argc = 0;
-    int i;
-    ret = 0;
+                if (o->alloc)
+                {
+                    CARGODBG(1, "%s: WARNING! Usually restricting the size of a "
+                        "string using # is only done on static strings.\n"
+                        "    Are you sure you want this?\n",
+                        o->name[0]);
+                    CARGODBG(1, "      \"%s\"\n", s.start);
+                    CARGODBG(1, "       %*s\n", s.column, "^");
+                }
+            }
+            else
+            {
+                // String size not fixed.
+                o->lenstr = 0;
+                _cargo_fmt_prev_token(&s);
+            }
 
-    argv = cargo_split_commandline(0, cmd, &argc);
-    for (i = 0; i < argc; i++)
-    {
-        printf("%s\n", argv[i]);
-    }
-    cargo_assert(argv != NULL, "Got NULL argv");
-    cargo_assert_str_array((size_t)argc, 3, argv, argv_expect);
-    cargo_free_commandline(&argv, argc);
+            break;
+        }
+        case 'B':
+        case 'b':
+        {
+            o->type = CARGO_BOOL;
+            o->target = va_arg(ap, void *);
 
-    argv = cargo_split_commandline(0, NULL, &argc);
-    cargo_assert(argv == NULL, "Expected NULL argv");
+            if (_cargo_fmt_token(&s) == 'B')
+            {
+                // A bit in a bitset of unsigned long long words, so
+                // many flags can share the same few words.
+                int bit = va_arg(ap, int);
 
-    #ifndef _WIN32
-    argv = cargo_split_commandline(0, "cmd not \"bla closed", &argc);
-    cargo_assert(argv == NULL, "Invalid commandline parsed as ok");
-    #endif
+                if (!o->target || (bit < 0) || o->array)
+                {
+                    CARGODBG(1, "%s: Invalid bit target\n", o->name[0]);
+                    goto fail;
+                }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+                o->target = (void **)((unsigned long long *)o->target + (bit / 64));
+                o->bit_mask = 1ULL << (bit % 64);
+            }
 
-_TEST_START(TEST_missing_last_arg)
-{
-    int k = 0;
-    char *args[] = { "program", "--centauri" };
+            // Look for any modifier tokens.
+            _cargo_fmt_next_token(&s);
 
-    ret |= cargo_add_option(cargo, 0, "--centauri", "The centauri", "i", &k);
-    cargo_assert(ret == 0, "Failed to add options");
+            switch (_cargo_fmt_token(&s))
+            {
+                // Read an int that will be stored in the bool value (Default 1)
+                case '=': o->bool_store = va_arg(ap, int); break;
+                // Count flag occurances.
+                case '!': o->bool_count = 1; break;
+                case '|':
+                case '+':
+                case '&':
+                case '_':
+                {
+                    switch (_cargo_fmt_token(&s))
+                    {
+                        default:
+                        case '|': o->bool_acc_op = CARGO_BOOL_OP_OR; break;
+                        case '+': o->bool_acc_op = CARGO_BOOL_OP_PLUS; break;
+                        case '&': o->bool_acc_op = CARGO_BOOL_OP_AND; break;
+                        case '_': o->bool_acc_op = CARGO_BOOL_OP_STORE; break;
+                    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Succesfully parsed option without argument");
+                    o->bool_acc_count = 0;
+                    o->bool_acc_max_count = (size_t)va_arg(ap, unsigned int);
+                    CARGODBG(3, "Bool acc max count %lu\n", o->bool_acc_max_count);
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+                    if (!(o->bool_acc = _cargo_calloc(&ctx->mem, o->bool_acc_max_count, sizeof(int))))
+                    {
+                        CARGODBG(1, "Out of memory\n");
+                        goto fail;
+                    }
 
-static const char *_cargo_test_verify_usage_length(const char *usage, int width)
-{
-    char *ret = NULL;
-    char **lines = NULL;
-    size_t line_count = 0;
-    size_t len = 0;
-    size_t i = 0;
-    assert(usage);
-    assert(width);
+                    for (i = 0; i < o->bool_acc_max_count; i++)
+                    {
+                        o->bool_acc[i] = va_arg(ap, int);
+                        CARGODBG(3, "  bool acc value %lu: 0x%x\n", i, o->bool_acc[i]);
+                    }
+                    break;
+                }
+                default:
+                {
+                    // Got no flag modifier token.
+                    o->bool_store = 1;
+                    o->bool_count = 0;
+                    o->bool_acc = NULL;
+                    _cargo_fmt_prev_token(&s);
+                }
+            }
 
-    printf("%s\n", usage);
+            break;
+        }
+        case 'm':
+        {
+            // A bitmap set from a range list, such as "0-63,128".
+            // The bits are unsigned ints as far as validation goes.
+            o->type = CARGO_UINT;
+            o->bitmap = 1;
+            o->ranges = 1;
+            o->delimiter = ',';
+            o->target = va_arg(ap, void *);
 
-    if (!(lines = _cargo_split(usage, "\n", &line_count)))
-    {
-        return "Failed to split usage";
-    }
+            _cargo_fmt_next_token(&s);
 
-    printf("Line count: %lu\n", line_count);
+            if (_cargo_fmt_token(&s) != '#')
+            {
+                CARGODBG(1, "%s: Expected '#' after 'm'\n", o->name[0]);
+                _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
+                goto fail;
+            }
 
-    for (i = 0; i < line_count; i++)
-    {
-        len = strlen(lines[i]);
-        printf("%02lu Len: %02lu:%s\n", i, len, lines[i]);
+            {
+                int bits = va_arg(ap, int);
 
-        if ((int)len > width)
-        {
-            ret = "Got usage line longer than specified";
+                if ((bits < 1) || o->array)
+                {
+                    CARGODBG(1, "%s: Invalid bitmap\n", o->name[0]);
+                    goto fail;
+                }
+
+                o->bitmap_bits = (size_t)bits;
+            }
             break;
         }
-    }
+        // TODO: Maybe replace target here with a union?
+        case 'i': o->type = CARGO_INT;    o->target = va_arg(ap, void *); break;
+        case 'd': o->type = CARGO_DOUBLE; o->target = va_arg(ap, void *); break;
+        case 'u': o->type = CARGO_UINT;   o->target = va_arg(ap, void *); break;
+        case 'f': o->type = CARGO_FLOAT;  o->target = va_arg(ap, void *); break;
+        case 'L': o->type = CARGO_LONGLONG;   o->target = va_arg(ap, void *); break;
+        case 'U': o->type = CARGO_ULONGLONG;  o->target = va_arg(ap, void *); break;
+        default:
+        {
+            cargo_ext_type_t *ext = _cargo_find_ext_type(ctx, _cargo_fmt_token(&s));
 
-    _cargo_free_str_list(&lines, &line_count);
-    return ret;
-}
+            if (!ext)
+            {
+                _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
+                goto fail;
+            }
 
-_TEST_START(TEST_cargo_set_max_width)
-{
-    int i;
-    int j;
-    const char *err = NULL;
-    const char *usage = NULL;
-    char *args[] = { "program", "--alpha", "789", "--beta", "123" };
+            o->type = CARGO_EXTENSION;
+            o->ext = *ext;
+            o->target = va_arg(ap, void *);
+            break;
+        }
+    }
 
-    cargo_set_description(cargo, LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM);
-    cargo_set_epilog(cargo, LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM);
+    if (o->array)
+    {
+        // Custom callbacks uses an internal target and count.
+        // However we still return the count in a separate
+        // user specified value for arrays.
+        if (o->custom)
+        {
+            o->custom_user_count = va_arg(ap, size_t *);
+        }
+        else
+        {
+            // This is where we return the number of arguments
+            // we have parsed for this option.
+            o->target_count = va_arg(ap, size_t *);
+        }
 
-    ret |= cargo_add_option(cargo, 0, "--alpha", LOREM_IPSUM, "i", &j);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", LOREM_IPSUM, "i", &i);
-    cargo_assert(ret == 0, "Failed to add options");
+        _cargo_fmt_next_token(&s);
 
-    cargo_set_max_width(cargo, 40);
-    cargo_assert(cargo_get_width(cargo, 0) == 40, "Unexpected witdth returned");
-    usage = cargo_get_usage(cargo, 0);
-    cargo_assert(usage != NULL, "Got NULL usage on width 40");
-    err = _cargo_test_verify_usage_length(usage, 40);
-    cargo_assert(err == NULL, err);
+        // A delimiter lets a single argument hold several values,
+        // "[i,]+" parses "--ids 1,2,3" (or "--ids 1,2 3").
+        switch (_cargo_fmt_token(&s))
+        {
+            case ',':
+            case ';':
+            case ':':
+            {
+                if ((o->type == CARGO_BOOL) || (o->type == CARGO_STRING)
+                    || (o->type == CARGO_EXTENSION))
+                {
+                    CARGODBG(1, "%s: Only numeric arrays can be delimited\n",
+                            o->name[0]);
+                    _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
+                    goto fail;
+                }
 
-    // Set a size bigger than CARGO_MAX_MAX_WIDTH.
-    cargo_set_max_width(cargo, CARGO_MAX_MAX_WIDTH * 2);
-    cargo_assert(cargo_get_width(cargo, 0) == CARGO_MAX_MAX_WIDTH,
-        "Got greater width than CARGO_MAX_MAX_WIDTH");
-    usage = cargo_get_usage(cargo, 0);
-    cargo_assert(usage != NULL, "Got NULL usage on width CARGO_MAX_MAX_WIDTH * 2");
-    err = _cargo_test_verify_usage_length(usage, CARGO_MAX_MAX_WIDTH);
-    cargo_assert(err == NULL, err);
+                o->delimiter = _cargo_fmt_token(&s);
+                _cargo_fmt_next_token(&s);
+                break;
+            }
+            case '-':
+            {
+                // A range list "[u-]+" parses "--cpus 0-3,8-15:2".
+                if ((o->type == CARGO_BOOL) || (o->type == CARGO_STRING)
+                    || (o->type == CARGO_FLOAT) || (o->type == CARGO_DOUBLE)
+                    || (o->type == CARGO_EXTENSION))
+                {
+                    CARGODBG(1, "%s: Only integer arrays can be range lists\n",
+                            o->name[0]);
+                    _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
+                    goto fail;
+                }
 
-    // Just make sure this doesn't crash.
-    // This could return -1, and we cannot assert on any return value
-    // since it's specific to the system the test is run on.
-    cargo_get_width(cargo, CARGO_WIDTH_RAW);
+                o->ranges = 1;
+                o->delimiter = ',';
+                _cargo_fmt_next_token(&s);
+                break;
+            }
+        }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+        if (_cargo_fmt_token(&s) != ']')
+        {
+            CARGODBG(1, "%s: Expected ']'\n", o->name[0]);
+            CARGODBG(1, "      \"%s\"\n", fmt);
+            CARGODBG(1, "        %*s\n", s.column, "^");
+            goto fail;
+        }
 
-_TEST_START(TEST_cargo_snprintf)
-{
-    char buf[32];
-    ret = cargo_snprintf(buf, 0, "%d", 123);
-    printf("%d\n", ret);
-    cargo_assert(ret == 0, "Expected ret == 0 when given 0 buflen");
+        _cargo_fmt_next_token(&s);
 
-    // Let memcheckers make sure this doesn't write past end of buffer
-    ret = cargo_snprintf(buf, sizeof(buf), "%s", LOREM_IPSUM);
+        if (o->alloc)
+        {
+            switch (_cargo_fmt_token(&s))
+            {
+                case '*': o->nargs = CARGO_NARGS_ZERO_OR_MORE; break;
+                case '+': o->nargs = CARGO_NARGS_ONE_OR_MORE;  break;
+                case 'N': // Fall through. Python uses N so lets allow that...
+                case '#': o->nargs = va_arg(ap, int); break;
+                default: _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
+                        goto fail;
+            }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+            // By default "nargs" is the max number of arguments the option should parse.
+            o->max_target_count = (o->nargs >= 0) ? o->nargs : (size_t)(-1);
+        }
+        else
+        {
+            assert(*fmt == '.');
+            // If we have a static array. For example:
+            // "int val[4];"
+            // The max target count must still always be specified
+            // if we use "+" or "*" when in static mode.
+            o->max_target_count = va_arg(ap, int);
 
-_TEST_START(TEST_cargo_set_prefix)
-{
-    int i;
-    int j;
-    int k;
-    char *args[] = { "program", "--alpha", "789", "++beta", "123" };
+            switch (_cargo_fmt_token(&s))
+            {
+                case '*': o->nargs = CARGO_NARGS_ZERO_OR_MORE; break;
+                case '+': o->nargs = CARGO_NARGS_ONE_OR_MORE;  break;
+                case 'N': // Fall through. Python uses N so lets allow that...
+                case '#': o->nargs = o->max_target_count; break;
+                default: _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
+                        goto fail;
+            }
+        }
+    }
+    else
+    {
+        // Non-array.
 
-    cargo_set_prefix(cargo, "+");
+        if (o->type == CARGO_BOOL)
+        {
+            // BOOLs never have arguments.
+            o->nargs = 0;
+        }
+        else
+        {
+            _cargo_fmt_next_token(&s);
 
-    ret = cargo_add_option(cargo, 0, "--alpha", LOREM_IPSUM, "i", &j);
-    cargo_assert(ret != 0, "Succesfully added argument with invalid prefix");
+            if (_cargo_fmt_token(&s) == '?')
+            {
+                o->nargs = CARGO_NARGS_ZERO_OR_ONE;
+                o->zero_or_one_default = va_arg(ap, char *);
+            }
+            else
+            {
+                _cargo_fmt_prev_token(&s);
 
-    ret = cargo_add_option(cargo, 0, "centauri c", LOREM_IPSUM, "i", &k);
-    cargo_assert(ret != 0, "Expected positional argument to reject alias");
+                if (!nargs_is_set)
+                {
+                    o->nargs = 1;
+                }
+            }
+        }
 
-    ret = cargo_add_option(cargo, 0, "++beta +b", LOREM_IPSUM, "i", &i);
-    cargo_assert(ret == 0, "Failed to add option with valid prefix '+'");
+        // Never allocate single values (unless it's a string).
+        o->alloc = (o->type != CARGO_STRING) ? 0 : o->alloc;
+        o->max_target_count = 1;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse with custom prefix");
-    cargo_assert(i == 123, "Expected ++beta to have value 123");
+    _cargo_fmt_next_token(&s);
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    if (_cargo_fmt_token(&s) != '\0')
+    {
+        _cargo_invalid_format_char(ctx, o->name[0], fmt, &s);
+        CARGODBG(1, "Got garbage at end of format string\n");
+        goto fail;
+    }
 
-_TEST_START(TEST_cargo_aapendf)
-{
-    char *s = NULL;
-    size_t lbefore = 0;
-    size_t lorem_lens = (strlen(LOREM_IPSUM) * 3);
-    cargo_astr_t astr;
+    o->flags = flags;
+    o->first_parse = 1;
 
-    // This test is only valid if the test strings causes a realloc.
-    assert(lorem_lens > CARGO_ASTR_DEFAULT_SIZE);
+    // Check if the option has a prefix
+    // (if not it's positional).
+    o->positional = !_cargo_is_prefix(ctx, o->name[0][0]);
 
-    memset(&astr, 0, sizeof(cargo_astr_t));
-    astr.s = &s;
+    if (o->positional
+        && !(o->flags & CARGO_OPT_NOT_REQUIRED)
+        && (o->nargs != CARGO_NARGS_ZERO_OR_MORE)
+        && (o->nargs != CARGO_NARGS_ZERO_OR_ONE))
+    {
+        CARGODBG(2, "Positional argument %s required by default\n", o->name[0]);
+        o->flags |= CARGO_OPT_REQUIRED;
+    }
 
-    ret = cargo_aappendf(&astr, "%s", "Some short string");
-    cargo_assert(ret > 0, "Expected ret > 0");
-    lbefore = astr.l;
+    if (_cargo_validate_option_args(ctx, o))
+    {
+        goto fail;
+    }
 
-    // Trigger realloc.
-    cargo_aappendf(&astr, "%s%s%s", LOREM_IPSUM, LOREM_IPSUM, LOREM_IPSUM);
-    cargo_assert(ret > 0, "Expected ret > 0");
-    cargo_assert(astr.offset > lorem_lens, "Expected longer string");
-    cargo_assert(astr.l > lbefore, "Expected realloc");
+    // .[s]#  .[s]+  .[s]*
+    if ((o->type == CARGO_STRING)
+         && (o->nargs != 1)
+         && (o->lenstr == 0)
+         && !o->alloc)
+    {
+        // A list of strings with a static size is a special case:
+        //   char *strs[5];
+        // Since we only want to allocate memory for the individual
+        // strings we parse, but not the entire list (as with):
+        //   char **strs;
+        // The format string for this would be ".[s]#"
+        //
+        // nargs != 1 && nargs != -1:
+        //   So we want nargs to be set, but not to infinite (-1),
+        //   this means # was used.
+        // lenstr == 0:
+        //   .[s#]# would mean we have something like char strs[5][15];
+        // !alloc:
+        //   The list is not to be allocated.
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&s);
-}
-_TEST_END()
+        // So in this case we are not allocating the list itself
+        // since that is of a fixed size. But we want to allocate
+        // each individual item string.
+        o->str_alloc_items = 1;
+    }
 
-_TEST_START(TEST_cargo_get_fprint_args)
-{
-    int i = 0;
-    int j = 0;
-    char *argv[] = { "program", "first", "second", "--third", "123" };
-    int argc = sizeof(argv) / sizeof(argv[0]);
-    char *s = NULL;
-    int start;
-    cargo_highlight_t highlights[] =
+    if ((o->type == CARGO_STRING)
+         && (o->lenstr == 0)
+         && (o->alloc || o->str_alloc_items)
+         && ((flags & CARGO_OPT_BORROW_STRING)
+            || (ctx->flags & CARGO_BORROW_STRINGS)))
     {
-        { 1, "#"CARGO_COLOR_YELLOW },
-        { 4, "="CARGO_COLOR_GREEN }
-    };
-    ret = 0;
+        // Only full length strings that would otherwise be allocated
+        // can be borrowed, "s#" still copies at most # characters.
+        o->str_borrow = 1;
+    }
 
-    start = 0;
-    printf("\nStart %d:\n", start);
-    printf("----------\n");
-    s = cargo_get_fprint_args(argc, argv,
-                            start,  // start.
-                            0,      // flags.
-                            CARGO_DEFAULT_MAX_WIDTH,
-                            3,      // highlight_count (how many follows).
-                            0, "^"CARGO_COLOR_RED,
-                            2 ,"~",
-                            4, "*"CARGO_COLOR_CYAN);
-    cargo_assert(s != NULL, "Got NULL fprint string");
-    printf("%s\n", s);
-    for (i = start; i < argc; i++)
+    for (i = 1; i < optcount; i++)
     {
-        cargo_assert(strstr(s, argv[i]), "Expected to find argv params");
+        if (cargo_add_alias(ctx, optname_list[0], optname_list[i]))
+        {
+            goto fail;
+        }
     }
-    cargo_assert(strstr(s, "^"), "Expected ^ highlight");
-    cargo_assert(strstr(s, CARGO_COLOR_RED), "Expected red color for ^");
-    cargo_assert(strstr(s, "~"), "Expected ~ highlight");
-    cargo_assert(strstr(s, "*"), "Expected * highlight");
-    cargo_assert(strstr(s, CARGO_COLOR_CYAN), "Expected red color for *");
-    _cargo_xfree(&s);
 
-    // Other start index.
-    start = 1;
-    printf("\nStart %d:\n", start);
-    printf("----------\n");
-    s = cargo_get_fprint_args(argc, argv,
-                            start,  // start.
-                            0,      // flags.
-                            CARGO_DEFAULT_MAX_WIDTH,
-                            3,      // highlight_count (how many follows).
-                            0, "^"CARGO_COLOR_RED, // Should not be shown.
-                            2 ,"~",
-                            4, "*"CARGO_COLOR_CYAN);
-    cargo_assert(s != NULL, "Got NULL fprint string");
-    printf("%s\n", s);
-    for (i = start; i < argc; i++)
+    CARGODBG(2, " Option %s:\n", o->name[0]);
+    CARGODBG(2, "   max_target_count = %lu\n", o->max_target_count);
+    CARGODBG(2, "   alloc = %d\n", o->alloc);
+    CARGODBG(2, "   lenstr = %lu\n", o->lenstr);
+    CARGODBG(2, "   nargs = %d\n", o->nargs);
+    CARGODBG(2, "   positional = %d\n", o->positional);
+    CARGODBG(2, "   array = %d\n", o->array);
+    CARGODBG(2, "   \n");
+
+    if (o->positional && _cargo_add_positional(ctx, ctx->opt_count - 1))
     {
-        cargo_assert(strstr(s, argv[i]), "Expected to find argv params");
+        goto fail;
     }
-    cargo_assert(!strstr(s, "^"), "Expected NO ^ highlight");
-    cargo_assert(!strstr(s, CARGO_COLOR_RED), "Expected NO red color for ^");
-    cargo_assert(strstr(s, "~"), "Expected ~ highlight");
-    cargo_assert(strstr(s, "*"), "Expected red color for *");
-    cargo_assert(strstr(s, CARGO_COLOR_CYAN), "Expected red color for *");
-    _cargo_xfree(&s);
 
-    // Pass a list instead of var args.
-    for (i = 0; i < argc+1; i++)
+    ret = 0;
+
+fail:
+    if (ret < 0)
     {
-        start = i;
-        printf("\nList start %d:\n", start);
-        printf("-------------\n");
-        s = cargo_get_fprintl_args(argc, argv,
-                                start,  // start.
-                                0,      // flags
-                                CARGO_DEFAULT_MAX_WIDTH,
-                                sizeof(highlights) / sizeof(highlights[0]),
-                                highlights);
-        printf("%s\n", s);
-        for (j = start; j < argc; j++)
+        if (o)
         {
-            cargo_assert(strstr(s, argv[i]), "Expected to find argv params");
-        }
+            _cargo_option_destroy(&ctx->mem, o);
+            ctx->opt_count--;
 
-        if (start <= highlights[0].i)
-        {
-            cargo_assert(strstr(s, "#"), "Expected # highlight");
-            cargo_assert(strstr(s, CARGO_COLOR_YELLOW), "Expected yellow color for #");
-        }
-        else
-        {
-            cargo_assert(!strstr(s, "#"), "Expected NO # highlight");
-            cargo_assert(!strstr(s, CARGO_COLOR_YELLOW), "Expected NO yellow color for #");
+            // Drop the names of the removed option from the index.
+            _cargo_name_index_rebuild(ctx);
         }
+    }
 
-        if (start <= highlights[1].i)
-        {
-            cargo_assert(strstr(s, "="), "Expected = highlight");
-            cargo_assert(strstr(s, CARGO_COLOR_GREEN), "Expected red color for =");
-        }
-        else
-        {
-            cargo_assert(!strstr(s, "="), "Expected NO = highlight");
-            cargo_assert(!strstr(s, CARGO_COLOR_GREEN), "Expected NO red color for =");
-        }
+    _cargo_xfree(&ctx->mem, &grpname);
+    _cargo_xfree(&ctx->mem, &mutex_grpname);
+    _cargo_free_str_list(&ctx->mem, &optname_list, &optcount);
 
-        _cargo_xfree(&s);
-    }
+    return ret;
+}
 
-    ret = cargo_fprintl_args(stdout, argc, argv, 0, 0, CARGO_DEFAULT_MAX_WIDTH,
-                            sizeof(highlights) / sizeof(highlights[0]),
-                            highlights);
-    cargo_assert(ret == 0, "Expected success");
+int cargo_add_option(cargo_t ctx, cargo_option_flags_t flags,
+                        const char *optnames, const char *description,
+                        const char *fmt, ...)
+{
+    int ret;
+    va_list ap;
+    assert(ctx);
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&s);
+    va_start(ap, fmt);
+    ret = cargo_add_optionv(ctx, flags, optnames, description, fmt, ap);
+    va_end(ap);
+
+    return ret;
 }
-_TEST_END()
 
-_TEST_START(TEST_cargo_get_fprint_args_long)
+cargo_validation_t *cargo_create_validator(const char *name,
+                                           cargo_validation_f validator,
+                                           cargo_validation_destroy_f destroy,
+                                           cargo_type_t types,
+                                           void *user)
 {
-    char *s = NULL;
-    char **argv = NULL;
-    int argc = 0;
+    cargo_validation_t *v = NULL;
 
-    argv = cargo_split_commandline(0, LOREM_IPSUM, &argc);
+    if (!(v = _cargo_calloc(NULL, 1, sizeof(cargo_validation_t))))
+    {
+        return NULL;
+    }
 
-    cargo_assert(argv, "Got NULL argv");
+    v->name = name;
+    v->validator = validator;
+    v->destroy = destroy;
+    v->types = types;
+    v->user = user;
 
-    s = cargo_get_fprint_args(argc, argv,
-                            0,      // start.
-                            0,      // flags.
-                            CARGO_AUTO_MAX_WIDTH,
-                            3,      // highlight_count (how many follows).
-                            0, "^"CARGO_COLOR_RED, // Should not be shown.
-                            2 ,"~",
-                            4, "*"CARGO_COLOR_CYAN);
+    return v;
+}
 
-    cargo_assert(s, "Got NULL string");
+void *cargo_validator_get_context(cargo_validation_t *validator)
+{
+    assert(validator);
+    return validator->user;
+}
 
-    printf("%s\n", s);
-    cargo_assert(strstr(s, "^"), "Missing \"^\" highlight");
-    cargo_assert(strstr(s, "~"), "Missing \"~\" highlight");
-    cargo_assert(strstr(s, "*"), "Missing \"*\" highlight");
-    _cargo_free(s);
 
-    s = cargo_get_fprint_args(argc, argv,
-                            0,      // start.
-                            0,      // flags.
-                            150,
-                            3,      // highlight_count (how many follows).
-                            0, "^"CARGO_COLOR_RED, // Should not be shown.
-                            2 ,"~",
-                            25, "*"CARGO_COLOR_CYAN);
+static int _cargo_validate_range_cb(cargo_t ctx, cargo_validation_flags_t flags,
+                        const char *opt, cargo_validation_t *vd, void *value)
+{
+    #define _CARGO_COMPARE_RANGE(_type, valfmt, _member)                    \
+    do                                                                      \
+    {                                                                       \
+        _type i = *((_type *)value);                                        \
+        if ((i < vr->min._member) || (i > vr->max._member))                 \
+        {                                                                   \
+            cargo_set_error(ctx, 0,                                         \
+                "Value must be in the range between "                       \
+                 valfmt" and "valfmt" for %s but got "valfmt"\n",           \
+                vr->min._member, vr->max._member, opt, i);                  \
+            return -1;                                                      \
+        }                                                                   \
+    } while (0)
 
-    cargo_assert(s, "Got NULL string");
+    #define _CARGO_COMPARE_FLOAT_RANGE(_type, valfmt, _member)              \
+    do                                                                      \
+    {                                                                       \
+        _type f = *((_type *)value);                                        \
+        _type min = vr->min._member;                                        \
+        _type max = vr->max._member;                                        \
+        _type epsilon = vr->epsilon._member;                                \
+        if (((f < min) && !_cargo_nearly_equal(f, min, epsilon))            \
+         || ((f > max) && !_cargo_nearly_equal(f, max, epsilon)))           \
+        {                                                                   \
+            cargo_set_error(ctx, 0,                                         \
+                "Value must be in the range between "                       \
+                 valfmt" and "valfmt" for %s but got "valfmt"\n",       \
+                vr->min._member, vr->max._member, opt, f);                  \
+            return -1;                                                      \
+        }                                                                   \
+    } while (0)
 
-    printf("%s\n", s);
-    cargo_assert(strstr(s, "^"), "Missing \"^\" highlight");
-    cargo_assert(strstr(s, "~"), "Missing \"~\" highlight");
-    cargo_assert(!strstr(s, "*"), "Got \"*\" highlight when it should be off screen");
+    cargo_type_t type = cargo_get_option_type(ctx, opt);
+    cargo_range_validation_t *vr = NULL;
+    assert(ctx);
+    assert(vd);
+    assert(opt);
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&s);
-    cargo_free_commandline(&argv, argc);
+    vr = (cargo_range_validation_t *)cargo_validator_get_context(vd);
+
+    switch (type)
+    {
+        case CARGO_INT:
+            _CARGO_COMPARE_RANGE(int, "%d", i); break;
+        case CARGO_UINT:
+            _CARGO_COMPARE_RANGE(unsigned int, "%u", u); break;
+        case CARGO_FLOAT:
+            _CARGO_COMPARE_FLOAT_RANGE(float, "%0.2f", f); break;
+        case CARGO_DOUBLE:
+            _CARGO_COMPARE_FLOAT_RANGE(double, "%0.2f", d); break;
+        case CARGO_LONGLONG:
+            _CARGO_COMPARE_RANGE(long long int, "%"CARGO_LONGLONG_FMT, ll); break;
+        case CARGO_ULONGLONG:
+            _CARGO_COMPARE_RANGE(unsigned long long int, "%"CARGO_ULONGLONG_FMT, ull); break;
+        case CARGO_BOOL:
+        case CARGO_STRING:
+        case CARGO_EXTENSION: return -1;
+    }
+
+    return 0;
+    #undef _CARGO_COMPARE_RANGE
+    #undef _CARGO_COMPARE_FLOAT_RANGE
 }
-_TEST_END()
 
-_TEST_START(TEST_cargo_fprintf)
+static cargo_validation_t *_cargo_create_range(const char *name,
+                                               cargo_type_t type)
 {
-    char *s = NULL;
-    cargo_fprintf(stdout, "%shej%s poop\n",
-        CARGO_COLOR_YELLOW, CARGO_COLOR_RESET);
+    cargo_range_validation_t *vr = NULL;
+    cargo_validation_t *v = NULL;
 
-    cargo_asprintf(&s, "%shej%s\n",
-        CARGO_COLOR_YELLOW, CARGO_COLOR_RESET);
+    if (!(vr = _cargo_calloc(NULL, 1, sizeof(cargo_range_validation_t))))
+    {
+        return NULL;
+    }
 
-    cargo_assert(s, "Got NULL string");
-    _cargo_free(s);
+    if (!(v = cargo_create_validator(name,
+                                    _cargo_validate_range_cb,
+                                    NULL, type, vr)))
+    {
+        _cargo_free(NULL, vr);
+        return NULL;
+    }
 
-    ret = cargo_asprintf(&s, "");
-    cargo_assert(ret == 0, "Expected empty string");
-    cargo_assert(!strcmp(s, ""), "Expecterd empty string");
+    return v;
+}
 
-    cargo_print_ansicolor(stdout, "Test " CARGO_COLOR_RED "RED" CARGO_COLOR_RESET "\n");
+#define _CARGO_CREATE_VALIDATE_RANGE_FUNC_BODY(type, _cargo_type, _member)          \
+    cargo_range_validation_t *vr = NULL;                                            \
+    cargo_validation_t *v = NULL;                                                   \
+    if (!(v = _cargo_create_range(#type" range", _cargo_type)))                 \
+        return NULL;                                                                \
+    vr = cargo_validator_get_context(v);                                            \
+    vr->min._member = min;                                                          \
+    vr->max._member = max;                                                          \
+    vr->epsilon._member = epsilon;                                                  \
+    return v;                                                                       \
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&s);
-}
-_TEST_END()
+#define _CARGO_CREATE_VALIDATE_RANGE_FUNC(name, type, _cargo_type, _member)         \
+    cargo_validation_t *cargo_validate_##name(type min, type max)                   \
+    {                                                                               \
+        type epsilon = 0;                                                           \
+        _CARGO_CREATE_VALIDATE_RANGE_FUNC_BODY(type, _cargo_type, _member);         \
+    }
 
-_TEST_START(TEST_cargo_bool_count)
-{
-    int i = 0;
-    char *args[] = { "program ", "123", "-v", "3", "-v", "-v" };
+#define _CARGO_CREATE_VALIDATE_FLOAT_RANGE_FUNC(name, type, _cargo_type, _member)   \
+    cargo_validation_t *cargo_validate_##name(type min, type max, type epsilon)     \
+    {                                                                               \
+        _CARGO_CREATE_VALIDATE_RANGE_FUNC_BODY(type, _cargo_type, _member);         \
+    }
 
-    ret |= cargo_add_option(cargo, 0,
-                            "--verbose -v", LOREM_IPSUM, "b!", &i);
+_CARGO_CREATE_VALIDATE_RANGE_FUNC(int_range, int, CARGO_INT, i)
+_CARGO_CREATE_VALIDATE_RANGE_FUNC(uint_range, unsigned int, CARGO_UINT, u)
+_CARGO_CREATE_VALIDATE_RANGE_FUNC(longlong_range, long long int, CARGO_LONGLONG, ll)
+_CARGO_CREATE_VALIDATE_RANGE_FUNC(ulonglong_range, unsigned long long int, CARGO_ULONGLONG, ull)
+_CARGO_CREATE_VALIDATE_FLOAT_RANGE_FUNC(float_range, float, CARGO_FLOAT, f)
+_CARGO_CREATE_VALIDATE_FLOAT_RANGE_FUNC(double_range, double, CARGO_DOUBLE, d)
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
+typedef struct cargo_choices_validation_s
+{
+    cargo_type_t type;
+    size_t count;
+    char **strs;
+    cargo_vals_t *nums;
+    double epsilon;
+    cargo_validate_choices_flags_t flags;
 
-    printf("i == %d\n", i);
-    cargo_assert(i == 3, "Expected i to be 3");
+    // Index built when the validator is created. Strings are in a hash
+    // table of choice index + 1 (0 is an empty slot). Integers are
+    // sorted, floats are compared using the epsilon one at a time.
+    size_t *slots;
+    size_t slot_count;
+    unsigned int *hashes;
+    size_t *sorted;
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    // The int value for each string choice, for cargo_validate_choices_map.
+    int *map;
+} cargo_choices_validation_t;
 
-_TEST_START(TEST_cargo_bool_count_compact)
+static void _cargo_validate_choices_destroy_cb(void *user)
 {
-    int i = 0;
-    int j;
-    char *args[] = { "program ", "-vvv", "123", "-vv" };
-
-    ret |= cargo_add_option(cargo, 0, "args", LOREM_IPSUM, "i", &j);
-    ret |= cargo_add_option(cargo, 0, "--verbose -v", LOREM_IPSUM, "b!", &i);
+    cargo_choices_validation_t *vc = (cargo_choices_validation_t *)user;
 
-    cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
+    _cargo_xfree(NULL, &vc->nums);
+    _cargo_xfree(NULL, &vc->slots);
+    _cargo_xfree(NULL, &vc->hashes);
+    _cargo_xfree(NULL, &vc->sorted);
+    _cargo_xfree(NULL, &vc->map);
+    _cargo_free_str_list(NULL, &vc->strs, &vc->count);
+}
 
-    printf("i == %d\n", i);
-    cargo_assert(i == 5, "Expected i to be 5");
+static unsigned int _cargo_hash_choice(const char *s, int fold)
+{
+    // FNV-1a, case folded when not case sensitive.
+    unsigned int h = 2166136261u;
 
-    printf("j == %d\n", j);
-    cargo_assert(j == 123, "Expected j to be 123");
+    while (*s)
+    {
+        h ^= (unsigned char)(fold ? tolower((unsigned char)*s) : *s);
+        h *= 16777619u;
+        s++;
+    }
 
-    _TEST_CLEANUP();
+    return h;
 }
-_TEST_END()
 
-_TEST_START(TEST_fixed_one_or_more_array)
+static int _cargo_compare_choice_nums(cargo_type_t type,
+                                      const cargo_vals_t *a,
+                                      const cargo_vals_t *b)
 {
-    int a[4];
-    int a_expect[2] = { 1, 2 };
-    char *args[] = { "program", "--beta", "1", "2" };
-    _ADD_TEST_FIXED_ARRAY(".[i]+", "%d");
-    _TEST_CLEANUP();
+    #define _CARGO_CMP(m) (a->m < b->m) ? -1 : (a->m > b->m)
+    switch (type)
+    {
+        case CARGO_INT: return _CARGO_CMP(i);
+        case CARGO_UINT: return _CARGO_CMP(u);
+        case CARGO_LONGLONG: return _CARGO_CMP(ll);
+        case CARGO_ULONGLONG: return _CARGO_CMP(ull);
+        default: assert(0); break;
+    }
+    #undef _CARGO_CMP
+
+    return 0;
 }
-_TEST_END()
 
-_TEST_START(TEST_fixed_zero_or_more_array)
+static int _cargo_is_sorted_choice_type(cargo_type_t type)
 {
-    int a[4];
-    int a_expect[2] = { 1, 2 };
-    char *args[] = { "program", "--beta", "1", "2" };
-    _ADD_TEST_FIXED_ARRAY(".[i]*", "%d");
-    _TEST_CLEANUP();
+    return (type == CARGO_INT) || (type == CARGO_UINT)
+        || (type == CARGO_LONGLONG) || (type == CARGO_ULONGLONG);
 }
-_TEST_END()
 
-_TEST_START(TEST_fixed_fail_array)
+// Bottom-up merge sort of the choice indices by value. It is stable,
+// so the first of any duplicates is found.
+static int _cargo_sort_choices(cargo_choices_validation_t *vc)
 {
-    int i;
-    int vals[4];
-    int vals_expect[] = { 1, 2 };
-    size_t val_count = 0;
-    char *args[] = { "program ", "--alpha", "1", "2", "--beta", "4" };
+    size_t i;
+    size_t width;
+    size_t lo;
+    size_t mid;
+    size_t hi;
+    size_t a;
+    size_t b;
+    size_t k;
+    size_t *src = vc->sorted;
+    size_t *dst = NULL;
+    size_t *tmp = NULL;
 
-    ret |= cargo_add_option(cargo, 0, "--alpha", LOREM_IPSUM,
-                            ".[i]#", &vals, &val_count, 4);
-    ret |= cargo_add_option(cargo, 0, "--beta", LOREM_IPSUM, "i", &i);
+    if (!(tmp = _cargo_calloc(NULL, vc->count + 1, sizeof(size_t))))
+    {
+        CARGODBG(1, "Out of memory\n");
+        return -1;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Parse succeeded when it should fail");
+    for (i = 0; i < vc->count; i++)
+    {
+        src[i] = i;
+    }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    dst = tmp;
 
-_TEST_START(TEST_user_context)
-{
-    int i = 3;
-    cargo_set_context(cargo, &i);
-    cargo_assert(&i == cargo_get_context(cargo), "Got invalid user context");
-    cargo_assert(i == 3, "Got invalid user context value");
+    for (width = 1; width < vc->count; width *= 2)
+    {
+        for (lo = 0; lo < vc->count; lo += 2 * width)
+        {
+            mid = CARGO_MIN(lo + width, vc->count);
+            hi = CARGO_MIN(lo + 2 * width, vc->count);
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+            for (a = lo, b = mid, k = lo; k < hi; k++)
+            {
+                if ((a < mid) && ((b >= hi)
+                    || (_cargo_compare_choice_nums(vc->type,
+                            &vc->nums[src[a]], &vc->nums[src[b]]) <= 0)))
+                {
+                    dst[k] = src[a++];
+                }
+                else
+                {
+                    dst[k] = src[b++];
+                }
+            }
+        }
 
-typedef struct test_grp_ctx_s
-{
-    char name[32];
-    int val;
-} test_grp_ctx_t;
+        // The merged runs are the input of the next pass.
+        src = dst;
+        dst = (dst == tmp) ? vc->sorted : tmp;
+    }
 
-static int _test_TEST_group_user_context_cb(cargo_t ctx, void *user,
-                                const char *optname, int argc, char **argv)
-{
-    test_grp_ctx_t *grpctx = NULL;
-    test_grp_ctx_t *mgrpctx = NULL;
-    const char *group = NULL;
-    const char **mgroups = NULL;
-    size_t mgroup_count = 0;
-    cargo_cb_assert(ctx, "NULL context in callback");
+    if (src != vc->sorted)
+    {
+        memcpy(vc->sorted, src, vc->count * sizeof(size_t));
+    }
 
-    group = cargo_get_option_group(ctx, optname);
-    cargo_cb_assert(group, "Got NULL Group name");
+    _cargo_free(NULL, tmp);
+    return 0;
+}
 
-    printf("Group context callback %s: %s\n", optname, group);
+static int _cargo_build_choices_index(cargo_choices_validation_t *vc)
+{
+    size_t i;
+    size_t k;
+    size_t mask;
+    int fold = !(vc->flags & CARGO_VALIDATE_CHOICES_CASE_SENSITIVE);
 
-    grpctx = cargo_get_group_context(ctx, group);
-    cargo_cb_assert(grpctx, "Got NULL group context");
+    if (vc->type == CARGO_STRING)
+    {
+        // Never more than half full.
+        for (vc->slot_count = 8; vc->slot_count < (vc->count * 2); )
+            vc->slot_count *= 2;
 
-    printf("Group context contents: %s = %d\n", grpctx->name, grpctx->val);
+        if (!(vc->slots = _cargo_calloc(NULL, vc->slot_count, sizeof(size_t)))
+         || !(vc->hashes = _cargo_calloc(NULL, vc->count + 1, sizeof(unsigned int))))
+        {
+            CARGODBG(1, "Out of memory\n");
+            return -1;
+        }
 
-    mgroups = cargo_get_option_mutex_groups(ctx, optname, &mgroup_count);
+        mask = vc->slot_count - 1;
 
-    printf("Mutex group count for %s: %lu\n", optname, mgroup_count);
+        for (i = 0; i < vc->count; i++)
+        {
+            vc->hashes[i] = _cargo_hash_choice(vc->strs[i], fold);
 
-    if (!strcmp(optname, "--alpha"))
-    {
-        int *a = (int *)user;
-        cargo_cb_assert(a, "Got NULL user context for --alpha");
-        *a = atoi(argv[0]);
-        printf("a == %d\n", *a);
-        cargo_cb_assert(*a == 15, "Got unexpected value for --alpha");
-        cargo_cb_assert(!strcmp(group, "group1"), "Expected group1 for --alpha");
-        cargo_cb_assert(!strcmp(grpctx->name, "hello"), "Invalid group context name");
-        cargo_cb_assert(grpctx->val == 20, "Unexpected group context value");
+            for (k = vc->hashes[i] & mask; vc->slots[k]; k = (k + 1) & mask)
+            {
+            }
 
-        cargo_cb_assert(mgroup_count == 0, "Got non-zero mutex group count");
-        cargo_cb_assert(mgroups == NULL, "Got non-NULL mutex group");
+            vc->slots[k] = i + 1;
+        }
     }
-    else if (!strcmp(optname, "--delta"))
+    else if (_cargo_is_sorted_choice_type(vc->type))
     {
-        char **d = (char **)user;
-        cargo_cb_assert(d, "Got NULL user context for --delta");
-        cargo_cb_assert(*d == NULL, "Got non-NULL char pointer for --delta");
-        cargo_cb_assert(!strcmp(group, "group2"), "Expected group2 for --delta");
-        cargo_cb_assert(!strcmp(grpctx->name, "world"), "Invalid group context name");
-
-        mgrpctx = cargo_get_mutex_group_context(ctx, mgroups[0]);
-        cargo_cb_assert(mgrpctx, "Got NULL mutex group 1 context");
-        cargo_cb_assert(!strcmp(mgrpctx->name, "great"), "--delta not member of mutex group 1");
-        cargo_cb_assert(mgrpctx->val == 60, "Got unexpected mutex group 1 value");
+        if (!(vc->sorted = _cargo_calloc(NULL, vc->count + 1, sizeof(size_t))))
+        {
+            CARGODBG(1, "Out of memory\n");
+            return -1;
+        }
 
-        *d = _cargo_strdup(argv[0]);
-        cargo_cb_assert(!strcmp(*d, "bla"), "Unexpected --delta value");
-        cargo_cb_assert(grpctx->val == 40, "Unexpected group context value");
-    }
-    else
-    {
-        fprintf(stderr, "Unexpected option: %s\n", optname);
-        return -1;
+        if (_cargo_sort_choices(vc))
+        {
+            return -1;
+        }
     }
 
-    return argc;
+    return 0;
 }
 
-_TEST_START(TEST_group_user_context)
+//
+// Returns the index of the choice the value matches, or -1.
+//
+static int _cargo_find_choice(cargo_choices_validation_t *vc, void *value)
 {
-    test_grp_ctx_t group_ctx1 = { "hello", 20 };
-    test_grp_ctx_t group_ctx2 = { "world", 40 };
-    test_grp_ctx_t mgroup_ctx1 = { "great", 60 };
-    test_grp_ctx_t mgroup_ctx2 = { "work", 80 };
-    int a = 0;
-    double b = 0.0;
-    float c = 0;
-    char *d = NULL;
-    int e = 123;
-    char *args[] = { "program", "--alpha", "15", "-b", "7.0", "-c", "5", "-d", "bla" };
+    size_t i;
+    size_t k;
+    size_t lo;
+    size_t hi;
+    size_t mid;
+    int cmp;
 
-    ret |= cargo_add_mutex_group(cargo, 0, "mgroup1", "Mutex group 1", "Mutex group 1");
-    ret |= cargo_set_mutex_group_context(cargo, "mgroup1", &mgroup_ctx1);
-    cargo_assert(ret == 0, "Failed to add mutex group 1");
+    switch (vc->type)
+    {
+        case CARGO_STRING:
+        {
+            const char *str = (const char *)value;
+            int fold = !(vc->flags & CARGO_VALIDATE_CHOICES_CASE_SENSITIVE);
+            unsigned int hash = _cargo_hash_choice(str, fold);
+            size_t mask = vc->slot_count - 1;
 
-    ret |= cargo_add_mutex_group(cargo, 0, "mgroup2", "Mutex group 2", "Mutex group 2");
-    ret |= cargo_set_mutex_group_context(cargo, "mgroup2", &mgroup_ctx2);
-    cargo_assert(ret == 0, "Failed to add mutex group 2");
+            for (k = hash & mask; vc->slots[k]; k = (k + 1) & mask)
+            {
+                i = vc->slots[k] - 1;
 
-    ret |= cargo_add_group(cargo, 0, "group1", "The Group 1", "This group is 1st");
-    ret |= cargo_set_group_context(cargo, "group1", &group_ctx1);
-    cargo_assert(ret == 0, "Failed to add group");
+                if ((vc->hashes[i] == hash)
+                 && !(fold ? strcasecmp(vc->strs[i], str)
+                           : strcmp(vc->strs[i], str)))
+                {
+                    return (int)i;
+                }
+            }
+            break;
+        }
+        case CARGO_INT:
+        case CARGO_UINT:
+        case CARGO_LONGLONG:
+        case CARGO_ULONGLONG:
+        {
+            cargo_vals_t v;
+            memset(&v, 0, sizeof(v));
+            memcpy(&v, value, _cargo_get_type_size(vc->type));
 
-    ret |= cargo_add_option(cargo, 0, "<group1> --alpha -a", "Alpha Description",
-            "c", _test_TEST_group_user_context_cb, &a);
-    ret |= cargo_add_option(cargo, 0, "<group1> --beta -b", "Alpha Description", "d", &b);
-    cargo_assert(ret == 0, "Failed to add options");
+            // Finds the first of any duplicates.
+            for (lo = 0, hi = vc->count; lo < hi; )
+            {
+                mid = lo + (hi - lo) / 2;
+                cmp = _cargo_compare_choice_nums(vc->type,
+                                        &vc->nums[vc->sorted[mid]], &v);
 
-    ret |= cargo_add_group(cargo, 0, "group2", "The Group 2", LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM);
-    ret |= cargo_set_group_context(cargo, "group2", &group_ctx2);
-    cargo_assert(ret == 0, "Failed to add group");
+                if (cmp < 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
 
-    ret |= cargo_add_option(cargo, 0, "<group2> --centauri -c", "Centauri Description", "f", &c);
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1, group2> --delta -d", "Delta Description",
-            "c", _test_TEST_group_user_context_cb, &d);
-    cargo_assert(ret == 0, "Failed to add options");
+            if ((lo < vc->count)
+             && !_cargo_compare_choice_nums(vc->type,
+                                        &vc->nums[vc->sorted[lo]], &v))
+            {
+                return (int)vc->sorted[lo];
+            }
+            break;
+        }
+        case CARGO_FLOAT:
+        {
+            for (i = 0; i < vc->count; i++)
+            {
+                if (_cargo_nearly_equal(vc->nums[i].f, *((float *)value),
+                                        vc->epsilon))
+                    return (int)i;
+            }
+            break;
+        }
+        case CARGO_DOUBLE:
+        {
+            for (i = 0; i < vc->count; i++)
+            {
+                if (_cargo_nearly_equal(vc->nums[i].d, *((double *)value),
+                                        vc->epsilon))
+                    return (int)i;
+            }
+            break;
+        }
+        default:
+            break;
+    }
 
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --error -e", "Error Description", "i", &e);
-    ret |= cargo_mutex_group_add_option(cargo, "mgroup2", "--error");
-    cargo_assert(ret == 0, "Failed to add option");
+    return -1;
+}
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse");
+static void _cargo_append_choices(cargo_astr_t *str,
+                                  cargo_choices_validation_t *vc)
+{
+    size_t i;
 
-    cargo_assert(a == 15, "a unexpected");
-    cargo_assert(b == 7.0, "b unexpected");
-    cargo_assert(c == 5.0f, "c unexpected");
-    cargo_assert(!strcmp(d, "bla"), "d unexpected");
-    cargo_assert(e == 123, "e changed unexpectedly");
+    for (i = 0; i < vc->count; i++)
+    {
+        switch (vc->type)
+        {
+            case CARGO_STRING:
+                cargo_aappendf(str, "%s", vc->strs[i]);
+                break;
+            case CARGO_INT:
+                cargo_aappendf(str, "%d", vc->nums[i].i);
+                break;
+            case CARGO_UINT:
+                cargo_aappendf(str, "%u", vc->nums[i].u);
+                break;
+            case CARGO_FLOAT:
+                cargo_aappendf(str, "%.2f", vc->nums[i].f);
+                break;
+            case CARGO_DOUBLE:
+                cargo_aappendf(str, "%.2f", vc->nums[i].d);
+                break;
+            case CARGO_LONGLONG:
+                cargo_aappendf(str, "%"CARGO_LONGLONG_FMT, vc->nums[i].ll);
+                break;
+            case CARGO_ULONGLONG:
+                cargo_aappendf(str, "%"CARGO_ULONGLONG_FMT, vc->nums[i].ull);
+                break;
+            default:
+                break;
+        }
 
-    ret = cargo_set_group_context(cargo, NULL, &group_ctx1);
-    cargo_assert(ret == 0, "Failed to set group context for default group");
+        if (i + 1 < vc->count)
+        {
+            cargo_aappendf(str, ", ");
+        }
+    }
+}
 
-    cargo_assert(cargo_get_group_context(cargo, NULL) == &group_ctx1,
-        "Got different group context back for default group");
+int _cargo_validate_choices_cb(cargo_t ctx,
+                            cargo_validation_flags_t flags,
+                            const char *opt, cargo_validation_t *vd,
+                            void *value)
+{
+    cargo_choices_validation_t *vc = NULL;
+    cargo_astr_t str;
+    char *choices = NULL;
+    int case_sensitive = 0;
+    assert(ctx);
+    assert(vd);
 
-    ret = cargo_set_group_context(cargo, "unknown", &group_ctx1);
-    cargo_assert(ret != 0, "Able to set group context for un-existent group");
+    vc = (cargo_choices_validation_t *)cargo_validator_get_context(vd);
+    assert(vc);
 
-    ret = cargo_set_group_context(cargo, "unknown", &group_ctx1);
-    cargo_assert(ret != 0, "Able to set group context for un-existent group");
+    if (_cargo_find_choice(vc, value) >= 0)
+    {
+        return 0;
+    }
 
-    _TEST_CLEANUP();
-    _cargo_xfree(&d);
-}
-_TEST_END()
-
-_TEST_START(TEST_mutex_group_context_fail)
-{
-    void *user = NULL;
-    test_grp_ctx_t mgroup_ctx1 = { "hello", 20 };
-    int i = 3;
-    ret |= cargo_add_mutex_group(cargo, 0, "mgroup1", NULL, NULL);
-    ret |= cargo_set_mutex_group_context(cargo, "mgroup1", &mgroup_ctx1);
-    cargo_assert(ret == 0, "Failed to add mutex group 1");
+    // The list of choices is only needed for the error.
+    case_sensitive = vc->flags & CARGO_VALIDATE_CHOICES_CASE_SENSITIVE;
+    memset(&str, 0, sizeof(str));
+    str.s = &choices;
+    str.arena = &ctx->arena;
+    _cargo_append_choices(&str, vc);
 
-    user = cargo_get_mutex_group_context(cargo, "mgroup2");
-    cargo_assert(user == NULL, "Got non-NULL mutex group context for non-existent group");
+    cargo_set_error(ctx, 0, "The value for %s, must be one of these %s: %s",
+                    opt, case_sensitive ? "(case sensitive)" : "",
+                    choices ? choices : "");
 
-    user = cargo_get_mutex_group_context(cargo, "mgroup1");
-    cargo_assert(user == &mgroup_ctx1, "Did not get correct mutex group context");
+    return -1;
+}
 
-    _TEST_CLEANUP();
+static void _cargo_free_choices(cargo_choices_validation_t *vc,
+                                cargo_validation_t *v)
+{
+    _cargo_validate_choices_destroy_cb(vc);
+    _cargo_free(NULL, vc);
+    _cargo_free(NULL, v);
 }
-_TEST_END()
 
-_TEST_START(TEST_cargo_get_option_mutex_groups)
+static cargo_validation_t *_cargo_create_choices(
+                                        cargo_validate_choices_flags_t flags,
+                                        cargo_type_t type,
+                                        size_t count,
+                                        cargo_choices_validation_t **out)
 {
-    size_t i;
-    size_t count = 0;
-    const char **mgroups = NULL;
-    int a = 0;
+    cargo_validation_t *v = NULL;
+    cargo_choices_validation_t *vc = NULL;
 
-    ret |= cargo_add_mutex_group(cargo, 0, "mgroup1", NULL, NULL);
-    cargo_assert(ret == 0, "Failed to add mutex group 1");
+    if (!(vc = _cargo_calloc(NULL, 1, sizeof(cargo_choices_validation_t))))
+    {
+        return NULL;
+    }
 
-    ret |= cargo_add_mutex_group(cargo, 0, "mgroup2", "hello", "world");
-    cargo_assert(ret == 0, "Failed to add mutex group 2");
+    if (!(v = cargo_create_validator("choices",
+                _cargo_validate_choices_cb,
+                _cargo_validate_choices_destroy_cb,
+                (CARGO_STRING | CARGO_INT | CARGO_UINT | CARGO_FLOAT |
+                 CARGO_DOUBLE | CARGO_LONGLONG | CARGO_ULONGLONG),
+                vc)))
+    {
+        _cargo_free(NULL, vc);
+        return NULL;
+    }
 
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --alpha -a", "Error Description", "i", &a);
-    ret |= cargo_mutex_group_add_option(cargo, "mgroup2", "--alpha");
-    cargo_assert(ret == 0, "Failed to add option");
+    vc->flags = flags;
+    vc->type = type;
+    vc->count = count;
+    vc->epsilon = CARGO_DEFAULT_EPSILON;
 
-    mgroups = cargo_get_option_mutex_groups(cargo, "--alpha", &count);
-    cargo_assert(mgroups != NULL, "Got NULL mutex group list");
-    printf("Mutex group count: %lu\n", count);
+    if (vc->type == CARGO_STRING)
+    {
+        if (!(vc->strs = _cargo_calloc(NULL, vc->count + 1, sizeof(char *))))
+        {
+            CARGODBG(1, "Out of memory\n");
+            goto fail;
+        }
+    }
+    else
+    {
+        if (!(vc->nums = _cargo_calloc(NULL, vc->count + 1, sizeof(cargo_vals_t))))
+        {
+            CARGODBG(1, "Out of memory\n");
+            goto fail;
+        }
+    }
 
-    for (i = 0; i < count; i++)
+    *out = vc;
+    return v;
+fail:
+    _cargo_free_choices(vc, v);
+    return NULL;
+}
+
+cargo_validation_t *cargo_validate_choices(cargo_validate_choices_flags_t flags,
+                                            cargo_type_t type,
+                                            size_t count, ...)
+{
+    va_list ap;
+    size_t i;
+    cargo_validation_t *v = NULL;
+    cargo_choices_validation_t *vc = NULL;
+
+    if (!(v = _cargo_create_choices(flags, type, count, &vc)))
     {
-        printf("%lu: \"%s\"\n", i, mgroups[i]);
+        return NULL;
     }
 
-    cargo_assert(count == 2, "Expected 2 mutex groups");
-    cargo_assert(!strcmp(mgroups[0], "mgroup1"), "Mutex group 1 expected");
-    cargo_assert(!strcmp(mgroups[1], "mgroup2"), "Mutex group 2 expected");
+    va_start(ap, count);
 
-    // Get it twice, make sure it was cached.
-    mgroups = cargo_get_option_mutex_groups(cargo, "--alpha", &count);
+    if (vc->flags & CARGO_VALIDATE_CHOICES_SET_EPSILON)
+    {
+        vc->epsilon = va_arg(ap, double);
+    }
 
-    cargo_assert(count == 2, "Expected 2 mutex groups twice");
-    cargo_assert(!strcmp(mgroups[0], "mgroup1"), "Mutex group 1 expected");
-    cargo_assert(!strcmp(mgroups[1], "mgroup2"), "Mutex group 2 expected");
+    for (i = 0; i < vc->count; i++)
+    {
+        switch (vc->type)
+        {
+            case CARGO_STRING:
+            {
+                if (!(vc->strs[i] = _cargo_strdup(NULL, va_arg(ap, char *))))
+                {
+                    va_end(ap);
+                    goto fail;
+                }
+                break;
+            }
+            case CARGO_INT:
+            {
+                vc->nums[i].i = va_arg(ap, int);
+                break;
+            }
+            case CARGO_UINT:
+            {
+                vc->nums[i].u = va_arg(ap, unsigned int);
+                break;
+            }
+            case CARGO_FLOAT:
+            {
+                vc->nums[i].f = (float)va_arg(ap, double);
+                break;
+            }
+            case CARGO_DOUBLE:
+            {
+                vc->nums[i].d = va_arg(ap, double);
+                break;
+            }
+            case CARGO_LONGLONG:
+            {
+                vc->nums[i].ll = va_arg(ap, long long int);
+                break;
+            }
+            case CARGO_ULONGLONG:
+            {
+                vc->nums[i].ull = va_arg(ap, unsigned long long int);
+                break;
+            }
+            default:
+                break;
+        }
+    }
 
-    // Get non-existent option.
-    mgroups = cargo_get_option_mutex_groups(cargo, "--unknown", &count);
+    va_end(ap);
 
-    cargo_assert(count == 0, "Expected 0 options");
+    if (_cargo_build_choices_index(vc))
+    {
+        goto fail;
+    }
 
-    _TEST_CLEANUP();
+    return v;
+fail:
+    _cargo_free_choices(vc, v);
+    return NULL;
 }
-_TEST_END()
 
-_TEST_START(TEST_invalid_format_char)
+cargo_validation_t *cargo_validate_choices_array(
+                                        cargo_validate_choices_flags_t flags,
+                                        cargo_type_t type,
+                                        size_t count, const void *choices)
 {
-    int a = 0;
-    int *c = NULL;
-    size_t c_count = 0;
-    int d[4];
-    size_t d_count = 0;
+    size_t i;
+    size_t size = 0;
+    cargo_validation_t *v = NULL;
+    cargo_choices_validation_t *vc = NULL;
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", NULL, "p", &a);
-    cargo_assert(ret != 0, "Invalid format character allowed");
+    if (!choices && count)
+    {
+        return NULL;
+    }
 
-    ret |= cargo_add_option(cargo, 0, "--beta -b", NULL, "[i", &a);
-    cargo_assert(ret != 0, "Impartial format string allowed");
+    if (!(v = _cargo_create_choices(flags, type, count, &vc)))
+    {
+        return NULL;
+    }
 
-    ret |= cargo_add_option(cargo, 0, "--centauri -c", NULL, "[i],", &c, &c_count);
-    cargo_assert(ret != 0, "Invalid format string allowed");
+    if (vc->type == CARGO_STRING)
+    {
+        for (i = 0; i < vc->count; i++)
+        {
+            if (!(vc->strs[i] = _cargo_strdup(NULL, ((char **)choices)[i])))
+            {
+                goto fail;
+            }
+        }
+    }
+    else
+    {
+        size = _cargo_get_type_size(vc->type);
 
-    ret |= cargo_add_option(cargo, 0, "--delta -d", NULL, ".[i],", &d, &d_count);
-    cargo_assert(ret != 0, "Invalid format string allowed");
+        for (i = 0; i < vc->count; i++)
+        {
+            memcpy(&vc->nums[i], (const char *)choices + i * size, size);
+        }
+    }
 
-    ret |= cargo_add_option(cargo, 0, "--error -e", NULL, "im", &a);
-    cargo_assert(ret != 0, "Invalid format string allowed");
+    if (_cargo_build_choices_index(vc))
+    {
+        goto fail;
+    }
 
-    _TEST_CLEANUP();
+    return v;
+fail:
+    _cargo_free_choices(vc, v);
+    return NULL;
 }
-_TEST_END()
 
-_TEST_START(TEST_option_target_null)
+cargo_validation_t *cargo_validate_choices_map(
+                                        cargo_validate_choices_flags_t flags,
+                                        size_t count,
+                                        const char **choices,
+                                        const int *values)
 {
-    int a = 0;
-    int *c = NULL;
-    size_t c_count = 0;
-    int d[4];
-    size_t d_count = 0;
-
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "i", NULL);
-    cargo_assert(ret != 0, "NULL target was allowed");
+    cargo_validation_t *v = NULL;
+    cargo_choices_validation_t *vc = NULL;
 
-    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL, "[i]+", &c, NULL);
-    cargo_assert(ret != 0, "NULL target count was allowed");
+    if (!values && count)
+    {
+        return NULL;
+    }
 
-    ret = cargo_add_option(cargo, 0, "--delta -d", NULL, "[i]#", &d, NULL, 4);
-    cargo_assert(ret != 0, "NULL target count was allowed");
+    if (!(v = cargo_validate_choices_array(flags, CARGO_STRING,
+                                           count, choices)))
+    {
+        return NULL;
+    }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    vc = (cargo_choices_validation_t *)cargo_validator_get_context(v);
 
-_TEST_START(TEST_autoclean_string_list)
-{
-    size_t i;
-    char **strs = NULL;
-    size_t str_count = 0;
-    char *args[] = { "program", "--alpha", "bla", "blo", "bli" };
+    if (!(vc->map = _cargo_calloc(NULL, count + 1, sizeof(int))))
+    {
+        CARGODBG(1, "Out of memory\n");
+        _cargo_free_choices(vc, v);
+        return NULL;
+    }
 
-    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+    if (count)
+    {
+        memcpy(vc->map, values, count * sizeof(int));
+    }
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "[s]+", &strs, &str_count);
-    cargo_assert(ret == 0, "Failed to add option");
+    // The option holds the mapped value, the string is never stored.
+    v->types = CARGO_INT;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse");
-    cargo_assert(strs != NULL, "Got NULL string list");
+    return v;
+}
 
-    printf("strs: %p\n", strs);
+static const int *_cargo_get_choice_map(cargo_opt_t *opt)
+{
+    cargo_choices_validation_t *vc = NULL;
 
-    for (i = 0; i < str_count; i++)
+    if (!opt->validation
+        || (opt->validation->validator != _cargo_validate_choices_cb))
     {
-        printf("%s\n", strs[i]);
+        return NULL;
     }
 
-    _TEST_CLEANUP();
+    vc = (cargo_choices_validation_t *)opt->validation->user;
+    return vc->map;
 }
-_TEST_END()
 
-static int _test_fail_callback(cargo_t ctx, void *user, const char *optname,
-                                int argc, char **argv)
-{
-    return -1;
-}
-
-_TEST_START(TEST_fail_custom_callback)
+static int _cargo_map_choice(cargo_t ctx, cargo_opt_t *opt,
+                             const char *val, int *out)
 {
-    size_t i = 0;
-    char *args[] = { "program", "-a", "bla" };
+    int i;
+    cargo_choices_validation_t *vc = NULL;
+    assert(_cargo_get_choice_map(opt));
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "c", _test_fail_callback, &i);
-    cargo_assert(ret == 0, "Failed to add option");
+    vc = (cargo_choices_validation_t *)opt->validation->user;
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Parse expected to fail");
+    if ((i = _cargo_find_choice(vc, (void *)val)) < 0)
+    {
+        // Sets the error listing the choices.
+        _cargo_validate_option_value(ctx, opt, (void *)val);
+        return -1;
+    }
 
-    _TEST_CLEANUP();
+    *out = vc->map[i];
+    return 0;
 }
-_TEST_END()
 
-static int _test_mutex_group_usage_add_options(cargo_t cargo,
-                cargo_mutex_group_flags_t flags1,
-                cargo_mutex_group_flags_t flags2,
-                int *a, int *b, int *c, int *d)
+int cargo_add_validation(cargo_t ctx, cargo_validation_flags_t flags,
+                        const char *opt, cargo_validation_t *vd)
 {
-    int ret = 0;
-    ret |= cargo_add_mutex_group(cargo, flags1, "mgroup1", "Mutex group 1",
-            "MGROUP1_DESCRIPTION " LOREM_IPSUM);
-    ret |= cargo_add_mutex_group(cargo, flags2, "mgroup2", "Mutex group2",
-            "MGROUP2_DESCRIPTION " LOREM_IPSUM LOREM_IPSUM);
-
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --alpha -a", "Error Description", "i", a);
-    ret |= cargo_mutex_group_add_option(cargo, "mgroup2", "--alpha");
+    size_t opt_i;
+    size_t name_i;
+    cargo_opt_t *o;
+    assert(ctx);
+    assert(opt);
 
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --beta -b", LOREM_IPSUM, "i", b);
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --centauri -c", "bla bla" LOREM_IPSUM, "i", c);
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --delta -d", "bla bla" LOREM_IPSUM, "i", d);
-    ret |= cargo_mutex_group_add_option(cargo, "mgroup2", "--delta");
+    if (_cargo_is_compiled(ctx))
+        return -1;
 
-    ret |= cargo_add_option(cargo, 0, "--error -e", "AAWESOME" LOREM_IPSUM, "i", d);
-    ret |= cargo_add_option(cargo, 0, "--fail -f", "Fail " LOREM_IPSUM, "i", d);
+    if (!vd)
+    {
+        CARGODBG(1, "Got NULL validation for options \"%s\"\n", opt);
+        return -1;
+    }
 
-    return ret;
-}
+    if (!(vd->validator))
+    {
+        CARGODBG(1, "Validation missing validator function for \"%s\"\n", opt);
+        goto fail;
+    }
 
-_TEST_START(TEST_mutex_group_usage)
-{
-    int a;
-    int b;
-    int c;
-    int d;
-    const char *s = NULL;
+    if (_cargo_find_option_name(ctx, opt, &opt_i, &name_i))
+    {
+        CARGODBG(1, "Failed to find option \"%s\"\n", opt);
+        goto fail;
+    }
 
-    ret = _test_mutex_group_usage_add_options(cargo, 0, 0, &a, &b, &c, &d);
-    cargo_assert(ret == 0, "Failed to add options");
+    o = &ctx->options[opt_i];
 
-    cargo_print_usage(cargo, 0);
+    if (!(o->type & vd->types))
+    {
+        CARGODBG(1, "\"%s\" of type \"%s\" is not supported by the validation %s\n",
+                opt, _cargo_type_to_str(o->type), vd->name);
+        goto fail;
+    }
 
-    s = cargo_get_usage(cargo, 0);
-    cargo_assert(s, "Got NULL usage");
-    cargo_assert(!strstr(s, "MGROUP1_DESCRIPTION"),
-        "MGROUP2_DESCRIPTION should not show by default");
-    cargo_assert(!strstr(s, "MGROUP2_DESCRIPTION"),
-        "MGROUP2_DESCRIPTION should not show by default");
-    cargo_assert(strstr(s, "--alpha"), "Missing --alpha");
-    cargo_assert(strstr(s, "--beta"), "Missing --beta");
-    cargo_assert(strstr(s, "--centauri"), "Missing --centauri");
-    cargo_assert(strstr(s, "--delta"), "Missing --delta");
+    // A choices map looks up each argument as a whole.
+    if ((vd->validator == _cargo_validate_choices_cb)
+        && ((cargo_choices_validation_t *)vd->user)->map
+        && (o->delimiter || o->bitmap))
+    {
+        CARGODBG(1, "\"%s\" cannot use a choices map with a delimited "
+                    "or range list\n", opt);
+        goto fail;
+    }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    // Remove current validation.
+    _cargo_option_destroy_validation(o);
 
-_TEST_START(TEST_mutex_group_usage2)
-{
-    int a;
-    int b;
-    int c;
-    int d;
-    const char *s = NULL;
+    // We have a reference count so that
+    // multiple options can use the same validation.
+    vd->ref_count++;
+    o->validation = vd;
+    o->validation_flags = flags;
 
-    ret = _test_mutex_group_usage_add_options(cargo,
-            CARGO_MUTEXGRP_ONE_REQUIRED |
-            CARGO_MUTEXGRP_NO_GROUP_SHORT_USAGE |
-            CARGO_MUTEXGRP_GROUP_USAGE,
-            0, &a, &b, &c, &d);
-    cargo_assert(ret == 0, "Failed to add options");
+    // The built-in range validations are checked inline
+    // instead of calling the validation for each value.
+    if (vd->validator == _cargo_validate_range_cb)
+    {
+        o->range = (cargo_range_validation_t *)vd->user;
+    }
 
-    cargo_print_usage(cargo, 0);
+    return 0;
+fail:
+    // Only a validation that was never added is ours to free. One that is
+    // already used by another option must stay alive for that option.
+    if (vd->ref_count == 0)
+        _cargo_free_validation(&vd);
+    return -1;
+}
 
-    s = cargo_get_usage(cargo, 0);
-    cargo_assert(s, "Got NULL usage");
-    cargo_assert(strstr(s, "MGROUP1_DESCRIPTION"),
-        "MGROUP1_DESCRIPTION should be shown when grouped");
-    cargo_assert(!strstr(s, "MGROUP2_DESCRIPTION"),
-        "MGROUP2_DESCRIPTION should not show by default");
+void cargo_free_commandline(char ***argv, int argc)
+{
+    size_t i;
+    assert(argv);
 
-    s = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
-    cargo_assert(strstr(s, "--alpha"), "Missing --alpha");
-    cargo_assert(strstr(s, "--beta"), "Missing --beta");
-    cargo_assert(strstr(s, "--centauri"), "Missing --centauri");
-    cargo_assert(strstr(s, "--delta"), "Missing --delta");
+    if (*argv)
+    {
+        for (i = 0; i < (size_t)argc; i++)
+        {
+            _cargo_xfree(NULL, &((*argv)[i]));
+        }
 
-    _TEST_CLEANUP();
+        _cargo_xfree(NULL, argv);
+    }
 }
-_TEST_END()
 
-_TEST_START(TEST_mutex_group_usage3)
+char **cargo_split_commandline(cargo_splitcmd_flags_t flags, const char *cmdline, int *argc)
 {
-    int a;
-    int b;
-    int c;
-    int d;
-    const char *s = NULL;
+    int i;
+    char **argv = NULL;
+    assert(argc);
 
-    ret = _test_mutex_group_usage_add_options(cargo,
-            CARGO_MUTEXGRP_ONE_REQUIRED |
-            CARGO_MUTEXGRP_NO_GROUP_SHORT_USAGE |
-            CARGO_MUTEXGRP_GROUP_USAGE,
-            CARGO_MUTEXGRP_GROUP_USAGE |
-            CARGO_MUTEXGRP_RAW_DESCRIPTION, &a, &b, &c, &d);
-    cargo_assert(ret == 0, "Failed to add options");
+    if (!cmdline)
+    {
+        CARGODBG(1, "Got NULL input\n");
+        return NULL;
+    }
 
-    cargo_print_usage(cargo, 0);
+    // Posix.
+    #ifndef _WIN32
+    {
+        int ret;
+        wordexp_t p;
+        memset(&p, 0, sizeof(p));
 
-    s = cargo_get_usage(cargo, 0);
-    cargo_assert(strstr(s, "MGROUP1_DESCRIPTION"),
-        "MGROUP1_DESCRIPTION should be shown when grouped");
-    cargo_assert(strstr(s, "MGROUP2_DESCRIPTION"),
-        "MGROUP2_DESCRIPTION should be shown when grouped");
+        // Note! This expands shell variables.
+        if ((ret = wordexp(cmdline, &p, 0)))
+        {
+            CARGODBG(1, "wordexp error %d: '%s'\n", ret, cmdline);
+            return NULL;
+        }
 
-    s = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
-    cargo_assert(strstr(s, "--alpha"), "Missing --alpha");
-    cargo_assert(strstr(s, "--beta"), "Missing --beta");
-    cargo_assert(strstr(s, "--centauri"), "Missing --centauri");
-    cargo_assert(strstr(s, "--delta"), "Missing --delta");
+        *argc = p.we_wordc;
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+        if (!(argv = _cargo_calloc(NULL, *argc, sizeof(char *))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            goto fail;
+        }
 
-_TEST_START(TEST_mutex_group_usage_set_metavar)
-{
-    int a;
-    int b;
-    int c;
-    int d;
-    const char *s = NULL;
+        for (i = 0; i < p.we_wordc; i++)
+        {
+            if (!(argv[i] = _cargo_strdup(NULL, p.we_wordv[i])))
+            {
+                CARGODBG(1, "Out of memory!\n");
+                goto fail;
+            }
+        }
 
-    ret = _test_mutex_group_usage_add_options(cargo,
-            CARGO_MUTEXGRP_ONE_REQUIRED |
-            CARGO_MUTEXGRP_GROUP_USAGE,
-            CARGO_MUTEXGRP_GROUP_USAGE |
-            CARGO_MUTEXGRP_RAW_DESCRIPTION, &a, &b, &c, &d);
-    cargo_assert(ret == 0, "Failed to add options");
+        // wordfree seems to fail to free everything in the wordexp_t struct
+        // at least on OSX 10.9.5. This is supposed to help on 10.8.5 at least.
+        p.we_offs = 0;
+        wordfree(&p);
 
-    ret = cargo_mutex_group_set_metavar(cargo, "mgroup1", "MUTEX");
-    cargo_assert(ret == 0, "Failed to set mutex group metavar");
+        return argv;
+    fail:
+        p.we_offs = 0;
+        wordfree(&p);
+    }
+    #else // WIN32
+    {
+        // TODO: __getmainargs is an alternative... https://msdn.microsoft.com/en-us/library/ff770599.aspx
+        wchar_t **wargs = NULL;
+        size_t needed = 0;
+        wchar_t *cmdlinew = NULL;
+        size_t len = strlen(cmdline) + 1;
 
-    cargo_print_usage(cargo, 0);
+        if (!(cmdlinew = _cargo_calloc(NULL, len, sizeof(wchar_t))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            goto fail;
+        }
 
-    s = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
-    cargo_assert(s, "Got NULL short usage");
-    cargo_assert(strstr(s, "MUTEX"), "Expected to find mutex group metavar");
-    cargo_assert(!strstr(s, "--beta"), "--beta should be hidden");
-    cargo_assert(!strstr(s, "--centauri"), "--centauri should be hidden");
+        if (!MultiByteToWideChar(CP_ACP, 0, cmdline, -1, cmdlinew, len))
+        {
+            CARGODBG(1, "Failed to convert to unicode!\n");
+            goto fail;
+        }
 
-    // Try to set for non-existing mutex group.
-    ret = cargo_mutex_group_set_metavar(cargo, "mgroup3", "MUTEX");
-    cargo_assert(ret != 0, "Succeeded to set metavar on invalid mutex group");
-
-    _TEST_CLEANUP();
-}
-_TEST_END()
-
-_TEST_START(TEST_dummy_callback)
-{
-    size_t i = 0;
-    char *args[] = { "program", "-a", "bla" };
-
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "D");
-    cargo_assert(ret == 0, "Failed to add option");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
+        if (!(wargs = CommandLineToArgvW(cmdlinew, argc)))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            goto fail;
+        }
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
+        if (!(argv = _cargo_calloc(NULL, *argc, sizeof(char *))))
+        {
+            CARGODBG(1, "Out of memory!\n");
+            goto fail;
+        }
 
-_TEST_START(TEST_group_add_missing_group)
-{
-    int i = 0;
-    int *j = NULL;
-    size_t j_count = 0;
-    char *args[] = { "program", "-a", "bla" };
+        // Convert from wchar_t * to ANSI char *
+        for (i = 0; i < *argc; i++)
+        {
+            // Get the size needed for the target buffer.
+            // CP_ACP = Ansi Codepage.
+            needed = WideCharToMultiByte(CP_ACP, 0, wargs[i], -1,
+                                        NULL, 0, NULL, NULL);
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "i", &i);
-    cargo_assert(ret == 0, "Failed to add option");
+            if (!(argv[i] = _cargo_malloc(NULL, needed)))
+            {
+                CARGODBG(1, "Out of memory!\n");
+                goto fail;
+            }
 
-    // Add to non-existent group.
-    ret = cargo_group_add_option(cargo, "group1", "--alpha");
-    cargo_assert(ret != 0, "Able to add option to non-existent group");
+            // Do the conversion.
+            needed = WideCharToMultiByte(CP_ACP, 0, wargs[i], -1,
+                                        argv[i], needed, NULL, NULL);
+        }
 
-        // Add non-existent option to non-existent group.
-    ret = cargo_group_add_option(cargo, "group1", "--beta");
-    cargo_assert(ret != 0, "Able to add non-existent option to non-existent group");
+        if (wargs) LocalFree(wargs);
+        _cargo_xfree(NULL, &cmdlinew);
+        return argv;
 
-    ret = cargo_add_group(cargo, CARGO_GROUP_RAW_DESCRIPTION,
-            "group1", "The Group 1", "This group is 1st");
-    cargo_assert(ret == 0, "Failed to add group");
+    fail:
+        if (wargs) LocalFree(wargs);
+        _cargo_xfree(NULL, &cmdlinew);
+    }
+    #endif // WIN32
 
-    // Add non-existent option to group.
-    ret = cargo_group_add_option(cargo, "group1", "--beta");
-    cargo_assert(ret != 0, "Able to add non-existent option to group");
+    if (argv)
+    {
+        for (i = 0; i < *argc; i++)
+        {
+            _cargo_xfree(NULL, &argv[i]);
+        }
 
-    ret = cargo_add_group(cargo, 0, "group2", "The Group 2", "This group is 2nd");
-    cargo_assert(ret == 0, "Failed to add second group");
+        _cargo_free(NULL, argv);
+    }
 
-    ret = cargo_group_add_option(cargo, "group1", "--alpha");
-    cargo_assert(ret == 0, "Failed to add option to first group");
-    ret = cargo_group_add_option(cargo, "group2", "--alpha");
-    cargo_assert(ret != 0, "Able to add option to second group");
+    return NULL;
+}
 
-    ret = cargo_add_option(cargo, 0, "<group1> --beta -b", LOREM_IPSUM, "i", &i);
-    cargo_assert(ret == 0, "Failed to add option");
+const char *cargo_get_version()
+{
+    return CARGO_VERSION_STR;
+}
 
-    cargo_print_usage(cargo, 0);
+void cargo_set_context(cargo_t ctx, void *user)
+{
+    assert(ctx);
+    ctx->user = user;
+}
 
-    ret = cargo_add_option(cargo, 0, "<group1 --centauri -c", LOREM_IPSUM, "i", &i);
-    cargo_assert(ret != 0, "Succesfully added invalid option with invalid group");
+void *cargo_get_context(cargo_t ctx)
+{
+    assert(ctx);
+    return ctx->user;
+}
 
-    ret = cargo_add_option(cargo, 0, "", LOREM_IPSUM, "i", &i);
-    cargo_assert(ret != 0, "Succesfully added option with empty name");
+int cargo_set_group_context(cargo_t ctx, const char *group, void *user)
+{
+    if (!group) group = "";
+    return _cargo_set_group_context(ctx, group,
+                ctx->groups, ctx->group_count, user);
+}
 
-    ret = cargo_add_option(cargo, 0, "<group1>", LOREM_IPSUM, "i", &i);
-    cargo_assert(ret != 0, "Succesfully added option with empty name");
+void *cargo_get_group_context(cargo_t ctx, const char *group)
+{
+    if (!group) group = "";
+    return _cargo_get_group_context(ctx, group, ctx->groups, ctx->group_count);
+}
 
-    ret = cargo_add_option(cargo, 0, "--delta", LOREM_IPSUM, "[i]#", &j, &j_count, -5);
-    cargo_assert(ret != 0, "Succesfully added option with nargs = -5");
+int cargo_set_mutex_group_context(cargo_t ctx, const char *mutex_group, void *user)
+{
+    assert(mutex_group);
+    return _cargo_set_group_context(ctx, mutex_group,
+                ctx->mutex_groups, ctx->mutex_group_count, user);
+}
 
-    ret = cargo_add_option(cargo, 0, "--unicorn u", LOREM_IPSUM, "i", &i);
-    cargo_assert(ret != 0, "Succesfully added option with invalid alias");
+void *cargo_get_mutex_group_context(cargo_t ctx, const char *mutex_group)
+{
+    assert(mutex_group);
+    return _cargo_get_group_context(ctx, mutex_group,
+                ctx->mutex_groups, ctx->mutex_group_count);
+}
 
-    _TEST_CLEANUP();
+const char *cargo_get_option_group(cargo_t ctx, const char *opt)
+{
+    return _cargo_option_get_group(ctx, opt, ctx->groups, ctx->group_count);
 }
-_TEST_END()
 
-_TEST_START(TEST_bool_acc_or)
+const char **cargo_get_option_mutex_groups(cargo_t ctx,
+                                            const char *opt, size_t *count)
 {
-    unsigned int a = 0;
-    unsigned int b = 0;
-    unsigned int c = 0;
-    unsigned int expected_bits = 0;
-    char *args[] = { "program", "-a", "-b", "-b", "123", "-ccc", "-b"};
+    size_t i;
+    cargo_opt_t *o = NULL;
+    cargo_group_t *mgrp = NULL;
+    size_t opt_i;
+    assert(ctx);
+    assert(opt);
 
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL,
-            "b|", &a, 1, (1 << 1));
-    cargo_assert(ret == 0, "Failed to add option");
+    if (count) *count = 0;
 
-    ret = cargo_add_option(cargo, 0, "--beta -b", NULL,
-            "b|", &b, 2, (1 << 1), (1 << 2));
-    cargo_assert(ret == 0, "Failed to add option");
+    if (_cargo_find_option_name(ctx, opt, &opt_i, NULL))
+    {
+        CARGODBG(1, "No such option \"%s\"\n", opt);
+        return NULL;
+    }
 
-    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL,
-            "b|", &c, 3, (1 << 1), (1 << 2), (1 << 5));
-    cargo_assert(ret == 0, "Failed to add option");
+    o = &ctx->options[opt_i];
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
+    // Use cached version. Mutex group count should
+    // not be changed between calls anyway.
+    if (o->mutex_group_names)
+    {
+        if (count) *count = o->mutex_group_count;
+        return (const char **)o->mutex_group_names;
+    }
 
-    expected_bits = (1 << 1);
-    printf("a = Expect: 0x%x Got: 0x%x\n", expected_bits, a);
-    cargo_assert((a & expected_bits) == expected_bits, "Expected bit 1 to be set");
-    cargo_assert((a ^ expected_bits) == 0, "Expected no other bit than 1 to be set");
+    if (!(o->mutex_group_names = _cargo_calloc(&ctx->mem, o->mutex_group_count, sizeof(char *))))
+    {
+        CARGODBG(1, "Out of memory\n");
+        return NULL;
+    }
 
-    // We have 3 occurrances of "-b" but only 2 bits should still be set.
-    expected_bits = (1 << 1) | (1 << 2);
-    printf("b = Expect: 0x%x Got: 0x%x\n", expected_bits, b);
-    cargo_assert((b & (expected_bits)) == expected_bits, "Expected bit 1 and 2 to be set");
-    cargo_assert((b ^ (expected_bits)) == 0, "Expected no other bit than 1 and 2 to be set");
+    for (i = 0; i < o->mutex_group_count; i++)
+    {
+        mgrp = &ctx->mutex_groups[o->mutex_group_idxs[i]];
+        o->mutex_group_names[i] = _cargo_strdup(&ctx->mem, mgrp->name);
+    }
 
-    expected_bits = (1 << 1) | (1 << 2) | (1 << 5);
-    printf("c = Expect: 0x%x Got: 0x%x\n", expected_bits, c);
-    cargo_assert((c & expected_bits) == expected_bits, "Expected bit 1, 2 and 5 to be set");
-    cargo_assert((c ^ expected_bits) == 0, "Expected no other bit than 1, 2 and 5 to be set");
+    if (count) *count = o->mutex_group_count;
 
-    _TEST_CLEANUP();
+    if (o->mutex_group_count == 0)
+    {
+        return NULL;
+    }
+
+    return (const char **)o->mutex_group_names;
 }
-_TEST_END()
 
-_TEST_START(TEST_bool_acc_and)
+cargo_type_t cargo_get_option_type(cargo_t ctx, const char *opt)
 {
-    unsigned int a = -1;
-    unsigned int b = -1;
-    unsigned int c = -1;
-    unsigned int expected_bits = 0;
-    char *args[] = { "program", "-a", "-b", "-b", "123", "-ccc", "-b"};
-
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL,
-            "b&", &a, 1, (1 << 1));
-    cargo_assert(ret == 0, "Failed to add option");
-
-    ret = cargo_add_option(cargo, 0, "--beta -b", NULL,
-            "b&", &b, 2, ((1 << 1) | (1 << 2) | (1 << 3)), (1 << 2));
-    cargo_assert(ret == 0, "Failed to add option");
+    cargo_opt_t *o = NULL;
+    size_t opt_i;
+    assert(ctx);
+    assert(opt);
 
-    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL,
-            "b&", &c, 2, (1 << 1) | (1 << 2) | (1 << 5),  (1 << 1) | (1 << 5));
-    cargo_assert(ret == 0, "Failed to add option");
+    if (_cargo_find_option_name(ctx, opt, &opt_i, NULL))
+    {
+        CARGODBG(1, "No such option \"%s\"\n", opt);
+        return -1;
+    }
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
+    o = &ctx->options[opt_i];
 
-    expected_bits = (1 << 1);
-    printf("a = Expect: 0x%x Got: 0x%x\n", expected_bits, a);
-    cargo_assert((a & expected_bits) == expected_bits, "Expected no bit to be set");
-    cargo_assert((a ^ expected_bits) == 0, "Expected no other bit than 1 to be set");
+    return o->type;
+}
 
-    expected_bits = (1 << 2);
-    printf("b = Expect: 0x%x Got: 0x%x\n", expected_bits, b);
-    cargo_assert((b & (expected_bits)) == expected_bits, "Expected bit 2 to be set");
-    cargo_assert((b ^ (expected_bits)) == 0, "Expected no other bit than 2 to be set");
+#endif // !CARGO_NOLIB
 
-    expected_bits = (1 << 1) | (1 << 5);
-    printf("c = Expect: 0x%x Got: 0x%x\n", expected_bits, c);
-    cargo_assert((c & expected_bits) == expected_bits, "Expected bit 1 and 5 to be set");
-    cargo_assert((c ^ expected_bits) == 0, "Expected no other bit than 1 and 5 to be set");
+// -----------------------------------------------------------------------------
+// Tests.
+// -----------------------------------------------------------------------------
+// LCOV_EXCL_START
+#ifdef CARGO_TEST
 
-    _TEST_CLEANUP();
-}
-_TEST_END()
-
-_TEST_START(TEST_bool_acc_plus)
-{
-    unsigned int a = 0;
-    unsigned int b = 0;
-    unsigned int c = 0;
-    char *args[] = { "program", "-a", "-b", "-b", "123", "-ccc", "-b"};
-
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL,
-            "b+", &a, 1, 1);
-    cargo_assert(ret == 0, "Failed to add option");
+#define LOREM_IPSUM                                                         \
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do"       \
+    " eiusmod tempor incididunt ut labore et dolore magna aliqua. "         \
+    "Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris "   \
+    "nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in "    \
+    "reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla "  \
+    "pariatur. Excepteur sint occaecat cupidatat non proident, sunt in "    \
+    "culpa qui officia deserunt mollit anim id est laborum."
 
-    ret = cargo_add_option(cargo, 0, "--beta -b", NULL,
-            "b+", &b, 2, 1, 2);
-    cargo_assert(ret == 0, "Failed to add option");
 
-    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL,
-            "b+", &c, 3, 1, 2, 3);
-    cargo_assert(ret == 0, "Failed to add option");
+#define cargo_assert(test, message) \
+do                                  \
+{                                   \
+    if (!(test))                    \
+    {                               \
+        msg = message;              \
+        goto fail;                  \
+    }                               \
+} while (0)
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
+// Used for asserting in custom callbacks.
+#define cargo_cb_assert(cond, msg)      \
+do                                      \
+{                                       \
+    if (!(cond))                        \
+    {                                   \
+        fprintf(stderr, "%s\n", msg);   \
+        return -1;                      \
+    }                                   \
+} while (0);
 
-    printf("a = Expect: %u Got: %u\n", 1, a);
-    cargo_assert(a == 1, "Expected a == 1");
+#define cargo_assert_array(count, expected_count, array, array_expected)    \
+do                                                                          \
+{                                                                           \
+    size_t k;                                                               \
+    printf("Check that \""#array"\" has "#expected_count" elements\n");     \
+    cargo_assert((count) == (expected_count),                               \
+        #array" array count "#count" is not expected "#expected_count);     \
+    for (k = 0; k < (count); k++)                                           \
+    {                                                                       \
+        cargo_assert((array)[k] == (array_expected)[k],                     \
+            "Array contains unexpected value");                             \
+    }                                                                       \
+} while (0)
 
-    printf("b = Expect: %u Got: %u\n", (1 + 2), b);
-    cargo_assert(b == (1 + 2), "Expected b == 3");
+#define cargo_assert_str_array(count, expected_count, array, array_expected)    \
+do                                                                              \
+{                                                                               \
+    size_t k;                                                                   \
+    printf("Check that \""#array"\" has "#expected_count" elements\n");         \
+    cargo_assert((count) == (expected_count),                                   \
+        #array" array count "#count" is not expected "#expected_count);         \
+    for (k = 0; k < count; k++)                                                 \
+    {                                                                           \
+        printf("  %lu: \"%s\" -> \"%s\"\n",                                     \
+            k+1, (char *)(array)[k], (char *)(array_expected)[k]);              \
+        cargo_assert(!strcmp((char *)(array)[k], (char *)(array_expected)[k]),  \
+            "Array contains unexpected value");                                 \
+    }                                                                           \
+} while (0)
 
-    printf("c = Expect: %u Got: %u\n", (1 + 2 + 3), c);
-    cargo_assert(c == (1 + 2 + 3), "Expected c == 6");
+static int malloc_fail_count;
+static int malloc_current;
+static int realloc_fail_count;
+static int realloc_current;
 
-    _TEST_CLEANUP();
+void _cargo_test_set_malloc_fail_count(int count)
+{
+    malloc_current = 0;
+    malloc_fail_count = count;
 }
-_TEST_END()
 
-_TEST_START(TEST_bool_acc_store)
+void *_cargo_test_malloc(size_t sz)
 {
-    unsigned int a = 0;
-    unsigned int b = 0;
-    unsigned int c = 0;
-    char *args[] = { "program", "-a", "-b", "-b", "123", "-ccc", "-b"};
-
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL,
-            "b_", &a, 1, 40);
-    cargo_assert(ret == 0, "Failed to add option");
-
-    ret = cargo_add_option(cargo, 0, "--beta -b", NULL,
-            "b_", &b, 2, 33, 44);
-    cargo_assert(ret == 0, "Failed to add option");
-
-    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL,
-            "b_", &c, 3, 11, 22, 33);
-    cargo_assert(ret == 0, "Failed to add option");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
-
-    printf("a = Expect: %u Got: %u\n", 40, a);
-    cargo_assert(a == 40, "Expected a == 40");
+    malloc_current++;
 
-    printf("b = Expect: %u Got: %u\n", 44, b);
-    cargo_assert(b == 44, "Expected b == 44");
+    if ((malloc_fail_count > 0)
+        && (malloc_current >= malloc_fail_count))
+        return NULL;
 
-    printf("c = Expect: %u Got: %u\n", 33, c);
-    cargo_assert(c == 33, "Expected c == 33");
+    return malloc(sz);
+}
 
-    _TEST_CLEANUP();
+void _cargo_test_set_realloc_fail_count(int count)
+{
+    realloc_current = 0;
+    realloc_fail_count = count;
 }
-_TEST_END()
 
-static char *_test_mutex_order_group(cargo_t cargo, cargo_mutex_group_flags_t flags,
-                                     int args1_expect, int args2_expect)
+void *_cargo_test_realloc(void *ptr, size_t sz)
 {
-    char *msg = NULL;
-    int ret = 0;
-    int a = 0;
-    int b = 0;
-    int c = 0;
-    int d = 0;
-    int e = 0;
-    int f = 0;
-    char *args1[] = { "program", "--alpha", "--beta", "--centauri", "--error" };
-    char *args2[] = { "program", "--fail", "--beta", "--centauri", "--alpha", "--error" };
+    realloc_current++;
 
-    ret = cargo_add_mutex_group(cargo, flags, "mgroup1", "Mutex group 1",
-            "MGROUP1_DESCRIPTION " LOREM_IPSUM);
+    if ((realloc_fail_count > 0)
+        && (realloc_current >= realloc_fail_count))
+        return NULL;
 
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --alpha -a", "Error Description", "b", &a);
+    return realloc(ptr, sz);
+}
 
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --beta -b", LOREM_IPSUM, "b", &b);
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --centauri -c", "bla bla" LOREM_IPSUM, "b", &c);
-    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --delta -d", "bla bla" LOREM_IPSUM, "b", &d);
+//
+// Some helper macros for creating test functions.
+//
+#define _MAKE_TEST_FUNC_NAME(f) f()
 
-    ret |= cargo_add_option(cargo, 0, "--error -e", "AAWESOME" LOREM_IPSUM, "b", &d);
-    ret |= cargo_add_option(cargo, 0, "--fail -f", "Fail " LOREM_IPSUM, "b", &d);
+// Start a test. Initializes the lib.
+#define _TEST_START_EX(testname, flags)                 \
+static const char *_MAKE_TEST_FUNC_NAME(testname)       \
+{                                                       \
+    const char *msg = NULL;                             \
+    int ret = 0;                                        \
+    cargo_t cargo;                                      \
+                                                        \
+    if (cargo_init(&cargo, flags, "program"))           \
+    {                                                   \
+        return "Failed to init cargo";                  \
+    }
 
-    cargo_assert(ret == 0, "Failed to add options");
+#define _TEST_START(testname) _TEST_START_EX(testname, 0)
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
-    cargo_assert(ret == args1_expect, "Unexpected result on parse");
+// Cleanup point, must be placed at the end of the test
+//
+// scope _TEST_START(name) { ... _TEST_CLEANUP(); free(something) } _TEST_END()
+//
+// cargo_assert jumps to this point on failure. Any cleanup should be
+// placed after this call.
+#define _TEST_CLEANUP()     \
+    fail: (void)0
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
-    cargo_assert(ret == args2_expect, "Unexpected result on parse");
-fail:
-    return msg;
+#define _TEST_END()         \
+    cargo_destroy(&cargo);  \
+    return msg;             \
 }
 
-_TEST_START(TEST_mutex_order_group_before)
-{
-    printf("Test order before:\n");
-    msg = _test_mutex_order_group(cargo,
-            CARGO_MUTEXGRP_ORDER_BEFORE, CARGO_PARSE_MUTEX_CONFLICT_ORDER, 0);
+// For tests where we want to assert after
+// cargo_destroy has been called.
+#define _TEST_END_NODESTROY()   \
+    return msg;                 \
 }
-_TEST_END()
 
-_TEST_START(TEST_mutex_order_group_after)
-{
-    printf("Test order after:\n");
-    msg = _test_mutex_order_group(cargo,CARGO_MUTEXGRP_ORDER_AFTER, 0,
-            CARGO_PARSE_MUTEX_CONFLICT_ORDER);
-}
-_TEST_END()
+// =================================================================
+// Test functions.
+// =================================================================
 
-_TEST_START(TEST_medium_length_usage)
+_TEST_START(TEST_no_args_bool_option)
 {
-    ret |= cargo_add_option(cargo, 0, "--alpha",
-                            "Hello there\n"
-                            "This isn't very long!", "D");
-    cargo_assert(ret == 0, "Failed to add options");
-    cargo_print_usage(cargo, 0);
+    int a;
+    char *args[] = { "program", "--alpha" };
+    int argc = sizeof(args) / sizeof(args[0]);
 
-    cargo_assert(strstr(cargo_get_usage(cargo, 0), "   This isn't"),
-                "Medium length usage not indented properly");
+    ret = cargo_add_option(cargo, 0, "--alpha", "Description", "b", &a);
+    cargo_assert(ret == 0, "Failed to add valid bool option");
+
+    if (cargo_parse(cargo, 0, 1, argc, args))
+    {
+        msg = "Failed to parse bool with no argument";
+        goto fail;
+    }
+
+    cargo_assert(a == 1, "Failed to parse bool with no argument to 1");
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_get_unknown_copy)
-{
-    size_t unknown_count = 0;
-    char **unknowns = NULL;
-    int a = 0;
-    char *args[] = { "--beta", "--alpha", "--centauri", "--delta" };
-    char *unknown_expect[] = { "--beta", "--centauri", "--delta" };
-
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == -1, "Expected fail on unknown options");
-
-    cargo_assert(cargo_get_error(cargo) != NULL, "Got NULL error");
-
-    unknowns = cargo_get_unknown_copy(cargo, &unknown_count);
-
-    cargo_assert_str_array(unknown_count,
-        sizeof(unknown_expect) / sizeof(unknown_expect[0]),
-        unknowns, unknown_expect);
+//
+// Simple add option tests.
+//
+#define _TEST_ADD_SIMPLE_OPTION(name, type, value, fmt, ...)                \
+    _TEST_START(name)                                                       \
+    {                                                                       \
+        char *args[] = { "program", "--alpha", #value };                    \
+        type a;                                                             \
+        ret = cargo_add_option(cargo, 0, "--alpha -a",                      \
+                                "Description",                              \
+                                fmt,                                        \
+                                &a, ##__VA_ARGS__);                         \
+        cargo_assert(ret == 0, "Failed to add valid "#type" option");       \
+        if (cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args)) \
+        {                                                                   \
+            msg = "Failed to parse "#type" with value \""#value"\"";        \
+            goto fail;                                                      \
+        }                                                                   \
+        printf("Attempt to parse value: "#value"\n");                       \
+        cargo_assert(a == value, "Failed to parse correct value "#value);   \
+        _TEST_CLEANUP();                                                    \
+    }                                                                       \
+    _TEST_END()
+
+_TEST_ADD_SIMPLE_OPTION(TEST_add_integer_option, int, -3, "i")
+_TEST_ADD_SIMPLE_OPTION(TEST_add_uinteger_option, unsigned int, 3, "u")
+_TEST_ADD_SIMPLE_OPTION(TEST_add_float_option, float, 0.3f, "f")
+_TEST_ADD_SIMPLE_OPTION(TEST_add_bool_option, int, 1, "b")
+_TEST_ADD_SIMPLE_OPTION(TEST_add_double_option, double, 0.4, "d")
+
+_TEST_START(TEST_add_static_string_option)
+{
+    char b[10];
+    char *args[] = { "program", "--beta", "abc" };
+    ret = cargo_add_option(cargo, 0, "--beta -b",
+                            "Description",
+                            ".s#",
+                            &b, sizeof(b));
+    cargo_assert(ret == 0, "Failed to add valid static string option");
 
+    if (cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args))
+    {
+        msg = "Failed to parse static char * with value \"abc\"";
+        goto fail;
+    }
+    printf("Attempt to parse value: abc\n");
+    cargo_assert(!strcmp(b, "abc"), "Failed to parse correct value abc");
     _TEST_CLEANUP();
-    _cargo_free_str_list(&unknowns, &unknown_count);
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_get_args_copy)
+_TEST_START(TEST_add_alloc_string_option)
 {
-    size_t extra_args_count = 0;
-    char **extra_args = NULL;
-    int a = 0;
-    char *args[] = { "--beta", "123", "--alpha", "--centauri", "beep", "--delta" };
-    char *extra_expect[] = { "--beta", "123", "--centauri", "beep", "--delta" };
-
-    cargo_set_flags(cargo, CARGO_NO_FAIL_UNKNOWN);
-
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse");
-
-    extra_args = cargo_get_args_copy(cargo, &extra_args_count);
+    char *b = NULL;
+    char *args[] = { "program", "--beta", "abc" };
+    ret = cargo_add_option(cargo, 0, "--beta -b",
+                            "Description",
+                            "s",
+                            &b);
+    cargo_assert(ret == 0, "Failed to add valid alloc string option");
 
-    cargo_assert_str_array(extra_args_count,
-        sizeof(extra_expect) / sizeof(extra_expect[0]),
-        extra_args, extra_expect);
+    if (cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args))
+    {
+        msg = "Failed to parse alloc char * with value \"abc\"";
+        goto fail;
+    }
+    printf("Attempt to parse value: abc\n");
+    cargo_assert(b, "pointer is null");
+    cargo_assert(!strcmp(b, "abc"), "Failed to parse correct value abc");
 
     _TEST_CLEANUP();
-    _cargo_free_str_list(&extra_args, &extra_args_count);
+    _cargo_free(NULL, b);
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_set_option_description)
-{
-    int a = 0;
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
-    cargo_assert(ret == 0, "Failed to create option");
-
-    ret = cargo_set_option_description(cargo, "--alpha",
-            "%s world %d", "hello", 123);
-    cargo_assert(ret == 0, "Failed to set description");
+//
+// =========================== Array Tests ====================================
+//
+#define _TEST_ARRAY_OPTION(array, array_size, args, argc, fmt, ...)          \
+{                                                                            \
+    ret = cargo_add_option(cargo, 0, "--beta -b", "Description",             \
+                            fmt, ##__VA_ARGS__);                             \
+    cargo_assert(ret == 0,                                                   \
+        "Failed to add "#array"["#array_size"] array option");               \
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);    \
+    cargo_assert(ret == 0, "Failed to parse array: "#array"["#array_size"]");\
+}
 
-    cargo_print_usage(cargo, 0);
+#define ARG_SIZE (sizeof(args) / sizeof(args[0]))
+#define ARRAY_SIZE (sizeof(a_expect) / sizeof(a_expect[0]))
+#define _ADD_TEST_FIXED_ARRAY(fmt, printfmt)                            \
+do                                                                      \
+{                                                                       \
+    size_t count = 0;                                                       \
+    size_t i;                                                           \
+    _TEST_ARRAY_OPTION(a, ARRAY_SIZE, args, ARG_SIZE,                   \
+        fmt, &a, &count, ARRAY_SIZE);                                   \
+    cargo_assert(a != NULL, "Array is null");                           \
+    cargo_assert(count == ARRAY_SIZE, "Array count is invalid");        \
+    printf("Read %lu values from int array:\n", count);                 \
+    for (i = 0; i < ARRAY_SIZE; i++) printf("  "printfmt"\n", a[i]);    \
+    cargo_assert_array(count, ARRAY_SIZE, a, a_expect);                 \
+} while (0)
 
+///
+/// Simple add array tests.
+///
+_TEST_START(TEST_add_static_int_array_option)
+{
+    int a[3];
+    int a_expect[3] = { 1, -2, 3 };
+    char *args[] = { "program", "--beta", "1", "-2", "3" };
+    _ADD_TEST_FIXED_ARRAY(".[i]#", "%d");
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_parse_stop)
+_TEST_START(TEST_add_static_uint_array_option)
 {
-    size_t extra_args_count = 0;
-    char **extra_args = NULL;
-    int a = 0;
-    int b = 0;
-    int c = 0;
-    int d = 0;
-    char *args[] = { "--beta", "123", "--alpha", "--centauri", "beep", "--delta" };
-    // We stop parsing here ---------------------^
-    char *extra_expect[] = { "123", "beep", "--delta" };
-
-    cargo_set_flags(cargo, 0);
-
-    ret |= cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
-    ret |= cargo_add_option(cargo, 0, "--beta", "an option", "b", &b);
-    ret |= cargo_add_option(cargo, CARGO_OPT_STOP, "--centauri", "an option", "b", &c);
-    ret |= cargo_add_option(cargo, 0, "--delta", "an option", "b", &d);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse");
-
-    extra_args = cargo_get_args_copy(cargo, &extra_args_count);
-
-    cargo_assert_str_array(extra_args_count,
-        sizeof(extra_expect) / sizeof(extra_expect[0]),
-        extra_args, extra_expect);
-
+    unsigned int a[3];
+    unsigned int a_expect[3] = { 1, 2, 3 };
+    char *args[] = { "program", "--beta", "1", "2", "3" };
+    _ADD_TEST_FIXED_ARRAY(".[u]#", "%u");
     _TEST_CLEANUP();
-    _cargo_free_str_list(&extra_args, &extra_args_count);
 }
 _TEST_END()
 
-_TEST_START(TEST_parse_stop_hard)
+_TEST_START(TEST_add_static_long_long_int_array_option)
 {
-    // The difference in this test is that
-    // --delta is required, but should be skipped.
-
-    // TODO: This is a copy paste of the test above, split up into a common function.
-    size_t extra_args_count = 0;
-    char **extra_args = NULL;
-    int a = 0;
-    int b = 0;
-    int c = 0;
-    int d = 0;
-    char *args[] = { "--beta", "123", "--alpha", "--centauri", "beep", "--delta" };
-    // We stop parsing here ---------------------^
-    char *extra_expect[] = { "123", "beep", "--delta" };
-
-    cargo_set_flags(cargo, 0);
-
-    ret |= cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
-    ret |= cargo_add_option(cargo, 0, "--beta", "an option", "b", &b);
-
-    // This should make it so that --delta isn't required.
-    ret |= cargo_add_option(cargo, CARGO_OPT_STOP | CARGO_OPT_STOP_HARD,
-                            "--centauri", "an option", "b", &c);
-    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED,
-                            "--delta", "an option", "b", &d);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed to parse");
-
-    extra_args = cargo_get_args_copy(cargo, &extra_args_count);
-
-    cargo_assert_str_array(extra_args_count,
-        sizeof(extra_expect) / sizeof(extra_expect[0]),
-        extra_args, extra_expect);
-
+    long long int a[3];
+    long long int a_expect[3] = { 9223372036854775807, -9223372036854775807, 3 };
+    char *args[] = { "program", "--beta", "9223372036854775807", "-9223372036854775807", "3" };
+    memset(a, 0, sizeof(a));
+    _ADD_TEST_FIXED_ARRAY(".[L]#", "%"CARGO_LONGLONG_FMT);
     _TEST_CLEANUP();
-    _cargo_free_str_list(&extra_args, &extra_args_count);
 }
 _TEST_END()
 
-_TEST_START(TEST_parse_stop_hard_fail)
+_TEST_START(TEST_add_static_unsigned_long_long_int_array_option)
 {
-    // The difference in this test is that
-    // --delta is required, and we should fail.
-
-    // TODO: This is a copy paste of the test above, split up into a common function.
-    int a = 0;
-    int b = 0;
-    int c = 0;
-    int d = 0;
-    char *args[] = { "--beta", "123", "--alpha", "--centauri", "beep", "--delta" };
-    // We stop parsing here ---------------------^
-
-    cargo_set_flags(cargo, 0);
-
-    ret |= cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
-    ret |= cargo_add_option(cargo, 0, "--beta", "an option", "b", &b);
-
-    // This should make it so that --delta isn't required.
-    ret |= cargo_add_option(cargo, CARGO_OPT_STOP,
-                            "--centauri", "an option", "b", &c);
-    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED,
-                            "--delta", "an option", "b", &d);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret < 0, "Succeeded to parse when expected to fail");
-
+    long long int a[3];
+    long long int a_expect[3] = { 1844674407370955161, 9223372036854775807, 3 };
+    char *args[] = { "program", "--beta", "1844674407370955161", "9223372036854775807", "3" };
+    _ADD_TEST_FIXED_ARRAY(".[U]#", "%"CARGO_ULONGLONG_FMT);
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_zero_or_one_with_arg)
+_TEST_START(TEST_add_static_float_array_option)
 {
-    char *args[] = { "program", "--alpha", "6" };
-    int a = 0;
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i?", &a, "5");
-    cargo_assert(ret == 0, "Failed to add option");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed parse");
-    cargo_assert(a == 6, "Unexpected value");
-
+    float a[3];
+    float a_expect[3] = { 0.1f, 0.2f, 0.3f };
+    char *args[] = { "program", "--beta", "0.1", "0.2", "0.3" };
+    _ADD_TEST_FIXED_ARRAY(".[f]#", "%f");
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_zero_or_one_without_arg)
+_TEST_START(TEST_add_static_double_array_option)
 {
-    char *args[] = { "program", "--alpha" };
-    int a = 0;
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i?", &a, "5");
-    cargo_assert(ret == 0, "Failed to add option");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed parse");
-    cargo_assert(a == 5, "Unexpected value");
-
+    double a[3];
+    double a_expect[3] = { 0.1, 0.2, 0.3 };
+    char *args[] = { "program", "--beta", "0.1", "0.2", "0.3" };
+    _ADD_TEST_FIXED_ARRAY(".[d]#", "%f");
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_zero_or_one_without_arg2)
+_TEST_START(TEST_add_static_string_array_option)
 {
-    char *args[] = { "program", "--alpha", "--beta", "3" };
-    int a = 0;
-    int b = 0;
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i?", &a, "5");
-    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
-    cargo_assert(ret == 0, "Failed to add options");
+    #define LENSTR 5
+    char a[3][LENSTR];
+    size_t count = 0;
+    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
+    #define ARRAY2_SIZE (sizeof(a) / sizeof(a[0]))
+    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
+    memset(a, 0, sizeof(a));
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Failed parse");
-    cargo_assert(a == 5, "Unexpected value");
+    _TEST_ARRAY_OPTION(a, ARRAY2_SIZE, args, ARG_SIZE,
+                        ".[s#]#", &a, LENSTR, &count, ARRAY2_SIZE);
 
+    printf("Read %lu values from int array: %s, %s, %s\n",
+            count, a[0], a[1], a[2]);
+    cargo_assert(count == ARRAY2_SIZE, "Array count is not 3 as expected");
+    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
+    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
+    cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_late_unknown_options)
+///
+/// Alloc fixed size array tests.
+///
+_TEST_START(TEST_add_alloc_fixed_int_array_option)
 {
-    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
-    int a = 0;
-    int b = 0;
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i", &a);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Parse success on unknown option (late)");
-
-    printf("a = %d\n", a);
-    printf("b = %d\n", b);
-    cargo_assert(a == 123, "a != 123 after unknown option (check after)");
-    cargo_assert(b == 3,   "b != 3 after unknown option (check after)");
-
+    int *a = NULL;
+    int a_expect[3] = { 1, -2, 3 };
+    char *args[] = { "program", "--beta", "1", "-2", "3" };
+    _ADD_TEST_FIXED_ARRAY("[i]#", "%d");
     _TEST_CLEANUP();
+    _cargo_free(NULL, a);
 }
 _TEST_END()
 
-_TEST_START(TEST_early_unknown_options)
+_TEST_START(TEST_add_alloc_fixed_uint_array_option)
 {
-    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
-    int a = 0;
-    int b = 0;
-
-    cargo_set_flags(cargo, CARGO_UNKNOWN_EARLY);
-
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i", &a);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret != 0, "Parse success on unknown option (early)");
-
-    printf("a = %d\n", a);
-    printf("b = %d\n", b);
-    cargo_assert(a == 0, "a != 0, when early unknown option");
-    cargo_assert(b == 0, "b != 0, when early unknown option");
-
+    unsigned int *a = NULL;
+    unsigned int a_expect[3] = { 1, 2, 3 };
+    char *args[] = { "program", "--beta", "1", "2", "3" };
+    _ADD_TEST_FIXED_ARRAY("[u]#", "%u");
     _TEST_CLEANUP();
+    _cargo_free(NULL, a);
 }
 _TEST_END()
 
-_TEST_START(TEST_late_unknown_options_no_fail)
+_TEST_START(TEST_add_alloc_fixed_float_array_option)
 {
-    char *args[] =
-    {
-        "program", "--alpha", "123", "--centauri", "--delta", "--beta", "3"
-    };
-    char *expected[] = { "--centauri", "--delta" };
-    size_t expected_count = sizeof(expected) / sizeof(expected[0]);
-    int a = 0;
-    int b = 0;
-    size_t i = 0;
-    const char **unknowns = NULL;
-    size_t unknown_count = 0;
-    char **unknowns_cpy = NULL;
-    size_t unknown_count_cpy = 0;
-
-    cargo_set_flags(cargo, CARGO_NO_FAIL_UNKNOWN);
-
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i", &a);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failure on unknown option (late, no fail)");
-
-    printf("a = %d\n", a);
-    printf("b = %d\n", b);
-    cargo_assert(a == 123, "a != 123 after unknown option (check after)");
-    cargo_assert(b == 3,   "b != 3 after unknown option (check after)");
-
-    unknowns = cargo_get_unknown(cargo, &unknown_count);
-    cargo_assert(unknowns, "Got NULL unknowns list");
-    for (i = 0; i < unknown_count; i++) printf("%s\n", unknowns[i]);
-    cargo_assert_str_array(unknown_count, expected_count, unknowns, expected);
-
-    unknowns_cpy = cargo_get_unknown_copy(cargo, &unknown_count_cpy);
-    cargo_assert(unknowns_cpy, "Got NULL unknowns list (copy)");
-    for (i = 0; i < unknown_count_cpy; i++) printf("%s\n", unknowns_cpy[i]);
-    cargo_assert_str_array(unknown_count_cpy, expected_count, unknowns_cpy, expected);
-
+    float *a = NULL;
+    float a_expect[3] = { 1.1f, -2.2f, 3.3f };
+    char *args[] = { "program", "--beta", "1.1", "-2.2", "3.3" };
+    _ADD_TEST_FIXED_ARRAY("[f]#", "%f");
     _TEST_CLEANUP();
-    cargo_free_commandline(&unknowns_cpy, unknown_count_cpy);
+    _cargo_free(NULL, a);
 }
 _TEST_END()
 
-_TEST_START(TEST_late_unknown_options_no_fail_stop)
+_TEST_START(TEST_add_alloc_fixed_double_array_option)
 {
-    char *args[] =
-    {
-        "program", "--alpha", "123", "--centauri", "--delta", "--beta", "3",
-        "--bla", "--blo", "--many", "--other", "options"
-    };
-    char *expected[] = { "--centauri", "--delta" };
-    size_t expected_count = sizeof(expected) / sizeof(expected[0]);
-    int a = 0;
-    int b = 0;
-    size_t i = 0;
-    const char **unknowns = NULL;
-    size_t unknown_count = 0;
-    char **unknowns_cpy = NULL;
-    size_t unknown_count_cpy = 0;
-
-    cargo_set_flags(cargo, CARGO_NO_FAIL_UNKNOWN);
-
-    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i", &a);
-    ret = cargo_add_option(cargo, CARGO_OPT_STOP, "--beta -b", "an option", "i", &b);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failure on unknown option (late, no fail)");
-
-    printf("a = %d\n", a);
-    printf("b = %d\n", b);
-    cargo_assert(a == 123, "a != 123 after unknown option (check after)");
-    cargo_assert(b == 3,   "b != 3 after unknown option (check after)");
-
-    unknowns = cargo_get_unknown(cargo, &unknown_count);
-    cargo_assert(unknowns, "Got NULL unknowns list");
-    for (i = 0; i < unknown_count; i++) printf("%s\n", unknowns[i]);
-    cargo_assert_str_array(unknown_count, expected_count, unknowns, expected);
-
-    unknowns_cpy = cargo_get_unknown_copy(cargo, &unknown_count_cpy);
-    cargo_assert(unknowns_cpy, "Got NULL unknowns list (copy)");
-    for (i = 0; i < unknown_count_cpy; i++) printf("%s\n", unknowns_cpy[i]);
-    cargo_assert_str_array(unknown_count_cpy, expected_count, unknowns_cpy, expected);
-
+    double *a = NULL;
+    double a_expect[3] = { 1.1, -2.2, 3.3 };
+    char *args[] = { "program", "--beta", "1.1", "-2.2", "3.3" };
+    _ADD_TEST_FIXED_ARRAY("[d]#", "%f");
     _TEST_CLEANUP();
-    cargo_free_commandline(&unknowns_cpy, unknown_count_cpy);
+    _cargo_free(NULL, a);
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_set_error)
+_TEST_START(TEST_add_alloc_fixed_string_array_option)
 {
-    cargo_set_error(cargo, 0, "Hello %s\n", "world");
-    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello world\n"), "Unexpected string");
+    #define LENSTR 5
+    char **a = NULL;
+    size_t count;
+    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
+    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
 
+    _TEST_ARRAY_OPTION(a, 3, args, ARG_SIZE,
+                        "[s#]#", &a, LENSTR, &count, 3);
+
+    cargo_assert(a != NULL, "Array is null");
+    cargo_assert(count == 3, "Array count is not 3");
+    printf("Read %lu values from int array: %s, %s, %s\n",
+            count, a[0], a[1], a[2]);
+    cargo_assert(count == 3, "Array count is not 3 as expected");
+    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
+    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
+    cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
     _TEST_CLEANUP();
+    _cargo_free_str_list(NULL, &a, &count);
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_set_error_append)
+_TEST_START(TEST_add_alloc_fixed_string_array_option2)
 {
-    cargo_set_error(cargo, 0, "Hello ");
-    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello "), "Unexpected string");
-    cargo_set_error(cargo, CARGO_ERR_APPEND, "world\n");
-    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello world\n"), "Unexpected string");
+    char **a = NULL;
+    size_t count;
+    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
+    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
+
+    _TEST_ARRAY_OPTION(a, 3, args, ARG_SIZE,
+                        "[s]#", &a, &count, 3);
 
+    cargo_assert(a != NULL, "Array is null");
+    cargo_assert(count == 3, "Array count is not 3");
+    printf("Read %lu values from string array: %s, %s, %s\n",
+            count, a[0], a[1], a[2]);
+    cargo_assert(count == 3, "Array count is not 3 as expected");
+    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
+    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
+    cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
     _TEST_CLEANUP();
+    _cargo_free_str_list(NULL, &a, &count);
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_set_error_append2)
+_TEST_START(TEST_add_alloc_fixed_string_array_option3)
 {
-    cargo_set_error(cargo, CARGO_ERR_APPEND, "Hello ");
-    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello "), "Unexpected string");
-    cargo_set_error(cargo, CARGO_ERR_APPEND, "world\n");
-    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello world\n"), "Unexpected string");
-    cargo_set_error(cargo, 0, "The other\n");
-    cargo_assert(!strcmp(cargo_get_error(cargo), "The other\n"), "Unexpected string");
+    #define NUM_ELEMENTS 3
+    char *a[NUM_ELEMENTS];
+    size_t count = 0;
+    size_t i;
+    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
+    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
+    memset(a, 0, sizeof(a));
+
+    _TEST_ARRAY_OPTION(a, 3, args, ARG_SIZE,
+                        ".[s]#", &a, &count, NUM_ELEMENTS);
 
+    cargo_assert(a != NULL, "Array is null");
+    cargo_assert(count == 3, "Array count is not 3");
+    printf("Read %lu values from string array: %s, %s, %s\n",
+            count, a[0], a[1], a[2]);
+    cargo_assert(count == NUM_ELEMENTS, "Array count is not 3 as expected");
+    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
+    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
+    cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
     _TEST_CLEANUP();
+    for (i = 0; i < NUM_ELEMENTS; i++)
+    {
+        if (a[i]) free(a[i]);
+    }
 }
 _TEST_END()
 
-
-_TEST_START(TEST_cargo_set_memfunctions)
+_TEST_START(TEST_add_alloc_fixed_string_array_option4)
 {
-    int i;
-    const char *s = NULL;
-    cargo_set_memfunctions(_cargo_test_malloc, _cargo_test_realloc, free);
-
-    _cargo_test_set_malloc_fail_count(0);
-    _cargo_test_set_realloc_fail_count(0);
-    s = TEST_add_integer_option();
-    cargo_assert(s == NULL, "Got unexpected mem error");
-
-    for (i = 1; i < 20; i++)
-    {
-        _cargo_test_set_malloc_fail_count(i);
-        s = TEST_add_integer_option();
-        cargo_assert(s != NULL, "Did not get expected mem error");
-    }
-
-    _cargo_test_set_malloc_fail_count(0);
-    _cargo_test_set_realloc_fail_count(0);
-    s = TEST_many_groups();
-    cargo_assert(s == NULL, "Got unexpected mem error");
+    #define NUM_ELEMENTS 3
+    char *a[NUM_ELEMENTS];
+    size_t count = 0;
+    size_t i;
+    char *args[] = { "program", "--beta", "abc", "def", "ghi" };
+    #define ARG_SIZE (sizeof(args) / sizeof(args[0]))
+    memset(a, 0, sizeof(a));
 
-    for (i = 1; i < 20; i++)
-    {
-        _cargo_test_set_malloc_fail_count(i);
-        s = TEST_many_groups();
-        cargo_assert(s != NULL, "Did not get expected mem error TEST_many_groups");
-    }
+    _TEST_ARRAY_OPTION(a, 3, args, ARG_SIZE,
+                        ".[s]+", &a, &count, NUM_ELEMENTS);
 
-    for (i = 1; i < 20; i++)
+    cargo_assert(a != NULL, "Array is null");
+    cargo_assert(count == 3, "Array count is not 3");
+    printf("Read %lu values from string array: %s, %s, %s\n",
+            count, a[0], a[1], a[2]);
+    cargo_assert(count == NUM_ELEMENTS, "Array count is not 3 as expected");
+    cargo_assert(!strcmp(a[0], "abc"), "Array value at index 0 is not \"abc\" as expected");
+    cargo_assert(!strcmp(a[1], "def"), "Array value at index 1 is not \"def\" as expected");
+    //cargo_assert(!strcmp(a[2], "ghi"), "Array value at index 2 is not \"ghi\" as expected");
+    _TEST_CLEANUP();
+    for (i = 0; i < NUM_ELEMENTS; i++)
     {
-        _cargo_test_set_realloc_fail_count(i);
-        s = TEST_many_groups();
-        cargo_assert(s != NULL, "Did not get expected mem error TEST_many_groups");
+        if (a[i]) free(a[i]);
     }
-
-
-    _TEST_CLEANUP();
-    cargo_set_memfunctions(NULL, NULL, NULL);
-    _cargo_test_set_malloc_fail_count(0);
-    _cargo_test_set_realloc_fail_count(0);
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_malloc_zero_bytes)
+//
+// Dynamic sized alloc array tests.
+//
+_TEST_START(TEST_add_alloc_dynamic_int_array_option)
 {
-    cargo_set_memfunctions(_cargo_test_malloc, NULL, NULL);
-    _cargo_test_set_malloc_fail_count(0);
-
-    cargo_assert(_cargo_malloc(0) == NULL, "Did not get expected error");
-    cargo_assert(malloc_current == 0, "Unexpected call to malloc");
-
+    int *a = NULL;
+    int a_expect[3] = { 1, -2, 3 };
+    char *args[] = { "program", "--beta", "1", "-2", "3" };
+    _ADD_TEST_FIXED_ARRAY("[i]+", "%d");
     _TEST_CLEANUP();
-    cargo_set_memfunctions(NULL, NULL, NULL);
-    _cargo_test_set_malloc_fail_count(0);
+    _cargo_free(NULL, a);
 }
 _TEST_END()
 
-_TEST_START(TEST_test_hidden_option)
+_TEST_START(TEST_add_alloc_dynamic_int_array_option_noargs)
 {
-    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
-    int a = 0;
-    int b = 0;
-    const char *usage = NULL;
-    ret = cargo_add_option(cargo, CARGO_OPT_HIDE, "--alpha", "the hidden", "i", &a);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
-    cargo_assert(ret == 0, "Failed to add options");
-
-    usage = cargo_get_usage(cargo, 0);
-    printf("%s\n", usage);
+    int *a = NULL;
+    char *args[] = { "program", "--beta" };
+    size_t count;
 
-    cargo_assert(strstr(usage, "--alpha") == NULL,
-        "Found hidden option in usage");
+    ret = cargo_add_option(cargo, 0, "--beta -b", "Description", "[i]+",
+                            &a, &count);
+    cargo_assert(ret == 0, "Failed to add options");
 
-    cargo_assert(strstr(usage, "the hidden") == NULL,
-        "Found hidden option description in usage");
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Successfully parsed when no args");
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_test_hidden_short_option)
+//
+// Misc output tests.
+//
+_TEST_START(TEST_print_usage)
 {
-    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
-    int a = 0;
-    int b = 0;
-    const char *usage = NULL;
-    ret = cargo_add_option(cargo, CARGO_OPT_HIDE_SHORT, "--alpha", "the hidden", "i", &a);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
-    cargo_assert(ret == 0, "Failed to add options");
+    int a[3];
+    size_t a_count = 0;
+    float b;
+    double c;
+    char *s = NULL;
+    int *vals = NULL;
+    size_t val_count = 0;
 
-    // Only hide in short usage.
-    usage = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
-    printf("%s\n", usage);
+    ret |= cargo_add_option(cargo, 0, "--alpha -a",
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+            "eiusmod tempor incididunt ut labore et dolore magna aliqua. "
+            "Ut enim ad minim veniam, quis nostrud exercitation ullamco "
+            "laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure "
+            "dolor in reprehenderit in voluptate velit esse cillum dolore eu "
+            "fugiat nulla pariatur. Excepteur sint occaecat cupidatat non "
+            "proident, sunt in culpa qui officia deserunt mollit anim id est "
+            "laborum",
+            ".[i]#",
+            &a, &a_count, sizeof(a) / sizeof(a[0]));
 
-    cargo_assert(strstr(usage, "--alpha") == NULL,
-        "Found hidden short option in short usage");
+    ret |= cargo_add_option(cargo, 0, "--beta -b",
+            "Shorter description",
+            "f",
+            &b);
+    ret |= cargo_set_metavar(cargo, "--beta", "FLOAT");
 
-    cargo_assert(strstr(usage, "the hidden") == NULL,
-        "Found hidden short option description in short usage");
+    ret |= cargo_add_option(cargo, 0, "--call_this_a_long_option_that_wont_fit -c",
+            "Sed ut perspiciatis unde omnis iste natus error sit voluptatem "
+            "accusantium doloremque laudantium, totam rem aperiam, eaque ipsa "
+            "quae ab illo inventore veritatis et quasi architecto beatae vitae "
+            "dicta sunt explicabo",
+            "d",
+            &c);
 
-    // It should be shown in full usage.
-    usage = cargo_get_usage(cargo, CARGO_USAGE_FULL);
-    printf("%s\n", usage);
+    ret |= cargo_add_option(cargo, 0, "--shorter -s",
+            "Sed ut perspiciatis unde omnis iste natus error sit voluptatem "
+            "accusantium doloremque laudantium, totam rem aperiam, eaque ipsa "
+            "quae ab illo inventore veritatis et quasi architecto beatae vitae "
+            "dicta sunt explicabo",
+            "s",
+            &s);
 
-    cargo_assert(strstr(usage, "--alpha") != NULL,
-        "Did not find hidden short option in full usage");
+    ret |= cargo_add_option(cargo, 0, "--vals -v",
+            "Shorter description",
+            "[ i ]+",
+            &vals, &val_count);
+    cargo_assert(ret == 0, "Failed to add options");
 
-    cargo_assert(strstr(usage, "the hidden") != NULL,
-        "Did not find hidden short option description in full usage");
+    cargo_set_epilog(cargo, "That's it!");
+    cargo_set_description(cargo, "Introductionary description");
 
+    cargo_print_usage(cargo, 0);
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_override_short_usage)
+_TEST_START(TEST_get_usage_settings)
 {
-    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
-    int a = 0;
-    int b = 0;
+    typedef struct _test_usage_settings_s
+    {
+        cargo_usage_t fmt;
+        char *expect[4];
+        size_t expect_count;
+    } _test_usage_settings_t;
+
+    #define DESCRIPT "Brown fox"
+    #define EPILOG "Lazy fox"
+    #define OPT_TXT "The alpha"
+    size_t j;
+    size_t k;
+    int i;
     const char *usage = NULL;
-    ret = cargo_add_option(cargo, CARGO_OPT_HIDE, "--alpha", "the hidden", "i", &a);
-    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
+    _test_usage_settings_t tus[] =
+    {
+        { 0,                                { DESCRIPT, EPILOG, OPT_TXT }, 3},
+        { CARGO_USAGE_HIDE_EPILOG,          { DESCRIPT, OPT_TXT }, 2},
+        { CARGO_USAGE_HIDE_DESCRIPTION,     { EPILOG, OPT_TXT }, 2}
+    };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", OPT_TXT, "i", &i);
     cargo_assert(ret == 0, "Failed to add options");
 
-    cargo_set_progname(cargo, "%s [options] args", args[0]);
-    usage = cargo_get_usage(cargo,
-        CARGO_USAGE_OVERRIDE_SHORT |
-        CARGO_USAGE_SHORT);
-    printf("%s\n", usage);
+    cargo_set_description(cargo, "Brown fox");
+    cargo_set_epilog(cargo, "Lazy fox");
 
-    cargo_assert(strstr(usage, "--help") == NULL,
-        "Short usage not overridden, found --help");
+    for (j = 0; j < sizeof(tus) / sizeof(tus[0]); j++)
+    {
+        usage = cargo_get_usage(cargo, tus[j].fmt);
+        cargo_assert(usage != NULL, "Got null usage");
+        printf("\n\n");
 
-    cargo_assert(strstr(usage, "--beta") == NULL,
-        "Short usage not overridden, found --beta");
+        for (k = 0; k < tus[j].expect_count; k++)
+        {
+            char *s = tus[j].expect[k];
+            char *found = strstr(usage, s);
+            printf("-------------------------------------\n");
+            printf("%s\n", usage);
+            printf("-------------------------------------\n");
+            printf("Expecting to find in usage: \"%s\"\n", s);
+            cargo_assert(found != NULL,
+                "Usage formatting unexpected");
+        }
 
-    cargo_assert(!strcmp(usage, "Usage: program [options] args"),
-        "Did not find overriden short usage");
+        printf("-------------------------------------\n");
+        printf("%s\n", usage);
+        printf("-------------------------------------\n");
+    }
 
-    // Test stripping path. First no strip.
-    cargo_set_progname(cargo, "%s [options] args", "some/long/path/program");
-    usage = cargo_get_usage(cargo,
-        CARGO_USAGE_OVERRIDE_SHORT |
-        CARGO_USAGE_SHORT);
-    printf("STRIP:\n%s\n", usage);
+    _TEST_CLEANUP();
+}
+_TEST_END()
 
-    cargo_assert(strstr(usage, "some/long/path/") == NULL,
-        "Found path when stripping");
+_TEST_START(TEST_autohelp_default)
+{
+    int i;
+    const char *usage = NULL;
 
-    usage = cargo_get_usage(cargo,
-        CARGO_USAGE_NO_STRIP_PROGNAME |
-        CARGO_USAGE_OVERRIDE_SHORT |
-        CARGO_USAGE_SHORT);
-    printf("NO STRIP:\n%s\n", usage);
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
 
-    cargo_assert(strstr(usage, "some/long/path/"),
-        "Did not find path when no strip");
+    // Default is to automatically add --help option.
+    usage = cargo_get_usage(cargo, 0);
+    cargo_assert(usage != NULL, "Got NULL usage");
+    printf("-------------------------------------\n");
+    printf("%s", usage);
+    printf("-------------------------------------\n");
+    cargo_assert(strstr(usage, "help") != NULL, "No help found by default");
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_duplicate_alias)
+_TEST_START_EX(TEST_autohelp_off, CARGO_NO_AUTOHELP)
 {
+    int i;
     const char *usage = NULL;
-    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "D");
-    cargo_assert(ret == 0, "Failed to add option");
 
-    ret = cargo_add_option(cargo, 0, "--bravo -b", "another option", "D");
-    cargo_assert(ret != 0, "Successfully added option with taken alias");
+    // Turn off auto_help (--help).
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
 
-    ret = cargo_add_option(cargo, 0, "--bravo", "another option", "D");
-    cargo_assert(ret == 0, "Failed to add valid option");
+    usage = cargo_get_usage(cargo, 0);
+    cargo_assert(usage != NULL, "Got NULL usage");
+    printf("-------------------------------------\n");
+    printf("%s", usage);
+    printf("-------------------------------------\n");
+    cargo_assert(strstr(usage, "help") == NULL,
+                "Help found when auto_help turned off");
 
-    ret = cargo_add_alias(cargo, "--bravo", "-r");
-    cargo_assert(ret == 0, "Failed to add valid alias");
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END_NODESTROY()
 
-    ret = cargo_add_alias(cargo, "--bravo", "-b");
-    cargo_assert(ret != 0, "Successfully added option with taken alias");
+#define _ADD_TEST_USAGE_OPTIONS()                                           \
+do                                                                          \
+{                                                                           \
+    int *k;                                                                 \
+    size_t k_count;                                                         \
+    int i;                                                                  \
+    float f;                                                                \
+    int b;                                                                  \
+    ret |= cargo_add_option(cargo, 0, "pos", "Positional arg", "[i]+",      \
+                            &k, &k_count);                                  \
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha" LOREM_IPSUM, "i", &i);  \
+    ret |= cargo_add_option(cargo, 0, "--beta", "The alpha", "f", &f);      \
+    ret |= cargo_add_option(cargo, 0, "--crash -c", "The alpha", "b", &b);  \
+    cargo_assert(ret == 0, "Failed to add options");                        \
+} while (0)
+
+_TEST_START(TEST_get_usage)
+{
+    const char *usage = NULL;
+
+    _ADD_TEST_USAGE_OPTIONS();
+    usage = cargo_get_usage(cargo, 0);
+    cargo_assert(usage != NULL, "Failed to get allocated usage");
+    printf("%s\n", usage);
+    printf("Cargo v%s\n", cargo_get_version());
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_get_option_type)
+_TEST_START(TEST_misspelled_argument)
 {
-    int a;
+    int i;
+    float f;
     int b;
-    float c;
-    char *s = NULL;
-    const char *usage = NULL;
-    ret = cargo_add_option(cargo, 0, "--alpha -a", "an option", "b", &a);
-    cargo_assert(ret == 0, "Failed to add option");
-    cargo_assert(cargo_get_option_type(cargo, "--alpha") == CARGO_BOOL,
-                "Expected alpha to be a bool");
+    char *args[] = { "program", "--bota", "0.1" };
 
-    ret = cargo_add_option(cargo, 0, "--beta -b", "another option", "i", &b);
-    cargo_assert(ret == 0, "Failed to add option");
-    cargo_assert(cargo_get_option_type(cargo, "--beta") == CARGO_INT,
-                "Expected beta to be a int");
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    ret |= cargo_add_option(cargo, 0, "--beta", "The alpha", "f", &f);
+    ret |= cargo_add_option(cargo, 0, "--crash -c", "The alpha", "b", &b);
+    cargo_assert(ret == 0, "Failed to add options");
 
-    ret = cargo_add_option(cargo, 0, "--centauri -c", "another option", "f", &c);
-    cargo_assert(ret == 0, "Failed to add option");
-    cargo_assert(cargo_get_option_type(cargo, "--centauri") == CARGO_FLOAT,
-                "Expected centauri to be a float");
+    ret = cargo_parse(cargo, 0, 1, 3, args);
+    cargo_assert(ret == -1, "Got valid parse with invalid input");
+    _TEST_CLEANUP();
+}
+_TEST_END()
 
-    ret = cargo_add_option(cargo, 0, "--delta -d", "another option", "s", &s);
-    cargo_assert(ret == 0, "Failed to add option");
-    cargo_assert(cargo_get_option_type(cargo, "--delta") == CARGO_STRING,
-                "Expected delta to be a string");
+_TEST_START(TEST_add_duplicate_option)
+{
+    int i;
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    cargo_assert(ret != 0, "Succesfully added duplicated, not allowed");
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_large_list_and_usage)
+_TEST_START(TEST_get_extra_args)
 {
-    #define LST_SIZE 256
-    char *lst[LST_SIZE];
-    size_t lst_count = 0;
-    const char *usage = NULL;
+    size_t argc = 0;
+    const char **extra_args = NULL;
+    char *extra_args_expect[] = { "abc", "def", "ghi" };
+    int i;
+    char *args[] = { "program", "-a", "1", "abc", "def", "ghi" };
 
-    // This tests a specific bug where a large array created
-    // a buffer overflow when generating the metavar for the usage.
-    ret |= cargo_add_option(cargo, 0,
-            "--template --input",
-            "Path to one or more template files generated on specified events. "
-            "(Not to be confused with the template matcher)",
-            ".[s]#", &lst, &lst_count, LST_SIZE);
-    cargo_assert(ret == 0, "Failed to add option");
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
 
-    usage = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse extra args input");
+
+    // Get left over arguments.
+    extra_args = cargo_get_args(cargo, &argc);
+    cargo_assert(extra_args != NULL, "Got NULL extra args");
+
+    printf("argc = %lu\n", argc);
+    cargo_assert(argc == 3, "Expected argc == 3");
+    cargo_assert_str_array(argc, 3, extra_args, extra_args_expect);
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_large_list_and_usage2)
+_TEST_START(TEST_get_unknown_opts)
 {
-    #define LST_SIZE 256
-    char *lst[LST_SIZE];
-    size_t lst_count = 0;
-    const char *usage = NULL;
+    size_t unknown_count = 0;
+    const char **unknown_opts = NULL;
+    char *unknown_opts_expect[] = { "-b", "-c" };
+    int i;
+    char *args[] = { "program", "-a", "1", "-b", "-c", "3" };
 
-    ret |= cargo_add_option(cargo, 0,
-            "--template --input",
-            "Path to one or more template files generated on specified events. "
-            "(Not to be confused with the template matcher)",
-            ".[s]+", &lst, &lst_count, LST_SIZE);
-    cargo_assert(ret == 0, "Failed to add option");
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
 
-    usage = cargo_get_usage(cargo, 0);
-    printf("%s\n", usage);
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Succeeded parsing with unknown options");
+
+    // Get left over arguments.
+    unknown_opts = cargo_get_unknown(cargo, &unknown_count);
+    cargo_assert(unknown_opts != NULL, "Got NULL unknown options");
+
+    printf("Unknown option count = %lu\n", unknown_count);
+    cargo_assert(unknown_count == 2, "Unknown option count == 2");
+    cargo_assert_str_array(unknown_count, 2, unknown_opts, unknown_opts_expect);
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-#define _CARGO_ADD_TEST_VALIDATE(fmt, opt, funcname, ...)                   \
-    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, fmt, opt);         \
-    cargo_assert(ret == 0, "Failed to add option");                         \
-    ret = cargo_add_validation(cargo, 0, "--alpha", funcname(__VA_ARGS__)); \
-    cargo_assert(ret == 0, "Failed to add validation")
+_TEST_START(TEST_cargo_split)
+{
+    size_t i;
+    size_t j;
 
-#define _CARGO_TEST_VALIDATE_VALUE(val, dofail)                             \
-    do                                                                      \
-    {                                                                       \
-        char *args[] = { "program", "--alpha", #val };                      \
-        ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);\
-        if (dofail) cargo_assert(ret < 0, "Expected parse failure for " #val);\
-        else  cargo_assert(ret == 0, "Failed to parse");                    \
-    } while (0)
+    char *in[] =
+    {
+        " abc def   ghi   ",
+        "abc",
+        NULL
+    };
+    #define NUM (sizeof(in) / sizeof(in[0]))
+
+    char *expect0[] = { "abc", "def", "ghi" };
+    char *expect1[] = { "abc" };
+    char *expect2[] = { NULL };
+    char **expect[] = { expect0, expect1, expect2 };
+    size_t expect_count[] =
+    {
+        3,
+        1,
+        0
+    };
+
+    char **out[NUM];
+    size_t out_count[NUM];
+    ret = 0;
+
+    for (i = 0; i < NUM; i++)
+    {
+        printf("Split: \"%s\"", in[i]);
+        out[i] = _cargo_split(NULL, in[i], " ", &out_count[i]);
+        printf(" into %lu substrings\n", out_count[i]);
+
+        if (in[i] != NULL)
+            cargo_assert(out[i] != NULL, "Got null split result");
+
+        for (j = 0; j < out_count[i]; j++)
+        {
+            printf("\"%s\"%s ",
+                out[i][j], ((j + 1) != out_count[i]) ? "," : "");
+        }
+
+        printf("\n");
+    }
+
+    for (i = 0; i < NUM; i++)
+    {
+        cargo_assert_str_array(out_count[i], expect_count[i], out[i], expect[i]);
+    }
 
-_TEST_START(TEST_int_range_validation)
-{
-    int a = 0;
-    _CARGO_ADD_TEST_VALIDATE("i", &a, cargo_validate_int_range, 3, 6);
-    _CARGO_TEST_VALIDATE_VALUE(-200, 1);
-    _CARGO_TEST_VALIDATE_VALUE(2, 1);
-    _CARGO_TEST_VALIDATE_VALUE(3, 0);
-    _CARGO_TEST_VALIDATE_VALUE(5, 0);
-    _CARGO_TEST_VALIDATE_VALUE(6, 0);
-    _CARGO_TEST_VALIDATE_VALUE(123, 1);
     _TEST_CLEANUP();
+    for (i = 0; i < NUM; i++)
+    {
+        _cargo_free_str_list(NULL, &out[i], &out_count[i]);
+    }
+    #undef NUM
 }
 _TEST_END()
 
-_TEST_START(TEST_float_range_validation)
+_TEST_START(TEST_parse_invalid_value)
 {
-    float a = 0;
-    _CARGO_ADD_TEST_VALIDATE("f", &a, cargo_validate_float_range, 3.0f, 6.0f, 0.00001f);
-    _CARGO_TEST_VALIDATE_VALUE(-312.4, 1);
-    _CARGO_TEST_VALIDATE_VALUE(2.4, 1);
-    _CARGO_TEST_VALIDATE_VALUE(3.0, 0);
-    _CARGO_TEST_VALIDATE_VALUE(5.5, 0);
-    _CARGO_TEST_VALIDATE_VALUE(6.0, 0);
-    _CARGO_TEST_VALIDATE_VALUE(6.2, 1);
-    _CARGO_TEST_VALIDATE_VALUE(123.424, 1);
+    int i;
+    int j;
+    char *args[] = { "program", "--alpha", "1", "--beta", "a" };
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Succesfully parsed invalid value");
+
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_double_range_validation)
+_TEST_START(TEST_parse_twice)
 {
-    double a = 0;
-    _CARGO_ADD_TEST_VALIDATE("d", &a, cargo_validate_double_range, 3.0, 6.0, 0.00001);
-    _CARGO_TEST_VALIDATE_VALUE(2.3, 1);
-    _CARGO_TEST_VALIDATE_VALUE(3.0, 0);
-    _CARGO_TEST_VALIDATE_VALUE(5.2, 0);
-    _CARGO_TEST_VALIDATE_VALUE(6.0, 0);
-    _CARGO_TEST_VALIDATE_VALUE(123.0, 1);
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    // This test make sure the parser is reset between
+    // different parse sessions.
+    #define PORTS_COUNT 3
+    int ports[PORTS_COUNT];
+    size_t ports_count = 0;
+    char *name = NULL;
+    char **vals = NULL;
+    size_t vals_count = 0;
 
-_TEST_START(TEST_uint_range_validation)
-{
-    unsigned int a = 0;
-    _CARGO_ADD_TEST_VALIDATE("u", &a, cargo_validate_uint_range, 10, 20);
-    _CARGO_TEST_VALIDATE_VALUE(2, 1);
-    _CARGO_TEST_VALIDATE_VALUE(10, 0);
-    _CARGO_TEST_VALIDATE_VALUE(15, 0);
-    _CARGO_TEST_VALIDATE_VALUE(20, 0);
-    _CARGO_TEST_VALIDATE_VALUE(123, 1);
-    _TEST_CLEANUP();
-}
-_TEST_END()
+    char *args1[] =
+    {
+        "program",
+        "--ports", "22", "24", "26",
+        "--vals", "abc", "def", "123456789101112", "ghi", "jklmnopq",
+        "--name", "server"
+    };
+    int args1_ports_expect[] = { 22, 24, 26 };
+    char *args1_vals_expect[] = { "abc", "def", "123456789101112", "ghi", "jklmnopq" };
+
+    char *args2[] =
+    {
+        "program",
+        "--vals", "abc", "def", "123456789101112", "ghi", "jklmnopq",
+        "--ports", "33", "34", "36",
+        "--name", "server"
+    };
+    int args2_ports_expect[] = { 33, 34, 36 };
+
+    ret |= cargo_add_option(cargo, 0, "--ports -p", "Ports", ".[i]#",
+                            &ports, &ports_count, PORTS_COUNT);
+    ret |= cargo_add_option(cargo, 0, "--name -n", "Name", "s", &name);
+    ret |= cargo_add_option(cargo, 0, "--vals -v", "Description of vals", "[s]+",
+                            &vals, &vals_count);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    printf("\nArgs 1:\n");
+    {
+        ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+
+        cargo_assert(ret == 0, "Failed to parse advanced example");
+        cargo_assert_array(ports_count, PORTS_COUNT, ports, args1_ports_expect);
+        cargo_assert_str_array(vals_count, 5, vals, args1_vals_expect);
+        cargo_assert(name && !strcmp(name, "server"), "Expected name = \"server\"");
+
+        // TODO: Remove this and make sure these are freed at cargo_parse instead
+        _cargo_free_str_list(NULL, &vals, &vals_count);
+        _cargo_xfree(NULL, &name);
+        memset(&ports, 0, sizeof(ports));
+    }
+
+    printf("\nArgs 2:\n");
+    {
+        ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+
+        cargo_assert(ret == 0, "Failed to parse advanced example");
+        cargo_assert_str_array(vals_count, 5, vals, args1_vals_expect);
+        cargo_assert_array(ports_count, PORTS_COUNT, ports, args2_ports_expect);
+        cargo_assert(!strcmp(name, "server"), "Expected name = \"server\"");
+    }
 
-_TEST_START(TEST_longlong_range_validation)
-{
-    long long int a = 0;
-    _CARGO_ADD_TEST_VALIDATE("L", &a, cargo_validate_longlong_range, 10, 20);
-    _CARGO_TEST_VALIDATE_VALUE(-2, 1);
-    _CARGO_TEST_VALIDATE_VALUE(10, 0);
-    _CARGO_TEST_VALIDATE_VALUE(15, 0);
-    _CARGO_TEST_VALIDATE_VALUE(20, 0);
-    _CARGO_TEST_VALIDATE_VALUE(123, 1);
     _TEST_CLEANUP();
+    _cargo_free_str_list(NULL, &vals, &vals_count);
+    _cargo_xfree(NULL, &name);
 }
 _TEST_END()
 
-_TEST_START(TEST_ulonglong_range_validation)
+_TEST_START(TEST_parse_missing_value)
 {
-    unsigned long long int a = 0;
-    _CARGO_ADD_TEST_VALIDATE("U", &a, cargo_validate_ulonglong_range, 10, 20);
-    _CARGO_TEST_VALIDATE_VALUE(2, 1);
-    _CARGO_TEST_VALIDATE_VALUE(10, 0);
-    _CARGO_TEST_VALIDATE_VALUE(15, 0);
-    _CARGO_TEST_VALIDATE_VALUE(20, 0);
-    _CARGO_TEST_VALIDATE_VALUE(123, 1);
+    int i;
+    int j;
+    char *args[] = { "program", "--alpha", "1", "--beta" };
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Succesfully parsed missing value");
+
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_choices_validation)
+_TEST_START(TEST_parse_missing_array_value)
 {
-    char *str = NULL;
-    _CARGO_ADD_TEST_VALIDATE("s", &str,
-            cargo_validate_choices, 0, CARGO_STRING,
-            2, "abc", "def");
-    _CARGO_TEST_VALIDATE_VALUE(abc, 0);
-    _CARGO_TEST_VALIDATE_VALUE(def, 0);
-    _CARGO_TEST_VALIDATE_VALUE(klmn, 1);
-    _CARGO_TEST_VALIDATE_VALUE(ABC, 0);
-    _CARGO_TEST_VALIDATE_VALUE(DEF, 0);
+    int i[3];
+    size_t i_count = 0;
+    int j = 0;
+    char *args[] = { "program", "--beta", "2", "--alpha", "1", "2" };
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", ".[i]#", &i, &i_count, 3);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Succesfully parsed missing value");
+
     _TEST_CLEANUP();
-    _cargo_xfree(&str);
 }
 _TEST_END()
 
-_TEST_START(TEST_choices_validation_case_sensitive)
+_TEST_START(TEST_parse_missing_array_value_ensure_free)
 {
-    char *str = NULL;
-    _CARGO_ADD_TEST_VALIDATE("s", &str,
-            cargo_validate_choices,
-            CARGO_VALIDATE_CHOICES_CASE_SENSITIVE,
-            CARGO_STRING,
-            2, "abc", "def");
-    _CARGO_TEST_VALIDATE_VALUE(abc, 0);
-    _CARGO_TEST_VALIDATE_VALUE(def, 0);
-    _CARGO_TEST_VALIDATE_VALUE(klmn, 1);
-    _CARGO_TEST_VALIDATE_VALUE(ABC, 1);
-    _CARGO_TEST_VALIDATE_VALUE(DEF, 1);
+    // Here we make sure allocated values get freed on a failed parse.
+    int i[3];
+    size_t i_count = 0;
+    int *j = NULL;
+    size_t j_count = 0;
+    char *args[] = { "program", "--beta", "2", "3", "--alpha", "1", "2" };
+
+    memset(i, 0, sizeof(i));
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "The alpha", ".[i]#", &i, &i_count, 3);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "The beta", "[i]#", &j, &j_count, 2);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Succesfully parsed missing value");
+    cargo_assert(j == NULL, "Array non-NULL after failed parse");
+
     _TEST_CLEANUP();
-    _cargo_xfree(&str);
 }
 _TEST_END()
 
-_TEST_START(TEST_choices_validation_int)
+_TEST_START(TEST_parse_same_option_twice)
 {
-    int a;
-    _CARGO_ADD_TEST_VALIDATE("i", &a,
-            cargo_validate_choices, 0, CARGO_INT,
-            3, -40, 30, 10);
-    _CARGO_TEST_VALIDATE_VALUE(-40, 0);
-    _CARGO_TEST_VALIDATE_VALUE(30, 0);
-    _CARGO_TEST_VALIDATE_VALUE(40, 1);
-    _CARGO_TEST_VALIDATE_VALUE(20, 1);
-    _CARGO_TEST_VALIDATE_VALUE(10, 0);
+    int i;
+    int j;
+    char *args[] = { "program", "--alpha", "1", "--beta", "4", "--alpha", "2" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "i", &i);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    printf("--alpha == %d\n", i);
+    cargo_assert(ret == 0, "Failed to parsed duplicate option without unique");
+    cargo_assert(i == 2, "Expected --alpha to have value 2");
+
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_choices_validation_uint)
+_TEST_START(TEST_parse_same_option_twice_string)
 {
-    int a;
-    _CARGO_ADD_TEST_VALIDATE("u", &a,
-            cargo_validate_choices, 0, CARGO_UINT,
-            3, 40, 30, 10);
-    _CARGO_TEST_VALIDATE_VALUE(-45, 1);
-    _CARGO_TEST_VALIDATE_VALUE(30, 0);
-    _CARGO_TEST_VALIDATE_VALUE(40, 0);
-    _CARGO_TEST_VALIDATE_VALUE(20, 1);
-    _CARGO_TEST_VALIDATE_VALUE(10, 0);
+    char *s = NULL;
+    int i;
+    char *args[] = { "program", "--alpha", "abc", "--beta", "4", "--alpha", "def" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "s", &s);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parsed duplicate option without unique");
+    cargo_assert(s && !strcmp(s, "def"), "Expected --alpha to have value \"def\"");
+
     _TEST_CLEANUP();
+    _cargo_xfree(NULL, &s);
 }
 _TEST_END()
 
-_TEST_START(TEST_choices_validation_float)
+_TEST_START(TEST_parse_same_option_twice_with_unique)
 {
-    float a;
-    _CARGO_ADD_TEST_VALIDATE("f", &a,
-            cargo_validate_choices, 0, CARGO_FLOAT,
-            3, 3.2, 44.35, 500402.4);
-    _CARGO_TEST_VALIDATE_VALUE(3131.0, 1);
-    _CARGO_TEST_VALIDATE_VALUE(3.2, 0);
-    _CARGO_TEST_VALIDATE_VALUE(44.35, 0);
-    _CARGO_TEST_VALIDATE_VALUE(500402.4, 0);
-    _CARGO_TEST_VALIDATE_VALUE(10, 1);
+    int i;
+    int j;
+    char *args[] = { "program", "--alpha", "1", "--beta", "4", "--alpha", "2" };
+
+    ret |= cargo_add_option(cargo, CARGO_OPT_UNIQUE,
+                                "--alpha -a", "The alpha", "i", &i);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    printf("--alpha == %d\n", i);
+    cargo_assert(ret != 0, "Succesfully parsed duplicate option");
+    cargo_assert(i == 1, "Expected --alpha to have value 1");
+
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START(TEST_choices_validation_double)
+_TEST_START(TEST_parse_same_option_twice_string_with_unique)
 {
-    double a;
-    _CARGO_ADD_TEST_VALIDATE("d", &a,
-            cargo_validate_choices, 0, CARGO_DOUBLE,
-            3, 3.2, 44.35, 500402.4);
-    _CARGO_TEST_VALIDATE_VALUE(3131.0, 1);
-    _CARGO_TEST_VALIDATE_VALUE(3.2, 0);
-    _CARGO_TEST_VALIDATE_VALUE(44.35, 0);
-    _CARGO_TEST_VALIDATE_VALUE(500402.4, 0);
-    _CARGO_TEST_VALIDATE_VALUE(10, 1);
+    char *s = NULL;
+    int i;
+    char *args[] = { "program", "--alpha", "abc", "--beta", "4", "--alpha", "def" };
+
+    ret |= cargo_add_option(cargo, CARGO_OPT_UNIQUE,
+                            "--alpha -a", "The alpha", "s", &s);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    printf("--alpha = %s\n", s);
+    cargo_assert(ret != 0, "Succesfully parsed duplicate option");
+    cargo_assert(s == NULL, "Expected --alpha to have value NULL");
+
     _TEST_CLEANUP();
+    _cargo_xfree(NULL, &s);
 }
 _TEST_END()
 
-_TEST_START(TEST_choices_validation_longlong)
+_TEST_START(TEST_highlight_args)
 {
-    long long int a;
-
-    _CARGO_ADD_TEST_VALIDATE("L", &a,
-            cargo_validate_choices, 0, CARGO_LONGLONG,
-            3,
-            (long long int)-1111111,
-            (long long int)32323232,
-            (long long int)1010101);
-    _CARGO_TEST_VALIDATE_VALUE(5, 1);
-    _CARGO_TEST_VALIDATE_VALUE(-1111111, 0);
-    _CARGO_TEST_VALIDATE_VALUE(32323232, 0);
-    _CARGO_TEST_VALIDATE_VALUE(1010101, 0);
-    _CARGO_TEST_VALIDATE_VALUE(4224422, 1);
-    _TEST_CLEANUP();
-}
-_TEST_END()
-
-_TEST_START(TEST_choices_validation_ulonglong)
-{
-    unsigned long long int a;
-    _CARGO_ADD_TEST_VALIDATE("U", &a,
-            cargo_validate_choices, 0, CARGO_ULONGLONG,
-            3,
-            (unsigned long long int)11111111,
-            (unsigned long long int)32323232,
-            (unsigned long long int)1010101);
-    _CARGO_TEST_VALIDATE_VALUE(5, 1);
-    _CARGO_TEST_VALIDATE_VALUE(11111111, 0);
-    _CARGO_TEST_VALIDATE_VALUE(32323232, 0);
-    _CARGO_TEST_VALIDATE_VALUE(1010101, 0);
-    _CARGO_TEST_VALIDATE_VALUE(4224422, 1);
-    _TEST_CLEANUP();
-}
-_TEST_END()
-
-_TEST_START(TEST_double_parse)
-{
-    // Set default values and make sure they are not cleared if we parse
-    // multiple times.
-    char *args[] = { "program", "--beta", "3" };
-    char *args2[] = { "program", "--alpha", "2" };
-    int a = 5;
-    int b = 6;
-    float c = 7.0f;
-    char *s = strdup("abc");
-    cargo_assert(s, "Failed to allocate s");
+    char *args[] =
+    {
+        "program",
+        "--alpha", "abc",
+        "--beta", "def", "ghi",
+        "--crazy", "banans"
+    };
+    char *s = NULL;
+    int argc = sizeof(args) / sizeof(args[0]);
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "an option", "i", &a);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "another option", "i", &b);
-    ret |= cargo_add_option(cargo, 0, "--centauri -c", "another option", "f", &c);
-    ret |= cargo_add_option(cargo, 0, "--delta -d", "another option", "s", &s);
-    cargo_assert(ret == 0, "Failed to add options");
+    printf("With color highlight & args:\n");
+    printf("----------------------------\n");
+    ret = cargo_fprint_args(stdout,
+                        argc,
+                        args,
+                        1, // Start index.
+                        0, // flags
+                        CARGO_DEFAULT_MAX_WIDTH,
+                        3, // Highlight count.
+                        1, "^"CARGO_COLOR_RED,
+                        3, "~"CARGO_COLOR_GREEN,
+                        4, "-");
+    cargo_assert(ret == 0, "Failed call cargo_fprint_args");
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
+    printf("With highlight & args:\n");
+    printf("----------------------\n");
+    ret = cargo_fprint_args(stdout,
+                        argc,
+                        args,
+                        1, // Start index.
+                        CARGO_FPRINT_NOCOLOR, // flags
+                        CARGO_DEFAULT_MAX_WIDTH,
+                        3, // Highlight count.
+                        1, "^"CARGO_COLOR_RED,
+                        3, "~"CARGO_COLOR_GREEN,
+                        4, "-");
+    cargo_assert(ret == 0, "Failed call cargo_fprint_args");
 
-    printf("First parse:\n");
-    printf("a == %d\n", a);
-    printf("b == %d\n", b);
-    printf("c == %f\n", c);
-    printf("s == %s\n", s);
-    cargo_assert(a == 5, "Expected a == 5");
-    cargo_assert(b == 3, "Expected b == 3 after parse");
-    cargo_assert(c == 7.0f, "Expected b == 7.0f");
-    cargo_assert(s && !strcmp(s, "abc"), "Expected s == 'abc'");
+    printf("With highlight & no args:\n");
+    printf("-------------------------\n");
+    ret = cargo_fprint_args(stdout,
+                        argc,
+                        args,
+                        1, // Start index.
+                        CARGO_FPRINT_NOARGS, // flags
+                        CARGO_DEFAULT_MAX_WIDTH,
+                        3, // Highlight count.
+                        1, "^"CARGO_COLOR_RED, 3, "~"CARGO_COLOR_GREEN, 4, "-");
+    cargo_assert(ret == 0, "Failed call cargo_fprint_args");
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
-    cargo_assert(ret == 0, "Parse failed");
+    printf("With no highlight & args:\n");
+    printf("-------------------------\n");
+    ret = cargo_fprint_args(stdout,
+                        argc,
+                        args,
+                        1, // Start index.
+                        CARGO_FPRINT_NOHIGHLIGHT, // flags
+                        CARGO_DEFAULT_MAX_WIDTH,
+                        3, // Highlight count.
+                        1, "^"CARGO_COLOR_RED, 3, "~"CARGO_COLOR_GREEN, 4, "-");
+    cargo_assert(ret == 0, "Failed call cargo_fprint_args");
 
-    printf("\nSecond parse\n");
-    printf("a == %d\n", a);
-    printf("b == %d\n", b);
-    printf("c == %f\n", c);
-    printf("s == %s\n", s);
-    cargo_assert(a == 2, "Expected a == 2");
-    cargo_assert(b == 3, "Expected b == 3 after parse");
-    cargo_assert(c == 7.0f, "Expected b == 7.0f");
-    cargo_assert(s && !strcmp(s, "abc"), "Expected s == 'abc'");
+    printf("With default & not ordered:\n");
+    printf("-------------------------\n");
+    s = cargo_get_fprint_args(
+                        argc,
+                        args,
+                        1, // Start index.
+                        0, // flags
+                        CARGO_DEFAULT_MAX_WIDTH,
+                        3, // Highlight count.
+                        3, "~"CARGO_COLOR_GREEN, 1, "^"CARGO_COLOR_RED, 4, "-");
+    cargo_assert(s, "Failed call cargo_get_fprint_args");
+    printf("%s\n", s);
+    cargo_assert(strstr(s, "~~~~~~"), "Did not find highlight for --beta");
+    cargo_assert(strstr(s, "^^^^^^^"), "Did not find highlight for --alpha");
+    cargo_assert(strstr(s, "---"), "Did not find highlight for 'def'");
+    cargo_assert(strstr(s, "^^^^^^^") < strstr(s, "---"),
+        "--beta highlight after --alpha");
 
     _TEST_CLEANUP();
-    _cargo_xfree(&s);
+    _cargo_xfree(NULL, &s);
 }
 _TEST_END()
 
-_TEST_START(TEST_double_parse_clear)
+_TEST_START(TEST_positional_argument)
 {
-    char *args[] = { "program", "--beta", "3" };
-    char *args2[] = { "program", "--delta", "def" };
-    int a = 5;
-    int b = 6;
-    float c = 7.0f;
-    char *s = strdup("abc");
-    cargo_assert(s, "Failed to allocate");
+    // Here we make sure allocated values get freed on a failed parse.
+    int i;
+    int j;
+    char *args[] = { "program", "--beta", "123", "456" };
 
-    ret |= cargo_add_option(cargo, 0, "--alpha -a", "an option", "i", &a);
-    ret |= cargo_add_option(cargo, 0, "--beta -b", "another option", "i", &b);
-    ret |= cargo_add_option(cargo, 0, "--centauri -c", "another option", "f", &c);
-    ret |= cargo_add_option(cargo, 0, "--delta -d", "another option", "s", &s);
+    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", "i", &j);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
 
     ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert(s && !strcmp(s, "abc"), "Expected s to be 'abc'");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert(s && !strcmp(s, "def"), "Expected s to be 'def'");
+    printf("alpha = %d\n", j);
+    cargo_assert(ret == 0, "Failed to parse positional argument");
+    cargo_assert(j == 456, "Expected \"alpha\" to have value 456");
 
     _TEST_CLEANUP();
-    _cargo_xfree(&s);
 }
 _TEST_END()
 
-_TEST_START_EX(TEST_default_str, CARGO_AUTOCLEAN)
+_TEST_START(TEST_positional_array_argument)
 {
-    char *args[] = { "program", "--alpha", "def" };
-    char *args2[] = { "program", "--beta", "DEF" };
-    char *s1 = strdup("abc");
-    char *s2 = "ABC"; // This should not be freed!
-    cargo_assert(s1, "Failed to allocate");
+    // Here we make sure allocated values get freed on a failed parse.
+    size_t k;
+    int i;
+    int j[3];
+    int j_expect[] = { 456, 789, 101112 };
+    size_t j_count = 0;
+    char *args[] = { "program", "--beta", "123", "456", "789", "101112" };
 
-    ret |= cargo_add_option(cargo, 0,
-            "--alpha -a", "an option", "s", &s1);
-    ret |= cargo_add_option(cargo, CARGO_OPT_DEFAULT_LITERAL,
-            "--beta -b", "another option", "s", &s2);
+    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", ".[i]#", &j, &j_count, 3);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
 
     ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert(s1 && !strcmp(s1, "def"), "Expected s to be 'def'");
-
-    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert(s2 && !strcmp(s2, "DEF"), "Expected s to be 'DEF'");
+    for (k = 0; k < j_count; k++)
+    {
+        printf("alpha = %d\n", j[k]);
+    }
+    cargo_assert(ret == 0, "Failed to parse positional argument");
+    cargo_assert_array(j_count, 3, j, j_expect);
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START_EX(TEST_default_str2, CARGO_AUTOCLEAN | CARGO_DEFAULT_LITERALS)
+_TEST_START(TEST_multiple_positional_array_argument)
 {
-    char *args[] = { "program", "--alpha", "def" };
-    char *args2[] = { "program", "--beta", "DEF" };
-    char *s1 = "abc";
-    char *s2 = "ABC"; // This should not be freed!
-    cargo_assert(s1, "Failed to allocate");
+    size_t k;
+    int i;
+    int j[3];
+    int j_expect[] = { 456, 789, 101112 };
+    size_t j_count = 0;
+    float m[3];
+    float m_expect[] = { 4.3f, 2.3f, 50.34f };
+    size_t m_count = 0;
+    char *args[] =
+    {
+        "program",
+        "--beta", "123",
+        "456", "789", "101112",
+        "4.3", "2.3", "50.34"
+    };
 
-    ret |= cargo_add_option(cargo, 0,
-            "--alpha -a", "an option", "s", &s1);
-    ret |= cargo_add_option(cargo, 0,
-            "--beta -b", "another option", "s", &s2);
+    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", ".[i]#",
+                            &j, &j_count, 3);
+    ret |= cargo_add_option(cargo, 0, "mad", "Mutual Assured Destruction", ".[f]#",
+                            &m, &m_count, 3);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
 
     ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert(s1 && !strcmp(s1, "def"), "Expected s to be 'def'");
 
-    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert(s2 && !strcmp(s2, "DEF"), "Expected s to be 'DEF'");
+    for (k = 0; k < j_count; k++)
+    {
+        printf("alpha = %d\n", j[k]);
+    }
+
+    for (k = 0; k < m_count; k++)
+    {
+        printf("mad = %f\n", m[k]);
+    }
+
+    cargo_assert(ret == 0, "Failed to parse positional argument");
+    cargo_assert_array(j_count, 3, j, j_expect);
+    cargo_assert_array(m_count, 3, m, m_expect);
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START_EX(TEST_default_str3, CARGO_AUTOCLEAN | CARGO_DEFAULT_LITERALS)
+_TEST_START(TEST_multiple_positional_array_argument2)
 {
-    char *args[] = { "program", "--alpha", "def" };
-    char *s1 = "abc";
-    char *s2 = "ABC"; // Don't touch this and make sure we don't try to free it.
-    cargo_assert(s1, "Failed to allocate");
+    // Shuffle the order of arguments
+    size_t k;
+    int i;
+    int j[3];
+    int j_expect[] = { 456, 789, 101112 };
+    size_t j_count = 0;
+    float m[3];
+    float m_expect[] = { 4.3f, 2.3f, 50.34f };
+    size_t m_count = 0;
+    char *args[] =
+    {
+        "program",
+        "456", "789", "101112",
+        "--beta", "123",
+        "4.3", "2.3", "50.34"
+    };
 
-    ret |= cargo_add_option(cargo, 0,
-            "--alpha -a", "an option", "s", &s1);
-    ret |= cargo_add_option(cargo, 0,
-            "--beta -b", "another option", "s", &s2);
+    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", ".[i]#",
+                            &j, &j_count, 3);
+    ret |= cargo_add_option(cargo, 0, "mad", "Mutual Assured Destruction", ".[f]#",
+                            &m, &m_count, 3);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
 
     ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
-    cargo_assert(ret == 0, "Parse failed");
-    cargo_assert(s1 && !strcmp(s1, "def"), "Expected s1 to be 'def'");
-    cargo_assert(s2 && !strcmp(s2, "ABC"), "Expected s2 to be 'ABC'");
+
+    for (k = 0; k < j_count; k++)
+    {
+        printf("alpha = %d\n", j[k]);
+    }
+
+    for (k = 0; k < m_count; k++)
+    {
+        printf("mad = %f\n", m[k]);
+    }
+
+    cargo_assert(ret == 0, "Failed to parse positional argument");
+    cargo_assert_array(j_count, 3, j, j_expect);
+    cargo_assert(m, "m is NULL");
+    cargo_assert_array(m_count, 3, m, m_expect);
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-_TEST_START_EX(TEST_default_str_add_fail, CARGO_DEFAULT_LITERALS)
+_TEST_START(TEST_multiple_positional_array_argument3)
 {
-    char *s1 = "abc";
-    cargo_assert(s1, "Failed to allocate");
+    // Test with an allocated array of 1 or more positional arguments.
+    size_t k;
+    int i;
+    int j[3];
+    int j_expect[] = { 456, 789, 101112 };
+    size_t j_count = 0;
+    float *m = NULL;
+    float m_expect[] = { 4.3f, 2.3f, 50.34f, 0.99f };
+    size_t m_count = 0;
+    char *args[] =
+    {
+        "program",
+        "456", "789", "101112",
+        "--beta", "123",
+        "4.3", "2.3", "50.34", "0.99"
+    };
 
-    // This should fail sinc CARGO_AUTOCLEAN is not on.
-    ret = cargo_add_option(cargo, 0,
-            "--alpha -a", "an option", "s", &s1);
-    cargo_assert(ret != 0, "Expected to fail");
+    ret |= cargo_add_option(cargo, 0, "alpha", "The alpha", ".[i]#",
+                            &j, &j_count, 3);
+    ret |= cargo_add_option(cargo, 0, "mad", "Mutual Assured Destruction", "[f]+",
+                            &m, &m_count);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+
+    printf("j_count = %lu\n", j_count);
+    for (k = 0; k < j_count; k++)
+    {
+        printf("alpha = %d\n", j[k]);
+    }
+
+    printf("m_count = %lu\n", m_count);
+    for (k = 0; k < m_count; k++)
+    {
+        printf("mad = %f\n", m[k]);
+    }
+
+    cargo_assert(ret == 0, "Failed to parse positional argument");
+    cargo_assert_array(j_count, 3, j, j_expect);
+    cargo_assert_array(m_count, 4, m, m_expect);
 
     _TEST_CLEANUP();
+    _cargo_xfree(NULL, &m);
 }
 _TEST_END()
 
-_TEST_START(TEST_default_str_add_fail2)
+_TEST_START_EX(TEST_autoclean_flag, CARGO_AUTOCLEAN)
 {
-    char *s1 = "abc";
-    cargo_assert(s1, "Failed to allocate");
+    char *s = NULL;
+    char *args[] = { "program", "--alpha", "abc" };
 
-    // This should fail sinc CARGO_AUTOCLEAN is not on.
-    ret = cargo_add_option(cargo, CARGO_OPT_DEFAULT_LITERAL,
-            "--alpha -a", "an option", "s", &s1);
-    cargo_assert(ret != 0, "Expected to fail");
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "s", &s);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse valid option");
+    cargo_assert(s && !strcmp(s, "abc"), "Expected --alpha to have value \"abc\"");
 
     _TEST_CLEANUP();
+    // Note! We're not using the normal _TEST_END here so we can assert after
+    // the cargo_destroy call. Important not to use cargo_assert after
+    // _TEST_CLEANUP. Since it will result in an infinite loop!
+    cargo_destroy(&cargo);
+    if (s != NULL) return "Expected \"s\" to be freed and NULL";
 }
-_TEST_END()
+_TEST_END_NODESTROY()
 
-_TEST_START(TEST_nearly_equal)
+_TEST_START_EX(TEST_autoclean_flag_off, 0)
 {
-    ret = _cargo_nearly_equal(3.2000001, 3.2, 0.00000001);
-    ret |= _cargo_nearly_equal(3.2001, 3.2, 0.00000001);
-    cargo_assert(ret == 0, "Should be equal");
+    char *s = NULL;
+    char *args[] = { "program", "--alpha", "abc" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "s", &s);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse valid option");
+    cargo_assert(s && !strcmp(s, "abc"), "Expected --alpha to have value \"abc\"");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+    if (s == NULL) return "Expected \"s\" to be non-NULL";
+    _cargo_free(NULL, s);
+}
+_TEST_END_NODESTROY()
+
+_TEST_START(TEST_parse_zero_or_more_with_args)
+{
+    int *i = NULL;
+    int i_expect[] = { 1, 2 };
+    size_t i_count = 0;
+    int j = 0;
+    char *args[] = { "program", "--beta", "2", "--alpha", "1", "2" };
+
+    cargo_get_flags(cargo);
+    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "[i]*", &i, &i_count);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert_array(i_count, 2, i, i_expect);
 
     _TEST_CLEANUP();
+    // Auto cleanup enabled.
 }
 _TEST_END()
 
-_TEST_START(TEST_cargo_strdup_invalid_arg)
+_TEST_START(TEST_parse_zero_or_more_without_args)
 {
-    char *p = _cargo_strdup(NULL);
-    cargo_assert(p == NULL, "Expected strdup to fail");
-    cargo_assert(errno == EINVAL, "Expected indication of faulty input argument");
+    int *i = NULL;
+    size_t i_count = 0;
+    int j = 0;
+    char *args[] = { "program", "--beta", "2", "--alpha" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "[i]*", &i, &i_count);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &j);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert(i == NULL, "Expected i to be NULL");
+    cargo_assert(i_count == 0, "Expected i count to be 0");
 
     _TEST_CLEANUP();
 }
 _TEST_END()
 
-// TODO: Test default values for string lists
-// TODO: Test giving add_option an invalid alias
-// TODO: Test --help
-// TODO: Test CARGO_UNIQUE_OPTS
-// TODO: Test CARGO_NOWARN
-// TODO: Test cargo_parse_result_t
-// TODO: Add test to make sure bool array is not allowed.
+_TEST_START(TEST_parse_zero_or_more_with_positional)
+{
+    int *pos = NULL;
+    int pos_expect[] = { 1, 2 };
+    size_t pos_count = 0;
+    int *i = NULL;
+    int i_expect[] = { 3, 4 };
+    size_t i_count = 0;
+    int *j = NULL;
+    int j_expect[] = { 5, 6 };
+    size_t j_count = 0;
+    char *args[] = { "program", "1", "2", "--alpha", "3", "4", "--beta", "5", "6" };
 
-//
-// List of all test functions to run:
-//
-typedef const char *(* cargo_test_f)();
+    cargo_get_flags(cargo);
+    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
 
-typedef struct cargo_test_s
+    ret |= cargo_add_option(cargo, 0, "pos", "The positional", "[i]*", &pos, &pos_count);
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "The alpha", "[i]*", &i, &i_count);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "[i]*", &j, &j_count);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert_array(pos_count, 2, pos, pos_expect);
+    cargo_assert_array(i_count, 2, i, i_expect);
+    cargo_assert_array(j_count, 2, j, j_expect);
+
+    _TEST_CLEANUP();
+    // Auto cleanup enabled.
+}
+_TEST_END()
+
+_TEST_START(TEST_required_option_missing)
 {
-    const char *name;
-    cargo_test_f f;
-    int success;
-    int ran;
-    const char *error;
-} cargo_test_t;
+    int i;
+    int j;
+    char *args[] = { "program", "--beta", "123", "456" };
 
-#define CARGO_ADD_TEST(test) { #test, test, 0, 0, NULL }
+    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED,
+                            "--alpha", "The alpha", "i", &j);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
 
-cargo_test_t tests[] =
+    cargo_set_internal_usage_flags(cargo, CARGO_USAGE_HIDE_DESCRIPTION);
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Succeeded with missing required option");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_required_option)
 {
-    CARGO_ADD_TEST(TEST_no_args_bool_option),
-    CARGO_ADD_TEST(TEST_add_integer_option),
-    CARGO_ADD_TEST(TEST_add_uinteger_option),
-    CARGO_ADD_TEST(TEST_add_float_option),
-    CARGO_ADD_TEST(TEST_add_bool_option),
-    CARGO_ADD_TEST(TEST_add_double_option),
-    CARGO_ADD_TEST(TEST_add_static_string_option),
-    CARGO_ADD_TEST(TEST_add_alloc_string_option),
-    CARGO_ADD_TEST(TEST_add_static_int_array_option),
-    CARGO_ADD_TEST(TEST_add_static_uint_array_option),
-    CARGO_ADD_TEST(TEST_add_static_long_long_int_array_option),
-    CARGO_ADD_TEST(TEST_add_static_unsigned_long_long_int_array_option),
-    CARGO_ADD_TEST(TEST_add_static_float_array_option),
-    CARGO_ADD_TEST(TEST_add_static_double_array_option),
-    CARGO_ADD_TEST(TEST_add_static_string_array_option),
-    CARGO_ADD_TEST(TEST_add_alloc_fixed_int_array_option),
-    CARGO_ADD_TEST(TEST_add_alloc_fixed_uint_array_option),
-    CARGO_ADD_TEST(TEST_add_alloc_fixed_float_array_option),
-    CARGO_ADD_TEST(TEST_add_alloc_fixed_double_array_option),
-    CARGO_ADD_TEST(TEST_add_alloc_fixed_string_array_option),
-    CARGO_ADD_TEST(TEST_add_alloc_fixed_string_array_option2),
-    CARGO_ADD_TEST(TEST_add_alloc_fixed_string_array_option3),
-    CARGO_ADD_TEST(TEST_add_alloc_fixed_string_array_option4),
-    CARGO_ADD_TEST(TEST_add_alloc_dynamic_int_array_option),
-    CARGO_ADD_TEST(TEST_add_alloc_dynamic_int_array_option_noargs),
-    CARGO_ADD_TEST(TEST_print_usage),
-    CARGO_ADD_TEST(TEST_get_usage_settings),
-    CARGO_ADD_TEST(TEST_autohelp_default),
-    CARGO_ADD_TEST(TEST_autohelp_off),
-    CARGO_ADD_TEST(TEST_get_usage),
-    CARGO_ADD_TEST(TEST_misspelled_argument),
-    CARGO_ADD_TEST(TEST_add_duplicate_option),
-    CARGO_ADD_TEST(TEST_get_extra_args),
-    CARGO_ADD_TEST(TEST_get_unknown_opts),
-    CARGO_ADD_TEST(TEST_cargo_split),
-    CARGO_ADD_TEST(TEST_parse_invalid_value),
-    CARGO_ADD_TEST(TEST_parse_twice),
-    CARGO_ADD_TEST(TEST_parse_missing_value),
-    CARGO_ADD_TEST(TEST_parse_missing_array_value),
-    CARGO_ADD_TEST(TEST_parse_missing_array_value_ensure_free),
-    CARGO_ADD_TEST(TEST_parse_same_option_twice),
-    CARGO_ADD_TEST(TEST_parse_same_option_twice_string),
-    CARGO_ADD_TEST(TEST_parse_same_option_twice_with_unique),
-    CARGO_ADD_TEST(TEST_parse_same_option_twice_string_with_unique),
-    CARGO_ADD_TEST(TEST_highlight_args),
-    CARGO_ADD_TEST(TEST_positional_argument),
-    CARGO_ADD_TEST(TEST_positional_array_argument),
-    CARGO_ADD_TEST(TEST_multiple_positional_array_argument),
-    CARGO_ADD_TEST(TEST_multiple_positional_array_argument2),
-    CARGO_ADD_TEST(TEST_multiple_positional_array_argument3),
-    CARGO_ADD_TEST(TEST_autoclean_flag),
-    CARGO_ADD_TEST(TEST_autoclean_flag_off),
-    CARGO_ADD_TEST(TEST_parse_zero_or_more_with_args),
-    CARGO_ADD_TEST(TEST_parse_zero_or_more_without_args),
-    CARGO_ADD_TEST(TEST_parse_zero_or_more_with_positional),
-    CARGO_ADD_TEST(TEST_required_option_missing),
-    CARGO_ADD_TEST(TEST_required_option),
-    CARGO_ADD_TEST(TEST_custom_callback),
-    CARGO_ADD_TEST(TEST_custom_callback_fixed_array),
-    CARGO_ADD_TEST(TEST_custom_callback_fixed_array_no_count),
-    CARGO_ADD_TEST(TEST_many_options_custom),
-    CARGO_ADD_TEST(TEST_custom_callback_array),
-    CARGO_ADD_TEST(TEST_zero_or_more_with_arg),
-    CARGO_ADD_TEST(TEST_zero_or_more_without_arg),
-    CARGO_ADD_TEST(TEST_group),
-    CARGO_ADD_TEST(TEST_many_groups),
-    CARGO_ADD_TEST(TEST_mutex_group_guard),
-    CARGO_ADD_TEST(TEST_mutex_group_require_one),
-    CARGO_ADD_TEST(TEST_cargo_split_commandline),
-    CARGO_ADD_TEST(TEST_missing_last_arg),
-    CARGO_ADD_TEST(TEST_cargo_set_max_width),
-    CARGO_ADD_TEST(TEST_cargo_snprintf),
-    CARGO_ADD_TEST(TEST_cargo_set_prefix),
-    CARGO_ADD_TEST(TEST_cargo_aapendf),
-    CARGO_ADD_TEST(TEST_cargo_get_fprint_args),
-    CARGO_ADD_TEST(TEST_cargo_get_fprint_args_long),
-    CARGO_ADD_TEST(TEST_cargo_fprintf),
-    CARGO_ADD_TEST(TEST_cargo_bool_count),
-    CARGO_ADD_TEST(TEST_cargo_bool_count_compact),
-    CARGO_ADD_TEST(TEST_fixed_one_or_more_array),
-    CARGO_ADD_TEST(TEST_fixed_zero_or_more_array),
-    CARGO_ADD_TEST(TEST_fixed_fail_array),
-    CARGO_ADD_TEST(TEST_user_context),
-    CARGO_ADD_TEST(TEST_group_user_context),
-    CARGO_ADD_TEST(TEST_mutex_group_context_fail),
-    CARGO_ADD_TEST(TEST_cargo_get_option_mutex_groups),
-    CARGO_ADD_TEST(TEST_invalid_format_char),
-    CARGO_ADD_TEST(TEST_option_target_null),
-    CARGO_ADD_TEST(TEST_autoclean_string_list),
-    CARGO_ADD_TEST(TEST_fail_custom_callback),
-    CARGO_ADD_TEST(TEST_mutex_group_usage),
-    CARGO_ADD_TEST(TEST_mutex_group_usage2),
-    CARGO_ADD_TEST(TEST_mutex_group_usage3),
-    CARGO_ADD_TEST(TEST_mutex_group_usage_set_metavar),
-    CARGO_ADD_TEST(TEST_dummy_callback),
-    CARGO_ADD_TEST(TEST_group_add_missing_group),
-    CARGO_ADD_TEST(TEST_bool_acc_or),
-    CARGO_ADD_TEST(TEST_bool_acc_and),
-    CARGO_ADD_TEST(TEST_bool_acc_plus),
-    CARGO_ADD_TEST(TEST_bool_acc_store),
-    CARGO_ADD_TEST(TEST_mutex_order_group_before),
-    CARGO_ADD_TEST(TEST_mutex_order_group_after),
-    CARGO_ADD_TEST(TEST_medium_length_usage),
-    CARGO_ADD_TEST(TEST_cargo_get_unknown_copy),
-    CARGO_ADD_TEST(TEST_cargo_get_args_copy),
-    CARGO_ADD_TEST(TEST_cargo_set_option_description),
-    CARGO_ADD_TEST(TEST_parse_stop),
-    CARGO_ADD_TEST(TEST_parse_stop_hard),
-    CARGO_ADD_TEST(TEST_parse_stop_hard_fail),
-    CARGO_ADD_TEST(TEST_cargo_zero_or_one_with_arg),
-    CARGO_ADD_TEST(TEST_cargo_zero_or_one_without_arg),
-    CARGO_ADD_TEST(TEST_cargo_zero_or_one_without_arg2),
-    CARGO_ADD_TEST(TEST_late_unknown_options),
-    CARGO_ADD_TEST(TEST_early_unknown_options),
-    CARGO_ADD_TEST(TEST_late_unknown_options_no_fail),
-    CARGO_ADD_TEST(TEST_late_unknown_options_no_fail_stop),
-    CARGO_ADD_TEST(TEST_cargo_set_error),
-    CARGO_ADD_TEST(TEST_cargo_set_error_append),
-    CARGO_ADD_TEST(TEST_cargo_set_error_append2),
-    CARGO_ADD_TEST(TEST_cargo_set_memfunctions),
-    CARGO_ADD_TEST(TEST_cargo_malloc_zero_bytes),
-    CARGO_ADD_TEST(TEST_test_hidden_option),
-    CARGO_ADD_TEST(TEST_test_hidden_short_option),
-    CARGO_ADD_TEST(TEST_override_short_usage),
-    CARGO_ADD_TEST(TEST_duplicate_alias),
-    CARGO_ADD_TEST(TEST_cargo_get_option_type),
-    CARGO_ADD_TEST(TEST_cargo_large_list_and_usage),
-    CARGO_ADD_TEST(TEST_cargo_large_list_and_usage2),
-    CARGO_ADD_TEST(TEST_int_range_validation),
-    CARGO_ADD_TEST(TEST_float_range_validation),
-    CARGO_ADD_TEST(TEST_double_range_validation),
-    CARGO_ADD_TEST(TEST_uint_range_validation),
-    CARGO_ADD_TEST(TEST_longlong_range_validation),
-    CARGO_ADD_TEST(TEST_ulonglong_range_validation),
-    CARGO_ADD_TEST(TEST_choices_validation),
-    CARGO_ADD_TEST(TEST_choices_validation_case_sensitive),
-    CARGO_ADD_TEST(TEST_choices_validation_int),
-    CARGO_ADD_TEST(TEST_choices_validation_uint),
-    CARGO_ADD_TEST(TEST_choices_validation_float),
-    CARGO_ADD_TEST(TEST_choices_validation_double),
-    CARGO_ADD_TEST(TEST_choices_validation_longlong),
-    CARGO_ADD_TEST(TEST_choices_validation_ulonglong),
-    CARGO_ADD_TEST(TEST_double_parse),
-    CARGO_ADD_TEST(TEST_double_parse_clear),
-    CARGO_ADD_TEST(TEST_default_str),
-    CARGO_ADD_TEST(TEST_default_str2),
-    CARGO_ADD_TEST(TEST_default_str3),
-    CARGO_ADD_TEST(TEST_default_str_add_fail),
-    CARGO_ADD_TEST(TEST_default_str_add_fail2),
-    CARGO_ADD_TEST(TEST_nearly_equal),
-    CARGO_ADD_TEST(TEST_cargo_strdup_invalid_arg)
-};
+    int i;
+    int j;
+    char *args[] = { "program", "--beta", "123", "456", "--alpha", "789" };
 
-#define CARGO_NUM_TESTS (sizeof(tests) / sizeof(tests[0]))
+    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED,
+                            "--alpha", "The alpha", "i", &j);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
 
-static void _test_print_names()
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed with existing required option");
+    cargo_assert(j == 789, "Expected j == 789");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+typedef struct _test_data_s
 {
-    int i;
+    int width;
+    int height;
+} _test_data_t;
 
-    for (i = 0; i < (int)CARGO_NUM_TESTS; i++)
+static int _test_cb(cargo_t ctx, void *user, const char *optname,
+                    int argc, char **argv)
+{
+    assert(ctx);
+    assert(user);
+
+    _test_data_t *u = (_test_data_t *)user;
+    memset(u, 0, sizeof(_test_data_t));
+
+    if (argc > 0)
     {
-        printf("%2d: %s\n", (i + 1), tests[i].name);
+        if (sscanf(argv[0], "%dx%d", &u->width, &u->height) != 2)
+        {
+            return -1;
+        }
+
+        return 1; // We ate 1 argument.
     }
+
+    return -1;
 }
 
-static int _test_find_test_index(const char *name)
+_TEST_START(TEST_custom_callback)
+{
+    _test_data_t data;
+    char *args[] = { "program", "--alpha", "128x64" };
+
+    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "c", _test_cb, &data);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    printf("%dx%d\n", data.width, data.height);
+    cargo_assert(data.width == 128, "Width expected to be 128");
+    cargo_assert(data.height == 64, "Height expected to be 128");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+static int _test_cb_fixed_array(cargo_t ctx, void *user, const char *optname,
+                                int argc, char **argv)
 {
     int i;
+    assert(ctx);
+    assert(user);
 
-    for (i = 0; i < (int)CARGO_NUM_TESTS; i++)
+    _test_data_t *u = (_test_data_t *)user;
+    memset(u, 0, sizeof(_test_data_t));
+
+    for (i = 0; i < argc; i++)
     {
-        if (!strcmp(name, tests[i].name))
+        if (sscanf(argv[i], "%dx%d", &u[i].width, &u[i].height) != 2)
         {
-            return i + 1;
+            return -1;
         }
     }
 
-    return -1;
+    return i;
 }
 
-int main(int argc, char **argv)
+_TEST_START(TEST_custom_callback_fixed_array)
 {
-    cargo_t cargo;
     size_t i;
-    int was_error = 0;
-    int tests_to_run[CARGO_NUM_TESTS];
-    size_t num_tests = 0;
-    size_t success_count = 0;
-    int all = 0;
-    int quiet = 0;
-    int test_index = 0;
-    int shortlist = 0;
-    int start = 1;
-    int ret = 0;
-    char **test_names = NULL;
-    size_t test_name_count = 0;
-    cargo_test_t *t;
+    #define DATA_COUNT 5
+    _test_data_t data[DATA_COUNT];
+    size_t data_count = 0;
+    _test_data_t data_expect[] =
+    {
+        { 128, 64 },
+        { 32, 16 },
+        { 24, 32 },
+        { 32, 32 },
+        { 24, 24 }
+    };
+    char *args[] = { "program", "--alpha", "128x64", "32x16", "24x32", "32x32", "24x24" };
 
-    memset(tests_to_run, 0, sizeof(tests_to_run));
+    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "[c]#",
+                            _test_cb_fixed_array, &data, &data_count, DATA_COUNT);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+
+    cargo_assert(data_count == DATA_COUNT, "Expected data_count == DATA_COUNT");
+
+    for (i = 0; i < data_count; i++)
+    {
+        printf("%dx%d == %dx%d\n",
+            data[i].width, data[i].height,
+            data_expect[i].width, data_expect[i].height);
+        cargo_assert(data[i].width == data_expect[i].width, "Unexpected width");
+        cargo_assert(data[i].height == data_expect[i].height, "Unexpected height");
+    }
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+typedef struct _test_rect_s
+{
+    int x;
+    int y;
+    int w;
+    int h;
+} _test_rect_t;
+
+static int _test_cb_fixed_array_no_count(cargo_t ctx, void *user,
+                                        const char *optname,
+                                        int argc, char **argv)
+{
+    _test_rect_t *rect = (_test_rect_t *)user;
+
+    if (argc != 4)
+    {
+        cargo_set_error(ctx, 0, "Not enough!");
+        return -1;
+    }
+
+    rect->x = atoi(argv[0]);
+    rect->y = atoi(argv[1]);
+    rect->w = atoi(argv[2]);
+    rect->h = atoi(argv[3]);
+
+    return argc;
+}
+
+_TEST_START(TEST_many_options_custom)
+{
+    size_t j = 0;
+    _test_rect_t rect;
+    #define OPT_COUNT 100
+    int vals[OPT_COUNT];
+    char optname[256];
+    char *args[] = { "program", "--help" };
+
+    // This reproduces a bug seen on the raspberry pi where
+    // you get a SIGSEV because the internal list for a custom
+    // variable would be freed and then target count was dereferenced
+    // (which now was freed).
+    for (j = 0; j < OPT_COUNT + 1; j++)
+    {
+        if (j == (OPT_COUNT / 2))
+        {
+            ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "[c]#",
+                            _test_cb_fixed_array_no_count,
+                            &rect, NULL, 4);
+            cargo_assert(ret == 0, "Failed to add options");
+            continue;
+        }
+        cargo_snprintf(optname, sizeof(optname), "--opto%02d",  j+1);
+        ret |= cargo_add_option(cargo, 0, optname, LOREM_IPSUM, "i", &vals[j]);
+        cargo_assert(ret == 0, "Failed to add option");
+    }
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+
+    cargo_print_usage(cargo, 0);
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_custom_callback_fixed_array_no_count)
+{
+    _test_rect_t rect;
+    char *args[] = { "program", "--alpha", "1", "2", "3", "4" };
+
+    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+
+    // We set the count var to NULL. This should work fine!
+    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "[c]#",
+                            _test_cb_fixed_array_no_count,
+                            &rect, NULL, 4);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    cargo_assert(rect.x == 1, "Expected x = 1");
+    cargo_assert(rect.y == 2, "Expected y = 2");
+    cargo_assert(rect.w == 3, "Expected w = 3");
+    cargo_assert(rect.h == 4, "Expected h = 4");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+static int _test_cb_array(cargo_t ctx, void *user, const char *optname,
+                                int argc, char **argv)
+{
+    int i;
+    assert(ctx);
+    assert(user);
+    _test_data_t **u = (_test_data_t **)user;
+    _test_data_t *data;
+
+    if (!(*u = _cargo_calloc(&ctx->mem, argc, sizeof(_test_data_t))))
+    {
+        return -1;
+    }
+
+    data = *u;
+
+    for (i = 0; i < argc; i++)
+    {
+        if (sscanf(argv[i], "%dx%d", &data[i].width, &data[i].height) != 2)
+        {
+            return -1;
+        }
+    }
+
+    return i; // How many arguments we ate.
+}
+
+_TEST_START(TEST_custom_callback_array)
+{
+    size_t i;
+    _test_data_t *data = NULL;
+    size_t data_count = 0;
+    _test_data_t data_expect[] =
+    {
+        { 128, 64 },
+        { 32, 16 },
+        { 24, 32 },
+        { 32, 32 },
+        { 24, 24 }
+    };
+    char *args[] = { "program", "--alpha", "128x64", "32x16", "24x32", "32x32", "24x24" };
+
+    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "[c]*",
+                            _test_cb_array, &data, &data_count, DATA_COUNT);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+
+    cargo_assert(data_count == 5, "Expected data_count == 5");
+
+    for (i = 0; i < data_count; i++)
+    {
+        printf("%dx%d == %dx%d\n",
+            data[i].width, data[i].height,
+            data_expect[i].width, data_expect[i].height);
+        cargo_assert(data[i].width == data_expect[i].width, "Unexpected width");
+        cargo_assert(data[i].height == data_expect[i].height, "Unexpected height");
+    }
+
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &data);
+}
+_TEST_END()
+
+_TEST_START(TEST_zero_or_more_with_arg)
+{
+    int i = 0;
+    int j = 0;
+    char *args[] = { "program", "--alpha", "789", "--beta", "123", "456" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "i?", &j, "3");
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed zero or more args parse");
+    cargo_assert(j == 789, "Expected j == 789");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_zero_or_more_without_arg)
+{
+    int i = 0;
+    int j = 5;
+    char *args[] = { "program", "--alpha", "--beta", "123", "456" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "i?", &j, "3");
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed zero or more args parse");
+    cargo_assert(j == 3, "Expected j == 3");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_group)
+{
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    int l = 0;
+    char *args[] = { "program", "--alpha", "--beta", "123", "456" };
+    cargo_set_max_width(cargo, 60);
+
+    ret = cargo_add_group(cargo, 0, "group1", "The Group 1", "This group is 1st");
+    ret |= cargo_add_group(cargo, 0, "group2", "The Group 2", LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM);
+    cargo_assert(ret == 0, "Failed to add group");
+
+    // Add options to the group using inline method.
+    ret |= cargo_add_option(cargo, 0, "   <group1> --alpha", "The alpha", "i?", &j, "3");
+    ret |= cargo_add_option(cargo, 0, "<group1> --beta -b", LOREM_IPSUM, "i", &i);
+
+    // Try using the API to add the option to the group.
+    ret |= cargo_add_option(cargo, 0, "--centauri", "The alpha centauri", "i?", &k, "4");
+    ret |= cargo_group_add_option(cargo, "group1", "--centauri");
+
+    ret |= cargo_add_option(cargo, 0, "<group2> --delta", LOREM_IPSUM LOREM_IPSUM, "i?", &l, "5");
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed zero or more args parse");
+
+    cargo_print_usage(cargo, 0);
+
+    // Make sure the group can be hidden.
+    cargo_assert(strstr(cargo_get_usage(cargo, 0), "Group 2") != NULL, "Did not find Group 2");
+    cargo_group_set_flags(cargo, "group2", CARGO_GROUP_HIDE);
+    cargo_assert(strstr(cargo_get_usage(cargo, 0), "Group 2") == NULL, "Found Group 2");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_many_groups)
+{
+    size_t i = 0;
+    size_t j = 0;
+    #define GROUP_COUNT 20
+    #define GROUP_OPT_COUNT 20
+    int vals[GROUP_COUNT][GROUP_OPT_COUNT];
+    char grpname[256];
+    char title[256];
+    char optname[256];
+    char *args[] = { "program", "--optg01o01", "5", "--optg02o02", "123" };
+
+    for (i = 0; i < GROUP_COUNT; i++)
+    {
+        cargo_snprintf(grpname, sizeof(grpname), "group%d", i+1);
+        cargo_snprintf(title, sizeof(title), "The Group%d", i+1);
+        ret |= cargo_add_group(cargo, 0, grpname, title, "Group");
+        cargo_assert(ret == 0, "Failed to add group");
+
+        for (j = 0; j < GROUP_OPT_COUNT; j++)
+        {
+            cargo_snprintf(optname, sizeof(optname), "--optg%02do%02d", i+1, j+1);
+            ret |= cargo_add_option(cargo, 0, optname, LOREM_IPSUM, "i", &vals[i][j]);
+            ret |= cargo_group_add_option(cargo, grpname, optname);
+            cargo_assert(ret == 0, "Failed to add option");
+        }
+    }
+
+    cargo_assert(ret == 0, "Failed to add groups");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed zero or more args parse");
+    cargo_assert(vals[0][0] == 5, "Expected --optg01o01 to be 5");
+    cargo_assert(vals[1][1] == 123, "Expected --optg02o02 to be 123");
+
+    cargo_print_usage(cargo, 0);
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_mutex_group_guard)
+{
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    char *args[] = { "program", "--alpha", "--beta", "123", "456" };
+
+    ret = cargo_add_mutex_group(cargo, 0, "mutex_group1", NULL, NULL);
+    cargo_assert(ret == 0, "Failed to add mutex group");
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "i?", &j, "3");
+    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--alpha");
+
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--beta");
+
+    ret |= cargo_add_option(cargo, 0, "--centauri", "The centauri", "i?", &k, "3");
+    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--centauri");
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // We parse args with 2 members of the mutex group.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Succesfully parsed mutex group with 2 group members");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_mutex_group_require_one)
+{
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    char *args[] = { "program", "--centauri", "5" };
+
+    ret = cargo_add_mutex_group(cargo,
+                                CARGO_MUTEXGRP_ONE_REQUIRED,
+                                "mutex_group1", NULL, NULL);
+    cargo_assert(ret == 0, "Failed to add mutex group");
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "The alpha", "i", &j);
+    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--alpha");
+
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "The beta", "i", &i);
+    ret |= cargo_mutex_group_add_option(cargo, "mutex_group1", "--beta");
+
+    // Don't add this to te mutex group.
+    ret |= cargo_add_option(cargo, 0, "--centauri", "The centauri", "i?", &k, "3");
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // We parse args with no members of the mutex group.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0,
+        "Succesfully parsed mutex group with no mutex member when 1 required");
+    cargo_assert(k == 5, "Expected k == 5");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_split_commandline)
+{
+    const char *cmd = "abc def \"ghi jkl\"";
+    char *argv_expect[] =
+    {
+        "abc", "def", "ghi jkl"
+    };
+    char **argv = NULL;
+    int argc = 0;
+    int i;
+    ret = 0;
+
+    argv = cargo_split_commandline(0, cmd, &argc);
+    for (i = 0; i < argc; i++)
+    {
+        printf("%s\n", argv[i]);
+    }
+    cargo_assert(argv != NULL, "Got NULL argv");
+    cargo_assert_str_array((size_t)argc, 3, argv, argv_expect);
+    cargo_free_commandline(&argv, argc);
+
+    argv = cargo_split_commandline(0, NULL, &argc);
+    cargo_assert(argv == NULL, "Expected NULL argv");
+
+    #ifndef _WIN32
+    argv = cargo_split_commandline(0, "cmd not \"bla closed", &argc);
+    cargo_assert(argv == NULL, "Invalid commandline parsed as ok");
+    #endif
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_missing_last_arg)
+{
+    int k = 0;
+    char *args[] = { "program", "--centauri" };
+
+    ret |= cargo_add_option(cargo, 0, "--centauri", "The centauri", "i", &k);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Succesfully parsed option without argument");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+static const char *_cargo_test_verify_usage_length(const char *usage, int width)
+{
+    char *ret = NULL;
+    char **lines = NULL;
+    size_t line_count = 0;
+    size_t len = 0;
+    size_t i = 0;
+    assert(usage);
+    assert(width);
+
+    printf("%s\n", usage);
+
+    if (!(lines = _cargo_split(NULL, usage, "\n", &line_count)))
+    {
+        return "Failed to split usage";
+    }
+
+    printf("Line count: %lu\n", line_count);
+
+    for (i = 0; i < line_count; i++)
+    {
+        len = strlen(lines[i]);
+        printf("%02lu Len: %02lu:%s\n", i, len, lines[i]);
+
+        if ((int)len > width)
+        {
+            ret = "Got usage line longer than specified";
+            break;
+        }
+    }
+
+    _cargo_free_str_list(NULL, &lines, &line_count);
+    return ret;
+}
+
+_TEST_START(TEST_cargo_set_max_width)
+{
+    int i;
+    int j;
+    const char *err = NULL;
+    const char *usage = NULL;
+    char *args[] = { "program", "--alpha", "789", "--beta", "123" };
+
+    cargo_set_description(cargo, LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM);
+    cargo_set_epilog(cargo, LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", LOREM_IPSUM, "i", &j);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", LOREM_IPSUM, "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    cargo_set_max_width(cargo, 40);
+    cargo_assert(cargo_get_width(cargo, 0) == 40, "Unexpected witdth returned");
+    usage = cargo_get_usage(cargo, 0);
+    cargo_assert(usage != NULL, "Got NULL usage on width 40");
+    err = _cargo_test_verify_usage_length(usage, 40);
+    cargo_assert(err == NULL, err);
+
+    // Set a size bigger than CARGO_MAX_MAX_WIDTH.
+    cargo_set_max_width(cargo, CARGO_MAX_MAX_WIDTH * 2);
+    cargo_assert(cargo_get_width(cargo, 0) == CARGO_MAX_MAX_WIDTH,
+        "Got greater width than CARGO_MAX_MAX_WIDTH");
+    usage = cargo_get_usage(cargo, 0);
+    cargo_assert(usage != NULL, "Got NULL usage on width CARGO_MAX_MAX_WIDTH * 2");
+    err = _cargo_test_verify_usage_length(usage, CARGO_MAX_MAX_WIDTH);
+    cargo_assert(err == NULL, err);
+
+    // Just make sure this doesn't crash.
+    // This could return -1, and we cannot assert on any return value
+    // since it's specific to the system the test is run on.
+    cargo_get_width(cargo, CARGO_WIDTH_RAW);
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_snprintf)
+{
+    char buf[32];
+    ret = cargo_snprintf(buf, 0, "%d", 123);
+    printf("%d\n", ret);
+    cargo_assert(ret == 0, "Expected ret == 0 when given 0 buflen");
+
+    // Let memcheckers make sure this doesn't write past end of buffer
+    ret = cargo_snprintf(buf, sizeof(buf), "%s", LOREM_IPSUM);
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_set_prefix)
+{
+    int i;
+    int j;
+    int k;
+    char *args[] = { "program", "--alpha", "789", "++beta", "123" };
+
+    cargo_set_prefix(cargo, "+");
+
+    ret = cargo_add_option(cargo, 0, "--alpha", LOREM_IPSUM, "i", &j);
+    cargo_assert(ret != 0, "Succesfully added argument with invalid prefix");
+
+    ret = cargo_add_option(cargo, 0, "centauri c", LOREM_IPSUM, "i", &k);
+    cargo_assert(ret != 0, "Expected positional argument to reject alias");
+
+    ret = cargo_add_option(cargo, 0, "++beta +b", LOREM_IPSUM, "i", &i);
+    cargo_assert(ret == 0, "Failed to add option with valid prefix '+'");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse with custom prefix");
+    cargo_assert(i == 123, "Expected ++beta to have value 123");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_aapendf)
+{
+    char *s = NULL;
+    size_t lbefore = 0;
+    size_t lorem_lens = (strlen(LOREM_IPSUM) * 3);
+    cargo_astr_t astr;
+
+    // This test is only valid if the test strings causes a realloc.
+    assert(lorem_lens > CARGO_ASTR_DEFAULT_SIZE);
+
+    memset(&astr, 0, sizeof(cargo_astr_t));
+    astr.s = &s;
+
+    ret = cargo_aappendf(&astr, "%s", "Some short string");
+    cargo_assert(ret > 0, "Expected ret > 0");
+    lbefore = astr.l;
+
+    // Trigger realloc.
+    cargo_aappendf(&astr, "%s%s%s", LOREM_IPSUM, LOREM_IPSUM, LOREM_IPSUM);
+    cargo_assert(ret > 0, "Expected ret > 0");
+    cargo_assert(astr.offset > lorem_lens, "Expected longer string");
+    cargo_assert(astr.l > lbefore, "Expected realloc");
+
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &s);
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_get_fprint_args)
+{
+    int i = 0;
+    int j = 0;
+    char *argv[] = { "program", "first", "second", "--third", "123" };
+    int argc = sizeof(argv) / sizeof(argv[0]);
+    char *s = NULL;
+    int start;
+    cargo_highlight_t highlights[] =
+    {
+        { 1, "#"CARGO_COLOR_YELLOW },
+        { 4, "="CARGO_COLOR_GREEN }
+    };
+    ret = 0;
+
+    start = 0;
+    printf("\nStart %d:\n", start);
+    printf("----------\n");
+    s = cargo_get_fprint_args(argc, argv,
+                            start,  // start.
+                            0,      // flags.
+                            CARGO_DEFAULT_MAX_WIDTH,
+                            3,      // highlight_count (how many follows).
+                            0, "^"CARGO_COLOR_RED,
+                            2 ,"~",
+                            4, "*"CARGO_COLOR_CYAN);
+    cargo_assert(s != NULL, "Got NULL fprint string");
+    printf("%s\n", s);
+    for (i = start; i < argc; i++)
+    {
+        cargo_assert(strstr(s, argv[i]), "Expected to find argv params");
+    }
+    cargo_assert(strstr(s, "^"), "Expected ^ highlight");
+    cargo_assert(strstr(s, CARGO_COLOR_RED), "Expected red color for ^");
+    cargo_assert(strstr(s, "~"), "Expected ~ highlight");
+    cargo_assert(strstr(s, "*"), "Expected * highlight");
+    cargo_assert(strstr(s, CARGO_COLOR_CYAN), "Expected red color for *");
+    _cargo_xfree(NULL, &s);
+
+    // Other start index.
+    start = 1;
+    printf("\nStart %d:\n", start);
+    printf("----------\n");
+    s = cargo_get_fprint_args(argc, argv,
+                            start,  // start.
+                            0,      // flags.
+                            CARGO_DEFAULT_MAX_WIDTH,
+                            3,      // highlight_count (how many follows).
+                            0, "^"CARGO_COLOR_RED, // Should not be shown.
+                            2 ,"~",
+                            4, "*"CARGO_COLOR_CYAN);
+    cargo_assert(s != NULL, "Got NULL fprint string");
+    printf("%s\n", s);
+    for (i = start; i < argc; i++)
+    {
+        cargo_assert(strstr(s, argv[i]), "Expected to find argv params");
+    }
+    cargo_assert(!strstr(s, "^"), "Expected NO ^ highlight");
+    cargo_assert(!strstr(s, CARGO_COLOR_RED), "Expected NO red color for ^");
+    cargo_assert(strstr(s, "~"), "Expected ~ highlight");
+    cargo_assert(strstr(s, "*"), "Expected red color for *");
+    cargo_assert(strstr(s, CARGO_COLOR_CYAN), "Expected red color for *");
+    _cargo_xfree(NULL, &s);
+
+    // Pass a list instead of var args.
+    for (i = 0; i < argc+1; i++)
+    {
+        start = i;
+        printf("\nList start %d:\n", start);
+        printf("-------------\n");
+        s = cargo_get_fprintl_args(argc, argv,
+                                start,  // start.
+                                0,      // flags
+                                CARGO_DEFAULT_MAX_WIDTH,
+                                sizeof(highlights) / sizeof(highlights[0]),
+                                highlights);
+        printf("%s\n", s);
+        for (j = start; j < argc; j++)
+        {
+            cargo_assert(strstr(s, argv[i]), "Expected to find argv params");
+        }
+
+        if (start <= highlights[0].i)
+        {
+            cargo_assert(strstr(s, "#"), "Expected # highlight");
+            cargo_assert(strstr(s, CARGO_COLOR_YELLOW), "Expected yellow color for #");
+        }
+        else
+        {
+            cargo_assert(!strstr(s, "#"), "Expected NO # highlight");
+            cargo_assert(!strstr(s, CARGO_COLOR_YELLOW), "Expected NO yellow color for #");
+        }
+
+        if (start <= highlights[1].i)
+        {
+            cargo_assert(strstr(s, "="), "Expected = highlight");
+            cargo_assert(strstr(s, CARGO_COLOR_GREEN), "Expected red color for =");
+        }
+        else
+        {
+            cargo_assert(!strstr(s, "="), "Expected NO = highlight");
+            cargo_assert(!strstr(s, CARGO_COLOR_GREEN), "Expected NO red color for =");
+        }
+
+        _cargo_xfree(NULL, &s);
+    }
+
+    ret = cargo_fprintl_args(stdout, argc, argv, 0, 0, CARGO_DEFAULT_MAX_WIDTH,
+                            sizeof(highlights) / sizeof(highlights[0]),
+                            highlights);
+    cargo_assert(ret == 0, "Expected success");
+
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &s);
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_get_fprint_args_long)
+{
+    char *s = NULL;
+    char **argv = NULL;
+    int argc = 0;
+
+    argv = cargo_split_commandline(0, LOREM_IPSUM, &argc);
+
+    cargo_assert(argv, "Got NULL argv");
+
+    s = cargo_get_fprint_args(argc, argv,
+                            0,      // start.
+                            0,      // flags.
+                            CARGO_AUTO_MAX_WIDTH,
+                            3,      // highlight_count (how many follows).
+                            0, "^"CARGO_COLOR_RED, // Should not be shown.
+                            2 ,"~",
+                            4, "*"CARGO_COLOR_CYAN);
+
+    cargo_assert(s, "Got NULL string");
+
+    printf("%s\n", s);
+    cargo_assert(strstr(s, "^"), "Missing \"^\" highlight");
+    cargo_assert(strstr(s, "~"), "Missing \"~\" highlight");
+    cargo_assert(strstr(s, "*"), "Missing \"*\" highlight");
+    _cargo_free(NULL, s);
+
+    s = cargo_get_fprint_args(argc, argv,
+                            0,      // start.
+                            0,      // flags.
+                            150,
+                            3,      // highlight_count (how many follows).
+                            0, "^"CARGO_COLOR_RED, // Should not be shown.
+                            2 ,"~",
+                            25, "*"CARGO_COLOR_CYAN);
+
+    cargo_assert(s, "Got NULL string");
+
+    printf("%s\n", s);
+    cargo_assert(strstr(s, "^"), "Missing \"^\" highlight");
+    cargo_assert(strstr(s, "~"), "Missing \"~\" highlight");
+    cargo_assert(!strstr(s, "*"), "Got \"*\" highlight when it should be off screen");
+
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &s);
+    cargo_free_commandline(&argv, argc);
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_fprintf)
+{
+    char *s = NULL;
+    cargo_fprintf(stdout, "%shej%s poop\n",
+        CARGO_COLOR_YELLOW, CARGO_COLOR_RESET);
+
+    cargo_asprintf(&s, "%shej%s\n",
+        CARGO_COLOR_YELLOW, CARGO_COLOR_RESET);
+
+    cargo_assert(s, "Got NULL string");
+    _cargo_free(NULL, s);
+
+    ret = cargo_asprintf(&s, "");
+    cargo_assert(ret == 0, "Expected empty string");
+    cargo_assert(!strcmp(s, ""), "Expecterd empty string");
+
+    cargo_print_ansicolor(stdout, "Test " CARGO_COLOR_RED "RED" CARGO_COLOR_RESET "\n");
+
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &s);
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_bool_count)
+{
+    int i = 0;
+    char *args[] = { "program ", "123", "-v", "3", "-v", "-v" };
+
+    ret |= cargo_add_option(cargo, 0,
+                            "--verbose -v", LOREM_IPSUM, "b!", &i);
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+
+    printf("i == %d\n", i);
+    cargo_assert(i == 3, "Expected i to be 3");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_bool_count_compact)
+{
+    int i = 0;
+    int j;
+    char *args[] = { "program ", "-vvv", "123", "-vv" };
+
+    ret |= cargo_add_option(cargo, 0, "args", LOREM_IPSUM, "i", &j);
+    ret |= cargo_add_option(cargo, 0, "--verbose -v", LOREM_IPSUM, "b!", &i);
+
+    cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+
+    printf("i == %d\n", i);
+    cargo_assert(i == 5, "Expected i to be 5");
+
+    printf("j == %d\n", j);
+    cargo_assert(j == 123, "Expected j to be 123");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_fixed_one_or_more_array)
+{
+    int a[4];
+    int a_expect[2] = { 1, 2 };
+    char *args[] = { "program", "--beta", "1", "2" };
+    _ADD_TEST_FIXED_ARRAY(".[i]+", "%d");
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_fixed_zero_or_more_array)
+{
+    int a[4];
+    int a_expect[2] = { 1, 2 };
+    char *args[] = { "program", "--beta", "1", "2" };
+    _ADD_TEST_FIXED_ARRAY(".[i]*", "%d");
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_fixed_fail_array)
+{
+    int i;
+    int vals[4];
+    int vals_expect[] = { 1, 2 };
+    size_t val_count = 0;
+    char *args[] = { "program ", "--alpha", "1", "2", "--beta", "4" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", LOREM_IPSUM,
+                            ".[i]#", &vals, &val_count, 4);
+    ret |= cargo_add_option(cargo, 0, "--beta", LOREM_IPSUM, "i", &i);
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Parse succeeded when it should fail");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_user_context)
+{
+    int i = 3;
+    cargo_set_context(cargo, &i);
+    cargo_assert(&i == cargo_get_context(cargo), "Got invalid user context");
+    cargo_assert(i == 3, "Got invalid user context value");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+typedef struct test_grp_ctx_s
+{
+    char name[32];
+    int val;
+} test_grp_ctx_t;
+
+static int _test_TEST_group_user_context_cb(cargo_t ctx, void *user,
+                                const char *optname, int argc, char **argv)
+{
+    test_grp_ctx_t *grpctx = NULL;
+    test_grp_ctx_t *mgrpctx = NULL;
+    const char *group = NULL;
+    const char **mgroups = NULL;
+    size_t mgroup_count = 0;
+    cargo_cb_assert(ctx, "NULL context in callback");
+
+    group = cargo_get_option_group(ctx, optname);
+    cargo_cb_assert(group, "Got NULL Group name");
+
+    printf("Group context callback %s: %s\n", optname, group);
+
+    grpctx = cargo_get_group_context(ctx, group);
+    cargo_cb_assert(grpctx, "Got NULL group context");
+
+    printf("Group context contents: %s = %d\n", grpctx->name, grpctx->val);
+
+    mgroups = cargo_get_option_mutex_groups(ctx, optname, &mgroup_count);
+
+    printf("Mutex group count for %s: %lu\n", optname, mgroup_count);
+
+    if (!strcmp(optname, "--alpha"))
+    {
+        int *a = (int *)user;
+        cargo_cb_assert(a, "Got NULL user context for --alpha");
+        *a = atoi(argv[0]);
+        printf("a == %d\n", *a);
+        cargo_cb_assert(*a == 15, "Got unexpected value for --alpha");
+        cargo_cb_assert(!strcmp(group, "group1"), "Expected group1 for --alpha");
+        cargo_cb_assert(!strcmp(grpctx->name, "hello"), "Invalid group context name");
+        cargo_cb_assert(grpctx->val == 20, "Unexpected group context value");
+
+        cargo_cb_assert(mgroup_count == 0, "Got non-zero mutex group count");
+        cargo_cb_assert(mgroups == NULL, "Got non-NULL mutex group");
+    }
+    else if (!strcmp(optname, "--delta"))
+    {
+        char **d = (char **)user;
+        cargo_cb_assert(d, "Got NULL user context for --delta");
+        cargo_cb_assert(*d == NULL, "Got non-NULL char pointer for --delta");
+        cargo_cb_assert(!strcmp(group, "group2"), "Expected group2 for --delta");
+        cargo_cb_assert(!strcmp(grpctx->name, "world"), "Invalid group context name");
+
+        mgrpctx = cargo_get_mutex_group_context(ctx, mgroups[0]);
+        cargo_cb_assert(mgrpctx, "Got NULL mutex group 1 context");
+        cargo_cb_assert(!strcmp(mgrpctx->name, "great"), "--delta not member of mutex group 1");
+        cargo_cb_assert(mgrpctx->val == 60, "Got unexpected mutex group 1 value");
+
+        *d = _cargo_strdup(&ctx->mem, argv[0]);
+        cargo_cb_assert(!strcmp(*d, "bla"), "Unexpected --delta value");
+        cargo_cb_assert(grpctx->val == 40, "Unexpected group context value");
+    }
+    else
+    {
+        fprintf(stderr, "Unexpected option: %s\n", optname);
+        return -1;
+    }
+
+    return argc;
+}
+
+_TEST_START(TEST_group_user_context)
+{
+    test_grp_ctx_t group_ctx1 = { "hello", 20 };
+    test_grp_ctx_t group_ctx2 = { "world", 40 };
+    test_grp_ctx_t mgroup_ctx1 = { "great", 60 };
+    test_grp_ctx_t mgroup_ctx2 = { "work", 80 };
+    int a = 0;
+    double b = 0.0;
+    float c = 0;
+    char *d = NULL;
+    int e = 123;
+    char *args[] = { "program", "--alpha", "15", "-b", "7.0", "-c", "5", "-d", "bla" };
+
+    ret |= cargo_add_mutex_group(cargo, 0, "mgroup1", "Mutex group 1", "Mutex group 1");
+    ret |= cargo_set_mutex_group_context(cargo, "mgroup1", &mgroup_ctx1);
+    cargo_assert(ret == 0, "Failed to add mutex group 1");
+
+    ret |= cargo_add_mutex_group(cargo, 0, "mgroup2", "Mutex group 2", "Mutex group 2");
+    ret |= cargo_set_mutex_group_context(cargo, "mgroup2", &mgroup_ctx2);
+    cargo_assert(ret == 0, "Failed to add mutex group 2");
+
+    ret |= cargo_add_group(cargo, 0, "group1", "The Group 1", "This group is 1st");
+    ret |= cargo_set_group_context(cargo, "group1", &group_ctx1);
+    cargo_assert(ret == 0, "Failed to add group");
+
+    ret |= cargo_add_option(cargo, 0, "<group1> --alpha -a", "Alpha Description",
+            "c", _test_TEST_group_user_context_cb, &a);
+    ret |= cargo_add_option(cargo, 0, "<group1> --beta -b", "Alpha Description", "d", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret |= cargo_add_group(cargo, 0, "group2", "The Group 2", LOREM_IPSUM LOREM_IPSUM LOREM_IPSUM);
+    ret |= cargo_set_group_context(cargo, "group2", &group_ctx2);
+    cargo_assert(ret == 0, "Failed to add group");
+
+    ret |= cargo_add_option(cargo, 0, "<group2> --centauri -c", "Centauri Description", "f", &c);
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1, group2> --delta -d", "Delta Description",
+            "c", _test_TEST_group_user_context_cb, &d);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --error -e", "Error Description", "i", &e);
+    ret |= cargo_mutex_group_add_option(cargo, "mgroup2", "--error");
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    cargo_assert(a == 15, "a unexpected");
+    cargo_assert(b == 7.0, "b unexpected");
+    cargo_assert(c == 5.0f, "c unexpected");
+    cargo_assert(!strcmp(d, "bla"), "d unexpected");
+    cargo_assert(e == 123, "e changed unexpectedly");
+
+    ret = cargo_set_group_context(cargo, NULL, &group_ctx1);
+    cargo_assert(ret == 0, "Failed to set group context for default group");
+
+    cargo_assert(cargo_get_group_context(cargo, NULL) == &group_ctx1,
+        "Got different group context back for default group");
+
+    ret = cargo_set_group_context(cargo, "unknown", &group_ctx1);
+    cargo_assert(ret != 0, "Able to set group context for un-existent group");
+
+    ret = cargo_set_group_context(cargo, "unknown", &group_ctx1);
+    cargo_assert(ret != 0, "Able to set group context for un-existent group");
+
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &d);
+}
+_TEST_END()
+
+_TEST_START(TEST_mutex_group_context_fail)
+{
+    void *user = NULL;
+    test_grp_ctx_t mgroup_ctx1 = { "hello", 20 };
+    int i = 3;
+    ret |= cargo_add_mutex_group(cargo, 0, "mgroup1", NULL, NULL);
+    ret |= cargo_set_mutex_group_context(cargo, "mgroup1", &mgroup_ctx1);
+    cargo_assert(ret == 0, "Failed to add mutex group 1");
+
+    user = cargo_get_mutex_group_context(cargo, "mgroup2");
+    cargo_assert(user == NULL, "Got non-NULL mutex group context for non-existent group");
+
+    user = cargo_get_mutex_group_context(cargo, "mgroup1");
+    cargo_assert(user == &mgroup_ctx1, "Did not get correct mutex group context");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_get_option_mutex_groups)
+{
+    size_t i;
+    size_t count = 0;
+    const char **mgroups = NULL;
+    int a = 0;
+
+    ret |= cargo_add_mutex_group(cargo, 0, "mgroup1", NULL, NULL);
+    cargo_assert(ret == 0, "Failed to add mutex group 1");
+
+    ret |= cargo_add_mutex_group(cargo, 0, "mgroup2", "hello", "world");
+    cargo_assert(ret == 0, "Failed to add mutex group 2");
+
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --alpha -a", "Error Description", "i", &a);
+    ret |= cargo_mutex_group_add_option(cargo, "mgroup2", "--alpha");
+    cargo_assert(ret == 0, "Failed to add option");
+
+    mgroups = cargo_get_option_mutex_groups(cargo, "--alpha", &count);
+    cargo_assert(mgroups != NULL, "Got NULL mutex group list");
+    printf("Mutex group count: %lu\n", count);
+
+    for (i = 0; i < count; i++)
+    {
+        printf("%lu: \"%s\"\n", i, mgroups[i]);
+    }
+
+    cargo_assert(count == 2, "Expected 2 mutex groups");
+    cargo_assert(!strcmp(mgroups[0], "mgroup1"), "Mutex group 1 expected");
+    cargo_assert(!strcmp(mgroups[1], "mgroup2"), "Mutex group 2 expected");
+
+    // Get it twice, make sure it was cached.
+    mgroups = cargo_get_option_mutex_groups(cargo, "--alpha", &count);
+
+    cargo_assert(count == 2, "Expected 2 mutex groups twice");
+    cargo_assert(!strcmp(mgroups[0], "mgroup1"), "Mutex group 1 expected");
+    cargo_assert(!strcmp(mgroups[1], "mgroup2"), "Mutex group 2 expected");
+
+    // Get non-existent option.
+    mgroups = cargo_get_option_mutex_groups(cargo, "--unknown", &count);
+
+    cargo_assert(count == 0, "Expected 0 options");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_invalid_format_char)
+{
+    int a = 0;
+    int *c = NULL;
+    size_t c_count = 0;
+    int d[4];
+    size_t d_count = 0;
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", NULL, "p", &a);
+    cargo_assert(ret != 0, "Invalid format character allowed");
+
+    ret |= cargo_add_option(cargo, 0, "--beta -b", NULL, "[i", &a);
+    cargo_assert(ret != 0, "Impartial format string allowed");
+
+    ret |= cargo_add_option(cargo, 0, "--centauri -c", NULL, "[i],", &c, &c_count);
+    cargo_assert(ret != 0, "Invalid format string allowed");
+
+    ret |= cargo_add_option(cargo, 0, "--delta -d", NULL, ".[i],", &d, &d_count);
+    cargo_assert(ret != 0, "Invalid format string allowed");
+
+    ret |= cargo_add_option(cargo, 0, "--error -e", NULL, "im", &a);
+    cargo_assert(ret != 0, "Invalid format string allowed");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_option_target_null)
+{
+    int a = 0;
+    int *c = NULL;
+    size_t c_count = 0;
+    int d[4];
+    size_t d_count = 0;
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "i", NULL);
+    cargo_assert(ret != 0, "NULL target was allowed");
+
+    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL, "[i]+", &c, NULL);
+    cargo_assert(ret != 0, "NULL target count was allowed");
+
+    ret = cargo_add_option(cargo, 0, "--delta -d", NULL, "[i]#", &d, NULL, 4);
+    cargo_assert(ret != 0, "NULL target count was allowed");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_autoclean_string_list)
+{
+    size_t i;
+    char **strs = NULL;
+    size_t str_count = 0;
+    char *args[] = { "program", "--alpha", "bla", "blo", "bli" };
+
+    cargo_set_flags(cargo, CARGO_AUTOCLEAN);
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "[s]+", &strs, &str_count);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(strs != NULL, "Got NULL string list");
+
+    printf("strs: %p\n", strs);
+
+    for (i = 0; i < str_count; i++)
+    {
+        printf("%s\n", strs[i]);
+    }
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+static int _test_fail_callback(cargo_t ctx, void *user, const char *optname,
+                                int argc, char **argv)
+{
+    return -1;
+}
+
+_TEST_START(TEST_fail_custom_callback)
+{
+    size_t i = 0;
+    char *args[] = { "program", "-a", "bla" };
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "c", _test_fail_callback, &i);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Parse expected to fail");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+static int _test_mutex_group_usage_add_options(cargo_t cargo,
+                cargo_mutex_group_flags_t flags1,
+                cargo_mutex_group_flags_t flags2,
+                int *a, int *b, int *c, int *d)
+{
+    int ret = 0;
+    ret |= cargo_add_mutex_group(cargo, flags1, "mgroup1", "Mutex group 1",
+            "MGROUP1_DESCRIPTION " LOREM_IPSUM);
+    ret |= cargo_add_mutex_group(cargo, flags2, "mgroup2", "Mutex group2",
+            "MGROUP2_DESCRIPTION " LOREM_IPSUM LOREM_IPSUM);
+
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --alpha -a", "Error Description", "i", a);
+    ret |= cargo_mutex_group_add_option(cargo, "mgroup2", "--alpha");
+
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --beta -b", LOREM_IPSUM, "i", b);
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --centauri -c", "bla bla" LOREM_IPSUM, "i", c);
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --delta -d", "bla bla" LOREM_IPSUM, "i", d);
+    ret |= cargo_mutex_group_add_option(cargo, "mgroup2", "--delta");
+
+    ret |= cargo_add_option(cargo, 0, "--error -e", "AAWESOME" LOREM_IPSUM, "i", d);
+    ret |= cargo_add_option(cargo, 0, "--fail -f", "Fail " LOREM_IPSUM, "i", d);
+
+    return ret;
+}
+
+_TEST_START(TEST_mutex_group_usage)
+{
+    int a;
+    int b;
+    int c;
+    int d;
+    const char *s = NULL;
+
+    ret = _test_mutex_group_usage_add_options(cargo, 0, 0, &a, &b, &c, &d);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    cargo_print_usage(cargo, 0);
+
+    s = cargo_get_usage(cargo, 0);
+    cargo_assert(s, "Got NULL usage");
+    cargo_assert(!strstr(s, "MGROUP1_DESCRIPTION"),
+        "MGROUP2_DESCRIPTION should not show by default");
+    cargo_assert(!strstr(s, "MGROUP2_DESCRIPTION"),
+        "MGROUP2_DESCRIPTION should not show by default");
+    cargo_assert(strstr(s, "--alpha"), "Missing --alpha");
+    cargo_assert(strstr(s, "--beta"), "Missing --beta");
+    cargo_assert(strstr(s, "--centauri"), "Missing --centauri");
+    cargo_assert(strstr(s, "--delta"), "Missing --delta");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_mutex_group_usage2)
+{
+    int a;
+    int b;
+    int c;
+    int d;
+    const char *s = NULL;
+
+    ret = _test_mutex_group_usage_add_options(cargo,
+            CARGO_MUTEXGRP_ONE_REQUIRED |
+            CARGO_MUTEXGRP_NO_GROUP_SHORT_USAGE |
+            CARGO_MUTEXGRP_GROUP_USAGE,
+            0, &a, &b, &c, &d);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    cargo_print_usage(cargo, 0);
+
+    s = cargo_get_usage(cargo, 0);
+    cargo_assert(s, "Got NULL usage");
+    cargo_assert(strstr(s, "MGROUP1_DESCRIPTION"),
+        "MGROUP1_DESCRIPTION should be shown when grouped");
+    cargo_assert(!strstr(s, "MGROUP2_DESCRIPTION"),
+        "MGROUP2_DESCRIPTION should not show by default");
+
+    s = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
+    cargo_assert(strstr(s, "--alpha"), "Missing --alpha");
+    cargo_assert(strstr(s, "--beta"), "Missing --beta");
+    cargo_assert(strstr(s, "--centauri"), "Missing --centauri");
+    cargo_assert(strstr(s, "--delta"), "Missing --delta");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_mutex_group_usage3)
+{
+    int a;
+    int b;
+    int c;
+    int d;
+    const char *s = NULL;
+
+    ret = _test_mutex_group_usage_add_options(cargo,
+            CARGO_MUTEXGRP_ONE_REQUIRED |
+            CARGO_MUTEXGRP_NO_GROUP_SHORT_USAGE |
+            CARGO_MUTEXGRP_GROUP_USAGE,
+            CARGO_MUTEXGRP_GROUP_USAGE |
+            CARGO_MUTEXGRP_RAW_DESCRIPTION, &a, &b, &c, &d);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    cargo_print_usage(cargo, 0);
+
+    s = cargo_get_usage(cargo, 0);
+    cargo_assert(strstr(s, "MGROUP1_DESCRIPTION"),
+        "MGROUP1_DESCRIPTION should be shown when grouped");
+    cargo_assert(strstr(s, "MGROUP2_DESCRIPTION"),
+        "MGROUP2_DESCRIPTION should be shown when grouped");
+
+    s = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
+    cargo_assert(strstr(s, "--alpha"), "Missing --alpha");
+    cargo_assert(strstr(s, "--beta"), "Missing --beta");
+    cargo_assert(strstr(s, "--centauri"), "Missing --centauri");
+    cargo_assert(strstr(s, "--delta"), "Missing --delta");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_mutex_group_usage_set_metavar)
+{
+    int a;
+    int b;
+    int c;
+    int d;
+    const char *s = NULL;
+
+    ret = _test_mutex_group_usage_add_options(cargo,
+            CARGO_MUTEXGRP_ONE_REQUIRED |
+            CARGO_MUTEXGRP_GROUP_USAGE,
+            CARGO_MUTEXGRP_GROUP_USAGE |
+            CARGO_MUTEXGRP_RAW_DESCRIPTION, &a, &b, &c, &d);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_mutex_group_set_metavar(cargo, "mgroup1", "MUTEX");
+    cargo_assert(ret == 0, "Failed to set mutex group metavar");
+
+    cargo_print_usage(cargo, 0);
+
+    s = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
+    cargo_assert(s, "Got NULL short usage");
+    cargo_assert(strstr(s, "MUTEX"), "Expected to find mutex group metavar");
+    cargo_assert(!strstr(s, "--beta"), "--beta should be hidden");
+    cargo_assert(!strstr(s, "--centauri"), "--centauri should be hidden");
+
+    // Try to set for non-existing mutex group.
+    ret = cargo_mutex_group_set_metavar(cargo, "mgroup3", "MUTEX");
+    cargo_assert(ret != 0, "Succeeded to set metavar on invalid mutex group");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_dummy_callback)
+{
+    size_t i = 0;
+    char *args[] = { "program", "-a", "bla" };
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "D");
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_group_add_missing_group)
+{
+    int i = 0;
+    int *j = NULL;
+    size_t j_count = 0;
+    char *args[] = { "program", "-a", "bla" };
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, "i", &i);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    // Add to non-existent group.
+    ret = cargo_group_add_option(cargo, "group1", "--alpha");
+    cargo_assert(ret != 0, "Able to add option to non-existent group");
+
+        // Add non-existent option to non-existent group.
+    ret = cargo_group_add_option(cargo, "group1", "--beta");
+    cargo_assert(ret != 0, "Able to add non-existent option to non-existent group");
+
+    ret = cargo_add_group(cargo, CARGO_GROUP_RAW_DESCRIPTION,
+            "group1", "The Group 1", "This group is 1st");
+    cargo_assert(ret == 0, "Failed to add group");
+
+    // Add non-existent option to group.
+    ret = cargo_group_add_option(cargo, "group1", "--beta");
+    cargo_assert(ret != 0, "Able to add non-existent option to group");
+
+    ret = cargo_add_group(cargo, 0, "group2", "The Group 2", "This group is 2nd");
+    cargo_assert(ret == 0, "Failed to add second group");
+
+    ret = cargo_group_add_option(cargo, "group1", "--alpha");
+    cargo_assert(ret == 0, "Failed to add option to first group");
+    ret = cargo_group_add_option(cargo, "group2", "--alpha");
+    cargo_assert(ret != 0, "Able to add option to second group");
+
+    ret = cargo_add_option(cargo, 0, "<group1> --beta -b", LOREM_IPSUM, "i", &i);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    cargo_print_usage(cargo, 0);
+
+    ret = cargo_add_option(cargo, 0, "<group1 --centauri -c", LOREM_IPSUM, "i", &i);
+    cargo_assert(ret != 0, "Succesfully added invalid option with invalid group");
+
+    ret = cargo_add_option(cargo, 0, "", LOREM_IPSUM, "i", &i);
+    cargo_assert(ret != 0, "Succesfully added option with empty name");
+
+    ret = cargo_add_option(cargo, 0, "<group1>", LOREM_IPSUM, "i", &i);
+    cargo_assert(ret != 0, "Succesfully added option with empty name");
+
+    ret = cargo_add_option(cargo, 0, "--delta", LOREM_IPSUM, "[i]#", &j, &j_count, -5);
+    cargo_assert(ret != 0, "Succesfully added option with nargs = -5");
+
+    ret = cargo_add_option(cargo, 0, "--unicorn u", LOREM_IPSUM, "i", &i);
+    cargo_assert(ret != 0, "Succesfully added option with invalid alias");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_bool_acc_or)
+{
+    unsigned int a = 0;
+    unsigned int b = 0;
+    unsigned int c = 0;
+    unsigned int expected_bits = 0;
+    char *args[] = { "program", "-a", "-b", "-b", "123", "-ccc", "-b"};
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL,
+            "b|", &a, 1, (1 << 1));
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--beta -b", NULL,
+            "b|", &b, 2, (1 << 1), (1 << 2));
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL,
+            "b|", &c, 3, (1 << 1), (1 << 2), (1 << 5));
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+
+    expected_bits = (1 << 1);
+    printf("a = Expect: 0x%x Got: 0x%x\n", expected_bits, a);
+    cargo_assert((a & expected_bits) == expected_bits, "Expected bit 1 to be set");
+    cargo_assert((a ^ expected_bits) == 0, "Expected no other bit than 1 to be set");
+
+    // We have 3 occurrances of "-b" but only 2 bits should still be set.
+    expected_bits = (1 << 1) | (1 << 2);
+    printf("b = Expect: 0x%x Got: 0x%x\n", expected_bits, b);
+    cargo_assert((b & (expected_bits)) == expected_bits, "Expected bit 1 and 2 to be set");
+    cargo_assert((b ^ (expected_bits)) == 0, "Expected no other bit than 1 and 2 to be set");
+
+    expected_bits = (1 << 1) | (1 << 2) | (1 << 5);
+    printf("c = Expect: 0x%x Got: 0x%x\n", expected_bits, c);
+    cargo_assert((c & expected_bits) == expected_bits, "Expected bit 1, 2 and 5 to be set");
+    cargo_assert((c ^ expected_bits) == 0, "Expected no other bit than 1, 2 and 5 to be set");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_bool_acc_and)
+{
+    unsigned int a = -1;
+    unsigned int b = -1;
+    unsigned int c = -1;
+    unsigned int expected_bits = 0;
+    char *args[] = { "program", "-a", "-b", "-b", "123", "-ccc", "-b"};
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL,
+            "b&", &a, 1, (1 << 1));
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--beta -b", NULL,
+            "b&", &b, 2, ((1 << 1) | (1 << 2) | (1 << 3)), (1 << 2));
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL,
+            "b&", &c, 2, (1 << 1) | (1 << 2) | (1 << 5),  (1 << 1) | (1 << 5));
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+
+    expected_bits = (1 << 1);
+    printf("a = Expect: 0x%x Got: 0x%x\n", expected_bits, a);
+    cargo_assert((a & expected_bits) == expected_bits, "Expected no bit to be set");
+    cargo_assert((a ^ expected_bits) == 0, "Expected no other bit than 1 to be set");
+
+    expected_bits = (1 << 2);
+    printf("b = Expect: 0x%x Got: 0x%x\n", expected_bits, b);
+    cargo_assert((b & (expected_bits)) == expected_bits, "Expected bit 2 to be set");
+    cargo_assert((b ^ (expected_bits)) == 0, "Expected no other bit than 2 to be set");
+
+    expected_bits = (1 << 1) | (1 << 5);
+    printf("c = Expect: 0x%x Got: 0x%x\n", expected_bits, c);
+    cargo_assert((c & expected_bits) == expected_bits, "Expected bit 1 and 5 to be set");
+    cargo_assert((c ^ expected_bits) == 0, "Expected no other bit than 1 and 5 to be set");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_bool_acc_plus)
+{
+    unsigned int a = 0;
+    unsigned int b = 0;
+    unsigned int c = 0;
+    char *args[] = { "program", "-a", "-b", "-b", "123", "-ccc", "-b"};
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL,
+            "b+", &a, 1, 1);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--beta -b", NULL,
+            "b+", &b, 2, 1, 2);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL,
+            "b+", &c, 3, 1, 2, 3);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+
+    printf("a = Expect: %u Got: %u\n", 1, a);
+    cargo_assert(a == 1, "Expected a == 1");
+
+    printf("b = Expect: %u Got: %u\n", (1 + 2), b);
+    cargo_assert(b == (1 + 2), "Expected b == 3");
+
+    printf("c = Expect: %u Got: %u\n", (1 + 2 + 3), c);
+    cargo_assert(c == (1 + 2 + 3), "Expected c == 6");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_bool_acc_store)
+{
+    unsigned int a = 0;
+    unsigned int b = 0;
+    unsigned int c = 0;
+    char *args[] = { "program", "-a", "-b", "-b", "123", "-ccc", "-b"};
+
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL,
+            "b_", &a, 1, 40);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--beta -b", NULL,
+            "b_", &b, 2, 33, 44);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--centauri -c", NULL,
+            "b_", &c, 3, 11, 22, 33);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+
+    printf("a = Expect: %u Got: %u\n", 40, a);
+    cargo_assert(a == 40, "Expected a == 40");
+
+    printf("b = Expect: %u Got: %u\n", 44, b);
+    cargo_assert(b == 44, "Expected b == 44");
+
+    printf("c = Expect: %u Got: %u\n", 33, c);
+    cargo_assert(c == 33, "Expected c == 33");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+static char *_test_mutex_order_group(cargo_t cargo, cargo_mutex_group_flags_t flags,
+                                     int args1_expect, int args2_expect)
+{
+    char *msg = NULL;
+    int ret = 0;
+    int a = 0;
+    int b = 0;
+    int c = 0;
+    int d = 0;
+    int e = 0;
+    int f = 0;
+    char *args1[] = { "program", "--alpha", "--beta", "--centauri", "--error" };
+    char *args2[] = { "program", "--fail", "--beta", "--centauri", "--alpha", "--error" };
+
+    ret = cargo_add_mutex_group(cargo, flags, "mgroup1", "Mutex group 1",
+            "MGROUP1_DESCRIPTION " LOREM_IPSUM);
+
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --alpha -a", "Error Description", "b", &a);
+
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --beta -b", LOREM_IPSUM, "b", &b);
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --centauri -c", "bla bla" LOREM_IPSUM, "b", &c);
+    ret |= cargo_add_option(cargo, 0, "<!mgroup1> --delta -d", "bla bla" LOREM_IPSUM, "b", &d);
+
+    ret |= cargo_add_option(cargo, 0, "--error -e", "AAWESOME" LOREM_IPSUM, "b", &d);
+    ret |= cargo_add_option(cargo, 0, "--fail -f", "Fail " LOREM_IPSUM, "b", &d);
+
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == args1_expect, "Unexpected result on parse");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == args2_expect, "Unexpected result on parse");
+fail:
+    return msg;
+}
+
+_TEST_START(TEST_mutex_order_group_before)
+{
+    printf("Test order before:\n");
+    msg = _test_mutex_order_group(cargo,
+            CARGO_MUTEXGRP_ORDER_BEFORE, CARGO_PARSE_MUTEX_CONFLICT_ORDER, 0);
+}
+_TEST_END()
+
+_TEST_START(TEST_mutex_order_group_after)
+{
+    printf("Test order after:\n");
+    msg = _test_mutex_order_group(cargo,CARGO_MUTEXGRP_ORDER_AFTER, 0,
+            CARGO_PARSE_MUTEX_CONFLICT_ORDER);
+}
+_TEST_END()
+
+_TEST_START(TEST_medium_length_usage)
+{
+    ret |= cargo_add_option(cargo, 0, "--alpha",
+                            "Hello there\n"
+                            "This isn't very long!", "D");
+    cargo_assert(ret == 0, "Failed to add options");
+    cargo_print_usage(cargo, 0);
+
+    cargo_assert(strstr(cargo_get_usage(cargo, 0), "   This isn't"),
+                "Medium length usage not indented properly");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_get_unknown_copy)
+{
+    size_t unknown_count = 0;
+    char **unknowns = NULL;
+    int a = 0;
+    char *args[] = { "--beta", "--alpha", "--centauri", "--delta" };
+    char *unknown_expect[] = { "--beta", "--centauri", "--delta" };
+
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == -1, "Expected fail on unknown options");
+
+    cargo_assert(cargo_get_error(cargo) != NULL, "Got NULL error");
+
+    unknowns = cargo_get_unknown_copy(cargo, &unknown_count);
+
+    cargo_assert_str_array(unknown_count,
+        sizeof(unknown_expect) / sizeof(unknown_expect[0]),
+        unknowns, unknown_expect);
+
+    _TEST_CLEANUP();
+    _cargo_free_str_list(NULL, &unknowns, &unknown_count);
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_get_args_copy)
+{
+    size_t extra_args_count = 0;
+    char **extra_args = NULL;
+    int a = 0;
+    char *args[] = { "--beta", "123", "--alpha", "--centauri", "beep", "--delta" };
+    char *extra_expect[] = { "--beta", "123", "--centauri", "beep", "--delta" };
+
+    cargo_set_flags(cargo, CARGO_NO_FAIL_UNKNOWN);
+
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    extra_args = cargo_get_args_copy(cargo, &extra_args_count);
+
+    cargo_assert_str_array(extra_args_count,
+        sizeof(extra_expect) / sizeof(extra_expect[0]),
+        extra_args, extra_expect);
+
+    _TEST_CLEANUP();
+    _cargo_free_str_list(NULL, &extra_args, &extra_args_count);
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_set_option_description)
+{
+    int a = 0;
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
+    cargo_assert(ret == 0, "Failed to create option");
+
+    ret = cargo_set_option_description(cargo, "--alpha",
+            "%s world %d", "hello", 123);
+    cargo_assert(ret == 0, "Failed to set description");
+
+    cargo_print_usage(cargo, 0);
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_parse_stop)
+{
+    size_t extra_args_count = 0;
+    char **extra_args = NULL;
+    int a = 0;
+    int b = 0;
+    int c = 0;
+    int d = 0;
+    char *args[] = { "--beta", "123", "--alpha", "--centauri", "beep", "--delta" };
+    // We stop parsing here ---------------------^
+    char *extra_expect[] = { "123", "beep", "--delta" };
+
+    cargo_set_flags(cargo, 0);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
+    ret |= cargo_add_option(cargo, 0, "--beta", "an option", "b", &b);
+    ret |= cargo_add_option(cargo, CARGO_OPT_STOP, "--centauri", "an option", "b", &c);
+    ret |= cargo_add_option(cargo, 0, "--delta", "an option", "b", &d);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    extra_args = cargo_get_args_copy(cargo, &extra_args_count);
+
+    cargo_assert_str_array(extra_args_count,
+        sizeof(extra_expect) / sizeof(extra_expect[0]),
+        extra_args, extra_expect);
+
+    _TEST_CLEANUP();
+    _cargo_free_str_list(NULL, &extra_args, &extra_args_count);
+}
+_TEST_END()
+
+_TEST_START(TEST_parse_stop_hard)
+{
+    // The difference in this test is that
+    // --delta is required, but should be skipped.
+
+    // TODO: This is a copy paste of the test above, split up into a common function.
+    size_t extra_args_count = 0;
+    char **extra_args = NULL;
+    int a = 0;
+    int b = 0;
+    int c = 0;
+    int d = 0;
+    char *args[] = { "--beta", "123", "--alpha", "--centauri", "beep", "--delta" };
+    // We stop parsing here ---------------------^
+    char *extra_expect[] = { "123", "beep", "--delta" };
+
+    cargo_set_flags(cargo, 0);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
+    ret |= cargo_add_option(cargo, 0, "--beta", "an option", "b", &b);
+
+    // This should make it so that --delta isn't required.
+    ret |= cargo_add_option(cargo, CARGO_OPT_STOP | CARGO_OPT_STOP_HARD,
+                            "--centauri", "an option", "b", &c);
+    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED,
+                            "--delta", "an option", "b", &d);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    extra_args = cargo_get_args_copy(cargo, &extra_args_count);
+
+    cargo_assert_str_array(extra_args_count,
+        sizeof(extra_expect) / sizeof(extra_expect[0]),
+        extra_args, extra_expect);
+
+    _TEST_CLEANUP();
+    _cargo_free_str_list(NULL, &extra_args, &extra_args_count);
+}
+_TEST_END()
+
+_TEST_START(TEST_parse_stop_hard_fail)
+{
+    // The difference in this test is that
+    // --delta is required, and we should fail.
+
+    // TODO: This is a copy paste of the test above, split up into a common function.
+    int a = 0;
+    int b = 0;
+    int c = 0;
+    int d = 0;
+    char *args[] = { "--beta", "123", "--alpha", "--centauri", "beep", "--delta" };
+    // We stop parsing here ---------------------^
+
+    cargo_set_flags(cargo, 0);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", "an option", "b", &a);
+    ret |= cargo_add_option(cargo, 0, "--beta", "an option", "b", &b);
+
+    // This should make it so that --delta isn't required.
+    ret |= cargo_add_option(cargo, CARGO_OPT_STOP,
+                            "--centauri", "an option", "b", &c);
+    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED,
+                            "--delta", "an option", "b", &d);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 0, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret < 0, "Succeeded to parse when expected to fail");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_zero_or_one_with_arg)
+{
+    char *args[] = { "program", "--alpha", "6" };
+    int a = 0;
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i?", &a, "5");
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed parse");
+    cargo_assert(a == 6, "Unexpected value");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_zero_or_one_without_arg)
+{
+    char *args[] = { "program", "--alpha" };
+    int a = 0;
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i?", &a, "5");
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed parse");
+    cargo_assert(a == 5, "Unexpected value");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_zero_or_one_without_arg2)
+{
+    char *args[] = { "program", "--alpha", "--beta", "3" };
+    int a = 0;
+    int b = 0;
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i?", &a, "5");
+    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed parse");
+    cargo_assert(a == 5, "Unexpected value");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_late_unknown_options)
+{
+    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
+    int a = 0;
+    int b = 0;
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i", &a);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Parse success on unknown option (late)");
+
+    printf("a = %d\n", a);
+    printf("b = %d\n", b);
+    cargo_assert(a == 123, "a != 123 after unknown option (check after)");
+    cargo_assert(b == 3,   "b != 3 after unknown option (check after)");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_early_unknown_options)
+{
+    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
+    int a = 0;
+    int b = 0;
+
+    cargo_set_flags(cargo, CARGO_UNKNOWN_EARLY);
+
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i", &a);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret != 0, "Parse success on unknown option (early)");
+
+    printf("a = %d\n", a);
+    printf("b = %d\n", b);
+    cargo_assert(a == 0, "a != 0, when early unknown option");
+    cargo_assert(b == 0, "b != 0, when early unknown option");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_late_unknown_options_no_fail)
+{
+    char *args[] =
+    {
+        "program", "--alpha", "123", "--centauri", "--delta", "--beta", "3"
+    };
+    char *expected[] = { "--centauri", "--delta" };
+    size_t expected_count = sizeof(expected) / sizeof(expected[0]);
+    int a = 0;
+    int b = 0;
+    size_t i = 0;
+    const char **unknowns = NULL;
+    size_t unknown_count = 0;
+    char **unknowns_cpy = NULL;
+    size_t unknown_count_cpy = 0;
+
+    cargo_set_flags(cargo, CARGO_NO_FAIL_UNKNOWN);
+
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i", &a);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failure on unknown option (late, no fail)");
+
+    printf("a = %d\n", a);
+    printf("b = %d\n", b);
+    cargo_assert(a == 123, "a != 123 after unknown option (check after)");
+    cargo_assert(b == 3,   "b != 3 after unknown option (check after)");
+
+    unknowns = cargo_get_unknown(cargo, &unknown_count);
+    cargo_assert(unknowns, "Got NULL unknowns list");
+    for (i = 0; i < unknown_count; i++) printf("%s\n", unknowns[i]);
+    cargo_assert_str_array(unknown_count, expected_count, unknowns, expected);
+
+    unknowns_cpy = cargo_get_unknown_copy(cargo, &unknown_count_cpy);
+    cargo_assert(unknowns_cpy, "Got NULL unknowns list (copy)");
+    for (i = 0; i < unknown_count_cpy; i++) printf("%s\n", unknowns_cpy[i]);
+    cargo_assert_str_array(unknown_count_cpy, expected_count, unknowns_cpy, expected);
+
+    _TEST_CLEANUP();
+    cargo_free_commandline(&unknowns_cpy, unknown_count_cpy);
+}
+_TEST_END()
+
+_TEST_START(TEST_late_unknown_options_no_fail_stop)
+{
+    char *args[] =
+    {
+        "program", "--alpha", "123", "--centauri", "--delta", "--beta", "3",
+        "--bla", "--blo", "--many", "--other", "options"
+    };
+    char *expected[] = { "--centauri", "--delta" };
+    size_t expected_count = sizeof(expected) / sizeof(expected[0]);
+    int a = 0;
+    int b = 0;
+    size_t i = 0;
+    const char **unknowns = NULL;
+    size_t unknown_count = 0;
+    char **unknowns_cpy = NULL;
+    size_t unknown_count_cpy = 0;
+
+    cargo_set_flags(cargo, CARGO_NO_FAIL_UNKNOWN);
+
+    ret = cargo_add_option(cargo, 0, "--alpha", "an option", "i", &a);
+    ret = cargo_add_option(cargo, CARGO_OPT_STOP, "--beta -b", "an option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failure on unknown option (late, no fail)");
+
+    printf("a = %d\n", a);
+    printf("b = %d\n", b);
+    cargo_assert(a == 123, "a != 123 after unknown option (check after)");
+    cargo_assert(b == 3,   "b != 3 after unknown option (check after)");
+
+    unknowns = cargo_get_unknown(cargo, &unknown_count);
+    cargo_assert(unknowns, "Got NULL unknowns list");
+    for (i = 0; i < unknown_count; i++) printf("%s\n", unknowns[i]);
+    cargo_assert_str_array(unknown_count, expected_count, unknowns, expected);
+
+    unknowns_cpy = cargo_get_unknown_copy(cargo, &unknown_count_cpy);
+    cargo_assert(unknowns_cpy, "Got NULL unknowns list (copy)");
+    for (i = 0; i < unknown_count_cpy; i++) printf("%s\n", unknowns_cpy[i]);
+    cargo_assert_str_array(unknown_count_cpy, expected_count, unknowns_cpy, expected);
+
+    _TEST_CLEANUP();
+    cargo_free_commandline(&unknowns_cpy, unknown_count_cpy);
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_set_error)
+{
+    cargo_set_error(cargo, 0, "Hello %s\n", "world");
+    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello world\n"), "Unexpected string");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_set_error_append)
+{
+    cargo_set_error(cargo, 0, "Hello ");
+    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello "), "Unexpected string");
+    cargo_set_error(cargo, CARGO_ERR_APPEND, "world\n");
+    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello world\n"), "Unexpected string");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_set_error_append2)
+{
+    cargo_set_error(cargo, CARGO_ERR_APPEND, "Hello ");
+    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello "), "Unexpected string");
+    cargo_set_error(cargo, CARGO_ERR_APPEND, "world\n");
+    cargo_assert(!strcmp(cargo_get_error(cargo), "Hello world\n"), "Unexpected string");
+    cargo_set_error(cargo, 0, "The other\n");
+    cargo_assert(!strcmp(cargo_get_error(cargo), "The other\n"), "Unexpected string");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+
+_TEST_START(TEST_cargo_set_memfunctions)
+{
+    int i;
+    const char *s = NULL;
+    cargo_set_memfunctions(_cargo_test_malloc, _cargo_test_realloc, free);
+
+    _cargo_test_set_malloc_fail_count(0);
+    _cargo_test_set_realloc_fail_count(0);
+    s = TEST_add_integer_option();
+    cargo_assert(s == NULL, "Got unexpected mem error");
+
+    for (i = 1; i < 20; i++)
+    {
+        _cargo_test_set_malloc_fail_count(i);
+        s = TEST_add_integer_option();
+        cargo_assert(s != NULL, "Did not get expected mem error");
+    }
+
+    _cargo_test_set_malloc_fail_count(0);
+    _cargo_test_set_realloc_fail_count(0);
+    s = TEST_many_groups();
+    cargo_assert(s == NULL, "Got unexpected mem error");
+
+    for (i = 1; i < 20; i++)
+    {
+        _cargo_test_set_malloc_fail_count(i);
+        s = TEST_many_groups();
+        cargo_assert(s != NULL, "Did not get expected mem error TEST_many_groups");
+    }
+
+    for (i = 1; i < 20; i++)
+    {
+        _cargo_test_set_realloc_fail_count(i);
+        s = TEST_many_groups();
+        cargo_assert(s != NULL, "Did not get expected mem error TEST_many_groups");
+    }
+
+
+    _TEST_CLEANUP();
+    cargo_set_memfunctions(NULL, NULL, NULL);
+    _cargo_test_set_malloc_fail_count(0);
+    _cargo_test_set_realloc_fail_count(0);
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_malloc_zero_bytes)
+{
+    cargo_set_memfunctions(_cargo_test_malloc, NULL, NULL);
+    _cargo_test_set_malloc_fail_count(0);
+
+    cargo_assert(_cargo_malloc(NULL, 0) == NULL, "Did not get expected error");
+    cargo_assert(malloc_current == 0, "Unexpected call to malloc");
+
+    _TEST_CLEANUP();
+    cargo_set_memfunctions(NULL, NULL, NULL);
+    _cargo_test_set_malloc_fail_count(0);
+}
+_TEST_END()
+
+_TEST_START(TEST_test_hidden_option)
+{
+    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
+    int a = 0;
+    int b = 0;
+    const char *usage = NULL;
+    ret = cargo_add_option(cargo, CARGO_OPT_HIDE, "--alpha", "the hidden", "i", &a);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    usage = cargo_get_usage(cargo, 0);
+    printf("%s\n", usage);
+
+    cargo_assert(strstr(usage, "--alpha") == NULL,
+        "Found hidden option in usage");
+
+    cargo_assert(strstr(usage, "the hidden") == NULL,
+        "Found hidden option description in usage");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_test_hidden_short_option)
+{
+    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
+    int a = 0;
+    int b = 0;
+    const char *usage = NULL;
+    ret = cargo_add_option(cargo, CARGO_OPT_HIDE_SHORT, "--alpha", "the hidden", "i", &a);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // Only hide in short usage.
+    usage = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
+    printf("%s\n", usage);
+
+    cargo_assert(strstr(usage, "--alpha") == NULL,
+        "Found hidden short option in short usage");
+
+    cargo_assert(strstr(usage, "the hidden") == NULL,
+        "Found hidden short option description in short usage");
+
+    // It should be shown in full usage.
+    usage = cargo_get_usage(cargo, CARGO_USAGE_FULL);
+    printf("%s\n", usage);
+
+    cargo_assert(strstr(usage, "--alpha") != NULL,
+        "Did not find hidden short option in full usage");
+
+    cargo_assert(strstr(usage, "the hidden") != NULL,
+        "Did not find hidden short option description in full usage");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_override_short_usage)
+{
+    char *args[] = { "program", "--alpha", "123", "--centauri", "--beta", "3" };
+    int a = 0;
+    int b = 0;
+    const char *usage = NULL;
+    ret = cargo_add_option(cargo, CARGO_OPT_HIDE, "--alpha", "the hidden", "i", &a);
+    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    cargo_set_progname(cargo, "%s [options] args", args[0]);
+    usage = cargo_get_usage(cargo,
+        CARGO_USAGE_OVERRIDE_SHORT |
+        CARGO_USAGE_SHORT);
+    printf("%s\n", usage);
+
+    cargo_assert(strstr(usage, "--help") == NULL,
+        "Short usage not overridden, found --help");
+
+    cargo_assert(strstr(usage, "--beta") == NULL,
+        "Short usage not overridden, found --beta");
+
+    cargo_assert(!strcmp(usage, "Usage: program [options] args"),
+        "Did not find overriden short usage");
+
+    // Test stripping path. First no strip.
+    cargo_set_progname(cargo, "%s [options] args", "some/long/path/program");
+    usage = cargo_get_usage(cargo,
+        CARGO_USAGE_OVERRIDE_SHORT |
+        CARGO_USAGE_SHORT);
+    printf("STRIP:\n%s\n", usage);
+
+    cargo_assert(strstr(usage, "some/long/path/") == NULL,
+        "Found path when stripping");
+
+    usage = cargo_get_usage(cargo,
+        CARGO_USAGE_NO_STRIP_PROGNAME |
+        CARGO_USAGE_OVERRIDE_SHORT |
+        CARGO_USAGE_SHORT);
+    printf("NO STRIP:\n%s\n", usage);
+
+    cargo_assert(strstr(usage, "some/long/path/"),
+        "Did not find path when no strip");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_duplicate_alias)
+{
+    const char *usage = NULL;
+    ret = cargo_add_option(cargo, 0, "--beta -b", "an option", "D");
+    cargo_assert(ret == 0, "Failed to add option");
+
+    ret = cargo_add_option(cargo, 0, "--bravo -b", "another option", "D");
+    cargo_assert(ret != 0, "Successfully added option with taken alias");
+
+    ret = cargo_add_option(cargo, 0, "--bravo", "another option", "D");
+    cargo_assert(ret == 0, "Failed to add valid option");
+
+    ret = cargo_add_alias(cargo, "--bravo", "-r");
+    cargo_assert(ret == 0, "Failed to add valid alias");
+
+    ret = cargo_add_alias(cargo, "--bravo", "-b");
+    cargo_assert(ret != 0, "Successfully added option with taken alias");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_get_option_type)
+{
+    int a;
+    int b;
+    float c;
+    char *s = NULL;
+    const char *usage = NULL;
+    ret = cargo_add_option(cargo, 0, "--alpha -a", "an option", "b", &a);
+    cargo_assert(ret == 0, "Failed to add option");
+    cargo_assert(cargo_get_option_type(cargo, "--alpha") == CARGO_BOOL,
+                "Expected alpha to be a bool");
+
+    ret = cargo_add_option(cargo, 0, "--beta -b", "another option", "i", &b);
+    cargo_assert(ret == 0, "Failed to add option");
+    cargo_assert(cargo_get_option_type(cargo, "--beta") == CARGO_INT,
+                "Expected beta to be a int");
+
+    ret = cargo_add_option(cargo, 0, "--centauri -c", "another option", "f", &c);
+    cargo_assert(ret == 0, "Failed to add option");
+    cargo_assert(cargo_get_option_type(cargo, "--centauri") == CARGO_FLOAT,
+                "Expected centauri to be a float");
+
+    ret = cargo_add_option(cargo, 0, "--delta -d", "another option", "s", &s);
+    cargo_assert(ret == 0, "Failed to add option");
+    cargo_assert(cargo_get_option_type(cargo, "--delta") == CARGO_STRING,
+                "Expected delta to be a string");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_large_list_and_usage)
+{
+    #define LST_SIZE 256
+    char *lst[LST_SIZE];
+    size_t lst_count = 0;
+    const char *usage = NULL;
+
+    // This tests a specific bug where a large array created
+    // a buffer overflow when generating the metavar for the usage.
+    ret |= cargo_add_option(cargo, 0,
+            "--template --input",
+            "Path to one or more template files generated on specified events. "
+            "(Not to be confused with the template matcher)",
+            ".[s]#", &lst, &lst_count, LST_SIZE);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    usage = cargo_get_usage(cargo, CARGO_USAGE_SHORT);
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_large_list_and_usage2)
+{
+    #define LST_SIZE 256
+    char *lst[LST_SIZE];
+    size_t lst_count = 0;
+    const char *usage = NULL;
+
+    ret |= cargo_add_option(cargo, 0,
+            "--template --input",
+            "Path to one or more template files generated on specified events. "
+            "(Not to be confused with the template matcher)",
+            ".[s]+", &lst, &lst_count, LST_SIZE);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    usage = cargo_get_usage(cargo, 0);
+    printf("%s\n", usage);
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+#define _CARGO_ADD_TEST_VALIDATE(fmt, opt, funcname, ...)                   \
+    ret = cargo_add_option(cargo, 0, "--alpha -a", NULL, fmt, opt);         \
+    cargo_assert(ret == 0, "Failed to add option");                         \
+    ret = cargo_add_validation(cargo, 0, "--alpha", funcname(__VA_ARGS__)); \
+    cargo_assert(ret == 0, "Failed to add validation")
+
+#define _CARGO_TEST_VALIDATE_VALUE(val, dofail)                             \
+    do                                                                      \
+    {                                                                       \
+        char *args[] = { "program", "--alpha", #val };                      \
+        ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);\
+        if (dofail) cargo_assert(ret < 0, "Expected parse failure for " #val);\
+        else  cargo_assert(ret == 0, "Failed to parse");                    \
+    } while (0)
+
+_TEST_START(TEST_int_range_validation)
+{
+    int a = 0;
+    _CARGO_ADD_TEST_VALIDATE("i", &a, cargo_validate_int_range, 3, 6);
+    _CARGO_TEST_VALIDATE_VALUE(-200, 1);
+    _CARGO_TEST_VALIDATE_VALUE(2, 1);
+    _CARGO_TEST_VALIDATE_VALUE(3, 0);
+    _CARGO_TEST_VALIDATE_VALUE(5, 0);
+    _CARGO_TEST_VALIDATE_VALUE(6, 0);
+    _CARGO_TEST_VALIDATE_VALUE(123, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_float_range_validation)
+{
+    float a = 0;
+    _CARGO_ADD_TEST_VALIDATE("f", &a, cargo_validate_float_range, 3.0f, 6.0f, 0.00001f);
+    _CARGO_TEST_VALIDATE_VALUE(-312.4, 1);
+    _CARGO_TEST_VALIDATE_VALUE(2.4, 1);
+    _CARGO_TEST_VALIDATE_VALUE(3.0, 0);
+    _CARGO_TEST_VALIDATE_VALUE(5.5, 0);
+    _CARGO_TEST_VALIDATE_VALUE(6.0, 0);
+    _CARGO_TEST_VALIDATE_VALUE(6.2, 1);
+    _CARGO_TEST_VALIDATE_VALUE(123.424, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_double_range_validation)
+{
+    double a = 0;
+    _CARGO_ADD_TEST_VALIDATE("d", &a, cargo_validate_double_range, 3.0, 6.0, 0.00001);
+    _CARGO_TEST_VALIDATE_VALUE(2.3, 1);
+    _CARGO_TEST_VALIDATE_VALUE(3.0, 0);
+    _CARGO_TEST_VALIDATE_VALUE(5.2, 0);
+    _CARGO_TEST_VALIDATE_VALUE(6.0, 0);
+    _CARGO_TEST_VALIDATE_VALUE(123.0, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_uint_range_validation)
+{
+    unsigned int a = 0;
+    _CARGO_ADD_TEST_VALIDATE("u", &a, cargo_validate_uint_range, 10, 20);
+    _CARGO_TEST_VALIDATE_VALUE(2, 1);
+    _CARGO_TEST_VALIDATE_VALUE(10, 0);
+    _CARGO_TEST_VALIDATE_VALUE(15, 0);
+    _CARGO_TEST_VALIDATE_VALUE(20, 0);
+    _CARGO_TEST_VALIDATE_VALUE(123, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_longlong_range_validation)
+{
+    long long int a = 0;
+    _CARGO_ADD_TEST_VALIDATE("L", &a, cargo_validate_longlong_range, 10, 20);
+    _CARGO_TEST_VALIDATE_VALUE(-2, 1);
+    _CARGO_TEST_VALIDATE_VALUE(10, 0);
+    _CARGO_TEST_VALIDATE_VALUE(15, 0);
+    _CARGO_TEST_VALIDATE_VALUE(20, 0);
+    _CARGO_TEST_VALIDATE_VALUE(123, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_ulonglong_range_validation)
+{
+    unsigned long long int a = 0;
+    _CARGO_ADD_TEST_VALIDATE("U", &a, cargo_validate_ulonglong_range, 10, 20);
+    _CARGO_TEST_VALIDATE_VALUE(2, 1);
+    _CARGO_TEST_VALIDATE_VALUE(10, 0);
+    _CARGO_TEST_VALIDATE_VALUE(15, 0);
+    _CARGO_TEST_VALIDATE_VALUE(20, 0);
+    _CARGO_TEST_VALIDATE_VALUE(123, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_choices_validation)
+{
+    char *str = NULL;
+    _CARGO_ADD_TEST_VALIDATE("s", &str,
+            cargo_validate_choices, 0, CARGO_STRING,
+            2, "abc", "def");
+    _CARGO_TEST_VALIDATE_VALUE(abc, 0);
+    _CARGO_TEST_VALIDATE_VALUE(def, 0);
+    _CARGO_TEST_VALIDATE_VALUE(klmn, 1);
+    _CARGO_TEST_VALIDATE_VALUE(ABC, 0);
+    _CARGO_TEST_VALIDATE_VALUE(DEF, 0);
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &str);
+}
+_TEST_END()
+
+_TEST_START(TEST_choices_validation_case_sensitive)
+{
+    char *str = NULL;
+    _CARGO_ADD_TEST_VALIDATE("s", &str,
+            cargo_validate_choices,
+            CARGO_VALIDATE_CHOICES_CASE_SENSITIVE,
+            CARGO_STRING,
+            2, "abc", "def");
+    _CARGO_TEST_VALIDATE_VALUE(abc, 0);
+    _CARGO_TEST_VALIDATE_VALUE(def, 0);
+    _CARGO_TEST_VALIDATE_VALUE(klmn, 1);
+    _CARGO_TEST_VALIDATE_VALUE(ABC, 1);
+    _CARGO_TEST_VALIDATE_VALUE(DEF, 1);
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &str);
+}
+_TEST_END()
+
+_TEST_START(TEST_choices_validation_int)
+{
+    int a;
+    _CARGO_ADD_TEST_VALIDATE("i", &a,
+            cargo_validate_choices, 0, CARGO_INT,
+            3, -40, 30, 10);
+    _CARGO_TEST_VALIDATE_VALUE(-40, 0);
+    _CARGO_TEST_VALIDATE_VALUE(30, 0);
+    _CARGO_TEST_VALIDATE_VALUE(40, 1);
+    _CARGO_TEST_VALIDATE_VALUE(20, 1);
+    _CARGO_TEST_VALIDATE_VALUE(10, 0);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_choices_validation_uint)
+{
+    int a;
+    _CARGO_ADD_TEST_VALIDATE("u", &a,
+            cargo_validate_choices, 0, CARGO_UINT,
+            3, 40, 30, 10);
+    _CARGO_TEST_VALIDATE_VALUE(-45, 1);
+    _CARGO_TEST_VALIDATE_VALUE(30, 0);
+    _CARGO_TEST_VALIDATE_VALUE(40, 0);
+    _CARGO_TEST_VALIDATE_VALUE(20, 1);
+    _CARGO_TEST_VALIDATE_VALUE(10, 0);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_choices_validation_float)
+{
+    float a;
+    _CARGO_ADD_TEST_VALIDATE("f", &a,
+            cargo_validate_choices, 0, CARGO_FLOAT,
+            3, 3.2, 44.35, 500402.4);
+    _CARGO_TEST_VALIDATE_VALUE(3131.0, 1);
+    _CARGO_TEST_VALIDATE_VALUE(3.2, 0);
+    _CARGO_TEST_VALIDATE_VALUE(44.35, 0);
+    _CARGO_TEST_VALIDATE_VALUE(500402.4, 0);
+    _CARGO_TEST_VALIDATE_VALUE(10, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_choices_validation_double)
+{
+    double a;
+    _CARGO_ADD_TEST_VALIDATE("d", &a,
+            cargo_validate_choices, 0, CARGO_DOUBLE,
+            3, 3.2, 44.35, 500402.4);
+    _CARGO_TEST_VALIDATE_VALUE(3131.0, 1);
+    _CARGO_TEST_VALIDATE_VALUE(3.2, 0);
+    _CARGO_TEST_VALIDATE_VALUE(44.35, 0);
+    _CARGO_TEST_VALIDATE_VALUE(500402.4, 0);
+    _CARGO_TEST_VALIDATE_VALUE(10, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_choices_validation_longlong)
+{
+    long long int a;
+
+    _CARGO_ADD_TEST_VALIDATE("L", &a,
+            cargo_validate_choices, 0, CARGO_LONGLONG,
+            3,
+            (long long int)-1111111,
+            (long long int)32323232,
+            (long long int)1010101);
+    _CARGO_TEST_VALIDATE_VALUE(5, 1);
+    _CARGO_TEST_VALIDATE_VALUE(-1111111, 0);
+    _CARGO_TEST_VALIDATE_VALUE(32323232, 0);
+    _CARGO_TEST_VALIDATE_VALUE(1010101, 0);
+    _CARGO_TEST_VALIDATE_VALUE(4224422, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_choices_validation_ulonglong)
+{
+    unsigned long long int a;
+    _CARGO_ADD_TEST_VALIDATE("U", &a,
+            cargo_validate_choices, 0, CARGO_ULONGLONG,
+            3,
+            (unsigned long long int)11111111,
+            (unsigned long long int)32323232,
+            (unsigned long long int)1010101);
+    _CARGO_TEST_VALIDATE_VALUE(5, 1);
+    _CARGO_TEST_VALIDATE_VALUE(11111111, 0);
+    _CARGO_TEST_VALIDATE_VALUE(32323232, 0);
+    _CARGO_TEST_VALIDATE_VALUE(1010101, 0);
+    _CARGO_TEST_VALIDATE_VALUE(4224422, 1);
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_double_parse)
+{
+    // Set default values and make sure they are not cleared if we parse
+    // multiple times.
+    char *args[] = { "program", "--beta", "3" };
+    char *args2[] = { "program", "--alpha", "2" };
+    int a = 5;
+    int b = 6;
+    float c = 7.0f;
+    char *s = strdup("abc");
+    cargo_assert(s, "Failed to allocate s");
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "an option", "i", &a);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "another option", "i", &b);
+    ret |= cargo_add_option(cargo, 0, "--centauri -c", "another option", "f", &c);
+    ret |= cargo_add_option(cargo, 0, "--delta -d", "another option", "s", &s);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+
+    printf("First parse:\n");
+    printf("a == %d\n", a);
+    printf("b == %d\n", b);
+    printf("c == %f\n", c);
+    printf("s == %s\n", s);
+    cargo_assert(a == 5, "Expected a == 5");
+    cargo_assert(b == 3, "Expected b == 3 after parse");
+    cargo_assert(c == 7.0f, "Expected b == 7.0f");
+    cargo_assert(s && !strcmp(s, "abc"), "Expected s == 'abc'");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == 0, "Parse failed");
+
+    printf("\nSecond parse\n");
+    printf("a == %d\n", a);
+    printf("b == %d\n", b);
+    printf("c == %f\n", c);
+    printf("s == %s\n", s);
+    cargo_assert(a == 2, "Expected a == 2");
+    cargo_assert(b == 3, "Expected b == 3 after parse");
+    cargo_assert(c == 7.0f, "Expected b == 7.0f");
+    cargo_assert(s && !strcmp(s, "abc"), "Expected s == 'abc'");
+
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &s);
+}
+_TEST_END()
+
+_TEST_START(TEST_double_parse_clear)
+{
+    char *args[] = { "program", "--beta", "3" };
+    char *args2[] = { "program", "--delta", "def" };
+    int a = 5;
+    int b = 6;
+    float c = 7.0f;
+    char *s = strdup("abc");
+    cargo_assert(s, "Failed to allocate");
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", "an option", "i", &a);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", "another option", "i", &b);
+    ret |= cargo_add_option(cargo, 0, "--centauri -c", "another option", "f", &c);
+    ret |= cargo_add_option(cargo, 0, "--delta -d", "another option", "s", &s);
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert(s && !strcmp(s, "abc"), "Expected s to be 'abc'");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert(s && !strcmp(s, "def"), "Expected s to be 'def'");
+
+    _TEST_CLEANUP();
+    _cargo_xfree(NULL, &s);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_default_str, CARGO_AUTOCLEAN)
+{
+    char *args[] = { "program", "--alpha", "def" };
+    char *args2[] = { "program", "--beta", "DEF" };
+    char *s1 = strdup("abc");
+    char *s2 = "ABC"; // This should not be freed!
+    cargo_assert(s1, "Failed to allocate");
+
+    ret |= cargo_add_option(cargo, 0,
+            "--alpha -a", "an option", "s", &s1);
+    ret |= cargo_add_option(cargo, CARGO_OPT_DEFAULT_LITERAL,
+            "--beta -b", "another option", "s", &s2);
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert(s1 && !strcmp(s1, "def"), "Expected s to be 'def'");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert(s2 && !strcmp(s2, "DEF"), "Expected s to be 'DEF'");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_default_str2, CARGO_AUTOCLEAN | CARGO_DEFAULT_LITERALS)
+{
+    char *args[] = { "program", "--alpha", "def" };
+    char *args2[] = { "program", "--beta", "DEF" };
+    char *s1 = "abc";
+    char *s2 = "ABC"; // This should not be freed!
+    cargo_assert(s1, "Failed to allocate");
+
+    ret |= cargo_add_option(cargo, 0,
+            "--alpha -a", "an option", "s", &s1);
+    ret |= cargo_add_option(cargo, 0,
+            "--beta -b", "another option", "s", &s2);
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert(s1 && !strcmp(s1, "def"), "Expected s to be 'def'");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert(s2 && !strcmp(s2, "DEF"), "Expected s to be 'DEF'");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_default_str3, CARGO_AUTOCLEAN | CARGO_DEFAULT_LITERALS)
+{
+    char *args[] = { "program", "--alpha", "def" };
+    char *s1 = "abc";
+    char *s2 = "ABC"; // Don't touch this and make sure we don't try to free it.
+    cargo_assert(s1, "Failed to allocate");
+
+    ret |= cargo_add_option(cargo, 0,
+            "--alpha -a", "an option", "s", &s1);
+    ret |= cargo_add_option(cargo, 0,
+            "--beta -b", "another option", "s", &s2);
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Parse failed");
+    cargo_assert(s1 && !strcmp(s1, "def"), "Expected s1 to be 'def'");
+    cargo_assert(s2 && !strcmp(s2, "ABC"), "Expected s2 to be 'ABC'");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_default_str_add_fail, CARGO_DEFAULT_LITERALS)
+{
+    char *s1 = "abc";
+    cargo_assert(s1, "Failed to allocate");
+
+    // This should fail sinc CARGO_AUTOCLEAN is not on.
+    ret = cargo_add_option(cargo, 0,
+            "--alpha -a", "an option", "s", &s1);
+    cargo_assert(ret != 0, "Expected to fail");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_default_str_add_fail2)
+{
+    char *s1 = "abc";
+    cargo_assert(s1, "Failed to allocate");
+
+    // This should fail sinc CARGO_AUTOCLEAN is not on.
+    ret = cargo_add_option(cargo, CARGO_OPT_DEFAULT_LITERAL,
+            "--alpha -a", "an option", "s", &s1);
+    cargo_assert(ret != 0, "Expected to fail");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_nearly_equal)
+{
+    ret = _cargo_nearly_equal(3.2000001, 3.2, 0.00000001);
+    ret |= _cargo_nearly_equal(3.2001, 3.2, 0.00000001);
+    cargo_assert(ret == 0, "Should be equal");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_cargo_strdup_invalid_arg)
+{
+    char *p = _cargo_strdup(NULL, NULL);
+    cargo_assert(p == NULL, "Expected strdup to fail");
+    cargo_assert(errno == EINVAL, "Expected indication of faulty input argument");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_option_name_index)
+{
+    #define NAME_INDEX_OPT_COUNT 300
+    int vals[NAME_INDEX_OPT_COUNT];
+    char name[64];
+    size_t k;
+    char *args[] = { "program", "--opt5", "5", "-a299", "299", "--opt150", "150" };
+    memset(vals, 0, sizeof(vals));
+
+    for (k = 0; k < NAME_INDEX_OPT_COUNT; k++)
+    {
+        cargo_snprintf(name, sizeof(name), "--opt%lu -a%lu", k, k);
+        ret |= cargo_add_option(cargo, 0, name, NULL, "i", &vals[k]);
+    }
+    cargo_assert(ret == 0, "Failed to add options");
+
+    for (k = 0; k < NAME_INDEX_OPT_COUNT; k++)
+    {
+        cargo_snprintf(name, sizeof(name), "-a%lu", k);
+        cargo_assert(cargo_get_option_type(cargo, name) == CARGO_INT,
+                    "Failed to find alias");
+    }
+
+    // A failed add should not leave its names behind.
+    ret = cargo_add_option(cargo, 0, "--broken -b", NULL, "i!", &vals[0]);
+    cargo_assert(ret != 0, "Expected invalid format to fail");
+    cargo_assert(cargo_get_option_type(cargo, "--broken") == (cargo_type_t)-1,
+                "Removed option still found");
+    cargo_assert(cargo_get_option_type(cargo, "--opt7") == CARGO_INT,
+                "Lost option after failed add");
+    ret = cargo_add_option(cargo, 0, "--broken -b", NULL, "b", &vals[0]);
+    cargo_assert(ret == 0, "Failed to add option after failed add");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(vals[5] == 5, "Unexpected value for --opt5");
+    cargo_assert(vals[299] == 299, "Unexpected value for -a299");
+    cargo_assert(vals[150] == 150, "Unexpected value for --opt150");
+
+    _TEST_CLEANUP();
+    #undef NAME_INDEX_OPT_COUNT
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_token_classification, CARGO_NO_FAIL_UNKNOWN | CARGO_NOERR_OUTPUT)
+{
+    int *nums = NULL;
+    size_t num_count = 0;
+    int nums_expect[] = { -1, -20, 3 };
+    int v = 0;
+    const char **unknown = NULL;
+    size_t unknown_count = 0;
+    const char **extra = NULL;
+    size_t extra_count = 0;
+    char *args[] = { "program", "--nums", "-1", "-20", "3", "-vv",
+                     "--what", "file" };
+
+    ret |= cargo_add_option(cargo, 0, "--nums", NULL, "[i]+", &nums, &num_count);
+    ret |= cargo_add_option(cargo, 0, "--verbose -v", NULL, "b!", &v);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert_array(num_count, 3, nums, nums_expect);
+    cargo_assert(v == 2, "Expected -vv to count 2");
+
+    unknown = cargo_get_unknown(cargo, &unknown_count);
+    cargo_assert(unknown_count == 1, "Expected 1 unknown option");
+    cargo_assert(!strcmp(unknown[0], "--what"), "Expected --what to be unknown");
+
+    extra = cargo_get_args(cargo, &extra_count);
+    cargo_assert(extra_count == 2, "Expected 2 extra arguments");
+    cargo_assert(!strcmp(extra[1], "file"), "Expected file as extra argument");
+
+    _TEST_CLEANUP();
+    _cargo_free(NULL, nums);
+}
+_TEST_END()
+
+_TEST_START(TEST_positional_cursor)
+{
+    int a[2];
+    size_t a_count = 0;
+    int a_expect[] = { 1, 2 };
+    int b = 0;
+    int c = 0;
+    const char **extra = NULL;
+    size_t extra_count = 0;
+    const char *extra_expect[] = { "x", "y" };
+    char *args[] = { "program", "1", "--cc", "7", "2", "3", "x", "y" };
+
+    ret |= cargo_add_option(cargo, 0, "alpha", NULL, ".[i]#", &a, &a_count, 2);
+    ret |= cargo_add_option(cargo, 0, "beta", NULL, "i", &b);
+    ret |= cargo_add_option(cargo, 0, "--cc", NULL, "i", &c);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // Parse twice to make sure the cursor starts over.
+    ret |= cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    ret |= cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    cargo_assert_array(a_count, 2, a, a_expect);
+    cargo_assert(b == 3, "Expected beta to be 3");
+    cargo_assert(c == 7, "Expected --cc to be 7");
+
+    extra = cargo_get_args(cargo, &extra_count);
+    cargo_assert_str_array(extra_count, 2, extra, extra_expect);
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START(TEST_bundled_short_flags)
+{
+    int a = 0;
+    int b = 0;
+    int c = 0;
+    int v = 0;
+    char *args[] = { "program", "-abv", "-vv" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", NULL, "b", &a);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", NULL, "b", &b);
+    ret |= cargo_add_option(cargo, 0, "--gamma -c", NULL, "b", &c);
+    ret |= cargo_add_option(cargo, 0, "--verbose -v", NULL, "b!", &v);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    cargo_assert(a == 1, "Expected -a to be set");
+    cargo_assert(b == 1, "Expected -b to be set");
+    cargo_assert(c == 0, "Expected -c to not be set");
+    cargo_assert(v == 3, "Expected -v to be counted 3 times");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_bundled_non_bool_flags,
+               CARGO_NO_FAIL_UNKNOWN | CARGO_NOERR_OUTPUT)
+{
+    int a = 0;
+    int i = 0;
+    const char **unknown = NULL;
+    size_t unknown_count = 0;
+    char *args[] = { "program", "-ai", "5" };
+
+    // Only bool flags can be bundled.
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", NULL, "b", &a);
+    ret |= cargo_add_option(cargo, 0, "--integer -i", NULL, "i", &i);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(a == 0, "Expected -a to not be set");
+    cargo_assert(i == 0, "Expected -i to not be set");
+
+    unknown = cargo_get_unknown(cargo, &unknown_count);
+    cargo_assert(unknown_count == 1, "Expected 1 unknown option");
+    cargo_assert(!strcmp(unknown[0], "-ai"), "Expected -ai to be unknown");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_abbreviated_options, CARGO_NOERR_OUTPUT)
+{
+    int a = 0;
+    int b = 0;
+    int c = 0;
+    const char **unknown = NULL;
+    size_t unknown_count = 0;
+    char *args[] = { "program", "--alpha", "3", "--alphab", "4", "--gam", "5" };
+    char *args2[] = { "program", "--alp", "3" };
+    char *args3[] = { "program", "--gamm", "5" };
+    const char *err = NULL;
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", NULL, "i", &a);
+    ret |= cargo_add_option(cargo, 0, "--alphabet", NULL, "i", &b);
+    ret |= cargo_add_option(cargo, 0, "--gamma --gamut", NULL, "i", &c);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // "--alpha" is a complete name so it is not ambiguous even though
+    // it prefixes "--alphabet". "--gam" prefixes two aliases of
+    // the same option.
+    ret = cargo_parse(cargo, CARGO_ABBREV | CARGO_NOERR_OUTPUT,
+                      1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(a == 3, "Expected --alpha to be 3");
+    cargo_assert(b == 4, "Expected --alphabet to be 4");
+    cargo_assert(c == 5, "Expected --gamma to be 5");
+
+    // Ambiguous abbreviation.
+    ret = cargo_parse(cargo, CARGO_ABBREV | CARGO_NOERR_OUTPUT,
+                      1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == CARGO_PARSE_UNKNOWN_OPTS, "Expected unknown option");
+
+    unknown = cargo_get_unknown(cargo, &unknown_count);
+    cargo_assert(unknown_count == 1, "Expected 1 unknown option");
+    cargo_assert(!strcmp(unknown[0], "--alp"), "Expected --alp to be unknown");
+
+    // Off by default, so a typo is still unknown and gets a suggestion.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == CARGO_PARSE_UNKNOWN_OPTS, "Expected unknown option");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == CARGO_PARSE_UNKNOWN_OPTS, "Expected --gamm to be unknown");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Did you mean --gamma"),
+                 "Expected --gamma to be suggested");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+typedef struct _test_compiled_args_s
+{
+    int level;
+    char *name;
+    int vals[4];
+    size_t val_count;
+    int verbose;
+} _test_compiled_args_t;
+
+_TEST_START(TEST_compiled_parser)
+{
+    size_t i;
+    _test_compiled_args_t tmpl;
+    _test_compiled_args_t a;
+    _test_compiled_args_t b;
+    cargo_compiled_t compiled = NULL;
+    cargo_t state_a = NULL;
+    cargo_t state_b = NULL;
+    const char **extra = NULL;
+    size_t extra_count = 0;
+    int a_expect[] = { 1, 2, 3 };
+    char *args_a[] = { "program", "extra", "--level", "5", "--name", "alpha",
+                       "--vals", "1", "2", "3" };
+    char *args_b[] = { "program", "-vv", "--name", "beta" };
+    memset(&tmpl, 0, sizeof(tmpl));
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+
+    ret |= cargo_add_option(cargo, 0, "--level", NULL, "i", &tmpl.level);
+    ret |= cargo_add_option(cargo, 0, "--name", NULL, "s", &tmpl.name);
+    ret |= cargo_add_option(cargo, 0, "--vals", NULL, ".[i]+",
+                            &tmpl.vals, &tmpl.val_count, 4);
+    ret |= cargo_add_option(cargo, 0, "--verbose -v", NULL, "b!",
+                            &tmpl.verbose);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_compile(&cargo, &compiled, &tmpl, sizeof(tmpl));
+    cargo_assert(ret == 0, "Failed to compile");
+    cargo_assert(cargo == NULL, "Expected compile to take the context");
+
+    ret |= cargo_state_init(&state_a, compiled, &a);
+    ret |= cargo_state_init(&state_b, compiled, &b);
+    cargo_assert(ret == 0, "Failed to init parse states");
+
+    // Both states are parsed before looking at either.
+    ret |= cargo_parse(state_a, 0, 1, sizeof(args_a) / sizeof(args_a[0]), args_a);
+    ret |= cargo_parse(state_b, 0, 1, sizeof(args_b) / sizeof(args_b[0]), args_b);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    cargo_assert(a.level == 5, "Expected level 5");
+    cargo_assert(a.name && !strcmp(a.name, "alpha"), "Expected name alpha");
+    cargo_assert_array(a.val_count, 3, a.vals, a_expect);
+    cargo_assert(a.verbose == 0, "Expected verbose 0");
+
+    extra = cargo_get_args(state_a, &extra_count);
+    cargo_assert(extra_count == 1, "Expected 1 extra argument");
+    cargo_assert(!strcmp(extra[0], "extra"), "Expected \"extra\"");
+
+    cargo_assert(b.level == 0, "Expected level 0");
+    cargo_assert(b.name && !strcmp(b.name, "beta"), "Expected name beta");
+    cargo_assert(b.val_count == 0, "Expected no vals");
+    cargo_assert(b.verbose == 2, "Expected verbose 2");
+    cargo_assert(cargo_get_args(state_b, &extra_count) == NULL
+                || extra_count == 0, "Expected no extra arguments");
+
+    // The template is never written to.
+    cargo_assert(tmpl.level == 0 && !tmpl.name && !tmpl.verbose,
+                "Expected template to be untouched");
+
+    // The definitions can't be changed through a state.
+    ret = cargo_add_option(state_a, 0, "--other", NULL, "i", &a.level);
+    cargo_assert(ret == -1, "Expected adding an option to fail");
+
+    _TEST_CLEANUP();
+    for (i = 0; i < 2; i++)
+    {
+        _test_compiled_args_t *t = (i == 0) ? &a : &b;
+        free(t->name);
+    }
+    cargo_destroy(&state_a);
+    cargo_destroy(&state_b);
+    cargo_compiled_destroy(&compiled);
+}
+_TEST_END()
+
+_TEST_START(TEST_compiled_parser_target_outside)
+{
+    int level = 0;
+    _test_compiled_args_t tmpl;
+    cargo_compiled_t compiled = NULL;
+
+    // A target outside the template would be shared by all states.
+    ret |= cargo_add_option(cargo, 0, "--level", NULL, "i", &level);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_compile(&cargo, &compiled, &tmpl, sizeof(tmpl));
+    cargo_assert(ret == -1, "Expected compile to fail");
+    cargo_assert(cargo != NULL, "Expected the context to be kept");
+
+    _TEST_CLEANUP();
+    cargo_compiled_destroy(&compiled);
+}
+_TEST_END()
+
+_TEST_START(TEST_scratch_arena)
+{
+    int a = 0;
+    int b = 0;
+    size_t i;
+    size_t arg_count = 0;
+    const char **extra = NULL;
+    double scratch[256];
+    char *args[] = { "program", "--alpha", "1", "-b", "2", "x", "y" };
+    char *bad_args[] = { "program", "--alpha", "abc", "--betta" };
+    int argc = sizeof(args) / sizeof(args[0]);
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", NULL, "i", &a);
+    ret |= cargo_add_option(cargo, 0, "--beta -b", NULL, "i", &b);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // The first parse sizes the arena, after that no heap calls are needed.
+    for (i = 0; i < 3; i++)
+    {
+        ret = cargo_parse(cargo, 0, 1, argc, args);
+        cargo_assert(ret == 0, "Failed to parse");
+        cargo_assert(a == 1 && b == 2, "Expected a == 1 and b == 2");
+
+        extra = cargo_get_args(cargo, &arg_count);
+        cargo_assert(arg_count == 2, "Expected 2 extra arguments");
+        cargo_assert(!strcmp(extra[0], "x") && !strcmp(extra[1], "y"),
+                    "Expected \"x\" and \"y\"");
+
+        if (i > 0)
+        {
+            cargo_assert(cargo_get_heap_alloc_count(cargo) == 0,
+                        "Expected no heap allocations");
+        }
+    }
+
+    // Use a user supplied buffer instead.
+    ret = cargo_set_scratch_buffer(cargo, scratch, sizeof(scratch));
+    cargo_assert(ret == 0, "Failed to set scratch buffer");
+    cargo_assert(cargo_get_args(cargo, &arg_count) == NULL,
+                "Expected args to be cleared");
+
+    ret = cargo_parse(cargo, 0, 1, argc, args);
+    cargo_assert(ret == 0, "Failed to parse with scratch buffer");
+    cargo_assert(cargo_get_heap_alloc_count(cargo) == 0,
+                "Expected no heap allocations with scratch buffer");
+    extra = cargo_get_args(cargo, &arg_count);
+    cargo_assert(arg_count == 2, "Expected 2 extra arguments");
+    cargo_assert(((char *)extra >= (char *)scratch)
+                && ((char *)extra < (char *)scratch + sizeof(scratch)),
+                "Expected args to be in the scratch buffer");
+
+    // Errors are built in the arena as well.
+    ret = cargo_parse(cargo, CARGO_NOERR_OUTPUT, 1,
+                    sizeof(bad_args) / sizeof(bad_args[0]), bad_args);
+    cargo_assert(ret != 0, "Expected parse to fail");
+    cargo_assert(cargo_get_error(cargo) != NULL, "Expected an error");
+
+    // Too small to be usable.
+    ret = cargo_set_scratch_buffer(cargo, (char *)scratch + 1, 1);
+    cargo_assert(ret == -1, "Expected a too small buffer to fail");
+
+    // Back to the internal arena.
+    ret = cargo_set_scratch_buffer(cargo, NULL, 0);
+    cargo_assert(ret == 0, "Failed to reset scratch buffer");
+    ret = cargo_parse(cargo, 0, 1, argc, args);
+    cargo_assert(ret == 0, "Failed to parse after reset");
+    extra = cargo_get_args(cargo, &arg_count);
+    cargo_assert(arg_count == 2, "Expected 2 extra arguments");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+typedef struct _test_allocator_s
+{
+    int live;       // Allocations not yet freed.
+    int calls;
+} _test_allocator_t;
+
+static void *_test_allocator_malloc(void *user, size_t sz)
+{
+    _test_allocator_t *t = (_test_allocator_t *)user;
+    t->live++;
+    t->calls++;
+    return malloc(sz);
+}
+
+static void *_test_allocator_realloc(void *user, void *ptr, size_t sz)
+{
+    _test_allocator_t *t = (_test_allocator_t *)user;
+    if (!ptr) t->live++;
+    t->calls++;
+    return realloc(ptr, sz);
+}
+
+static void _test_allocator_free(void *user, void *ptr)
+{
+    _test_allocator_t *t = (_test_allocator_t *)user;
+    t->live--;
+    free(ptr);
+}
+
+_TEST_START(TEST_context_allocator)
+{
+    _test_allocator_t ta;
+    _test_allocator_t tb;
+    cargo_allocator_t alloc_a;
+    cargo_allocator_t alloc_b;
+    cargo_t c = NULL;
+    cargo_t state = NULL;
+    cargo_compiled_t compiled = NULL;
+    _test_compiled_args_t tmpl;
+    _test_compiled_args_t vals;
+    char *name = NULL;
+    int *nums = NULL;
+    size_t num_count = 0;
+    int nums_expect[] = { 1, 2, 3 };
+    char *args[] = { "program", "--name", "alpha", "--nums", "1", "2", "3" };
+    char *state_args[] = { "program", "-v", "--name", "beta" };
+    memset(&ta, 0, sizeof(ta));
+    memset(&tb, 0, sizeof(tb));
+    memset(&tmpl, 0, sizeof(tmpl));
+    memset(&vals, 0, sizeof(vals));
+
+    alloc_a.malloc_fn = _test_allocator_malloc;
+    alloc_a.realloc_fn = _test_allocator_realloc;
+    alloc_a.free_fn = _test_allocator_free;
+    alloc_a.user = &ta;
+    alloc_b = alloc_a;
+    alloc_b.user = &tb;
+
+    // All functions are required.
+    alloc_a.free_fn = NULL;
+    ret = cargo_init_with_allocator(&c, &alloc_a, 0, "program");
+    cargo_assert(ret == -1, "Expected an incomplete allocator to fail");
+    cargo_assert(c == NULL, "Expected no context");
+    alloc_a.free_fn = _test_allocator_free;
+
+    // Nothing should go through the global functions.
+    cargo_set_memfunctions(_cargo_test_malloc, _cargo_test_realloc, free);
+    _cargo_test_set_malloc_fail_count(0);
+    _cargo_test_set_realloc_fail_count(0);
+
+    ret = cargo_init_with_allocator(&c, &alloc_a,
+                                    CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT,
+                                    "program");
+    cargo_assert(ret == 0, "Failed to init with allocator");
+    ret |= cargo_add_option(c, 0, "--name", NULL, "s", &name);
+    ret |= cargo_add_option(c, 0, "--nums", NULL, "[i]+", &nums, &num_count);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(c, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(name && !strcmp(name, "alpha"), "Expected name alpha");
+    cargo_assert_array(num_count, 3, nums, nums_expect);
+    cargo_assert(cargo_get_usage(c, 0) != NULL, "Failed to get usage");
+
+    cargo_assert(ta.calls > 0, "Expected the allocator to be used");
+    cargo_assert((malloc_current == 0) && (realloc_current == 0),
+                "Expected no calls to the global functions");
+
+    cargo_destroy(&c);
+    cargo_assert(ta.live == 0, "Expected everything to be freed");
+
+    // A parse state can use a different allocator than its compiled parser.
+    ret = cargo_init_with_allocator(&c, &alloc_a, CARGO_AUTOCLEAN, "program");
+    ret |= cargo_add_option(c, 0, "--name", NULL, "s", &tmpl.name);
+    ret |= cargo_add_option(c, 0, "--verbose -v", NULL, "b!", &tmpl.verbose);
+    ret |= cargo_compile(&c, &compiled, &tmpl, sizeof(tmpl));
+    cargo_assert(ret == 0, "Failed to compile");
+    ta.calls = 0;
+
+    ret = cargo_state_init_with_allocator(&state, compiled, &vals, &alloc_b);
+    cargo_assert(ret == 0, "Failed to init parse state");
+    ret = cargo_parse(state, 0, 1,
+                      sizeof(state_args) / sizeof(state_args[0]), state_args);
+    cargo_assert(ret == 0, "Failed to parse state");
+    cargo_assert(vals.name && !strcmp(vals.name, "beta"), "Expected name beta");
+    cargo_assert(vals.verbose == 1, "Expected verbose 1");
+    cargo_assert(ta.calls == 0, "Expected the state to not use the parser allocator");
+    cargo_assert(tb.calls > 0, "Expected the state allocator to be used");
+
+    cargo_destroy(&state);
+    cargo_assert(tb.live == 0, "Expected everything in the state to be freed");
+    cargo_compiled_destroy(&compiled);
+    cargo_assert(ta.live == 0, "Expected everything to be freed");
+    cargo_assert((malloc_current == 0) && (realloc_current == 0),
+                "Expected no calls to the global functions");
+
+    _TEST_CLEANUP();
+    cargo_set_memfunctions(NULL, NULL, NULL);
+    cargo_destroy(&state);
+    cargo_compiled_destroy(&compiled);
+    cargo_destroy(&c);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_streaming_parse, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    char *name = NULL;
+    char *file = NULL;
+    int *nums = NULL;
+    size_t num_count = 0;
+    int pair[2];
+    size_t pair_count = 0;
+    int verbose = 0;
+    int req = 0;
+    const char **extra = NULL;
+    size_t extra_count = 0;
+    int nums_expect[] = { 1, 2, 3 };
+    int pair_expect[] = { 4, 5 };
+    char *chunk1[] = { "1", "2" };
+    char *chunk2[] = { "--pair", "4" };
+    char *chunk3[] = { "--name", "beta", "--bogus" };
+
+    ret |= cargo_add_option(cargo, 0, "--name", NULL, "s", &name);
+    ret |= cargo_add_option(cargo, 0, "--nums", NULL, "[i]+", &nums, &num_count);
+    ret |= cargo_add_option(cargo, 0, "--pair", NULL, ".[i]#",
+                            &pair, &pair_count, 2);
+    ret |= cargo_add_option(cargo, 0, "--verbose -v", NULL, "b", &verbose);
+    ret |= cargo_add_option(cargo, CARGO_OPT_REQUIRED, "--req", NULL, "i", &req);
+    ret |= cargo_add_option(cargo, 0, "file", NULL, "s", &file);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse_push(cargo, "--nums");
+    cargo_assert(ret != 0, "Expected push without begin to fail");
+
+    ret = cargo_parse_begin(cargo, 0);
+    cargo_assert(ret == 0, "Failed to begin parse");
+
+    // A list keeps taking values across pushes.
+    ret |= cargo_parse_push(cargo, "--nums");
+    ret |= cargo_parse_push_args(cargo, 2, chunk1);
+    ret |= cargo_parse_push(cargo, "3");
+    cargo_assert(ret == 0, "Failed to push list");
+    cargo_assert(cargo->stream_count == 0, "Expected list values to be parsed");
+
+    // A fixed count waits for all of its values.
+    ret = cargo_parse_push_args(cargo, 2, chunk2);
+    cargo_assert(ret == 0, "Failed to push pair");
+    cargo_assert(cargo->stream_count == 2, "Expected pair to wait for values");
+    ret |= cargo_parse_push(cargo, "5");
+    cargo_assert(cargo->stream_count == 0, "Expected pair to be parsed");
+
+    ret |= cargo_parse_push(cargo, "-v");
+    ret |= cargo_parse_push(cargo, "--name");
+    ret |= cargo_parse_push(cargo, "alpha");
+    ret |= cargo_parse_push(cargo, "input.txt");
+    ret |= cargo_parse_push(cargo, "extra");
+    ret |= cargo_parse_push(cargo, "--req");
+    ret |= cargo_parse_push(cargo, "7");
+    cargo_assert(ret == 0, "Failed to push");
+
+    ret = cargo_parse_end(cargo);
+    cargo_assert(ret == 0, "Failed to end parse");
+    cargo_assert_array(num_count, 3, nums, nums_expect);
+    cargo_assert_array(pair_count, 2, pair, pair_expect);
+    cargo_assert(verbose == 1, "Expected verbose 1");
+    cargo_assert(name && !strcmp(name, "alpha"), "Expected name alpha");
+    cargo_assert(file && !strcmp(file, "input.txt"), "Expected file input.txt");
+    cargo_assert(req == 7, "Expected req 7");
+
+    extra = cargo_get_args(cargo, &extra_count);
+    cargo_assert(extra_count == 1, "Expected 1 extra arg");
+    cargo_assert(!strcmp(extra[0], "extra"), "Expected extra arg \"extra\"");
+    free(file);
+    file = NULL;
+
+    ret = cargo_parse_push(cargo, "--nums");
+    cargo_assert(ret != 0, "Expected push after end to fail");
+
+    // Unknown options are reported when the parse ends.
+    ret = cargo_parse_begin(cargo, 0);
+    ret |= cargo_parse_push_args(cargo, 3, chunk3);
+    cargo_assert(ret == 0, "Expected unknown option to not fail push");
+    ret = cargo_parse_end(cargo);
+    cargo_assert(ret == CARGO_PARSE_UNKNOWN_OPTS, "Expected unknown option");
+    extra = cargo_get_unknown(cargo, &extra_count);
+    cargo_assert(extra_count == 1, "Expected 1 unknown option");
+    cargo_assert(!strcmp(extra[0], "--bogus"), "Expected --bogus");
+
+    // ... or right away with CARGO_UNKNOWN_EARLY.
+    ret = cargo_parse_begin(cargo, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT
+                                 | CARGO_UNKNOWN_EARLY);
+    ret |= cargo_parse_push_args(cargo, 3, chunk3);
+    cargo_assert(ret == CARGO_PARSE_UNKNOWN_OPTS, "Expected early unknown option");
+    cargo_assert(!cargo->streaming, "Expected failed push to end the parse");
+
+    ret = cargo_parse_begin(cargo, 0);
+    ret |= cargo_parse_push(cargo, "--name");
+    ret |= cargo_parse_push(cargo, "beta");
+    cargo_assert(ret == 0, "Failed to push");
+    ret = cargo_parse_end(cargo);
+    cargo_assert(ret == CARGO_PARSE_MISS_REQUIRED, "Expected missing required");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+static int _test_write_file(const char *path, const char *content)
+{
+    FILE *f = NULL;
+
+    if (!(f = fopen(path, "wb")))
+        return -1;
+
+    fputs(content, f);
+    fclose(f);
+    return 0;
+}
+
+_TEST_START_EX(TEST_response_files, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    char *name = NULL;
+    int *nums = NULL;
+    size_t num_count = 0;
+    const char **extra = NULL;
+    size_t extra_count = 0;
+    int nums_expect[] = { 1, 2, 3 };
+    const char *content = "--nums 1 '2' \\3\n--name \"hello world\" "
+                          "@cargo_test_nested.rsp\n";
+    char buf[128];
+    FILE *f = NULL;
+    size_t len = 0;
+    char *args[] = { "program", "@cargo_test_args.rsp", "last" };
+    char *missing_args[] = { "program", "@cargo_test_missing.rsp" };
+    char *loop_args[] = { "program", "@cargo_test_loop.rsp" };
+
+    ret |= _test_write_file("cargo_test_args.rsp", content);
+    ret |= _test_write_file("cargo_test_nested.rsp", "extra\\ arg");
+    ret |= _test_write_file("cargo_test_loop.rsp", "@cargo_test_loop.rsp");
+    cargo_assert(ret == 0, "Failed to write response files");
+
+    ret |= cargo_add_option(cargo, 0, "--name", NULL, "s", &name);
+    ret |= cargo_add_option(cargo, 0, "--nums", NULL, "[i]+", &nums, &num_count);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // Only expanded when asked for.
+    ret = cargo_parse(cargo, 0, 1, 3, args);
+    cargo_assert(ret == 0, "Failed to parse");
+    extra = cargo_get_args(cargo, &extra_count);
+    cargo_assert(extra_count == 2, "Expected 2 extra args");
+    cargo_assert(!strcmp(extra[0], "@cargo_test_args.rsp"),
+                "Expected response file to be an extra arg");
+
+    // Pushed arguments are expanded as well.
+    ret |= cargo_parse_begin(cargo, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT
+                                  | CARGO_RESPONSE_FILES);
+    ret |= cargo_parse_push(cargo, "@cargo_test_args.rsp");
+    ret |= cargo_parse_push(cargo, "last");
+    ret |= cargo_parse_end(cargo);
+    cargo_assert(ret == 0, "Failed to stream parse response file");
+    cargo_assert_array(num_count, 3, nums, nums_expect);
+    cargo_assert(name && !strcmp(name, "hello world"), "Expected \"hello world\"");
+
+    ret = cargo_parse_begin(cargo, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT
+                                 | CARGO_RESPONSE_FILES);
+    cargo_assert(ret == 0, "Failed to begin stream parse");
+    ret = cargo_parse_push(cargo, "@cargo_test_missing.rsp");
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected missing pushed file to fail");
+
+    ret = cargo_parse(cargo, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT
+                           | CARGO_RESPONSE_FILES, 1, 3, args);
+    cargo_assert(ret == 0, "Failed to parse response file");
+    cargo_assert_array(num_count, 3, nums, nums_expect);
+    cargo_assert(name && !strcmp(name, "hello world"), "Expected \"hello world\"");
+    cargo_assert(cargo->mapping_count == 2, "Expected 2 mapped files");
+
+    extra = cargo_get_args(cargo, &extra_count);
+    cargo_assert(extra_count == 2, "Expected 2 extra args");
+    cargo_assert(!strcmp(extra[0], "extra arg"), "Expected \"extra arg\"");
+    cargo_assert(!strcmp(extra[1], "last"), "Expected \"last\"");
+
+    // The file itself is left untouched.
+    cargo_assert((f = fopen("cargo_test_args.rsp", "rb")) != NULL,
+                "Failed to open response file");
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    cargo_assert(!strcmp(buf, content), "Expected response file to be unchanged");
+
+    ret = cargo_parse(cargo, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT
+                           | CARGO_RESPONSE_FILES, 1, 2, missing_args);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected missing file to fail");
+    cargo_assert(strstr(cargo_get_error(cargo), "cargo_test_missing.rsp"),
+                "Expected file name in error");
+
+    ret = cargo_parse(cargo, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT
+                           | CARGO_RESPONSE_FILES, 1, 2, loop_args);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected recursive file to fail");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+    remove("cargo_test_args.rsp");
+    remove("cargo_test_nested.rsp");
+    remove("cargo_test_loop.rsp");
+}
+_TEST_END()
+
+typedef struct _test_batch_s
+{
+    int *level;
+    char **name;
+    size_t lines[4];
+    cargo_parse_result_t results[4];
+    int levels[4];
+    char names[4][16];
+    size_t count;
+} _test_batch_t;
+
+static int _test_batch_callback(cargo_t ctx, void *user, size_t line,
+                                cargo_parse_result_t result)
+{
+    _test_batch_t *b = (_test_batch_t *)user;
+
+    if (b->count >= 4)
+        return -1;
+
+    b->lines[b->count] = line;
+    b->results[b->count] = result;
+    b->levels[b->count] = *b->level;
+    cargo_snprintf(b->names[b->count], sizeof(b->names[0]), "%s",
+                   *b->name ? *b->name : "");
+    b->count++;
+
+    // Stop at the line containing "stop".
+    return (*b->level == 99);
+}
+
+_TEST_START_EX(TEST_parse_batch, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    int level = 0;
+    char *name = NULL;
+    _test_batch_t b;
+    const char *lines =
+        "--level 1 --name a\n"
+        "\n"
+        "--level x\n"
+        "  --name \"b c\" --level 3\r\n"
+        "--level 99\n"
+        "--level 5";
+    memset(&b, 0, sizeof(b));
+    b.level = &level;
+    b.name = &name;
+
+    ret |= cargo_add_option(cargo, 0, "--level", NULL, "i", &level);
+    ret |= cargo_add_option(cargo, 0, "--name", NULL, "s", &name);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse_batch(cargo, 0, lines, strlen(lines),
+                            _test_batch_callback, &b);
+    cargo_assert(ret == 4, "Expected 4 lines to be parsed");
+    cargo_assert(b.count == 4, "Expected 4 callbacks");
+
+    cargo_assert(b.lines[0] == 0, "Expected line 0");
+    cargo_assert(b.results[0] == CARGO_PARSE_OK, "Expected line 0 to parse");
+    cargo_assert(b.levels[0] == 1, "Expected level 1");
+    cargo_assert(!strcmp(b.names[0], "a"), "Expected name a");
+
+    cargo_assert(b.lines[1] == 2, "Expected blank line to be skipped");
+    cargo_assert(b.results[1] == CARGO_PARSE_FAIL_OPT, "Expected line 2 to fail");
+
+    cargo_assert(b.lines[2] == 3, "Expected line 3");
+    cargo_assert(b.results[2] == CARGO_PARSE_OK, "Expected line 3 to parse");
+    cargo_assert(b.levels[2] == 3, "Expected level 3");
+    cargo_assert(!strcmp(b.names[2], "b c"), "Expected name \"b c\"");
+
+    // The callback stopped the batch.
+    cargo_assert(b.lines[3] == 4, "Expected line 4");
+    cargo_assert(b.levels[3] == 99, "Expected level 99");
+
+    // Without a callback, and without a newline at the end.
+    ret = cargo_parse_batch(cargo, 0, "--level 7", 9, NULL, NULL);
+    cargo_assert(ret == 1, "Expected 1 line to be parsed");
+    cargo_assert(level == 7, "Expected level 7");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_integer_overflow, CARGO_NOERR_OUTPUT)
+{
+    int i = 0;
+    unsigned int u = 0;
+    long long ll = 0;
+    unsigned long long ull = 0;
+    #define TEST_PARSE_INT(opt, value)                                  \
+    {                                                                   \
+        char *args[] = { "program", opt, value };                       \
+        ret = cargo_parse(cargo, 0, 1, 3, args);                        \
+    }
+
+    ret |= cargo_add_option(cargo, 0, "--int", NULL, "i", &i);
+    ret |= cargo_add_option(cargo, 0, "--uint", NULL, "u", &u);
+    ret |= cargo_add_option(cargo, 0, "--ll", NULL, "L", &ll);
+    ret |= cargo_add_option(cargo, 0, "--ull", NULL, "U", &ull);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    TEST_PARSE_INT("--int", "-2147483648");
+    cargo_assert((ret == 0) && (i == INT_MIN), "Expected INT_MIN");
+    TEST_PARSE_INT("--int", "2147483647");
+    cargo_assert((ret == 0) && (i == INT_MAX), "Expected INT_MAX");
+    TEST_PARSE_INT("--int", "2147483648");
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected int overflow to fail");
+    TEST_PARSE_INT("--int", "-2147483649");
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected int underflow to fail");
+
+    // Long digit runs.
+    TEST_PARSE_INT("--int", "0000000000000000000123");
+    cargo_assert((ret == 0) && (i == 123), "Expected 123");
+    TEST_PARSE_INT("--int", "+1234567890");
+    cargo_assert((ret == 0) && (i == 1234567890), "Expected 1234567890");
+
+    TEST_PARSE_INT("--uint", "4294967295");
+    cargo_assert((ret == 0) && (u == UINT_MAX), "Expected UINT_MAX");
+    TEST_PARSE_INT("--uint", "4294967296");
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected uint overflow to fail");
+    TEST_PARSE_INT("--uint", "-1");
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected negative uint to fail");
+
+    TEST_PARSE_INT("--ll", "-9223372036854775808");
+    cargo_assert((ret == 0) && (ll == LLONG_MIN), "Expected LLONG_MIN");
+    TEST_PARSE_INT("--ll", "9223372036854775807");
+    cargo_assert((ret == 0) && (ll == LLONG_MAX), "Expected LLONG_MAX");
+    TEST_PARSE_INT("--ll", "9223372036854775808");
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected long long overflow to fail");
+
+    TEST_PARSE_INT("--ull", "18446744073709551615");
+    cargo_assert((ret == 0) && (ull == ULLONG_MAX), "Expected ULLONG_MAX");
+    TEST_PARSE_INT("--ull", "18446744073709551616");
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected unsigned long long overflow to fail");
+    TEST_PARSE_INT("--ull", "99999999999999999999");
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected unsigned long long overflow to fail");
+
+    #undef TEST_PARSE_INT
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+static unsigned long long _test_rand_state = 88172645463325252ULL;
+
+static unsigned long long _test_rand(void)
+{
+    // xorshift64
+    _test_rand_state ^= _test_rand_state << 13;
+    _test_rand_state ^= _test_rand_state >> 7;
+    _test_rand_state ^= _test_rand_state << 17;
+    return _test_rand_state;
+}
+
+static void _test_random_decimal(char *buf, size_t size)
+{
+    unsigned long long r = _test_rand();
+    double d;
+    float f;
+    int k;
+    int n;
+    int point;
+    char *p = buf;
+
+    switch (r % 4)
+    {
+        case 0:
+        {
+            // Any double, printed with a random precision, which also
+            // gives values close to halfway between two doubles.
+            r = _test_rand();
+            memcpy(&d, &r, sizeof(d));
+            if (d != d) d = 1.0;
+            cargo_snprintf(buf, size, "%.*g", (int)(_test_rand() % 25) + 1, d);
+            break;
+        }
+        case 1:
+        {
+            unsigned int u = (unsigned int)_test_rand();
+            memcpy(&f, &u, sizeof(f));
+            if (f != f) f = 1.0f;
+            cargo_snprintf(buf, size, "%.*e", (int)(_test_rand() % 12), f);
+            break;
+        }
+        default:
+        {
+            // Random digits, point and exponent.
+            n = (int)(_test_rand() % 30) + 1;
+            point = (int)(_test_rand() % (n + 1));
+
+            if (_test_rand() % 2)
+                *p++ = '-';
+
+            for (k = 0; k < n; k++)
+            {
+                if (k == point)
+                    *p++ = '.';
+                *p++ = (char)('0' + (_test_rand() % 10));
+            }
+
+            cargo_snprintf(p, size - (p - buf), "e%d",
+                           (int)(_test_rand() % 700) - 350);
+            break;
+        }
+    }
+}
+
+_TEST_START(TEST_float_parsing)
+{
+    int k;
+    char buf[64];
+    double d1;
+    double d2;
+    float f1;
+    float f2;
+    const char *end1 = NULL;
+    char *end2 = NULL;
+    const char *fixed[] =
+    {
+        "0", "-0", "0.1", "1e23", "2.2250738585072011e-308",
+        "4.9406564584124654e-324", "2.4703282292062327e-324",
+        "1.7976931348623157e308", "1.7976931348623159e308", "1e400",
+        "1e-400", "9007199254740993", "0.1e", "1.5e+", "  3.25abc",
+        "+.5", "5.", "3.4028235e38", "1.4e-45", "7.006492e-46",
+        "inf", "-Infinity", "0x1.8p1",
+        "179769313486231580793728971405303415079934132710037826936173778980444"
+        "968292764750946649017977587207096330286416692887910946555547851940402"
+        "630657488671505820681908902000708383676273854845817711531764475730270"
+        "069855571366959622842914819860834936475292719074168444365510704342711"
+        "559699508093042880177904174497792"
+    };
+
+    // Every fixed case and a random corpus must match strtod and
+    // strtof exactly, including where the number ends.
+    for (k = 0; k < (int)(sizeof(fixed) / sizeof(fixed[0])) + 200000; k++)
+    {
+        const char *s = buf;
+
+        if (k < (int)(sizeof(fixed) / sizeof(fixed[0])))
+            s = fixed[k];
+        else
+            _test_random_decimal(buf, sizeof(buf));
+
+        end1 = _cargo_parse_double(s, &d1);
+        d2 = strtod(s, &end2);
+
+        if ((end1 != end2) || memcmp(&d1, &d2, sizeof(d1)))
+        {
+            fprintf(stderr, "\"%s\": %.17g != strtod %.17g\n", s, d1, d2);
+            cargo_assert(0, "Expected the same double as strtod");
+        }
+
+        end1 = _cargo_parse_float(s, &f1);
+        f2 = strtof(s, &end2);
+
+        if ((end1 != end2) || memcmp(&f1, &f2, sizeof(f1)))
+        {
+            fprintf(stderr, "\"%s\": %.9g != strtof %.9g\n", s, f1, f2);
+            cargo_assert(0, "Expected the same float as strtof");
+        }
+    }
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_unbounded_array_size, CARGO_AUTOCLEAN)
+{
+    size_t k;
+    size_t opt_i;
+    int *a = NULL;
+    size_t a_count = 0;
+    int *b = NULL;
+    size_t b_count = 0;
+    int *pos = NULL;
+    size_t pos_count = 0;
+    int flag = 0;
+    int pos_expect[] = { 10, 11, 12, 13, 14 };
+    char *args[] =
+    {
+        "program", "10", "11", "--flag", "12", "13", "14",
+        "--alpha", "1", "2", "3", "--beta", "4", "5"
+    };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha", NULL, "[i]+", &a, &a_count);
+    ret |= cargo_add_option(cargo, 0, "--beta", NULL, "[i]+", &b, &b_count);
+    ret |= cargo_add_option(cargo, 0, "--flag", NULL, "b", &flag);
+    ret |= cargo_add_option(cargo, 0, "pos", NULL, "[i]+", &pos, &pos_count);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Expected parse to succeed");
+    cargo_assert((a_count == 3) && (a[0] == 1) && (a[2] == 3),
+                 "Expected --alpha 1 2 3");
+    cargo_assert((b_count == 2) && (b[0] == 4) && (b[1] == 5),
+                 "Expected --beta 4 5");
+
+    // The positional is interrupted by --flag, so it has to grow.
+    cargo_assert(pos_count == 5, "Expected 5 positional values");
+    for (k = 0; k < pos_count; k++)
+    {
+        cargo_assert(pos[k] == pos_expect[k], "Unexpected positional value");
+    }
+
+    // Each array is sized after the values stored in it,
+    // not the rest of argv.
+    cargo_assert(_cargo_find_option_name(cargo, "--alpha", &opt_i, NULL) == 0,
+                 "Expected to find --alpha");
+    cargo_assert(cargo->options[opt_i].target_alloc_count == 3,
+                 "Expected --alpha to be allocated for 3 values");
+    cargo_assert(_cargo_find_option_name(cargo, "--beta", &opt_i, NULL) == 0,
+                 "Expected to find --beta");
+    cargo_assert(cargo->options[opt_i].target_alloc_count == 2,
+                 "Expected --beta to be allocated for 2 values");
+    cargo_assert(_cargo_find_option_name(cargo, "pos", &opt_i, NULL) == 0,
+                 "Expected to find pos");
+    cargo_assert(cargo->options[opt_i].target_alloc_count == 5,
+                 "Expected pos to be shrunk to 5 values");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_bulk_conversion, CARGO_NOERR_OUTPUT)
+{
+    int *nums = NULL;
+    size_t num_count = 0;
+    double *ds = NULL;
+    size_t d_count = 0;
+    unsigned long long *us = NULL;
+    size_t u_count = 0;
+    const char *err = NULL;
+    char *args1[] = { "program", "--nums", "1", "2", "3", "--ds", "0.5", "2e3",
+                      "--us", "18446744073709551615", "7" };
+    char *args2[] = { "program", "--nums", "1", "200", "x" };
+    char *args3[] = { "program", "--nums", "1", "2", "x", "200" };
+
+    ret |= cargo_add_option(cargo, 0, "--nums", NULL, "[i]+", &nums, &num_count);
+    ret |= cargo_add_validation(cargo, 0, "--nums",
+                                cargo_validate_int_range(0, 100));
+    ret |= cargo_add_option(cargo, 0, "--ds", NULL, "[d]*", &ds, &d_count);
+    ret |= cargo_add_option(cargo, 0, "--us", NULL, "[U]+", &us, &u_count);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Expected parse to succeed");
+    cargo_assert((num_count == 3) && (nums[0] == 1) && (nums[2] == 3),
+                 "Expected --nums 1 2 3");
+    cargo_assert((d_count == 2) && (ds[0] == 0.5) && (ds[1] == 2000.0),
+                 "Expected --ds 0.5 2e3");
+    cargo_assert((u_count == 2) && (us[0] == ULLONG_MAX) && (us[1] == 7),
+                 "Expected --us ULLONG_MAX 7");
+    _cargo_cleanup_option_values(cargo, 1);
+
+    // The value that fails validation comes before the one that
+    // can't be parsed, so that is the error.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected validation to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && !strstr(err, "Cannot parse"),
+                 "Expected a validation error");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected parse to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Cannot parse \"x\" as int"),
+                 "Expected a parse error for \"x\"");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_parallel_convert, CARGO_NOERR_OUTPUT | CARGO_PARALLEL_CONVERT)
+{
+    // Enough values to be split up, when threads are available.
+    #define TEST_VALUES 100000
+    int k;
+    char *buf = NULL;
+    char *end = NULL;
+    char **args = NULL;
+    int *vals = NULL;
+    size_t val_count = 0;
+    const char *err = NULL;
+
+    ret |= cargo_add_option(cargo, 0, "--vals", NULL, "[i]+", &vals, &val_count);
+    cargo_assert(ret == 0, "Failed to add option");
+
+    buf = malloc(TEST_VALUES * 8);
+    args = calloc(TEST_VALUES + 2, sizeof(char *));
+    cargo_assert(buf && args, "Out of memory");
+
+    args[0] = "program";
+    args[1] = "--vals";
+
+    for (k = 0, end = buf; k < TEST_VALUES; k++)
+    {
+        args[k + 2] = end;
+        end += sprintf(end, "%d", k) + 1;
+    }
+
+    ret = cargo_parse(cargo, 0, 1, TEST_VALUES + 2, args);
+    cargo_assert(ret == 0, "Expected parse to succeed");
+    cargo_assert(val_count == TEST_VALUES, "Expected all values");
+
+    for (k = 0; k < TEST_VALUES; k++)
+    {
+        cargo_assert(vals[k] == k, "Unexpected value");
+    }
+
+    _cargo_cleanup_option_values(cargo, 1);
+
+    // The error points at the first failing value,
+    // even if a later chunk also fails.
+    args[70000 + 2] = "bad1";
+    args[90000 + 2] = "bad2";
+    ret = cargo_parse(cargo, 0, 1, TEST_VALUES + 2, args);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected parse to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Cannot parse \"bad1\" as int"),
+                 "Expected the error to be for \"bad1\"");
+
+    _TEST_CLEANUP();
+    free(args);
+    free(buf);
+    #undef TEST_VALUES
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_delimited_list, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    size_t k;
+    int *ids = NULL;
+    size_t id_count = 0;
+    double *ds = NULL;
+    size_t d_count = 0;
+    unsigned int us[3];
+    size_t u_count = 0;
+    char **strs = NULL;
+    size_t str_count = 0;
+    const char *err = NULL;
+    const char *usage = NULL;
+    int ids_expect[] = { 1, 2, 3, 4, 5, 6 };
+    char *args1[] = { "program", "--ids", "1,2,3", "4", "5,6",
+                      "--ds", "0.5;1e3", "--us", "7,8,9" };
+    char *args2[] = { "program", "--us", "1,2,3,4" };
+    char *args3[] = { "program", "--ids", "1,x,3" };
+    char *args4[] = { "program", "--ids", "1,,3" };
+
+    ret |= cargo_add_option(cargo, 0, "--ids", NULL, "[i,]+", &ids, &id_count);
+    ret |= cargo_add_option(cargo, 0, "--ds", NULL, "[d;]*", &ds, &d_count);
+    ret |= cargo_add_option(cargo, 0, "--us", NULL, ".[u,]#", &us, &u_count, 3);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_add_option(cargo, 0, "--strs", NULL, "[s,]+", &strs, &str_count);
+    cargo_assert(ret != 0, "Expected a delimited string list to fail");
+
+    usage = cargo_get_usage(cargo, 0);
+    cargo_assert(usage && strstr(usage, "IDS[,IDS ...]"),
+                 "Expected the usage to show the delimiter");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Expected parse to succeed");
+    cargo_assert(id_count == 6, "Expected 6 ids");
+
+    for (k = 0; k < id_count; k++)
+    {
+        cargo_assert(ids[k] == ids_expect[k], "Unexpected id");
+    }
+
+    cargo_assert((d_count == 2) && (ds[0] == 0.5) && (ds[1] == 1000.0),
+                 "Expected --ds 0.5;1e3");
+    cargo_assert((u_count == 3) && (us[0] == 7) && (us[2] == 9),
+                 "Expected --us 7,8,9");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected too many values to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Too many values"), "Expected too many values");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected parse to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Cannot parse \"x\" as int"),
+                 "Expected the error to be for \"x\"");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args4) / sizeof(args4[0]), args4);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected an empty value to fail");
+
+    // The delimiters are counted 8 bytes at a time, check the edges.
+    for (k = 0; k < 40; k++)
+    {
+        char buf[41];
+        size_t m;
+        size_t expect = 0;
+
+        for (m = 0; m < k; m++)
+        {
+            buf[m] = ((m * 7 + k) % 3) ? ',' : '1';
+            expect += (buf[m] == ',');
+        }
+
+        buf[k] = '\0';
+        cargo_assert(_cargo_count_char(buf, k, ',') == expect,
+                     "Wrong number of delimiters");
+    }
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_range_list, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    size_t k;
+    unsigned int *cpus = NULL;
+    size_t cpu_count = 0;
+    int is[8];
+    size_t i_count = 0;
+    unsigned long long bits[CARGO_BITMAP_WORDS(200)];
+    const char *err = NULL;
+    const char *usage = NULL;
+    unsigned int cpus_expect[] = { 0, 1, 2, 3, 8, 10, 12, 14, 20 };
+    int is_expect[] = { -3, -2, -1, 0, 1, -10, -5 };
+    char *args1[] = { "program", "--cpus", "0-3,8-15:2", "20",
+                      "--is", "-3-1,-10--5:5", "--bits", "1,60-130,140" };
+    char *args2[] = { "program", "--is", "0-8" };
+    char *args3[] = { "program", "--cpus", "0-3,5-x" };
+    char *args4[] = { "program", "--bits", "0-200" };
+    char *args5[] = { "program", "--cpus", "5-3" };
+    char *args6[] = { "program", "--cpus", "0-3:0" };
+    char *args7[] = { "program", "--bits", "0-199:50" };
+    char *args9[] = { "program", "--bits", "0-199:70" };
+    char *args8[] = { "program", "--cpus", "0-18446744073709551615" };
+    char *args10[] = { "program", "--cpus", "0-4294967295" };
+    char range_max[64];
+    char *args11[] = { "program", "--cpus", NULL };
+
+    ret |= cargo_add_option(cargo, 0, "--cpus", NULL, "[u-]+", &cpus, &cpu_count);
+    ret |= cargo_add_option(cargo, 0, "--is", NULL, ".[i-]+", &is, &i_count, 8);
+    ret |= cargo_add_option(cargo, 0, "--bits", NULL, "m#", bits, 200);
+    ret |= cargo_add_validation(cargo, 0, "--bits", cargo_validate_uint_range(0, 140));
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_add_option(cargo, 0, "--ds", NULL, "[d-]+", NULL, NULL);
+    cargo_assert(ret != 0, "Expected a double range list to fail");
+
+    ret = cargo_add_option(cargo, 0, "--nobits", NULL, "m#", bits, -1);
+    cargo_assert(ret != 0, "Expected a negative bit count to fail");
+    ret = cargo_add_option(cargo, 0, "--nobits", NULL, "m#", bits, 0);
+    cargo_assert(ret != 0, "Expected a zero bit count to fail");
+
+    usage = cargo_get_usage(cargo, 0);
+    cargo_assert(usage && strstr(usage, "CPUS[-CPUS][,...]"),
+                 "Expected the usage to show the range syntax");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Expected parse to succeed");
+    cargo_assert(cpu_count == 9, "Expected 9 cpus");
+
+    for (k = 0; k < cpu_count; k++)
+    {
+        cargo_assert(cpus[k] == cpus_expect[k], "Unexpected cpu");
+    }
+
+    cargo_assert(i_count == 7, "Expected 7 ints");
+
+    for (k = 0; k < i_count; k++)
+    {
+        cargo_assert(is[k] == is_expect[k], "Unexpected int");
+    }
+
+    for (k = 0; k < 200; k++)
+    {
+        int expect = (k == 1) || ((k >= 60) && (k <= 130)) || (k == 140);
+        cargo_assert((int)CARGO_BITMAP_TEST(bits, k) == expect, "Unexpected bit");
+    }
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected too many values to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Too many values"), "Expected too many values");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected parse to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Cannot parse \"5-x\" as a range"),
+                 "Expected the error to be for \"5-x\"");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args4) / sizeof(args4[0]), args4);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected a bit out of range to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Bit 200 is out of range"),
+                 "Expected bit out of range");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args5) / sizeof(args5[0]), args5);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected a reversed range to fail");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args6) / sizeof(args6[0]), args6);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected a zero step to fail");
+
+    // The last value 150 is above the validated range.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args7) / sizeof(args7[0]), args7);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected validation to fail");
+
+    // But here the last value is 140.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args9) / sizeof(args9[0]), args9);
+    cargo_assert(ret == 0, "Expected 0-199:70 to pass validation");
+    cargo_assert(CARGO_BITMAP_TEST(bits, 70) && CARGO_BITMAP_TEST(bits, 140)
+                 && !CARGO_BITMAP_TEST(bits, 1), "Expected bits 0, 70 and 140");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args8) / sizeof(args8[0]), args8);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected a huge range to fail");
+
+    // An unbounded array is still limited to CARGO_MAX_RANGE_VALUES.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args10) / sizeof(args10[0]), args10);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected a too large range to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Too many values"), "Expected too many values");
+
+    sprintf(range_max, "1-%d", CARGO_MAX_RANGE_VALUES);
+    args11[2] = range_max;
+    ret = cargo_parse(cargo, 0, 1, sizeof(args11) / sizeof(args11[0]), args11);
+    cargo_assert(ret == 0, "Expected CARGO_MAX_RANGE_VALUES values to parse");
+    cargo_assert((cpu_count == CARGO_MAX_RANGE_VALUES)
+                 && (cpus[cpu_count - 1] == CARGO_MAX_RANGE_VALUES),
+                 "Expected CARGO_MAX_RANGE_VALUES cpus");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+_TEST_START(TEST_borrowed_strings)
+{
+    int i;
+    int calls;
+    _test_allocator_t ta;
+    cargo_allocator_t alloc;
+    cargo_t c = NULL;
+    char *name = NULL;
+    char **files = NULL;
+    size_t file_count = 0;
+    char *pair[2] = { NULL, NULL };
+    size_t pair_count = 0;
+    char *copy = NULL;
+    char *args[1004];
+    char bufs[1000][8];
+    char *short_args[] = { "program", "--name", "alpha", "--copy", "beta" };
+    memset(&ta, 0, sizeof(ta));
+
+    alloc.malloc_fn = _test_allocator_malloc;
+    alloc.realloc_fn = _test_allocator_realloc;
+    alloc.free_fn = _test_allocator_free;
+    alloc.user = &ta;
+
+    args[0] = "program";
+    args[1] = "--pair";
+    args[2] = "a";
+    args[3] = "b";
+
+    for (i = 0; i < 1000; i++)
+    {
+        sprintf(bufs[i], "f%d", i);
+        args[4 + i] = bufs[i];
+    }
+
+    ret = cargo_init_with_allocator(&c, &alloc,
+                                    CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT,
+                                    "program");
+    cargo_assert(ret == 0, "Failed to init with allocator");
+    ret |= cargo_add_option(c, CARGO_OPT_BORROW_STRING, "--name", NULL, "s", &name);
+    ret |= cargo_add_option(c, CARGO_OPT_BORROW_STRING, "files", NULL, "[s]*",
+                            &files, &file_count);
+    ret |= cargo_add_option(c, CARGO_OPT_BORROW_STRING, "--pair", NULL, ".[s]#",
+                            &pair, &pair_count, 2);
+    ret |= cargo_add_option(c, 0, "--copy", NULL, "s", &copy);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    calls = ta.calls;
+    ret = cargo_parse(c, 0, 1, sizeof(args) / sizeof(args[0]), args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(file_count == 1000, "Expected 1000 files");
+    cargo_assert((pair_count == 2) && (pair[0] == args[2]) && (pair[1] == args[3]),
+                 "Expected the pair to point into argv");
+
+    for (i = 0; i < 1000; i++)
+    {
+        cargo_assert(files[i] == args[4 + i], "Expected files to point into argv");
+    }
+
+    // Only a few allocations, such as the array itself.
+    cargo_assert((ta.calls - calls) < 10, "Expected no string allocations");
+
+    ret = cargo_parse(c, 0, 1, sizeof(short_args) / sizeof(short_args[0]), short_args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(name == short_args[2], "Expected name to point into argv");
+    cargo_assert(copy && (copy != short_args[4]) && !strcmp(copy, "beta"),
+                 "Expected --copy to be copied");
+
+    // A streamed parse frees its arguments, so those are copied.
+    ret |= cargo_parse_begin(c, 0);
+    ret |= cargo_parse_push(c, "--name");
+    ret |= cargo_parse_push(c, "gamma");
+    ret |= cargo_parse_end(c);
+    cargo_assert(ret == 0, "Failed to stream parse");
+    cargo_assert(name && !strcmp(name, "gamma"), "Expected name gamma");
+
+    // A batch reuses and then frees its line buffer, so those are too.
+    ret = cargo_parse_batch(c, 0, "--name aaa\n--name bbb\n", 22, NULL, NULL);
+    cargo_assert(ret == 2, "Expected 2 lines to be parsed");
+    cargo_assert(name && !strcmp(name, "bbb"), "Expected name bbb");
+
+    ret = cargo_parse(c, 0, 1, sizeof(short_args) / sizeof(short_args[0]), short_args);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(name == short_args[2], "Expected name to point into argv");
+
+    cargo_destroy(&c);
+    cargo_assert(ta.live == 0, "Expected everything to be freed");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&c);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_bool_bit_target, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    int i;
+    char name[32];
+    unsigned long long bits[CARGO_BITMAP_WORDS(140)];
+    char *args1[] = { "program", "--enable-5", "-abc", "--enable-100",
+                      "--enable-139", "-v", "-v", "-o" };
+    char *args2[] = { "program", "--off-100", "-ox" };
+    memset(bits, 0, sizeof(bits));
+
+    // Bits 3 and 4 are used by "-v" and "-o" below.
+    for (i = 0; i < 140; i++)
+    {
+        if ((i == 3) || (i == 4))
+            continue;
+
+        if (i < 3)
+            sprintf(name, "--enable-%d -%c", i, 'a' + i);
+        else
+            sprintf(name, "--enable-%d", i);
+
+        ret |= cargo_add_option(cargo, 0, name, NULL, "B", bits, i);
+    }
+
+    ret |= cargo_add_option(cargo, 0, "-v", NULL, "B!", bits, 3);
+    ret |= cargo_add_option(cargo, 0, "--off-100", NULL, "B=", bits, 100, 0);
+    ret |= cargo_add_option(cargo, 0, "-o", NULL, "B|", bits, 4, 2, 0, 1);
+    ret |= cargo_add_option(cargo, 0, "-x", NULL, "B&", bits, 5, 1, 1);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_add_option(cargo, 0, "--bad", NULL, "[B]+", bits, 1);
+    cargo_assert(ret != 0, "Expected a bit array to fail");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Failed to parse");
+
+    for (i = 0; i < 140; i++)
+    {
+        int expect = (i <= 3) || (i == 5) || (i == 100) || (i == 139);
+        cargo_assert((int)CARGO_BITMAP_TEST(bits, i) == expect, "Unexpected bit");
+    }
+
+    // The second "-o" ORs 1 into the bit, "-x" ANDs 1 with bit 5.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(!CARGO_BITMAP_TEST(bits, 100), "Expected bit 100 to be cleared");
+    cargo_assert(CARGO_BITMAP_TEST(bits, 4), "Expected bit 4 to be set");
+    cargo_assert(CARGO_BITMAP_TEST(bits, 5), "Expected bit 5 to stay set");
+    cargo_assert(CARGO_BITMAP_TEST(bits, 139), "Expected bit 139 to stay set");
+
+    _TEST_CLEANUP();
+}
+_TEST_END()
+
+static int _test_parse_rect(cargo_t ctx, void *user, const char *optname,
+                            const char *value, void *target)
+{
+    _test_rect_t *r = (_test_rect_t *)target;
+    int *calls = (int *)user;
+    (void)ctx;
+    (void)optname;
+    (*calls)++;
+
+    if (sscanf(value, "%dx%d", &r->w, &r->h) != 2)
+        return -1;
+
+    return 0;
+}
+
+static int _test_validate_square(cargo_t ctx, cargo_validation_flags_t flags,
+                                 const char *opt, cargo_validation_t *vd,
+                                 void *value)
+{
+    _test_rect_t *r = (_test_rect_t *)value;
+    (void)ctx;
+    (void)flags;
+    (void)opt;
+    (void)vd;
+    return (r->w == r->h) ? 0 : -1;
+}
+
+_TEST_START_EX(TEST_extension_type, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    int calls = 0;
+    _test_rect_t rect;
+    _test_rect_t *rects = NULL;
+    size_t rect_count = 0;
+    _test_rect_t squares[3];
+    size_t square_count = 0;
+    const char *err = NULL;
+    char *args1[] = { "program", "--rect", "1x2", "--rects", "3x4", "5x6", "7x8",
+                      "--squares", "2x2", "3x3" };
+    char *args2[] = { "program", "--rect", "1y2" };
+    char *args3[] = { "program", "--squares", "2x3" };
+    memset(&rect, 0, sizeof(rect));
+
+    ret = cargo_add_type(cargo, 'i', "int2", sizeof(int), _test_parse_rect, &calls);
+    cargo_assert(ret != 0, "Expected a built in type to fail");
+    ret = cargo_add_type(cargo, '[', "rect", sizeof(_test_rect_t), _test_parse_rect, &calls);
+    cargo_assert(ret != 0, "Expected a format character to fail");
+
+    ret = cargo_add_type(cargo, 'r', "rect", sizeof(_test_rect_t), _test_parse_rect, &calls);
+    cargo_assert(ret == 0, "Failed to add type");
+    ret = cargo_add_type(cargo, 'r', "rect", sizeof(_test_rect_t), _test_parse_rect, &calls);
+    cargo_assert(ret != 0, "Expected adding a type twice to fail");
+
+    ret = 0;
+    ret |= cargo_add_option(cargo, 0, "--rect", NULL, "r", &rect);
+    ret |= cargo_add_option(cargo, 0, "--rects", NULL, "[r]+", &rects, &rect_count);
+    ret |= cargo_add_option(cargo, 0, "--squares", NULL, ".[r]+", &squares, &square_count, 3);
+    ret |= cargo_add_validation(cargo, 0, "--squares",
+                cargo_create_validator("square", _test_validate_square,
+                                       NULL, CARGO_EXTENSION, NULL));
+    cargo_assert(ret == 0, "Failed to add options");
+    cargo_assert(cargo_get_option_type(cargo, "--rect") == CARGO_EXTENSION,
+                 "Expected an extension type");
+
+    ret = cargo_add_option(cargo, 0, "--bad", NULL, "[r,]+", &rects, &rect_count);
+    cargo_assert(ret != 0, "Expected a delimited extension type to fail");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(calls == 6, "Expected the parse function to be called 6 times");
+    cargo_assert((rect.w == 1) && (rect.h == 2), "Expected --rect 1x2");
+    cargo_assert((rect_count == 3) && (rects[0].w == 3)
+                 && (rects[2].h == 8), "Expected --rects 3x4 5x6 7x8");
+    cargo_assert((square_count == 2) && (squares[1].w == 3),
+                 "Expected --squares 2x2 3x3");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected parse to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Cannot parse \"1y2\" as rect"),
+                 "Expected the error to name the type");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected validation to fail");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_choices_index, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    size_t k;
+    int m;
+    char names[2000][16];
+    const char *choices[2000];
+    long long nums[2000];
+    int *rev = NULL;
+    char **regions = NULL;
+    size_t region_count = 0;
+    char *region = NULL;
+    long long *skus = NULL;
+    size_t sku_count = 0;
+    const char *err = NULL;
+    cargo_choices_validation_t *vc = NULL;
+    cargo_validation_t *v = NULL;
+    char *args1[] = { "program", "--regions", "REGION-1999", "region-0", "Region-1000",
+                      "--skus", "-7", "13986", "0" };
+    char *args2[] = { "program", "--region", "region-2000" };
+    char *args3[] = { "program", "--skus", "1" };
+
+    for (k = 0; k < 2000; k++)
+    {
+        sprintf(names[k], "region-%lu", (unsigned long)k);
+        choices[k] = names[k];
+        // Unsorted, with negative values.
+        nums[k] = (long long)((k * 7919) % 2000) * 7 - 7;
+    }
+
+    ret |= cargo_add_option(cargo, 0, "--regions", NULL, "[s]+", &regions, &region_count);
+    ret |= cargo_add_option(cargo, 0, "--region", NULL, "s", &region);
+    ret |= cargo_add_option(cargo, 0, "--skus", NULL, "[L]+", &skus, &sku_count);
+    v = cargo_validate_choices_array(0, CARGO_STRING, 2000, choices);
+    ret |= cargo_add_validation(cargo, 0, "--regions", v);
+    ret |= cargo_add_validation(cargo, 0, "--region", v);
+    ret |= cargo_add_validation(cargo, 0, "--skus",
+                cargo_validate_choices_array(0, CARGO_LONGLONG, 2000, nums));
+    cargo_assert(ret == 0, "Failed to add options");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected an unknown region to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "region-0, region-1, region-2"),
+                 "Expected the choices in the error");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected an unknown sku to fail");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Expected all choices to be valid");
+    cargo_assert((region_count == 3) && (sku_count == 3), "Expected all values");
+
+    // The first of any duplicates is found.
+    v = cargo_validate_choices(CARGO_VALIDATE_CHOICES_CASE_SENSITIVE,
+                               CARGO_STRING, 4, "b", "a", "B", "a");
+    cargo_assert(v != NULL, "Failed to create choices");
+    vc = (cargo_choices_validation_t *)cargo_validator_get_context(v);
+    cargo_assert(_cargo_find_choice(vc, "a") == 1, "Expected \"a\" at 1");
+    cargo_assert(_cargo_find_choice(vc, "B") == 2, "Expected \"B\" at 2");
+    cargo_assert(_cargo_find_choice(vc, "A") == -1, "Expected no \"A\"");
+    v->ref_count++;
+    _cargo_free_validation(&v);
+
+    v = cargo_validate_choices(0, CARGO_INT, 5, 5, -1, 3, -1, 9);
+    cargo_assert(v != NULL, "Failed to create choices");
+    vc = (cargo_choices_validation_t *)cargo_validator_get_context(v);
+    m = 3;
+    cargo_assert(_cargo_find_choice(vc, &m) == 2, "Expected 3 at 2");
+    m = -1;
+    cargo_assert(_cargo_find_choice(vc, &m) == 1, "Expected -1 at 1");
+    m = 4;
+    cargo_assert(_cargo_find_choice(vc, &m) == -1, "Expected no 4");
+    v->ref_count++;
+    _cargo_free_validation(&v);
+
+    // A large list in reverse order, each value twice.
+    rev = malloc(50000 * sizeof(int));
+    cargo_assert(rev != NULL, "Out of memory");
+
+    for (k = 0; k < 50000; k++)
+    {
+        rev[k] = (int)((50000 - k) / 2);
+    }
+
+    v = cargo_validate_choices_array(0, CARGO_INT, 50000, rev);
+    cargo_assert(v != NULL, "Failed to create choices");
+    vc = (cargo_choices_validation_t *)cargo_validator_get_context(v);
+
+    for (k = 0; k <= 25000; k++)
+    {
+        m = (int)(25000 - k);
+        cargo_assert(_cargo_find_choice(vc, &m) == (int)(k ? (2 * k - 1) : 0),
+                     "Expected the first of the duplicates");
+    }
+
+    m = 25001;
+    cargo_assert(_cargo_find_choice(vc, &m) == -1, "Expected no 25001");
+    v->ref_count++;
+    _cargo_free_validation(&v);
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+    _cargo_xfree(NULL, &region);
+    free(rev);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_choices_map, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    enum { MODE_FAST = 10, MODE_SAFE = 20, MODE_DEBUG = 30 };
+    const char *names[] = { "fast", "safe", "debug" };
+    const int values[] = { MODE_FAST, MODE_SAFE, MODE_DEBUG };
+    int mode = 0;
+    int *modes = NULL;
+    size_t mode_count = 0;
+    int fixed[2];
+    size_t fixed_count = 0;
+    int *ids = NULL;
+    size_t id_count = 0;
+    char *name = NULL;
+    int level = 0;
+    const char *err = NULL;
+    cargo_validation_t *v = NULL;
+    cargo_validation_t *w = NULL;
+    char *args1[] = { "program", "--modes", "debug", "fast" };
+    char *args2[] = { "program", "--mode", "turbo" };
+    char *args3[] = { "program", "--mode", "SAFE", "--fixed", "safe", "fast",
+                      "--modes", "fast", "safe", "debug", "fast" };
+    char *args4[] = { "program", "--level", "debug" };
+
+    v = cargo_validate_choices_map(0, 3, names, values);
+    cargo_assert(v != NULL, "Failed to create choices map");
+
+    ret |= cargo_add_option(cargo, 0, "--mode", NULL, "i", &mode);
+    ret |= cargo_add_option(cargo, 0, "--modes", NULL, "[i]+", &modes, &mode_count);
+    ret |= cargo_add_option(cargo, 0, "--fixed", NULL, ".[i]#", fixed, &fixed_count, 2);
+    ret |= cargo_add_option(cargo, 0, "--ids", NULL, "[i,]+", &ids, &id_count);
+    ret |= cargo_add_validation(cargo, 0, "--mode", v);
+    ret |= cargo_add_validation(cargo, 0, "--modes", v);
+    ret |= cargo_add_validation(cargo, 0, "--fixed", v);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // A map only gives ints, and whole arguments.
+    ret = cargo_add_validation(cargo, 0, "--ids",
+                cargo_validate_choices_map(0, 3, names, values));
+    cargo_assert(ret != 0, "Expected a delimited list to be rejected");
+    ret = cargo_add_option(cargo, 0, "--name", NULL, "s", &name);
+    cargo_assert(ret == 0, "Failed to add --name");
+    ret = cargo_add_validation(cargo, 0, "--name",
+                cargo_validate_choices_map(0, 3, names, values));
+    cargo_assert(ret != 0, "Expected a string option to be rejected");
+
+    // A rejected option must not take the validation from --level.
+    w = cargo_validate_choices_map(0, 3, names, values);
+    cargo_assert(w != NULL, "Failed to create choices map");
+    ret = cargo_add_option(cargo, 0, "--level", NULL, "i", &level);
+    ret |= cargo_add_validation(cargo, 0, "--level", w);
+    cargo_assert(ret == 0, "Failed to add --level");
+    ret = cargo_add_validation(cargo, 0, "--ids", w);
+    cargo_assert(ret != 0, "Expected a delimited list to be rejected");
+    ret = cargo_parse(cargo, 0, 1, sizeof(args4) / sizeof(args4[0]), args4);
+    cargo_assert(ret == 0, "Failed to parse --level");
+    cargo_assert(level == MODE_DEBUG, "Expected a mapped level");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected an unknown name to fail");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "fast, safe, debug"),
+                 "Expected the choices in the error");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(mode_count == 2, "Expected 2 modes");
+    cargo_assert((modes[0] == MODE_DEBUG) && (modes[1] == MODE_FAST),
+                 "Expected mapped modes");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(mode == MODE_SAFE, "Expected case insensitive mode");
+    cargo_assert((fixed_count == 2) && (fixed[0] == MODE_SAFE)
+                 && (fixed[1] == MODE_FAST), "Expected mapped fixed array");
+    cargo_assert((mode_count == 4) && (modes[3] == MODE_FAST),
+                 "Expected mapped modes");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_range_validation_list, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    int *ints = NULL;
+    size_t int_count = 0;
+    double *ds = NULL;
+    size_t d_count = 0;
+    unsigned int us[4];
+    size_t u_count = 0;
+    const char *err = NULL;
+    char *args1[] = { "program", "--ints", "0", "5", "100", "--ds", "0.5,1.0,1.5",
+                      "--us", "7", "8" };
+    char *args2[] = { "program", "--ints", "1", "2", "101", "3" };
+    char *args3[] = { "program", "--ds", "0.5,1.6" };
+    char *args4[] = { "program", "--us", "7", "9" };
+
+    ret |= cargo_add_option(cargo, 0, "--ints", NULL, "[i]+", &ints, &int_count);
+    ret |= cargo_add_option(cargo, 0, "--ds", NULL, "[d,]+", &ds, &d_count);
+    ret |= cargo_add_option(cargo, 0, "--us", NULL, ".[u]+", us, &u_count, 4);
+    ret |= cargo_add_validation(cargo, 0, "--ints", cargo_validate_int_range(0, 100));
+    ret |= cargo_add_validation(cargo, 0, "--ds",
+                cargo_validate_double_range(0.5, 1.5, CARGO_DEFAULT_EPSILON));
+    ret |= cargo_add_validation(cargo, 0, "--us", cargo_validate_uint_range(7, 9));
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // Replacing a range validation drops the inline check.
+    ret = cargo_add_validation(cargo, 0, "--us",
+                cargo_validate_choices(0, CARGO_UINT, 2, 7, 8));
+    cargo_assert(ret == 0, "Failed to replace validation");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected 101 to be out of range");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "but got 101"), "Expected 101 in the error");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected 1.6 to be out of range");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args4) / sizeof(args4[0]), args4);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected 9 to not be a choice");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Expected all values to be in range");
+    cargo_assert((int_count == 3) && (ints[2] == 100), "Expected 3 ints");
+    cargo_assert((d_count == 3) && (u_count == 2), "Expected all values");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_error_records, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT | CARGO_NOWARN)
+{
+    int a = 0;
+    int b = 0;
+    size_t count = 0;
+    const char *err = NULL;
+    const cargo_error_record_t *r = NULL;
+    char *args1[] = { "program", "--alpha", "1", "-a", "2", "--alpha", "3" };
+    char *args2[] = { "program", "--beta", "1", "--alpha", "2", "--beta", "3" };
+    char *args3[] = { "program", "--beta", "1", "-a", "x" };
+    char *args4[] = { "program", "--alpha", "1", "--beta", "50" };
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", NULL, "i", &a);
+    ret |= cargo_add_option(cargo, CARGO_OPT_UNIQUE, "--beta", NULL, "i", &b);
+    ret |= cargo_add_validation(cargo, 0, "--beta", cargo_validate_int_range(0, 10));
+    cargo_assert(ret == 0, "Failed to add options");
+
+    // Only recorded, the warnings are not shown.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args1) / sizeof(args1[0]), args1);
+    cargo_assert(ret == 0, "Failed to parse");
+    cargo_assert(a == 3, "Expected the last --alpha");
+    r = cargo_get_error_records(cargo, &count);
+    cargo_assert(count == 2, "Expected 2 warnings");
+    cargo_assert((r[0].code == CARGO_ERROR_ALREADY_PARSED) && r[0].warning,
+                 "Expected an already parsed warning");
+    cargo_assert((r[0].argi == 3) && (r[0].prev_argi == 1)
+              && !strcmp(r[0].name, "-a"), "Expected -a at 3");
+    cargo_assert((r[1].argi == 5) && (r[1].prev_argi == 3), "Expected 5");
+    cargo_assert(!strcmp(cargo->options[r[1].opt_i].name[0], "--alpha"),
+                 "Expected --alpha");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Warning: --alpha was already specified"),
+                 "Expected the last warning as the error");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args2) / sizeof(args2[0]), args2);
+    cargo_assert(ret != 0, "Expected --beta to be unique");
+    r = cargo_get_error_records(cargo, &count);
+    cargo_assert(count == 1, "Expected the warnings of the last parse to be gone");
+    cargo_assert((r[0].code == CARGO_ERROR_NOT_UNIQUE) && !r[0].warning
+              && (r[0].argi == 5) && (r[0].prev_argi == 1),
+                 "Expected a unique error");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Error: --beta was already specified"),
+                 "Expected the unique error");
+    cargo_assert(cargo_get_error(cargo) == err, "Expected the same message");
+
+    // Value and validation errors have the option and the argument.
+    ret = cargo_parse(cargo, 0, 1, sizeof(args3) / sizeof(args3[0]), args3);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected x to fail as an int");
+    r = cargo_get_error_records(cargo, &count);
+    cargo_assert((count == 1) && (r[0].code == CARGO_ERROR_VALUE) && !r[0].warning,
+                 "Expected a value error");
+    cargo_assert((r[0].argi == 4) && (r[0].prev_argi == -1)
+              && r[0].name && !strcmp(r[0].name, "-a")
+              && !strcmp(cargo->options[r[0].opt_i].name[0], "--alpha"),
+                 "Expected -a with x at 4");
+    err = cargo_get_error(cargo);
+    cargo_assert(err && strstr(err, "Cannot parse \"x\""), "Expected the message");
+
+    ret = cargo_parse(cargo, 0, 1, sizeof(args4) / sizeof(args4[0]), args4);
+    cargo_assert(ret == CARGO_PARSE_FAIL_OPT, "Expected 50 to fail validation");
+    r = cargo_get_error_records(cargo, &count);
+    cargo_assert((count == 1) && (r[0].code == CARGO_ERROR_VALUE)
+              && (r[0].argi == 4) && !strcmp(r[0].name, "--beta"),
+                 "Expected --beta with 50 at 4");
+
+    // A message replaces the error record.
+    cargo_set_error(cargo, 0, "Custom");
+    r = cargo_get_error_records(cargo, &count);
+    cargo_assert((count == 1) && (r[0].code == CARGO_ERROR_MESSAGE),
+                 "Expected a message record");
+    cargo_assert(!strcmp(cargo_get_error(cargo), "Custom"), "Expected Custom");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+_TEST_START_EX(TEST_suggestions_bounded, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT)
+{
+    int a = 0;
+    int b = 0;
+    int c = 0;
+    const char *s = NULL;
+
+    ret |= cargo_add_option(cargo, 0, "--alpha -a", NULL, "i", &a);
+    ret |= cargo_add_option(cargo, 0, "--alphas", NULL, "i", &b);
+    ret |= cargo_add_option(cargo, 0, "--gamma", NULL, "i", &c);
+    cargo_assert(ret == 0, "Failed to add options");
+
+    s = _cargo_find_closest_opt(cargo, "--gamna");
+    cargo_assert(s && !strcmp(s, "--gamma"), "Expected substitution");
+    s = _cargo_find_closest_opt(cargo, "--gmama");
+    cargo_assert(s && !strcmp(s, "--gamma"), "Expected swap");
+    s = _cargo_find_closest_opt(cargo, "--gammma");
+    cargo_assert(s && !strcmp(s, "--gamma"), "Expected insertion");
+    s = _cargo_find_closest_opt(cargo, "--gama");
+    cargo_assert(s && !strcmp(s, "--gamma"), "Expected deletion");
+    s = _cargo_find_closest_opt(cargo, "--alphas");
+    cargo_assert(s && !strcmp(s, "--alphas"), "Expected the exact match");
+    s = _cargo_find_closest_opt(cargo, "--gmaam");
+    cargo_assert(s == NULL, "Expected no suggestion two edits away");
+
+    _TEST_CLEANUP();
+    cargo_destroy(&cargo);
+}
+_TEST_END()
+
+// TODO: Test default values for string lists
+// TODO: Test giving add_option an invalid alias
+// TODO: Test --help
+// TODO: Test CARGO_UNIQUE_OPTS
+// TODO: Test CARGO_NOWARN
+// TODO: Test cargo_parse_result_t
+// TODO: Add test to make sure bool array is not allowed.
+
+//
+// List of all test functions to run:
+//
+typedef const char *(* cargo_test_f)();
+
+typedef struct cargo_test_s
+{
+    const char *name;
+    cargo_test_f f;
+    int success;
+    int ran;
+    const char *error;
+} cargo_test_t;
+
+#define CARGO_ADD_TEST(test) { #test, test, 0, 0, NULL }
+
+cargo_test_t tests[] =
+{
+    CARGO_ADD_TEST(TEST_no_args_bool_option),
+    CARGO_ADD_TEST(TEST_add_integer_option),
+    CARGO_ADD_TEST(TEST_add_uinteger_option),
+    CARGO_ADD_TEST(TEST_add_float_option),
+    CARGO_ADD_TEST(TEST_add_bool_option),
+    CARGO_ADD_TEST(TEST_add_double_option),
+    CARGO_ADD_TEST(TEST_add_static_string_option),
+    CARGO_ADD_TEST(TEST_add_alloc_string_option),
+    CARGO_ADD_TEST(TEST_add_static_int_array_option),
+    CARGO_ADD_TEST(TEST_add_static_uint_array_option),
+    CARGO_ADD_TEST(TEST_add_static_long_long_int_array_option),
+    CARGO_ADD_TEST(TEST_add_static_unsigned_long_long_int_array_option),
+    CARGO_ADD_TEST(TEST_add_static_float_array_option),
+    CARGO_ADD_TEST(TEST_add_static_double_array_option),
+    CARGO_ADD_TEST(TEST_add_static_string_array_option),
+    CARGO_ADD_TEST(TEST_add_alloc_fixed_int_array_option),
+    CARGO_ADD_TEST(TEST_add_alloc_fixed_uint_array_option),
+    CARGO_ADD_TEST(TEST_add_alloc_fixed_float_array_option),
+    CARGO_ADD_TEST(TEST_add_alloc_fixed_double_array_option),
+    CARGO_ADD_TEST(TEST_add_alloc_fixed_string_array_option),
+    CARGO_ADD_TEST(TEST_add_alloc_fixed_string_array_option2),
+    CARGO_ADD_TEST(TEST_add_alloc_fixed_string_array_option3),
+    CARGO_ADD_TEST(TEST_add_alloc_fixed_string_array_option4),
+    CARGO_ADD_TEST(TEST_add_alloc_dynamic_int_array_option),
+    CARGO_ADD_TEST(TEST_add_alloc_dynamic_int_array_option_noargs),
+    CARGO_ADD_TEST(TEST_print_usage),
+    CARGO_ADD_TEST(TEST_get_usage_settings),
+    CARGO_ADD_TEST(TEST_autohelp_default),
+    CARGO_ADD_TEST(TEST_autohelp_off),
+    CARGO_ADD_TEST(TEST_get_usage),
+    CARGO_ADD_TEST(TEST_misspelled_argument),
+    CARGO_ADD_TEST(TEST_add_duplicate_option),
+    CARGO_ADD_TEST(TEST_get_extra_args),
+    CARGO_ADD_TEST(TEST_get_unknown_opts),
+    CARGO_ADD_TEST(TEST_cargo_split),
+    CARGO_ADD_TEST(TEST_parse_invalid_value),
+    CARGO_ADD_TEST(TEST_parse_twice),
+    CARGO_ADD_TEST(TEST_parse_missing_value),
+    CARGO_ADD_TEST(TEST_parse_missing_array_value),
+    CARGO_ADD_TEST(TEST_parse_missing_array_value_ensure_free),
+    CARGO_ADD_TEST(TEST_parse_same_option_twice),
+    CARGO_ADD_TEST(TEST_parse_same_option_twice_string),
+    CARGO_ADD_TEST(TEST_parse_same_option_twice_with_unique),
+    CARGO_ADD_TEST(TEST_parse_same_option_twice_string_with_unique),
+    CARGO_ADD_TEST(TEST_highlight_args),
+    CARGO_ADD_TEST(TEST_positional_argument),
+    CARGO_ADD_TEST(TEST_positional_array_argument),
+    CARGO_ADD_TEST(TEST_multiple_positional_array_argument),
+    CARGO_ADD_TEST(TEST_multiple_positional_array_argument2),
+    CARGO_ADD_TEST(TEST_multiple_positional_array_argument3),
+    CARGO_ADD_TEST(TEST_autoclean_flag),
+    CARGO_ADD_TEST(TEST_autoclean_flag_off),
+    CARGO_ADD_TEST(TEST_parse_zero_or_more_with_args),
+    CARGO_ADD_TEST(TEST_parse_zero_or_more_without_args),
+    CARGO_ADD_TEST(TEST_parse_zero_or_more_with_positional),
+    CARGO_ADD_TEST(TEST_required_option_missing),
+    CARGO_ADD_TEST(TEST_required_option),
+    CARGO_ADD_TEST(TEST_custom_callback),
+    CARGO_ADD_TEST(TEST_custom_callback_fixed_array),
+    CARGO_ADD_TEST(TEST_custom_callback_fixed_array_no_count),
+    CARGO_ADD_TEST(TEST_many_options_custom),
+    CARGO_ADD_TEST(TEST_custom_callback_array),
+    CARGO_ADD_TEST(TEST_zero_or_more_with_arg),
+    CARGO_ADD_TEST(TEST_zero_or_more_without_arg),
+    CARGO_ADD_TEST(TEST_group),
+    CARGO_ADD_TEST(TEST_many_groups),
+    CARGO_ADD_TEST(TEST_mutex_group_guard),
+    CARGO_ADD_TEST(TEST_mutex_group_require_one),
+    CARGO_ADD_TEST(TEST_cargo_split_commandline),
+    CARGO_ADD_TEST(TEST_missing_last_arg),
+    CARGO_ADD_TEST(TEST_cargo_set_max_width),
+    CARGO_ADD_TEST(TEST_cargo_snprintf),
+    CARGO_ADD_TEST(TEST_cargo_set_prefix),
+    CARGO_ADD_TEST(TEST_cargo_aapendf),
+    CARGO_ADD_TEST(TEST_cargo_get_fprint_args),
+    CARGO_ADD_TEST(TEST_cargo_get_fprint_args_long),
+    CARGO_ADD_TEST(TEST_cargo_fprintf),
+    CARGO_ADD_TEST(TEST_cargo_bool_count),
+    CARGO_ADD_TEST(TEST_cargo_bool_count_compact),
+    CARGO_ADD_TEST(TEST_fixed_one_or_more_array),
+    CARGO_ADD_TEST(TEST_fixed_zero_or_more_array),
+    CARGO_ADD_TEST(TEST_fixed_fail_array),
+    CARGO_ADD_TEST(TEST_user_context),
+    CARGO_ADD_TEST(TEST_group_user_context),
+    CARGO_ADD_TEST(TEST_mutex_group_context_fail),
+    CARGO_ADD_TEST(TEST_cargo_get_option_mutex_groups),
+    CARGO_ADD_TEST(TEST_invalid_format_char),
+    CARGO_ADD_TEST(TEST_option_target_null),
+    CARGO_ADD_TEST(TEST_autoclean_string_list),
+    CARGO_ADD_TEST(TEST_fail_custom_callback),
+    CARGO_ADD_TEST(TEST_mutex_group_usage),
+    CARGO_ADD_TEST(TEST_mutex_group_usage2),
+    CARGO_ADD_TEST(TEST_mutex_group_usage3),
+    CARGO_ADD_TEST(TEST_mutex_group_usage_set_metavar),
+    CARGO_ADD_TEST(TEST_dummy_callback),
+    CARGO_ADD_TEST(TEST_group_add_missing_group),
+    CARGO_ADD_TEST(TEST_bool_acc_or),
+    CARGO_ADD_TEST(TEST_bool_acc_and),
+    CARGO_ADD_TEST(TEST_bool_acc_plus),
+    CARGO_ADD_TEST(TEST_bool_acc_store),
+    CARGO_ADD_TEST(TEST_mutex_order_group_before),
+    CARGO_ADD_TEST(TEST_mutex_order_group_after),
+    CARGO_ADD_TEST(TEST_medium_length_usage),
+    CARGO_ADD_TEST(TEST_cargo_get_unknown_copy),
+    CARGO_ADD_TEST(TEST_cargo_get_args_copy),
+    CARGO_ADD_TEST(TEST_cargo_set_option_description),
+    CARGO_ADD_TEST(TEST_parse_stop),
+    CARGO_ADD_TEST(TEST_parse_stop_hard),
+    CARGO_ADD_TEST(TEST_parse_stop_hard_fail),
+    CARGO_ADD_TEST(TEST_cargo_zero_or_one_with_arg),
+    CARGO_ADD_TEST(TEST_cargo_zero_or_one_without_arg),
+    CARGO_ADD_TEST(TEST_cargo_zero_or_one_without_arg2),
+    CARGO_ADD_TEST(TEST_late_unknown_options),
+    CARGO_ADD_TEST(TEST_early_unknown_options),
+    CARGO_ADD_TEST(TEST_late_unknown_options_no_fail),
+    CARGO_ADD_TEST(TEST_late_unknown_options_no_fail_stop),
+    CARGO_ADD_TEST(TEST_cargo_set_error),
+    CARGO_ADD_TEST(TEST_cargo_set_error_append),
+    CARGO_ADD_TEST(TEST_cargo_set_error_append2),
+    CARGO_ADD_TEST(TEST_cargo_set_memfunctions),
+    CARGO_ADD_TEST(TEST_cargo_malloc_zero_bytes),
+    CARGO_ADD_TEST(TEST_test_hidden_option),
+    CARGO_ADD_TEST(TEST_test_hidden_short_option),
+    CARGO_ADD_TEST(TEST_override_short_usage),
+    CARGO_ADD_TEST(TEST_duplicate_alias),
+    CARGO_ADD_TEST(TEST_cargo_get_option_type),
+    CARGO_ADD_TEST(TEST_cargo_large_list_and_usage),
+    CARGO_ADD_TEST(TEST_cargo_large_list_and_usage2),
+    CARGO_ADD_TEST(TEST_int_range_validation),
+    CARGO_ADD_TEST(TEST_float_range_validation),
+    CARGO_ADD_TEST(TEST_double_range_validation),
+    CARGO_ADD_TEST(TEST_uint_range_validation),
+    CARGO_ADD_TEST(TEST_longlong_range_validation),
+    CARGO_ADD_TEST(TEST_ulonglong_range_validation),
+    CARGO_ADD_TEST(TEST_choices_validation),
+    CARGO_ADD_TEST(TEST_choices_validation_case_sensitive),
+    CARGO_ADD_TEST(TEST_choices_validation_int),
+    CARGO_ADD_TEST(TEST_choices_validation_uint),
+    CARGO_ADD_TEST(TEST_choices_validation_float),
+    CARGO_ADD_TEST(TEST_choices_validation_double),
+    CARGO_ADD_TEST(TEST_choices_validation_longlong),
+    CARGO_ADD_TEST(TEST_choices_validation_ulonglong),
+    CARGO_ADD_TEST(TEST_double_parse),
+    CARGO_ADD_TEST(TEST_double_parse_clear),
+    CARGO_ADD_TEST(TEST_default_str),
+    CARGO_ADD_TEST(TEST_default_str2),
+    CARGO_ADD_TEST(TEST_default_str3),
+    CARGO_ADD_TEST(TEST_default_str_add_fail),
+    CARGO_ADD_TEST(TEST_default_str_add_fail2),
+    CARGO_ADD_TEST(TEST_nearly_equal),
+    CARGO_ADD_TEST(TEST_cargo_strdup_invalid_arg),
+    CARGO_ADD_TEST(TEST_option_name_index),
+    CARGO_ADD_TEST(TEST_token_classification),
+    CARGO_ADD_TEST(TEST_positional_cursor),
+    CARGO_ADD_TEST(TEST_bundled_short_flags),
+    CARGO_ADD_TEST(TEST_bundled_non_bool_flags),
+    CARGO_ADD_TEST(TEST_abbreviated_options),
+    CARGO_ADD_TEST(TEST_compiled_parser),
+    CARGO_ADD_TEST(TEST_compiled_parser_target_outside),
+    CARGO_ADD_TEST(TEST_scratch_arena),
+    CARGO_ADD_TEST(TEST_context_allocator),
+    CARGO_ADD_TEST(TEST_streaming_parse),
+    CARGO_ADD_TEST(TEST_response_files),
+    CARGO_ADD_TEST(TEST_parse_batch),
+    CARGO_ADD_TEST(TEST_integer_overflow),
+    CARGO_ADD_TEST(TEST_float_parsing),
+    CARGO_ADD_TEST(TEST_unbounded_array_size),
+    CARGO_ADD_TEST(TEST_bulk_conversion),
+    CARGO_ADD_TEST(TEST_parallel_convert),
+    CARGO_ADD_TEST(TEST_delimited_list),
+    CARGO_ADD_TEST(TEST_range_list),
+    CARGO_ADD_TEST(TEST_borrowed_strings),
+    CARGO_ADD_TEST(TEST_bool_bit_target),
+    CARGO_ADD_TEST(TEST_extension_type),
+    CARGO_ADD_TEST(TEST_choices_index),
+    CARGO_ADD_TEST(TEST_choices_map),
+    CARGO_ADD_TEST(TEST_range_validation_list),
+    CARGO_ADD_TEST(TEST_error_records),
+    CARGO_ADD_TEST(TEST_suggestions_bounded)
+};
+
+#define CARGO_NUM_TESTS (sizeof(tests) / sizeof(tests[0]))
+
+static void _test_print_names()
+{
+    int i;
+
+    for (i = 0; i < (int)CARGO_NUM_TESTS; i++)
+    {
+        printf("%2d: %s\n", (i + 1), tests[i].name);
+    }
+}
+
+static int _test_find_test_index(const char *name)
+{
+    int i;
+
+    for (i = 0; i < (int)CARGO_NUM_TESTS; i++)
+    {
+        if (!strcmp(name, tests[i].name))
+        {
+            return i + 1;
+        }
+    }
+
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    cargo_t cargo;
+    size_t i;
+    int was_error = 0;
+    int tests_to_run[CARGO_NUM_TESTS];
+    size_t num_tests = 0;
+    size_t success_count = 0;
+    int all = 0;
+    int quiet = 0;
+    int test_index = 0;
+    int shortlist = 0;
+    int start = 1;
+    int ret = 0;
+    char **test_names = NULL;
+    size_t test_name_count = 0;
+    cargo_test_t *t;
+
+    memset(tests_to_run, 0, sizeof(tests_to_run));
+
+    cargo_suppress_debug = 1;
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT, argv[0]))
+    {
+        fprintf(stderr, "Failed to init command line parsing\n");
+        return -1;
+    }
+
+    cargo_set_description(cargo,
+        "You can add additional debug output by compiling with CARGO_DEBUG=<level>");
+
+    ret |= cargo_add_option(cargo, 0, "--shortlist --short -s",
+            "Only show the tests that have been run, don't include the entire list.",
+            "b", &shortlist);
+
+    ret |= cargo_add_option(cargo, 0, "--all -a",
+            "Run all tests.",
+            "b", &all);
+
+    ret |= cargo_add_option(cargo, 0, "--quiet -q",
+            "Suppress CARGO_DEBUG output.",
+            "b", &quiet);
+
+    ret |= cargo_add_option(cargo, 0, "tests",
+            "Either a test number or name. "
+            "If -1 is specified all tests will be run.",
+            "[s]*", &test_names, &test_name_count);
+
+    cargo_set_epilog(cargo,
+            "Return code for this usage message equals "
+            "the number of available tests.");
+
+    assert(ret == 0);
+
+    if (cargo_parse(cargo, 0, 1, argc, argv))
+    {
+        _test_print_names();
+        cargo_print_usage(cargo, 0);
+        fprintf(stderr, "%s\n", cargo_get_error(cargo));
+        return CARGO_NUM_TESTS;
+    }
+
+    if ((test_name_count == 0) && !all)
+    {
+        _test_print_names();
+        cargo_print_usage(cargo, 0);
+        fprintf(stderr, "No test specified!\n");
+        return CARGO_NUM_TESTS;
+    }
+
+    if (!quiet) cargo_suppress_debug = 0;
+
+    for (i = 0; i < test_name_count; i++)
+    {
+        // First check if we were given a function name.
+        if (!strncmp(test_names[i], "TEST_", 5))
+        {
+            test_index = _test_find_test_index(test_names[i]);
+
+            if (test_index <= 0)
+            {
+                fprintf(stderr, "Unknown test specified: \"%s\"\n", test_names[i]);
+                return CARGO_NUM_TESTS;
+            }
+        }
+        else
+        {
+            test_index = atoi(test_names[i]);
+            fprintf(stderr, "%d\n", test_index);
+
+            if ((test_index == 0) || (test_index > (int)CARGO_NUM_TESTS))
+            {
+                fprintf(stderr, "Invalid test number %s\n", test_names[i]);
+                return CARGO_NUM_TESTS;
+            }
+            else if (test_index < 0)
+            {
+                printf("Run ALL tests!\n");
+                all = 1;
+                break;
+            }
+        }
+
+        tests_to_run[num_tests] = test_index;
+        num_tests++;
+    }
+
+    // Run all tests.
+    if (all)
+    {
+        num_tests = CARGO_NUM_TESTS;
+
+        for (i = 0; i < num_tests; i++)
+        {
+            tests_to_run[i] = i + 1;
+        }
+    }
+
+    // Run the tests.
+    for (i = 0; i < num_tests; i++)
+    {
+        test_index = tests_to_run[i] - 1;
+        t = &tests[test_index];
+        t->ran = 1;
+
+        fprintf(stderr, "\n%sStart Test %3d:%s - %s\n",
+            CARGO_COLOR_CYAN, test_index + 1, CARGO_COLOR_RESET, t->name);
+
+        //fprintf(stderr, "%s", CARGO_COLOR_DARK_GRAY);
+        t->error = t->f();
+        fprintf(stderr, "%s", CARGO_COLOR_RESET);
+
+        fprintf(stderr, "%sEnd Test %3d:%s ",
+            CARGO_COLOR_CYAN, test_index + 1, CARGO_COLOR_RESET);
+
+        if (t->error)
+        {
+            fprintf(stderr, "[%sFAIL%s] %s\n",
+                CARGO_COLOR_RED, CARGO_COLOR_RESET, t->error);
+            was_error++;
+        }
+        else
+        {
+            fprintf(stderr, "[%sSUCCESS%s]\n",
+                CARGO_COLOR_GREEN, CARGO_COLOR_RESET);
+
+            success_count++;
+        }
+
+        tests[test_index].success = (t->error == NULL);
+    }
+
+    printf("---------------------------------------------------------------\n");
+    printf("Test report:\n");
+    printf("---------------------------------------------------------------\n");
+
+    for (i = 0; i < CARGO_NUM_TESTS; i++)
+    {
+        if (!tests[i].ran)
+        {
+            if (!shortlist)
+            {
+                printf(" [%sNOT RUN%s] %3lu: %s\n",
+                    CARGO_COLOR_DARK_GRAY, CARGO_COLOR_RESET, (i + 1), tests[i].name);
+            }
+
+            continue;
+        }
+
+        if (tests[i].success)
+        {
+            printf(" [%sSUCCESS%s] %3lu: %s\n",
+                CARGO_COLOR_GREEN, CARGO_COLOR_RESET, (i + 1), tests[i].name);
+        }
+        else
+        {
+            fprintf(stderr, " [%sFAILED%s]  %3lu: %s - %s\n",
+                CARGO_COLOR_RED, CARGO_COLOR_RESET,
+                (i + 1), tests[i].name, tests[i].error);
+        }
+    }
+
+    if (was_error)
+    {
+        fprintf(stderr, "\n[[%sFAIL%s]] ", CARGO_COLOR_RED, CARGO_COLOR_RESET);
+    }
+    else
+    {
+        printf("\n[[%sSUCCESS%s]] ", CARGO_COLOR_GREEN, CARGO_COLOR_RESET);
+    }
+
+    printf("%lu of %lu tests run were successful (%lu of %lu tests ran)\n",
+            success_count, num_tests, num_tests, CARGO_NUM_TESTS);
+
+    cargo_suppress_debug = 1;
+    cargo_destroy(&cargo);
+    if (!quiet) cargo_suppress_debug = 0;
+
+    return (num_tests - success_count);
+}
+
+#elif defined(CARGO_HELPER)
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    char *fmt = NULL;
+    char *end = NULL;
+    char arrsize[1024];
+    char lenstr[1024];
+    char varname[1024];
+    cargo_type_t types[3];
+    size_t type_count = 0;
+    int array = 0;
+    int alloc = 0;
+    int static_str = 0;
+    size_t example_count = 1;
+    size_t i;
+    size_t j;
+    memset(types, 0, sizeof(types));
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "%s: <variable declaration>\n", argv[0]);
+        return -1;
+    }
+
+    fmt = argv[1];
+
+    printf("%s;\n", fmt);
+
+    while (isspace(*fmt)) fmt++;
+
+    // Get type.
+    if (!strncmp(fmt, "int", 3))
+    {
+        types[type_count++] = CARGO_INT;
+        types[type_count++] = CARGO_BOOL;
+        fmt += 3;
+    }
+    else if (!strncmp(fmt, "long long", 9))
+    {
+        types[type_count++] = CARGO_LONGLONG;
+        fmt += 9;
+    }
+    else if (!strncmp(fmt, "unsigned long long", 18))
+    {
+        types[type_count++] = CARGO_ULONGLONG;
+        fmt += 18;
+    }
+    else if (!strncmp(fmt, "char", 4))
+    {
+        types[type_count++] = CARGO_STRING;
+        fmt += 4;
+    }
+    else if (!strncmp(fmt, "float", 5))
+    {
+        types[type_count++] = CARGO_FLOAT;
+        fmt += 5;
+    }
+    else if (!strncmp(fmt, "double", 6))
+    {
+        types[type_count++] = CARGO_DOUBLE;
+        fmt += 6;
+    }
+    else if (!strncmp(fmt, "unsigned int", 12))
+    {
+        types[type_count++] = CARGO_UINT;
+        fmt += 12;
+    }
+
+    while (isspace(*fmt)) fmt++;
+
+    // Set array and alloc status.
+    if (types[0] == CARGO_STRING)
+    {
+        if (!strncmp(fmt, "**", 2))
+        {
+            alloc = 1;
+            array = 1;
+            fmt += 2;
+        }
+        else if (*fmt == '*')
+        {
+            alloc = 1;
+            fmt++;
+        }
+    }
+    else
+    {
+        if (*fmt == '*')
+        {
+            alloc = 1;
+            array = 1;
+            // We can't have CARGO_BOOL arrays.
+            if (types[0] == CARGO_INT)
+                type_count--;
+
+            fmt++;
+        }
+    }
+
+    // Get var name.
+    if ((end = strchr(fmt, '[')) != NULL)
+    {
+        cargo_snprintf(varname, sizeof(varname), "%.*s", (end - fmt), fmt);
+    }
+    else
+    {
+        cargo_snprintf(varname, sizeof(varname), "%s", fmt);
+    }
+
+    // Get variable name.
+    if ((end = strchr(fmt, '[')) != NULL)
+    {
+        char *start = end + 1;
+        array = 1;
+
+        // We can't have CARGO_BOOL arrays.
+        if (types[0] == CARGO_INT)
+            type_count--;
+
+        if ((end = strchr(fmt, ']')) == NULL)
+        {
+            fprintf(stderr, "Missing ']'\n");
+            ret = -1; goto fail;
+        }
+
+        cargo_snprintf(arrsize, sizeof(arrsize), "%.*s", (end - start), start);
+
+        if (types[0] == CARGO_STRING)
+        {
+            if (alloc)
+            {
+                fprintf(stderr, "You cannot use string arrays of this format\n");
+                ret = -1; goto fail;
+            }
+
+            if ((end = strchr(start, '[')) != NULL)
+            {
+                // We have an array of strings.
+                // char bla[COUNT][LENSTR];
+                start = end + 1;
+
+                if ((end = strchr(start, ']')) == NULL)
+                {
+                    fprintf(stderr, "Missing ']'\n");
+                    ret = -1; goto fail;
+                }
+
+                static_str = 1;
+                cargo_snprintf(lenstr, sizeof(lenstr), "%.*s", (end - start), start);
+            }
+            else
+            {
+                // This is not an array, simply a static string.
+                // char bla[123];
+                array = 0;
+                static_str = 1;
+                cargo_snprintf(lenstr, sizeof(lenstr), "%s", arrsize);
+            }
+        }
+
+        if (strlen(arrsize) == 0)
+        {
+            cargo_snprintf(arrsize, sizeof(arrsize), "sizeof(%s) / sizeof(%s[0])",
+                            varname, varname);
+        }
+    }
+
+    if ((types[0] == CARGO_STRING) && !array && !alloc && !static_str)
+    {
+        fprintf(stderr, "\"char\" is not a valid variable type by itself, did you mean \"char *\"?\n");
+        return -1;
+    }
+
+    if (alloc) example_count++;
+    if (array) printf("size_t %s_count;\n", varname);
+
+    // TODO: Create extra examples for [s#]#
+    //if ((types[0] == CARGO_STRING)) example_count += 2;
+
+    #define IS_EXTRA_EXAMPLE(num) ((j % 2) == 0)
+
+    for (j = 0; j < example_count; j++)
+    {
+        for (i = 0; i < type_count; i++)
+        {
+            printf("cargo_add_option(cargo, 0, \"--%s", varname);
+            if (strlen(varname) > 1) printf(" -%c", varname[0]);
+            printf("\", \"Description of %s\", \"", varname);
+
+            if (!alloc)
+            {
+                if (static_str || array)
+                    printf(".");
+            }
+
+            if (array) printf("[");
+
+            printf("%c", _cargo_type_to_str(types[i])[0]);
+
+            if (array && static_str) printf("#");
+            if (array) printf("]");
+
+            if (array && IS_EXTRA_EXAMPLE(1))
+            {
+                printf("#");
+            }
+            else
+            {
+                if (array && alloc) printf("+");
+            }
+
+            printf("\", &%s", varname);
+
+            if (static_str) printf(", %s", lenstr);
+
+            if (array)
+            {
+                printf(", &%s_count", varname);
+
+                if (!alloc)
+                {
+                    printf(", %s", arrsize);
+                }
+            }
+
+            if (array && alloc && IS_EXTRA_EXAMPLE(1))
+            {
+                printf(", 128");
+            }
+
+            printf(");");
+
+            if (array && alloc && IS_EXTRA_EXAMPLE(1))
+            {
+                printf(" // Allocated with max length 128.");
+            }
+            else if (array && alloc)
+            {
+                printf(" // Allocated unlimited length.");
+            }
+
+            printf("\n");
+        }
+    }
+
+fail:
+    return ret;
+}
+
+#elif defined(CARGO_EXAMPLE)
+
+typedef struct args_s
+{
+    int a;
+} args_t;
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    cargo_t cargo;
+
+    cargo_init(&cargo, 0, argv[0]);
+
+    // TODO: Make a real example.
+
+    cargo_print_usage(cargo, 0);
+    cargo_destroy(&cargo);
+    return ret;
+}
+
+#elif defined(CARGO_BENCH)
+
+#include <time.h>
+
+//
+// Benchmarks, run all of them or only the ones given by name:
+//   cargo_bench [name ...]
+//
+typedef int (*cargo_bench_f)(void);
+
+typedef struct cargo_bench_s
+{
+    const char *name;
+    cargo_bench_f f;
+} cargo_bench_t;
+
+static double _bench_ms(clock_t start)
+{
+    return ((double)(clock() - start) * 1000.0) / CLOCKS_PER_SEC;
+}
+
+// clock() adds up the time of all threads, so this is used
+// when timing something that runs in parallel.
+static double _bench_wall_ms(void)
+{
+    #ifdef _WIN32
+    return (double)GetTickCount64();
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0);
+    #endif
+}
+
+static int bench_option_lookup(void)
+{
+    // Parses the same amount of options against definitions with a
+    // growing number of options. The cost per lookup should stay flat.
+    #define BENCH_LOOKUPS 20000
+    #define BENCH_ROUNDS 20
+    size_t counts[] = { 10, 100, 1000, 10000 };
+    size_t c;
+    size_t k;
+    int r;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    char name[64];
+    char **args = NULL;
+    int *vals = NULL;
+    cargo_t cargo = NULL;
+
+    printf("Option lookup, %d options parsed per round:\n", BENCH_LOOKUPS);
+
+    for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        if (cargo_init(&cargo, 0, "bench"))
+            goto fail;
+
+        if (!(vals = calloc(counts[c], sizeof(int)))
+         || !(args = calloc(BENCH_LOOKUPS + 1, sizeof(char *))))
+            goto fail;
+
+        for (k = 0; k < counts[c]; k++)
+        {
+            cargo_snprintf(name, sizeof(name), "--option-name-%lu", k);
+
+            if (cargo_add_option(cargo, 0, name, NULL, "b!", &vals[k]))
+                goto fail;
+        }
+
+        args[0] = "bench";
+
+        for (k = 1; k <= BENCH_LOOKUPS; k++)
+        {
+            cargo_snprintf(name, sizeof(name), "--option-name-%lu",
+                            (k * 7919) % counts[c]);
+
+            if (!(args[k] = strdup(name)))
+                goto fail;
+        }
+
+        start = clock();
+
+        for (r = 0; r < BENCH_ROUNDS; r++)
+        {
+            if (cargo_parse(cargo, 0, 1, BENCH_LOOKUPS + 1, args))
+                goto fail;
+        }
+
+        ms = _bench_ms(start);
+
+        printf("  %6lu options: %8.2f ms, %6.1f ns/lookup\n",
+            counts[c], ms,
+            (ms * 1000000.0) / ((double)BENCH_LOOKUPS * BENCH_ROUNDS));
+
+        for (k = 1; k <= BENCH_LOOKUPS; k++)
+            free(args[k]);
+
+        free(args);
+        args = NULL;
+        free(vals);
+        vals = NULL;
+        cargo_destroy(&cargo);
+        cargo = NULL;
+    }
+
+    ret = 0;
+fail:
+    if (args)
+    {
+        for (k = 1; k <= BENCH_LOOKUPS; k++)
+            free(args[k]);
+        free(args);
+    }
+
+    free(vals);
+    if (cargo) cargo_destroy(&cargo);
+    return ret;
+    #undef BENCH_LOOKUPS
+    #undef BENCH_ROUNDS
+}
+
+typedef struct bench_args_s
+{
+    int level;
+    int verbose;
+    char *name;
+    int vals[8];
+    size_t val_count;
+} bench_args_t;
+
+static int _bench_add_options(cargo_t cargo, bench_args_t *a)
+{
+    int ret = 0;
+    ret |= cargo_add_option(cargo, 0, "--level -l", NULL, "i", &a->level);
+    ret |= cargo_add_option(cargo, 0, "--verbose -v", NULL, "b!", &a->verbose);
+    ret |= cargo_add_option(cargo, 0, "--name -n", NULL, "s", &a->name);
+    ret |= cargo_add_option(cargo, 0, "--vals", NULL, ".[i]+",
+                            &a->vals, &a->val_count, 8);
+    return ret;
+}
+
+static int bench_compiled_parse(void)
+{
+    // Parsing many short command lines, setting up a new context for
+    // each one versus a parse state for a compiled parser.
+    #define BENCH_PARSES 50000
+    int k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    bench_args_t tmpl;
+    bench_args_t a;
+    cargo_t cargo = NULL;
+    cargo_t state = NULL;
+    cargo_compiled_t compiled = NULL;
+    char *args[] = { "bench", "-vv", "--level", "3", "--name", "job",
+                     "--vals", "1", "2", "3" };
+    int argc = sizeof(args) / sizeof(args[0]);
+    memset(&tmpl, 0, sizeof(tmpl));
+
+    printf("Parse %d command lines:\n", BENCH_PARSES);
+
+    start = clock();
+
+    for (k = 0; k < BENCH_PARSES; k++)
+    {
+        memset(&a, 0, sizeof(a));
+
+        if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+         || _bench_add_options(cargo, &a)
+         || cargo_parse(cargo, 0, 1, argc, args))
+            goto fail;
+
+        cargo_destroy(&cargo);
+    }
+
+    ms = _bench_ms(start);
+    printf("  new context:  %8.2f ms, %6.2f us/parse\n",
+        ms, (ms * 1000.0) / BENCH_PARSES);
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || _bench_add_options(cargo, &tmpl)
+     || cargo_compile(&cargo, &compiled, &tmpl, sizeof(tmpl)))
+        goto fail;
+
+    start = clock();
+
+    for (k = 0; k < BENCH_PARSES; k++)
+    {
+        memset(&a, 0, sizeof(a));
+
+        if (cargo_state_init(&state, compiled, &a)
+         || cargo_parse(state, 0, 1, argc, args))
+            goto fail;
+
+        cargo_destroy(&state);
+    }
+
+    ms = _bench_ms(start);
+    printf("  parse state:  %8.2f ms, %6.2f us/parse\n",
+        ms, (ms * 1000.0) / BENCH_PARSES);
+
+    ret = 0;
+fail:
+    cargo_destroy(&state);
+    cargo_destroy(&cargo);
+    cargo_compiled_destroy(&compiled);
+    return ret;
+    #undef BENCH_PARSES
+}
+
+static int bench_response_file(void)
+{
+    // Parses a large response file, the arguments are split in place
+    // in the mapped file instead of being copied one by one.
+    #define BENCH_RESPONSE_ARGS 1000000
+    #define BENCH_RESPONSE_FILE "cargo_bench_args.rsp"
+    int k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    size_t size = 0;
+    size_t arg_count = 0;
+    FILE *f = NULL;
+    bench_args_t a;
+    cargo_t cargo = NULL;
+    char *args[] = { "bench", "@"BENCH_RESPONSE_FILE };
+    memset(&a, 0, sizeof(a));
+
+    if (!(f = fopen(BENCH_RESPONSE_FILE, "wb")))
+        goto fail;
+
+    for (k = 0; k < BENCH_RESPONSE_ARGS; k++)
+    {
+        size += fprintf(f, (k % 10) ? "argument-%07d " : "\"arg %07d\"\n", k);
+    }
+
+    fclose(f);
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN | CARGO_RESPONSE_FILES, "bench")
+     || _bench_add_options(cargo, &a))
+        goto fail;
+
+    printf("Response file with %d args (%.1f MB):\n",
+        BENCH_RESPONSE_ARGS, size / (1024.0 * 1024.0));
+
+    start = clock();
+
+    if (cargo_parse(cargo, 0, 1, 2, args))
+        goto fail;
+
+    ms = _bench_ms(start);
+    cargo_get_args(cargo, &arg_count);
+
+    printf("  parse:        %8.2f ms, %6.1f MB/s, %lu heap allocations\n",
+        ms, (size / (1024.0 * 1024.0)) / (ms / 1000.0),
+        cargo_get_heap_alloc_count(cargo));
+
+    if (arg_count != BENCH_RESPONSE_ARGS)
+        goto fail;
+
+    ret = 0;
+fail:
+    remove(BENCH_RESPONSE_FILE);
+    cargo_destroy(&cargo);
+    return ret;
+    #undef BENCH_RESPONSE_ARGS
+    #undef BENCH_RESPONSE_FILE
+}
+
+static int bench_parse_batch(void)
+{
+    // Parses a manifest of command lines, one cargo_parse per line
+    // versus a single cargo_parse_batch call.
+    #define BENCH_BATCH_LINES 50000
+    int k;
+    int ret = -1;
+    int argc = 0;
+    clock_t start;
+    double ms;
+    bench_args_t a;
+    cargo_t cargo = NULL;
+    char *buf = NULL;
+    size_t len = 0;
+    char *line = NULL;
+    char *eol = NULL;
+    char **argv = NULL;
+    const char *fmt = "-vv --level %d --name \"job %d\" --vals 1 2 3\n";
+    size_t max_line = 64;
+    memset(&a, 0, sizeof(a));
+
+    if (!(buf = malloc(BENCH_BATCH_LINES * max_line)))
+        goto fail;
+
+    for (k = 0; k < BENCH_BATCH_LINES; k++)
+    {
+        len += sprintf(buf + len, fmt, k % 10, k);
+    }
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || _bench_add_options(cargo, &a))
+        goto fail;
+
+    printf("Parse a manifest of %d command lines:\n", BENCH_BATCH_LINES);
+
+    start = clock();
+
+    for (line = buf; line < (buf + len); line = eol + 1)
+    {
+        eol = strchr(line, '\n');
+        *eol = '\0';
+
+        if (!(argv = cargo_split_commandline(0, line, &argc)))
+            goto fail;
+
+        *eol = '\n';
+
+        if (cargo_parse(cargo, 0, 0, argc, argv))
+            goto fail;
+
+        cargo_free_commandline(&argv, argc);
+    }
+
+    ms = _bench_ms(start);
+    printf("  split + parse: %8.2f ms, %8.0f lines/s\n",
+        ms, BENCH_BATCH_LINES / (ms / 1000.0));
+
+    start = clock();
+
+    if (cargo_parse_batch(cargo, 0, buf, len, NULL, NULL) != BENCH_BATCH_LINES)
+        goto fail;
+
+    ms = _bench_ms(start);
+    printf("  batch:         %8.2f ms, %8.0f lines/s\n",
+        ms, BENCH_BATCH_LINES / (ms / 1000.0));
+
+    ret = 0;
+fail:
+    if (argv) cargo_free_commandline(&argv, argc);
+    free(buf);
+    cargo_destroy(&cargo);
+    return ret;
+    #undef BENCH_BATCH_LINES
+}
+
+static int bench_integer_parse(void)
+{
+    // Converts a million integers using libc and the conversion used
+    // by cargo, and parses them as an array option.
+    #define BENCH_INTS 1000000
+    int k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    char *end = NULL;
+    char *buf = NULL;
+    char **args = NULL;
+    long sum = 0;
+    long long v = 0;
+    unsigned long long uv = 0;
+    unsigned long long *uvals = NULL;
+    size_t uval_count = 0;
+    cargo_t cargo = NULL;
+
+    if (!(buf = malloc(BENCH_INTS * 24))
+     || !(args = calloc(BENCH_INTS + 2, sizeof(char *))))
+        goto fail;
+
+    args[0] = "bench";
+    args[1] = "--vals";
+
+    for (k = 0, end = buf; k < BENCH_INTS; k++)
+    {
+        args[k + 2] = end;
+        end += sprintf(end, (k % 2) ? "%d" : "-%d",
+                       (int)(((unsigned)k * 2654435761u) % 2000000000u)) + 1;
+    }
+
+    printf("Convert %d integers:\n", BENCH_INTS);
+
+    start = clock();
+    for (k = 0; k < BENCH_INTS; k++)
+        sum += strtol(args[k + 2], &end, 10);
+    ms = _bench_ms(start);
+    printf("  strtol:        %8.2f ms, %6.1f ns/int\n",
+        ms, (ms * 1000000.0) / BENCH_INTS);
+
+    start = clock();
+    for (k = 0; k < BENCH_INTS; k++)
+    {
+        _cargo_parse_longlong(args[k + 2], INT_MIN, INT_MAX, &v);
+        sum -= (long)v;
+    }
+    ms = _bench_ms(start);
+    printf("  cargo:         %8.2f ms, %6.1f ns/int\n",
+        ms, (ms * 1000000.0) / BENCH_INTS);
+
+    if (sum != 0)
+        goto fail;
+
+    // Long digit runs, where 8 digits are converted at a time.
+    for (k = 0, end = buf; k < BENCH_INTS; k++)
+    {
+        args[k + 2] = end;
+        end += sprintf(end, "%lu%09lu",
+                       (unsigned long)k, (unsigned long)k * 7) + 1;
+    }
+
+    start = clock();
+    for (k = 0; k < BENCH_INTS; k++)
+        uv += strtoull(args[k + 2], &end, 10);
+    ms = _bench_ms(start);
+    printf("  strtoull:      %8.2f ms, %6.1f ns/int (15 digits)\n",
+        ms, (ms * 1000000.0) / BENCH_INTS);
+
+    start = clock();
+    for (k = 0; k < BENCH_INTS; k++)
+    {
+        unsigned long long u = 0;
+        _cargo_parse_ulonglong(args[k + 2], ULLONG_MAX, &u);
+        uv -= u;
+    }
+    ms = _bench_ms(start);
+    printf("  cargo:         %8.2f ms, %6.1f ns/int (15 digits)\n",
+        ms, (ms * 1000000.0) / BENCH_INTS);
+
+    if (uv != 0)
+        goto fail;
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || cargo_add_option(cargo, 0, "--vals", NULL, "[U]+", &uvals, &uval_count))
+        goto fail;
+
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, BENCH_INTS + 2, args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  cargo_parse:   %8.2f ms, %6.1f ns/int ([U]+ array)\n",
+        ms, (ms * 1000000.0) / BENCH_INTS);
+
+    if (uval_count != BENCH_INTS)
+        goto fail;
+
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+    free(args);
+    free(buf);
+    return ret;
+    #undef BENCH_INTS
+}
+
+static int bench_float_parse(void)
+{
+    // Converts a million doubles using libc and the conversion used
+    // by cargo, and parses them as an array option.
+    #define BENCH_FLOATS 1000000
+    int k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    char *end = NULL;
+    char *buf = NULL;
+    char **args = NULL;
+    double sum = 0;
+    double v = 0;
+    double *vals = NULL;
+    size_t val_count = 0;
+    cargo_t cargo = NULL;
+
+    if (!(buf = malloc(BENCH_FLOATS * 32))
+     || !(args = calloc(BENCH_FLOATS + 2, sizeof(char *))))
+        goto fail;
+
+    args[0] = "bench";
+    args[1] = "--vals";
+
+    for (k = 0, end = buf; k < BENCH_FLOATS; k++)
+    {
+        args[k + 2] = end;
+        end += sprintf(end, "%.17g",
+            ((double)((unsigned)k * 2654435761u) / 4294967296.0)
+            * ((k % 3) ? 1e-3 : 1e5)) + 1;
+    }
+
+    printf("Convert %d doubles:\n", BENCH_FLOATS);
+
+    start = clock();
+    for (k = 0; k < BENCH_FLOATS; k++)
+        sum += strtod(args[k + 2], &end);
+    ms = _bench_ms(start);
+    printf("  strtod:        %8.2f ms, %6.1f ns/double\n",
+        ms, (ms * 1000000.0) / BENCH_FLOATS);
+
+    start = clock();
+    for (k = 0; k < BENCH_FLOATS; k++)
+    {
+        _cargo_parse_double(args[k + 2], &v);
+        sum -= v;
+    }
+    ms = _bench_ms(start);
+    printf("  cargo:         %8.2f ms, %6.1f ns/double\n",
+        ms, (ms * 1000000.0) / BENCH_FLOATS);
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || cargo_add_option(cargo, 0, "--vals", NULL, "[d]+", &vals, &val_count))
+        goto fail;
+
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, BENCH_FLOATS + 2, args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  cargo_parse:   %8.2f ms, %6.1f ns/double ([d]+ array)\n",
+        ms, (ms * 1000000.0) / BENCH_FLOATS);
+
+    if (val_count != BENCH_FLOATS)
+        goto fail;
+
+    // Keep the loops from being optimized away.
+    ret = (sum > 1e300) ? -1 : 0;
+fail:
+    cargo_destroy(&cargo);
+    free(args);
+    free(buf);
+    return ret;
+    #undef BENCH_FLOATS
+}
+
+static int bench_parallel_convert(void)
+{
+    // Parses two million doubles as an array option, with and
+    // without converting them in parallel.
+    #define BENCH_VALUES 2000000
+    int k;
+    int ret = -1;
+    double start;
+    double ms;
+    char *end = NULL;
+    char *buf = NULL;
+    char **args = NULL;
+    double *vals = NULL;
+    size_t val_count = 0;
+    cargo_t cargo = NULL;
+    cargo_flags_t flags[] = { 0, CARGO_PARALLEL_CONVERT };
+    const char *names[] = { "serial", "parallel" };
+
+    if (!(buf = malloc(BENCH_VALUES * 24))
+     || !(args = calloc(BENCH_VALUES + 2, sizeof(char *))))
+        goto fail;
 
-    cargo_suppress_debug = 1;
+    args[0] = "bench";
+    args[1] = "--vals";
 
-    if (cargo_init(&cargo, CARGO_AUTOCLEAN | CARGO_NOERR_OUTPUT, argv[0]))
+    for (k = 0, end = buf; k < BENCH_VALUES; k++)
     {
-        fprintf(stderr, "Failed to init command line parsing\n");
-        return -1;
+        args[k + 2] = end;
+        end += sprintf(end, "%.17g",
+                       ((unsigned)k * 2654435761u) / 4096.0) + 1;
     }
 
-    cargo_set_description(cargo,
-        "You can add additional debug output by compiling with CARGO_DEBUG=<level>");
+    printf("Parse %d doubles as a [d]+ array:\n", BENCH_VALUES);
 
-    ret |= cargo_add_option(cargo, 0, "--shortlist --short -s",
-            "Only show the tests that have been run, don't include the entire list.",
-            "b", &shortlist);
+    for (k = 0; k < (int)(sizeof(flags) / sizeof(flags[0])); k++)
+    {
+        if (cargo_init(&cargo, CARGO_AUTOCLEAN | flags[k], "bench")
+         || cargo_add_option(cargo, 0, "--vals", NULL, "[d]+", &vals, &val_count))
+            goto fail;
 
-    ret |= cargo_add_option(cargo, 0, "--all -a",
-            "Run all tests.",
-            "b", &all);
+        start = _bench_wall_ms();
+        if (cargo_parse(cargo, 0, 1, BENCH_VALUES + 2, args))
+            goto fail;
+        ms = _bench_wall_ms() - start;
+        printf("  %-13s  %8.2f ms, %6.1f ns/double\n",
+            names[k], ms, (ms * 1000000.0) / BENCH_VALUES);
 
-    ret |= cargo_add_option(cargo, 0, "--quiet -q",
-            "Suppress CARGO_DEBUG output.",
-            "b", &quiet);
+        if (val_count != BENCH_VALUES)
+            goto fail;
 
-    ret |= cargo_add_option(cargo, 0, "tests",
-            "Either a test number or name. "
-            "If -1 is specified all tests will be run.",
-            "[s]*", &test_names, &test_name_count);
+        cargo_destroy(&cargo);
+    }
 
-    cargo_set_epilog(cargo,
-            "Return code for this usage message equals "
-            "the number of available tests.");
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+    free(args);
+    free(buf);
+    return ret;
+    #undef BENCH_VALUES
+}
 
-    assert(ret == 0);
+static int bench_delimited_list(void)
+{
+    // Parses a million integers given as a single comma separated
+    // argument, and as separate arguments.
+    #define BENCH_INTS 1000000
+    int k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    char *end = NULL;
+    char *list = NULL;
+    char **args = NULL;
+    int *vals = NULL;
+    size_t val_count = 0;
+    cargo_t cargo = NULL;
+    char *list_args[3];
 
-    if (cargo_parse(cargo, 0, 1, argc, argv))
-    {
-        _test_print_names();
-        cargo_print_usage(cargo, 0);
-        fprintf(stderr, "%s\n", cargo_get_error(cargo));
-        return CARGO_NUM_TESTS;
-    }
+    if (!(list = malloc(BENCH_INTS * 12))
+     || !(args = calloc(BENCH_INTS + 2, sizeof(char *))))
+        goto fail;
 
-    if ((test_name_count == 0) && !all)
+    args[0] = "bench";
+    args[1] = "--vals";
+
+    for (k = 0, end = list; k < BENCH_INTS; k++)
     {
-        _test_print_names();
-        cargo_print_usage(cargo, 0);
-        fprintf(stderr, "No test specified!\n");
-        return CARGO_NUM_TESTS;
+        end += sprintf(end, "%d,", (int)(((unsigned)k * 2654435761u) % 1000000u));
     }
 
-    if (!quiet) cargo_suppress_debug = 0;
+    end[-1] = '\0';
 
-    for (i = 0; i < test_name_count; i++)
-    {
-        // First check if we were given a function name.
-        if (!strncmp(test_names[i], "TEST_", 5))
-        {
-            test_index = _test_find_test_index(test_names[i]);
+    list_args[0] = "bench";
+    list_args[1] = "--vals";
+    list_args[2] = list;
 
-            if (test_index <= 0)
-            {
-                fprintf(stderr, "Unknown test specified: \"%s\"\n", test_names[i]);
-                return CARGO_NUM_TESTS;
-            }
-        }
-        else
-        {
-            test_index = atoi(test_names[i]);
-            fprintf(stderr, "%d\n", test_index);
+    printf("Parse %d integers:\n", BENCH_INTS);
 
-            if ((test_index == 0) || (test_index > (int)CARGO_NUM_TESTS))
-            {
-                fprintf(stderr, "Invalid test number %s\n", test_names[i]);
-                return CARGO_NUM_TESTS;
-            }
-            else if (test_index < 0)
-            {
-                printf("Run ALL tests!\n");
-                all = 1;
-                break;
-            }
-        }
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || cargo_add_option(cargo, 0, "--vals", NULL, "[i,]+", &vals, &val_count))
+        goto fail;
 
-        tests_to_run[num_tests] = test_index;
-        num_tests++;
-    }
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, 3, list_args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  [i,]+ list:    %8.2f ms, %6.1f ns/int (one argument)\n",
+        ms, (ms * 1000000.0) / BENCH_INTS);
 
-    // Run all tests.
-    if (all)
-    {
-        num_tests = CARGO_NUM_TESTS;
+    if (val_count != BENCH_INTS)
+        goto fail;
 
-        for (i = 0; i < num_tests; i++)
+    cargo_destroy(&cargo);
+
+    // The same values split into separate arguments.
+    args[2] = list;
+
+    for (k = 1, end = list; k < BENCH_INTS; end++)
+    {
+        if (*end == ',')
         {
-            tests_to_run[i] = i + 1;
+            *end = '\0';
+            args[2 + k++] = end + 1;
         }
     }
 
-    // Run the tests.
-    for (i = 0; i < num_tests; i++)
-    {
-        test_index = tests_to_run[i] - 1;
-        t = &tests[test_index];
-        t->ran = 1;
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || cargo_add_option(cargo, 0, "--vals", NULL, "[i]+", &vals, &val_count))
+        goto fail;
 
-        fprintf(stderr, "\n%sStart Test %3d:%s - %s\n",
-            CARGO_COLOR_CYAN, test_index + 1, CARGO_COLOR_RESET, t->name);
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, BENCH_INTS + 2, args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  [i]+ array:    %8.2f ms, %6.1f ns/int (separate arguments)\n",
+        ms, (ms * 1000000.0) / BENCH_INTS);
 
-        //fprintf(stderr, "%s", CARGO_COLOR_DARK_GRAY);
-        t->error = t->f();
-        fprintf(stderr, "%s", CARGO_COLOR_RESET);
+    if (val_count != BENCH_INTS)
+        goto fail;
 
-        fprintf(stderr, "%sEnd Test %3d:%s ",
-            CARGO_COLOR_CYAN, test_index + 1, CARGO_COLOR_RESET);
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+    free(args);
+    free(list);
+    return ret;
+    #undef BENCH_INTS
+}
 
-        if (t->error)
-        {
-            fprintf(stderr, "[%sFAIL%s] %s\n",
-                CARGO_COLOR_RED, CARGO_COLOR_RESET, t->error);
-            was_error++;
-        }
-        else
-        {
-            fprintf(stderr, "[%sSUCCESS%s]\n",
-                CARGO_COLOR_GREEN, CARGO_COLOR_RESET);
+static int bench_range_list(void)
+{
+    // Expands large ranges into a bitmap and into an array.
+    #define BENCH_BITS (1 << 24)
+    int ret = -1;
+    clock_t start;
+    double ms;
+    unsigned long long *bits = NULL;
+    unsigned int *vals = NULL;
+    size_t val_count = 0;
+    cargo_t cargo = NULL;
+    char *args1[] = { "bench", "--bits", "0-16777215" };
+    char *args2[] = { "bench", "--bits", "0-16777215:3" };
+    char range_max[64];
+    char *args3[] = { "bench", "--vals", NULL };
 
-            success_count++;
-        }
+    if (!(bits = malloc(CARGO_BITMAP_WORDS(BENCH_BITS) * sizeof(unsigned long long))))
+        goto fail;
 
-        tests[test_index].success = (t->error == NULL);
-    }
+    printf("Expand ranges of %d values:\n", BENCH_BITS);
 
-    printf("---------------------------------------------------------------\n");
-    printf("Test report:\n");
-    printf("---------------------------------------------------------------\n");
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || cargo_add_option(cargo, 0, "--bits", NULL, "m#", bits, BENCH_BITS)
+     || cargo_add_option(cargo, 0, "--vals", NULL, "[u-]+", &vals, &val_count))
+        goto fail;
 
-    for (i = 0; i < CARGO_NUM_TESTS; i++)
-    {
-        if (!tests[i].ran)
-        {
-            if (!shortlist)
-            {
-                printf(" [%sNOT RUN%s] %3lu: %s\n",
-                    CARGO_COLOR_DARK_GRAY, CARGO_COLOR_RESET, (i + 1), tests[i].name);
-            }
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, 3, args1))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  m# bitmap:         %8.2f ms\n", ms);
 
-            continue;
-        }
+    if (!CARGO_BITMAP_TEST(bits, BENCH_BITS - 1))
+        goto fail;
 
-        if (tests[i].success)
-        {
-            printf(" [%sSUCCESS%s] %3lu: %s\n",
-                CARGO_COLOR_GREEN, CARGO_COLOR_RESET, (i + 1), tests[i].name);
-        }
-        else
-        {
-            fprintf(stderr, " [%sFAILED%s]  %3lu: %s - %s\n",
-                CARGO_COLOR_RED, CARGO_COLOR_RESET,
-                (i + 1), tests[i].name, tests[i].error);
-        }
-    }
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, 3, args2))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  m# bitmap step 3:  %8.2f ms\n", ms);
 
-    if (was_error)
-    {
-        fprintf(stderr, "\n[[%sFAIL%s]] ", CARGO_COLOR_RED, CARGO_COLOR_RESET);
-    }
-    else
-    {
-        printf("\n[[%sSUCCESS%s]] ", CARGO_COLOR_GREEN, CARGO_COLOR_RESET);
-    }
+    // An array can't expand to more than CARGO_MAX_RANGE_VALUES.
+    sprintf(range_max, "0-%d", CARGO_MAX_RANGE_VALUES - 1);
+    args3[2] = range_max;
 
-    printf("%lu of %lu tests run were successful (%lu of %lu tests ran)\n",
-            success_count, num_tests, num_tests, CARGO_NUM_TESTS);
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, 3, args3))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  [u-]+ array:       %8.2f ms, %6.2f ns/value (%d values)\n",
+        ms, (ms * 1000000.0) / CARGO_MAX_RANGE_VALUES, CARGO_MAX_RANGE_VALUES);
 
-    cargo_suppress_debug = 1;
-    cargo_destroy(&cargo);
-    if (!quiet) cargo_suppress_debug = 0;
+    if (val_count != CARGO_MAX_RANGE_VALUES)
+        goto fail;
 
-    return (num_tests - success_count);
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+    free(bits);
+    return ret;
+    #undef BENCH_BITS
 }
 
-#elif defined(CARGO_HELPER)
-
-int main(int argc, char **argv)
+static int bench_borrowed_strings(void)
 {
-    int ret = 0;
-    char *fmt = NULL;
-    char *end = NULL;
-    char arrsize[1024];
-    char lenstr[1024];
-    char varname[1024];
-    cargo_type_t types[3];
-    size_t type_count = 0;
-    int array = 0;
-    int alloc = 0;
-    int static_str = 0;
-    size_t example_count = 1;
-    size_t i;
-    size_t j;
-    memset(types, 0, sizeof(types));
-
-    if (argc < 2)
-    {
-        fprintf(stderr, "%s: <variable declaration>\n", argv[0]);
-        return -1;
-    }
-
-    fmt = argv[1];
-
-    printf("%s;\n", fmt);
+    // Parses a million file names, copied and borrowed.
+    #define BENCH_FILES 1000000
+    int k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    char *names = NULL;
+    char **args = NULL;
+    char **files = NULL;
+    size_t file_count = 0;
+    cargo_t cargo = NULL;
+
+    if (!(names = malloc(BENCH_FILES * 16))
+     || !(args = calloc(BENCH_FILES + 1, sizeof(char *))))
+        goto fail;
 
-    while (isspace(*fmt)) fmt++;
+    args[0] = "bench";
 
-    // Get type.
-    if (!strncmp(fmt, "int", 3))
-    {
-        types[type_count++] = CARGO_INT;
-        types[type_count++] = CARGO_BOOL;
-        fmt += 3;
-    }
-    else if (!strncmp(fmt, "long long", 9))
-    {
-        types[type_count++] = CARGO_LONGLONG;
-        fmt += 9;
-    }
-    else if (!strncmp(fmt, "unsigned long long", 18))
-    {
-        types[type_count++] = CARGO_ULONGLONG;
-        fmt += 18;
-    }
-    else if (!strncmp(fmt, "char", 4))
-    {
-        types[type_count++] = CARGO_STRING;
-        fmt += 4;
-    }
-    else if (!strncmp(fmt, "float", 5))
-    {
-        types[type_count++] = CARGO_FLOAT;
-        fmt += 5;
-    }
-    else if (!strncmp(fmt, "double", 6))
+    for (k = 0; k < BENCH_FILES; k++)
     {
-        types[type_count++] = CARGO_DOUBLE;
-        fmt += 6;
-    }
-    else if (!strncmp(fmt, "unsigned int", 12))
-    {
-        types[type_count++] = CARGO_UINT;
-        fmt += 12;
+        args[k + 1] = names + k * 16;
+        sprintf(args[k + 1], "file%07d.txt", k);
     }
 
-    while (isspace(*fmt)) fmt++;
+    printf("Parse %d file names:\n", BENCH_FILES);
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || cargo_add_option(cargo, 0, "files", NULL, "[s]+", &files, &file_count))
+        goto fail;
 
-    // Set array and alloc status.
-    if (types[0] == CARGO_STRING)
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, BENCH_FILES + 1, args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  copied:   %8.2f ms, %6.1f ns/file\n",
+        ms, (ms * 1000000.0) / BENCH_FILES);
+
+    cargo_destroy(&cargo);
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN | CARGO_BORROW_STRINGS, "bench")
+     || cargo_add_option(cargo, 0, "files", NULL, "[s]+", &files, &file_count))
+        goto fail;
+
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, BENCH_FILES + 1, args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  borrowed: %8.2f ms, %6.1f ns/file\n",
+        ms, (ms * 1000000.0) / BENCH_FILES);
+
+    if ((file_count != BENCH_FILES) || (files[0] != args[1]))
+        goto fail;
+
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+    free(args);
+    free(names);
+    return ret;
+    #undef BENCH_FILES
+}
+
+static int bench_choices_validation(void)
+{
+    // Validates many values against a large list of choices.
+    #define BENCH_CHOICES 10000
+    #define BENCH_VALUES 100000
+    int k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    char *names = NULL;
+    const char **choices = NULL;
+    char **args = NULL;
+    char **vals = NULL;
+    size_t val_count = 0;
+    int *nums = NULL;
+    cargo_validation_t *v = NULL;
+    cargo_t cargo = NULL;
+
+    if (!(names = malloc(BENCH_CHOICES * 16))
+     || !(choices = calloc(BENCH_CHOICES, sizeof(char *)))
+     || !(args = calloc(BENCH_VALUES + 1, sizeof(char *)))
+     || !(nums = calloc(BENCH_VALUES, sizeof(int))))
+        goto fail;
+
+    for (k = 0; k < BENCH_CHOICES; k++)
     {
-        if (!strncmp(fmt, "**", 2))
-        {
-            alloc = 1;
-            array = 1;
-            fmt += 2;
-        }
-        else if (*fmt == '*')
-        {
-            alloc = 1;
-            fmt++;
-        }
+        choices[k] = names + k * 16;
+        sprintf(names + k * 16, "choice-%05d", k);
     }
-    else
-    {
-        if (*fmt == '*')
-        {
-            alloc = 1;
-            array = 1;
-            // We can't have CARGO_BOOL arrays.
-            if (types[0] == CARGO_INT)
-                type_count--;
 
-            fmt++;
-        }
-    }
+    args[0] = "bench";
 
-    // Get var name.
-    if ((end = strchr(fmt, '[')) != NULL)
+    for (k = 0; k < BENCH_VALUES; k++)
     {
-        cargo_snprintf(varname, sizeof(varname), "%.*s", (end - fmt), fmt);
+        args[k + 1] = (char *)choices[(k * 7919) % BENCH_CHOICES];
     }
-    else
+
+    printf("Validate %d values against %d choices:\n", BENCH_VALUES, BENCH_CHOICES);
+
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN | CARGO_BORROW_STRINGS, "bench")
+     || cargo_add_option(cargo, 0, "vals", NULL, "[s]+", &vals, &val_count)
+     || cargo_add_validation(cargo, 0, "vals",
+            cargo_validate_choices_array(0, CARGO_STRING,
+                                         BENCH_CHOICES, choices)))
+        goto fail;
+
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, BENCH_VALUES + 1, args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  strings:  %8.2f ms, %6.1f ns/value\n",
+        ms, (ms * 1000000.0) / BENCH_VALUES);
+
+    if (val_count != BENCH_VALUES)
+        goto fail;
+
+    // Building the index for int choices given in reverse order.
+    for (k = 0; k < BENCH_VALUES; k++)
     {
-        cargo_snprintf(varname, sizeof(varname), "%s", fmt);
+        nums[k] = BENCH_VALUES - k;
     }
 
-    // Get variable name.
-    if ((end = strchr(fmt, '[')) != NULL)
+    start = clock();
+    if (!(v = cargo_validate_choices_array(0, CARGO_INT, BENCH_VALUES, nums)))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  create %d reversed ints: %8.2f ms\n", BENCH_VALUES, ms);
+
+    v->ref_count++;
+    _cargo_free_validation(&v);
+
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+    free(nums);
+    free(args);
+    free(choices);
+    free(names);
+    return ret;
+    #undef BENCH_CHOICES
+    #undef BENCH_VALUES
+}
+
+static int bench_range_validation(void)
+{
+    // Parses a million integers into an array with a range validation.
+    #define BENCH_INTS 1000000
+    int k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    char *buf = NULL;
+    char *end = NULL;
+    char **args = NULL;
+    int *vals = NULL;
+    size_t val_count = 0;
+    cargo_t cargo = NULL;
+
+    if (!(buf = malloc(BENCH_INTS * 8))
+     || !(args = calloc(BENCH_INTS + 1, sizeof(char *))))
+        goto fail;
+
+    args[0] = "bench";
+
+    for (k = 0, end = buf; k < BENCH_INTS; k++)
     {
-        char *start = end + 1;
-        array = 1;
+        args[k + 1] = end;
+        end += sprintf(end, "%d", k % 1000) + 1;
+    }
 
-        // We can't have CARGO_BOOL arrays.
-        if (types[0] == CARGO_INT)
-            type_count--;
+    printf("Parse %d integers with a range validation:\n", BENCH_INTS);
 
-        if ((end = strchr(fmt, ']')) == NULL)
-        {
-            fprintf(stderr, "Missing ']'\n");
-            ret = -1; goto fail;
-        }
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN, "bench")
+     || cargo_add_option(cargo, 0, "vals", NULL, "[i]+", &vals, &val_count)
+     || cargo_add_validation(cargo, 0, "vals", cargo_validate_int_range(0, 999)))
+        goto fail;
 
-        cargo_snprintf(arrsize, sizeof(arrsize), "%.*s", (end - start), start);
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, BENCH_INTS + 1, args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  [i]+ int range: %8.2f ms, %6.1f ns/int\n",
+        ms, (ms * 1000000.0) / BENCH_INTS);
 
-        if (types[0] == CARGO_STRING)
-        {
-            if (alloc)
-            {
-                fprintf(stderr, "You cannot use string arrays of this format\n");
-                ret = -1; goto fail;
-            }
+    if (val_count != BENCH_INTS)
+        goto fail;
 
-            if ((end = strchr(start, '[')) != NULL)
-            {
-                // We have an array of strings.
-                // char bla[COUNT][LENSTR];
-                start = end + 1;
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+    free(args);
+    free(buf);
+    return ret;
+    #undef BENCH_INTS
+}
 
-                if ((end = strchr(start, ']')) == NULL)
-                {
-                    fprintf(stderr, "Missing ']'\n");
-                    ret = -1; goto fail;
-                }
+static int bench_repeated_option(void)
+{
+    // Parses an option that is given over and over again,
+    // which records a warning each time.
+    #define BENCH_REPEATS 20000
+    int k;
+    int ret = -1;
+    int v = 0;
+    clock_t start;
+    double ms;
+    char **args = NULL;
+    cargo_t cargo = NULL;
 
-                static_str = 1;
-                cargo_snprintf(lenstr, sizeof(lenstr), "%.*s", (end - start), start);
-            }
-            else
-            {
-                // This is not an array, simply a static string.
-                // char bla[123];
-                array = 0;
-                static_str = 1;
-                cargo_snprintf(lenstr, sizeof(lenstr), "%s", arrsize);
-            }
-        }
+    if (!(args = calloc(2 * BENCH_REPEATS + 1, sizeof(char *))))
+        goto fail;
 
-        if (strlen(arrsize) == 0)
-        {
-            cargo_snprintf(arrsize, sizeof(arrsize), "sizeof(%s) / sizeof(%s[0])",
-                            varname, varname);
-        }
-    }
+    args[0] = "bench";
 
-    if ((types[0] == CARGO_STRING) && !array && !alloc && !static_str)
+    for (k = 0; k < BENCH_REPEATS; k++)
     {
-        fprintf(stderr, "\"char\" is not a valid variable type by itself, did you mean \"char *\"?\n");
-        return -1;
+        args[2 * k + 1] = "--val";
+        args[2 * k + 2] = "1";
     }
 
-    if (alloc) example_count++;
-    if (array) printf("size_t %s_count;\n", varname);
+    printf("Parse an option repeated %d times:\n", BENCH_REPEATS);
 
-    // TODO: Create extra examples for [s#]#
-    //if ((types[0] == CARGO_STRING)) example_count += 2;
+    if (cargo_init(&cargo, CARGO_AUTOCLEAN | CARGO_NOWARN, "bench")
+     || cargo_add_option(cargo, 0, "--val", NULL, "i", &v))
+        goto fail;
 
-    #define IS_EXTRA_EXAMPLE(num) ((j % 2) == 0)
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, 2 * BENCH_REPEATS + 1, args))
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  warnings: %8.2f ms, %6.1f ns/repeat\n",
+        ms, (ms * 1000000.0) / BENCH_REPEATS);
 
-    for (j = 0; j < example_count; j++)
-    {
-        for (i = 0; i < type_count; i++)
-        {
-            printf("cargo_add_option(cargo, 0, \"--%s", varname);
-            if (strlen(varname) > 1) printf(" -%c", varname[0]);
-            printf("\", \"Description of %s\", \"", varname);
+    if (v != 1)
+        goto fail;
 
-            if (!alloc)
-            {
-                if (static_str || array)
-                    printf(".");
-            }
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+    free(args);
+    return ret;
+    #undef BENCH_REPEATS
+}
 
-            if (array) printf("[");
+static int bench_suggestions(void)
+{
+    // Suggests names for unknown options, with many options defined.
+    #define BENCH_OPTS 5000
+    #define BENCH_UNKNOWN 1000
+    size_t k;
+    int ret = -1;
+    clock_t start;
+    double ms;
+    char name[64];
+    char **args = NULL;
+    int *vals = NULL;
+    const char *err = NULL;
+    cargo_t cargo = NULL;
 
-            printf("%c", _cargo_type_to_str(types[i])[0]);
+    if (cargo_init(&cargo, CARGO_NOERR_OUTPUT | CARGO_NOERR_USAGE, "bench")
+     || !(vals = calloc(BENCH_OPTS, sizeof(int)))
+     || !(args = calloc(BENCH_UNKNOWN + 1, sizeof(char *))))
+        goto fail;
 
-            if (array && static_str) printf("#");
-            if (array) printf("]");
+    for (k = 0; k < BENCH_OPTS; k++)
+    {
+        cargo_snprintf(name, sizeof(name), "--option-name-%lu", k);
 
-            if (array && IS_EXTRA_EXAMPLE(1))
-            {
-                printf("#");
-            }
-            else
-            {
-                if (array && alloc) printf("+");
-            }
+        if (cargo_add_option(cargo, 0, name, NULL, "b", &vals[k]))
+            goto fail;
+    }
 
-            printf("\", &%s", varname);
+    args[0] = "bench";
 
-            if (static_str) printf(", %s", lenstr);
+    // Every other one is a typo of an option.
+    for (k = 1; k <= BENCH_UNKNOWN; k++)
+    {
+        cargo_snprintf(name, sizeof(name),
+            (k % 2) ? "--optoin-name-%lu" : "--unknown-%lu", (k * 7919) % BENCH_OPTS);
 
-            if (array)
-            {
-                printf(", &%s_count", varname);
+        if (!(args[k] = strdup(name)))
+            goto fail;
+    }
 
-                if (!alloc)
-                {
-                    printf(", %s", arrsize);
-                }
-            }
+    printf("Suggest for %d unknown options against %d options:\n",
+        BENCH_UNKNOWN, BENCH_OPTS);
 
-            if (array && alloc && IS_EXTRA_EXAMPLE(1))
-            {
-                printf(", 128");
-            }
+    start = clock();
+    if (cargo_parse(cargo, 0, 1, BENCH_UNKNOWN + 1, args) != CARGO_PARSE_UNKNOWN_OPTS)
+        goto fail;
+    ms = _bench_ms(start);
+    printf("  suggestions: %8.2f ms\n", ms);
 
-            printf(");");
+    err = cargo_get_error(cargo);
 
-            if (array && alloc && IS_EXTRA_EXAMPLE(1))
-            {
-                printf(" // Allocated with max length 128.");
-            }
-            else if (array && alloc)
-            {
-                printf(" // Allocated unlimited length.");
-            }
+    if (!err || !strstr(err, "Did you mean --option-name-"))
+        goto fail;
 
-            printf("\n");
-        }
+    ret = 0;
+fail:
+    cargo_destroy(&cargo);
+
+    if (args)
+    {
+        for (k = 1; k <= BENCH_UNKNOWN; k++)
+            free(args[k]);
     }
 
-fail:
+    free(args);
+    free(vals);
     return ret;
-}
-
-#elif defined(CARGO_EXAMPLE)
+    #undef BENCH_OPTS
+    #undef BENCH_UNKNOWN
+}
+
+static cargo_bench_t benchmarks[] =
+{
+    { "option_lookup", bench_option_lookup },
+    { "compiled_parse", bench_compiled_parse },
+    { "response_file", bench_response_file },
+    { "parse_batch", bench_parse_batch },
+    { "integer_parse", bench_integer_parse },
+    { "float_parse", bench_float_parse },
+    { "parallel_convert", bench_parallel_convert },
+    { "delimited_list", bench_delimited_list },
+    { "range_list", bench_range_list },
+    { "borrowed_strings", bench_borrowed_strings },
+    { "choices_validation", bench_choices_validation },
+    { "range_validation", bench_range_validation },
+    { "repeated_option", bench_repeated_option },
+    { "suggestions", bench_suggestions }
+};
 
-typedef struct args_s
-{
-    int a;
-} args_t;
+#define CARGO_NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
 
 int main(int argc, char **argv)
 {
+    size_t i;
+    int j;
     int ret = 0;
-    cargo_t cargo;
 
-    cargo_init(&cargo, 0, argv[0]);
+    for (i = 0; i < CARGO_NUM_BENCHMARKS; i++)
+    {
+        if (argc > 1)
+        {
+            for (j = 1; j < argc; j++)
+            {
+                if (!strcmp(argv[j], benchmarks[i].name))
+                    break;
+            }
 
-    // TODO: Make a real example.
+            if (j == argc)
+                continue;
+        }
+
+        if (benchmarks[i].f())
+        {
+            fprintf(stderr, "Benchmark %s failed\n", benchmarks[i].name);
+            ret = -1;
+        }
+    }
 
-    cargo_print_usage(cargo, 0);
-    cargo_destroy(&cargo);
     return ret;
 }
 
-#endif // CARGO_EXAMPLE
+#endif // CARGO_BENCH
 
 // LCOV_EXCL_END
@@ -63,6 +63,18 @@
 #define CARGO_MAX_OPT_MUTEX_GROUP 4
 #endif
 
+//
+// Bitmap targets "m#" and bool bit targets "B" are arrays of
+// unsigned long long words.
+//
+#define CARGO_BITMAP_WORDS(bits) (((bits) + 63) / 64)
+#define CARGO_BITMAP_TEST(bitmap, bit) \
+    (((bitmap)[(bit) / 64] >> ((bit) % 64)) & 1ULL)
+#define CARGO_BITMAP_SET(bitmap, bit) \
+    ((bitmap)[(bit) / 64] |= (1ULL << ((bit) % 64)))
+#define CARGO_BITMAP_CLEAR(bitmap, bit) \
+    ((bitmap)[(bit) / 64] &= ~(1ULL << ((bit) % 64)))
+
 //
 // Colors.
 //
@@ -123,6 +135,7 @@ const char *cargo_get_version();
 //
 
 typedef struct cargo_s *cargo_t;
+typedef struct cargo_compiled_s *cargo_compiled_t;
 
 typedef enum cargo_type_e
 {
@@ -133,7 +146,8 @@ typedef enum cargo_type_e
     CARGO_DOUBLE                        = (1 << 4),
     CARGO_STRING                        = (1 << 5),
     CARGO_LONGLONG                      = (1 << 6),
-    CARGO_ULONGLONG                     = (1 << 7)
+    CARGO_ULONGLONG                     = (1 << 7),
+    CARGO_EXTENSION                     = (1 << 8)
 } cargo_type_t;
 
 //
@@ -152,7 +166,11 @@ typedef enum cargo_flags_e
     CARGO_UNIQUE_OPTS                   = (1 << 7),
     CARGO_NOWARN                        = (1 << 8),
     CARGO_UNKNOWN_EARLY                 = (1 << 9),
-    CARGO_DEFAULT_LITERALS              = (1 << 10)
+    CARGO_DEFAULT_LITERALS              = (1 << 10),
+    CARGO_ABBREV                        = (1 << 11),
+    CARGO_RESPONSE_FILES                = (1 << 12),
+    CARGO_PARALLEL_CONVERT              = (1 << 13),
+    CARGO_BORROW_STRINGS                = (1 << 14)
 } cargo_flags_t;
 
 typedef enum cargo_format_e
@@ -179,7 +197,8 @@ typedef enum cargo_option_flags_e
     CARGO_OPT_HIDE                      = (1 << 5),
     CARGO_OPT_HIDE_SHORT                = (1 << 6),
     CARGO_OPT_STOP_HARD                 = (1 << 7),
-    CARGO_OPT_DEFAULT_LITERAL           = (1 << 8)
+    CARGO_OPT_DEFAULT_LITERAL           = (1 << 8),
+    CARGO_OPT_BORROW_STRING             = (1 << 9)
 } cargo_option_flags_t;
 
 typedef enum cargo_mutex_group_flags_e
@@ -218,6 +237,24 @@ typedef enum cargo_err_flags_e
     CARGO_ERR_APPEND                    = (1 << 0)
 } cargo_err_flags_t;
 
+typedef enum cargo_error_code_e
+{
+    CARGO_ERROR_MESSAGE                 = 0,
+    CARGO_ERROR_ALREADY_PARSED          = 1,
+    CARGO_ERROR_NOT_UNIQUE              = 2,
+    CARGO_ERROR_VALUE                   = 3
+} cargo_error_code_t;
+
+typedef struct cargo_error_record_s
+{
+    cargo_error_code_t code;
+    int warning;            // Only a warning, the parse went on.
+    int opt_i;              // Index of the option, -1 if none.
+    const char *name;       // Name the option was given as, NULL if none.
+    int argi;               // Index in argv of the argument, -1 if none.
+    int prev_argi;          // Index in argv it conflicts with, -1 if none.
+} cargo_error_record_t;
+
 typedef enum cargo_width_flags_e
 {
     CARGO_WIDTH_USED                    = (0 << 0),
@@ -244,16 +281,38 @@ typedef enum cargo_validate_choices_flags_e
 typedef int (*cargo_custom_f)(cargo_t ctx, void *user, const char *optname,
                                 int argc, char **argv);
 
+// Parses a single value of a type added using cargo_add_type.
+typedef int (*cargo_type_f)(cargo_t ctx, void *user, const char *optname,
+                            const char *value, void *target);
+
+// Called for each command line parsed by cargo_parse_batch.
+typedef int (*cargo_batch_f)(cargo_t ctx, void *user, size_t line,
+                             cargo_parse_result_t result);
+
 typedef void *(*cargo_malloc_f)(size_t bytes);
 typedef void (*cargo_free_f)(void *ptr);
 typedef void *(*cargo_realloc_f)(void *ptr, size_t bytes);
 
+// Allocator used by a single context, see cargo_init_with_allocator.
+typedef struct cargo_allocator_s
+{
+    void *(*malloc_fn)(void *user, size_t bytes);
+    void *(*realloc_fn)(void *user, void *ptr, size_t bytes);
+    void (*free_fn)(void *user, void *ptr);
+    void *user;
+} cargo_allocator_t;
+
 //
 // Functions.
 //
 
 int cargo_init(cargo_t *ctx, cargo_flags_t flags, const char *progname_fmt, ...);
 
+int cargo_init_with_allocator(cargo_t *ctx,
+                              const cargo_allocator_t *allocator,
+                              cargo_flags_t flags,
+                              const char *progname_fmt, ...);
+
 void cargo_destroy(cargo_t *ctx);
 
 void cargo_set_flags(cargo_t ctx, cargo_flags_t flags);
@@ -269,6 +328,9 @@ int cargo_add_option(cargo_t ctx, cargo_option_flags_t flags,
                     const char *optnames, const char *description,
                     const char *fmt, ...);
 
+int cargo_add_type(cargo_t ctx, char fmt, const char *name, size_t size,
+                   cargo_type_f parse, void *user);
+
 int cargo_add_alias(cargo_t ctx, const char *optname, const char *alias);
 
 int cargo_set_metavarv(cargo_t ctx,
@@ -318,6 +380,35 @@ void cargo_set_internal_usage_flags(cargo_t ctx, cargo_usage_t flags);
 cargo_parse_result_t cargo_parse(cargo_t ctx, cargo_flags_t flags,
                                 int start_index, int argc, char **argv);
 
+int cargo_parse_begin(cargo_t ctx, cargo_flags_t flags);
+
+cargo_parse_result_t cargo_parse_push(cargo_t ctx, const char *arg);
+
+cargo_parse_result_t cargo_parse_push_args(cargo_t ctx,
+                                           int argc, char **argv);
+
+cargo_parse_result_t cargo_parse_end(cargo_t ctx);
+
+int cargo_parse_batch(cargo_t ctx, cargo_flags_t flags,
+                      const char *lines, size_t len,
+                      cargo_batch_f callback, void *user);
+
+int cargo_set_scratch_buffer(cargo_t ctx, void *buf, size_t size);
+
+size_t cargo_get_heap_alloc_count(cargo_t ctx);
+
+int cargo_compile(cargo_t *ctx, cargo_compiled_t *compiled,
+                  void *tmpl, size_t tmpl_size);
+
+void cargo_compiled_destroy(cargo_compiled_t *compiled);
+
+int cargo_state_init(cargo_t *state, cargo_compiled_t compiled, void *targets);
+
+int cargo_state_init_with_allocator(cargo_t *state,
+                                    cargo_compiled_t compiled,
+                                    void *targets,
+                                    const cargo_allocator_t *allocator);
+
 void cargo_set_prefix(cargo_t ctx, const char *prefix_chars);
 
 void cargo_set_max_width(cargo_t ctx, size_t max_width);
@@ -344,6 +435,9 @@ const char *cargo_get_usage(cargo_t ctx, cargo_usage_t flags);
 
 const char *cargo_get_error(cargo_t ctx);
 
+const cargo_error_record_t *cargo_get_error_records(cargo_t ctx,
+                                                    size_t *count);
+
 void cargo_set_errorv(cargo_t ctx, cargo_err_flags_t flags,
                     const char *fmt, va_list ap);
 
@@ -431,6 +525,15 @@ cargo_validation_t *cargo_validate_choices(
                                         cargo_validate_choices_flags_t flags,
                                         cargo_type_t type,
                                         size_t count, ...);
+cargo_validation_t *cargo_validate_choices_array(
+                                        cargo_validate_choices_flags_t flags,
+                                        cargo_type_t type,
+                                        size_t count, const void *choices);
+cargo_validation_t *cargo_validate_choices_map(
+                                        cargo_validate_choices_flags_t flags,
+                                        size_t count,
+                                        const char **choices,
+                                        const int *values);
 
 
 //
@@ -108,6 +108,25 @@ static int parse_rect_static_list_cb(cargo_t ctx, void *user,
     return i; // How many arguments we ate.
 }
 
+// Parses a single value for the "r" type added below. Unlike the
+// callbacks above this gets one value, and writes it straight into
+// the target.
+static int parse_rect_type(cargo_t ctx, void *user, const char *optname,
+                           const char *value, void *target)
+{
+    rect_t *r = (rect_t *)target;
+    (void)ctx;
+    (void)user;
+    (void)optname;
+
+    if (sscanf(value, "%dx%d", &r->width, &r->height) != 2)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     int ret = 0;
@@ -120,6 +139,8 @@ int main(int argc, char **argv)
     size_t rect_count = 0;
     rect_t squares[4];
     size_t squares_count = 0;
+    rect_t *boxes = NULL;
+    size_t box_count = 0;
     memset(&rect, 0, sizeof(rect));
 
     if (cargo_init(&cargo, 0, "%s", argv[0]))
@@ -140,6 +161,12 @@ int main(int argc, char **argv)
                             "[c]#", parse_rect_static_list_cb,
                             &squares, &squares_count,
                             sizeof(squares) / sizeof(squares[0])); // Max elements.
+
+    // A rect type that can be used just like the built in types.
+    ret |= cargo_add_type(cargo, 'r', "rect", sizeof(rect_t),
+                          parse_rect_type, NULL);
+    ret |= cargo_add_option(cargo, 0, "--boxes -b", "Boxes",
+                            "[r]+", &boxes, &box_count);
     assert(ret == 0);
 
     if (cargo_parse(cargo, 0, 1, argc, argv))
@@ -169,6 +196,12 @@ int main(int argc, char **argv)
               (i + 1), squares[i].width, squares[i].height);
     }
 
+    for (i = 0; i < box_count; i++)
+    {
+        printf("Box %lu: %d x %d\n",
+              (i + 1), boxes[i].width, boxes[i].height);
+    }
+
 
     cargo_destroy(&cargo);
 